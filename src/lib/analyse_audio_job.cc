@@ -27,8 +27,13 @@
 #include "filter.h"
 #include "player.h"
 #include "playlist.h"
+#include "subtitle_analyser.h"
 #include "config.h"
+#include "util.h"
+#include <dcp/filesystem.h>
+#include <boost/thread.hpp>
 #include <iostream>
+#include <numeric>
 
 #include "i18n.h"
 
@@ -41,6 +46,7 @@ using std::min;
 using std::shared_ptr;
 using std::string;
 using std::vector;
+using boost::optional;
 using namespace dcpomatic;
 #if BOOST_VERSION >= 106100
 using namespace boost::placeholders;
@@ -52,6 +58,7 @@ AnalyseAudioJob::AnalyseAudioJob (shared_ptr<const Film> film, shared_ptr<const
 	: Job (film)
 	, _analyser (film, playlist, from_zero, boost::bind(&Job::set_progress, this, _1, false))
 	, _playlist (playlist)
+	, _from_zero (from_zero)
 	, _path (film->audio_analysis_path(playlist))
 {
 	LOG_DEBUG_AUDIO_ANALYSIS_NC("AnalyseAudioJob::AnalyseAudioJob");
@@ -83,32 +90,250 @@ AnalyseAudioJob::run ()
 {
 	LOG_DEBUG_AUDIO_ANALYSIS_NC("AnalyseAudioJob::run");
 
-	auto player = make_shared<Player>(_film, _playlist);
-	player->set_ignore_video ();
-	player->set_ignore_text ();
-	player->set_fast ();
-	player->set_play_referenced ();
-	player->Audio.connect (bind(&AudioAnalyser::analyse, &_analyser, _1, _2));
+	/* Analyse, in the same pass, the subtitles of any content which needs it, so that
+	 * AnalyseSubtitlesJob will find the results waiting for it.
+	 */
+	SubtitleAnalyser subtitle_analyser (_film, SubtitleAnalyser::needing_analysis(_film, _playlist));
 
-	bool has_any_audio = false;
+	int audio_content = 0;
 	for (auto c: _playlist->content()) {
 		if (c->audio) {
-			has_any_audio = true;
+			++audio_content;
 		}
 	}
+	bool const has_any_audio = audio_content > 0;
 
-	if (has_any_audio) {
-		player->seek (_analyser.start(), true);
-		while (!player->pass ()) {}
-	}
+	auto periods = AudioAnalyser::split(_film, _playlist, _from_zero, parts());
+
+	optional<AudioAnalysis> analysis;
+	if (audio_content > 1) {
+		analysis = analyse_by_content (subtitle_analyser);
+	} else if (has_any_audio && periods.size() > 1) {
+		analysis = AudioAnalyser::merge(analyse_in_parts(periods, subtitle_analyser, [this](float p) { set_progress(p, false); }));
+	} else {
+		auto player = make_player (subtitle_analyser);
+		player->Audio.connect (bind(&AudioAnalyser::analyse, &_analyser, _1, _2));
+		player->Text.connect (bind(&SubtitleAnalyser::analyse, &subtitle_analyser, _1, _2));
 
-	LOG_DEBUG_AUDIO_ANALYSIS_NC("Loop complete");
+		if (has_any_audio) {
+			player->seek (_analyser.start(), true);
+			while (!player->pass ()) {}
+		}
 
-	_analyser.finish ();
-	auto analysis = _analyser.get();
-	analysis.write (_path);
+		LOG_DEBUG_AUDIO_ANALYSIS_NC("Loop complete");
+
+		_analyser.finish ();
+		analysis = _analyser.get();
+	}
+
+	analysis->write (_path);
+	if (has_any_audio) {
+		subtitle_analyser.write ();
+	}
 
 	LOG_DEBUG_AUDIO_ANALYSIS_NC("Job finished");
 	set_progress (1);
 	set_state (FINISHED_OK);
 }
+
+
+shared_ptr<Player>
+AnalyseAudioJob::make_player (SubtitleAnalyser const& subtitle_analyser) const
+{
+	auto player = make_shared<Player>(_film, _playlist);
+	player->set_ignore_video ();
+	if (subtitle_analyser.empty()) {
+		player->set_ignore_text ();
+	} else {
+		/* Text only goes to the subtitle analyser, which just needs positions */
+		player->set_unscaled_bitmap_text ();
+	}
+	player->set_fast ();
+	player->set_play_referenced ();
+	return player;
+}
+
+
+/** @return the number of parts to split our analysis into */
+int
+AnalyseAudioJob::parts () const
+{
+	if (!Config::instance()->parallel_audio_analysis()) {
+		return 1;
+	}
+
+	/* Don't bother splitting into parts that are shorter than this */
+	auto const minimum_part = DCPTime::from_seconds(60);
+
+	auto const length = _playlist->length(_film);
+	return std::max(1, std::min(static_cast<int>(boost::thread::hardware_concurrency()), static_cast<int>(length.get() / minimum_part.get())));
+}
+
+
+/** Analyse each of some periods of our playlist in its own thread with its own Player.
+ *  @return the analyses of the periods, in the same order.
+ */
+vector<AudioAnalyser::Part>
+AnalyseAudioJob::analyse_in_parts (
+	vector<DCPTimePeriod> const& periods, SubtitleAnalyser& subtitle_analyser, std::function<void (float)> set_overall_progress
+	)
+{
+	LOG_GENERAL ("Analysing audio in %1 parts", periods.size());
+
+	/* Protects progress, subtitle_analyser and exception */
+	boost::mutex mutex;
+	vector<float> progress(periods.size());
+	boost::exception_ptr exception;
+
+	vector<shared_ptr<AudioAnalyser>> analysers;
+	for (size_t i = 0; i < periods.size(); ++i) {
+		auto set_part_progress = [i, &mutex, &progress, set_overall_progress](float p) {
+			boost::mutex::scoped_lock lm (mutex);
+			progress[i] = p;
+			set_overall_progress (std::accumulate(progress.begin(), progress.end(), 0.0f) / progress.size());
+		};
+		analysers.push_back (make_shared<AudioAnalyser>(_film, _playlist, _from_zero, set_part_progress, periods[i]));
+	}
+
+	boost::thread_group threads;
+	for (size_t i = 0; i < periods.size(); ++i) {
+		threads.create_thread ([this, i, &periods, &analysers, &subtitle_analyser, &mutex, &exception]() {
+			try {
+				start_of_thread ("AnalyseAudio");
+				auto analyser = analysers[i];
+				auto player = make_player (subtitle_analyser);
+				player->Audio.connect (bind(&AudioAnalyser::analyse, analyser.get(), _1, _2));
+				player->Text.connect ([&mutex, &subtitle_analyser](PlayerText text, TextType type, optional<DCPTextTrack>, DCPTimePeriod) {
+					boost::mutex::scoped_lock lm (mutex);
+					subtitle_analyser.analyse (text, type);
+				});
+				player->seek (periods[i].from, true);
+				while (!analyser->period_done() && !player->pass()) {
+					boost::this_thread::interruption_point ();
+				}
+				analyser->finish ();
+			} catch (boost::thread_interrupted &) {
+				/* The job has been cancelled */
+			} catch (...) {
+				boost::mutex::scoped_lock lm (mutex);
+				exception = boost::current_exception ();
+			}
+		});
+	}
+
+	try {
+		threads.join_all ();
+	} catch (boost::thread_interrupted &) {
+		threads.interrupt_all ();
+		threads.join_all ();
+		throw;
+	}
+
+	if (exception) {
+		boost::rethrow_exception (exception);
+	}
+
+	LOG_DEBUG_AUDIO_ANALYSIS_NC("Parts complete");
+
+	vector<AudioAnalyser::Part> parts;
+	for (auto analyser: analysers) {
+		parts.push_back(analyser->part());
+	}
+	return parts;
+}
+
+
+/** Move the times of the sample peaks in an analysis by some offset */
+static void
+shift_sample_peaks (AudioAnalysis& analysis, DCPTime offset)
+{
+	auto peaks = analysis.sample_peak();
+	for (auto& peak: peaks) {
+		peak.time += offset;
+	}
+	analysis.set_sample_peak(peaks);
+}
+
+
+/** Analyse our playlist in regions split around its pieces of content (see AudioAnalyser::split_by_content),
+ *  re-using any analyses of those regions which were made before (perhaps for a different playlist),
+ *  so that when content is added, removed or moved only the parts of the playlist around the change
+ *  need to be looked at again.
+ */
+AudioAnalysis
+AnalyseAudioJob::analyse_by_content (SubtitleAnalyser& subtitle_analyser)
+{
+	auto const regions = AudioAnalyser::split_by_content(_film, _playlist, _from_zero);
+	auto const start = _analyser.start();
+	auto const rate = _film->audio_frame_rate();
+
+	vector<optional<AudioAnalyser::Part>> parts(regions.size());
+	vector<size_t> missing;
+
+	for (size_t i = 0; i < regions.size(); ++i) {
+		auto const& region = regions[i];
+		/* If there are subtitles to analyse we must look at the whole playlist anyway */
+		if (region.digest && subtitle_analyser.empty()) {
+			auto const path = _film->audio_analysis_region_path(*region.digest);
+			if (dcp::filesystem::exists(path)) {
+				try {
+					AudioAnalysis analysis(path);
+					/* Cached analyses have their peak times relative to the start of the region */
+					shift_sample_peaks(analysis, region.period.from - start);
+					parts[i] = AudioAnalyser::Part{analysis, region.period.duration().frames_round(rate)};
+				} catch (std::exception& e) {
+					LOG_GENERAL("Could not use cached audio analysis %1 (%2)", path.string(), e.what());
+				}
+			}
+		}
+
+		if (!parts[i]) {
+			missing.push_back(i);
+		}
+	}
+
+	LOG_GENERAL("Re-using %1 of %2 audio analysis regions", regions.size() - missing.size(), regions.size());
+
+	size_t const batch = Config::instance()->parallel_audio_analysis() ? std::max(1U, boost::thread::hardware_concurrency()) : 1;
+
+	DCPTime total;
+	for (auto i: missing) {
+		total += regions[i].period.duration();
+	}
+
+	DCPTime done;
+	for (size_t i = 0; i < missing.size(); i += batch) {
+		auto const end = min(missing.size(), i + batch);
+
+		vector<DCPTimePeriod> periods;
+		DCPTime batch_length;
+		for (auto j = i; j < end; ++j) {
+			periods.push_back(regions[missing[j]].period);
+			batch_length += regions[missing[j]].period.duration();
+		}
+
+		auto analysed = analyse_in_parts(periods, subtitle_analyser, [this, done, batch_length, total](float p) {
+			set_progress((done.seconds() + p * batch_length.seconds()) / total.seconds(), false);
+		});
+
+		for (auto j = i; j < end; ++j) {
+			auto const& region = regions[missing[j]];
+			auto const& part = analysed[j - i];
+			if (region.digest) {
+				auto cached = part.analysis;
+				shift_sample_peaks(cached, start - region.period.from);
+				cached.write(_film->audio_analysis_region_path(*region.digest));
+			}
+			parts[missing[j]] = part;
+		}
+
+		done += batch_length;
+	}
+
+	vector<AudioAnalyser::Part> all;
+	for (auto const& part: parts) {
+		all.push_back(*part);
+	}
+
+	return AudioAnalyser::merge(all);
+}
@@ -34,8 +34,10 @@
 
 class AudioBuffers;
 class AudioAnalysis;
+class Player;
 class Playlist;
 class AudioPoint;
+class SubtitleAnalyser;
 class AudioFilterGraph;
 class Filter;
 
@@ -65,9 +67,17 @@ public:
 	}
 
 private:
+	std::shared_ptr<Player> make_player (SubtitleAnalyser const& subtitle_analyser) const;
+	int parts () const;
+	std::vector<AudioAnalyser::Part> analyse_in_parts (
+		std::vector<dcpomatic::DCPTimePeriod> const& periods, SubtitleAnalyser& subtitle_analyser, std::function<void (float)> set_overall_progress
+		);
+	AudioAnalysis analyse_by_content (SubtitleAnalyser& subtitle_analyser);
+
 	AudioAnalyser _analyser;
 
 	std::shared_ptr<const Playlist> _playlist;
+	bool _from_zero;
 	/** playlist's audio analysis path when the job was created */
 	boost::filesystem::path _path;
 
@@ -20,15 +20,13 @@
 
 
 #include "analyse_subtitles_job.h"
-#include "bitmap_text.h"
+#include "exceptions.h"
 #include "film.h"
-#include "image.h"
 #include "player.h"
 #include "playlist.h"
-#include "render_text.h"
+#include "subtitle_analyser.h"
 #include "subtitle_analysis.h"
-#include "text_content.h"
-#include <iostream>
+#include <dcp/filesystem.h>
 
 #include "i18n.h"
 
@@ -72,11 +70,30 @@ AnalyseSubtitlesJob::run ()
 	DCPOMATIC_ASSERT (content);
 	playlist->add (_film, content);
 
+	if (dcp::filesystem::exists(_path)) {
+		try {
+			/* Another analysis pass (e.g. for audio) has already done this for us */
+			SubtitleAnalysis existing (_path);
+			set_progress (1);
+			set_state (FINISHED_OK);
+			return;
+		} catch (OldFormatError &) {
+			/* Re-make it */
+		}
+	}
+
+	SubtitleAnalyser analyser (_film, { content });
+
 	auto player = make_shared<Player>(_film, playlist);
+	/* We only need the positions of the text, so there's no need for video (which would
+	 * also have any subtitles rendered into it) or properly-scaled bitmap subtitles.
+	 */
+	player->set_ignore_video ();
 	player->set_ignore_audio ();
+	player->set_unscaled_bitmap_text ();
 	player->set_fast ();
 	player->set_play_referenced ();
-	player->Text.connect (bind(&AnalyseSubtitlesJob::analyse, this, _1, _2));
+	player->Text.connect (bind(&SubtitleAnalyser::analyse, &analyser, _1, _2));
 
 	set_progress_unknown ();
 
@@ -86,63 +103,9 @@ AnalyseSubtitlesJob::run ()
 		}
 	}
 
-	SubtitleAnalysis analysis (_bounding_box, content->text.front()->x_offset(), content->text.front()->y_offset());
-	analysis.write (_path);
+	analyser.write ();
 
 	set_progress (1);
 	set_state (FINISHED_OK);
 }
 
-
-void
-AnalyseSubtitlesJob::analyse(PlayerText const& text, TextType type)
-{
-	if (type != TextType::OPEN_SUBTITLE) {
-		return;
-	}
-
-	for (auto const& i: text.bitmap) {
-		if (!_bounding_box) {
-			_bounding_box = i.rectangle;
-		} else {
-			_bounding_box->extend (i.rectangle);
-		}
-	}
-
-	if (text.string.empty()) {
-		return;
-	}
-
-	/* We can provide dummy values for time and frame rate here as they are only used to calculate fades */
-	dcp::Size const frame = _film->frame_size();
-	std::vector<dcp::SubtitleStandard> override_standard;
-	if (_film->interop()) {
-		/* Since the film is Interop there is only one way the vpositions in the subs can be interpreted
-		 * (we assume).
-		 */
-		override_standard.push_back(dcp::SubtitleStandard::INTEROP);
-	} else {
-		/* We're using the great new SMPTE standard, which means there are two different ways that vposition
-		 * could be interpreted; we will write SMPTE-2014 standard assets, but if the projection system uses
-		 * SMPTE 20{07,10} instead they won't be placed how we intended.  To show the user this, make the
-		 * bounding rectangle enclose both possibilities.
-		 */
-		override_standard.push_back(dcp::SubtitleStandard::SMPTE_2007);
-		override_standard.push_back(dcp::SubtitleStandard::SMPTE_2014);
-	}
-
-	for (auto standard: override_standard) {
-		for (auto i: bounding_box(text.string, frame, standard)) {
-			dcpomatic::Rect<double> rect (
-				double(i.x) / frame.width, double(i.y) / frame.height,
-				double(i.width) / frame.width, double(i.height) / frame.height
-				);
-			if (!_bounding_box) {
-				_bounding_box = rect;
-			} else {
-				_bounding_box->extend (rect);
-			}
-		}
-	}
-}
-
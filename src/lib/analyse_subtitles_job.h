@@ -42,10 +42,7 @@ public:
 	}
 
 private:
-	void analyse(PlayerText const& text, TextType type);
-
 	std::weak_ptr<Content> _content;
 	boost::filesystem::path _path;
-	boost::optional<dcpomatic::Rect<double>> _bounding_box;
 };
 
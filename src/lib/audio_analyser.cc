@@ -25,12 +25,16 @@
 #include "audio_content.h"
 #include "audio_filter_graph.h"
 #include "audio_point.h"
+#include "audio_processor.h"
 #include "config.h"
 #include "dcpomatic_log.h"
+#include "digester.h"
 #include "film.h"
 #include "filter.h"
 #include "playlist.h"
+#include "true_peak_meter.h"
 #include <dcp/warnings.h>
+#include <algorithm>
 extern "C" {
 #include <leqm_nrt.h>
 LIBDCP_DISABLE_WARNINGS
@@ -44,28 +48,84 @@ LIBDCP_ENABLE_WARNINGS
 
 using std::make_shared;
 using std::max;
+using std::min;
 using std::shared_ptr;
+using std::string;
 using std::vector;
+using boost::optional;
 using namespace dcpomatic;
 
 
-static auto constexpr num_points = 1024;
+/* Enough points that AudioPlot can zoom in a long way; it uses AudioAnalysis's lower-resolution levels when zoomed out */
+static auto constexpr num_points = 32768;
 
 
-AudioAnalyser::AudioAnalyser (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist, bool from_zero, std::function<void (float)> set_progress)
+/* We may struggle to serialise and recover inf or -inf, so prevent such
+   values by replacing tiny samples with this (140dB down) */
+static inline float
+clamped_abs (float s)
+{
+	return max(fabsf(s), 10e-7f);
+}
+
+
+/** Find the peak of clamped_abs() of some samples, and the sum of their squares */
+static void
+peak_and_sum_of_squares (float const* data, int frames, float& peak, float& sum_of_squares)
+{
+	/* Keep separate results for each of a group of adjacent samples so that the
+	 * compiler can vectorise the loop without re-ordering any sums.
+	 */
+	int constexpr width = 8;
+	float peaks[width] = { 0 };
+	float sums[width] = { 0 };
+
+	int i = 0;
+	for (; i + width <= frames; i += width) {
+		for (int j = 0; j < width; ++j) {
+			auto const as = clamped_abs(data[i + j]);
+			sums[j] += as * as;
+			peaks[j] = max(peaks[j], as);
+		}
+	}
+
+	for (; i < frames; ++i) {
+		auto const as = clamped_abs(data[i]);
+		sums[0] += as * as;
+		peaks[0] = max(peaks[0], as);
+	}
+
+	peak = 0;
+	sum_of_squares = 0;
+	for (int j = 0; j < width; ++j) {
+		peak = max(peak, peaks[j]);
+		sum_of_squares += sums[j];
+	}
+}
+
+
+AudioAnalyser::AudioAnalyser (
+	shared_ptr<const Film> film,
+	shared_ptr<const Playlist> playlist,
+	bool from_zero,
+	std::function<void (float)> set_progress,
+	optional<DCPTimePeriod> period
+	)
 	: _film (film)
 	, _playlist (playlist)
 	, _set_progress (set_progress)
+	, _period (period)
 #ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 	, _ebur128 (new AudioFilterGraph(film->audio_frame_rate(), film->audio_channels()))
 #endif
+	, _true_peak (film->audio_channels())
 	, _sample_peak (film->audio_channels())
 	, _sample_peak_frame (film->audio_channels())
 	, _analysis (film->audio_channels())
 {
 
 #ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
-	_filters.push_back (new Filter("ebur128", "ebur128", "audio", "ebur128=peak=true"));
+	_filters.push_back (new Filter("ebur128", "ebur128", "audio", "ebur128"));
 	_ebur128->setup (_filters);
 #endif
 
@@ -114,13 +174,159 @@ AudioAnalyser::AudioAnalyser (shared_ptr<const Film> film, shared_ptr<const Play
 		channel_corrections,
 		850, // suggested by leqm_nrt CLI source
 		64,  // suggested by leqm_nrt CLI source
-		boost::thread::hardware_concurrency()
+		/* If we're one part of a larger analysis the other parts will be using the other threads */
+		_period ? 1 : boost::thread::hardware_concurrency()
 		));
 
-	DCPTime const length = _playlist->length (_film);
+	_samples_per_point = samples_per_point(film, playlist, _start);
+
+	if (_period) {
+		DCPOMATIC_ASSERT (_period->from >= _start);
+		_done = _first_frame = (_period->from - _start).frames_round(film->audio_frame_rate());
+	}
+}
+
+
+Frame
+AudioAnalyser::samples_per_point (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist, DCPTime start)
+{
+	Frame const len = DCPTime(playlist->length(film) - start).frames_round(film->audio_frame_rate());
+	/* Use a power of two so that small changes to the playlist's length (e.g. adding a trailer)
+	 * usually leave this unchanged, and analyses of regions (see split_by_content()) can be re-used.
+	 */
+	Frame spp = 1;
+	while (spp * 2 <= len / num_points) {
+		spp *= 2;
+	}
+	return spp;
+}
+
+
+vector<DCPTimePeriod>
+AudioAnalyser::split (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist, bool from_zero, int parts)
+{
+	DCPOMATIC_ASSERT (parts > 0);
+
+	auto const start = from_zero ? DCPTime() : playlist->start().get_value_or(DCPTime());
+	auto const rate = film->audio_frame_rate();
+	auto const spp = samples_per_point(film, playlist, start);
+	auto const length = DCPTime(playlist->length(film) - start).frames_round(rate);
+
+	/* A point is added on the first sample of every group of spp samples (see ::analyse), so
+	 * if every part after the first starts just after one of those the parts' points will be
+	 * the same as if one analyser had done the whole lot.
+	 */
+	auto const points_per_part = (length / spp) / parts;
+
+	vector<DCPTimePeriod> periods;
+	Frame from = 0;
+	for (int i = 1; i < parts && points_per_part > 0; ++i) {
+		auto const to = i * points_per_part * spp + 1;
+		periods.push_back (DCPTimePeriod(start + DCPTime::from_frames(from, rate), start + DCPTime::from_frames(to, rate)));
+		from = to;
+	}
+	periods.push_back (DCPTimePeriod(start + DCPTime::from_frames(from, rate), start + DCPTime::from_frames(length, rate)));
+
+	return periods;
+}
+
+
+vector<AudioAnalyser::Region>
+AudioAnalyser::split_by_content (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist, bool from_zero)
+{
+	auto const start = from_zero ? DCPTime() : playlist->start().get_value_or(DCPTime());
+	auto const rate = film->audio_frame_rate();
+	auto const spp = samples_per_point(film, playlist, start);
+	auto const length = DCPTime(playlist->length(film) - start).frames_round(rate);
+	/* Don't bother with regions of their own for pieces of content shorter than this */
+	auto const minimum = DCPTime::from_seconds(2).frames_round(rate);
+
+	auto to_frame = [start, rate, length](DCPTime time) -> Frame {
+		return max(Frame(0), min(length, DCPTime(time - start).frames_round(rate)));
+	};
+
+	auto to_time = [start, rate](Frame frame) {
+		return start + DCPTime::from_frames(frame, rate);
+	};
+
+	/* As in split(), every region after the first must start just after the end of a point */
+	auto align_up = [spp](Frame frame) -> Frame {
+		return frame == 0 ? 0 : ((frame + spp - 2) / spp) * spp + 1;
+	};
+
+	auto align_down = [spp](Frame frame) -> Frame {
+		return frame == 0 ? 0 : ((frame - 1) / spp) * spp + 1;
+	};
+
+	auto const content = playlist->content();
+
+	vector<Region> own;
+	for (auto i: content) {
+		if (!i->audio) {
+			continue;
+		}
+
+		auto const content_from = to_frame(i->position());
+		auto const from = align_up(content_from);
+		auto const to = align_down(to_frame(i->end(film)));
+		if (to - from < minimum) {
+			continue;
+		}
+
+		DCPTimePeriod const period(to_time(from), to_time(to));
+		bool overlapped = false;
+		for (auto j: content) {
+			if (j != i && j->audio && DCPTimePeriod(j->position(), j->end(film)).overlap(period)) {
+				overlapped = true;
+			}
+		}
+
+		if (overlapped) {
+			continue;
+		}
+
+		Digester digester;
+		digester.add(i->digest());
+		digester.add(i->audio->mapping().digest());
+		digester.add(i->audio->gain());
+		digester.add(i->audio->delay());
+		digester.add(i->audio->fade_in().get());
+		digester.add(i->audio->fade_out().get());
+		digester.add(i->trim_start().get());
+		digester.add(from - content_from);
+		digester.add(to - from);
+		digester.add(spp);
+		digester.add(rate);
+		digester.add(film->audio_channels());
+		digester.add(film->video_frame_rate());
+		if (film->audio_processor()) {
+			digester.add(film->audio_processor()->id());
+		}
+		digester.add(Config::instance()->analyse_ebur128());
 
-	Frame const len = DCPTime (length - _start).frames_round (film->audio_frame_rate());
-	_samples_per_point = max (int64_t (1), len / num_points);
+		own.push_back({period, digester.get()});
+	}
+
+	std::sort(own.begin(), own.end(), [](Region const& a, Region const& b) {
+		return a.period.from < b.period.from;
+	});
+
+	/* Fill in the gaps between the content regions */
+	vector<Region> regions;
+	auto done = start;
+	for (auto const& i: own) {
+		if (i.period.from > done) {
+			regions.push_back({DCPTimePeriod(done, i.period.from), boost::none});
+		}
+		regions.push_back(i);
+		done = i.period.to;
+	}
+
+	if (done < to_time(length) || regions.empty()) {
+		regions.push_back({DCPTimePeriod(done, to_time(length)), boost::none});
+	}
+
+	return regions;
 }
 
 
@@ -143,12 +349,28 @@ AudioAnalyser::analyse (shared_ptr<AudioBuffers> b, DCPTime time)
 	 */
 	DCPOMATIC_ASSERT(b->frames() < 480000);
 
+	if (_period) {
+		/* Only look at the part of this block which is in our period */
+		auto const rate = _film->audio_frame_rate();
+		auto const skip = max(Frame(0), (_period->from - time).frames_round(rate));
+		auto const take = min(Frame(b->frames()), (_period->to - time).frames_round(rate)) - skip;
+		if (take <= 0) {
+			return;
+		}
+		if (skip > 0 || take < b->frames()) {
+			b = make_shared<AudioBuffers>(b, take, skip);
+			time += DCPTime::from_frames(skip, rate);
+		}
+	}
+
 #ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 	if (Config::instance()->analyse_ebur128 ()) {
 		_ebur128->process (b);
 	}
 #endif
 
+	_true_peak.process (*b);
+
 	int const frames = b->frames ();
 	int const channels = b->channels ();
 	vector<double> interleaved(frames * channels);
@@ -156,29 +378,42 @@ AudioAnalyser::analyse (shared_ptr<AudioBuffers> b, DCPTime time)
 	for (int j = 0; j < channels; ++j) {
 		float const* data = b->data(j);
 		for (int i = 0; i < frames; ++i) {
-			float s = data[i];
-
-			interleaved[i * channels + j] = s;
-
-			float as = fabsf (s);
-			if (as < 10e-7) {
-				/* We may struggle to serialise and recover inf or -inf, so prevent such
-				   values by replacing with this (140dB down) */
-				s = as = 10e-7;
-			}
-			_current[j][AudioPoint::RMS] += pow (s, 2);
-			_current[j][AudioPoint::PEAK] = max (_current[j][AudioPoint::PEAK], as);
+			interleaved[i * channels + j] = data[i];
+		}
+	}
 
-			if (as > _sample_peak[j]) {
-				_sample_peak[j] = as;
-				_sample_peak_frame[j] = _done + i;
+	for (int j = 0; j < channels; ++j) {
+		float const* data = b->data(j);
+		int i = 0;
+		while (i < frames) {
+			/* Take samples up to and including the next one which ends a point */
+			auto const to_point_end = (_samples_per_point - ((_done + i) % _samples_per_point)) % _samples_per_point;
+			int const end = min(Frame(frames), i + to_point_end + 1);
+
+			float peak;
+			float sum_of_squares;
+			peak_and_sum_of_squares (data + i, end - i, peak, sum_of_squares);
+
+			_current[j][AudioPoint::RMS] += sum_of_squares;
+			_current[j][AudioPoint::PEAK] = max (_current[j][AudioPoint::PEAK], peak);
+
+			if (peak > _sample_peak[j]) {
+				/* Find the first sample with this new peak value */
+				int k = i;
+				while (clamped_abs(data[k]) != peak) {
+					++k;
+				}
+				_sample_peak[j] = peak;
+				_sample_peak_frame[j] = _done + k;
 			}
 
-			if (((_done + i) % _samples_per_point) == 0) {
+			if (((_done + end - 1) % _samples_per_point) == 0) {
 				_current[j][AudioPoint::RMS] = sqrt (_current[j][AudioPoint::RMS] / _samples_per_point);
 				_analysis.add_point (j, _current[j]);
 				_current[j] = AudioPoint ();
 			}
+
+			i = end;
 		}
 	}
 
@@ -186,12 +421,23 @@ AudioAnalyser::analyse (shared_ptr<AudioBuffers> b, DCPTime time)
 
 	_done += frames;
 
-	DCPTime const length = _playlist->length (_film);
-	_set_progress ((time.seconds() - _start.seconds()) / (length.seconds() - _start.seconds()));
+	if (_period) {
+		_set_progress ((time.seconds() - _period->from.seconds()) / (_period->to.seconds() - _period->from.seconds()));
+	} else {
+		DCPTime const length = _playlist->length (_film);
+		_set_progress ((time.seconds() - _start.seconds()) / (length.seconds() - _start.seconds()));
+	}
 	LOG_DEBUG_AUDIO_ANALYSIS_NC("Frames processed");
 }
 
 
+bool
+AudioAnalyser::period_done () const
+{
+	return _period && _done >= (_period->to - _start).frames_round(_film->audio_frame_rate());
+}
+
+
 void
 AudioAnalyser::finish ()
 {
@@ -203,14 +449,12 @@ AudioAnalyser::finish ()
 	}
 	_analysis.set_sample_peak (sample_peak);
 
+	_true_peak.flush ();
+	_analysis.set_true_peak (_true_peak.peaks());
+
 #ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 	if (Config::instance()->analyse_ebur128 ()) {
 		void* eb = _ebur128->get("Parsed_ebur128_0")->priv;
-		vector<float> true_peak;
-		for (int i = 0; i < _film->audio_channels(); ++i) {
-			true_peak.push_back (av_ebur128_get_true_peaks(eb)[i]);
-		}
-		_analysis.set_true_peak (true_peak);
 		_analysis.set_integrated_loudness (av_ebur128_get_integrated_loudness(eb));
 		_analysis.set_loudness_range (av_ebur128_get_loudness_range(eb));
 	}
@@ -229,3 +473,75 @@ AudioAnalyser::finish ()
 	_analysis.set_sample_rate (_film->audio_frame_rate ());
 	_analysis.set_leqm (_leqm->leq_m());
 }
+
+
+AudioAnalysis
+AudioAnalyser::merge (vector<shared_ptr<AudioAnalyser>> const& analysers)
+{
+	vector<Part> parts;
+	for (auto analyser: analysers) {
+		parts.push_back(analyser->part());
+	}
+	return merge(parts);
+}
+
+
+AudioAnalysis
+AudioAnalyser::merge (vector<Part> const& parts)
+{
+	DCPOMATIC_ASSERT (!parts.empty());
+
+	auto const& first = parts.front().analysis;
+	auto const channels = first.channels();
+
+	AudioAnalysis merged (channels);
+	auto sample_peak = first.sample_peak();
+	auto true_peak = first.true_peak();
+	/* Sum of energy and of frames, to merge Leq(m) and integrated loudness */
+	double leqm_energy = 0;
+	double loudness_energy = 0;
+	bool have_loudness = true;
+	Frame frames = 0;
+
+	for (size_t i = 0; i < parts.size(); ++i) {
+		auto const& analysis = parts[i].analysis;
+
+		for (int c = 0; c < channels; ++c) {
+			for (int p = 0; p < analysis.points(c); ++p) {
+				merged.add_point (c, analysis.get_point(c, p));
+			}
+			auto const peak = analysis.sample_peak()[c];
+			if (peak.peak > sample_peak[c].peak) {
+				sample_peak[c] = peak;
+			}
+			if (!true_peak.empty() && !analysis.true_peak().empty()) {
+				true_peak[c] = max(true_peak[c], analysis.true_peak()[c]);
+			}
+		}
+
+		auto const part_frames = parts[i].frames;
+		frames += part_frames;
+		leqm_energy += part_frames * pow(10, analysis.leqm().get_value_or(0) / 10);
+		if (analysis.integrated_loudness()) {
+			loudness_energy += part_frames * pow(10, *analysis.integrated_loudness() / 10);
+		} else {
+			have_loudness = false;
+		}
+	}
+
+	merged.set_sample_peak (sample_peak);
+	merged.set_true_peak (true_peak);
+	if (auto gain = first.analysis_gain()) {
+		merged.set_analysis_gain (*gain);
+	}
+	merged.set_samples_per_point (first.samples_per_point());
+	merged.set_sample_rate (first.sample_rate());
+	if (frames > 0) {
+		merged.set_leqm (10 * log10(leqm_energy / frames));
+		if (have_loudness) {
+			merged.set_integrated_loudness (10 * log10(loudness_energy / frames));
+		}
+	}
+
+	return merged;
+}
@@ -21,10 +21,12 @@
 
 #include "audio_analysis.h"
 #include "dcpomatic_time.h"
+#include "true_peak_meter.h"
 #include "types.h"
 #include <leqm_nrt.h>
 #include <boost/scoped_ptr.hpp>
 #include <memory>
+#include <vector>
 
 
 class AudioAnalysis;
@@ -39,7 +41,16 @@ class Playlist;
 class AudioAnalyser
 {
 public:
-	AudioAnalyser (std::shared_ptr<const Film> film, std::shared_ptr<const Playlist> playlist, bool from_zero, std::function<void (float)> set_progress);
+	/** @param period Period of the playlist to analyse, if not all of it; used when splitting an analysis into
+	 *  parts which can run in parallel (see split() and merge()).
+	 */
+	AudioAnalyser (
+		std::shared_ptr<const Film> film,
+		std::shared_ptr<const Playlist> playlist,
+		bool from_zero,
+		std::function<void (float)> set_progress,
+		boost::optional<dcpomatic::DCPTimePeriod> period = boost::none
+		);
 	~AudioAnalyser ();
 
 	AudioAnalyser (AudioAnalyser const&) = delete;
@@ -51,19 +62,71 @@ public:
 		return _start;
 	}
 
+	/** @return true if we were given a period and have now seen all of it */
+	bool period_done () const;
+
 	void finish ();
 
 	AudioAnalysis get () const {
 		return _analysis;
 	}
 
+	/** A finished analysis of some period, and the number of frames that it covers */
+	struct Part
+	{
+		AudioAnalysis analysis;
+		Frame frames;
+	};
+
+	Part part () const {
+		return { _analysis, _done - _first_frame };
+	}
+
+	/** A period made by split_by_content() */
+	struct Region
+	{
+		dcpomatic::DCPTimePeriod period;
+		/** If all the audio in this period comes from one piece of content, a digest of that
+		 *  content, its audio settings and the period's place within it.  An analysis of the
+		 *  period can then be re-used for any region with the same digest, in any playlist
+		 *  whose analyses have the same samples per point.
+		 */
+		boost::optional<std::string> digest;
+	};
+
+	/** @return consecutive periods which cover the playlist, with boundaries placed so that
+	 *  separate AudioAnalysers for each can have their results merged together with merge().
+	 */
+	static std::vector<dcpomatic::DCPTimePeriod> split (
+		std::shared_ptr<const Film> film, std::shared_ptr<const Playlist> playlist, bool from_zero, int parts
+		);
+
+	/** Merge the results of finished analysers made for the periods returned by split().
+	 *  Peaks, points and Leq(m) are merged exactly (apart from filter start-up at the
+	 *  boundaries) but integrated loudness is approximated by an energy-weighted mean of
+	 *  the parts, and loudness range cannot be merged so it is not set.
+	 */
+	static AudioAnalysis merge (std::vector<std::shared_ptr<AudioAnalyser>> const& parts);
+	static AudioAnalysis merge (std::vector<Part> const& parts);
+
+	/** @return consecutive regions which cover the playlist, like split(), but with boundaries
+	 *  placed so that the middle of each piece of audio content which does not overlap any other
+	 *  is in a region of its own.
+	 */
+	static std::vector<Region> split_by_content (
+		std::shared_ptr<const Film> film, std::shared_ptr<const Playlist> playlist, bool from_zero
+		);
+
 private:
+	static Frame samples_per_point (std::shared_ptr<const Film> film, std::shared_ptr<const Playlist> playlist, dcpomatic::DCPTime start);
+
 	std::shared_ptr<const Film> _film;
 	std::shared_ptr<const Playlist> _playlist;
 
 	std::function<void (float)> _set_progress;
 
 	dcpomatic::DCPTime _start;
+	boost::optional<dcpomatic::DCPTimePeriod> _period;
 #ifdef DCPOMATIC_HAVE_EBUR128_PATCHED_FFMPEG
 	std::shared_ptr<AudioFilterGraph> _ebur128;
 #endif
@@ -72,6 +135,11 @@ private:
 
 	boost::scoped_ptr<leqm_nrt::Calculator> _leqm;
 	Frame _done = 0;
+	/** value of _done when we started, which is non-zero if we are analysing a period
+	 *  which does not start at _start.
+	 */
+	Frame _first_frame = 0;
+	TruePeakMeter _true_peak;
 	std::vector<float> _sample_peak;
 	std::vector<Frame> _sample_peak_frame;
 	std::vector<AudioPoint> _current;
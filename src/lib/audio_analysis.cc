@@ -22,8 +22,11 @@
 #include "audio_analysis.h"
 #include "audio_content.h"
 #include "cross.h"
+#include "exceptions.h"
 #include "playlist.h"
 #include "util.h"
+#include <dcp/file.h>
+#include <dcp/filesystem.h>
 #include <dcp/raw_convert.h>
 #include <dcp/warnings.h>
 LIBDCP_DISABLE_WARNINGS
@@ -32,7 +35,9 @@ LIBDCP_ENABLE_WARNINGS
 #include <boost/filesystem.hpp>
 #include <stdint.h>
 #include <cmath>
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <inttypes.h>
 
@@ -63,7 +68,166 @@ AudioAnalysis::AudioAnalysis (int channels)
 }
 
 
+/* The binary format is written in native byte order (little-endian on all the platforms
+ * that we support) and is laid out so that the point data could be mapped straight into memory:
+ *
+ *   char[8]  binary_magic
+ *   uint32   _current_binary_version
+ *   uint32   number of channels
+ *   int64    samples per point
+ *   int32    sample rate
+ *   uint32   flags saying which of the following 4 values are present
+ *   float    integrated loudness
+ *   float    loudness range
+ *   double   analysis gain
+ *   double   Leq(m)
+ *   uint32   number of sample peaks
+ *   uint32   number of true peaks
+ *   for each sample peak: float peak, int64 time
+ *   for each true peak: float peak
+ *   for each channel: uint64 number of points
+ *   padding to a multiple of 8 bytes
+ *   for each channel: its points, each as AudioPoint::COUNT floats
+ */
+int const AudioAnalysis::_current_binary_version = 1;
+static char const binary_magic[8] = { 'D', 'O', 'M', 'A', 'U', 'D', 'A', 'N' };
+
+enum BinaryFlags {
+	HAVE_INTEGRATED_LOUDNESS = 0x1,
+	HAVE_LOUDNESS_RANGE = 0x2,
+	HAVE_ANALYSIS_GAIN = 0x4,
+	HAVE_LEQM = 0x8
+};
+
+
+template <class T>
+void
+read_value (dcp::File& f, T& value)
+{
+	f.checked_read(&value, sizeof(T));
+}
+
+
+template <class T>
+void
+write_value (dcp::File& f, T value)
+{
+	f.checked_write(&value, sizeof(T));
+}
+
+
 AudioAnalysis::AudioAnalysis (boost::filesystem::path filename)
+{
+	char magic[sizeof(binary_magic)];
+	bool binary = false;
+	{
+		dcp::File f(filename, "rb");
+		if (!f) {
+			throw OpenFileError(filename, errno, OpenFileError::READ);
+		}
+		binary = f.read(magic, 1, sizeof(magic)) == sizeof(magic) && memcmp(magic, binary_magic, sizeof(magic)) == 0;
+	}
+
+	if (binary) {
+		read_binary (filename);
+	} else {
+		read_xml (filename);
+	}
+}
+
+
+void
+AudioAnalysis::read_binary (boost::filesystem::path filename)
+{
+	dcp::File f(filename, "rb");
+	if (!f) {
+		throw OpenFileError(filename, errno, OpenFileError::READ);
+	}
+
+	char magic[sizeof(binary_magic)];
+	f.checked_read(magic, sizeof(magic));
+
+	uint32_t version;
+	read_value(f, version);
+	if (version != _current_binary_version) {
+		throw OldFormatError ("Audio analysis file is an unknown version");
+	}
+
+	uint32_t channels;
+	read_value(f, channels);
+	read_value(f, _samples_per_point);
+	int32_t sample_rate;
+	read_value(f, sample_rate);
+	_sample_rate = sample_rate;
+
+	uint32_t flags;
+	read_value(f, flags);
+	float integrated_loudness;
+	read_value(f, integrated_loudness);
+	float loudness_range;
+	read_value(f, loudness_range);
+	double analysis_gain;
+	read_value(f, analysis_gain);
+	double leqm;
+	read_value(f, leqm);
+
+	if (flags & HAVE_INTEGRATED_LOUDNESS) {
+		_integrated_loudness = integrated_loudness;
+	}
+	if (flags & HAVE_LOUDNESS_RANGE) {
+		_loudness_range = loudness_range;
+	}
+	if (flags & HAVE_ANALYSIS_GAIN) {
+		_analysis_gain = analysis_gain;
+	}
+	if (flags & HAVE_LEQM) {
+		_leqm = leqm;
+	}
+
+	uint32_t sample_peaks;
+	read_value(f, sample_peaks);
+	uint32_t true_peaks;
+	read_value(f, true_peaks);
+
+	for (uint32_t i = 0; i < sample_peaks; ++i) {
+		float peak;
+		read_value(f, peak);
+		int64_t time;
+		read_value(f, time);
+		_sample_peak.push_back(PeakTime(peak, DCPTime(time)));
+	}
+
+	_true_peak.resize(true_peaks);
+	for (auto& i: _true_peak) {
+		read_value(f, i);
+	}
+
+	vector<uint64_t> points(channels);
+	for (auto& i: points) {
+		read_value(f, i);
+	}
+
+	f.seek((f.tell() + 7) & ~7, SEEK_SET);
+
+	_data.resize(channels);
+	vector<float> buffer;
+	for (uint32_t i = 0; i < channels; ++i) {
+		buffer.resize(points[i] * AudioPoint::COUNT);
+		if (!buffer.empty()) {
+			f.checked_read(buffer.data(), buffer.size() * sizeof(float));
+		}
+		_data[i].resize(points[i]);
+		for (uint64_t j = 0; j < points[i]; ++j) {
+			for (int k = 0; k < AudioPoint::COUNT; ++k) {
+				_data[i][j][k] = buffer[j * AudioPoint::COUNT + k];
+			}
+		}
+	}
+}
+
+
+void
+AudioAnalysis::read_xml (boost::filesystem::path filename)
 {
 	cxml::Document f ("AudioAnalysis");
 	f.read_file(dcp::filesystem::fix_long_path(filename));
@@ -111,6 +275,7 @@ AudioAnalysis::add_point (int c, AudioPoint const & p)
 {
 	DCPOMATIC_ASSERT (c < channels ());
 	_data[c].push_back (p);
+	_levels.clear ();
 }
 
 
@@ -138,7 +303,169 @@ AudioAnalysis::points (int c) const
 
 
 void
-AudioAnalysis::write (boost::filesystem::path filename)
+AudioAnalysis::make_levels () const
+{
+	if (!_levels.empty() || _data.empty()) {
+		return;
+	}
+
+	auto const* previous = &_data;
+	while ((*previous)[0].size() > 1) {
+		vector<vector<AudioPoint>> level(previous->size());
+		for (size_t c = 0; c < previous->size(); ++c) {
+			auto const& from = (*previous)[c];
+			auto& to = level[c];
+			to.resize((from.size() + 1) / 2);
+			for (size_t i = 0; i < to.size(); ++i) {
+				auto a = from[i * 2];
+				/* If there's an odd number of points just copy the last one */
+				auto b = i * 2 + 1 < from.size() ? from[i * 2 + 1] : a;
+				to[i][AudioPoint::PEAK] = max(a[AudioPoint::PEAK], b[AudioPoint::PEAK]);
+				to[i][AudioPoint::RMS] = sqrt((pow(a[AudioPoint::RMS], 2) + pow(b[AudioPoint::RMS], 2)) / 2);
+			}
+		}
+		_levels.push_back (level);
+		previous = &_levels.back();
+	}
+}
+
+
+int
+AudioAnalysis::levels () const
+{
+	make_levels ();
+	return _levels.size() + 1;
+}
+
+
+int
+AudioAnalysis::points (int c, int level) const
+{
+	if (level == 0) {
+		return points (c);
+	}
+
+	make_levels ();
+	DCPOMATIC_ASSERT (level <= static_cast<int>(_levels.size()));
+	DCPOMATIC_ASSERT (c < channels());
+	return _levels[level - 1][c].size();
+}
+
+
+AudioPoint
+AudioAnalysis::get_point (int c, int p, int level) const
+{
+	if (level == 0) {
+		return get_point (c, p);
+	}
+
+	DCPOMATIC_ASSERT (p < points(c, level));
+	return _levels[level - 1][c][p];
+}
+
+
+int
+AudioAnalysis::level_for_samples_per_point (int64_t samples) const
+{
+	int level = 0;
+	while ((level + 1) < levels() && samples_per_point(level + 1) <= samples) {
+		++level;
+	}
+	return level;
+}
+
+
+void
+AudioAnalysis::write (boost::filesystem::path filename, Format format)
+{
+	switch (format) {
+	case Format::XML:
+		write_xml (filename);
+		break;
+	case Format::BINARY:
+		write_binary (filename);
+		break;
+	}
+}
+
+
+void
+AudioAnalysis::write_binary (boost::filesystem::path filename)
+{
+	auto tmp = filename;
+	tmp += ".tmp";
+
+	{
+		dcp::File f(tmp, "wb");
+		if (!f) {
+			throw OpenFileError(tmp, errno, OpenFileError::WRITE);
+		}
+
+		f.checked_write(binary_magic, sizeof(binary_magic));
+		write_value(f, static_cast<uint32_t>(_current_binary_version));
+		write_value(f, static_cast<uint32_t>(_data.size()));
+		write_value(f, static_cast<int64_t>(_samples_per_point));
+		write_value(f, static_cast<int32_t>(_sample_rate));
+
+		uint32_t flags = 0;
+		if (_integrated_loudness) {
+			flags |= HAVE_INTEGRATED_LOUDNESS;
+		}
+		if (_loudness_range) {
+			flags |= HAVE_LOUDNESS_RANGE;
+		}
+		if (_analysis_gain) {
+			flags |= HAVE_ANALYSIS_GAIN;
+		}
+		if (_leqm) {
+			flags |= HAVE_LEQM;
+		}
+		write_value(f, flags);
+		write_value(f, _integrated_loudness.get_value_or(0));
+		write_value(f, _loudness_range.get_value_or(0));
+		write_value(f, _analysis_gain.get_value_or(0));
+		write_value(f, _leqm.get_value_or(0));
+
+		write_value(f, static_cast<uint32_t>(_sample_peak.size()));
+		write_value(f, static_cast<uint32_t>(_true_peak.size()));
+		for (auto const& i: _sample_peak) {
+			write_value(f, i.peak);
+			write_value(f, static_cast<int64_t>(i.time.get()));
+		}
+		for (auto i: _true_peak) {
+			write_value(f, i);
+		}
+
+		for (auto const& i: _data) {
+			write_value(f, static_cast<uint64_t>(i.size()));
+		}
+
+		uint8_t const padding[8] = { 0 };
+		auto const position = f.tell();
+		if (position % 8) {
+			f.checked_write(padding, 8 - position % 8);
+		}
+
+		vector<float> buffer;
+		for (auto& i: _data) {
+			buffer.resize(i.size() * AudioPoint::COUNT);
+			for (size_t j = 0; j < i.size(); ++j) {
+				for (int k = 0; k < AudioPoint::COUNT; ++k) {
+					buffer[j * AudioPoint::COUNT + k] = i[j][k];
+				}
+			}
+			if (!buffer.empty()) {
+				f.checked_write(buffer.data(), buffer.size() * sizeof(float));
+			}
+		}
+	}
+
+	dcp::filesystem::rename(tmp, filename);
+}
+
+
+void
+AudioAnalysis::write_xml (boost::filesystem::path filename)
 {
 	auto doc = make_shared<xmlpp::Document>();
 	xmlpp::Element* root = doc->create_root_node ("AudioAnalysis");
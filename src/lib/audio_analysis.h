@@ -77,6 +77,23 @@ public:
 	int points (int c) const;
 	int channels () const;
 
+	/* Lower-resolution versions of the points: at level 0 are the points as they were
+	 * added, and each level after that has half as many, each one summarising two from
+	 * the level before.
+	 */
+
+	/** @return number of levels, including level 0 */
+	int levels () const;
+	AudioPoint get_point (int c, int p, int level) const;
+	int points (int c, int level) const;
+	int64_t samples_per_point (int level) const {
+		return _samples_per_point << level;
+	}
+	/** @return the lowest-resolution level which still has at least one point for every
+	 *  `samples' samples.
+	 */
+	int level_for_samples_per_point (int64_t samples) const;
+
 	std::vector<PeakTime> sample_peak () const {
 		return _sample_peak;
 	}
@@ -129,12 +146,30 @@ public:
 		return _leqm;
 	}
 
-	void write (boost::filesystem::path);
+	enum class Format {
+		/** The original XML format */
+		XML,
+		/** Header followed by arrays of floats; much smaller and quicker to load than XML */
+		BINARY
+	};
+
+	void write (boost::filesystem::path, Format format = Format::BINARY);
 
 	float gain_correction (std::shared_ptr<const Playlist> playlist);
 
 private:
+	void read_xml (boost::filesystem::path filename);
+	void read_binary (boost::filesystem::path filename);
+	void write_xml (boost::filesystem::path filename);
+	void write_binary (boost::filesystem::path filename);
+
+	void make_levels () const;
+
 	std::vector<std::vector<AudioPoint>> _data;
+	/** Levels 1 onwards of the points, indexed by level - 1 then channel; these are made
+	 *  from _data when they are first needed.
+	 */
+	mutable std::vector<std::vector<std::vector<AudioPoint>>> _levels;
 	std::vector<PeakTime> _sample_peak;
 	std::vector<float> _true_peak;
 	boost::optional<float> _integrated_loudness;
@@ -149,6 +184,7 @@ private:
 	int _sample_rate = 0;
 
 	static int const _current_state_version;
+	static int const _current_binary_version;
 };
 
 
@@ -23,13 +23,84 @@
 #include "dcpomatic_assert.h"
 #include "maths_util.h"
 #include "scope_guard.h"
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <iterator>
 #include <cmath>
 
 
 using std::shared_ptr;
 using std::make_shared;
+using std::vector;
+
+
+namespace {
+
+/** A pool of channel buffers which have been used by AudioBuffers that have since
+ *  been destroyed.  AudioBuffers are made and thrown away at a high rate in the
+ *  player, and they are mostly of similar sizes, so re-using the storage saves a lot
+ *  of trips to the heap.
+ */
+class ChannelPool
+{
+public:
+	/** Resize `data' to `channels' channels of `frames' frames, using buffers from the pool
+	 *  for any new channels.  New channels are silent.
+	 */
+	void get (vector<vector<float>>& data, int channels, int frames)
+	{
+		int const old_channels = data.size();
+		if (channels > old_channels) {
+			data.resize(channels);
+			boost::mutex::scoped_lock lm(_mutex);
+			for (int channel = old_channels; channel < channels; ++channel) {
+				/* Look for the most recently-returned buffer which is big enough */
+				auto i = std::find_if(_buffers.rbegin(), _buffers.rend(), [frames](vector<float> const& b) { return static_cast<int>(b.capacity()) >= frames; });
+				if (i != _buffers.rend()) {
+					_floats_held -= i->capacity();
+					data[channel].swap(*i);
+					_buffers.erase(std::next(i).base());
+				}
+			}
+		}
+	}
+
+	/** Take the storage of some channels of `data' for re-use */
+	void put (vector<vector<float>>& data, int from_channel)
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		for (size_t channel = from_channel; channel < data.size(); ++channel) {
+			auto& buffer = data[channel];
+			if (buffer.capacity() == 0 || _buffers.size() >= maximum_buffers || (_floats_held + buffer.capacity()) > maximum_floats) {
+				continue;
+			}
+			buffer.clear();
+			_floats_held += buffer.capacity();
+			_buffers.push_back({});
+			_buffers.back().swap(buffer);
+		}
+	}
+
+	static ChannelPool& instance ()
+	{
+		/* Never destroyed, as AudioBuffers may be destroyed during static destruction */
+		static auto pool = new ChannelPool();
+		return *pool;
+	}
+
+private:
+	static size_t constexpr maximum_buffers = 512;
+	/* 64MB */
+	static size_t constexpr maximum_floats = 16 * 1024 * 1024;
+
+	boost::mutex _mutex;
+	vector<vector<float>> _buffers;
+	size_t _floats_held = 0;
+};
+
+}
 
 
 /** Construct a silent AudioBuffers */
@@ -63,6 +134,46 @@ AudioBuffers::AudioBuffers (std::shared_ptr<const AudioBuffers> other, int frame
 }
 
 
+AudioBuffers::AudioBuffers (AudioBuffers&& other) noexcept
+	: _data (std::move(other._data))
+	, _data_pointers (std::move(other._data_pointers))
+{
+	other._data.clear();
+	other._data_pointers.clear();
+}
+
+
+AudioBuffers::~AudioBuffers ()
+{
+	release ();
+}
+
+
+/** Give our storage back to the pool */
+void
+AudioBuffers::release ()
+{
+	ChannelPool::instance().put(_data, 0);
+}
+
+
+AudioBuffers &
+AudioBuffers::operator= (AudioBuffers&& other) noexcept
+{
+	if (this == &other) {
+		return *this;
+	}
+
+	release ();
+	_data = std::move(other._data);
+	_data_pointers = std::move(other._data_pointers);
+	other._data.clear();
+	other._data_pointers.clear();
+
+	return *this;
+}
+
+
 AudioBuffers &
 AudioBuffers::operator= (AudioBuffers const & other)
 {
@@ -85,7 +196,13 @@ AudioBuffers::allocate (int channels, int frames)
 
 	ScopeGuard sg = [this]() { update_data_pointers(); };
 
-	_data.resize(channels);
+	if (channels < static_cast<int>(_data.size())) {
+		ChannelPool::instance().put(_data, channels);
+		_data.resize(channels);
+	} else {
+		ChannelPool::instance().get(_data, channels, frames);
+	}
+
 	for (int channel = 0; channel < channels; ++channel) {
 		_data[channel].resize(frames);
 	}
@@ -309,10 +426,25 @@ AudioBuffers::clone () const
 void
 AudioBuffers::append (shared_ptr<const AudioBuffers> other)
 {
-	DCPOMATIC_ASSERT (channels() == other->channels());
+	append (*other);
+}
+
+
+/** Extend these buffers with the data from another.  The AudioBuffers must have the same number of channels. */
+void
+AudioBuffers::append (AudioBuffers const& other)
+{
+	DCPOMATIC_ASSERT (channels() == other.channels());
 	auto old_frames = frames();
-	set_frames(old_frames + other->frames());
-	copy_from (other.get(), other->frames(), 0, old_frames);
+	auto const new_frames = old_frames + other.frames();
+	/* Grow geometrically so that repeated appends (e.g. in AudioMerger) don't re-allocate each time */
+	for (auto& channel: _data) {
+		if (static_cast<int>(channel.capacity()) < new_frames) {
+			channel.reserve(std::max(new_frames, static_cast<int>(channel.capacity() * 2)));
+		}
+	}
+	set_frames(new_frames);
+	copy_from (&other, other.frames(), 0, old_frames);
 }
 
 
@@ -347,10 +479,16 @@ AudioBuffers::set_channels(int new_channels)
 	ScopeGuard sg = [this]() { update_data_pointers(); };
 
 	int const old_channels = channels();
-	_data.resize(new_channels);
+	int const old_frames = frames();
+	if (new_channels < old_channels) {
+		ChannelPool::instance().put(_data, new_channels);
+		_data.resize(new_channels);
+	} else {
+		ChannelPool::instance().get(_data, new_channels, old_frames);
+	}
 
 	for (int channel = old_channels; channel < new_channels; ++channel) {
-		_data[channel].resize(frames());
+		_data[channel].resize(old_frames);
 	}
 }
 
@@ -40,10 +40,14 @@ class AudioBuffers
 public:
 	AudioBuffers (int channels, int frames);
 	AudioBuffers (AudioBuffers const &);
+	AudioBuffers (AudioBuffers &&) noexcept;
 	explicit AudioBuffers (std::shared_ptr<const AudioBuffers>);
 	AudioBuffers (std::shared_ptr<const AudioBuffers> other, int frames_to_copy, int read_offset);
 
+	~AudioBuffers ();
+
 	AudioBuffers & operator= (AudioBuffers const &);
+	AudioBuffers & operator= (AudioBuffers &&) noexcept;
 
 	std::shared_ptr<AudioBuffers> clone () const;
 	std::shared_ptr<AudioBuffers> channel (int) const;
@@ -79,10 +83,12 @@ public:
 	void accumulate_channel (AudioBuffers const * from, int from_channel, int to_channel, float gain = 1);
 	void accumulate_frames (AudioBuffers const * from, int frames, int read_offset, int write_offset);
 	void append (std::shared_ptr<const AudioBuffers> other);
+	void append (AudioBuffers const& other);
 	void trim_start (int frames);
 
 private:
 	void allocate (int channels, int frames);
+	void release ();
 	void update_data_pointers ();
 
 	/** Audio data (so that, e.g. _data[2][6] is channel 2, sample 6) */
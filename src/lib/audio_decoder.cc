@@ -22,6 +22,7 @@
 #include "audio_decoder.h"
 #include "audio_buffers.h"
 #include "audio_content.h"
+#include "config.h"
 #include "dcpomatic_log.h"
 #include "log.h"
 #include "resampler.h"
@@ -111,10 +112,13 @@ AudioDecoder::emit(shared_ptr<const Film> film, AudioStreamPtr stream, shared_pt
 				stream->channels()
 				);
 
-			resampler = make_shared<Resampler>(stream->frame_rate(), resampled_rate, stream->channels());
-			if (_fast) {
-				resampler->set_fast ();
-			}
+			auto config = Config::instance();
+			resampler = make_shared<Resampler>(
+				stream->frame_rate(),
+				resampled_rate,
+				stream->channels(),
+				_fast ? config->preview_resampler_quality() : config->resampler_quality()
+				);
 			_resamplers[stream] = resampler;
 		}
 	}
@@ -23,12 +23,22 @@
 #include "audio_buffers.h"
 #include "maths_util.h"
 #include "util.h"
+#include <algorithm>
 #include <cmath>
 
 
+using std::complex;
 using std::make_shared;
 using std::min;
 using std::shared_ptr;
+using std::vector;
+
+
+/** Kernels with at least this many taps are applied using FFTs; shorter ones directly */
+static int constexpr fft_minimum_taps = 256;
+
+/** Number of output samples that run_direct() works on at a time, so that they stay in the cache */
+static int constexpr direct_block = 1024;
 
 
 std::vector<float>
@@ -74,6 +84,156 @@ AudioFilter::sinc_blackman (float cutoff, bool invert) const
 }
 
 
+/** Apply the kernel by direct convolution.
+ *  @param history_and_input _M samples of history followed by frames samples of input.
+ */
+void
+AudioFilter::run_direct (float const* history_and_input, float* out, int frames) const
+{
+	/* Going through the kernel in the outer loop means that the inner loop has no branches
+	 * and can be vectorised across output samples, while each output still sums its terms
+	 * in the same order (so the result is the same as the obvious way).
+	 */
+	for (int block = 0; block < frames; block += direct_block) {
+		int const this_block = min(direct_block, frames - block);
+		auto block_out = out + block;
+		std::fill(block_out, block_out + this_block, 0.0f);
+		for (int k = 0; k <= _M; ++k) {
+			float const tap = _ir[k];
+			auto in = history_and_input + block + _M - k;
+			for (int j = 0; j < this_block; ++j) {
+				block_out[j] += tap * in[j];
+			}
+		}
+	}
+}
+
+
+static inline complex<float>
+multiply (complex<float> a, complex<float> b)
+{
+	/* Written out to avoid the checks for infinities that std::complex's operator* makes */
+	return { a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real() };
+}
+
+
+/** In-place radix-2 FFT of size _fft_size */
+void
+AudioFilter::transform (vector<complex<float>>& data, bool inverse) const
+{
+	int const n = _fft_size;
+
+	for (int i = 0; i < n; ++i) {
+		if (i < _fft_bit_reverse[i]) {
+			std::swap(data[i], data[_fft_bit_reverse[i]]);
+		}
+	}
+
+	for (int length = 2; length <= n; length *= 2) {
+		int const half = length / 2;
+		int const step = n / length;
+		for (int i = 0; i < n; i += length) {
+			for (int j = 0; j < half; ++j) {
+				auto twiddle = _fft_twiddles[j * step];
+				if (inverse) {
+					twiddle = std::conj(twiddle);
+				}
+				auto const u = data[i + j];
+				auto const v = multiply(data[i + j + half], twiddle);
+				data[i + j] = u + v;
+				data[i + j + half] = u - v;
+			}
+		}
+	}
+}
+
+
+void
+AudioFilter::prepare_fft ()
+{
+	/* Big enough that most of each FFT gives useful output */
+	_fft_size = 1;
+	while (_fft_size < (_M + 1) * 4) {
+		_fft_size *= 2;
+	}
+
+	int bits = 0;
+	while ((1 << bits) < _fft_size) {
+		++bits;
+	}
+
+	_fft_bit_reverse.resize(_fft_size);
+	for (int i = 0; i < _fft_size; ++i) {
+		int r = 0;
+		for (int b = 0; b < bits; ++b) {
+			if (i & (1 << b)) {
+				r |= 1 << (bits - 1 - b);
+			}
+		}
+		_fft_bit_reverse[i] = r;
+	}
+
+	_fft_twiddles.resize(_fft_size / 2);
+	for (int i = 0; i < _fft_size / 2; ++i) {
+		double const angle = -2 * M_PI * i / _fft_size;
+		_fft_twiddles[i] = complex<float>(cos(angle), sin(angle));
+	}
+
+	_ir_fft.assign(_fft_size, complex<float>());
+	for (int i = 0; i <= _M; ++i) {
+		_ir_fft[i] = complex<float>(_ir[i] / _fft_size, 0);
+	}
+	transform (_ir_fft, false);
+
+	_fft_buffer.resize(_fft_size);
+}
+
+
+/** Apply the kernel to two channels at once by overlap-save FFT convolution.  One channel goes
+ *  in the real part of the FFT and the other in the imaginary part; as the kernel is real,
+ *  their results come back in the real and imaginary parts of the output.
+ *  @param history_and_input_a _M samples of history followed by frames samples of input for the first channel.
+ *  @param history_and_input_b Similarly for the second channel, or nullptr.
+ */
+void
+AudioFilter::run_fft (float const* history_and_input_a, float const* history_and_input_b, float* out_a, float* out_b, int frames)
+{
+	if (_fft_size == 0) {
+		prepare_fft ();
+	}
+
+	int const available = _M + frames;
+	/* Number of output samples that each FFT gives us */
+	int const hop = _fft_size - _M;
+
+	for (int start = 0; start < frames; start += hop) {
+		for (int i = 0; i < _fft_size; ++i) {
+			auto const n = start + i;
+			if (n < available) {
+				_fft_buffer[i] = complex<float>(history_and_input_a[n], history_and_input_b ? history_and_input_b[n] : 0);
+			} else {
+				_fft_buffer[i] = complex<float>();
+			}
+		}
+
+		transform (_fft_buffer, false);
+		for (int i = 0; i < _fft_size; ++i) {
+			_fft_buffer[i] = multiply(_fft_buffer[i], _ir_fft[i]);
+		}
+		transform (_fft_buffer, true);
+
+		/* The first _M outputs are wrapped around, and not useful */
+		int const this_hop = min(hop, frames - start);
+		for (int i = 0; i < this_hop; ++i) {
+			out_a[start + i] = _fft_buffer[_M + i].real();
+			if (out_b) {
+				out_b[start + i] = _fft_buffer[_M + i].imag();
+			}
+		}
+	}
+}
+
+
 shared_ptr<AudioBuffers>
 AudioFilter::run (shared_ptr<const AudioBuffers> in)
 {
@@ -87,21 +247,27 @@ AudioFilter::run (shared_ptr<const AudioBuffers> in)
 	int const channels = in->channels ();
 	int const frames = in->frames ();
 
-	for (int i = 0; i < channels; ++i) {
-		auto tail_p = _tail->data (i);
-		auto in_p = in->data (i);
-		auto out_p = out->data (i);
-		for (int j = 0; j < frames; ++j) {
-			float s = 0;
-			for (int k = 0; k <= _M; ++k) {
-				if ((j - k) < 0) {
-					s += tail_p[j - k + _M + 1] * _ir[k];
-				} else {
-					s += in_p[j - k] * _ir[k];
-				}
+	/* Each channel's history (the last _M samples from the tail) followed by its input */
+	auto history_and_input = [this, &in, frames](int channel) -> vector<float> {
+		vector<float> all(_M + frames);
+		std::copy(_tail->data(channel) + 1, _tail->data(channel) + _M + 1, all.begin());
+		std::copy(in->data(channel), in->data(channel) + frames, all.begin() + _M);
+		return all;
+	};
+
+	if (static_cast<int>(_ir.size()) >= fft_minimum_taps) {
+		for (int i = 0; i < channels; i += 2) {
+			auto a = history_and_input(i);
+			if (i + 1 < channels) {
+				auto b = history_and_input(i + 1);
+				run_fft (a.data(), b.data(), out->data(i), out->data(i + 1), frames);
+			} else {
+				run_fft (a.data(), nullptr, out->data(i), nullptr, frames);
 			}
-
-			out_p[j] = s;
+		}
+	} else {
+		for (int i = 0; i < channels; ++i) {
+			run_direct (history_and_input(i).data(), out->data(i), frames);
 		}
 	}
 
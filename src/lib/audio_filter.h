@@ -22,12 +22,14 @@
 #define DCPOMATIC_AUDIO_FILTER_H
 
 
+#include <complex>
 #include <memory>
 #include <vector>
 
 
 class AudioBuffers;
 struct audio_filter_impulse_input_test;
+struct audio_filter_fft_test;
 
 
 /** An audio filter which can take AudioBuffers and apply some filtering operation,
@@ -53,12 +55,28 @@ public:
 protected:
 	friend struct audio_filter_impulse_kernel_test;
 	friend struct audio_filter_impulse_input_test;
+	friend struct ::audio_filter_fft_test;
 
 	std::vector<float> sinc_blackman (float cutoff, bool invert) const;
 
 	std::vector<float> _ir;
 	int _M;
 	std::shared_ptr<AudioBuffers> _tail;
+
+private:
+	void run_direct (float const* history_and_input, float* out, int frames) const;
+	void run_fft (float const* history_and_input_a, float const* history_and_input_b, float* out_a, float* out_b, int frames);
+	void prepare_fft ();
+	void transform (std::vector<std::complex<float>>& data, bool inverse) const;
+
+	/** Size of the FFTs that we use for long kernels, or 0 if they have not been set up yet */
+	int _fft_size = 0;
+	/** FFT of _ir, scaled to undo the gain of a forward and inverse FFT */
+	std::vector<std::complex<float>> _ir_fft;
+	std::vector<std::complex<float>> _fft_twiddles;
+	std::vector<int> _fft_bit_reverse;
+	/** Work space for run_fft() */
+	std::vector<std::complex<float>> _fft_buffer;
 };
 
 
@@ -19,6 +19,7 @@
 */
 
 
+#include "audio_buffers.h"
 #include "audio_mapping.h"
 #include "audio_processor.h"
 #include "constants.h"
@@ -31,11 +32,13 @@ LIBDCP_DISABLE_WARNINGS
 #include <libxml++/libxml++.h>
 LIBDCP_ENABLE_WARNINGS
 #include <boost/regex.hpp>
+#include <algorithm>
 #include <iostream>
 
 
 using std::list;
 using std::cout;
+using std::fill;
 using std::make_pair;
 using std::pair;
 using std::string;
@@ -44,6 +47,7 @@ using std::vector;
 using std::abs;
 using std::shared_ptr;
 using std::dynamic_pointer_cast;
+using std::make_shared;
 using boost::optional;
 using dcp::raw_convert;
 
@@ -303,3 +307,62 @@ AudioMapping::take_from(AudioMapping const& other)
 	}
 }
 
+
+
+/** @param mapping Mapping to compile.
+ *  @param output_channels Number of output channels that run() should produce; any outputs
+ *  which are not in the mapping will be silent.
+ */
+SparseAudioMapping::SparseAudioMapping (AudioMapping const& mapping, int output_channels)
+	: _outputs (output_channels)
+{
+	for (int i = 0; i < mapping.input_channels(); ++i) {
+		for (int o = 0; o < min(output_channels, mapping.output_channels()); ++o) {
+			auto const gain = mapping.get(i, o);
+			if (gain > 0) {
+				_outputs[o].push_back(Input(i, gain));
+			}
+		}
+	}
+}
+
+
+/** @return A new buffer containing input mapped to our output channels */
+shared_ptr<AudioBuffers>
+SparseAudioMapping::run (shared_ptr<const AudioBuffers> input) const
+{
+	auto const frames = input->frames();
+	auto mapped = make_shared<AudioBuffers>(output_channels(), frames);
+
+	for (int o = 0; o < output_channels(); ++o) {
+		auto out = mapped->data(o);
+		bool first = true;
+		/* Write the first input straight into the output, then accumulate the rest,
+		 * so that each output channel is touched once per input and never needs
+		 * to be cleared first (unless nothing is mapped to it).
+		 */
+		for (auto const& i: _outputs[o]) {
+			if (i.channel >= input->channels()) {
+				continue;
+			}
+			auto in = input->data(i.channel);
+			auto const gain = i.gain;
+			if (first) {
+				for (int f = 0; f < frames; ++f) {
+					out[f] = in[f] * gain;
+				}
+				first = false;
+			} else {
+				for (int f = 0; f < frames; ++f) {
+					out[f] += in[f] * gain;
+				}
+			}
+		}
+
+		if (first) {
+			fill(out, out + frames, 0.0f);
+		}
+	}
+
+	return mapped;
+}
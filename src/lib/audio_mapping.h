@@ -30,6 +30,7 @@
 
 #include <dcp/types.h>
 #include <libcxml/cxml.h>
+#include <memory>
 #include <vector>
 
 
@@ -37,6 +38,7 @@ namespace xmlpp {
 	class Node;
 }
 
+class AudioBuffers;
 class AudioProcessor;
 
 
@@ -86,4 +88,36 @@ private:
 };
 
 
+/** @class SparseAudioMapping
+ *  @brief An AudioMapping compiled into a list of the inputs which feed each output channel,
+ *  so that it can be applied to blocks of audio without looking at the unmapped pairs.
+ */
+class SparseAudioMapping
+{
+public:
+	SparseAudioMapping (AudioMapping const& mapping, int output_channels);
+
+	std::shared_ptr<AudioBuffers> run (std::shared_ptr<const AudioBuffers> input) const;
+
+	int output_channels () const {
+		return _outputs.size();
+	}
+
+private:
+	struct Input
+	{
+		Input (int channel_, float gain_)
+			: channel(channel_)
+			, gain(gain_)
+		{}
+
+		int channel;
+		float gain;
+	};
+
+	/** Inputs (with gains) for each output channel */
+	std::vector<std::vector<Input>> _outputs;
+};
+
+
 #endif
@@ -25,6 +25,7 @@
 
 #include "audio_merger.h"
 #include "dcpomatic_time.h"
+#include <algorithm>
 #include <iostream>
 
 
@@ -41,7 +42,8 @@ using namespace dcpomatic;
 
 
 AudioMerger::AudioMerger (int frame_rate)
-	: _frame_rate (frame_rate)
+	: _audio (0, 0)
+	, _frame_rate (frame_rate)
 {
 
 }
@@ -54,6 +56,50 @@ AudioMerger::frames (DCPTime t) const
 }
 
 
+/** @return Number of frames of _audio that might contain something other than silence */
+Frame
+AudioMerger::used () const
+{
+	return _ranges.empty() ? 0 : _ranges.back().second - _start;
+}
+
+
+/** Make sure _audio has at least the given number of channels and frames */
+void
+AudioMerger::reserve (int channels, Frame frames)
+{
+	if (_audio.channels() != channels) {
+		/* Everything is silent, so it doesn't matter what happens to the existing data */
+		DCPOMATIC_ASSERT (_ranges.empty());
+		_audio.set_channels (channels);
+	}
+
+	if (_audio.frames() < frames) {
+		_audio.set_frames (max(frames, static_cast<Frame>(_audio.frames()) * 2));
+	}
+}
+
+
+void
+AudioMerger::add_range (Frame from, Frame to)
+{
+	auto i = std::lower_bound(_ranges.begin(), _ranges.end(), from, [](pair<Frame, Frame> const& range, Frame f) {
+		return range.second < f;
+	});
+
+	/* i is now the first range that overlaps or touches [from, to), or the one after it */
+	auto j = i;
+	while (j != _ranges.end() && j->first <= to) {
+		from = min(from, j->first);
+		to = max(to, j->second);
+		++j;
+	}
+
+	i = _ranges.erase (i, j);
+	_ranges.insert (i, make_pair(from, to));
+}
+
+
 /** Pull audio up to a given time; after this call, no more data can be pushed
  *  before the specified time.
  *  @param time Time to pull up to.
@@ -64,38 +110,39 @@ AudioMerger::pull (DCPTime time)
 {
 	list<pair<shared_ptr<AudioBuffers>, DCPTime>> out;
 
-	list<Buffer> new_buffers;
+	auto const end = frames(time);
+	auto const old_used = used();
+
+	auto i = _ranges.begin();
+	while (i != _ranges.end() && i->first < end) {
+		auto const to = min(i->second, end);
+		auto audio = make_shared<AudioBuffers>(_audio.channels(), to - i->first);
+		audio->copy_from (&_audio, to - i->first, i->first - _start, 0);
+		out.push_back (make_pair(audio, DCPTime::from_frames(i->first, _frame_rate)));
+		if (to < i->second) {
+			/* Overlaps the end of the pull period; keep the rest */
+			i->first = to;
+			break;
+		}
+		++i;
+	}
 
-	_buffers.sort ([](Buffer const& a, Buffer const& b) {
-		return a.time < b.time;
-	});
+	_ranges.erase (_ranges.begin(), i);
 
-	for (auto i: _buffers) {
-		if (i.period().to <= time) {
-			/* Completely within the pull period */
-			DCPOMATIC_ASSERT (i.audio->frames() > 0);
-			out.push_back (make_pair (i.audio, i.time));
-		} else if (i.time < time) {
-			/* Overlaps the end of the pull period */
-			int32_t const overlap = frames(DCPTime(time - i.time));
-			/* Though time > i.time, overlap could be 0 if the difference in time is less than one frame */
-			if (overlap > 0) {
-				auto audio = make_shared<AudioBuffers>(i.audio, overlap, 0);
-				out.push_back (make_pair(audio, i.time));
-				i.audio->trim_start (overlap);
-				i.time += DCPTime::from_frames(overlap, _frame_rate);
-				DCPOMATIC_ASSERT (i.audio->frames() > 0);
-				new_buffers.push_back (i);
-			}
-		} else {
-			/* Not involved */
-			DCPOMATIC_ASSERT (i.audio->frames() > 0);
-			new_buffers.push_back (i);
+	/* Discard everything before the first frame that we still need, keeping the rest silent */
+	if (_ranges.empty()) {
+		if (old_used > 0) {
+			_audio.make_silent (0, old_used);
+		}
+	} else {
+		auto const discard = _ranges.front().first - _start;
+		if (discard > 0) {
+			_audio.move (old_used - discard, discard, 0);
+			_audio.make_silent (old_used - discard, discard);
+			_start += discard;
 		}
 	}
 
-	_buffers = new_buffers;
-
 	for (auto const& i: out) {
 		DCPOMATIC_ASSERT (i.first->frames() > 0);
 	}
@@ -110,68 +157,34 @@ AudioMerger::push (std::shared_ptr<const AudioBuffers> audio, DCPTime time)
 {
 	DCPOMATIC_ASSERT (audio->frames() > 0);
 
-	DCPTimePeriod period (time, time + DCPTime::from_frames (audio->frames(), _frame_rate));
-
-	/* Mix any overlapping parts of this new block with existing ones */
-	for (auto i: _buffers) {
-		auto overlap = i.period().overlap(period);
-		if (overlap) {
-			int32_t const offset = frames(DCPTime(overlap->from - i.time));
-			int32_t const frames_to_mix = frames(overlap->duration());
-			if (i.time < time) {
-				i.audio->accumulate_frames(audio.get(), frames_to_mix, 0, offset);
-			} else {
-				i.audio->accumulate_frames(audio.get(), frames_to_mix, offset, 0);
-			}
-		}
-	}
-
-	list<DCPTimePeriod> periods;
-	for (auto i: _buffers) {
-		periods.push_back (i.period());
+	auto const from = frames(time);
+	auto const to = from + audio->frames();
+
+	if (_ranges.empty()) {
+		_start = from;
+	} else if (from < _start) {
+		/* Make space for this new audio before what we already have */
+		auto const shift = _start - from;
+		auto const old_used = used();
+		reserve (audio->channels(), old_used + shift);
+		_audio.move (old_used, 0, shift);
+		_audio.make_silent (0, min(shift, old_used));
+		_start = from;
 	}
 
-	/* Add the non-overlapping parts */
-	for (auto i: subtract(period, periods)) {
-		auto before = _buffers.end();
-		auto after = _buffers.end();
-		for (auto j = _buffers.begin(); j != _buffers.end(); ++j) {
-			if (j->period().to == i.from) {
-				before = j;
-			}
-			if (j->period().from == i.to) {
-				after = j;
-			}
-		}
+	reserve (audio->channels(), to - _start);
 
-		/* Get the part of audio that we want to use */
-		auto part = make_shared<AudioBuffers>(audio, frames(i.to) - frames(i.from), frames(DCPTime(i.from - time)));
-
-		if (before == _buffers.end() && after == _buffers.end()) {
-			if (part->frames() > 0) {
-				/* New buffer */
-				_buffers.push_back (Buffer (part, time, _frame_rate));
-			}
-		} else if (before != _buffers.end() && after == _buffers.end()) {
-			/* We have an existing buffer before this one; append new data to it */
-			before->audio->append (part);
-		} else if (before ==_buffers.end() && after != _buffers.end()) {
-			/* We have an existing buffer after this one; append it to the new data and replace */
-			part->append (after->audio);
-			after->audio = part;
-			after->time = time;
-		} else {
-			/* We have existing buffers both before and after; coalesce them all */
-			before->audio->append (part);
-			before->audio->append (after->audio);
-			_buffers.erase (after);
-		}
-	}
+	/* Any part of _audio which has not yet been pushed is silent, so we can mix everything in */
+	_audio.accumulate_frames (audio.get(), audio->frames(), 0, from - _start);
+	add_range (from, to);
 }
 
 
 void
 AudioMerger::clear ()
 {
-	_buffers.clear ();
+	if (used() > 0) {
+		_audio.make_silent (0, used());
+	}
+	_ranges.clear ();
 }
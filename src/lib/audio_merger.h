@@ -42,36 +42,20 @@ public:
 
 private:
 	Frame frames (dcpomatic::DCPTime t) const;
-
-	class Buffer
-	{
-	public:
-		/** @param c Channels
-		 *  @param f Frames
-		 *  @param t Time
-		 *  @param r Frame rate.
-		 */
-		Buffer (int c, int32_t f, dcpomatic::DCPTime t, int r)
-			: audio (std::make_shared<AudioBuffers>(c, f))
-			, time (t)
-			, frame_rate (r)
-		{}
-
-		Buffer (std::shared_ptr<AudioBuffers> a, dcpomatic::DCPTime t, int r)
-			: audio (a)
-			, time (t)
-			, frame_rate (r)
-		{}
-
-		std::shared_ptr<AudioBuffers> audio;
-		dcpomatic::DCPTime time;
-		int frame_rate;
-
-		dcpomatic::DCPTimePeriod period () const {
-			return dcpomatic::DCPTimePeriod (time, time + dcpomatic::DCPTime::from_frames (audio->frames(), frame_rate));
-		}
-	};
-
-	std::list<Buffer> _buffers;
+	Frame used () const;
+	void reserve (int channels, Frame frames);
+	void add_range (Frame from, Frame to);
+
+	/** Mixed audio, with frame i being output frame _start + i.  Any frame which is not in one of
+	 *  _ranges is silent, so new audio can always be mixed straight into place.  This is never
+	 *  shrunk, so once it has grown to cover the usual overlap of pushes and pulls it needs no
+	 *  more allocation.
+	 */
+	AudioBuffers _audio;
+	Frame _start = 0;
+	/** Ranges of output frames [from, to) that have been pushed and not yet pulled; these are
+	 *  sorted and never overlap or touch.
+	 */
+	std::vector<std::pair<Frame, Frame>> _ranges;
 	int _frame_rate;
 };
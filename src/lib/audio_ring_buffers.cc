@@ -22,20 +22,30 @@
 #include "audio_ring_buffers.h"
 #include "dcpomatic_assert.h"
 #include "exceptions.h"
+#include <cstring>
 #include <iostream>
 
 
+using std::max;
 using std::min;
 using std::cout;
 using std::make_pair;
 using std::pair;
-using std::list;
 using std::shared_ptr;
 using boost::optional;
 using namespace dcpomatic;
 
 
-AudioRingBuffers::AudioRingBuffers ()
+AudioRingBuffers::AudioRingBuffers (int capacity)
+	: _slots (capacity)
+	, _write (0)
+	, _read (0)
+	, _put_frames (0)
+	, _got_frames (0)
+	, _cleared_frames (0)
+	, _channels (0)
+	, _state (IDLE)
+	, _pending_clear (0)
 {
 
 }
@@ -45,95 +55,216 @@ AudioRingBuffers::AudioRingBuffers ()
 void
 AudioRingBuffers::put (shared_ptr<const AudioBuffers> data, DCPTime time, int frame_rate)
 {
-	boost::mutex::scoped_lock lm (_mutex);
-
-	if (!_buffers.empty()) {
-		DCPOMATIC_ASSERT (_buffers.front().first->channels() == data->channels());
-		DCPTime const end = (_buffers.back().second + DCPTime::from_frames(_buffers.back().first->frames(), frame_rate));
+	if (_last_time) {
+		DCPOMATIC_ASSERT (_channels == data->channels());
+		DCPTime const end = (*_last_time + DCPTime::from_frames(_last_frames, frame_rate));
 		if (labs(end.get() - time.get()) > 1) {
-			cout << "bad put " << to_string(_buffers.back().second) << " " << _buffers.back().first->frames() << " " << to_string(time) << "\n";
+			cout << "bad put " << to_string(*_last_time) << " " << _last_frames << " " << to_string(time) << "\n";
 		}
 		DCPOMATIC_ASSERT (labs(end.get() - time.get()) < 2);
 	}
 
-	_buffers.push_back(make_pair(data, time));
+	/* Drop our references to any buffers that have been read, so that they are not freed in get() */
+	auto const read = _read.load(boost::memory_order_acquire);
+	for (; _release < read; ++_release) {
+		_slots[_release % _slots.size()].buffers.reset();
+	}
+
+	auto const write = _write.load(boost::memory_order_relaxed);
+	/* The Butler should never let us get anywhere near this */
+	DCPOMATIC_ASSERT (write - read < _slots.size());
+
+	auto const end = _put_frames.load() + data->frames();
+
+	auto& slot = _slots[write % _slots.size()];
+	slot.buffers = data;
+	slot.time.store(time.get(), boost::memory_order_relaxed);
+	slot.end = end;
+
+	_channels = data->channels();
+	_put_frames.store(end);
+	_write.store(write + 1, boost::memory_order_release);
+
+	_last_time = time;
+	_last_frames = data->frames();
 }
 
 
-/** @return time of the returned data; if it's not set this indicates an underrun */
+/** Get some interleaved data.
+ *  @return time of the returned data; if it's not set this indicates an underrun.
+ */
 optional<DCPTime>
 AudioRingBuffers::get (float* out, int channels, int frames)
 {
-	boost::mutex::scoped_lock lm (_mutex);
-
-	optional<DCPTime> time;
-
-	while (frames > 0) {
-		if (_buffers.empty ()) {
-			for (int i = 0; i < frames; ++i) {
+	return get_common (
+		frames,
+		[&out, channels](float* const* in, int in_channels, int in_offset, int n) {
+			int const c = min (in_channels, channels);
+			for (int i = 0; i < n; ++i) {
+				for (int j = 0; j < c; ++j) {
+					*out++ = in[j][i + in_offset];
+				}
+				for (int j = c; j < channels; ++j) {
+					*out++ = 0;
+				}
+			}
+		},
+		[&out, channels](int n) {
+			for (int i = 0; i < n; ++i) {
 				for (int j = 0; j < channels; ++j) {
 					*out++ = 0;
 				}
 			}
-			return time;
-		}
+		});
+}
 
-		auto front = _buffers.front ();
-		if (!time) {
-			time = front.second + DCPTime::from_frames(_used_in_head, 48000);
-		}
 
-		int const to_do = min (frames, front.first->frames() - _used_in_head);
-		float* const* p = front.first->data();
-		int const c = min (front.first->channels(), channels);
-		for (int i = 0; i < to_do; ++i) {
+/** Get some data without interleaving it, filling the whole of out.
+ *  @return time of the returned data; if it's not set this indicates an underrun.
+ */
+optional<DCPTime>
+AudioRingBuffers::get (AudioBuffers& out)
+{
+	int done = 0;
+	auto const channels = out.channels();
+	auto data = out.data();
+
+	return get_common (
+		out.frames(),
+		[&done, channels, data](float* const* in, int in_channels, int in_offset, int n) {
+			int const c = min (in_channels, channels);
 			for (int j = 0; j < c; ++j) {
-				*out++ = p[j][i + _used_in_head];
+				memcpy (data[j] + done, in[j] + in_offset, n * sizeof(float));
 			}
 			for (int j = c; j < channels; ++j) {
-				*out++ = 0;
+				memset (data[j] + done, 0, n * sizeof(float));
+			}
+			done += n;
+		},
+		[&done, channels, data](int n) {
+			for (int j = 0; j < channels; ++j) {
+				memset (data[j] + done, 0, n * sizeof(float));
 			}
+			done += n;
+		});
+}
+
+
+/** @param copy Function to copy some frames from a slot's buffers; it is called with the slot's data,
+ *  its channel count, the offset into the slot's data and the number of frames to copy.
+ *  @param silence Function to write some frames of silence.
+ */
+template <class Copy, class Silence>
+optional<DCPTime>
+AudioRingBuffers::get_common (int frames, Copy copy, Silence silence)
+{
+	int expected = IDLE;
+	if (!_state.compare_exchange_strong(expected, READING, boost::memory_order_acquire)) {
+		/* A clear() is happening; rather than waiting for it, behave as if it had finished */
+		silence (frames);
+		return {};
+	}
+
+	apply_pending_clear ();
+
+	optional<DCPTime> time;
+	auto read = _read.load(boost::memory_order_relaxed);
+
+	while (frames > 0) {
+		if (read == _write.load(boost::memory_order_acquire)) {
+			silence (frames);
+			break;
+		}
+
+		auto const& slot = _slots[read % _slots.size()];
+		if (!time) {
+			time = DCPTime(slot.time.load(boost::memory_order_relaxed)) + DCPTime::from_frames(_used_in_head, 48000);
 		}
+
+		int const to_do = min (frames, slot.buffers->frames() - _used_in_head);
+		copy (slot.buffers->data(), slot.buffers->channels(), _used_in_head, to_do);
 		_used_in_head += to_do;
 		frames -= to_do;
+		_got_frames += to_do;
 
-		if (_used_in_head == front.first->frames()) {
-			_buffers.pop_front ();
+		if (_used_in_head == slot.buffers->frames()) {
+			++read;
 			_used_in_head = 0;
+			_read.store(read, boost::memory_order_release);
 		}
 	}
 
+	apply_pending_clear ();
+	_state.store(IDLE, boost::memory_order_release);
+
 	return time;
 }
 
 
+/** Skip _read forward to `to', if it is not already there.  Must only be called by whichever
+ *  of get() or clear() has set _state.
+ */
+void
+AudioRingBuffers::skip_to (uint64_t to)
+{
+	if (to > _read.load(boost::memory_order_relaxed)) {
+		_got_frames = _slots[(to - 1) % _slots.size()].end;
+		_used_in_head = 0;
+		_read.store(to, boost::memory_order_release);
+	}
+}
+
+
+void
+AudioRingBuffers::apply_pending_clear ()
+{
+	auto const to = _pending_clear.exchange(0);
+	if (to) {
+		skip_to (to);
+	}
+}
+
+
 optional<DCPTime>
 AudioRingBuffers::peek () const
 {
-	boost::mutex::scoped_lock lm (_mutex);
-	if (_buffers.empty()) {
+	auto const front = max(_read.load(boost::memory_order_acquire), _pending_clear.load());
+	if (front >= _write.load(boost::memory_order_relaxed)) {
 		return {};
 	}
-	return _buffers.front().second;
+	return DCPTime(_slots[front % _slots.size()].time.load(boost::memory_order_relaxed));
 }
 
 
 void
 AudioRingBuffers::clear ()
 {
-	boost::mutex::scoped_lock lm (_mutex);
-	_buffers.clear ();
-	_used_in_head = 0;
+	_last_time = boost::none;
+
+	auto const write = _write.load(boost::memory_order_relaxed);
+	_cleared_frames = _put_frames.load();
+
+	int expected = IDLE;
+	if (_state.compare_exchange_strong(expected, CLEARING, boost::memory_order_acquire)) {
+		_pending_clear = 0;
+		skip_to (write);
+		_state.store(IDLE, boost::memory_order_release);
+	} else {
+		/* get() is running, so leave it to skip the cleared data when it has finished */
+		_pending_clear = write;
+	}
 }
 
 
 Frame
 AudioRingBuffers::size () const
 {
-	boost::mutex::scoped_lock lm (_mutex);
-	Frame s = 0;
-	for (auto const& i: _buffers) {
-		s += i.first->frames();
-	}
-	return s - _used_in_head;
+	return max(Frame(0), _put_frames.load() - max(_got_frames.load(), _cleared_frames.load()));
+}
+
+
+size_t
+AudioRingBuffers::memory_used () const
+{
+	return static_cast<size_t>(size()) * _channels.load() * sizeof(float);
 }
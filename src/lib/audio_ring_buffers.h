@@ -26,30 +26,82 @@
 #include "audio_buffers.h"
 #include "dcpomatic_time.h"
 #include "types.h"
-#include <boost/thread.hpp>
-#include <list>
-
-
+#include <boost/atomic.hpp>
+#include <vector>
+
+
+/** @class AudioRingBuffers
+ *  @brief A fixed-size queue of audio which can be written by one thread
+ *  and read by another without either of them taking a lock.
+ *
+ *  put() and clear() must only be called from one thread at a time (the Butler makes sure of this
+ *  with its mutex); get() must only be called from one (other) thread at a time.  So that the reader
+ *  never has to wait, a get() which coincides with a clear() returns silence.
+ */
 class AudioRingBuffers
 {
 public:
-	AudioRingBuffers ();
+	explicit AudioRingBuffers (int capacity = 65536);
 
 	AudioRingBuffers (AudioBuffers const&) = delete;
 	AudioRingBuffers& operator= (AudioBuffers const&) = delete;
 
 	void put (std::shared_ptr<const AudioBuffers> data, dcpomatic::DCPTime time, int frame_rate);
 	boost::optional<dcpomatic::DCPTime> get (float* out, int channels, int frames);
+	boost::optional<dcpomatic::DCPTime> get (AudioBuffers& out);
 	boost::optional<dcpomatic::DCPTime> peek () const;
 
 	void clear ();
 	/** @return number of frames currently available */
 	Frame size () const;
+	/** @return approximate number of bytes of audio data that we are holding */
+	size_t memory_used () const;
 
 private:
-	mutable boost::mutex _mutex;
-	std::list<std::pair<std::shared_ptr<const AudioBuffers>, dcpomatic::DCPTime>> _buffers;
+	struct Slot
+	{
+		std::shared_ptr<const AudioBuffers> buffers;
+		boost::atomic<dcpomatic::DCPTime::Type> time;
+		/** Total number of frames that had been put when this slot was put, including its own */
+		Frame end = 0;
+	};
+
+	template <class Copy, class Silence>
+	boost::optional<dcpomatic::DCPTime> get_common (int frames, Copy copy, Silence silence);
+	void skip_to (uint64_t to);
+	void apply_pending_clear ();
+
+	std::vector<Slot> _slots;
+
+	/** Index (not wrapped to the size of _slots) of the next slot that put() will write */
+	boost::atomic<uint64_t> _write;
+	/** Index (not wrapped to the size of _slots) of the next slot that get() will read */
+	boost::atomic<uint64_t> _read;
+	/** Index of the first slot that put() has not yet released; only used by the writer */
+	uint64_t _release = 0;
+
+	/** Total frames that have been put */
+	boost::atomic<Frame> _put_frames;
+	/** Total frames that have been got, or thrown away by clear() */
+	boost::atomic<Frame> _got_frames;
+	/** Value of _put_frames at the last clear() */
+	boost::atomic<Frame> _cleared_frames;
+	boost::atomic<int> _channels;
+
+	enum { IDLE, READING, CLEARING };
+	/** IDLE, or whichever of get() or clear() is currently moving _read */
+	boost::atomic<int> _state;
+	/** If non-zero, a value of _write that get() should skip _read forward to because a clear()
+	 *  happened while it was reading.
+	 */
+	boost::atomic<uint64_t> _pending_clear;
+
+	/** Frames of the slot at _read that have already been got; only used by get() or a clear() */
 	int _used_in_head = 0;
+
+	/** Details of the last put(), to check timing; only used by the writer */
+	boost::optional<dcpomatic::DCPTime> _last_time;
+	int _last_frames = 0;
 };
 
 
@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "audio_sample_conversion.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <cstring>
+
+
+/* Multiplying by these gives exactly the same results as dividing by 2^15 and 2^31 */
+static float const s16_scale = 1.0f / (1 << 15);
+static float const s32_scale = 1.0f / 2147483648.0f;
+
+
+void
+s16_to_float (int16_t const* in, float* out, int count)
+{
+	int i = 0;
+
+#ifdef __SSE2__
+	auto const scale = _mm_set1_ps(s16_scale);
+	for (; i + 8 <= count; i += 8) {
+		auto const samples = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+		/* Put each 16-bit sample in the top of a 32-bit lane then shift it down to sign-extend it */
+		auto const low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		auto const high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		out[i] = in[i] * s16_scale;
+	}
+}
+
+
+void
+s32_to_float (int32_t const* in, float* out, int count)
+{
+	int i = 0;
+
+#ifdef __SSE2__
+	auto const scale = _mm_set1_ps(s32_scale);
+	for (; i + 4 <= count; i += 4) {
+		auto const samples = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		out[i] = static_cast<float>(in[i]) * s32_scale;
+	}
+}
+
+
+void
+s24_to_float (uint8_t const* in, float* out, int count)
+{
+	/* There's no neat way to unpack 3-byte samples with SSE2, so this is left to the compiler */
+	for (int i = 0; i < count; ++i) {
+		auto const sample = static_cast<int32_t>((uint32_t(in[0]) << 8) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 24));
+		out[i] = static_cast<float>(sample) * s32_scale;
+		in += 3;
+	}
+}
+
+
+void
+deinterleave_float (float const* in, float* const* out, int channels, int frames)
+{
+	if (channels == 1) {
+		memcpy (out[0], in, frames * sizeof(float));
+		return;
+	}
+
+	int i = 0;
+
+#ifdef __SSE2__
+	if (channels == 2) {
+		/* Stereo is common enough to be worth doing four frames at a time */
+		auto left = out[0];
+		auto right = out[1];
+		for (; i + 4 <= frames; i += 4) {
+			auto const a = _mm_loadu_ps(in + i * 2);
+			auto const b = _mm_loadu_ps(in + i * 2 + 4);
+			_mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+#endif
+
+	/* Otherwise go through the input once, which is kinder to the cache than going
+	 * through it once per channel when there are many channels.
+	 */
+	auto p = in + i * channels;
+	for (; i < frames; ++i) {
+		for (int c = 0; c < channels; ++c) {
+			out[c][i] = *p++;
+		}
+	}
+}
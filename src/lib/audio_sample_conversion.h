@@ -0,0 +1,54 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/audio_sample_conversion.h
+ *  @brief Conversion of decoded integer and float audio samples to DCP-o-matic's float format.
+ *
+ *  These are vectorised with SSE2 where it is available.
+ */
+
+
+#ifndef DCPOMATIC_AUDIO_SAMPLE_CONVERSION_H
+#define DCPOMATIC_AUDIO_SAMPLE_CONVERSION_H
+
+
+#include <cstdint>
+
+
+/** Convert some signed 16-bit samples to floats in the range [-1, 1) */
+extern void s16_to_float (int16_t const* in, float* out, int count);
+/** Convert some packed, little-endian signed 24-bit samples to floats in the range [-1, 1).
+ *  The results are the same as those from shifting each sample into the top of an int32_t
+ *  and then using s32_to_float(), which is what FFmpeg's PCM decoder does.
+ */
+extern void s24_to_float (uint8_t const* in, float* out, int count);
+/** Convert some signed 32-bit samples to floats in the range [-1, 1] */
+extern void s32_to_float (int32_t const* in, float* out, int count);
+/** Split interleaved float samples into one buffer per channel.
+ *  @param in Interleaved samples; there should be channels * frames of them.
+ *  @param out One output buffer for each channel, each with space for frames samples.
+ */
+extern void deinterleave_float (float const* in, float* const* out, int channels, int frames);
+
+
+#endif
@@ -24,6 +24,8 @@
 #include "constants.h"
 
 
+using std::make_shared;
+using std::shared_ptr;
 using boost::optional;
 
 
@@ -52,6 +54,21 @@ AudioStream::set_mapping (AudioMapping mapping)
 {
 	boost::mutex::scoped_lock lm (_mutex);
 	_mapping = mapping;
+	_sparse_mapping.reset();
+}
+
+
+/** @return Our mapping compiled for applying to audio with the given number of output channels.
+ *  This is cached until the mapping changes, so it is cheap to call for every block of audio.
+ */
+shared_ptr<const SparseAudioMapping>
+AudioStream::sparse_mapping (int output_channels) const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	if (!_sparse_mapping || _sparse_mapping->output_channels() != output_channels) {
+		_sparse_mapping = make_shared<SparseAudioMapping>(_mapping, output_channels);
+	}
+	return _sparse_mapping;
 }
 
 
@@ -54,6 +54,8 @@ public:
 		return _length;
 	}
 
+	std::shared_ptr<const SparseAudioMapping> sparse_mapping (int output_channels) const;
+
 	int channels () const;
 	boost::optional<int> bit_depth() const;
 
@@ -67,6 +69,8 @@ private:
 	int _frame_rate;
 	Frame _length;
 	AudioMapping _mapping;
+	/** _mapping compiled for the number of output channels that was last asked for */
+	mutable std::shared_ptr<const SparseAudioMapping> _sparse_mapping;
 	boost::optional<int> _bit_depth;
 };
 
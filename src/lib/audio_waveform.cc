@@ -0,0 +1,175 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  src/lib/audio_waveform.cc
+ *  @brief AudioWaveform class.
+ */
+
+
+#include "audio_buffers.h"
+#include "audio_waveform.h"
+#include "exceptions.h"
+#include <dcp/file.h>
+#include <dcp/filesystem.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+using std::make_pair;
+using std::max;
+using std::min;
+using std::pair;
+using std::vector;
+using namespace dcpomatic;
+
+
+static char const magic[] = "DCPWVFM1";
+
+
+AudioWaveform::AudioWaveform (boost::filesystem::path file)
+{
+	dcp::File f(file, "rb");
+	if (!f) {
+		throw OpenFileError(file, errno, OpenFileError::READ);
+	}
+
+	char check[sizeof(magic)];
+	f.checked_read(check, sizeof(check));
+	if (memcmp(check, magic, sizeof(magic)) != 0) {
+		throw FileError("Unrecognised audio waveform file", file);
+	}
+
+	uint64_t points;
+	f.checked_read(&points, sizeof(points));
+	_min.resize(points);
+	_max.resize(points);
+	if (points > 0) {
+		f.checked_read(_min.data(), points * sizeof(float));
+		f.checked_read(_max.data(), points * sizeof(float));
+	}
+}
+
+
+void
+AudioWaveform::write (boost::filesystem::path file) const
+{
+	/* More than one job may write the same file at once, so use a unique temporary name */
+	auto tmp = file;
+	tmp += "." + boost::filesystem::unique_path().string() + ".tmp";
+
+	try {
+		{
+			dcp::File f(tmp, "wb");
+			if (!f) {
+				throw OpenFileError(tmp, errno, OpenFileError::WRITE);
+			}
+
+			f.checked_write(magic, sizeof(magic));
+			uint64_t const points = _min.size();
+			f.checked_write(&points, sizeof(points));
+			if (points > 0) {
+				f.checked_write(_min.data(), points * sizeof(float));
+				f.checked_write(_max.data(), points * sizeof(float));
+			}
+		}
+
+		dcp::filesystem::rename(tmp, file);
+	} catch (...) {
+		boost::system::error_code ec;
+		dcp::filesystem::remove(tmp, ec);
+		throw;
+	}
+}
+
+
+/** Add some audio to the summary.
+ *  @param frame_rate Sampling rate of audio.
+ *  @param time Time of the first frame of audio.
+ */
+void
+AudioWaveform::add (AudioBuffers const& audio, int frame_rate, ContentTime time)
+{
+	auto const t0 = time.seconds();
+	int i = 0;
+	while (i < audio.frames()) {
+		auto const point = static_cast<int64_t>(floor((t0 + static_cast<double>(i) / frame_rate) * points_per_second));
+		/* First frame which is in the next point */
+		auto const next = static_cast<int>(ceil(((static_cast<double>(point) + 1) / points_per_second - t0) * frame_rate));
+		auto const end = min(audio.frames(), max(i + 1, next));
+
+		if (point >= 0) {
+			if (point >= static_cast<int64_t>(_min.size())) {
+				_min.resize(point + 1, 0);
+				_max.resize(point + 1, 0);
+			}
+			auto low = _min[point];
+			auto high = _max[point];
+			for (int c = 0; c < audio.channels(); ++c) {
+				auto data = audio.data(c);
+				for (int j = i; j < end; ++j) {
+					low = min(low, data[j]);
+					high = max(high, data[j]);
+				}
+			}
+			_min[point] = low;
+			_max[point] = high;
+		}
+
+		i = end;
+	}
+}
+
+
+/** Move everything in the summary later by some time (or earlier if it is negative) */
+void
+AudioWaveform::shift (ContentTime by)
+{
+	auto const points = llrint(by.seconds() * points_per_second);
+	if (points > 0) {
+		_min.insert(_min.begin(), points, 0);
+		_max.insert(_max.begin(), points, 0);
+	} else if (points < 0) {
+		auto const remove = min(static_cast<size_t>(-points), _min.size());
+		_min.erase(_min.begin(), _min.begin() + remove);
+		_max.erase(_max.begin(), _max.begin() + remove);
+	}
+}
+
+
+pair<float, float>
+AudioWaveform::range (ContentTime from, ContentTime to) const
+{
+	auto const size = static_cast<int64_t>(_min.size());
+	auto const first = max(int64_t(0), static_cast<int64_t>(floor(from.seconds() * points_per_second)));
+	/* Always look at one point, however small the range */
+	auto const last = min(size, max(first + 1, static_cast<int64_t>(ceil(to.seconds() * points_per_second))));
+
+	float low = 0;
+	float high = 0;
+	for (auto i = first; i < last; ++i) {
+		low = min(low, _min[i]);
+		high = max(high, _max[i]);
+	}
+
+	return make_pair(low, high);
+}
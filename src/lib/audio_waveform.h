@@ -0,0 +1,70 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  src/lib/audio_waveform.h
+ *  @brief AudioWaveform class.
+ */
+
+
+#ifndef DCPOMATIC_AUDIO_WAVEFORM_H
+#define DCPOMATIC_AUDIO_WAVEFORM_H
+
+
+#include "dcpomatic_time.h"
+#include <boost/filesystem.hpp>
+#include <utility>
+#include <vector>
+
+
+class AudioBuffers;
+
+
+/** @class AudioWaveform
+ *  @brief A low-resolution summary of some audio, giving the smallest and largest sample
+ *  (across all channels) in each short period, used to draw audio in the timeline.
+ */
+class AudioWaveform
+{
+public:
+	AudioWaveform () {}
+	explicit AudioWaveform (boost::filesystem::path file);
+
+	void add (AudioBuffers const& audio, int frame_rate, dcpomatic::ContentTime time);
+	void shift (dcpomatic::ContentTime by);
+	void write (boost::filesystem::path file) const;
+
+	bool empty () const {
+		return _min.empty();
+	}
+
+	/** @return smallest and largest samples between two times, or (0, 0) if we have nothing there */
+	std::pair<float, float> range (dcpomatic::ContentTime from, dcpomatic::ContentTime to) const;
+
+	static int constexpr points_per_second = 50;
+
+private:
+	std::vector<float> _min;
+	std::vector<float> _max;
+};
+
+
+#endif
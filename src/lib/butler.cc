@@ -21,11 +21,13 @@
 
 #include "butler.h"
 #include "compose.hpp"
+#include "config.h"
 #include "cross.h"
 #include "dcpomatic_log.h"
 #include "exceptions.h"
 #include "log.h"
 #include "player.h"
+#include "trace.h"
 #include "util.h"
 #include "video_content.h"
 
@@ -36,6 +38,7 @@ using std::make_pair;
 using std::pair;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using std::weak_ptr;
 using boost::bind;
 using boost::optional;
@@ -59,6 +62,7 @@ using namespace boost::placeholders;
  *  butler.  This will be used (where possible) to prepare the PlayerVideos so that calling image() on them is quick.
  *  @param alignment Same as above for the `alignment' value.
  *  @param fast Same as above for the `fast' flag.
+ *  @param priority Priority to give to the work of preparing PlayerVideos.
  */
 Butler::Butler (
 	weak_ptr<const Film> film,
@@ -70,17 +74,18 @@ Butler::Butler (
 	Image::Alignment alignment,
 	bool fast,
 	bool prepare_only_proxy,
-	Audio audio
+	Audio audio,
+	TaskScheduler::Priority priority
 	)
 	: _film (film)
 	, _player (player)
-	, _prepare_work (new boost::asio::io_service::work(_prepare_service))
+	, _prepare_tasks (TaskScheduler::instance(), priority)
 	, _pending_seek_accurate (false)
 	, _suspended (0)
 	, _finished (false)
 	, _died (false)
 	, _stop_thread (false)
-	, _audio_mapping (audio_mapping)
+	, _audio_mapping (audio_mapping, audio_channels)
 	, _audio_channels (audio_channels)
 	, _disable_audio (audio == Audio::DISABLED)
 	, _pixel_format (pixel_format)
@@ -88,6 +93,7 @@ Butler::Butler (
 	, _alignment (alignment)
 	, _fast (fast)
 	, _prepare_only_proxy (prepare_only_proxy)
+	, _memory_limit (static_cast<size_t>(Config::instance()->player_memory_limit()) * 1024 * 1024)
 {
 	_player_video_connection = _player.Video.connect(bind(&Butler::video, this, _1, _2));
 	_player_audio_connection = _player.Audio.connect(bind(&Butler::audio, this, _1, _2, _3));
@@ -100,16 +106,6 @@ Butler::Butler (
 #ifdef DCPOMATIC_LINUX
 	pthread_setname_np (_thread.native_handle(), "butler");
 #endif
-
-	/* Create some threads to do work on the PlayerVideos we are creating; at present this is used to
-	   multi-thread JPEG2000 decoding.
-	*/
-
-	LOG_TIMING("start-prepare-threads %1", boost::thread::hardware_concurrency() * 2);
-
-	for (size_t i = 0; i < boost::thread::hardware_concurrency() * 2; ++i) {
-		_prepare_pool.create_thread (bind (&boost::asio::io_service::run, &_prepare_service));
-	}
 }
 
 
@@ -122,9 +118,7 @@ Butler::~Butler ()
 		_stop_thread = true;
 	}
 
-	_prepare_work.reset ();
-	_prepare_pool.join_all ();
-	_prepare_service.stop ();
+	_prepare_tasks.wait ();
 
 	_thread.interrupt ();
 	try {
@@ -178,6 +172,11 @@ Butler::should_run () const
 		return true;
 	}
 
+	if (_memory_limit && memory_used().first >= _memory_limit) {
+		/* We have the minimum that we need, and we've used all the memory we are allowed */
+		return false;
+	}
+
 	/* Run if we aren't full of video or audio */
 	return (_video.size() < MAXIMUM_VIDEO_READAHEAD) && (_audio.size() < MAXIMUM_AUDIO_READAHEAD);
 }
@@ -197,11 +196,21 @@ try
 			_summon.wait (lm);
 		}
 
-		/* Do any seek that has been requested */
-		if (_pending_seek_position) {
+		/* Do any seek that has been requested.  We don't hold the lock while the player seeks, so
+		   that seek() can be called again without waiting (as happens when the user drags the
+		   position slider).  Any seeks that arrive meanwhile are coalesced so that we only go on
+		   to the last of them.
+		*/
+		while (_pending_seek_position) {
 			_finished = false;
-			_player.seek(*_pending_seek_position, _pending_seek_accurate);
-			_pending_seek_position = optional<DCPTime> ();
+			auto const position = *_pending_seek_position;
+			auto const accurate = _pending_seek_accurate;
+			_pending_seek_position = optional<DCPTime>();
+			_seeking = position;
+			lm.unlock ();
+			_player.seek(position, accurate);
+			lm.lock ();
+			_seeking = optional<DCPTime>();
 		}
 
 		/* Fill _video and _audio.  Don't try to carry on if a pending seek appears
@@ -326,6 +335,7 @@ try
 	/* If the weak_ptr cannot be locked the video obviously no longer requires any work */
 	if (video) {
 		LOG_TIMING("start-prepare in %1", thread_id());
+		TraceSpan span("prepare", "butler");
 		video->prepare (_pixel_format, _video_range, _alignment, _fast, _prepare_only_proxy);
 		LOG_TIMING("finish-prepare in %1", thread_id());
 	}
@@ -355,7 +365,10 @@ Butler::video (shared_ptr<PlayerVideo> video, DCPTime time)
 		return;
 	}
 
-	_prepare_service.post (bind(&Butler::prepare, this, weak_ptr<PlayerVideo>(video)));
+	/* Do some work on the PlayerVideos we are creating; at present this is used to multi-thread
+	   JPEG2000 decoding.
+	*/
+	_prepare_tasks.submit (bind(&Butler::prepare, this, weak_ptr<PlayerVideo>(video)));
 
 	_video.put (video, time);
 }
@@ -370,7 +383,7 @@ Butler::audio (shared_ptr<AudioBuffers> audio, DCPTime time, int frame_rate)
 		return;
 	}
 
-	_audio.put (remap(audio, _audio_channels, _audio_mapping), time, frame_rate);
+	_audio.put (_audio_mapping.run(audio), time, frame_rate);
 }
 
 
@@ -383,6 +396,16 @@ Butler::audio (shared_ptr<AudioBuffers> audio, DCPTime time, int frame_rate)
 optional<DCPTime>
 Butler::get_audio (Behaviour behaviour, float* out, Frame frames)
 {
+	if (behaviour == Behaviour::NON_BLOCKING) {
+		/* This is called from real-time audio callbacks, so it must not wait for our mutex.
+		   _audio can be read without it, and if the notify is missed by a butler thread that
+		   is just about to wait it will get the next one.
+		*/
+		auto t = _audio.get (out, _audio_channels, frames);
+		_summon.notify_all ();
+		return t;
+	}
+
 	boost::mutex::scoped_lock lm (_mutex);
 
 	while (behaviour == Behaviour::BLOCKING && !_finished && !_died && _audio.size() < frames) {
@@ -395,11 +418,54 @@ Butler::get_audio (Behaviour behaviour, float* out, Frame frames)
 }
 
 
+/** Like get_audio (Behaviour, float*, Frame) but fills the whole of out without interleaving,
+ *  for callers that want the audio as separate channels.
+ */
+optional<DCPTime>
+Butler::get_audio (Behaviour behaviour, AudioBuffers& out)
+{
+	DCPOMATIC_ASSERT (out.channels() == _audio_channels);
+
+	if (behaviour == Behaviour::NON_BLOCKING) {
+		auto t = _audio.get (out);
+		_summon.notify_all ();
+		return t;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	while (!_finished && !_died && _audio.size() < out.frames()) {
+		_arrived.wait (lm);
+	}
+
+	auto t = _audio.get (out);
+	_summon.notify_all ();
+	return t;
+}
+
+
+vector<Metric>
+Butler::metrics () const
+{
+	return {
+		Metric("butler_video_frames", _video.size()),
+		Metric("butler_audio_frames", _audio.size()),
+		Metric("butler_bytes_in_memory", memory_used().first)
+	};
+}
+
+
 pair<size_t, string>
 Butler::memory_used () const
 {
-	/* XXX: should also look at _audio.memory_used() */
-	return _video.memory_used();
+	auto const video = _video.memory_used();
+	auto const audio = _audio.memory_used();
+	auto const text = _closed_caption.memory_used();
+
+	return make_pair(
+		video.first + audio + text,
+		String::compose("%1 (%2 bytes), %3 audio frames (%4 bytes), %5 bytes of closed captions", video.second, video.first, _audio.size(), audio, text)
+		);
 }
 
 
@@ -430,7 +496,10 @@ Butler::player_change (ChangeType type, int property)
 
 		DCPTime seek_to;
 		auto next = _video.get().second;
-		if (_awaiting && _awaiting > next) {
+		if (_seeking) {
+			/* The player is part-way through a seek, so go back to where it was going */
+			seek_to = *_seeking;
+		} else if (_awaiting && _awaiting > next) {
 			/* We have recently done a player_changed seek and our buffers haven't been refilled yet,
 			   so assume that we're seeking to the same place as last time.
 			*/
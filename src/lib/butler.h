@@ -27,10 +27,11 @@
 #include "audio_ring_buffers.h"
 #include "change_signaller.h"
 #include "exception_store.h"
+#include "metric.h"
+#include "task_scheduler.h"
 #include "text_ring_buffers.h"
 #include "text_type.h"
 #include "video_ring_buffers.h"
-#include <boost/asio.hpp>
 #include <boost/signals2.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
@@ -59,7 +60,8 @@ public:
 		Image::Alignment alignment,
 		bool fast,
 		bool prepare_only_proxy,
-		Audio audio
+		Audio audio,
+		TaskScheduler::Priority priority = TaskScheduler::Priority::PREVIEW
 		);
 
 	~Butler ();
@@ -91,10 +93,16 @@ public:
 
 	std::pair<std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime> get_video (Behaviour behaviour, Error* e = nullptr);
 	boost::optional<dcpomatic::DCPTime> get_audio (Behaviour behaviour, float* out, Frame frames);
+	boost::optional<dcpomatic::DCPTime> get_audio (Behaviour behaviour, AudioBuffers& out);
 	boost::optional<TextRingBuffers::Data> get_closed_caption ();
 
+	/** @return approximate memory used by video, audio and closed captions that we are holding,
+	 *  and a description of what there is.
+	 */
 	std::pair<size_t, std::string> memory_used () const;
 
+	std::vector<Metric> metrics () const;
+
 private:
 	void thread ();
 	void video (std::shared_ptr<PlayerVideo> video, dcpomatic::DCPTime time);
@@ -113,23 +121,24 @@ private:
 	AudioRingBuffers _audio;
 	TextRingBuffers _closed_caption;
 
-	boost::thread_group _prepare_pool;
-	boost::asio::io_service _prepare_service;
-	std::shared_ptr<boost::asio::io_service::work> _prepare_work;
+	/** Tasks to prepare PlayerVideos, run by the process-wide TaskScheduler */
+	TaskScheduler::Group _prepare_tasks;
 
-	/** mutex to protect _pending_seek_position, _pending_seek_accurate, _finished, _died, _stop_thread */
+	/** mutex to protect _pending_seek_position, _pending_seek_accurate, _seeking, _finished, _died, _stop_thread */
 	boost::mutex _mutex;
 	boost::condition _summon;
 	boost::condition _arrived;
 	boost::optional<dcpomatic::DCPTime> _pending_seek_position;
 	bool _pending_seek_accurate;
+	/** Position that the player is seeking to (without _mutex held), if it is doing so */
+	boost::optional<dcpomatic::DCPTime> _seeking;
 	int _suspended;
 	bool _finished;
 	bool _died;
 	std::string _died_message;
 	bool _stop_thread;
 
-	AudioMapping _audio_mapping;
+	SparseAudioMapping _audio_mapping;
 	int _audio_channels;
 
 	bool _disable_audio;
@@ -147,6 +156,11 @@ private:
 	 */
 	bool _prepare_only_proxy = false;
 
+	/** Maximum number of bytes that our buffers should use once they have
+	 *  their minimum read-ahead, or 0 for no limit.
+	 */
+	size_t _memory_limit = 0;
+
 	/** If we are waiting to be refilled following a seek, this is the time we were
 	    seeking to.
 	*/
@@ -23,7 +23,9 @@
 #define DCPOMATIC_CHANGE_SIGNALLER_H
 
 
+#include "dcpomatic_assert.h"
 #include <boost/thread.hpp>
+#include <algorithm>
 #include <vector>
 
 
@@ -69,35 +71,61 @@ public:
 
 	void signal_change(ChangeSignal<T, P> const& signal)
 	{
+		boost::mutex::scoped_lock lm(_mutex);
 		if (_suspended) {
-			boost::mutex::scoped_lock lm(_mutex);
 			_pending.push_back(signal);
-		} else {
-			signal.thing->signal_change(signal.type, signal.property);
+			return;
 		}
+		lm.unlock();
+
+		signal.thing->signal_change(signal.type, signal.property);
 	}
 
+	/** Hold back change signals until a matching call to resume(); calls may be nested */
 	void suspend()
 	{
 		boost::mutex::scoped_lock lm(_mutex);
-		_suspended = true;
+		++_suspended;
 	}
 
+	/** Undo a call to suspend().  When the last suspension is lifted the signals that were held
+	 *  back are sent, with each property of each thing that changed (perhaps many times) being
+	 *  signalled just once, and with all the PENDING signals coming before any DONE or CANCELLED.
+	 */
 	void resume()
 	{
 		boost::mutex::scoped_lock lm(_mutex);
-		auto pending = _pending;
+		DCPOMATIC_ASSERT(_suspended > 0);
+		if (--_suspended > 0) {
+			return;
+		}
+		auto pending = std::move(_pending);
+		_pending.clear();
 		lm.unlock();
 
-		for (auto signal: pending) {
+		for (auto const& signal: collapse(pending)) {
 			signal.thing->signal_change(signal.type, signal.property);
 		}
-
-		lm.lock();
-		_pending.clear();
-		_suspended = false;
 	}
 
+	/** Suspend signals for the lifetime of this object, so that changes made in a batch are signalled once */
+	class Batch
+	{
+	public:
+		Batch()
+		{
+			ChangeSignalDespatcher<T, P>::instance()->suspend();
+		}
+
+		~Batch()
+		{
+			ChangeSignalDespatcher<T, P>::instance()->resume();
+		}
+
+		Batch(Batch const&) = delete;
+		Batch& operator=(Batch const&) = delete;
+	};
+
 	static ChangeSignalDespatcher* instance()
 	{
 		static boost::mutex _instance_mutex;
@@ -110,8 +138,71 @@ public:
 	}
 
 private:
+	static std::vector<ChangeSignal<T, P>> collapse(std::vector<ChangeSignal<T, P>> const& signals)
+	{
+		/* The held-back signals for one property of one thing, with the number of
+		 * PENDINGs that have not yet been closed by a DONE or CANCELLED.
+		 */
+		struct Group
+		{
+			Group(T* thing_, P property_)
+				: thing(thing_)
+				, property(property_)
+			{}
+
+			T* thing;
+			P property;
+			int open = 1;
+			/* true if any of the changes was DONE rather than CANCELLED */
+			bool done = false;
+		};
+
+		std::vector<Group> groups;
+		/* DONE/CANCELLED for PENDINGs which were sent before we were suspended */
+		std::vector<ChangeSignal<T, P>> closes;
+
+		for (auto const& signal: signals) {
+			auto group = std::find_if(groups.begin(), groups.end(), [&signal](Group const& g) {
+				return g.thing == signal.thing && g.property == signal.property;
+			});
+
+			if (signal.type == ChangeType::PENDING) {
+				if (group != groups.end()) {
+					++group->open;
+				} else {
+					groups.push_back(Group(signal.thing, signal.property));
+				}
+			} else if (group != groups.end() && group->open > 0) {
+				--group->open;
+				group->done = group->done || signal.type == ChangeType::DONE;
+			} else {
+				closes.push_back(signal);
+			}
+		}
+
+		std::vector<ChangeSignal<T, P>> collapsed;
+		for (auto const& group: groups) {
+			/* If a group is still open its remaining closes will come after we resume, so it
+			 * needs a PENDING for each of them; otherwise one PENDING (and one close) will do.
+			 */
+			for (int i = 0; i < std::max(1, group.open); ++i) {
+				collapsed.push_back({group.thing, group.property, ChangeType::PENDING});
+			}
+		}
+		for (auto const& close: closes) {
+			collapsed.push_back(close);
+		}
+		for (auto const& group: groups) {
+			if (group.open == 0) {
+				collapsed.push_back({group.thing, group.property, group.done ? ChangeType::DONE : ChangeType::CANCELLED});
+			}
+		}
+
+		return collapsed;
+	}
+
 	std::vector<ChangeSignal<T, P>> _pending;
-	bool _suspended = false;
+	int _suspended = 0;
 	boost::mutex _mutex;
 };
 
@@ -22,6 +22,7 @@
 #include "colour_conversion.h"
 #include "config.h"
 #include "digester.h"
+#include "encoding_request.h"
 #include "util.h"
 #include <dcp/chromaticity.h>
 #include <dcp/gamma_transfer_function.h>
@@ -140,6 +141,103 @@ ColourConversion::ColourConversion (cxml::NodePtr node, int version)
 	}
 }
 
+/* Identifiers for input transfer functions in binary encoding requests */
+enum class BinaryTransferFunction : uint32_t
+{
+	NONE = 0,
+	GAMMA = 1,
+	MODIFIED_GAMMA = 2,
+	SGAMUT3 = 3
+};
+
+
+/** Read a conversion written by as_binary() */
+ColourConversion::ColourConversion (EncodingRequestReader& reader)
+{
+	switch (static_cast<BinaryTransferFunction>(reader.read_uint())) {
+	case BinaryTransferFunction::NONE:
+		break;
+	case BinaryTransferFunction::GAMMA:
+		_in = make_shared<dcp::GammaTransferFunction>(reader.read_double());
+		break;
+	case BinaryTransferFunction::MODIFIED_GAMMA:
+	{
+		auto const power = reader.read_double();
+		auto const threshold = reader.read_double();
+		auto const A = reader.read_double();
+		auto const B = reader.read_double();
+		_in = make_shared<dcp::ModifiedGammaTransferFunction>(power, threshold, A, B);
+		break;
+	}
+	case BinaryTransferFunction::SGAMUT3:
+		_in = make_shared<dcp::SGamut3TransferFunction>();
+		break;
+	}
+
+	_yuv_to_rgb = static_cast<dcp::YUVToRGB>(reader.read_int());
+
+	auto read_chromaticity = [&reader]() -> dcp::Chromaticity {
+		auto const x = reader.read_double();
+		auto const y = reader.read_double();
+		return dcp::Chromaticity(x, y);
+	};
+
+	_red = read_chromaticity();
+	_green = read_chromaticity();
+	_blue = read_chromaticity();
+	_white = read_chromaticity();
+	if (reader.read_bool()) {
+		_adjusted_white = read_chromaticity();
+	}
+
+	auto gamma = reader.read_optional_double();
+	if (gamma) {
+		_out = make_shared<dcp::GammaTransferFunction>(*gamma);
+	} else {
+		_out = make_shared<dcp::IdentityTransferFunction>();
+	}
+}
+
+
+/** Write the same information as as_xml(), but in the compact form used by encoding requests */
+void
+ColourConversion::as_binary (EncodingRequestWriter& writer) const
+{
+	if (auto tf = dynamic_pointer_cast<const dcp::GammaTransferFunction>(_in)) {
+		writer.write_uint(static_cast<uint32_t>(BinaryTransferFunction::GAMMA));
+		writer.write_double(tf->gamma());
+	} else if (auto mtf = dynamic_pointer_cast<const dcp::ModifiedGammaTransferFunction>(_in)) {
+		writer.write_uint(static_cast<uint32_t>(BinaryTransferFunction::MODIFIED_GAMMA));
+		writer.write_double(mtf->power());
+		writer.write_double(mtf->threshold());
+		writer.write_double(mtf->A());
+		writer.write_double(mtf->B());
+	} else if (dynamic_pointer_cast<const dcp::SGamut3TransferFunction>(_in)) {
+		writer.write_uint(static_cast<uint32_t>(BinaryTransferFunction::SGAMUT3));
+	} else {
+		writer.write_uint(static_cast<uint32_t>(BinaryTransferFunction::NONE));
+	}
+
+	writer.write_int(static_cast<int>(_yuv_to_rgb));
+
+	for (auto const& chromaticity: { _red, _green, _blue, _white }) {
+		writer.write_double(chromaticity.x);
+		writer.write_double(chromaticity.y);
+	}
+	writer.write_bool(static_cast<bool>(_adjusted_white));
+	if (_adjusted_white) {
+		writer.write_double(_adjusted_white->x);
+		writer.write_double(_adjusted_white->y);
+	}
+
+	optional<double> gamma;
+	if (auto gf = dynamic_pointer_cast<const dcp::GammaTransferFunction>(_out)) {
+		gamma = gf->gamma();
+	}
+	writer.write_optional_double(gamma);
+}
+
+
 boost::optional<ColourConversion>
 ColourConversion::from_xml (cxml::NodePtr node, int version)
 {
@@ -33,15 +33,20 @@ namespace xmlpp {
 	class Node;
 }
 
+class EncodingRequestReader;
+class EncodingRequestWriter;
+
 class ColourConversion : public dcp::ColourConversion
 {
 public:
 	ColourConversion ();
 	explicit ColourConversion (dcp::ColourConversion);
 	ColourConversion (cxml::NodePtr, int version);
+	explicit ColourConversion (EncodingRequestReader& reader);
 	virtual ~ColourConversion () {}
 
 	virtual void as_xml (xmlpp::Node *) const;
+	void as_binary (EncodingRequestWriter& writer) const;
 	std::string identifier () const;
 
 	boost::optional<size_t> preset () const;
@@ -22,15 +22,37 @@
 #include "combine_dcp_job.h"
 #include "compose.hpp"
 #include "config.h"
-#include <dcp/combine.h>
+#include "cross.h"
+#include "dcpomatic_log.h"
+#include "util.h"
+#include <dcp/cpl.h>
+#include <dcp/dcp.h>
 #include <dcp/exceptions.h>
+#include <dcp/filesystem.h>
+#include <dcp/font_asset.h>
+#include <dcp/interop_subtitle_asset.h>
+#include <dcp/reel.h>
+#include <dcp/reel_atmos_asset.h>
+#include <dcp/reel_closed_caption_asset.h>
+#include <dcp/reel_file_asset.h>
+#include <dcp/reel_picture_asset.h>
+#include <dcp/reel_sound_asset.h>
+#include <dcp/reel_subtitle_asset.h>
+#include <dcp/version.h>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <atomic>
+#include <set>
 
 #include "i18n.h"
 
 
+using std::dynamic_pointer_cast;
+using std::set;
+using std::shared_ptr;
 using std::string;
 using std::vector;
-using std::shared_ptr;
+using boost::optional;
 
 
 CombineDCPJob::CombineDCPJob (vector<boost::filesystem::path> inputs, boost::filesystem::path output, string annotation_text)
@@ -60,26 +82,216 @@ CombineDCPJob::json_name () const
 void
 CombineDCPJob::run ()
 {
-	try {
-		dcp::combine (
-			_inputs,
-			_output,
-			String::compose("libdcp %1", dcp::version),
-			String::compose("libdcp %1", dcp::version),
-			dcp::LocalTime().as_string(),
-			_annotation_text,
-			Config::instance()->signer_chain()
-			);
-	} catch (dcp::CombineError& e) {
+	vector<shared_ptr<dcp::Asset>> assets;
+	vector<shared_ptr<dcp::CPL>> cpls;
+	optional<dcp::Standard> standard;
+
+	auto fail = [this](string message, string detail) {
 		set_state (FINISHED_ERROR);
-		set_error (e.what(), "");
-		return;
+		set_error (message, detail);
+	};
+
+	try {
+		for (auto input: _inputs) {
+			dcp::DCP dcp(input);
+			dcp.read();
+			if (standard && dcp.standard() && *standard != *dcp.standard()) {
+				return fail(_("Cannot combine Interop and SMPTE DCPs."), "");
+			}
+			if (!standard) {
+				standard = dcp.standard();
+			}
+			auto dcp_cpls = dcp.cpls();
+			std::copy(dcp_cpls.begin(), dcp_cpls.end(), back_inserter(cpls));
+			auto dcp_assets = dcp.assets(true);
+			std::copy(dcp_assets.begin(), dcp_assets.end(), back_inserter(assets));
+		}
 	} catch (dcp::ReadError& e) {
-		set_state (FINISHED_ERROR);
-		set_error (e.what(), e.detail().get_value_or(""));
-		return;
+		return fail(e.what(), e.detail().get_value_or(""));
+	}
+
+	/* Work out where all the assets that the CPLs need are going to go */
+
+	vector<Copy> copies;
+	set<string> done_ids;
+	set<boost::filesystem::path> done_paths;
+
+	auto add_copy = [&copies, &done_paths](boost::filesystem::path from, boost::filesystem::path to) {
+		if (done_paths.find(to) != done_paths.end()) {
+			throw std::runtime_error(String::compose(_("More than one asset is called %1"), to.filename().string()));
+		}
+		done_paths.insert(to);
+		copies.push_back({from, to});
+	};
+
+	auto add_asset = [this, &assets, &done_ids, &add_copy](string id, optional<boost::filesystem::path> extra) {
+		if (done_ids.find(id) != done_ids.end()) {
+			return;
+		}
+
+		auto iter = std::find_if(assets.begin(), assets.end(), [id](shared_ptr<const dcp::Asset> a) { return a->id() == id; });
+		if (iter == assets.end() || !(*iter)->file()) {
+			throw std::runtime_error(String::compose(_("Could not find asset %1"), id));
+		}
+
+		auto output_path = _output;
+		if (extra) {
+			output_path /= *extra;
+		}
+		output_path /= (*iter)->file()->filename();
+
+		add_copy (*(*iter)->file(), output_path);
+		(*iter)->set_file_preserving_hash(output_path);
+		done_ids.insert(id);
+	};
+
+	auto add_reel_asset = [&add_asset](shared_ptr<dcp::ReelFileAsset> asset, optional<boost::filesystem::path> extra) {
+		if (asset && asset->asset_ref().resolved()) {
+			add_asset (asset->asset_ref().id(), extra);
+		}
+	};
+
+	/* Interop subtitles go in a directory of their own, with their fonts and images */
+	auto add_subtitle = [this, &add_asset, &add_reel_asset, &add_copy](shared_ptr<dcp::ReelFileAsset> reel_asset, shared_ptr<const dcp::SubtitleAsset> asset) {
+		optional<boost::filesystem::path> extra;
+		if (auto interop = dynamic_pointer_cast<const dcp::InteropSubtitleAsset>(asset)) {
+			extra = interop->id();
+			for (auto font_asset: interop->font_assets()) {
+				add_asset (font_asset->id(), extra);
+			}
+			for (auto subtitle: interop->subtitles()) {
+				if (auto image = dynamic_pointer_cast<const dcp::SubtitleImage>(subtitle)) {
+					add_copy (*image->file(), _output / interop->id() / image->file()->filename());
+				}
+			}
+		}
+		add_reel_asset (reel_asset, extra);
+	};
+
+	try {
+		for (auto cpl: cpls) {
+			for (auto reel: cpl->reels()) {
+				add_reel_asset (reel->main_picture(), {});
+				add_reel_asset (reel->main_sound(), {});
+				if (reel->main_subtitle() && reel->main_subtitle()->asset_ref().resolved()) {
+					add_subtitle (reel->main_subtitle(), reel->main_subtitle()->asset());
+				}
+				for (auto ccap: reel->closed_captions()) {
+					if (ccap->asset_ref().resolved()) {
+						add_subtitle (ccap, ccap->asset());
+					}
+				}
+				add_reel_asset (reel->atmos(), {});
+			}
+		}
+
+		copy (copies);
+	} catch (std::runtime_error& e) {
+		return fail(e.what(), "");
+	}
+
+	try {
+		dcp::DCP output(_output);
+		for (auto cpl: cpls) {
+			output.add(cpl);
+		}
+		output.resolve_refs(assets);
+		output.set_issuer(String::compose("libdcp %1", dcp::version));
+		output.set_creator(String::compose("libdcp %1", dcp::version));
+		output.set_annotation_text(_annotation_text);
+		output.write_xml(Config::instance()->signer_chain());
+	} catch (dcp::UnresolvedRefError& e) {
+		return fail(e.what(), "");
 	}
 
 	set_progress (1);
 	set_state (FINISHED_OK);
 }
+
+
+/** Put some files in place, using copy-on-write clones or hard links where we can (which is
+ *  usually when the input and output are on the same filesystem) so that nothing is copied.
+ *  Real copies are done a few at a time.
+ */
+void
+CombineDCPJob::copy (vector<Copy> const& copies)
+{
+	boost::uintmax_t total = 0;
+	for (auto const& i: copies) {
+		total += dcp::filesystem::file_size(i.from);
+	}
+
+	std::atomic<boost::uintmax_t> done_bytes{0};
+	std::atomic<size_t> next{0};
+	boost::mutex exception_mutex;
+	boost::exception_ptr exception;
+
+	auto worker = [this, &copies, total, &done_bytes, &next, &exception_mutex, &exception]() {
+		try {
+			while (true) {
+				size_t const index = next++;
+				if (index >= copies.size()) {
+					break;
+				}
+
+				auto const& from = copies[index].from;
+				auto const& to = copies[index].to;
+				auto const size = dcp::filesystem::file_size(from);
+
+				dcp::filesystem::create_directories(to.parent_path());
+
+				boost::uintmax_t copied = 0;
+				if (clone_file(from, to)) {
+					LOG_GENERAL("Cloned %1 to %2", from.string(), to.string());
+				} else {
+					boost::system::error_code ec;
+					dcp::filesystem::create_hard_link(from, to, ec);
+					if (!ec) {
+						LOG_GENERAL("Hard-linked %1 to %2", from.string(), to.string());
+					} else {
+						LOG_GENERAL("Copying %1 to %2", from.string(), to.string());
+						copy_in_bits(from, to, [this, size, total, &copied, &done_bytes](float progress) {
+							boost::this_thread::interruption_point();
+							auto const now = static_cast<boost::uintmax_t>(progress * size);
+							done_bytes += now - copied;
+							copied = now;
+							set_progress (float(done_bytes) / total);
+						});
+					}
+				}
+
+				done_bytes += size - copied;
+				set_progress (total ? float(done_bytes) / total : 0);
+			}
+		} catch (...) {
+			boost::mutex::scoped_lock lm (exception_mutex);
+			if (!exception) {
+				exception = boost::current_exception();
+			}
+			/* Stop the other workers picking up anything else */
+			next = copies.size();
+		}
+	};
+
+	/* A few copies at once help with SSDs and network storage; any more would just make
+	 * spinning disks seek.
+	 */
+	size_t const threads = std::min(copies.size(), static_cast<size_t>(4));
+
+	boost::thread_group group;
+	for (size_t i = 0; i < threads; ++i) {
+		group.create_thread(worker);
+	}
+
+	try {
+		group.join_all ();
+	} catch (boost::thread_interrupted&) {
+		group.interrupt_all ();
+		group.join_all ();
+		throw;
+	}
+
+	if (exception) {
+		boost::rethrow_exception (exception);
+	}
+}
@@ -32,7 +32,19 @@ public:
 	std::string json_name () const override;
 	void run () override;
 
+	Resource resource () const override {
+		return Resource::DISK;
+	}
+
 private:
+	struct Copy
+	{
+		boost::filesystem::path from;
+		boost::filesystem::path to;
+	};
+
+	void copy (std::vector<Copy> const& copies);
+
 	std::vector<boost::filesystem::path> _inputs;
 	boost::filesystem::path _output;
 	std::string _annotation_text;
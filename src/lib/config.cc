@@ -197,9 +197,51 @@ Config::set_defaults ()
 	_default_kdm_type = dcp::Formulation::MODIFIED_TRANSITIONAL_1;
 	_default_kdm_duration = RoughDuration(1, RoughDuration::Unit::WEEKS);
 	_auto_crop_threshold = 0.1;
+	_auto_crop_samples = 1;
 	_last_release_notes_version = boost::none;
 	_allow_smpte_bv20 = false;
 	_isdcf_name_part_length = 14;
+	_adaptive_encoding_queue = true;
+	_external_j2k_encoder_command = "";
+	_external_j2k_encoder_threads = 1;
+	_image_buffer_pool_size = 512;
+	_writer_memory_limit = 1024;
+	_dcp_read_ahead = 64;
+	_j2k_decode_threads = 0;
+	_adaptive_decode_reduction = false;
+	_player_memory_limit = 0;
+	_parallel_audio_analysis = false;
+	_parallel_examine_jobs = 4;
+	_ffmpeg_trust_container_index = false;
+	_player_decode_ahead = false;
+	_ffmpeg_keyframe_index = false;
+	_ffmpeg_hardware_decode = "";
+	_ffmpeg_decode_threads = 8;
+	_kdm_email_connections = 1;
+	_disk_verify_sample_interval = 1;
+	_export_concurrent_reels = 2;
+	_dcp_encode_chunks = 1;
+	_reuse_previous_frames = true;
+	_resampler_quality = ResamplerQuality::BEST;
+	_preview_resampler_quality = ResamplerQuality::LINEAR;
+	_image_read_ahead = 256;
+	_ffmpeg_filter_threads = 4;
+	_tms_connections = 4;
+	_tms_resume = true;
+	_numa_aware_encoding = false;
+	_shared_frame_cache = boost::none;
+	_reduce_preview_ffmpeg_decode = false;
+	_preview_frame_cache_size = 256;
+	_encode_server_coordinator = "";
+	_encode_server_coordinator_priority = 1;
+	_content_read_buffer_size = 256;
+	_content_read_ahead = 32;
+	_image_huge_pages = false;
+	_ffmpeg_examine_subtitles = false;
+	_ui_watchdog = false;
+	_ui_watchdog_threshold = 500;
+	_kdm_cache = false;
+	_preallocate_video_assets = true;
 
 	_allowed_dcp_frame_rates.clear ();
 	_allowed_dcp_frame_rates.push_back (24);
@@ -277,6 +319,45 @@ Config::backup ()
 	copy_adding_number (_dkdm_recipients_file);
 }
 
+/* Make sure these two match each other */
+static
+ResamplerQuality
+read_resampler_quality(optional<string> name, ResamplerQuality default_quality)
+{
+	if (name && *name == "best") {
+		return ResamplerQuality::BEST;
+	} else if (name && *name == "medium") {
+		return ResamplerQuality::MEDIUM;
+	} else if (name && *name == "fastest") {
+		return ResamplerQuality::FASTEST;
+	} else if (name && *name == "linear") {
+		return ResamplerQuality::LINEAR;
+	}
+
+	return default_quality;
+}
+
+
+static
+string
+resampler_quality_to_string(ResamplerQuality quality)
+{
+	switch (quality) {
+	case ResamplerQuality::BEST:
+		return "best";
+	case ResamplerQuality::MEDIUM:
+		return "medium";
+	case ResamplerQuality::FASTEST:
+		return "fastest";
+	case ResamplerQuality::LINEAR:
+		return "linear";
+	}
+
+	DCPOMATIC_ASSERT(false);
+	return {};
+}
+
+
 void
 Config::read ()
 {
@@ -619,6 +700,7 @@ try
 		_default_kdm_duration = RoughDuration(1, RoughDuration::Unit::WEEKS);
 	}
 	_auto_crop_threshold = f.optional_number_child<double>("AutoCropThreshold").get_value_or(0.1);
+	_auto_crop_samples = max(1, f.optional_number_child<int>("AutoCropSamples").get_value_or(1));
 	_last_release_notes_version = f.optional_string_child("LastReleaseNotesVersion");
 	_main_divider_sash_position = f.optional_number_child<int>("MainDividerSashPosition");
 	_main_content_divider_sash_position = f.optional_number_child<int>("MainContentDividerSashPosition");
@@ -633,6 +715,47 @@ try
 
 	_allow_smpte_bv20 = f.optional_bool_child("AllowSMPTEBv20").get_value_or(false);
 	_isdcf_name_part_length = f.optional_number_child<int>("ISDCFNamePartLength").get_value_or(14);
+	_adaptive_encoding_queue = f.optional_bool_child("AdaptiveEncodingQueue").get_value_or(true);
+	_external_j2k_encoder_command = f.optional_string_child("ExternalJ2KEncoderCommand").get_value_or("");
+	_external_j2k_encoder_threads = f.optional_number_child<int>("ExternalJ2KEncoderThreads").get_value_or(1);
+	_image_buffer_pool_size = f.optional_number_child<int>("ImageBufferPoolSize").get_value_or(512);
+	_writer_memory_limit = f.optional_number_child<int>("WriterMemoryLimit").get_value_or(1024);
+	_dcp_read_ahead = f.optional_number_child<int>("DCPReadAhead").get_value_or(64);
+	_j2k_decode_threads = f.optional_number_child<int>("J2KDecodeThreads").get_value_or(0);
+	_adaptive_decode_reduction = f.optional_bool_child("AdaptiveDecodeReduction").get_value_or(false);
+	_player_memory_limit = f.optional_number_child<int>("PlayerMemoryLimit").get_value_or(0);
+	_parallel_audio_analysis = f.optional_bool_child("ParallelAudioAnalysis").get_value_or(false);
+	_parallel_examine_jobs = f.optional_number_child<int>("ParallelExamineJobs").get_value_or(4);
+	_ffmpeg_trust_container_index = f.optional_bool_child("FFmpegTrustContainerIndex").get_value_or(false);
+	_player_decode_ahead = f.optional_bool_child("PlayerDecodeAhead").get_value_or(false);
+	_ffmpeg_keyframe_index = f.optional_bool_child("FFmpegKeyframeIndex").get_value_or(false);
+	_ffmpeg_hardware_decode = f.optional_string_child("FFmpegHardwareDecode").get_value_or("");
+	_ffmpeg_decode_threads = f.optional_number_child<int>("FFmpegDecodeThreads").get_value_or(8);
+	_kdm_email_connections = f.optional_number_child<int>("KDMEmailConnections").get_value_or(1);
+	_disk_verify_sample_interval = f.optional_number_child<int>("DiskVerifySampleInterval").get_value_or(1);
+	_export_concurrent_reels = f.optional_number_child<int>("ExportConcurrentReels").get_value_or(2);
+	_dcp_encode_chunks = f.optional_number_child<int>("DCPEncodeChunks").get_value_or(1);
+	_reuse_previous_frames = f.optional_bool_child("ReusePreviousFrames").get_value_or(true);
+	_resampler_quality = read_resampler_quality(f.optional_string_child("ResamplerQuality"), ResamplerQuality::BEST);
+	_preview_resampler_quality = read_resampler_quality(f.optional_string_child("PreviewResamplerQuality"), ResamplerQuality::LINEAR);
+	_image_read_ahead = f.optional_number_child<int>("ImageReadAhead").get_value_or(256);
+	_ffmpeg_filter_threads = f.optional_number_child<int>("FFmpegFilterThreads").get_value_or(4);
+	_tms_connections = f.optional_number_child<int>("TMSConnections").get_value_or(4);
+	_tms_resume = f.optional_bool_child("TMSResume").get_value_or(true);
+	_numa_aware_encoding = f.optional_bool_child("NUMAAwareEncoding").get_value_or(false);
+	_shared_frame_cache = f.optional_string_child("SharedFrameCache");
+	_reduce_preview_ffmpeg_decode = f.optional_bool_child("ReducePreviewFFmpegDecode").get_value_or(false);
+	_preview_frame_cache_size = f.optional_number_child<int>("PreviewFrameCacheSize").get_value_or(256);
+	_encode_server_coordinator = f.optional_string_child("EncodeServerCoordinator").get_value_or("");
+	_encode_server_coordinator_priority = f.optional_number_child<int>("EncodeServerCoordinatorPriority").get_value_or(1);
+	_content_read_buffer_size = f.optional_number_child<int>("ContentReadBufferSize").get_value_or(256);
+	_content_read_ahead = f.optional_number_child<int>("ContentReadAhead").get_value_or(32);
+	_image_huge_pages = f.optional_bool_child("ImageHugePages").get_value_or(false);
+	_ffmpeg_examine_subtitles = f.optional_bool_child("FFmpegExamineSubtitles").get_value_or(false);
+	_ui_watchdog = f.optional_bool_child("UIWatchdog").get_value_or(false);
+	_ui_watchdog_threshold = f.optional_number_child<int>("UIWatchdogThreshold").get_value_or(500);
+	_kdm_cache = f.optional_bool_child("KDMCache").get_value_or(false);
+	_preallocate_video_assets = f.optional_bool_child("PreallocateVideoAssets").get_value_or(true);
 
 	_export.read(f.optional_node_child("Export"));
 }
@@ -1101,6 +1224,8 @@ Config::write_config () const
 	root->add_child("EmailKDMs")->add_child_text(_email_kdms ? "1" : "0");
 	root->add_child("DefaultKDMType")->add_child_text(dcp::formulation_to_string(_default_kdm_type));
 	root->add_child("AutoCropThreshold")->add_child_text(raw_convert<string>(_auto_crop_threshold));
+	/* [XML] AutoCropSamples Number of frames to look at when guessing a crop; 1 to use just the one under the playhead */
+	root->add_child("AutoCropSamples")->add_child_text(raw_convert<string>(_auto_crop_samples));
 	if (_last_release_notes_version) {
 		root->add_child("LastReleaseNotesVersion")->add_child_text(*_last_release_notes_version);
 	}
@@ -1119,6 +1244,90 @@ Config::write_config () const
 	root->add_child("AllowSMPTEBv20")->add_child_text(_allow_smpte_bv20 ? "1" : "0");
 	/* [XML] ISDCFNamePartLength Maximum length of the "name" part of an ISDCF name, which should be 14 according to the standard */
 	root->add_child("ISDCFNamePartLength")->add_child_text(raw_convert<string>(_isdcf_name_part_length));
+	/* [XML] AdaptiveEncodingQueue 1 to size the queue of frames waiting to be encoded according to the measured speed of each encoding thread and server, 0 to use a fixed size */
+	root->add_child("AdaptiveEncodingQueue")->add_child_text(_adaptive_encoding_queue ? "1" : "0");
+	/* [XML] ExternalJ2KEncoderCommand Command to run an external JPEG2000 encoder (such as a GPU-based one) for each frame, or empty to use only the built-in encoder */
+	root->add_child("ExternalJ2KEncoderCommand")->add_child_text(_external_j2k_encoder_command);
+	/* [XML] ExternalJ2KEncoderThreads Number of threads to run the external JPEG2000 encoder in */
+	root->add_child("ExternalJ2KEncoderThreads")->add_child_text(raw_convert<string>(_external_j2k_encoder_threads));
+	/* [XML] ImageBufferPoolSize Maximum size in megabytes of image buffers to keep for re-use. */
+	root->add_child("ImageBufferPoolSize")->add_child_text(raw_convert<string>(_image_buffer_pool_size));
+	/* [XML] WriterMemoryLimit Memory, in megabytes, that the writer may use to hold encoded frames which it cannot yet write. */
+	root->add_child("WriterMemoryLimit")->add_child_text(raw_convert<string>(_writer_memory_limit));
+	/* [XML] DCPReadAhead Megabytes of picture data to read ahead when decoding a DCP, or 0 for none. */
+	root->add_child("DCPReadAhead")->add_child_text(raw_convert<string>(_dcp_read_ahead));
+	/* [XML] J2KDecodeThreads Number of threads that OpenJPEG should use to decode each J2K frame in the player, or 0 to decide automatically. */
+	root->add_child("J2KDecodeThreads")->add_child_text(raw_convert<string>(_j2k_decode_threads));
+	/* [XML] AdaptiveDecodeReduction 1 to have the player reduce its decode resolution automatically when it is dropping frames, and restore it when it catches up, otherwise 0. */
+	root->add_child("AdaptiveDecodeReduction")->add_child_text(_adaptive_decode_reduction ? "1" : "0");
+	/* [XML] PlayerMemoryLimit Maximum memory in MB that the player should use for its read-ahead buffers, or 0 for no limit. */
+	root->add_child("PlayerMemoryLimit")->add_child_text(raw_convert<string>(_player_memory_limit));
+	/* [XML] ParallelAudioAnalysis 1 to split audio analysis into parts which are analysed in parallel, otherwise 0.  Integrated loudness is then approximate and loudness range is not measured. */
+	root->add_child("ParallelAudioAnalysis")->add_child_text(_parallel_audio_analysis ? "1" : "0");
+	/* [XML] ParallelExamineJobs Maximum number of jobs which examine content to run at the same time */
+	root->add_child("ParallelExamineJobs")->add_child_text(raw_convert<string>(_parallel_examine_jobs));
+	/* [XML] FFmpegTrustContainerIndex 1 to take the lengths of FFmpeg content from its container index (checked against the end of the file) rather than scanning it, otherwise 0 */
+	root->add_child("FFmpegTrustContainerIndex")->add_child_text(_ffmpeg_trust_container_index ? "1" : "0");
+	/* [XML] PlayerDecodeAhead <code>1</code> to decode each piece of content in a film on its own thread while playing, <code>0</code> to decode everything on the player thread. */
+	root->add_child("PlayerDecodeAhead")->add_child_text(_player_decode_ahead ? "1" : "0");
+	/* [XML] FFmpegKeyframeIndex 1 to build an index of the video keyframes in FFmpeg content when examining it, so that seeks can go straight to the right keyframe, otherwise 0 */
+	root->add_child("FFmpegKeyframeIndex")->add_child_text(_ffmpeg_keyframe_index ? "1" : "0");
+	/* [XML] FFmpegHardwareDecode Name of the FFmpeg hardware device type (for example <code>vaapi</code>, <code>cuda</code>, <code>videotoolbox</code> or <code>d3d11va</code>) to use to decode video, or empty to decode in software. */
+	root->add_child("FFmpegHardwareDecode")->add_child_text(_ffmpeg_hardware_decode);
+	/* [XML] FFmpegDecodeThreads Number of threads that FFmpeg may use to decode video; when several pieces of FFmpeg content are playing at the same time they share this number between them. */
+	root->add_child("FFmpegDecodeThreads")->add_child_text(raw_convert<string>(_ffmpeg_decode_threads));
+	/* [XML] KDMEmailConnections Number of connections to the mail server to use at the same time when emailing KDMs. */
+	root->add_child("KDMEmailConnections")->add_child_text(raw_convert<string>(_kdm_email_connections));
+	/* [XML] DiskVerifySampleInterval Interval between blocks which are read back to verify a drive written by the disk writer; 1 to verify every block. */
+	root->add_child("DiskVerifySampleInterval")->add_child_text(raw_convert<string>(_disk_verify_sample_interval));
+	/* [XML] ExportConcurrentReels Maximum number of reels to export at the same time when splitting an export into one file per reel. */
+	root->add_child("ExportConcurrentReels")->add_child_text(raw_convert<string>(_export_concurrent_reels));
+	/* [XML] DCPEncodeChunks Number of parts of the timeline to decode at the same time, each with its own player, when making a DCP; 1 to use a single player. */
+	root->add_child("DCPEncodeChunks")->add_child_text(raw_convert<string>(_dcp_encode_chunks));
+	/* [XML] ReusePreviousFrames 1 to copy the J2K of frames which are unchanged since an earlier DCP encode of the same film from that earlier video asset, rather than encoding them again. */
+	root->add_child("ReusePreviousFrames")->add_child_text(_reuse_previous_frames ? "1" : "0");
+	/* [XML] ResamplerQuality Quality of audio resampling when making DCPs: <code>best</code>, <code>medium</code>, <code>fastest</code> or <code>linear</code>. */
+	root->add_child("ResamplerQuality")->add_child_text(resampler_quality_to_string(_resampler_quality));
+	/* [XML] PreviewResamplerQuality Quality of audio resampling for previews and analysis: <code>best</code>, <code>medium</code>, <code>fastest</code> or <code>linear</code>. */
+	root->add_child("PreviewResamplerQuality")->add_child_text(resampler_quality_to_string(_preview_resampler_quality));
+	/* [XML] ImageReadAhead Megabytes of image data to read ahead of the decode position when decoding image sequences; 0 to disable. */
+	root->add_child("ImageReadAhead")->add_child_text(raw_convert<string>(_image_read_ahead));
+	/* [XML] FFmpegFilterThreads Number of threads that each FFmpeg filter graph (for example a deinterlacer) may use to process video. */
+	root->add_child("FFmpegFilterThreads")->add_child_text(raw_convert<string>(_ffmpeg_filter_threads));
+	/* [XML] TMSConnections Number of files to upload to the TMS at the same time, where the protocol allows it. */
+	root->add_child("TMSConnections")->add_child_text(raw_convert<string>(_tms_connections));
+	/* [XML] TMSResume True to skip large files which are already on the TMS with the right size, and to carry on with those which were only partly sent. */
+	root->add_child("TMSResume")->add_child_text(_tms_resume ? "1" : "0");
+	/* [XML] NUMAAwareEncoding 1 to spread encoding threads across NUMA nodes and keep each thread on the CPUs of one node, otherwise 0. */
+	root->add_child("NUMAAwareEncoding")->add_child_text(_numa_aware_encoding ? "1" : "0");
+	if (_shared_frame_cache) {
+		/* [XML] SharedFrameCache Directory on shared storage where encoded J2K frames are kept, so that other films and machines can re-use them. */
+		root->add_child("SharedFrameCache")->add_child_text(_shared_frame_cache->string());
+	}
+	/* [XML] ReducePreviewFFmpegDecode 1 to decode FFmpeg video at reduced resolution (and quality) when it is shown small in the preview, 0 to decode it at full resolution. */
+	root->add_child("ReducePreviewFFmpegDecode")->add_child_text(_reduce_preview_ffmpeg_decode ? "1" : "0");
+	/* [XML] PreviewFrameCacheSize Memory in megabytes to use for keeping frames either side of the preview playhead, so that stepping and short scrubs do not need to seek. */
+	root->add_child("PreviewFrameCacheSize")->add_child_text(raw_convert<string>(_preview_frame_cache_size));
+	/* [XML] EncodeServerCoordinator Host name or IP address of an encode server coordinator to ask for servers, or empty to find servers ourselves. */
+	root->add_child("EncodeServerCoordinator")->add_child_text(_encode_server_coordinator);
+	/* [XML] EncodeServerCoordinatorPriority Priority (1 or more) to ask an encode server coordinator for; masters get a share of the servers in proportion to their priority. */
+	root->add_child("EncodeServerCoordinatorPriority")->add_child_text(raw_convert<string>(_encode_server_coordinator_priority));
+	/* [XML] ContentReadBufferSize Size of the buffer, in KB, used when reading content files with FFmpeg. */
+	root->add_child("ContentReadBufferSize")->add_child_text(raw_convert<string>(_content_read_buffer_size));
+	/* [XML] ContentReadAhead Amount of a content file, in MB, that the OS should be asked to read ahead of the current position; 0 to disable. */
+	root->add_child("ContentReadAhead")->add_child_text(raw_convert<string>(_content_read_ahead));
+	/* [XML] ImageHugePages 1 to allocate large image buffers from huge pages where possible (currently only on Linux). */
+	root->add_child("ImageHugePages")->add_child_text(_image_huge_pages ? "1" : "0");
+	/* [XML] FFmpegExamineSubtitles 1 to find the colours of bitmap subtitles in FFmpeg content while examining it, reading the whole file once, rather than when the subtitle appearance dialog is first opened, otherwise 0 */
+	root->add_child("FFmpegExamineSubtitles")->add_child_text(_ffmpeg_examine_subtitles ? "1" : "0");
+	/* [XML] UIWatchdog 1 to measure the latency of the GUI event loop and log details of any stalls, otherwise 0 */
+	root->add_child("UIWatchdog")->add_child_text(_ui_watchdog ? "1" : "0");
+	/* [XML] UIWatchdogThreshold Time in milliseconds for which the GUI must be blocked before the watchdog logs a stall */
+	root->add_child("UIWatchdogThreshold")->add_child_text(raw_convert<string>(_ui_watchdog_threshold));
+	/* [XML] KDMCache 1 to keep KDMs that are made, and use them again when the same KDM is asked for, or 0 to make every KDM afresh */
+	root->add_child("KDMCache")->add_child_text(_kdm_cache ? "1" : "0");
+	/* [XML] PreallocateVideoAssets 1 to reserve disk space for picture assets before writing them, so that they are not fragmented, or 0 to let them grow as they are written */
+	root->add_child("PreallocateVideoAssets")->add_child_text(_preallocate_video_assets ? "1" : "0");
 
 	_export.write(root->add_child("Export"));
 
@@ -1219,6 +1428,9 @@ Config::drop ()
 void
 Config::changed (Property what)
 {
+	if (what == CINEMAS) {
+		_cinema_index = boost::none;
+	}
 	Changed (what);
 }
 
@@ -1353,6 +1565,35 @@ Config::read_cinemas (cxml::Document const & f)
 		cinema->read_screens (i);
 		_cinemas.push_back (cinema);
 	}
+	_cinema_index = boost::none;
+}
+
+
+/** @return The first cinema whose name, or one of whose email addresses, is name_or_email,
+ *  or nullptr if there is no such cinema.
+ */
+shared_ptr<Cinema>
+Config::cinema_by_name_or_email (string const& name_or_email) const
+{
+	if (!_cinema_index) {
+		_cinema_index = std::map<string, shared_ptr<Cinema>>();
+		for (auto cinema: _cinemas) {
+			/* emplace() won't replace an existing entry, so earlier cinemas win as they would
+			 * with a search through the list.
+			 */
+			_cinema_index->emplace(cinema->name, cinema);
+			for (auto const& email: cinema->emails) {
+				_cinema_index->emplace(email, cinema);
+			}
+		}
+	}
+
+	auto iter = _cinema_index->find(name_or_email);
+	if (iter == _cinema_index->end()) {
+		return {};
+	}
+
+	return iter->second;
 }
 
 void
@@ -81,6 +81,7 @@ public:
 
 	enum Property {
 		USE_ANY_SERVERS,
+		ENCODE_SERVER_COORDINATOR,
 		SERVERS,
 		CINEMAS,
 		DKDM_RECIPIENTS,
@@ -93,6 +94,7 @@ public:
 		SHOW_EXPERIMENTAL_AUDIO_PROCESSORS,
 		AUDIO_MAPPING,
 		AUTO_CROP_THRESHOLD,
+		AUTO_CROP_SAMPLES,
 		ALLOW_SMPTE_BV20,
 		ISDCF_NAME_PART_LENGTH,
 		OTHER
@@ -159,6 +161,8 @@ public:
 		return _cinemas;
 	}
 
+	std::shared_ptr<Cinema> cinema_by_name_or_email (std::string const& name_or_email) const;
+
 	std::list<std::shared_ptr<DKDMRecipient>> dkdm_recipients () const {
 		return _dkdm_recipients;
 	}
@@ -593,6 +597,13 @@ public:
 		return _auto_crop_threshold;
 	}
 
+	/** @return number of frames to look at, spread across the content, when guessing a crop;
+	 *  1 means to look only at the frame under the playhead.
+	 */
+	int auto_crop_samples () const {
+		return _auto_crop_samples;
+	}
+
 	boost::optional<std::string> last_release_notes_version () const {
 		return _last_release_notes_version;
 	}
@@ -622,6 +633,208 @@ public:
 		return _isdcf_name_part_length;
 	}
 
+	/** true to size J2KEncoder's queue from the observed latency of its workers, rather than just the number of threads */
+	bool adaptive_encoding_queue() const {
+		return _adaptive_encoding_queue;
+	}
+
+	/** command to run an external (e.g. GPU) JPEG2000 encoder, or empty */
+	std::string external_j2k_encoder_command() const {
+		return _external_j2k_encoder_command;
+	}
+
+	/** number of threads which should use the external JPEG2000 encoder */
+	int external_j2k_encoder_threads() const {
+		return _external_j2k_encoder_threads;
+	}
+
+	/** Maximum size, in megabytes, of unused image buffers to keep for re-use */
+	int image_buffer_pool_size() const {
+		return _image_buffer_pool_size;
+	}
+
+	/** Memory, in megabytes, that the writer may use to hold encoded frames which arrive out of order */
+	int writer_memory_limit() const {
+		return _writer_memory_limit;
+	}
+
+	/** Megabytes of picture data to read ahead of the decode position when decoding DCPs; 0 to disable */
+	int dcp_read_ahead() const {
+		return _dcp_read_ahead;
+	}
+
+	/** number of threads to use to decode each J2K frame, or 0 to choose automatically */
+	int j2k_decode_threads() const {
+		return _j2k_decode_threads;
+	}
+
+	/** true if the player should lower its decode resolution automatically when it is dropping frames */
+	bool adaptive_decode_reduction() const {
+		return _adaptive_decode_reduction;
+	}
+
+	/** maximum memory in MB for the player's read-ahead buffers, or 0 for no limit */
+	int player_memory_limit() const {
+		return _player_memory_limit;
+	}
+
+	/** true to analyse audio in several parts at once */
+	bool parallel_audio_analysis() const {
+		return _parallel_audio_analysis;
+	}
+
+	/** maximum number of content examination jobs that can run at the same time */
+	int parallel_examine_jobs() const {
+		return _parallel_examine_jobs;
+	}
+
+	/** true to take the lengths of FFmpeg content from its container index where it looks reliable, rather than reading through the file */
+	bool ffmpeg_trust_container_index() const {
+		return _ffmpeg_trust_container_index;
+	}
+
+	/** true to decode each piece of content in the player on its own thread, ahead of when it is needed */
+	bool player_decode_ahead() const {
+		return _player_decode_ahead;
+	}
+
+	/** true to build an index of video keyframes when examining FFmpeg content */
+	bool ffmpeg_keyframe_index() const {
+		return _ffmpeg_keyframe_index;
+	}
+
+	/** FFmpeg hardware device type to decode video with (e.g. vaapi, cuda, videotoolbox, d3d11va), or empty to decode in software */
+	std::string ffmpeg_hardware_decode() const {
+		return _ffmpeg_hardware_decode;
+	}
+
+	/** Number of threads that FFmpeg may use to decode video, shared between pieces of content that play at the same time */
+	int ffmpeg_decode_threads() const {
+		return _ffmpeg_decode_threads;
+	}
+
+	/** Number of SMTP connections to use at the same time when emailing KDMs */
+	int kdm_email_connections() const {
+		return _kdm_email_connections;
+	}
+
+	/** @return interval between the 16MB blocks that are read back when verifying a drive that has been written; 1 means verify all of it */
+	int disk_verify_sample_interval() const {
+		return _disk_verify_sample_interval;
+	}
+
+	/** Maximum number of reels to export at the same time when they are going to separate files */
+	int export_concurrent_reels() const {
+		return _export_concurrent_reels;
+	}
+
+	/** Number of parts of the timeline to decode in parallel, each with its own player, when making a DCP */
+	int dcp_encode_chunks() const {
+		return _dcp_encode_chunks;
+	}
+
+	/** true to copy unchanged frames from earlier encodes of a film rather than encoding them again */
+	bool reuse_previous_frames() const {
+		return _reuse_previous_frames;
+	}
+
+	/** Quality of resampling used when making DCPs */
+	ResamplerQuality resampler_quality() const {
+		return _resampler_quality;
+	}
+
+	/** Quality of resampling used for previews and analysis */
+	ResamplerQuality preview_resampler_quality() const {
+		return _preview_resampler_quality;
+	}
+
+	/** Megabytes of image data to read ahead of the decode position when decoding image sequences; 0 to disable */
+	int image_read_ahead() const {
+		return _image_read_ahead;
+	}
+
+	int ffmpeg_filter_threads() const {
+		return _ffmpeg_filter_threads;
+	}
+
+	int tms_connections() const {
+		return _tms_connections;
+	}
+
+	bool tms_resume() const {
+		return _tms_resume;
+	}
+
+	/** true to restrict each encoding thread to the CPUs of one NUMA node */
+	bool numa_aware_encoding() const {
+		return _numa_aware_encoding;
+	}
+
+	/** directory where encoded frames are shared with other films and machines, if any */
+	boost::optional<boost::filesystem::path> shared_frame_cache() const {
+		return _shared_frame_cache;
+	}
+
+	/** true to decode FFmpeg video at reduced resolution when the preview will scale it down anyway */
+	bool reduce_preview_ffmpeg_decode() const {
+		return _reduce_preview_ffmpeg_decode;
+	}
+
+	/** memory in MB to use for caching frames around the preview playhead */
+	int preview_frame_cache_size() const {
+		return _preview_frame_cache_size;
+	}
+
+	/** host name or IP address of an encode server coordinator to get servers from, or empty to find servers ourselves */
+	std::string encode_server_coordinator() const {
+		return _encode_server_coordinator;
+	}
+
+	/** priority to ask an encode server coordinator for; a higher priority gets a larger share of the servers */
+	int encode_server_coordinator_priority() const {
+		return _encode_server_coordinator_priority;
+	}
+
+	/** Size of the buffer, in KB, used when reading content files with FFmpeg */
+	int content_read_buffer_size() const {
+		return _content_read_buffer_size;
+	}
+
+	/** Amount of a content file, in MB, that the OS should be asked to read ahead of where we are reading, or 0 */
+	int content_read_ahead() const {
+		return _content_read_ahead;
+	}
+
+	/** true to allocate large image buffers from huge pages where possible */
+	bool image_huge_pages() const {
+		return _image_huge_pages;
+	}
+
+	/** true to find the colours of FFmpeg content's bitmap subtitles while examining it */
+	bool ffmpeg_examine_subtitles() const {
+		return _ffmpeg_examine_subtitles;
+	}
+
+	/** true to measure GUI event loop latency and log stalls */
+	bool ui_watchdog() const {
+		return _ui_watchdog;
+	}
+
+	/** time in milliseconds for which the GUI must be blocked before a stall is logged */
+	int ui_watchdog_threshold() const {
+		return _ui_watchdog_threshold;
+	}
+
+	/** true to keep KDMs that are made, and use them again when an identical KDM is asked for */
+	bool kdm_cache() const {
+		return _kdm_cache;
+	}
+
+	/** true to reserve disk space for picture assets before they are written */
+	bool preallocate_video_assets() const {
+		return _preallocate_video_assets;
+	}
+
 	/* SET (mostly) */
 
 	void set_master_encoding_threads (int n) {
@@ -1171,6 +1384,10 @@ public:
 		maybe_set (_auto_crop_threshold, threshold, AUTO_CROP_THRESHOLD);
 	}
 
+	void set_auto_crop_samples (int samples) {
+		maybe_set (_auto_crop_samples, samples, AUTO_CROP_SAMPLES);
+	}
+
 	void set_last_release_notes_version (std::string version) {
 		maybe_set (_last_release_notes_version, version);
 	}
@@ -1203,6 +1420,178 @@ public:
 		maybe_set(_isdcf_name_part_length, length, ISDCF_NAME_PART_LENGTH);
 	}
 
+	void set_adaptive_encoding_queue(bool b) {
+		maybe_set(_adaptive_encoding_queue, b);
+	}
+
+	void set_external_j2k_encoder_command(std::string s) {
+		maybe_set(_external_j2k_encoder_command, s);
+	}
+
+	void set_external_j2k_encoder_threads(int n) {
+		maybe_set(_external_j2k_encoder_threads, n);
+	}
+
+	void set_image_buffer_pool_size(int n) {
+		maybe_set(_image_buffer_pool_size, n);
+	}
+
+	void set_writer_memory_limit(int n) {
+		maybe_set(_writer_memory_limit, n);
+	}
+
+	void set_dcp_read_ahead(int n) {
+		maybe_set(_dcp_read_ahead, n);
+	}
+
+	void set_j2k_decode_threads(int n) {
+		maybe_set(_j2k_decode_threads, n);
+	}
+
+	void set_adaptive_decode_reduction(bool b) {
+		maybe_set(_adaptive_decode_reduction, b);
+	}
+
+	void set_player_memory_limit(int n) {
+		maybe_set(_player_memory_limit, n);
+	}
+
+	void set_parallel_audio_analysis(bool b) {
+		maybe_set(_parallel_audio_analysis, b);
+	}
+
+	void set_parallel_examine_jobs(int n) {
+		maybe_set(_parallel_examine_jobs, n);
+	}
+
+	void set_ffmpeg_trust_container_index(bool b) {
+		maybe_set(_ffmpeg_trust_container_index, b);
+	}
+
+	void set_player_decode_ahead(bool b) {
+		maybe_set(_player_decode_ahead, b);
+	}
+
+	void set_ffmpeg_keyframe_index(bool b) {
+		maybe_set(_ffmpeg_keyframe_index, b);
+	}
+
+	void set_ffmpeg_hardware_decode(std::string s) {
+		maybe_set(_ffmpeg_hardware_decode, s);
+	}
+
+	void set_ffmpeg_decode_threads(int n) {
+		maybe_set(_ffmpeg_decode_threads, n);
+	}
+
+	void set_kdm_email_connections(int n) {
+		maybe_set(_kdm_email_connections, n);
+	}
+
+	void set_disk_verify_sample_interval(int n) {
+		maybe_set(_disk_verify_sample_interval, n);
+	}
+
+	void set_export_concurrent_reels(int n) {
+		maybe_set(_export_concurrent_reels, n);
+	}
+
+	void set_dcp_encode_chunks(int n) {
+		maybe_set(_dcp_encode_chunks, n);
+	}
+
+	void set_reuse_previous_frames(bool b) {
+		maybe_set(_reuse_previous_frames, b);
+	}
+
+	void set_resampler_quality(ResamplerQuality q) {
+		maybe_set(_resampler_quality, q);
+	}
+
+	void set_preview_resampler_quality(ResamplerQuality q) {
+		maybe_set(_preview_resampler_quality, q);
+	}
+
+	void set_image_read_ahead(int n) {
+		maybe_set(_image_read_ahead, n);
+	}
+
+	void set_ffmpeg_filter_threads(int n) {
+		maybe_set(_ffmpeg_filter_threads, n);
+	}
+
+	void set_tms_connections(int n) {
+		maybe_set(_tms_connections, n);
+	}
+
+	void set_tms_resume(bool b) {
+		maybe_set(_tms_resume, b);
+	}
+
+	void set_numa_aware_encoding(bool b) {
+		maybe_set(_numa_aware_encoding, b);
+	}
+
+	void set_shared_frame_cache(boost::filesystem::path p) {
+		maybe_set(_shared_frame_cache, p);
+	}
+
+	void unset_shared_frame_cache() {
+		if (!_shared_frame_cache) {
+			return;
+		}
+		_shared_frame_cache = boost::none;
+		changed ();
+	}
+
+	void set_reduce_preview_ffmpeg_decode(bool b) {
+		maybe_set(_reduce_preview_ffmpeg_decode, b);
+	}
+
+	void set_preview_frame_cache_size(int n) {
+		maybe_set(_preview_frame_cache_size, n);
+	}
+
+	void set_encode_server_coordinator(std::string s) {
+		maybe_set(_encode_server_coordinator, s, ENCODE_SERVER_COORDINATOR);
+	}
+
+	void set_encode_server_coordinator_priority(int n) {
+		maybe_set(_encode_server_coordinator_priority, n);
+	}
+
+	void set_content_read_buffer_size(int n) {
+		maybe_set(_content_read_buffer_size, n);
+	}
+
+	void set_content_read_ahead(int n) {
+		maybe_set(_content_read_ahead, n);
+	}
+
+	void set_image_huge_pages(bool b) {
+		maybe_set(_image_huge_pages, b);
+	}
+
+	void set_ffmpeg_examine_subtitles(bool b) {
+		maybe_set(_ffmpeg_examine_subtitles, b);
+	}
+
+	void set_ui_watchdog(bool b) {
+		maybe_set(_ui_watchdog, b);
+	}
+
+	void set_ui_watchdog_threshold(int n) {
+		maybe_set(_ui_watchdog_threshold, n);
+	}
+
+	void set_kdm_cache(bool b) {
+		maybe_set(_kdm_cache, b);
+	}
+
+	void set_preallocate_video_assets(bool b) {
+		maybe_set(_preallocate_video_assets, b);
+	}
+
 	void changed (Property p = OTHER);
 	boost::signals2::signal<void (Property)> Changed;
 	/** Emitted if read() failed on an existing Config file.  There is nothing
@@ -1350,6 +1739,10 @@ private:
 	boost::optional<boost::filesystem::path> _default_kdm_directory;
 	bool _upload_after_make_dcp;
 	std::list<std::shared_ptr<Cinema>> _cinemas;
+	/** Index of _cinemas by name and email address, built when it is first needed
+	 *  and discarded whenever the cinemas change.
+	 */
+	mutable boost::optional<std::map<std::string, std::shared_ptr<Cinema>>> _cinema_index;
 	std::list<std::shared_ptr<DKDMRecipient>> _dkdm_recipients;
 	std::string _mail_server;
 	int _mail_port;
@@ -1436,12 +1829,54 @@ private:
 	dcp::Formulation _default_kdm_type;
 	RoughDuration _default_kdm_duration;
 	double _auto_crop_threshold;
+	int _auto_crop_samples;
 	boost::optional<std::string> _last_release_notes_version;
 	boost::optional<int> _main_divider_sash_position;
 	boost::optional<int> _main_content_divider_sash_position;
 	DefaultAddFileLocation _default_add_file_location;
 	bool _allow_smpte_bv20;
 	int _isdcf_name_part_length;
+	bool _adaptive_encoding_queue;
+	std::string _external_j2k_encoder_command;
+	int _external_j2k_encoder_threads;
+	int _image_buffer_pool_size;
+	int _writer_memory_limit;
+	int _dcp_read_ahead;
+	int _j2k_decode_threads;
+	bool _adaptive_decode_reduction;
+	int _player_memory_limit;
+	bool _parallel_audio_analysis;
+	int _parallel_examine_jobs;
+	bool _ffmpeg_trust_container_index;
+	bool _player_decode_ahead;
+	bool _ffmpeg_keyframe_index;
+	std::string _ffmpeg_hardware_decode;
+	int _ffmpeg_decode_threads;
+	int _kdm_email_connections;
+	int _disk_verify_sample_interval;
+	int _export_concurrent_reels;
+	int _dcp_encode_chunks;
+	bool _reuse_previous_frames;
+	ResamplerQuality _resampler_quality;
+	ResamplerQuality _preview_resampler_quality;
+	int _image_read_ahead;
+	int _ffmpeg_filter_threads;
+	int _tms_connections;
+	bool _tms_resume;
+	bool _numa_aware_encoding;
+	boost::optional<boost::filesystem::path> _shared_frame_cache;
+	bool _reduce_preview_ffmpeg_decode;
+	int _preview_frame_cache_size;
+	std::string _encode_server_coordinator;
+	int _encode_server_coordinator_priority;
+	int _content_read_buffer_size;
+	int _content_read_ahead;
+	bool _image_huge_pages;
+	bool _ffmpeg_examine_subtitles;
+	bool _ui_watchdog;
+	int _ui_watchdog_threshold;
+	bool _kdm_cache;
+	bool _preallocate_video_assets;
 
 	ExportConfig _export;
 
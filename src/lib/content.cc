@@ -39,6 +39,7 @@
 #include <dcp/raw_convert.h>
 #include <libcxml/cxml.h>
 #include <libxml++/libxml++.h>
+#include <boost/atomic.hpp>
 #include <boost/thread/mutex.hpp>
 #include <iostream>
 
@@ -48,6 +49,7 @@
 using std::cout;
 using std::list;
 using std::make_shared;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -86,6 +88,7 @@ Content::Content (boost::filesystem::path p)
 
 Content::Content (cxml::ConstNodePtr node)
 {
+	bool have_digest_stats = true;
 	for (auto i: node->node_children("Path")) {
 		_paths.push_back (i->content());
 		auto const mod = i->optional_number_attribute<time_t>("mtime");
@@ -96,6 +99,16 @@ Content::Content (cxml::ConstNodePtr node)
 			auto last_write = dcp::filesystem::last_write_time(i->content(), ec);
 			_last_write_times.push_back (ec ? 0 : last_write);
 		}
+		auto const digest_mtime = i->optional_number_attribute<time_t>("digest_mtime");
+		auto const digest_size = i->optional_number_attribute<uintmax_t>("digest_size");
+		if (digest_mtime && digest_size) {
+			_digest_stats.push_back ({*digest_mtime, *digest_size});
+		} else {
+			have_digest_stats = false;
+		}
+	}
+	if (!have_digest_stats) {
+		_digest_stats.clear ();
 	}
 	_digest = node->optional_string_child ("Digest").get_value_or ("X");
 	_position = DCPTime (node->number_child<DCPTime::Type> ("Position"));
@@ -136,6 +149,8 @@ Content::Content (vector<shared_ptr<Content>> c)
 			_last_write_times.push_back (c[i]->_last_write_times[j]);
 		}
 	}
+
+	/* We don't have a digest for the joined content yet, so these will be filled in by examine() */
 }
 
 
@@ -145,10 +160,15 @@ Content::as_xml (xmlpp::Node* node, bool with_paths) const
 	boost::mutex::scoped_lock lm (_mutex);
 
 	if (with_paths) {
+		bool const digest_stats = _digest_stats.size() == _paths.size();
 		for (size_t i = 0; i < _paths.size(); ++i) {
 			auto p = node->add_child("Path");
 			p->add_child_text (_paths[i].string());
 			p->set_attribute ("mtime", raw_convert<string>(_last_write_times[i]));
+			if (digest_stats) {
+				p->set_attribute ("digest_mtime", raw_convert<string>(_digest_stats[i].first));
+				p->set_attribute ("digest_size", raw_convert<string>(_digest_stats[i].second));
+			}
 		}
 	}
 	node->add_child("Digest")->add_child_text(_digest);
@@ -181,15 +201,35 @@ Content::examine (shared_ptr<const Film>, shared_ptr<Job> job)
 
 	auto const d = calculate_digest ();
 
+	auto const stats = stat_paths ();
+	vector<std::time_t> last_write_times;
+	for (auto const& i: stats) {
+		last_write_times.push_back (i.first);
+	}
+
 	boost::mutex::scoped_lock lm (_mutex);
 	_digest = d;
+	_last_write_times = last_write_times;
+	_digest_stats = stats;
+}
 
-	_last_write_times.clear ();
-	for (auto i: _paths) {
+
+/** @return Modification time and size of each of our paths (0 for either if it can't be found),
+ *  looked at on several threads if there are a lot of them.
+ */
+vector<pair<std::time_t, uintmax_t>>
+Content::stat_paths () const
+{
+	auto const paths = this->paths();
+	vector<pair<std::time_t, uintmax_t>> stats(paths.size());
+	parallel_for (paths.size(), [&paths, &stats](size_t i) {
 		boost::system::error_code ec;
-		auto last_write = dcp::filesystem::last_write_time(i, ec);
-		_last_write_times.push_back (ec ? 0 : last_write);
-	}
+		auto const last_write = dcp::filesystem::last_write_time(paths[i], ec);
+		stats[i].first = ec ? 0 : last_write;
+		auto const size = dcp::filesystem::file_size(paths[i], ec);
+		stats[i].second = ec ? 0 : size;
+	});
+	return stats;
 }
 
 
@@ -356,6 +396,7 @@ Content::set_paths (vector<boost::filesystem::path> paths)
 	{
 		boost::mutex::scoped_lock lm (_mutex);
 		_paths = paths;
+		_digest_stats.clear ();
 		_last_write_times.clear ();
 		for (auto i: _paths) {
 			boost::system::error_code ec;
@@ -551,6 +592,7 @@ Content::add_path (boost::filesystem::path p)
 {
 	boost::mutex::scoped_lock lm (_mutex);
 	_paths.push_back (p);
+	_digest_stats.clear ();
 	boost::system::error_code ec;
 	auto last_write = dcp::filesystem::last_write_time(p, ec);
 	_last_write_times.push_back (ec ? 0 : last_write);
@@ -560,13 +602,21 @@ Content::add_path (boost::filesystem::path p)
 bool
 Content::changed () const
 {
-	bool write_time_changed = false;
-	for (auto i = 0U; i < _paths.size(); ++i) {
-		if (dcp::filesystem::last_write_time(_paths[i]) != last_write_time(i)) {
-			write_time_changed = true;
-			break;
+	auto const stats = stat_paths ();
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		for (size_t i = 0; i < stats.size(); ++i) {
+			if (i >= _last_write_times.size() || stats[i].first != _last_write_times[i]) {
+				return true;
+			}
+		}
+
+		if (!stats.empty() && stats == _digest_stats) {
+			/* Nothing has been touched since we calculated our digest */
+			return false;
 		}
 	}
 
-	return (write_time_changed || calculate_digest() != digest());
+	return calculate_digest() != digest();
 }
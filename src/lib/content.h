@@ -237,10 +237,13 @@ private:
 	template<class, class> friend class ChangeSignalDespatcher;
 
 	void signal_change (ChangeType, int);
+	std::vector<std::pair<std::time_t, uintmax_t>> stat_paths () const;
 
 	/** Paths of our data files */
 	std::vector<boost::filesystem::path> _paths;
 	std::vector<std::time_t> _last_write_times;
+	/** Modification time and size of each of _paths when _digest was calculated, or empty if we don't know */
+	std::vector<std::pair<std::time_t, uintmax_t>> _digest_stats;
 
 	std::string _digest;
 	dcpomatic::DCPTime _position;
@@ -257,6 +260,7 @@ private:
 
 typedef ChangeSignaller<Content, int> ContentChangeSignaller;
 typedef ChangeSignalDespatcher<Content, int> ContentChangeSignalDespatcher;
+typedef ChangeSignalDespatcher<Content, int>::Batch ContentChangeSignalBatch;
 
 
 #endif
@@ -0,0 +1,352 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "compose.hpp"
+#include "content.h"
+#include "content_factory.h"
+#include "content_library.h"
+#include "dcp_content.h"
+#include "dcpomatic_log.h"
+#include "film.h"
+#include "job.h"
+#include "state.h"
+#include "util.h"
+#include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
+#include <dcp/warnings.h>
+#include <libcxml/cxml.h>
+LIBDCP_DISABLE_WARNINGS
+#include <libxml++/libxml++.h>
+LIBDCP_ENABLE_WARNINGS
+#include <algorithm>
+
+#include "i18n.h"
+
+
+using std::list;
+using std::make_shared;
+using std::map;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::optional;
+
+
+static string const index_file = "content_library.xml";
+
+
+/** @return A description of the modification times and sizes of the file at path or, if
+ *  path is a directory, of the files at its top level (which is where the ASSETMAP, PKL
+ *  and CPLs of a DCP are).
+ */
+static
+string
+item_key (boost::filesystem::path path)
+{
+	auto stamp = [](boost::filesystem::path file) -> string {
+		boost::system::error_code ec;
+		auto const time = dcp::filesystem::last_write_time(file, ec);
+		auto const size = dcp::filesystem::is_regular_file(file) ? dcp::filesystem::file_size(file, ec) : 0;
+		return String::compose("%1:%2:%3;", file.filename().string(), time, size);
+	};
+
+	if (!dcp::filesystem::is_directory(path)) {
+		return stamp(path);
+	}
+
+	vector<string> stamps;
+	for (auto i: dcp::filesystem::directory_iterator(path)) {
+		if (dcp::filesystem::is_regular_file(i.path())) {
+			stamps.push_back(stamp(i.path()));
+		}
+	}
+
+	std::sort(stamps.begin(), stamps.end());
+
+	string key;
+	for (auto const& i: stamps) {
+		key += i;
+	}
+	return key;
+}
+
+
+ContentLibrary::ContentLibrary ()
+{
+	_thread = boost::thread(boost::bind(&ContentLibrary::thread, this));
+}
+
+
+ContentLibrary::~ContentLibrary ()
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_stop = true;
+	}
+
+	_condition.notify_all ();
+
+	try {
+		_thread.join ();
+	} catch (...) {}
+}
+
+
+/** @return Everything that our index says is in directory, as of the last refresh (possibly
+ *  in a previous run).  This does not look at the directory itself.
+ */
+vector<shared_ptr<Content>>
+ContentLibrary::load (boost::filesystem::path directory)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (!_index_read) {
+		read_index ();
+		_index_read = true;
+	}
+
+	vector<shared_ptr<Content>> content;
+	if (directory == _directory) {
+		for (auto const& i: _entries) {
+			content.push_back(i.second.content);
+		}
+	}
+
+	return content;
+}
+
+
+/** Look at directory in the background, examine anything in it which is new or has changed
+ *  since we last looked, then emit Refreshed.
+ */
+void
+ContentLibrary::refresh (boost::filesystem::path directory, bool report_errors)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	if (_pending && _pending->first == directory) {
+		report_errors = report_errors || _pending->second;
+	}
+	_pending = std::make_pair(directory, report_errors);
+	_condition.notify_all ();
+}
+
+
+void
+ContentLibrary::thread ()
+{
+	start_of_thread ("ContentLibrary");
+
+	while (true) {
+		boost::mutex::scoped_lock lm (_mutex);
+		while (!_stop && !_pending) {
+			_condition.wait (lm);
+		}
+
+		if (_stop) {
+			return;
+		}
+
+		auto const next = *_pending;
+		_pending = boost::none;
+		lm.unlock ();
+
+		try {
+			scan (next.first, next.second);
+		} catch (std::exception& e) {
+			LOG_ERROR ("Could not scan content directory %1 (%2)", next.first.string(), e.what());
+		}
+	}
+}
+
+
+void
+ContentLibrary::scan (boost::filesystem::path directory, bool report_errors)
+{
+	struct Candidate
+	{
+		boost::filesystem::path path;
+		bool dcp;
+		string key;
+		shared_ptr<Content> content;
+		string error;
+	};
+
+	vector<Candidate> candidates;
+	for (auto i: dcp::filesystem::directory_iterator(directory)) {
+		try {
+			if (dcp::filesystem::is_directory(i.path()) && contains_assetmap(i.path())) {
+				candidates.push_back({i.path(), true, item_key(i.path()), {}, {}});
+			} else if (i.path().extension() == ".mp4") {
+				candidates.push_back({i.path(), false, item_key(i.path()), {}, {}});
+			}
+		} catch (boost::filesystem::filesystem_error& e) {
+			/* Never mind */
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](Candidate const& a, Candidate const& b) { return a.path < b.path; });
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (!_index_read) {
+			read_index ();
+			_index_read = true;
+		}
+		if (directory == _directory) {
+			for (auto& candidate: candidates) {
+				auto existing = _entries.find(candidate.path);
+				if (existing != _entries.end() && existing->second.key == candidate.key) {
+					candidate.content = existing->second.content;
+				}
+			}
+		}
+	}
+
+	/* Examine whatever is new or changed, a few at a time */
+	parallel_for_cpu (candidates.size(), [this, &candidates](size_t i) {
+		auto& candidate = candidates[i];
+		if (candidate.content) {
+			return;
+		}
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			if (_stop) {
+				return;
+			}
+		}
+
+		try {
+			shared_ptr<Content> content;
+			if (candidate.dcp) {
+				content = make_shared<DCPContent>(candidate.path);
+			} else {
+				auto all_content = content_factory(candidate.path);
+				if (!all_content.empty()) {
+					content = all_content[0];
+				}
+			}
+
+			if (content) {
+				content->examine (shared_ptr<const Film>(), shared_ptr<Job>());
+				candidate.content = content;
+			}
+		} catch (std::exception& e) {
+			candidate.error = e.what();
+		}
+	});
+
+	map<boost::filesystem::path, Entry> entries;
+	vector<shared_ptr<Content>> content;
+	for (auto const& candidate: candidates) {
+		if (candidate.content) {
+			entries[candidate.path] = { candidate.key, candidate.content };
+			content.push_back(candidate.content);
+		} else if (!candidate.error.empty()) {
+			LOG_WARNING ("Could not examine %1 (%2)", candidate.path.string(), candidate.error);
+			if (report_errors) {
+				emit (boost::bind(boost::ref(Error), String::compose(_("Could not examine %1"), candidate.path.filename().string()), candidate.error));
+			}
+		}
+	}
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (_stop) {
+			return;
+		}
+		_directory = directory;
+		_entries = entries;
+		write_index ();
+	}
+
+	emit (boost::bind(boost::ref(Refreshed), content));
+}
+
+
+/** Read our index file into _directory and _entries.  A lock must be held on _mutex */
+void
+ContentLibrary::read_index ()
+{
+	auto const file = State::read_path(index_file);
+	if (!dcp::filesystem::exists(file)) {
+		return;
+	}
+
+	try {
+		cxml::Document doc("ContentLibrary");
+		doc.read_file(dcp::filesystem::fix_long_path(file));
+
+		if (doc.number_child<int>("Version") != Film::current_state_version) {
+			/* Just examine everything again */
+			return;
+		}
+
+		map<boost::filesystem::path, Entry> entries;
+		for (auto item: doc.node_children("Item")) {
+			list<string> notes;
+			auto content = content_factory(item->node_child("Content"), Film::current_state_version, notes);
+			if (content) {
+				entries[item->string_child("Path")] = { item->string_child("Key"), content };
+			}
+		}
+
+		_directory = doc.string_child("Directory");
+		_entries = entries;
+	} catch (std::exception& e) {
+		LOG_WARNING ("Could not read content library index %1 (%2)", file.string(), e.what());
+	}
+}
+
+
+/** Write _directory and _entries to our index file.  A lock must be held on _mutex */
+void
+ContentLibrary::write_index () const
+{
+	auto const file = State::write_path(index_file);
+	auto const temp = file.string() + "." + boost::filesystem::unique_path().string() + ".tmp";
+
+	try {
+		xmlpp::Document doc;
+		auto root = doc.create_root_node("ContentLibrary");
+		root->add_child("Version")->add_child_text(dcp::raw_convert<string>(Film::current_state_version));
+		root->add_child("Directory")->add_child_text(_directory.string());
+		for (auto const& i: _entries) {
+			auto item = root->add_child("Item");
+			item->add_child("Path")->add_child_text(i.first.string());
+			item->add_child("Key")->add_child_text(i.second.key);
+			i.second.content->as_xml(item->add_child("Content"), true);
+		}
+		doc.write_to_file_formatted(temp);
+
+		boost::system::error_code ec;
+		dcp::filesystem::rename(temp, file, ec);
+		if (ec) {
+			LOG_WARNING ("Could not write content library index %1 (%2)", file.string(), ec.message());
+			dcp::filesystem::remove(temp, ec);
+		}
+	} catch (std::exception& e) {
+		LOG_WARNING ("Could not write content library index %1 (%2)", file.string(), e.what());
+	}
+}
@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_CONTENT_LIBRARY_H
+#define DCPOMATIC_CONTENT_LIBRARY_H
+
+
+#include "signaller.h"
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/signals2.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class Content;
+
+
+/** @class ContentLibrary
+ *  @brief The DCPs and .mp4 files in a directory, examined on a background thread.
+ *
+ *  The results of examination are kept in an index file, keyed on the modification
+ *  times and sizes of each item's top-level files, so that only new or changed items
+ *  need to be examined again.
+ */
+class ContentLibrary : public Signaller
+{
+public:
+	ContentLibrary ();
+	~ContentLibrary ();
+
+	ContentLibrary (ContentLibrary const&) = delete;
+	ContentLibrary& operator= (ContentLibrary const&) = delete;
+
+	std::vector<std::shared_ptr<Content>> load (boost::filesystem::path directory);
+	void refresh (boost::filesystem::path directory, bool report_errors);
+
+	/** Emitted from the UI thread when a refresh has finished, with everything that is now in the directory */
+	boost::signals2::signal<void (std::vector<std::shared_ptr<Content>>)> Refreshed;
+	/** Emitted from the UI thread, with a summary and details, when something could not be examined
+	 *  during a refresh that was asked to report errors.
+	 */
+	boost::signals2::signal<void (std::string, std::string)> Error;
+
+private:
+	struct Entry
+	{
+		/** Description of the state of the item's files when it was examined */
+		std::string key;
+		std::shared_ptr<Content> content;
+	};
+
+	void thread ();
+	void scan (boost::filesystem::path directory, bool report_errors);
+	void read_index ();
+	void write_index () const;
+
+	boost::mutex _mutex;
+	boost::condition _condition;
+	/** Directory that _entries describe */
+	boost::filesystem::path _directory;
+	std::map<boost::filesystem::path, Entry> _entries;
+	bool _index_read = false;
+	/** Directory to scan next, and whether to report errors while doing so */
+	boost::optional<std::pair<boost::filesystem::path, bool>> _pending;
+	bool _stop = false;
+	boost::thread _thread;
+};
+
+
+#endif
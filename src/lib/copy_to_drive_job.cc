@@ -20,7 +20,9 @@
 
 
 #include "compose.hpp"
+#include "config.h"
 #include "copy_to_drive_job.h"
+#include "dcpomatic_assert.h"
 #include "dcpomatic_log.h"
 #include "disk_writer_messages.h"
 #include "exceptions.h"
@@ -40,6 +42,7 @@ using std::cout;
 using std::min;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using boost::optional;
 using dcp::raw_convert;
 
@@ -47,21 +50,38 @@ using dcp::raw_convert;
 CopyToDriveJob::CopyToDriveJob(std::vector<boost::filesystem::path> const& dcps, Drive drive, Nanomsg& nanomsg)
 	: Job (shared_ptr<Film>())
 	, _dcps (dcps)
-	, _drive (drive)
+	, _drives ({drive})
 	, _nanomsg (nanomsg)
 {
 
 }
 
 
+CopyToDriveJob::CopyToDriveJob(std::vector<boost::filesystem::path> const& dcps, vector<Drive> drives, Nanomsg& nanomsg)
+	: Job (shared_ptr<Film>())
+	, _dcps (dcps)
+	, _drives (drives)
+	, _nanomsg (nanomsg)
+{
+	DCPOMATIC_ASSERT (!_drives.empty());
+}
+
+
 string
 CopyToDriveJob::name () const
 {
+	if (_drives.size() > 1) {
+		if (_dcps.size() == 1) {
+			return String::compose(_("Copying %1\nto %2 drives"), _dcps[0].filename().string(), _drives.size());
+		}
+		return String::compose(_("Copying DCPs to %1 drives"), _drives.size());
+	}
+
 	if (_dcps.size() == 1) {
-		return String::compose(_("Copying %1\nto %2"), _dcps[0].filename().string(), _drive.description());
+		return String::compose(_("Copying %1\nto %2"), _dcps[0].filename().string(), _drives[0].description());
 	}
 
-	return String::compose(_("Copying DCPs to %1"), _drive.description());
+	return String::compose(_("Copying DCPs to %1"), _drives[0].description());
 }
 
 
@@ -74,16 +94,30 @@ CopyToDriveJob::json_name () const
 void
 CopyToDriveJob::run ()
 {
-	LOG_DISK("Sending write requests to disk %1 for:", _drive.device());
+	if (_drives.size() == 1) {
+		run_single ();
+	} else {
+		run_multiple ();
+	}
+}
+
+
+void
+CopyToDriveJob::run_single ()
+{
+	auto const& drive = _drives[0];
+
+	LOG_DISK("Sending write requests to disk %1 for:", drive.device());
 	for (auto dcp: _dcps) {
 		LOG_DISK("%1", dcp.string());
 	}
 
-	string request = String::compose(DISK_WRITER_WRITE "\n%1\n", _drive.device());
+	string request = String::compose(DISK_WRITER_WRITE "\n%1\n", drive.device());
 	for (auto dcp: _dcps) {
 		request += String::compose("%1\n", dcp.string());
 	}
 	request += "\n";
+	request += String::compose("%1\n", Config::instance()->disk_verify_sample_interval());
 	if (!_nanomsg.send(request, 2000)) {
 		LOG_DISK_NC("Failed to send write request.");
 		throw CommunicationFailedError ();
@@ -134,3 +168,122 @@ CopyToDriveJob::run ()
 		}
 	}
 }
+
+
+void
+CopyToDriveJob::run_multiple ()
+{
+	LOG_DISK("Sending write requests to %1 disks for:", _drives.size());
+	for (auto dcp: _dcps) {
+		LOG_DISK("%1", dcp.string());
+	}
+
+	string request = DISK_WRITER_WRITE_MULTIPLE "\n";
+	for (auto const& drive: _drives) {
+		LOG_DISK("  to %1", drive.device());
+		request += String::compose("%1\n", drive.device());
+	}
+	request += "\n";
+	for (auto dcp: _dcps) {
+		request += String::compose("%1\n", dcp.string());
+	}
+	request += "\n";
+	request += String::compose("%1\n", Config::instance()->disk_verify_sample_interval());
+	if (!_nanomsg.send(request, 2000)) {
+		LOG_DISK_NC("Failed to send write request.");
+		throw CommunicationFailedError ();
+	}
+
+	/* Stages of the write to each drive, in order, so that we can work out overall progress */
+	enum class Stage {
+		FORMAT,
+		COPY,
+		VERIFY,
+		FINISHED
+	};
+
+	struct DriveState {
+		Stage stage = Stage::FORMAT;
+		float progress = 0;
+		optional<string> error;
+	};
+
+	vector<DriveState> states(_drives.size());
+
+	sub (_("Writing to drives"));
+
+	while (true) {
+		auto response = DiskWriterBackEndResponse::read_from_nanomsg(_nanomsg, 10000);
+		if (!response) {
+			continue;
+		}
+
+		if (!response->drive()) {
+			if (response->type() == DiskWriterBackEndResponse::Type::ERROR) {
+				/* Something went wrong that affects all the drives */
+				throw CopyError(response->error_message(), response->ext4_error_number(), response->platform_error_number());
+			} else if (response->type() != DiskWriterBackEndResponse::Type::OK) {
+				continue;
+			}
+
+			vector<string> failed;
+			string details;
+			for (size_t i = 0; i < _drives.size(); ++i) {
+				if (states[i].error) {
+					failed.push_back(_drives[i].description());
+					details += String::compose("%1: %2\n", _drives[i].description(), *states[i].error);
+				}
+			}
+
+			if (failed.empty()) {
+				set_state (FINISHED_OK);
+			} else {
+				set_error (String::compose(_("Could not write to %1 of %2 drives"), failed.size(), _drives.size()), details);
+				set_progress (1);
+				set_state (FINISHED_ERROR);
+			}
+			return;
+		}
+
+		auto const index = *response->drive();
+		if (index < 0 || index >= static_cast<int>(states.size())) {
+			LOG_DISK("Ignoring response for unknown drive %1", index);
+			continue;
+		}
+
+		auto& state = states[index];
+		switch (response->type()) {
+		case DiskWriterBackEndResponse::Type::OK:
+			LOG_DISK("Finished writing to %1", _drives[index].device());
+			state.stage = Stage::FINISHED;
+			state.progress = 0;
+			break;
+		case DiskWriterBackEndResponse::Type::ERROR:
+			LOG_DISK("Writing to %1 failed: %2", _drives[index].device(), response->error_message());
+			state.stage = Stage::FINISHED;
+			state.progress = 0;
+			state.error = String::compose("%1 (%2, %3)", response->error_message(), response->ext4_error_number(), response->platform_error_number());
+			break;
+		case DiskWriterBackEndResponse::Type::PONG:
+			break;
+		case DiskWriterBackEndResponse::Type::FORMAT_PROGRESS:
+			state.stage = Stage::FORMAT;
+			state.progress = response->progress();
+			break;
+		case DiskWriterBackEndResponse::Type::COPY_PROGRESS:
+			state.stage = Stage::COPY;
+			state.progress = response->progress();
+			break;
+		case DiskWriterBackEndResponse::Type::VERIFY_PROGRESS:
+			state.stage = Stage::VERIFY;
+			state.progress = response->progress();
+			break;
+		}
+
+		float total = 0;
+		for (auto const& i: states) {
+			total += (static_cast<int>(i.stage) + i.progress) / 3;
+		}
+		set_progress (total / states.size());
+	}
+}
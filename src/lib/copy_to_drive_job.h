@@ -26,10 +26,17 @@ class CopyToDriveJob : public Job
 {
 public:
 	CopyToDriveJob (std::vector<boost::filesystem::path> const& dcps, Drive drive, Nanomsg& nanomsg);
+	/** Write the same DCPs to several drives at once */
+	CopyToDriveJob (std::vector<boost::filesystem::path> const& dcps, std::vector<Drive> drives, Nanomsg& nanomsg);
 
 	std::string name () const override;
 	std::string json_name () const override;
 	void run () override;
+
+	Resource resource () const override {
+		return Resource::DISK;
+	}
+
 	bool enable_notify () const override {
 		return true;
 	}
@@ -37,7 +44,10 @@ public:
 private:
 	void count (boost::filesystem::path dir, uint64_t& total_bytes);
 	void copy (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total_remaining, uint64_t total);
+	void run_single ();
+	void run_multiple ();
+
 	std::vector<boost::filesystem::path> _dcps;
-	Drive _drive;
+	std::vector<Drive> _drives;
 	Nanomsg& _nanomsg;
 };
@@ -0,0 +1,129 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/cpl_cache.cc
+ *  @brief A process-wide cache of parsed CPLs, so that the examiner, decoders and
+ *  the player's CPL menus don't each parse the same DCP again.
+ */
+
+
+#include "cpl_cache.h"
+#include <dcp/cpl.h>
+#include <dcp/filesystem.h>
+#include <dcp/search.h>
+#include <boost/thread/mutex.hpp>
+#include <list>
+
+
+using std::list;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+
+namespace {
+
+/** Everything that we look at to decide whether a DCP has changed since we parsed it */
+class Key
+{
+public:
+	Key (vector<boost::filesystem::path> const& directories, bool tolerant_)
+		: tolerant(tolerant_)
+	{
+		for (auto const& directory: directories) {
+			files.push_back({directory.string(), stamp(directory)});
+			/* We only need to look at the top level, since that's where ASSETMAP, PKL and CPL files are */
+			try {
+				for (auto i: dcp::filesystem::directory_iterator(directory)) {
+					if (dcp::filesystem::is_regular_file(i.path())) {
+						files.push_back({i.path().string(), stamp(i.path())});
+					}
+				}
+			} catch (...) {
+				/* dcp::find_and_resolve_cpls will complain if the directory can't be read */
+			}
+		}
+	}
+
+	bool operator== (Key const& other) const {
+		return tolerant == other.tolerant && files == other.files;
+	}
+
+	bool tolerant;
+	vector<pair<string, pair<std::time_t, uintmax_t>>> files;
+
+private:
+	static pair<std::time_t, uintmax_t> stamp (boost::filesystem::path path)
+	{
+		boost::system::error_code ec;
+		auto const time = dcp::filesystem::last_write_time(path, ec);
+		if (ec) {
+			return {};
+		}
+		auto const size = dcp::filesystem::is_regular_file(path) ? dcp::filesystem::file_size(path, ec) : 0;
+		return { time, ec ? 0 : size };
+	}
+};
+
+
+boost::mutex mutex;
+/** Most-recently used first */
+list<pair<Key, vector<shared_ptr<dcp::CPL>>>> cache;
+int const max_cache_size = 8;
+
+}
+
+
+/** Call dcp::find_and_resolve_cpls, re-using the results of a previous call if
+ *  none of the top-level files in the directories have changed since.
+ *  The returned CPLs may be shared with other callers.
+ */
+vector<shared_ptr<dcp::CPL>>
+find_and_resolve_cpls_cached (vector<boost::filesystem::path> const& directories, bool tolerant)
+{
+	Key key(directories, tolerant);
+
+	{
+		boost::mutex::scoped_lock lm (mutex);
+		for (auto i = cache.begin(); i != cache.end(); ++i) {
+			if (i->first == key) {
+				cache.splice(cache.begin(), cache, i);
+				return cache.front().second;
+			}
+		}
+	}
+
+	/* Parse without holding the lock; if another thread gets there first we'll just
+	 * end up with one of the results in the cache.
+	 */
+	auto cpls = dcp::find_and_resolve_cpls(directories, tolerant);
+
+	boost::mutex::scoped_lock lm (mutex);
+	cache.push_front({key, cpls});
+	while (static_cast<int>(cache.size()) > max_cache_size) {
+		cache.pop_back();
+	}
+
+	return cpls;
+}
@@ -0,0 +1,106 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "crc32c.h"
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+#include <cstring>
+
+
+#ifndef __SSE4_2__
+
+namespace {
+
+/** Tables for the slice-by-8 software implementation */
+class Tables
+{
+public:
+	Tables ()
+	{
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (int j = 0; j < 8; ++j) {
+				c = (c >> 1) ^ ((c & 1) ? 0x82f63b78 : 0);
+			}
+			table[0][i] = c;
+		}
+
+		for (uint32_t i = 0; i < 256; ++i) {
+			for (int j = 1; j < 8; ++j) {
+				table[j][i] = (table[j - 1][i] >> 8) ^ table[0][table[j - 1][i] & 0xff];
+			}
+		}
+	}
+
+	uint32_t table[8][256];
+};
+
+}
+
+#endif
+
+
+void
+CRC32C::add (void const* data, size_t size)
+{
+	auto p = reinterpret_cast<uint8_t const*>(data);
+	uint32_t crc = _crc;
+
+#ifdef __SSE4_2__
+
+	uint64_t crc64 = crc;
+	while (size >= 8) {
+		uint64_t v;
+		memcpy (&v, p, 8);
+		crc64 = _mm_crc32_u64 (crc64, v);
+		p += 8;
+		size -= 8;
+	}
+	crc = static_cast<uint32_t>(crc64);
+	while (size > 0) {
+		crc = _mm_crc32_u8 (crc, *p++);
+		--size;
+	}
+
+#else
+
+	static Tables const tables;
+	auto const& t = tables.table;
+
+	while (size >= 8) {
+		uint32_t const a = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24));
+		crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^ t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^
+			t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+		p += 8;
+		size -= 8;
+	}
+	while (size > 0) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+		--size;
+	}
+
+#endif
+
+	_crc = crc;
+}
@@ -0,0 +1,53 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_CRC32C_H
+#define DCPOMATIC_CRC32C_H
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+/** @class CRC32C
+ *  @brief Incremental CRC-32C (Castagnoli) checksum.
+ *
+ *  This is much cheaper to compute than MD5, and is used to check data sent
+ *  between masters and encode servers.  SSE4.2 instructions are used when the
+ *  build allows it.
+ */
+class CRC32C
+{
+public:
+	void add (void const* data, size_t size);
+
+	uint32_t get () const {
+		return ~_crc;
+	}
+
+private:
+	uint32_t _crc = 0xffffffff;
+};
+
+
+#endif
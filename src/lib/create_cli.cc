@@ -23,10 +23,14 @@
 #include "config.h"
 #include "create_cli.h"
 #include "dcp_content_type.h"
+#include "dcpomatic_assert.h"
 #include "dcpomatic_log.h"
 #include "film.h"
 #include "ratio.h"
 #include <dcp/raw_convert.h>
+#include <dcp/util.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/tokenizer.hpp>
 #include <iostream>
 #include <string>
 
@@ -65,7 +69,9 @@ string CreateCLI::_help =
 	"      --channel <channel>       next piece of content should be mapped to audio channel L, R, C, Lfe, Ls, Rs, BsL, BsR, HI, VI\n"
 	"      --gain                    next piece of content should have the given audio gain (in dB)\n"
 	"      --cpl <id>                CPL ID to use from the next piece of content (which is a DCP)\n"
-	"      --kdm <file>              KDM for next piece of content\n";
+	"      --kdm <file>              KDM for next piece of content\n"
+	"      --manifest <file>         create several films, each described by one line of <file>\n"
+	"                                containing the options and content for that film\n";
 
 
 template <class T>
@@ -206,6 +212,7 @@ CreateCLI::CreateCLI (int argc, char* argv[])
 		argument_option(i, argc, argv, "",   "--config",           &claimed, &error, &config_dir, string_to_path);
 		argument_option(i, argc, argv, "-o", "--output",           &claimed, &error, &output_dir, string_to_path);
 		argument_option(i, argc, argv, "",   "--j2k-bandwidth",    &claimed, &error, &j2k_bandwidth_int);
+		argument_option(i, argc, argv, "",   "--manifest",         &claimed, &error, &manifest, string_to_path);
 
 		std::function<optional<dcp::Channel> (string)> convert_channel = [](string channel) -> optional<dcp::Channel>{
 			if (channel == "L") {
@@ -310,6 +317,13 @@ CreateCLI::CreateCLI (int argc, char* argv[])
 		error = String::compose("%1: specify one of --no-encrypt or --encrypt, not both", argv[0]);
 	}
 
+	if (manifest) {
+		if (!content.empty()) {
+			error = String::compose("%1: specify content either on the command line or in a manifest, not both", argv[0]);
+		}
+		return;
+	}
+
 	if (content.empty()) {
 		error = String::compose("%1: no content specified", argv[0]);
 		return;
@@ -390,3 +404,57 @@ CreateCLI::make_film() const
 	return film;
 }
 
+
+
+/** @param program Name of the program, as given in argv[0].
+ *  @return Details of the films described by our manifest, one for each line which is not blank
+ *  or a comment.  Any errors in a line are given in that film's error, prefixed by the line number.
+ */
+vector<CreateCLI>
+CreateCLI::manifest_films(string program) const
+{
+	DCPOMATIC_ASSERT(manifest);
+
+	vector<string> lines;
+	auto const text = dcp::file_to_string(*manifest);
+	boost::algorithm::split(lines, text, boost::is_any_of("\n"));
+
+	vector<CreateCLI> films;
+	int line_number = 0;
+	for (auto const& line: lines) {
+		++line_number;
+		auto const trimmed = boost::algorithm::trim_copy(line);
+		if (trimmed.empty() || trimmed[0] == '#') {
+			continue;
+		}
+
+		/* Split the line up as a shell would, allowing quoted arguments that contain spaces */
+		boost::escaped_list_separator<char> separator("", " \t", "\"\'");
+		boost::tokenizer<boost::escaped_list_separator<char>> tokens(trimmed, separator);
+
+		vector<string> arguments = { program };
+		for (auto const& token: tokens) {
+			if (!token.empty()) {
+				arguments.push_back(token);
+			}
+		}
+
+		vector<char*> argv;
+		for (auto& argument: arguments) {
+			argv.push_back(const_cast<char*>(argument.c_str()));
+		}
+
+		CreateCLI film(static_cast<int>(argv.size()), argv.data());
+		if (!film.error && film.manifest) {
+			film.error = String::compose("%1: manifests cannot include other manifests", program);
+		} else if (!film.error && !film.output_dir) {
+			film.error = String::compose("%1: each film in a manifest must have an --output directory", program);
+		}
+		if (film.error) {
+			film.error = String::compose("%1:%2: %3", manifest->string(), line_number, *film.error);
+		}
+		films.push_back(film);
+	}
+
+	return films;
+}
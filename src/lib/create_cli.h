@@ -31,6 +31,7 @@ class Film;
 class Ratio;
 
 struct create_cli_test;
+struct create_cli_manifest_test;
 
 
 class CreateCLI
@@ -52,13 +53,17 @@ public:
 	boost::optional<int> still_length;
 	boost::optional<boost::filesystem::path> config_dir;
 	boost::optional<boost::filesystem::path> output_dir;
+	/** File describing several films to create, one per line */
+	boost::optional<boost::filesystem::path> manifest;
 	boost::optional<std::string> error;
 	std::vector<Content> content;
 
 	std::shared_ptr<Film> make_film() const;
+	std::vector<CreateCLI> manifest_films(std::string program) const;
 
 private:
 	friend struct ::create_cli_test;
+	friend struct ::create_cli_manifest_test;
 
 	boost::optional<std::string> _template_name;
 	std::string _name;
@@ -33,6 +33,7 @@
 #undef ERROR
 #include <boost/thread/mutex.hpp>
 #include <boost/optional.hpp>
+#include <cstdio>
 
 #ifdef DCPOMATIC_WINDOWS
 #define WEXITSTATUS(w) (w)
@@ -43,6 +44,7 @@ struct AVIOContext;
 
 extern void dcpomatic_sleep_seconds (int);
 extern void dcpomatic_sleep_milliseconds (int);
+extern void sync_file (FILE* file);
 extern std::string cpu_info ();
 extern void run_ffprobe(boost::filesystem::path content, boost::filesystem::path out, bool err = true, std::string args = {});
 extern std::list<std::pair<std::string, std::string>> mount_info ();
@@ -66,6 +68,32 @@ extern void unprivileged ();
 extern boost::filesystem::path config_path (boost::optional<std::string> version);
 extern boost::filesystem::path directory_containing_executable ();
 extern bool show_in_file_manager (boost::filesystem::path dir, boost::filesystem::path select);
+/** Make a copy-on-write clone of a file, if the filesystem can do it.
+ *  @return true if `to' was created as a clone; false if not, in which case `to' has not been created.
+ */
+extern bool clone_file (boost::filesystem::path from, boost::filesystem::path to);
+/** Ask the OS to start reading part of a file into its cache, without waiting for it to do so.
+ *  This does nothing on platforms which cannot do it.
+ */
+extern void advise_read_ahead (FILE* file, int64_t offset, int64_t length);
+/** Ask the filesystem to reserve space for a file, which may be open for writing elsewhere, so that it
+ *  can grow to size bytes without becoming fragmented.  The file's length is not changed.  This does
+ *  nothing on platforms or filesystems which cannot do it.
+ */
+extern void preallocate_file (boost::filesystem::path file, int64_t size);
+/** Give back any space reserved by preallocate_file() which is beyond the end of a file */
+extern void release_file_preallocation (boost::filesystem::path file);
+/** @return memory of at least size bytes, aligned to and backed by huge pages if the OS
+ *  will allow it, or nullptr if this is not possible.  Free it with free_huge_pages().
+ */
+extern void* allocate_huge_pages (size_t size);
+extern void free_huge_pages (void* buffer, size_t size);
+/** @return the CPUs in each NUMA node, or an empty vector if this is not known */
+extern std::vector<std::vector<int>> numa_nodes ();
+/** Try to make the calling thread run only on some CPUs */
+extern void set_thread_cpus (std::vector<int> const& cpus);
+extern void set_thread_numa_node (int index);
+extern std::string numa_description ();
 namespace dcpomatic {
 	std::string get_process_id ();
 }
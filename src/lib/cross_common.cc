@@ -216,3 +216,37 @@ osx_disks_to_drives (vector<OSXDisk> disks)
 
 	return drives;
 }
+
+
+/** Restrict the calling encoding thread to the CPUs of one NUMA node, so that the
+ *  buffers that it allocates are local to where they are used.  Threads are spread
+ *  over the nodes in turn according to \p index.  Nothing happens if there is only
+ *  one node.
+ */
+void
+set_thread_numa_node (int index)
+{
+	static auto const nodes = numa_nodes();
+	if (nodes.size() < 2) {
+		return;
+	}
+
+	set_thread_cpus (nodes[index % nodes.size()]);
+}
+
+
+/** @return a description of the NUMA nodes, for logs */
+string
+numa_description ()
+{
+	auto const nodes = numa_nodes();
+	if (nodes.empty()) {
+		return "NUMA topology unknown";
+	}
+
+	string description = String::compose("%1 NUMA node(s):", nodes.size());
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		description += String::compose(" %1: %2 CPUs from %3 to %4;", i, nodes[i].size(), nodes[i].front(), nodes[i].back());
+	}
+	return description;
+}
@@ -35,8 +35,13 @@
 #include <boost/dll/runtime_symbol_info.hpp>
 #endif
 #include <unistd.h>
+#include <fcntl.h>
 #include <mntent.h>
+#include <sys/ioctl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/mount.h>
 #include <ifaddrs.h>
 #include <netinet/in.h>
@@ -338,3 +343,139 @@ show_in_file_manager (boost::filesystem::path dir, boost::filesystem::path)
 	return true;
 }
 
+
+/* From linux/fs.h, which we can't include as it clashes with sys/mount.h */
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+
+bool
+clone_file (boost::filesystem::path from, boost::filesystem::path to)
+{
+	int const from_fd = open(from.c_str(), O_RDONLY);
+	if (from_fd < 0) {
+		return false;
+	}
+
+	int const to_fd = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (to_fd < 0) {
+		close (from_fd);
+		return false;
+	}
+
+	bool const ok = ioctl(to_fd, FICLONE, from_fd) == 0;
+	close (from_fd);
+	close (to_fd);
+
+	if (!ok) {
+		unlink (to.c_str());
+	}
+
+	return ok;
+}
+
+
+void
+advise_read_ahead (FILE* file, int64_t offset, int64_t length)
+{
+	posix_fadvise (fileno(file), offset, length, POSIX_FADV_WILLNEED);
+}
+
+
+void
+preallocate_file (boost::filesystem::path file, int64_t size)
+{
+	int const fd = open(file.c_str(), O_WRONLY);
+	if (fd < 0) {
+		return;
+	}
+
+	/* This fails with EOPNOTSUPP on filesystems which can't do it (e.g. older exFAT drivers), which is fine */
+	fallocate (fd, FALLOC_FL_KEEP_SIZE, 0, size);
+	close (fd);
+}
+
+
+void*
+allocate_huge_pages (size_t size)
+{
+	size_t constexpr huge_page = 2 * 1024 * 1024;
+
+	void* buffer = nullptr;
+	if (posix_memalign(&buffer, huge_page, size) != 0) {
+		return nullptr;
+	}
+
+	/* This may fail (e.g. if transparent huge pages are disabled) but the memory is still usable */
+	madvise (buffer, size, MADV_HUGEPAGE);
+	return buffer;
+}
+
+
+void
+free_huge_pages (void* buffer, size_t)
+{
+	free (buffer);
+}
+
+
+vector<vector<int>>
+numa_nodes ()
+{
+	vector<vector<int>> nodes;
+
+	for (int node = 0; ; ++node) {
+		ifstream f(String::compose("/sys/devices/system/node/node%1/cpulist", node));
+		if (!f.good()) {
+			break;
+		}
+
+		/* A list like 0-31,64-95 */
+		string line;
+		getline (f, line);
+		boost::algorithm::trim (line);
+
+		vector<int> cpus;
+		vector<string> ranges;
+		boost::split (ranges, line, boost::is_any_of(","));
+		for (auto const& range: ranges) {
+			if (range.empty()) {
+				continue;
+			}
+			auto const dash = range.find('-');
+			try {
+				int const first = std::stoi(range.substr(0, dash));
+				int const last = dash == string::npos ? first : std::stoi(range.substr(dash + 1));
+				for (int cpu = first; cpu <= last; ++cpu) {
+					cpus.push_back (cpu);
+				}
+			} catch (std::exception&) {
+				return {};
+			}
+		}
+
+		if (!cpus.empty()) {
+			nodes.push_back (cpus);
+		}
+	}
+
+	return nodes;
+}
+
+
+void
+set_thread_cpus (vector<int> const& cpus)
+{
+	cpu_set_t set;
+	CPU_ZERO (&set);
+	for (auto cpu: cpus) {
+		if (cpu < CPU_SETSIZE) {
+			CPU_SET (cpu, &set);
+		}
+	}
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		LOG_WARNING_NC ("Could not set CPU affinity of encoding thread");
+	}
+}
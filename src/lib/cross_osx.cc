@@ -42,9 +42,13 @@
 #include <DiskArbitration/DiskArbitration.h>
 #include <CoreFoundation/CFURL.h>
 #include <sys/types.h>
+#include <sys/clonefile.h>
+#include <fcntl.h>
 #include <ifaddrs.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <algorithm>
+#include <climits>
 #include <fstream>
 #include <cstring>
 
@@ -491,3 +495,68 @@ show_in_file_manager (boost::filesystem::path, boost::filesystem::path select)
 	return static_cast<bool>(WEXITSTATUS(r));
 }
 
+
+bool
+clone_file (boost::filesystem::path from, boost::filesystem::path to)
+{
+	/* This works on APFS and fails on anything else */
+	return clonefile(from.c_str(), to.c_str(), 0) == 0;
+}
+
+
+void
+advise_read_ahead (FILE* file, int64_t offset, int64_t length)
+{
+	radvisory advice;
+	advice.ra_offset = offset;
+	advice.ra_count = static_cast<int>(std::min(length, static_cast<int64_t>(INT_MAX)));
+	fcntl (fileno(file), F_RDADVISE, &advice);
+}
+
+
+void
+preallocate_file (boost::filesystem::path file, int64_t size)
+{
+	int const fd = open(file.c_str(), O_WRONLY);
+	if (fd < 0) {
+		return;
+	}
+
+	/* Ask for contiguous space first, then take what we can get */
+	fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, size, 0 };
+	if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+		store.fst_flags = F_ALLOCATEALL;
+		fcntl (fd, F_PREALLOCATE, &store);
+	}
+	close (fd);
+}
+
+
+void*
+allocate_huge_pages (size_t)
+{
+	/* macOS only offers superpages through mach_vm_allocate flags which are not supported on Apple silicon */
+	return nullptr;
+}
+
+
+void
+free_huge_pages (void*, size_t)
+{
+
+}
+
+
+vector<vector<int>>
+numa_nodes ()
+{
+	/* macOS doesn't expose NUMA topology, and Apple hardware doesn't need it */
+	return {};
+}
+
+
+void
+set_thread_cpus (vector<int> const&)
+{
+	/* macOS has no way to bind a thread to particular CPUs */
+}
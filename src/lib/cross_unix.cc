@@ -27,6 +27,9 @@ extern "C" {
 #include <libavformat/avio.h>
 }
 LIBDCP_ENABLE_WARNINGS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 
 using std::string;
@@ -47,6 +50,32 @@ dcpomatic_sleep_milliseconds (int ms)
 }
 
 
+/** Flush a file's buffers and ask the OS to write its data to disk */
+void
+sync_file (FILE* file)
+{
+	fflush (file);
+	fsync (fileno(file));
+}
+
+
+void
+release_file_preallocation (boost::filesystem::path file)
+{
+	int const fd = open(file.c_str(), O_WRONLY);
+	if (fd < 0) {
+		return;
+	}
+
+	/* Truncating to the current length frees any blocks allocated past it */
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		ftruncate (fd, st.st_size);
+	}
+	close (fd);
+}
+
+
 uint64_t
 thread_id ()
 {
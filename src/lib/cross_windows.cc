@@ -51,6 +51,7 @@ extern "C" {
 #include <shlobj.h>
 #include <shlwapi.h>
 #include <fcntl.h>
+#include <io.h>
 #include <fstream>
 #include <map>
 
@@ -83,6 +84,15 @@ dcpomatic_sleep_seconds (int s)
 }
 
 
+/** Flush a file's buffers and ask the OS to write its data to disk */
+void
+sync_file (FILE* file)
+{
+	fflush (file);
+	_commit (_fileno(file));
+}
+
+
 void
 dcpomatic_sleep_milliseconds (int ms)
 {
@@ -687,3 +697,95 @@ ArgFixer::ArgFixer(int, char**)
 	}
 }
 
+
+bool
+clone_file (boost::filesystem::path, boost::filesystem::path)
+{
+	/* ReFS can do this with FSCTL_DUPLICATE_EXTENTS_TO_FILE, but it is fiddly (the extents
+	 * must be aligned to clusters) and ReFS is rarely seen outside servers, so we don't try.
+	 */
+	return false;
+}
+
+
+void
+advise_read_ahead (FILE*, int64_t, int64_t)
+{
+	/* Windows has no equivalent of posix_fadvise(); it does its own read-ahead on files that are read sequentially */
+}
+
+
+/* @return a handle to file which can be used to change its allocation, or INVALID_HANDLE_VALUE.
+ * This fails if whoever is writing the file has not allowed others to write to it too.
+ */
+static HANDLE
+open_for_allocation (boost::filesystem::path file)
+{
+	return CreateFileW(
+		file.wstring().c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+		);
+}
+
+
+void
+preallocate_file (boost::filesystem::path file, int64_t size)
+{
+	auto handle = open_for_allocation(file);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = size;
+	SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info));
+	CloseHandle(handle);
+}
+
+
+void
+release_file_preallocation (boost::filesystem::path file)
+{
+	auto handle = open_for_allocation(file);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	LARGE_INTEGER length;
+	if (GetFileSizeEx(handle, &length)) {
+		FILE_ALLOCATION_INFO info;
+		info.AllocationSize = length;
+		SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info));
+	}
+	CloseHandle(handle);
+}
+
+
+void*
+allocate_huge_pages (size_t)
+{
+	/* Large pages need the SeLockMemoryPrivilege, which we won't normally have */
+	return nullptr;
+}
+
+
+void
+free_huge_pages (void*, size_t)
+{
+
+}
+
+
+vector<vector<int>>
+numa_nodes ()
+{
+	/* We could use GetNumaNodeProcessorMaskEx, but we don't yet */
+	return {};
+}
+
+
+void
+set_thread_cpus (vector<int> const&)
+{
+
+}
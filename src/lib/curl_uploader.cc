@@ -26,21 +26,61 @@
 #include "cross.h"
 #include "compose.hpp"
 #include "dcpomatic_assert.h"
+#include "scope_guard.h"
+#include <dcp/filesystem.h>
+#include <algorithm>
 #include <iostream>
+#include <list>
 
 #include "i18n.h"
 
 
-using std::string;
 using std::cout;
 using std::function;
+using std::list;
+using std::make_pair;
+using std::pair;
+using std::string;
+using std::vector;
+using boost::optional;
+
+
+/** Files smaller than this are always sent in full, even if a file of the right size is already
+ *  there, as (unlike MXFs) they may well be the same size from one version of a DCP to the next.
+ */
+static boost::uintmax_t constexpr minimum_resume_size = 16 * 1024 * 1024;
+
+
+/** State of a file which is being sent */
+struct CurlUploader::Transfer
+{
+	Transfer (CurlUploader* uploader_, boost::filesystem::path from_)
+		: uploader(uploader_)
+		, from(from_)
+	{}
+
+	~Transfer ()
+	{
+		if (curl) {
+			curl_easy_cleanup (curl);
+		}
+	}
+
+	Transfer (Transfer const&) = delete;
+	Transfer& operator= (Transfer const&) = delete;
+
+	CurlUploader* uploader;
+	boost::filesystem::path from;
+	CURL* curl = nullptr;
+	std::unique_ptr<dcp::File> file;
+};
 
 
 static size_t
 read_callback (void* ptr, size_t size, size_t nmemb, void* object)
 {
-	CurlUploader* u = reinterpret_cast<CurlUploader*> (object);
-	return u->read_callback (ptr, size, nmemb);
+	auto transfer = reinterpret_cast<CurlUploader::Transfer*>(object);
+	return transfer->uploader->read_callback (transfer, ptr, size, nmemb);
 }
 
 
@@ -54,30 +94,63 @@ curl_debug_shim (CURL* curl, curl_infotype type, char* data, size_t size, void*
 CurlUploader::CurlUploader (function<void (string)> set_status, function<void (float)> set_progress)
 	: Uploader (set_status, set_progress)
 {
-	_curl = curl_easy_init ();
-	if (!_curl) {
+
+}
+
+
+/** @return A new handle with the options that all our transfers need */
+CURL*
+CurlUploader::make_handle ()
+{
+	auto curl = curl_easy_init ();
+	if (!curl) {
 		throw NetworkError (_("Could not start transfer"));
 	}
 
-	curl_easy_setopt (_curl, CURLOPT_READFUNCTION, ::read_callback);
-	curl_easy_setopt (_curl, CURLOPT_READDATA, this);
-	curl_easy_setopt (_curl, CURLOPT_UPLOAD, 1L);
-	curl_easy_setopt (_curl, CURLOPT_FTP_CREATE_MISSING_DIRS, 1L);
-	curl_easy_setopt (_curl, CURLOPT_READDATA, this);
-	curl_easy_setopt (_curl, CURLOPT_USERNAME, Config::instance()->tms_user().c_str());
-	curl_easy_setopt (_curl, CURLOPT_PASSWORD, Config::instance()->tms_password().c_str());
+	curl_easy_setopt (curl, CURLOPT_READFUNCTION, ::read_callback);
+	curl_easy_setopt (curl, CURLOPT_UPLOAD, 1L);
+	/* Retry if another of our connections makes a directory after we find it's not there, but before we make it */
+	curl_easy_setopt (curl, CURLOPT_FTP_CREATE_MISSING_DIRS, static_cast<long>(CURLFTP_CREATE_DIR_RETRY));
+	curl_easy_setopt (curl, CURLOPT_USERNAME, Config::instance()->tms_user().c_str());
+	curl_easy_setopt (curl, CURLOPT_PASSWORD, Config::instance()->tms_password().c_str());
 	if (!Config::instance()->tms_passive()) {
-		curl_easy_setopt(_curl, CURLOPT_FTPPORT, "-");
+		curl_easy_setopt(curl, CURLOPT_FTPPORT, "-");
 	}
-	curl_easy_setopt(_curl, CURLOPT_VERBOSE, 1L);
-	curl_easy_setopt(_curl, CURLOPT_DEBUGFUNCTION, curl_debug_shim);
-	curl_easy_setopt(_curl, CURLOPT_DEBUGDATA, this);
+	curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+	curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, curl_debug_shim);
+	curl_easy_setopt(curl, CURLOPT_DEBUGDATA, this);
+
+	return curl;
 }
 
 
-CurlUploader::~CurlUploader ()
+string
+CurlUploader::url (boost::filesystem::path to) const
 {
-	curl_easy_cleanup (_curl);
+	/* Use generic_string so that we get forward-slashes in the path, even on Windows */
+	return String::compose ("ftp://%1/%2/%3", Config::instance()->tms_ip(), Config::instance()->tms_path(), to.generic_string());
+}
+
+
+/** @return Size of a file on the TMS, or none if it is not there (or we can't find its size) */
+optional<boost::uintmax_t>
+CurlUploader::remote_size (string url)
+{
+	auto curl = make_handle ();
+	curl_easy_setopt (curl, CURLOPT_URL, url.c_str());
+	curl_easy_setopt (curl, CURLOPT_UPLOAD, 0L);
+	curl_easy_setopt (curl, CURLOPT_NOBODY, 1L);
+
+	optional<boost::uintmax_t> size;
+	if (curl_easy_perform(curl) == CURLE_OK) {
+		curl_off_t length = -1;
+		if (curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK && length >= 0) {
+			size = length;
+		}
+	}
+
+	curl_easy_cleanup (curl);
+	return size;
 }
 
 
@@ -88,38 +161,140 @@ CurlUploader::create_directory (boost::filesystem::path)
 }
 
 
-void
-CurlUploader::upload_file (boost::filesystem::path from, boost::filesystem::path to, boost::uintmax_t& transferred, boost::uintmax_t total_size)
+/** Set up a transfer of one file.
+ *  @return Transfer, ready to be performed, or nullptr if the file is already on the TMS.
+ */
+std::unique_ptr<CurlUploader::Transfer>
+CurlUploader::start (boost::filesystem::path from, boost::filesystem::path to)
 {
-	curl_easy_setopt (
-		_curl, CURLOPT_URL,
-		/* Use generic_string so that we get forward-slashes in the path, even on Windows */
-		String::compose ("ftp://%1/%2/%3", Config::instance()->tms_ip(), Config::instance()->tms_path(), to.generic_string ()).c_str ()
-		);
-
-	dcp::File file(from, "rb");
-	if (!file) {
+	auto const target = url(to);
+	auto const size = dcp::filesystem::file_size(from);
+
+	boost::uintmax_t offset = 0;
+	if (Config::instance()->tms_resume() && size >= minimum_resume_size) {
+		auto const existing = remote_size(target);
+		if (existing && *existing == size) {
+			LOG_GENERAL("%1 is already on the TMS; not sending it again", to.generic_string());
+			*_transferred += size;
+			return {};
+		} else if (existing && *existing < size) {
+			LOG_GENERAL("Carrying on with %1 from %2 of %3 bytes", to.generic_string(), *existing, size);
+			offset = *existing;
+		}
+	}
+
+	std::unique_ptr<Transfer> transfer(new Transfer(this, from));
+	transfer->file.reset(new dcp::File(from, "rb"));
+	if (!*transfer->file) {
 		throw NetworkError (String::compose (_("Could not open %1 to send"), from));
 	}
-	_file = file.get();
+
+	transfer->curl = make_handle ();
+	curl_easy_setopt (transfer->curl, CURLOPT_URL, target.c_str());
+	curl_easy_setopt (transfer->curl, CURLOPT_READDATA, transfer.get());
+	curl_easy_setopt (transfer->curl, CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(size - offset));
+
+	if (offset > 0) {
+		transfer->file->seek (offset, SEEK_SET);
+		curl_easy_setopt (transfer->curl, CURLOPT_APPEND, 1L);
+		*_transferred += offset;
+	}
+
+	_set_status(String::compose(_("copying %1"), from.filename()));
+	return transfer;
+}
+
+
+void
+CurlUploader::upload_file (boost::filesystem::path from, boost::filesystem::path to, boost::uintmax_t& transferred, boost::uintmax_t total_size)
+{
+	upload_files ({ make_pair(from, to) }, transferred, total_size);
+}
+
+
+void
+CurlUploader::upload_files (vector<pair<boost::filesystem::path, boost::filesystem::path>> const& files, boost::uintmax_t& transferred, boost::uintmax_t total_size)
+{
 	_transferred = &transferred;
 	_total_size = total_size;
 
-	auto const r = curl_easy_perform (_curl);
-	if (r != CURLE_OK) {
-		throw NetworkError (String::compose (_("Could not write to remote file (%1)"), curl_easy_strerror (r)));
+	auto multi = curl_multi_init ();
+	if (!multi) {
+		throw NetworkError (_("Could not start transfer"));
+	}
+
+	list<std::unique_ptr<Transfer>> transfers;
+
+	ScopeGuard sg = [multi, &transfers]() {
+		for (auto const& transfer: transfers) {
+			curl_multi_remove_handle (multi, transfer->curl);
+		}
+		transfers.clear ();
+		curl_multi_cleanup (multi);
+	};
+
+	size_t next = 0;
+	auto start_next = [this, multi, &files, &next, &transfers]() {
+		while (next < files.size()) {
+			auto transfer = start(files[next].first, files[next].second);
+			++next;
+			if (transfer) {
+				curl_multi_add_handle (multi, transfer->curl);
+				transfers.push_back (std::move(transfer));
+				return;
+			}
+		}
+	};
+
+	auto const connections = std::max(1, Config::instance()->tms_connections());
+	for (int i = 0; i < connections; ++i) {
+		start_next ();
+	}
+
+	while (!transfers.empty()) {
+		int running = 0;
+		auto const r = curl_multi_perform (multi, &running);
+		if (r != CURLM_OK) {
+			throw NetworkError (String::compose(_("Could not write to remote file (%1)"), curl_multi_strerror(r)));
+		}
+
+		int queued = 0;
+		while (auto message = curl_multi_info_read(multi, &queued)) {
+			if (message->msg != CURLMSG_DONE) {
+				continue;
+			}
+
+			auto transfer = std::find_if(transfers.begin(), transfers.end(), [message](std::unique_ptr<Transfer> const& t) {
+				return t->curl == message->easy_handle;
+			});
+			DCPOMATIC_ASSERT (transfer != transfers.end());
+
+			auto const result = message->data.result;
+			curl_multi_remove_handle (multi, (*transfer)->curl);
+			transfers.erase (transfer);
+
+			if (result != CURLE_OK) {
+				throw NetworkError (String::compose (_("Could not write to remote file (%1)"), curl_easy_strerror (result)));
+			}
+
+			start_next ();
+		}
+
+		if (!transfers.empty()) {
+			curl_multi_wait (multi, nullptr, 0, 1000, nullptr);
+		}
 	}
 
-	_file = nullptr;
+	_transferred = nullptr;
 }
 
 
 size_t
-CurlUploader::read_callback (void* ptr, size_t size, size_t nmemb)
+CurlUploader::read_callback (Transfer* transfer, void* ptr, size_t size, size_t nmemb)
 {
-	DCPOMATIC_ASSERT (_file);
-	size_t const r = fread(ptr, size, nmemb, _file);
-	*_transferred += size * nmemb;
+	DCPOMATIC_ASSERT (transfer->file);
+	size_t const r = transfer->file->read(ptr, size, nmemb);
+	*_transferred += size * r;
 
 	if (_total_size > 0) {
 		_set_progress ((double) *_transferred / _total_size);
@@ -22,25 +22,31 @@
 #include "uploader.h"
 #include <dcp/file.h>
 #include <curl/curl.h>
+#include <boost/optional.hpp>
+#include <memory>
 
 
 class CurlUploader : public Uploader
 {
 public:
 	CurlUploader (std::function<void (std::string)> set_status, std::function<void (float)> set_progress);
-	~CurlUploader ();
 
-	size_t read_callback (void* ptr, size_t size, size_t nmemb);
+	struct Transfer;
+
+	size_t read_callback (Transfer* transfer, void* ptr, size_t size, size_t nmemb);
 	int debug(CURL* curl, curl_infotype type, char* data, size_t size);
 
 protected:
 	void create_directory (boost::filesystem::path directory) override;
 	void upload_file (boost::filesystem::path from, boost::filesystem::path to, boost::uintmax_t& transferred, boost::uintmax_t total_size) override;
+	void upload_files (std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>> const& files, boost::uintmax_t& transferred, boost::uintmax_t total_size) override;
 
 private:
-	CURL* _curl;
+	CURL* make_handle ();
+	std::string url (boost::filesystem::path to) const;
+	boost::optional<boost::uintmax_t> remote_size (std::string url);
+	std::unique_ptr<Transfer> start (boost::filesystem::path from, boost::filesystem::path to);
 
-	FILE* _file = nullptr;
 	boost::uintmax_t* _transferred = nullptr;
 	boost::uintmax_t _total_size = 0;
 };
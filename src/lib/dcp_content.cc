@@ -116,9 +116,10 @@ DCPContent::DCPContent (cxml::ConstNodePtr node, int version)
 	_name = node->string_child ("Name");
 	_encrypted = node->bool_child ("Encrypted");
 	_needs_assets = node->optional_bool_child("NeedsAssets").get_value_or (false);
-	if (node->optional_node_child ("KDM")) {
-		_kdm = dcp::EncryptedKDM (node->string_child ("KDM"));
-	}
+	/* Parsing a KDM is quite slow, and many films with lots of DCPs in them will never use
+	   their KDMs in a given session, so keep the XML and parse it when it's needed.
+	*/
+	_kdm_xml = node->optional_string_child("KDM");
 	_kdm_valid = node->bool_child ("KDMValid");
 	_reference_video = node->optional_bool_child ("ReferenceVideo").get_value_or (false);
 	_reference_audio = node->optional_bool_child ("ReferenceAudio").get_value_or (false);
@@ -303,6 +304,7 @@ DCPContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 		_content_kind = examiner->content_kind ();
 		_cpl = examiner->cpl ();
 		_reel_lengths = examiner->reel_lengths ();
+		_reel_assets = boost::none;
 		for (auto const& i: examiner->markers()) {
 			_markers[i.first] = ContentTime(i.second.as_editable_units_ceil(DCPTime::HZ));
 		}
@@ -380,6 +382,8 @@ DCPContent::as_xml (xmlpp::Node* node, bool with_paths) const
 	node->add_child("NeedsAssets")->add_child_text (_needs_assets ? "1" : "0");
 	if (_kdm) {
 		node->add_child("KDM")->add_child_text (_kdm->as_xml ());
+	} else if (_kdm_xml) {
+		node->add_child("KDM")->add_child_text (*_kdm_xml);
 	}
 	node->add_child("KDMValid")->add_child_text (_kdm_valid ? "1" : "0");
 	node->add_child("ReferenceVideo")->add_child_text (_reference_video ? "1" : "0");
@@ -473,13 +477,30 @@ DCPContent::identifier () const
 void
 DCPContent::add_kdm (dcp::EncryptedKDM k)
 {
+	boost::mutex::scoped_lock lm (_mutex);
 	_kdm = k;
+	_kdm_xml = boost::none;
+	_reel_assets = boost::none;
+}
+
+
+optional<dcp::EncryptedKDM>
+DCPContent::kdm () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	if (_kdm_xml) {
+		_kdm = dcp::EncryptedKDM(*_kdm_xml);
+		_kdm_xml = boost::none;
+	}
+	return _kdm;
 }
 
 void
 DCPContent::add_ov (boost::filesystem::path ov)
 {
 	read_directory (ov);
+	boost::mutex::scoped_lock lm (_mutex);
+	_reel_assets = boost::none;
 }
 
 bool
@@ -565,12 +586,21 @@ DCPContent::set_reference_text (TextType type, bool r)
 list<DCPTimePeriod>
 DCPContent::reels (shared_ptr<const Film> film) const
 {
-	auto reel_lengths = _reel_lengths;
+	list<int64_t> reel_lengths;
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		reel_lengths = _reel_lengths;
+	}
+
 	if (reel_lengths.empty()) {
-		/* Old metadata with no reel lengths; get them here instead */
+		/* Old metadata with no reel lengths; get them here instead, and keep them
+		   so that we need not examine the DCP again.
+		*/
 		try {
 			scoped_ptr<DCPExaminer> examiner (new DCPExaminer(shared_from_this(), film->tolerant()));
 			reel_lengths = examiner->reel_lengths ();
+			boost::mutex::scoped_lock lm (_mutex);
+			_reel_lengths = reel_lengths;
 		} catch (...) {
 			/* Could not examine the DCP; guess reels */
 			reel_lengths.push_back (length_after_trim(film).frames_round(film->video_frame_rate()));
@@ -668,6 +698,57 @@ DCPContent::can_reference (shared_ptr<const Film> film, function<bool (shared_pt
 }
 
 
+/** @return Facts about the assets in our reels, or none if the DCP could not be read */
+optional<DCPContent::ReelAssets>
+DCPContent::reel_assets (shared_ptr<const Film> film) const
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		if (_reel_assets) {
+			return _reel_assets;
+		}
+	}
+
+	shared_ptr<DCPDecoder> decoder;
+	try {
+		decoder = make_shared<DCPDecoder>(film, shared_from_this(), false, film->tolerant(), shared_ptr<DCPDecoder>());
+	} catch (dcp::ReadError &) {
+		/* We couldn't read the DCP, so it's probably missing */
+		return {};
+	} catch (DCPError &) {
+		/* We couldn't read the DCP, so it's probably missing */
+		return {};
+	} catch (dcp::KDMDecryptionError &) {
+		/* We have an incorrect KDM */
+		return {};
+	}
+
+	ReelAssets assets;
+	for (auto i: decoder->reels()) {
+		if (!i->main_sound()) {
+			assets.all_have_sound = false;
+		}
+		if (!i->main_subtitle()) {
+			assets.all_have_open_subtitles = false;
+		} else if (i->main_subtitle()->entry_point().get_value_or(0) != 0) {
+			assets.open_subtitle_entry_points_zero = false;
+		}
+		if (i->closed_captions().empty()) {
+			assets.all_have_closed_captions = false;
+		}
+		for (auto j: i->closed_captions()) {
+			if (j->entry_point().get_value_or(0) != 0) {
+				assets.closed_caption_entry_points_zero = false;
+			}
+		}
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	_reel_assets = assets;
+	return assets;
+}
+
+
 bool
 DCPContent::can_reference_video (shared_ptr<const Film> film, string& why_not) const
 {
@@ -706,27 +787,16 @@ DCPContent::can_reference_video (shared_ptr<const Film> film, string& why_not) c
 bool
 DCPContent::can_reference_audio (shared_ptr<const Film> film, string& why_not) const
 {
-	shared_ptr<DCPDecoder> decoder;
-	try {
-		decoder = make_shared<DCPDecoder>(film, shared_from_this(), false, film->tolerant(), shared_ptr<DCPDecoder>());
-	} catch (dcp::ReadError &) {
-		/* We couldn't read the DCP, so it's probably missing */
-		return false;
-	} catch (DCPError &) {
-		/* We couldn't read the DCP, so it's probably missing */
-		return false;
-	} catch (dcp::KDMDecryptionError &) {
-		/* We have an incorrect KDM */
+	auto const assets = reel_assets(film);
+	if (!assets) {
 		return false;
 	}
 
-        for (auto i: decoder->reels()) {
-                if (!i->main_sound()) {
-			/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
-                        why_not = _("it does not have sound in all its reels.");
-                        return false;
-                }
-        }
+	if (!assets->all_have_sound) {
+		/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
+		why_not = _("it does not have sound in all its reels.");
+		return false;
+	}
 
 	/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
 	return can_reference(
@@ -742,44 +812,33 @@ DCPContent::can_reference_audio (shared_ptr<const Film> film, string& why_not) c
 bool
 DCPContent::can_reference_text (shared_ptr<const Film> film, TextType type, string& why_not) const
 {
-	shared_ptr<DCPDecoder> decoder;
-	try {
-		decoder = make_shared<DCPDecoder>(film, shared_from_this(), false, film->tolerant(), shared_ptr<DCPDecoder>());
-	} catch (dcp::ReadError &) {
-		/* We couldn't read the DCP, so it's probably missing */
-		return false;
-	} catch (dcp::KDMDecryptionError &) {
-		/* We have an incorrect KDM */
+	auto const assets = reel_assets(film);
+	if (!assets) {
 		return false;
 	}
 
-        for (auto i: decoder->reels()) {
-                if (type == TextType::OPEN_SUBTITLE) {
-			if (!i->main_subtitle()) {
-				/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
-				why_not = _("it does not have open subtitles in all its reels.");
-				return false;
-			} else if (i->main_subtitle()->entry_point().get_value_or(0) != 0) {
-				/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
-				why_not = _("one of its subtitle reels has a non-zero entry point so it must be re-written.");
-				return false;
-			}
-                }
-		if (type == TextType::CLOSED_CAPTION) {
-			if (i->closed_captions().empty()) {
-				/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
-				why_not = _("it does not have closed captions in all its reels.");
-				return false;
-			}
-			for (auto j: i->closed_captions()) {
-				if (j->entry_point().get_value_or(0) != 0) {
-					/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
-					why_not = _("one of its closed caption has a non-zero entry point so it must be re-written.");
-					return false;
-				}
-			}
+	if (type == TextType::OPEN_SUBTITLE) {
+		if (!assets->all_have_open_subtitles) {
+			/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
+			why_not = _("it does not have open subtitles in all its reels.");
+			return false;
+		} else if (!assets->open_subtitle_entry_points_zero) {
+			/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
+			why_not = _("one of its subtitle reels has a non-zero entry point so it must be re-written.");
+			return false;
+		}
+	}
+	if (type == TextType::CLOSED_CAPTION) {
+		if (!assets->all_have_closed_captions) {
+			/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
+			why_not = _("it does not have closed captions in all its reels.");
+			return false;
+		} else if (!assets->closed_caption_entry_points_zero) {
+			/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
+			why_not = _("one of its closed caption has a non-zero entry point so it must be re-written.");
+			return false;
 		}
-        }
+	}
 
 	if (trim_start() != dcpomatic::ContentTime()) {
 		/// TRANSLATORS: this string will follow "Cannot reference this DCP: "
@@ -826,18 +885,20 @@ DCPContent::set_cpl (string id)
 	{
 		boost::mutex::scoped_lock lm (_mutex);
 		_cpl = id;
+		_reel_assets = boost::none;
 	}
 }
 
 bool
 DCPContent::kdm_timing_window_valid () const
 {
-	if (!_kdm) {
+	auto const k = kdm();
+	if (!k) {
 		return true;
 	}
 
 	dcp::LocalTime now;
-	return _kdm->not_valid_before() < now && now < _kdm->not_valid_after();
+	return k->not_valid_before() < now && now < k->not_valid_after();
 }
 
 
@@ -92,9 +92,7 @@ public:
 	void add_kdm (dcp::EncryptedKDM);
 	void add_ov (boost::filesystem::path ov);
 
-	boost::optional<dcp::EncryptedKDM> kdm () const {
-		return _kdm;
-	}
+	boost::optional<dcp::EncryptedKDM> kdm () const;
 
 	bool can_be_played () const override;
 	bool needs_kdm () const;
@@ -193,12 +191,29 @@ private:
 		std::string& why_not
 		) const;
 
+	/** Facts about the assets in our reels which decide whether parts of the DCP can be referenced */
+	struct ReelAssets
+	{
+		bool all_have_sound = true;
+		bool all_have_open_subtitles = true;
+		bool open_subtitle_entry_points_zero = true;
+		bool all_have_closed_captions = true;
+		bool closed_caption_entry_points_zero = true;
+	};
+
+	boost::optional<ReelAssets> reel_assets (std::shared_ptr<const Film> film) const;
+
 	std::string _name;
 	/** true if our DCP is encrypted */
 	bool _encrypted;
 	/** true if this DCP needs more assets before it can be played */
 	bool _needs_assets;
-	boost::optional<dcp::EncryptedKDM> _kdm;
+	/** Our KDM; if it came from metadata it is not parsed until it is needed, so this is
+	 *  mutable so that kdm() can fill it in from _kdm_xml.
+	 */
+	mutable boost::optional<dcp::EncryptedKDM> _kdm;
+	/** XML of a KDM from our metadata which has not yet been parsed into _kdm */
+	mutable boost::optional<std::string> _kdm_xml;
 	/** true if _kdm successfully decrypts the first frame of our DCP */
 	bool _kdm_valid;
 	/** true if the video in this DCP should be included in the output by reference
@@ -222,8 +237,14 @@ private:
 	 *  just use the only CPL.
 	 */
 	boost::optional<std::string> _cpl;
-	/** List of the lengths of the reels in this DCP */
-	std::list<int64_t> _reel_lengths;
+	/** List of the lengths of the reels in this DCP; this is mutable so that reels()
+	 *  can fill it in for old metadata which did not have it.
+	 */
+	mutable std::list<int64_t> _reel_lengths;
+	/** Cache of reel_assets(), which must read our CPL; reset whenever that might
+	 *  give a different answer.
+	 */
+	mutable boost::optional<ReelAssets> _reel_assets;
 	std::map<dcp::Marker, dcpomatic::ContentTime> _markers;
 	std::vector<dcp::Rating> _ratings;
 	std::vector<std::string> _content_versions;
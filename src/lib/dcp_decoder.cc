@@ -24,6 +24,7 @@
 #include "audio_decoder.h"
 #include "config.h"
 #include "constants.h"
+#include "cpl_cache.h"
 #include "dcp_content.h"
 #include "dcp_decoder.h"
 #include "digester.h"
@@ -36,6 +37,7 @@
 #include <dcp/cpl.h>
 #include <dcp/dcp.h>
 #include <dcp/decrypted_kdm.h>
+#include <dcp/filesystem.h>
 #include <dcp/mono_picture_asset.h>
 #include <dcp/mono_picture_asset_reader.h>
 #include <dcp/mono_picture_frame.h>
@@ -45,7 +47,6 @@
 #include <dcp/reel_picture_asset.h>
 #include <dcp/reel_sound_asset.h>
 #include <dcp/reel_subtitle_asset.h>
-#include <dcp/search.h>
 #include <dcp/sound_asset_reader.h>
 #include <dcp/sound_frame.h>
 #include <dcp/stereo_picture_asset.h>
@@ -62,6 +63,8 @@ using std::dynamic_pointer_cast;
 using std::list;
 using std::make_shared;
 using std::map;
+using std::max;
+using std::min;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -69,6 +72,10 @@ using boost::optional;
 using namespace dcpomatic;
 
 
+/** Maximum number of picture frames to read ahead of the decode position */
+static int constexpr maximum_read_ahead_frames = 240;
+
+
 DCPDecoder::DCPDecoder (shared_ptr<const Film> film, shared_ptr<const DCPContent> content, bool fast, bool tolerant, shared_ptr<DCPDecoder> old)
 	: Decoder (film)
 	, _dcp_content (content)
@@ -106,7 +113,7 @@ DCPDecoder::DCPDecoder (shared_ptr<const Film> film, shared_ptr<const DCPContent
 		_reels = old->_reels;
 	} else {
 
-		auto cpl_list = dcp::find_and_resolve_cpls(content->directories(), tolerant);
+		auto cpl_list = find_and_resolve_cpls_cached(content->directories(), tolerant);
 
 		if (cpl_list.empty()) {
 			throw DCPError (_("No CPLs found in DCP."));
@@ -176,7 +183,7 @@ DCPDecoder::pass ()
 			video->emit (
 				film(),
 				std::make_shared<J2KImageProxy>(
-					_mono_reader->get_frame (entry_point + frame),
+					_mono_reader->get (entry_point + frame),
 					picture_asset->size(),
 					AV_PIX_FMT_XYZ12LE,
 					_forced_reduction
@@ -184,10 +191,13 @@ DCPDecoder::pass ()
 				_offset + frame
 				);
 		} else {
+			/* Read the frame once; both eyes' proxies refer to the same data */
+			auto stereo_frame = _stereo_reader->get (entry_point + frame);
+
 			video->emit (
 				film(),
 				std::make_shared<J2KImageProxy>(
-					_stereo_reader->get_frame (entry_point + frame),
+					stereo_frame,
 					picture_asset->size(),
 					dcp::Eye::LEFT,
 					AV_PIX_FMT_XYZ12LE,
@@ -199,7 +209,7 @@ DCPDecoder::pass ()
 			video->emit (
 				film(),
 				std::make_shared<J2KImageProxy>(
-					_stereo_reader->get_frame (entry_point + frame),
+					stereo_frame,
 					picture_asset->size(),
 					dcp::Eye::RIGHT,
 					AV_PIX_FMT_XYZ12LE,
@@ -377,14 +387,32 @@ DCPDecoder::get_readers ()
 		auto mono = dynamic_pointer_cast<dcp::MonoPictureAsset> (asset);
 		auto stereo = dynamic_pointer_cast<dcp::StereoPictureAsset> (asset);
 		DCPOMATIC_ASSERT (mono || stereo);
+
+		/* Work out how many frames to read ahead, so that slow storage doesn't hold us up */
+		int read_ahead = 0;
+		auto const read_ahead_bytes = static_cast<int64_t>(Config::instance()->dcp_read_ahead()) * 1024 * 1024;
+		if (read_ahead_bytes > 0 && asset->file() && asset->intrinsic_duration() > 0) {
+			try {
+				auto const frame_size = max(static_cast<int64_t>(1), static_cast<int64_t>(dcp::filesystem::file_size(asset->file().get())) / asset->intrinsic_duration());
+				read_ahead = min(static_cast<int64_t>(maximum_read_ahead_frames), max(static_cast<int64_t>(1), read_ahead_bytes / frame_size));
+			} catch (...) {
+				/* Never mind; we just won't read ahead */
+			}
+		}
+
 		if (mono) {
-			_mono_reader = mono->start_read ();
-			_mono_reader->set_check_hmac (false);
+			auto reader = mono->start_read ();
+			reader->set_check_hmac (false);
 			_stereo_reader.reset ();
+			/* Stop any existing read-ahead before starting a new one */
+			_mono_reader.reset ();
+			_mono_reader = make_shared<FramePrefetcher<dcp::MonoPictureAssetReader, dcp::MonoPictureFrame>>(reader, asset->intrinsic_duration(), read_ahead);
 		} else {
-			_stereo_reader = stereo->start_read ();
-			_stereo_reader->set_check_hmac (false);
+			auto reader = stereo->start_read ();
+			reader->set_check_hmac (false);
 			_mono_reader.reset ();
+			_stereo_reader.reset ();
+			_stereo_reader = make_shared<FramePrefetcher<dcp::StereoPictureAssetReader, dcp::StereoPictureFrame>>(reader, asset->intrinsic_duration(), read_ahead);
 		}
 	} else {
 		_mono_reader.reset ();
@@ -27,6 +27,7 @@
 #include "atmos_metadata.h"
 #include "decoder.h"
 #include "font_id_allocator.h"
+#include "frame_prefetcher.h"
 #include <dcp/mono_picture_asset_reader.h>
 #include <dcp/stereo_picture_asset_reader.h>
 #include <dcp/sound_asset_reader.h>
@@ -94,10 +95,10 @@ private:
 	std::vector<std::shared_ptr<dcp::Reel>>::iterator _reel;
 	/** Offset of _reel from the start of the content in frames */
 	int64_t _offset = 0;
-	/** Reader for current mono picture asset, if applicable */
-	std::shared_ptr<dcp::MonoPictureAssetReader> _mono_reader;
-	/** Reader for current stereo picture asset, if applicable */
-	std::shared_ptr<dcp::StereoPictureAssetReader> _stereo_reader;
+	/** Reader (with read-ahead) for current mono picture asset, if applicable */
+	std::shared_ptr<FramePrefetcher<dcp::MonoPictureAssetReader, dcp::MonoPictureFrame>> _mono_reader;
+	/** Reader (with read-ahead) for current stereo picture asset, if applicable */
+	std::shared_ptr<FramePrefetcher<dcp::StereoPictureAssetReader, dcp::StereoPictureFrame>> _stereo_reader;
 	/** Reader for current sound asset, if applicable */
 	std::shared_ptr<dcp::SoundAssetReader> _sound_reader;
 	std::shared_ptr<dcp::AtmosAssetReader> _atmos_reader;
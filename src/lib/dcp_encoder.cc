@@ -25,7 +25,9 @@
  *  as a parameter to the constructor.
  */
 
+#include "config.h"
 #include "dcp_encoder.h"
+#include "dcpomatic_log.h"
 #include "j2k_encoder.h"
 #include "film.h"
 #include "video_decoder.h"
@@ -35,8 +37,10 @@
 #include "writer.h"
 #include "compose.hpp"
 #include "referenced_reel_asset.h"
+#include "review_export.h"
 #include "text_content.h"
 #include "player_video.h"
+#include "scope_guard.h"
 #include <boost/signals2.hpp>
 #include <iostream>
 
@@ -82,6 +86,17 @@ DCPEncoder::DCPEncoder (shared_ptr<const Film> film, weak_ptr<Job> job)
 	}
 }
 
+/** Make an export from the same Player pass as the DCP.  This must be called before go(),
+ *  and only if ReviewExport::possible() is true for our film.
+ */
+void
+DCPEncoder::add_export (shared_ptr<ReviewExport> review_export)
+{
+	DCPOMATIC_ASSERT (ReviewExport::possible(_film));
+	_exports.push_back(review_export);
+}
+
+
 DCPEncoder::~DCPEncoder ()
 {
 	/* We must stop receiving more video data before we die */
@@ -97,6 +112,10 @@ DCPEncoder::go ()
 	_writer.start();
 	_j2k_encoder.begin();
 
+	for (auto i: _exports) {
+		i->start(_film);
+	}
+
 	{
 		auto job = _job.lock ();
 		DCPOMATIC_ASSERT (job);
@@ -107,7 +126,17 @@ DCPEncoder::go ()
 		_writer.write(_player.get_subtitle_fonts());
 	}
 
-	while (!_player.pass()) {}
+	/* Don't bother splitting into chunks of less than this length, since each chunk's player
+	 * has to seek to its start.
+	 */
+	auto const min_chunk = DCPTime::from_seconds(10);
+	auto const chunks = std::min(static_cast<int64_t>(Config::instance()->dcp_encode_chunks()), _film->length().get() / min_chunk.get());
+	/* Exports need their video in order, so they can't be made from chunks */
+	if (chunks > 1 && _exports.empty()) {
+		go_chunked (chunks);
+	} else {
+		while (!_player.pass()) {}
+	}
 
 	for (auto i: get_referenced_reel_assets(_film, _film->playlist())) {
 		_writer.write(i);
@@ -115,20 +144,139 @@ DCPEncoder::go ()
 
 	_finishing = true;
 	_j2k_encoder.end();
+
+	for (auto i: _exports) {
+		i->flush();
+	}
+
+	if (auto job = _job.lock()) {
+		job->set_finishing ();
+	}
+
 	_writer.finish(_film->dir(_film->dcp_name()));
 }
 
+/** Split the film into some chunks and make the video for each one with its own Player,
+ *  all at the same time.  The Writer is happy to receive video out of order, but not audio,
+ *  text or Atmos, so _player makes all those (which is usually quick) without any video.
+ */
+void
+DCPEncoder::go_chunked (int chunks)
+{
+	_chunked = true;
+	_player.set_ignore_video ();
+
+	auto const length = _film->length().frames_round(_film->video_frame_rate());
+	vector<DCPTimePeriod> periods;
+	for (int i = 0; i < chunks; ++i) {
+		periods.push_back(
+			DCPTimePeriod(
+				DCPTime::from_frames(length * i / chunks, _film->video_frame_rate()),
+				DCPTime::from_frames(length * (i + 1) / chunks, _film->video_frame_rate())
+				)
+			);
+	}
+
+	LOG_GENERAL("Encoding video in %1 chunks", chunks);
+
+	boost::mutex exception_mutex;
+	boost::exception_ptr exception;
+
+	boost::thread_group group;
+	for (auto period: periods) {
+		group.create_thread([this, period, &exception_mutex, &exception]() {
+			try {
+				encode_chunk (period);
+			} catch (...) {
+				boost::mutex::scoped_lock lm (exception_mutex);
+				if (!exception) {
+					exception = boost::current_exception();
+				}
+				_stop_chunks = true;
+			}
+		});
+	}
+
+	ScopeGuard sg = [this, &group]() {
+		/* Make sure that the chunk threads have finished before we go, even if we
+		 * have been interrupted.
+		 */
+		boost::this_thread::disable_interruption dis;
+		_stop_chunks = true;
+		group.interrupt_all ();
+		group.join_all ();
+	};
+
+	while (!_player.pass() && !_stop_chunks) {}
+
+	group.join_all ();
+
+	if (exception) {
+		boost::rethrow_exception (exception);
+	}
+}
+
+
+/** Make the video for part of the film with a Player of its own, and pass it to the J2KEncoder */
+void
+DCPEncoder::encode_chunk (DCPTimePeriod period)
+{
+	Player player(_film, Image::Alignment::PADDED);
+	player.set_ignore_audio ();
+
+	auto const length = _film->length().frames_round(_film->video_frame_rate());
+	bool done = false;
+
+	boost::signals2::scoped_connection connection = player.Video.connect(
+		[this, period, length, &done](shared_ptr<PlayerVideo> data, DCPTime time) {
+			if (time >= period.to) {
+				done = true;
+				return;
+			}
+			if (time < period.from) {
+				return;
+			}
+
+			_j2k_encoder.encode(data, time);
+
+			auto job = _job.lock ();
+			if (job) {
+				job->set_progress (float(_j2k_encoder.video_frames_enqueued()) / length);
+			}
+		});
+
+	if (period.from != DCPTime()) {
+		player.seek (period.from, true);
+	}
+
+	while (!done && !_stop_chunks && !player.pass()) {}
+}
+
+
 void
 DCPEncoder::video (shared_ptr<PlayerVideo> data, DCPTime time)
 {
 	_j2k_encoder.encode(data, time);
+
+	for (auto i: _exports) {
+		i->video(data, time);
+	}
 }
 
 void
 DCPEncoder::audio (shared_ptr<AudioBuffers> data, DCPTime time)
 {
+	for (auto i: _exports) {
+		i->audio(data);
+	}
+
 	_writer.write(data, time);
 
+	if (_chunked) {
+		/* Progress comes from the chunks' video instead */
+		return;
+	}
+
 	auto job = _job.lock ();
 	DCPOMATIC_ASSERT (job);
 	job->set_progress (float(time.get()) / _film->length().get());
@@ -161,3 +309,15 @@ DCPEncoder::frames_done () const
 {
 	return _j2k_encoder.video_frames_enqueued();
 }
+
+
+vector<Metric>
+DCPEncoder::metrics () const
+{
+	auto metrics = Encoder::metrics();
+	auto j2k = _j2k_encoder.metrics();
+	metrics.insert(metrics.end(), j2k.begin(), j2k.end());
+	auto writer = _writer.metrics();
+	metrics.insert(metrics.end(), writer.begin(), writer.end());
+	return metrics;
+}
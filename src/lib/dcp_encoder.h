@@ -27,6 +27,7 @@
 #include "j2k_encoder.h"
 #include "writer.h"
 #include <dcp/atmos_frame.h>
+#include <atomic>
 
 
 class AudioBuffers;
@@ -34,6 +35,7 @@ class Film;
 class Job;
 class Player;
 class PlayerVideo;
+class ReviewExport;
 
 
 /** @class DCPEncoder */
@@ -43,10 +45,13 @@ public:
 	DCPEncoder (std::shared_ptr<const Film> film, std::weak_ptr<Job> job);
 	~DCPEncoder ();
 
+	void add_export (std::shared_ptr<ReviewExport> review_export);
+
 	void go () override;
 
 	boost::optional<float> current_rate () const override;
 	Frame frames_done () const override;
+	std::vector<Metric> metrics () const override;
 
 	/** @return true if we are in the process of calling Encoder::process_end */
 	bool finishing () const override {
@@ -59,11 +64,19 @@ private:
 	void audio (std::shared_ptr<AudioBuffers>, dcpomatic::DCPTime);
 	void text (PlayerText, TextType, boost::optional<DCPTextTrack>, dcpomatic::DCPTimePeriod);
 	void atmos (std::shared_ptr<const dcp::AtmosFrame>, dcpomatic::DCPTime, AtmosMetadata metadata);
+	void go_chunked (int chunks);
+	void encode_chunk (dcpomatic::DCPTimePeriod period);
 
 	Writer _writer;
 	J2KEncoder _j2k_encoder;
 	bool _finishing;
 	bool _non_burnt_subtitles;
+	/** Files to export from the same pass as the DCP */
+	std::vector<std::shared_ptr<ReviewExport>> _exports;
+	/** true if video is coming from several chunk players rather than _player */
+	bool _chunked = false;
+	/** set to true to ask chunk threads to stop */
+	std::atomic<bool> _stop_chunks{false};
 
 	boost::signals2::scoped_connection _player_video_connection;
 	boost::signals2::scoped_connection _player_audio_connection;
@@ -21,6 +21,7 @@
 
 #include "config.h"
 #include "constants.h"
+#include "cpl_cache.h"
 #include "dcp_content.h"
 #include "dcp_examiner.h"
 #include "dcpomatic_log.h"
@@ -41,7 +42,6 @@
 #include <dcp/reel_picture_asset.h>
 #include <dcp/reel_sound_asset.h>
 #include <dcp/reel_subtitle_asset.h>
-#include <dcp/search.h>
 #include <dcp/sound_asset.h>
 #include <dcp/sound_asset.h>
 #include <dcp/sound_asset_reader.h>
@@ -63,11 +63,23 @@ using std::vector;
 using boost::optional;
 
 
+/** @return true if some data starts with the markers that every JPEG2000 codestream begins with (SOC then SIZ).
+ *  This is enough to tell whether an encrypted frame was decrypted with the right key, since data decrypted
+ *  with the wrong one is noise.
+ */
+static
+bool
+looks_like_j2k (uint8_t const* data, int size)
+{
+	return size >= 4 && data[0] == 0xff && data[1] == 0x4f && data[2] == 0xff && data[3] == 0x51;
+}
+
+
 DCPExaminer::DCPExaminer (shared_ptr<const DCPContent> content, bool tolerant)
 {
 	shared_ptr<dcp::CPL> selected_cpl;
 
-	auto cpls = dcp::find_and_resolve_cpls (content->directories(), tolerant);
+	auto cpls = find_and_resolve_cpls_cached(content->directories(), tolerant);
 
 	if (content->cpl ()) {
 		/* Use the CPL that was specified, or that the content was using before */
@@ -298,14 +310,26 @@ DCPExaminer::DCPExaminer (shared_ptr<const DCPContent> content, bool tolerant)
 			auto mono = dynamic_pointer_cast<dcp::MonoPictureAsset>(pic);
 			auto stereo = dynamic_pointer_cast<dcp::StereoPictureAsset>(pic);
 
+			/* Just look at the start of the first frame rather than decoding it, as a full-resolution
+			 * JPEG2000 decode of every reel makes examining big DCPs slow.
+			 */
+			bool decrypted = true;
 			if (mono) {
 				auto reader = mono->start_read();
 				reader->set_check_hmac (false);
-				reader->get_frame(0)->xyz_image();
+				auto frame = reader->get_frame(0);
+				decrypted = looks_like_j2k(frame->data(), frame->size());
 			} else {
 				auto reader = stereo->start_read();
 				reader->set_check_hmac (false);
-				reader->get_frame(0)->xyz_image(dcp::Eye::LEFT);
+				auto frame = reader->get_frame(0)->left();
+				decrypted = looks_like_j2k(frame->data(), frame->size());
+			}
+
+			if (!decrypted) {
+				_kdm_valid = false;
+				LOG_GENERAL_NC ("Picture could not be decrypted");
+				break;
 			}
 
 			if (i->main_sound()) {
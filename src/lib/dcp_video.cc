@@ -36,12 +36,17 @@
 #include "dcp_video.h"
 #include "dcpomatic_log.h"
 #include "dcpomatic_socket.h"
+#include "digester.h"
 #include "encode_server_description.h"
+#include "encoding_request.h"
 #include "exceptions.h"
+#include "fast_rgb_to_xyz.h"
 #include "image.h"
+#include "j2k_compress.h"
 #include "log.h"
 #include "player_video.h"
 #include "rng.h"
+#include "xyz_image_pool.h"
 #include <libcxml/cxml.h>
 #include <dcp/raw_convert.h>
 #include <dcp/openjpeg_image.h>
@@ -84,12 +89,14 @@ DCPVideo::DCPVideo (
 	, _frames_per_second (dcp_fps)
 	, _j2k_bandwidth (bw)
 	, _resolution (r)
+	, _prepared (make_shared<Prepared>())
 {
 
 }
 
 DCPVideo::DCPVideo (shared_ptr<const PlayerVideo> frame, shared_ptr<const cxml::Node> node)
 	: _frame (frame)
+	, _prepared (make_shared<Prepared>())
 {
 	_index = node->number_child<int> ("Index");
 	_frames_per_second = node->number_child<int> ("FramesPerSecond");
@@ -97,32 +104,103 @@ DCPVideo::DCPVideo (shared_ptr<const PlayerVideo> frame, shared_ptr<const cxml::
 	_resolution = Resolution (node->optional_number_child<int>("Resolution").get_value_or(static_cast<int>(Resolution::TWO_K)));
 }
 
+/** Construct a DCPVideo from the binary form of an encoding request.  frame should have been
+ *  made from the same reader, as the PlayerVideo's details come first.
+ */
+DCPVideo::DCPVideo (shared_ptr<const PlayerVideo> frame, EncodingRequestReader& reader)
+	: _frame (frame)
+	, _prepared (make_shared<Prepared>())
+{
+	_index = reader.read_int();
+	_frames_per_second = reader.read_int();
+	_j2k_bandwidth = reader.read_int();
+	_resolution = static_cast<Resolution>(reader.read_int());
+}
+
 shared_ptr<dcp::OpenJPEGImage>
 DCPVideo::convert_to_xyz (shared_ptr<const PlayerVideo> frame)
 {
-	shared_ptr<dcp::OpenJPEGImage> xyz;
+	/* Try first to do the conversion to XYZ as the image is scaled */
+	auto xyz = frame->xyz_image();
+	if (xyz) {
+		return xyz;
+	}
 
 	auto image = frame->image (bind(&PlayerVideo::keep_xyz_or_rgb, _1), VideoRange::FULL, false);
 	if (frame->colour_conversion()) {
-		xyz = dcp::rgb_to_xyz (
+		xyz = fast_rgb_to_xyz (
 			image->data()[0],
 			image->size(),
 			image->stride()[0],
 			frame->colour_conversion().get()
 			);
 	} else {
-		xyz = make_shared<dcp::OpenJPEGImage>(image->data()[0], image->size(), image->stride()[0]);
+		/* The image is already XYZ, in 16 bits */
+		auto const size = image->size();
+		xyz = pooled_xyz_image(size);
+		auto x = xyz->data(0);
+		auto y = xyz->data(1);
+		auto z = xyz->data(2);
+		for (int line = 0; line < size.height; ++line) {
+			auto p = reinterpret_cast<uint16_t const*>(image->data()[0] + line * image->stride()[0]);
+			for (int i = 0; i < size.width; ++i) {
+				*x++ = *p++ >> 4;
+				*y++ = *p++ >> 4;
+				*z++ = *p++ >> 4;
+			}
+		}
 	}
 
 	return xyz;
 }
 
+/** Make the XYZ image that encode_locally() will need, so that it is ready when a
+ *  worker gets to this frame.  Nothing is done if the frame has already been taken by
+ *  a worker or sent to a server.  This may be called from any thread.
+ */
+void
+DCPVideo::prepare () const
+{
+	boost::mutex::scoped_lock lm (_prepared->mutex);
+	if (!_prepared->finished && !_prepared->xyz) {
+		_prepared->xyz = convert_to_xyz(_frame);
+	}
+}
+
+
+/** @return The XYZ image made by prepare(), if there is one, otherwise a new one.
+ *  The image belongs to the caller, who may modify it.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+DCPVideo::take_xyz () const
+{
+	{
+		boost::mutex::scoped_lock lm (_prepared->mutex);
+		_prepared->finished = true;
+		if (_prepared->xyz) {
+			auto xyz = _prepared->xyz;
+			_prepared->xyz.reset ();
+			return xyz;
+		}
+	}
+
+	return convert_to_xyz(_frame);
+}
+
+
 /** J2K-encode this frame on the local host.
+ *  @param threads Number of threads to use within the frame, if OpenJPEG supports that.
+ *  @param noise_retries If non-null, filled in with the number of times that the frame had
+ *  to be encoded again with added noise because it came out too small.
  *  @return Encoded data.
  */
 ArrayData
-DCPVideo::encode_locally () const
+DCPVideo::encode_locally (int threads, int* noise_retries) const
 {
+	if (noise_retries) {
+		*noise_retries = 0;
+	}
+
 	auto const comment = Config::instance()->dcp_j2k_comment();
 
 	ArrayData enc = {};
@@ -130,17 +208,20 @@ DCPVideo::encode_locally () const
 	int const minimum_size = 16384;
 	LOG_DEBUG_ENCODE("Using minimum frame size %1", minimum_size);
 
-	auto xyz = convert_to_xyz(_frame);
+	auto xyz = take_xyz();
+	/* Unmodified copy of xyz, made if we need to retry with added noise */
+	shared_ptr<dcp::OpenJPEGImage> pristine;
 	int noise_amount = 2;
 	int pixel_skip = 16;
 	while (true) {
-		enc = dcp::compress_j2k (
+		enc = compress_j2k (
 			xyz,
 			_j2k_bandwidth,
 			_frames_per_second,
 			_frame->eyes() == Eyes::LEFT || _frame->eyes() == Eyes::RIGHT,
 			_resolution == Resolution::FOUR_K,
-			comment.empty() ? "libdcp" : comment
+			comment.empty() ? "libdcp" : comment,
+			threads
 		);
 
 		if (enc.size() >= minimum_size) {
@@ -149,13 +230,20 @@ DCPVideo::encode_locally () const
 		}
 
 		LOG_GENERAL (N_("Frame %1 encoded size was small (%2); adding noise at level %3 with pixel skip %4"), _index, enc.size(), noise_amount, pixel_skip);
+		if (noise_retries) {
+			++*noise_retries;
+		}
 
 		/* The JPEG2000 is too low-bitrate for some decoders <cough>DSS200</cough> so add some noise
-		 * and try again.  This is slow but hopefully won't happen too often.  We have to do
-		 * convert_to_xyz() again because compress_j2k() corrupts its xyz parameter.
+		 * and try again.  This is slow but hopefully won't happen too often.  We have to start
+		 * from a fresh XYZ image each time because compress_j2k() corrupts its xyz parameter,
+		 * but we only need to do convert_to_xyz() once; after that we copy the result.
 		 */
 
-		xyz = convert_to_xyz(_frame);
+		if (!pristine) {
+			pristine = convert_to_xyz(_frame);
+		}
+		xyz = make_shared<dcp::OpenJPEGImage>(*pristine);
 		auto size = xyz->size ();
 		auto pixels = size.width * size.height;
 		dcpomatic::RNG rng(42);
@@ -201,10 +289,32 @@ DCPVideo::encode_locally () const
  */
 ArrayData
 DCPVideo::encode_remotely (EncodeServerDescription serv, int timeout) const
+{
+	auto socket = connect_to_server (serv, timeout);
+	send_to_server (socket, serv.transport_compression());
+	auto encoded = collect_from_server (socket);
+	if (encoded.busy_retry > 0) {
+		throw NetworkError (String::compose("Server is too busy; try again in %1ms", encoded.busy_retry));
+	}
+	if (encoded.index != _index || encoded.eyes != eyes()) {
+		throw NetworkError ("Server sent back the wrong frame");
+	}
+
+	return encoded.data;
+}
+
+
+/** Open a connection to an encoding server.  The connection can then be used to send
+ *  any number of frames with send_to_server(), and get them back with collect_from_server().
+ *  @param server Server to connect to.
+ *  @param timeout timeout in seconds.
+ */
+shared_ptr<Socket>
+DCPVideo::connect_to_server (EncodeServerDescription server, int timeout)
 {
 	boost::asio::io_service io_service;
 	boost::asio::ip::tcp::resolver resolver (io_service);
-	boost::asio::ip::tcp::resolver::query query (serv.host_name(), raw_convert<string> (ENCODE_FRAME_PORT));
+	boost::asio::ip::tcp::resolver::query query (server.host_name(), raw_convert<string> (ENCODE_FRAME_PORT));
 	boost::asio::ip::tcp::resolver::iterator endpoint_iterator = resolver.resolve (query);
 
 	auto socket = make_shared<Socket>(timeout);
@@ -212,15 +322,66 @@ DCPVideo::encode_remotely (EncodeServerDescription serv, int timeout) const
 
 	socket->connect (*endpoint_iterator);
 
-	/* Collect all XML metadata */
-	xmlpp::Document doc;
-	auto root = doc.create_root_node ("EncodingRequest");
-	root->add_child("Version")->add_child_text (raw_convert<string> (SERVER_LINK_VERSION));
-	add_metadata (root);
+	if (server.transport_checksum() != TransportChecksum::MD5) {
+		/* Servers which don't advertise anything else only know about MD5, so only
+		 * try to change it if we know that the other end will understand.
+		 */
+		socket->write (static_cast<uint32_t>(EncodeServerCommand::SET_CHECKSUM));
+		socket->write (static_cast<uint32_t>(server.transport_checksum()));
+		socket->set_checksum (server.transport_checksum());
+	}
 
+	return socket;
+}
+
+
+/** Send this frame to a connection opened by connect_to_server().  This does not wait
+ *  for the frame to be encoded; call collect_from_server() to get an encoded frame back.
+ */
+void
+DCPVideo::send_to_server (shared_ptr<Socket> socket, TransportCompression compression, EncodingRequestFormat format) const
+{
 	LOG_DEBUG_ENCODE (N_("Sending frame %1 to remote"), _index);
 
 	{
+		/* The server will make its own XYZ */
+		boost::mutex::scoped_lock lm (_prepared->mutex);
+		_prepared->finished = true;
+		_prepared->xyz.reset ();
+	}
+
+	switch (format) {
+	case EncodingRequestFormat::BINARY:
+	{
+		EncodingRequestWriter writer;
+		writer.write_uint(SERVER_LINK_VERSION);
+		writer.write_uint(static_cast<uint32_t>(compression));
+		add_metadata (writer);
+
+		socket->write (static_cast<uint32_t>(EncodeServerCommand::ENCODE_BINARY));
+
+		Socket::WriteDigestScope ds (socket);
+
+		socket->write(static_cast<uint32_t>(writer.data().size()));
+		socket->write(writer.data().data(), writer.data().size());
+
+		LOG_TIMING("start-remote-send thread=%1", thread_id ());
+		_frame->write_to_socket (socket, compression);
+		break;
+	}
+	case EncodingRequestFormat::XML:
+	{
+		/* Collect all XML metadata */
+		xmlpp::Document doc;
+		auto root = doc.create_root_node ("EncodingRequest");
+		root->add_child("Version")->add_child_text (raw_convert<string> (SERVER_LINK_VERSION));
+		if (compression == TransportCompression::ZSTD) {
+			root->add_child("Compression")->add_child_text("zstd");
+		}
+		add_metadata (root);
+
+		socket->write (static_cast<uint32_t>(EncodeServerCommand::ENCODE));
+
 		Socket::WriteDigestScope ds (socket);
 
 		/* Send XML metadata */
@@ -230,27 +391,71 @@ DCPVideo::encode_remotely (EncodeServerDescription serv, int timeout) const
 
 		/* Send binary data */
 		LOG_TIMING("start-remote-send thread=%1", thread_id ());
-		_frame->write_to_socket (socket);
+		_frame->write_to_socket (socket, compression);
+		break;
 	}
+	}
+}
+
+
+/** Ask a server for the next frame that it finishes encoding, and read it.  The frames
+ *  sent to a connection may come back in any order.
+ *  @param verify true to check the data against the hash that the server sent; if this is false
+ *  the caller should check the hash some other way.
+ */
+DCPVideo::RemotelyEncoded
+DCPVideo::collect_from_server (shared_ptr<Socket> socket, bool verify)
+{
+	socket->write (static_cast<uint32_t>(EncodeServerCommand::COLLECT));
 
 	/* Read the response (JPEG2000-encoded data); this blocks until the data
 	   is ready and sent back.
 	*/
 	Socket::ReadDigestScope ds (socket);
 	LOG_TIMING("start-remote-encode thread=%1", thread_id ());
+	auto const index = static_cast<int>(socket->read_uint32());
+	auto const eyes = static_cast<Eyes>(socket->read_uint32());
+	auto const busy_retry = static_cast<int>(socket->read_uint32());
 	ArrayData e (socket->read_uint32 ());
+	char hash[MD5_DIGEST_SIZE * 2];
+	socket->read (reinterpret_cast<uint8_t*>(hash), sizeof(hash));
+	if (!ds.check()) {
+		throw NetworkError ("Checksums do not match");
+	}
+
 	LOG_TIMING("start-remote-receive thread=%1", thread_id ());
 	socket->read (e.data(), e.size());
 	LOG_TIMING("finish-remote-receive thread=%1", thread_id ());
-	if (!ds.check()) {
+
+	if (busy_retry > 0) {
+		LOG_DEBUG_ENCODE (N_("Server too busy for frame %1; retry in %2ms"), index, busy_retry);
+		return { index, eyes, e, string(hash, sizeof(hash)), busy_retry };
+	}
+
+	if (e.size() == 0) {
+		throw NetworkError (String::compose("Server failed to encode frame %1", index));
+	}
+
+	RemotelyEncoded encoded = { index, eyes, e, string(hash, sizeof(hash)), 0 };
+	if (verify && !encoded.check()) {
 		throw NetworkError ("Checksums do not match");
 	}
 
-	LOG_DEBUG_ENCODE (N_("Finished remotely-encoded frame %1"), _index);
+	LOG_DEBUG_ENCODE (N_("Finished remotely-encoded frame %1"), index);
 
-	return e;
+	return encoded;
 }
 
+
+bool
+DCPVideo::RemotelyEncoded::check () const
+{
+	Digester digester;
+	digester.add (data.data(), data.size());
+	return digester.get() == hash;
+}
+
+
 void
 DCPVideo::add_metadata (xmlpp::Element* el) const
 {
@@ -261,6 +466,19 @@ DCPVideo::add_metadata (xmlpp::Element* el) const
 	_frame->add_metadata (el);
 }
 
+/** Write the same information as add_metadata(xmlpp::Element*) in binary form.
+ *  The frame comes first so that the server can read it before our own details.
+ */
+void
+DCPVideo::add_metadata (EncodingRequestWriter& writer) const
+{
+	_frame->add_metadata (writer);
+	writer.write_int(_index);
+	writer.write_int(_frames_per_second);
+	writer.write_int(_j2k_bandwidth);
+	writer.write_int(static_cast<int>(_resolution));
+}
+
 Eyes
 DCPVideo::eyes () const
 {
@@ -24,6 +24,7 @@
 #include <libcxml/cxml.h>
 #include <dcp/array_data.h>
 #include <dcp/openjpeg_image.h>
+#include <boost/thread/mutex.hpp>
 
 
 /** @file  src/dcp_video_frame.h
@@ -31,8 +32,11 @@
  */
 
 
+class EncodingRequestReader;
+class EncodingRequestWriter;
 class Log;
 class PlayerVideo;
+class Socket;
 
 
 /** @class DCPVideo
@@ -49,19 +53,62 @@ class DCPVideo
 public:
 	DCPVideo (std::shared_ptr<const PlayerVideo>, int index, int dcp_fps, int bandwidth, Resolution r);
 	DCPVideo (std::shared_ptr<const PlayerVideo>, cxml::ConstNodePtr);
+	DCPVideo (std::shared_ptr<const PlayerVideo>, EncodingRequestReader& reader);
 
 	DCPVideo (DCPVideo const&) = default;
 	DCPVideo& operator= (DCPVideo const&) = default;
 
-	dcp::ArrayData encode_locally () const;
+	dcp::ArrayData encode_locally (int threads = 1, int* noise_retries = nullptr) const;
+	void prepare () const;
+	std::shared_ptr<dcp::OpenJPEGImage> take_xyz () const;
 	dcp::ArrayData encode_remotely (EncodeServerDescription, int timeout = 30) const;
 
+	/** A frame which has been encoded by a server */
+	struct RemotelyEncoded {
+		int index;
+		Eyes eyes;
+		dcp::ArrayData data;
+		/** MD5 of data as hex, calculated by the server */
+		std::string hash;
+		/** If non-zero, the server was too busy to encode the frame, data is empty,
+		 *  and we should not send it more before this many milliseconds have passed.
+		 */
+		int busy_retry;
+
+		/** @return true if hash is correct */
+		bool check () const;
+	};
+
+	static std::shared_ptr<Socket> connect_to_server (EncodeServerDescription server, int timeout = 30);
+	void send_to_server (
+		std::shared_ptr<Socket> socket,
+		TransportCompression compression = TransportCompression::NONE,
+		EncodingRequestFormat format = EncodingRequestFormat::BINARY
+		) const;
+	static RemotelyEncoded collect_from_server (std::shared_ptr<Socket> socket, bool verify = true);
+
 	int index () const {
 		return _index;
 	}
 
 	Eyes eyes () const;
 
+	std::shared_ptr<const PlayerVideo> frame () const {
+		return _frame;
+	}
+
+	int frames_per_second () const {
+		return _frames_per_second;
+	}
+
+	int j2k_bandwidth () const {
+		return _j2k_bandwidth;
+	}
+
+	Resolution resolution () const {
+		return _resolution;
+	}
+
 	bool same (std::shared_ptr<const DCPVideo> other) const;
 
 	static std::shared_ptr<dcp::OpenJPEGImage> convert_to_xyz(std::shared_ptr<const PlayerVideo> frame);
@@ -69,10 +116,22 @@ public:
 private:
 
 	void add_metadata (xmlpp::Element *) const;
+	void add_metadata (EncodingRequestWriter& writer) const;
 
 	std::shared_ptr<const PlayerVideo> _frame;
 	int _index;			 ///< frame index within the DCP's intrinsic duration
 	int _frames_per_second;		 ///< Frames per second that we will use for the DCP
 	int _j2k_bandwidth;		 ///< J2K bandwidth to use
 	Resolution _resolution;          ///< Resolution (2K or 4K)
+
+	/** An XYZ image made in advance by prepare() */
+	struct Prepared {
+		boost::mutex mutex;
+		std::shared_ptr<dcp::OpenJPEGImage> xyz;
+		/** true if the XYZ has been taken or the frame sent to a server, so no more should be made */
+		bool finished = false;
+	};
+
+	/** Shared between copies of this DCPVideo */
+	std::shared_ptr<Prepared> _prepared;
 };
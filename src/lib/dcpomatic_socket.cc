@@ -20,9 +20,11 @@
 
 
 #include "compose.hpp"
+#include "crc32c.h"
 #include "dcpomatic_assert.h"
 #include "dcpomatic_log.h"
 #include "dcpomatic_socket.h"
+#include "digester.h"
 #include "exceptions.h"
 #include <boost/bind/bind.hpp>
 #include <boost/lambda/lambda.hpp>
@@ -114,6 +116,33 @@ Socket::write (uint8_t const * data, int size)
 }
 
 
+/** Blocking write of several buffers, one after the other.  This can be much quicker
+ *  than writing them separately, as they are handed to the OS in as few calls as possible.
+ */
+void
+Socket::write (std::vector<boost::asio::const_buffer> const& buffers)
+{
+	_deadline.expires_from_now (boost::posix_time::seconds (_timeout));
+	boost::system::error_code ec = boost::asio::error::would_block;
+
+	boost::asio::async_write (_socket, buffers, boost::lambda::var(ec) = boost::lambda::_1);
+
+	do {
+		_io_service.run_one ();
+	} while (ec == boost::asio::error::would_block);
+
+	if (ec) {
+		throw NetworkError (String::compose (_("error during async_write (%1)"), ec.value ()));
+	}
+
+	if (_write_digester) {
+		for (auto const& buffer: buffers) {
+			_write_digester->add (boost::asio::buffer_cast<void const*>(buffer), boost::asio::buffer_size(buffer));
+		}
+	}
+}
+
+
 void
 Socket::write (uint32_t v)
 {
@@ -148,6 +177,31 @@ Socket::read (uint8_t* data, int size)
 }
 
 
+/** Blocking read into several buffers, filling each one before moving on to the next */
+void
+Socket::read (std::vector<boost::asio::mutable_buffer> const& buffers)
+{
+	_deadline.expires_from_now (boost::posix_time::seconds (_timeout));
+	boost::system::error_code ec = boost::asio::error::would_block;
+
+	boost::asio::async_read (_socket, buffers, boost::lambda::var(ec) = boost::lambda::_1);
+
+	do {
+		_io_service.run_one ();
+	} while (ec == boost::asio::error::would_block);
+
+	if (ec) {
+		throw NetworkError (String::compose (_("error during async_read (%1)"), ec.value ()));
+	}
+
+	if (_read_digester) {
+		for (auto const& buffer: buffers) {
+			_read_digester->add (boost::asio::buffer_cast<void const*>(buffer), boost::asio::buffer_size(buffer));
+		}
+	}
+}
+
+
 uint32_t
 Socket::read_uint32 ()
 {
@@ -157,11 +211,74 @@ Socket::read_uint32 ()
 }
 
 
+namespace {
+
+class MD5Digest : public Socket::Digest
+{
+public:
+	void add (void const* data, size_t size) override {
+		_digester.add (data, size);
+	}
+
+	int size () const override {
+		return _digester.size();
+	}
+
+	void get (uint8_t* buffer) const override {
+		_digester.get (buffer);
+	}
+
+private:
+	Digester _digester;
+};
+
+
+class CRC32CDigest : public Socket::Digest
+{
+public:
+	void add (void const* data, size_t size) override {
+		_crc.add (data, size);
+	}
+
+	int size () const override {
+		return 4;
+	}
+
+	void get (uint8_t* buffer) const override {
+		auto const crc = _crc.get();
+		buffer[0] = (crc >> 24) & 0xff;
+		buffer[1] = (crc >> 16) & 0xff;
+		buffer[2] = (crc >> 8) & 0xff;
+		buffer[3] = crc & 0xff;
+	}
+
+private:
+	CRC32C _crc;
+};
+
+}
+
+
+Socket::Digest*
+Socket::make_digest () const
+{
+	switch (_checksum) {
+	case TransportChecksum::MD5:
+		return new MD5Digest();
+	case TransportChecksum::CRC32C:
+		return new CRC32CDigest();
+	}
+
+	DCPOMATIC_ASSERT (false);
+	return nullptr;
+}
+
+
 void
 Socket::start_read_digest ()
 {
 	DCPOMATIC_ASSERT (!_read_digester);
-	_read_digester.reset (new Digester());
+	_read_digester.reset (make_digest());
 }
 
 
@@ -169,7 +286,7 @@ void
 Socket::start_write_digest ()
 {
 	DCPOMATIC_ASSERT (!_write_digester);
-	_write_digester.reset (new Digester());
+	_write_digester.reset (make_digest());
 }
 
 
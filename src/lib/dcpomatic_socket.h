@@ -18,9 +18,10 @@
 
 */
 
-#include "digester.h"
+#include "types.h"
 #include <boost/asio.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <vector>
 
 /** @class Socket
  *  @brief A class to wrap a boost::asio::ip::tcp::socket with some things
@@ -43,14 +44,32 @@ public:
 	}
 
 	void set_send_buffer_size (int size);
+	/** Set the checksum to use for subsequent digest scopes; both ends of the
+	 *  connection must agree on this.
+	 */
+	void set_checksum (TransportChecksum checksum) {
+		_checksum = checksum;
+	}
 	void connect (boost::asio::ip::tcp::endpoint);
 
 	void write (uint32_t n);
 	void write (uint8_t const * data, int size);
+	void write (std::vector<boost::asio::const_buffer> const& buffers);
 
 	void read (uint8_t* data, int size);
+	void read (std::vector<boost::asio::mutable_buffer> const& buffers);
 	uint32_t read_uint32 ();
 
+	/** Something that can accumulate a checksum of data sent or received */
+	class Digest
+	{
+	public:
+		virtual ~Digest () {}
+		virtual void add (void const* data, size_t size) = 0;
+		virtual int size () const = 0;
+		virtual void get (uint8_t* buffer) const = 0;
+	};
+
 	class ReadDigestScope
 	{
 	public:
@@ -76,6 +95,8 @@ public:
 private:
 	friend class DigestScope;
 
+	Digest* make_digest () const;
+
 	void check ();
 	void start_read_digest ();
 	bool check_read_digest ();
@@ -86,7 +107,8 @@ private:
 	boost::asio::deadline_timer _deadline;
 	boost::asio::ip::tcp::socket _socket;
 	int _timeout;
-	boost::scoped_ptr<Digester> _read_digester;
-	boost::scoped_ptr<Digester> _write_digester;
+	boost::scoped_ptr<Digest> _read_digester;
+	boost::scoped_ptr<Digest> _write_digester;
 	boost::optional<int> _send_buffer_size;
+	TransportChecksum _checksum = TransportChecksum::MD5;
 };
@@ -0,0 +1,186 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "decode_ahead.h"
+#include "decoder.h"
+#include "util.h"
+#include <boost/bind/bind.hpp>
+#include <boost/optional.hpp>
+
+
+using std::shared_ptr;
+using boost::optional;
+using namespace dcpomatic;
+
+
+DecodeAhead::DecodeAhead (shared_ptr<Decoder> decoder)
+	: _decoder (decoder)
+{
+
+}
+
+
+DecodeAhead::~DecodeAhead ()
+{
+	boost::this_thread::disable_interruption dis;
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_stop = true;
+		_condition.notify_all ();
+	}
+
+	try {
+		_thread.join ();
+	} catch (...) {}
+}
+
+
+/** Start our thread, if it is not already running.  This is not done in the constructor
+ *  so that the caller can connect to the decoder's signals before anything is decoded.
+ */
+void
+DecodeAhead::start ()
+{
+	if (!_thread.joinable()) {
+		_thread = boost::thread (boost::bind(&DecodeAhead::thread, this));
+	}
+}
+
+
+void
+DecodeAhead::thread ()
+{
+	start_of_thread ("DecodeAhead");
+
+	while (true) {
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			while (!_stop && (_finished || static_cast<int>(_passes.size()) >= _max_passes)) {
+				_condition.wait (lm);
+			}
+			if (_stop) {
+				return;
+			}
+		}
+
+		boost::mutex::scoped_lock dm (_decoder_mutex);
+
+		Pass pass;
+		optional<ContentTime> end_position;
+		try {
+			pass.position = _decoder->position();
+			pass.done = _decoder->pass();
+			if (pass.done) {
+				end_position = _decoder->position();
+			}
+		} catch (...) {
+			pass.error = std::current_exception();
+			pass.done = true;
+		}
+
+		pass.emissions.swap (_emissions);
+
+		boost::mutex::scoped_lock lm (_mutex);
+		if (pass.done) {
+			_finished = true;
+			_end_position = end_position.get_value_or(pass.position);
+		}
+		_passes.push_back (std::move(pass));
+		_condition.notify_all ();
+	}
+}
+
+
+void
+DecodeAhead::queue (std::function<void ()> emission)
+{
+	_emissions.push_back (emission);
+}
+
+
+/** @return the position that the decoder would have at this point if it were being run by the caller */
+ContentTime
+DecodeAhead::position ()
+{
+	start ();
+
+	boost::mutex::scoped_lock lm (_mutex);
+	while (_passes.empty() && !_finished) {
+		_condition.wait (lm);
+	}
+
+	return _passes.empty() ? _end_position : _passes.front().position;
+}
+
+
+/** Replay the emissions of the decoder's next pass, waiting for it to be run if necessary.
+ *  @return true if the decoder will emit no more data unless a seek() happens.
+ */
+bool
+DecodeAhead::pass ()
+{
+	start ();
+
+	Pass pass;
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		while (_passes.empty() && !_finished) {
+			_condition.wait (lm);
+		}
+
+		if (_passes.empty()) {
+			return true;
+		}
+
+		pass = std::move(_passes.front());
+		_passes.pop_front ();
+		_condition.notify_all ();
+	}
+
+	for (auto const& i: pass.emissions) {
+		i ();
+	}
+
+	if (pass.error) {
+		std::rethrow_exception (pass.error);
+	}
+
+	return pass.done;
+}
+
+
+void
+DecodeAhead::seek (ContentTime time, bool accurate)
+{
+	/* Wait for any pass that is running to finish */
+	boost::mutex::scoped_lock dm (_decoder_mutex);
+	boost::mutex::scoped_lock lm (_mutex);
+
+	_passes.clear ();
+	_finished = false;
+	_decoder->seek (time, accurate);
+	/* Anything emitted by the seek itself is for the caller's next pass */
+	_condition.notify_all ();
+}
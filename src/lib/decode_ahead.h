@@ -0,0 +1,134 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_DECODE_AHEAD_H
+#define DCPOMATIC_DECODE_AHEAD_H
+
+
+#include "dcpomatic_time.h"
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+
+
+class Decoder;
+
+
+/** @class DecodeAhead
+ *  @brief Runs a decoder on its own thread, a few passes ahead of when its data is needed.
+ *
+ *  Whatever the decoder emits during a pass is recorded (see queue()) and then replayed,
+ *  on the caller's thread, by a call to pass().  position() and pass() therefore behave
+ *  for the caller exactly as Decoder::position() and Decoder::pass() would, except that
+ *  the decoding itself has (usually) already been done.
+ */
+class DecodeAhead
+{
+public:
+	explicit DecodeAhead (std::shared_ptr<Decoder> decoder);
+	~DecodeAhead ();
+
+	DecodeAhead (DecodeAhead const&) = delete;
+	DecodeAhead& operator= (DecodeAhead const&) = delete;
+
+	/** Record something that the decoder has emitted; must only be called by
+	 *  handlers for the decoder's signals.
+	 */
+	void queue (std::function<void ()> emission);
+
+	dcpomatic::ContentTime position ();
+	bool pass ();
+	void seek (dcpomatic::ContentTime time, bool accurate);
+
+private:
+	void start ();
+	void thread ();
+
+	struct Pass
+	{
+		/** Decoder position before the pass */
+		dcpomatic::ContentTime position;
+		/** Things that were emitted during the pass */
+		std::vector<std::function<void ()>> emissions;
+		/** Return value of Decoder::pass() */
+		bool done = false;
+		/** Exception thrown by Decoder::pass(), if any */
+		std::exception_ptr error;
+	};
+
+	std::shared_ptr<Decoder> _decoder;
+	/** Held by our thread whenever it is using _decoder */
+	boost::mutex _decoder_mutex;
+	/** Emissions from the pass that our thread is running */
+	std::vector<std::function<void ()>> _emissions;
+
+	/** Mutex to protect the following */
+	boost::mutex _mutex;
+	boost::condition _condition;
+	/** Passes which have been run but not yet replayed */
+	std::list<Pass> _passes;
+	/** true if the decoder has nothing more to give until it is next seeked */
+	bool _finished = false;
+	/** Decoder position once it had finished */
+	dcpomatic::ContentTime _end_position;
+	bool _stop = false;
+
+	boost::thread _thread;
+
+	/** Maximum number of passes to run ahead */
+	static int constexpr _max_passes = 4;
+};
+
+
+/** A handler for a decoder signal which, instead of calling some other handler, queues
+ *  the call to be made when its DecodeAhead is next asked for a pass.
+ */
+template <class Handler>
+class DecodeAheadHandler
+{
+public:
+	DecodeAheadHandler (DecodeAhead* decode_ahead, Handler handler)
+		: _decode_ahead (decode_ahead)
+		, _handler (handler)
+	{}
+
+	template <class... Args>
+	void operator() (Args const&... args) const
+	{
+		_decode_ahead->queue(std::bind(_handler, args...));
+	}
+
+private:
+	/* This can be a bare pointer as only the DecodeAhead's thread passes the decoder,
+	 * and so only that thread can call us.
+	 */
+	DecodeAhead* _decode_ahead;
+	Handler _handler;
+};
+
+
+#endif
@@ -29,6 +29,7 @@
 #include "ffmpeg_decoder.h"
 #include "image_content.h"
 #include "image_decoder.h"
+#include "pcm_decoder.h"
 #include "string_text_file_content.h"
 #include "string_text_file_decoder.h"
 #include "timer.h"
@@ -40,6 +41,7 @@ using std::dynamic_pointer_cast;
 using std::list;
 using std::make_shared;
 using std::shared_ptr;
+using boost::optional;
 
 
 template <class T>
@@ -55,13 +57,26 @@ maybe_cast (shared_ptr<Decoder> d)
 /**
    @param tolerant true to proceed in the face of `survivable' errors, otherwise false.
    @param old_decoder A `used' decoder that has been previously made for this piece of content, or 0
+   @param ffmpeg_video_threads Number of threads for an FFmpegDecoder to decode video with, or empty to use the number from the configuration.
+   @param ffmpeg_video_reduction If set, an FFmpegDecoder should decode video quickly for a preview, reducing its size by 2^ffmpeg_video_reduction if it can.
 */
 shared_ptr<Decoder>
-decoder_factory (shared_ptr<const Film> film, shared_ptr<const Content> content, bool fast, bool tolerant, shared_ptr<Decoder> old_decoder)
+decoder_factory (
+	shared_ptr<const Film> film,
+	shared_ptr<const Content> content,
+	bool fast,
+	bool tolerant,
+	shared_ptr<Decoder> old_decoder,
+	optional<int> ffmpeg_video_threads,
+	optional<int> ffmpeg_video_reduction
+	)
 {
 	auto fc = dynamic_pointer_cast<const FFmpegContent> (content);
 	if (fc) {
-		return make_shared<FFmpegDecoder>(film, fc, fast);
+		if (PCMDecoder::can_decode(fc)) {
+			return make_shared<PCMDecoder>(film, fc, fast);
+		}
+		return make_shared<FFmpegDecoder>(film, fc, fast, ffmpeg_video_threads, ffmpeg_video_reduction);
 	}
 
 	auto dc = dynamic_pointer_cast<const DCPContent> (content);
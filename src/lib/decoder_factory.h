@@ -19,7 +19,13 @@
 */
 
 
+#include <boost/optional.hpp>
+#include <memory>
+
+
+class Content;
 class Decoder;
+class Film;
 
 
 extern std::shared_ptr<Decoder> decoder_factory (
@@ -27,5 +33,7 @@ extern std::shared_ptr<Decoder> decoder_factory (
 	std::shared_ptr<const Content> content,
 	bool fast,
 	bool tolerant,
-	std::shared_ptr<Decoder> old_decoder
+	std::shared_ptr<Decoder> old_decoder,
+	boost::optional<int> ffmpeg_video_threads = boost::none,
+	boost::optional<int> ffmpeg_video_reduction = boost::none
 	);
@@ -21,9 +21,16 @@
 
 #include "digester.h"
 #include "dcpomatic_assert.h"
+#include "exceptions.h"
+#include <dcp/file.h>
+#include <dcp/filesystem.h>
+#include <nettle/base64.h>
 #include <nettle/md5.h>
+#include <nettle/sha1.h>
+#include <boost/thread.hpp>
 #include <iomanip>
 #include <cstdio>
+#include <vector>
 
 
 using std::string;
@@ -89,3 +96,77 @@ Digester::size () const
 {
 	return MD5_DIGEST_SIZE;
 }
+
+
+SHA1Digester::SHA1Digester ()
+{
+	sha1_init (&_context);
+}
+
+
+void
+SHA1Digester::add (void const * data, size_t size)
+{
+	sha1_update (&_context, size, reinterpret_cast<uint8_t const *>(data));
+}
+
+
+string
+SHA1Digester::get () const
+{
+	if (!_digest) {
+		uint8_t digest[SHA1_DIGEST_SIZE];
+		sha1_digest (&_context, SHA1_DIGEST_SIZE, digest);
+
+		char base64[BASE64_ENCODE_RAW_LENGTH(SHA1_DIGEST_SIZE) + 1];
+		base64_encode_raw (base64, SHA1_DIGEST_SIZE, digest);
+		base64[BASE64_ENCODE_RAW_LENGTH(SHA1_DIGEST_SIZE)] = '\0';
+
+		_digest = base64;
+	}
+
+	return _digest.get ();
+}
+
+
+/** @return base64-encoded SHA-1 digest of a file, as used for DCP asset hashes.
+ *  The next block of the file is read while the current one is being hashed.
+ *  @param progress Called with progress from 0 to 1 after each block.
+ */
+string
+sha1_digest_file (boost::filesystem::path file, std::function<void (float)> progress)
+{
+	dcp::File in(file, "rb");
+	if (!in) {
+		throw OpenFileError (file, errno, OpenFileError::READ);
+	}
+
+	auto const total = dcp::filesystem::file_size(file);
+
+	int const block_size = 4 * 1024 * 1024;
+	std::vector<uint8_t> current(block_size);
+	std::vector<uint8_t> next(block_size);
+
+	SHA1Digester digester;
+	auto current_size = in.read(current.data(), 1, block_size);
+	uintmax_t done = 0;
+	while (current_size > 0) {
+		size_t next_size = 0;
+		boost::thread reader([&in, &next, &next_size]() {
+			next_size = in.read(next.data(), 1, block_size);
+		});
+
+		digester.add (current.data(), current_size);
+		reader.join ();
+
+		done += current_size;
+		if (progress && total > 0) {
+			progress (static_cast<float>(done) / total);
+		}
+
+		std::swap (current, next);
+		current_size = next_size;
+	}
+
+	return digester.get ();
+}
@@ -20,7 +20,10 @@
 
 
 #include <nettle/md5.h>
+#include <nettle/sha1.h>
+#include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
+#include <functional>
 #include <string>
 
 
@@ -52,3 +55,30 @@ private:
 	mutable md5_ctx _context;
 	mutable boost::optional<std::string> _digest;
 };
+
+
+/** @class SHA1Digester
+ *  @brief SHA-1 digest in the form used for DCP asset hashes.
+ *
+ *  nettle selects SHA-NI or ARMv8 crypto instructions at run time where the CPU has them.
+ */
+class SHA1Digester
+{
+public:
+	SHA1Digester ();
+
+	SHA1Digester (SHA1Digester const&) = delete;
+	SHA1Digester& operator= (SHA1Digester const&) = delete;
+
+	void add (void const * data, size_t size);
+
+	/** @return base64-encoded digest */
+	std::string get () const;
+
+private:
+	mutable sha1_ctx _context;
+	mutable boost::optional<std::string> _digest;
+};
+
+
+extern std::string sha1_digest_file (boost::filesystem::path file, std::function<void (float)> progress = {});
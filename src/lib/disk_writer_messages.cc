@@ -54,6 +54,13 @@ DiskWriterBackEndResponse::read_from_nanomsg(Nanomsg& nanomsg, int timeout)
 	} else if (*s == DISK_WRITER_VERIFY_PROGRESS) {
 		auto progress = nanomsg.receive(500);
 		return DiskWriterBackEndResponse::verify_progress(dcp::raw_convert<float>(progress.get_value_or("0")));
+	} else if (*s == DISK_WRITER_DRIVE) {
+		auto const drive = nanomsg.receive(500);
+		auto response = read_from_nanomsg(nanomsg, 500);
+		if (response) {
+			response->set_drive(dcp::raw_convert<int>(drive.get_value_or("0")));
+		}
+		return response;
 	} else {
 		DCPOMATIC_ASSERT(false);
 	}
@@ -67,28 +74,31 @@ bool
 DiskWriterBackEndResponse::write_to_nanomsg(Nanomsg& nanomsg, int timeout) const
 {
 	string message;
+	if (_drive) {
+		message = String::compose("%1\n%2\n", DISK_WRITER_DRIVE, *_drive);
+	}
 
 	switch (_type)
 	{
 		case Type::OK:
-			message = String::compose("%1\n", DISK_WRITER_OK);
+			message += String::compose("%1\n", DISK_WRITER_OK);
 			break;
 		case Type::ERROR:
-			message = String::compose("%1\n%2\n%3\n%4\n", DISK_WRITER_ERROR, _error_message, _ext4_error_number, _platform_error_number);
+			message += String::compose("%1\n%2\n%3\n%4\n", DISK_WRITER_ERROR, _error_message, _ext4_error_number, _platform_error_number);
 			break;
 		case Type::PONG:
-			message = String::compose("%1\n", DISK_WRITER_PONG);
+			message += String::compose("%1\n", DISK_WRITER_PONG);
 			break;
 		case Type::FORMAT_PROGRESS:
-			message = String::compose("%1\n", DISK_WRITER_FORMAT_PROGRESS);
+			message += String::compose("%1\n", DISK_WRITER_FORMAT_PROGRESS);
 			message += dcp::raw_convert<string>(_progress) + "\n";
 			break;
 		case Type::COPY_PROGRESS:
-			message = String::compose("%1\n", DISK_WRITER_COPY_PROGRESS);
+			message += String::compose("%1\n", DISK_WRITER_COPY_PROGRESS);
 			message += dcp::raw_convert<string>(_progress) + "\n";
 			break;
 		case Type::VERIFY_PROGRESS:
-			message = String::compose("%1\n", DISK_WRITER_VERIFY_PROGRESS);
+			message += String::compose("%1\n", DISK_WRITER_VERIFY_PROGRESS);
 			message += dcp::raw_convert<string>(_progress) + "\n";
 			break;
 	}
@@ -46,8 +46,10 @@ class Nanomsg;
 // Front-end sends:
 
 #define DISK_WRITER_WRITE "W"
-// DCP pathname
 // Internal name of the drive to write to
+// DCP pathname(s), one per line
+// Empty line
+// Verify sample interval: 1 to verify everything, or N to verify one block in N
 
 // Back-end responds:
 
@@ -73,6 +75,25 @@ class Nanomsg;
 // 0.6\n
 
 
+/* REQUEST TO WRITE DCP TO SEVERAL DRIVES AT ONCE */
+
+// Front-end sends:
+
+#define DISK_WRITER_WRITE_MULTIPLE "M"
+// Internal names of the drives to write to, one per line
+// Empty line
+// DCP pathname(s), one per line
+// Empty line
+// Verify sample interval: 1 to verify everything, or N to verify one block in N
+
+// Back-end responds with any of the responses to DISK_WRITER_WRITE, each preceded by
+#define DISK_WRITER_DRIVE "R"
+// Index of the drive that the response is about, in the order that they were sent
+
+// then, when every drive has finished (successfully or not)
+// DISK_WRITER_OK
+
+
 /* REQUEST TO QUIT */
 
 // Front-end sends:
@@ -161,6 +182,15 @@ public:
 		return _progress;
 	}
 
+	/** @return index of the drive that this response is about, when writing to several drives */
+	boost::optional<int> drive() const {
+		return _drive;
+	}
+
+	void set_drive(int drive) {
+		_drive = drive;
+	}
+
 private:
 	DiskWriterBackEndResponse(Type type)
 		: _type(type)
@@ -171,5 +201,6 @@ private:
 	int _ext4_error_number = 0;
 	int _platform_error_number = 0;
 	float _progress = 0;
+	boost::optional<int> _drive;
 };
 
@@ -23,6 +23,7 @@
 #include "dkdm_recipient.h"
 #include "film.h"
 #include "kdm_with_metadata.h"
+#include "util.h"
 #include <dcp/raw_convert.h>
 #include <dcp/utc_offset.h>
 
@@ -69,7 +70,7 @@ kdm_for_dkdm_recipient (
 	boost::posix_time::ptime valid_to
 	)
 {
-	if (!recipient->recipient) {
+	if (!recipient->recipient()) {
 		return {};
 	}
 
@@ -77,12 +78,12 @@ kdm_for_dkdm_recipient (
 	dcp::LocalTime const end  (valid_to,   dcp::UTCOffset(recipient->utc_offset_hour, recipient->utc_offset_minute));
 
 	auto signer = Config::instance()->signer_chain();
-	if (!signer->valid()) {
+	if (!certificate_chain_valid(signer)) {
 		throw InvalidSignerError();
 	}
 
 	auto const decrypted_kdm = film->make_kdm(cpl, begin, end);
-	auto const kdm = decrypted_kdm.encrypt(signer, recipient->recipient.get(), {}, dcp::Formulation::MODIFIED_TRANSITIONAL_1, true, 0);
+	auto const kdm = decrypted_kdm.encrypt(signer, recipient->recipient().get(), {}, dcp::Formulation::MODIFIED_TRANSITIONAL_1, true, 0);
 
 	dcp::NameFormat::Map name_values;
 	name_values['f'] = kdm.content_title_text();
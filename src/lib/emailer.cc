@@ -94,6 +94,10 @@ curl_data_shim (void* ptr, size_t size, size_t nmemb, void* userp)
 static int
 curl_debug_shim (CURL* curl, curl_infotype type, char* data, size_t size, void* userp)
 {
+	if (!userp) {
+		/* This is a session which is closing, with no Emailer interested in what it says */
+		return 0;
+	}
 	return reinterpret_cast<Emailer*>(userp)->debug (curl, type, data, size);
 }
 
@@ -108,9 +112,67 @@ Emailer::get_data (void* ptr, size_t size, size_t nmemb)
 }
 
 
+EmailSession::EmailSession(string server, int port, EmailProtocol protocol, string user, string password)
+{
+	curl_global_init (CURL_GLOBAL_DEFAULT);
+
+	_curl = curl_easy_init ();
+	if (!_curl) {
+		curl_global_cleanup ();
+		throw NetworkError ("Could not initialise libcurl");
+	}
+
+	if ((protocol == EmailProtocol::AUTO && port == 465) || protocol == EmailProtocol::SSL) {
+		/* "SSL" or "Implicit TLS"; I think curl wants us to use smtps here */
+		curl_easy_setopt (_curl, CURLOPT_URL, String::compose("smtps://%1:%2", server, port).c_str());
+	} else {
+		curl_easy_setopt (_curl, CURLOPT_URL, String::compose("smtp://%1:%2", server, port).c_str());
+	}
+
+	if (!user.empty ()) {
+		curl_easy_setopt (_curl, CURLOPT_USERNAME, user.c_str ());
+	}
+	if (!password.empty ()) {
+		curl_easy_setopt (_curl, CURLOPT_PASSWORD, password.c_str());
+	}
+
+	curl_easy_setopt (_curl, CURLOPT_READFUNCTION, curl_data_shim);
+	curl_easy_setopt (_curl, CURLOPT_UPLOAD, 1L);
+
+	if (protocol == EmailProtocol::AUTO || protocol == EmailProtocol::STARTTLS) {
+		curl_easy_setopt (_curl, CURLOPT_USE_SSL, (long) CURLUSESSL_TRY);
+	}
+	curl_easy_setopt (_curl, CURLOPT_SSL_VERIFYPEER, 0L);
+	curl_easy_setopt (_curl, CURLOPT_SSL_VERIFYHOST, 0L);
+	curl_easy_setopt (_curl, CURLOPT_VERBOSE, 1L);
+	curl_easy_setopt (_curl, CURLOPT_DEBUGFUNCTION, curl_debug_shim);
+}
+
+
+EmailSession::~EmailSession()
+{
+	curl_easy_cleanup (_curl);
+	curl_global_cleanup ();
+}
+
+
 void
 Emailer::send (string server, int port, EmailProtocol protocol, string user, string password)
 {
+	EmailSession session(server, port, protocol, user, password);
+	send (session);
+}
+
+
+/** Send this email using a session which may already have been used to send others; curl
+ *  will re-use the session's connection to the server if it is still open.
+ */
+void
+Emailer::send (EmailSession& session)
+{
+	_offset = 0;
+	_notes.clear ();
+
 	char date_buffer[128];
 	time_t now = time (0);
 	strftime (date_buffer, sizeof(date_buffer), "%a, %d %b %Y %H:%M:%S ", localtime(&now));
@@ -186,26 +248,7 @@ Emailer::send (string server, int port, EmailProtocol protocol, string user, str
 		_email += "\r\n--" + boundary + "--\r\n";
 	}
 
-	curl_global_init (CURL_GLOBAL_DEFAULT);
-
-	auto curl = curl_easy_init ();
-	if (!curl) {
-		throw NetworkError ("Could not initialise libcurl");
-	}
-
-	if ((protocol == EmailProtocol::AUTO && port == 465) || protocol == EmailProtocol::SSL) {
-		/* "SSL" or "Implicit TLS"; I think curl wants us to use smtps here */
-		curl_easy_setopt (curl, CURLOPT_URL, String::compose("smtps://%1:%2", server, port).c_str());
-	} else {
-		curl_easy_setopt (curl, CURLOPT_URL, String::compose("smtp://%1:%2", server, port).c_str());
-	}
-
-	if (!user.empty ()) {
-		curl_easy_setopt (curl, CURLOPT_USERNAME, user.c_str ());
-	}
-	if (!password.empty ()) {
-		curl_easy_setopt (curl, CURLOPT_PASSWORD, password.c_str());
-	}
+	auto curl = session._curl;
 
 	curl_easy_setopt (curl, CURLOPT_MAIL_FROM, _from.c_str());
 
@@ -222,27 +265,20 @@ Emailer::send (string server, int port, EmailProtocol protocol, string user, str
 
 	curl_easy_setopt (curl, CURLOPT_MAIL_RCPT, recipients);
 
-	curl_easy_setopt (curl, CURLOPT_READFUNCTION, curl_data_shim);
 	curl_easy_setopt (curl, CURLOPT_READDATA, this);
-	curl_easy_setopt (curl, CURLOPT_UPLOAD, 1L);
-
-	if (protocol == EmailProtocol::AUTO || protocol == EmailProtocol::STARTTLS) {
-		curl_easy_setopt (curl, CURLOPT_USE_SSL, (long) CURLUSESSL_TRY);
-	}
-	curl_easy_setopt (curl, CURLOPT_SSL_VERIFYPEER, 0L);
-	curl_easy_setopt (curl, CURLOPT_SSL_VERIFYHOST, 0L);
-	curl_easy_setopt (curl, CURLOPT_VERBOSE, 1L);
-	curl_easy_setopt (curl, CURLOPT_DEBUGFUNCTION, curl_debug_shim);
 	curl_easy_setopt (curl, CURLOPT_DEBUGDATA, this);
 
 	auto const r = curl_easy_perform (curl);
+
+	/* Don't leave curl with pointers to things that are about to go away */
+	curl_easy_setopt (curl, CURLOPT_MAIL_RCPT, nullptr);
+	curl_easy_setopt (curl, CURLOPT_READDATA, nullptr);
+	curl_easy_setopt (curl, CURLOPT_DEBUGDATA, nullptr);
+	curl_slist_free_all (recipients);
+
 	if (r != CURLE_OK) {
 		throw NetworkError (_("Failed to send email"), string(curl_easy_strerror(r)));
 	}
-
-	curl_slist_free_all (recipients);
-	curl_easy_cleanup (curl);
-	curl_global_cleanup ();
 }
 
 
@@ -23,6 +23,26 @@
 #include <boost/scoped_array.hpp>
 
 
+/** @class EmailSession
+ *  @brief A connection to a SMTP server which can be used to send several emails one after the other,
+ *  so that we only connect, negotiate TLS and log in once.
+ */
+class EmailSession
+{
+public:
+	EmailSession(std::string server, int port, EmailProtocol protocol, std::string user = "", std::string password = "");
+	~EmailSession();
+
+	EmailSession(EmailSession const&) = delete;
+	EmailSession& operator=(EmailSession const&) = delete;
+
+private:
+	friend class Emailer;
+
+	CURL* _curl = nullptr;
+};
+
+
 class Emailer
 {
 public:
@@ -33,6 +53,7 @@ public:
 	void add_attachment (boost::filesystem::path file, std::string name, std::string mime_type);
 
 	void send (std::string server, int port, EmailProtocol protocol, std::string user = "", std::string password = "");
+	void send (EmailSession& session);
 
 	std::string notes () const {
 		return _notes;
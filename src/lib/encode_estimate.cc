@@ -0,0 +1,215 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "config.h"
+#include "dcp_video.h"
+#include "dcpomatic_assert.h"
+#include "dcpomatic_time.h"
+#include "encode_estimate.h"
+#include "film.h"
+#include "player.h"
+#include "player_video.h"
+#include "util.h"
+#include <boost/thread.hpp>
+#include <sys/time.h>
+#include <algorithm>
+#include <vector>
+
+
+using std::max;
+using std::min;
+using std::shared_ptr;
+using std::vector;
+using namespace dcpomatic;
+
+
+namespace {
+
+/** Measurements from one sampled frame */
+struct Sample
+{
+	bool done = false;
+	boost::optional<double> decode;
+	double prepare = 0;
+	double encode = 0;
+	int64_t bytes = 0;
+	bool noise = false;
+};
+
+
+double
+now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return seconds(tv);
+}
+
+}
+
+
+/** Estimate how long it will take to make a DCP of a film by looking at some frames spread
+ *  evenly through it.  Each frame is made by a Player, converted to XYZ and encoded on this
+ *  machine, as DCPEncoder and J2KEncoder would.
+ *
+ *  @param samples Number of frames to look at.
+ *  @param threads Number of threads to look at the frames with, which is also the number
+ *  of encoding threads that the projection assumes.
+ */
+EncodeEstimate
+estimate_encode(shared_ptr<const Film> film, int samples, int threads)
+{
+	DCPOMATIC_ASSERT(samples > 0);
+	DCPOMATIC_ASSERT(threads > 0);
+
+	auto const rate = film->video_frame_rate();
+	auto const length = film->length().frames_round(rate);
+
+	vector<Sample> results(samples);
+
+	boost::mutex exception_mutex;
+	boost::exception_ptr exception;
+
+	auto measure = [film, rate, length, samples, threads, &results](int first) {
+		start_of_thread("EncodeEstimate");
+
+		Player player(film, Image::Alignment::PADDED);
+		player.set_ignore_audio();
+
+		for (int i = first; i < samples; i += threads) {
+			auto const frame = length * (2 * i + 1) / (2 * samples);
+			auto const time = DCPTime::from_frames(frame, rate);
+
+			/* The first two frames that the Player gives us from our time, with the times at which they arrived */
+			vector<shared_ptr<PlayerVideo>> video;
+			vector<double> arrived;
+			boost::signals2::scoped_connection connection = player.Video.connect(
+				[time, &video, &arrived](shared_ptr<PlayerVideo> pv, DCPTime when) {
+					if (when >= time && video.size() < 2) {
+						video.push_back(pv);
+						arrived.push_back(now());
+					}
+				});
+
+			player.seek(time, true);
+			while (video.size() < 2 && !player.pass()) {}
+
+			if (video.empty()) {
+				continue;
+			}
+
+			auto& result = results[i];
+			result.done = true;
+			if (video.size() == 2) {
+				/* The first frame includes the cost of seeking, so use the time between the first and second */
+				result.decode = arrived[1] - arrived[0];
+			}
+
+			auto pv = video.front();
+			if (pv->has_j2k() && !film->reencode_j2k()) {
+				/* This would be passed straight through */
+				result.bytes = pv->j2k()->size();
+				continue;
+			}
+
+			DCPVideo dcp_video(pv, frame, rate, film->j2k_bandwidth(), film->resolution());
+
+			auto const start = now();
+			dcp_video.prepare();
+			auto const prepared = now();
+			int noise_retries = 0;
+			auto const encoded = dcp_video.encode_locally(1, &noise_retries);
+			auto const finished = now();
+
+			result.prepare = prepared - start;
+			result.encode = finished - prepared;
+			result.bytes = encoded.size();
+			result.noise = noise_retries > 0;
+		}
+	};
+
+	boost::thread_group group;
+	for (int i = 0; i < min(threads, samples); ++i) {
+		group.create_thread([i, &measure, &exception_mutex, &exception]() {
+			try {
+				measure(i);
+			} catch (...) {
+				boost::mutex::scoped_lock lm(exception_mutex);
+				exception = boost::current_exception();
+			}
+		});
+	}
+	group.join_all();
+
+	if (exception) {
+		boost::rethrow_exception(exception);
+	}
+
+	EncodeEstimate estimate;
+	estimate.threads = threads;
+	estimate.total_frames = length * (film->three_d() ? 2 : 1);
+
+	int decoded = 0;
+	double bits = 0;
+	int noise = 0;
+	for (auto const& result: results) {
+		if (!result.done) {
+			continue;
+		}
+		++estimate.frames;
+		if (result.decode) {
+			estimate.decode += *result.decode;
+			++decoded;
+		}
+		estimate.prepare += result.prepare;
+		estimate.encode += result.encode;
+		bits += result.bytes * 8;
+		if (result.noise) {
+			++noise;
+		}
+	}
+
+	if (estimate.frames == 0) {
+		return estimate;
+	}
+
+	if (decoded > 0) {
+		estimate.decode /= decoded;
+	}
+	estimate.prepare /= estimate.frames;
+	estimate.encode /= estimate.frames;
+	estimate.bits_per_frame = bits / estimate.frames;
+	estimate.noise_retries = static_cast<double>(noise) / estimate.frames;
+
+	/* As DCPEncoder decides how many chunks to split the film into, each with its own Player */
+	auto const min_chunk = DCPTime::from_seconds(10);
+	estimate.decoders = max(int64_t(1), min(static_cast<int64_t>(Config::instance()->dcp_encode_chunks()), film->length().get() / min_chunk.get()));
+
+	/* Decoding happens alongside encoding, so whichever is slower sets the pace */
+	estimate.projected = max(
+		estimate.total_frames * estimate.decode / estimate.decoders,
+		estimate.total_frames * (estimate.prepare + estimate.encode) / threads
+		);
+
+	return estimate;
+}
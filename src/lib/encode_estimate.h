@@ -0,0 +1,67 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_ENCODE_ESTIMATE_H
+#define DCPOMATIC_ENCODE_ESTIMATE_H
+
+
+#include <cstdint>
+#include <memory>
+
+
+class Film;
+
+
+/** @struct EncodeEstimate
+ *  @brief An estimate of how long it will take to make a DCP of a film on this machine,
+ *  made by decoding and encoding a sample of its frames in the same way as DCPEncoder.
+ */
+struct EncodeEstimate
+{
+	/** Number of frames that were looked at */
+	int frames = 0;
+	/** Mean time (in seconds) that a Player took to make each frame */
+	double decode = 0;
+	/** Mean time (in seconds) taken to make each frame's XYZ image */
+	double prepare = 0;
+	/** Mean time (in seconds) taken to JPEG2000-encode each frame */
+	double encode = 0;
+	/** Mean size of the encoded frames, in bits */
+	double bits_per_frame = 0;
+	/** Proportion of the frames which had to be encoded again with added noise because they came out too small */
+	double noise_retries = 0;
+	/** Number of frames in the whole DCP (counting each eye of a 3D DCP separately) */
+	int64_t total_frames = 0;
+	/** Number of Players that the projection assumes will run at the same time */
+	int decoders = 1;
+	/** Number of encoding threads that the projection assumes */
+	int threads = 1;
+	/** Projected time (in seconds) to make the DCP's video */
+	double projected = 0;
+};
+
+
+extern EncodeEstimate estimate_encode(std::shared_ptr<const Film> film, int samples, int threads);
+
+
+#endif
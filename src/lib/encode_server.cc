@@ -32,11 +32,14 @@
 #include "dcp_video.h"
 #include "dcpomatic_log.h"
 #include "dcpomatic_socket.h"
+#include "digester.h"
 #include "encode_server.h"
 #include "encoded_log_entry.h"
+#include "encoding_request.h"
 #include "image.h"
 #include "log.h"
 #include "player_video.h"
+#include "raw_image_proxy.h"
 #include "version.h"
 #include <dcp/raw_convert.h>
 #include <dcp/warnings.h>
@@ -49,8 +52,11 @@ LIBDCP_ENABLE_WARNINGS
 #ifdef HAVE_VALGRIND_H
 #include <valgrind/memcheck.h>
 #endif
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
+#include <iomanip>
 #include <iostream>
 
 #include "i18n.h"
@@ -94,13 +100,20 @@ EncodeServer::~EncodeServer ()
 		boost::mutex::scoped_lock lm (_mutex);
 		_terminate = true;
 		_empty_condition.notify_all ();
-		_full_condition.notify_all ();
 	}
 
 	try {
 		_worker_threads.join_all ();
 	} catch (...) {}
 
+	/* Connection threads will finish when their masters disconnect, or their sockets time out */
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		while (_connections > 0) {
+			_connections_condition.wait (lm);
+		}
+	}
+
 	{
 		boost::mutex::scoped_lock lm (_broadcast.mutex);
 		if (_broadcast.socket) {
@@ -117,11 +130,11 @@ EncodeServer::~EncodeServer ()
 }
 
 
-/** @param after_read Filled in with gettimeofday() after reading the input from the network.
- *  @param after_encode Filled in with gettimeofday() after encoding the image.
+/** Read a frame to encode from a socket.
+ *  @return Frame to encode.
  */
-int
-EncodeServer::process (shared_ptr<Socket> socket, struct timeval& after_read, struct timeval& after_encode)
+shared_ptr<DCPVideo>
+EncodeServer::read_request (shared_ptr<Socket> socket)
 {
 	Socket::ReadDigestScope ds (socket);
 
@@ -142,7 +155,7 @@ EncodeServer::process (shared_ptr<Socket> socket, struct timeval& after_read, st
 	if (xml->number_child<int> ("Version") != SERVER_LINK_VERSION) {
 		cerr << "Mismatched server/client versions\n";
 		LOG_ERROR_NC ("Mismatched server/client versions");
-		return -1;
+		throw NetworkError ("Mismatched server/client versions");
 	}
 
 	auto pvf = make_shared<PlayerVideo>(xml, socket);
@@ -151,31 +164,196 @@ EncodeServer::process (shared_ptr<Socket> socket, struct timeval& after_read, st
 		throw NetworkError ("Checksums do not match");
 	}
 
-	DCPVideo dcp_video_frame (pvf, xml);
+	return make_shared<DCPVideo>(pvf, xml);
+}
+
 
-	gettimeofday (&after_read, 0);
+/** Read a frame to encode, described in binary, from a socket.
+ *  @return Frame to encode.
+ */
+shared_ptr<DCPVideo>
+EncodeServer::read_binary_request (shared_ptr<Socket> socket)
+{
+	Socket::ReadDigestScope ds (socket);
 
-	auto encoded = dcp_video_frame.encode_locally ();
+	auto length = socket->read_uint32 ();
+	if (length > 65536) {
+		throw NetworkError("Malformed encode request (too large)");
+	}
 
-	gettimeofday (&after_encode, 0);
+	vector<uint8_t> header(length);
+	socket->read (header.data(), length);
+
+	EncodingRequestReader reader(std::move(header));
+	if (reader.read_uint() != SERVER_LINK_VERSION) {
+		cerr << "Mismatched server/client versions\n";
+		LOG_ERROR_NC ("Mismatched server/client versions");
+		throw NetworkError ("Mismatched server/client versions");
+	}
+
+	auto const compression = static_cast<TransportCompression>(reader.read_uint());
+	if (compression != TransportCompression::NONE && compression != TransportCompression::ZSTD) {
+		throw NetworkError ("Malformed encode request (unknown compression)");
+	}
+
+	auto pvf = make_shared<PlayerVideo>(reader, socket, compression);
+
+	if (!ds.check()) {
+		throw NetworkError ("Checksums do not match");
+	}
+
+	return make_shared<DCPVideo>(pvf, reader);
+}
+
+
+/** Wait for a frame sent on a connection to be finished, then send it back */
+void
+EncodeServer::send_result (shared_ptr<Socket> socket, shared_ptr<Connection> connection, string ip)
+{
+	boost::mutex::scoped_lock lm (connection->mutex);
+	while (connection->done.empty()) {
+		connection->condition.timed_wait (lm, boost::posix_time::seconds(1));
+		boost::mutex::scoped_lock tm (_mutex);
+		if (_terminate) {
+			throw NetworkError ("Server is shutting down");
+		}
+	}
+
+	auto result = connection->done.front ();
+	connection->done.pop_front ();
+	lm.unlock ();
+
+	struct timeval before_send;
+	gettimeofday (&before_send, 0);
 
 	try {
-		Socket::WriteDigestScope ds (socket);
-		socket->write (encoded.size());
-		socket->write (encoded.data(), encoded.size());
+		{
+			/* The hash is enough to check the data, so only the things around it need a digest */
+			Socket::WriteDigestScope ds (socket);
+			socket->write (result.index);
+			socket->write (static_cast<uint32_t>(result.eyes));
+			socket->write (static_cast<uint32_t>(result.busy_retry));
+			socket->write (result.data.size());
+			socket->write (reinterpret_cast<uint8_t const*>(result.hash.c_str()), result.hash.size());
+		}
+		socket->write (result.data.data(), result.data.size());
 	} catch (std::exception& e) {
-		cerr << "Send failed; frame " << dcp_video_frame.index() << "\n";
-		LOG_ERROR ("Send failed; frame %1", dcp_video_frame.index());
+		cerr << "Send failed; frame " << result.index << "\n";
+		LOG_ERROR ("Send failed; frame %1", result.index);
 		throw;
 	}
 
-	return dcp_video_frame.index ();
+	struct timeval after_send;
+	gettimeofday (&after_send, 0);
+
+	if (result.data.size() > 0) {
+		auto e = make_shared<EncodedLogEntry>(
+			result.index, ip, result.receive, result.encode, seconds(after_send) - seconds(before_send)
+			);
+
+		if (_verbose) {
+			cout << e->get() << "\n";
+		}
+
+		dcpomatic_log->log (e);
+	}
+}
+
+
+/** Handle all the requests sent down one connection from a master */
+void
+EncodeServer::connection_thread (shared_ptr<Socket> socket)
+{
+	auto connection = make_shared<Connection>();
+	/* Number of frames which have been sent to us but not yet collected */
+	int outstanding = 0;
+
+	try {
+		auto const ip = socket->socket().remote_endpoint().address().to_string();
+
+		while (true) {
+			uint32_t command = 0;
+			try {
+				command = socket->read_uint32 ();
+			} catch (NetworkError &) {
+				/* The master has closed the connection, or gone quiet for too long */
+				break;
+			}
+
+			switch (static_cast<EncodeServerCommand>(command)) {
+			case EncodeServerCommand::ENCODE:
+			case EncodeServerCommand::ENCODE_BINARY:
+			{
+				struct timeval start;
+				gettimeofday (&start, 0);
+				auto frame = static_cast<EncodeServerCommand>(command) == EncodeServerCommand::ENCODE_BINARY ? read_binary_request(socket) : read_request(socket);
+				struct timeval after_read;
+				gettimeofday (&after_read, 0);
+
+				boost::mutex::scoped_lock lm (_mutex);
+				if (_terminate) {
+					throw NetworkError ("Server is shutting down");
+				}
+				if (_queue.size() >= queue_capacity()) {
+					/* Rather than making the master wait, tell it straight away that we are busy
+					   so that it can give the frame to someone else.
+					*/
+					auto const retry = busy_retry_time ();
+					lm.unlock ();
+					boost::mutex::scoped_lock clm (connection->mutex);
+					connection->done.push_back ({ frame->index(), frame->eyes(), ArrayData(), Digester().get(), 0, 0, retry });
+					connection->condition.notify_all ();
+				} else {
+					_queue.push_back ({connection, frame, seconds(after_read) - seconds(start)});
+					_empty_condition.notify_one ();
+				}
+				++outstanding;
+				break;
+			}
+			case EncodeServerCommand::COLLECT:
+				if (outstanding == 0) {
+					throw NetworkError ("Master asked for a frame when none were outstanding");
+				}
+				send_result (socket, connection, ip);
+				--outstanding;
+				break;
+			case EncodeServerCommand::SET_CHECKSUM:
+			{
+				auto const checksum = socket->read_uint32 ();
+				switch (static_cast<TransportChecksum>(checksum)) {
+				case TransportChecksum::MD5:
+				case TransportChecksum::CRC32C:
+					socket->set_checksum (static_cast<TransportChecksum>(checksum));
+					break;
+				default:
+					throw NetworkError (String::compose("Unknown checksum %1 from master", checksum));
+				}
+				break;
+			}
+			default:
+				throw NetworkError (String::compose("Unknown command %1 from master", command));
+			}
+		}
+	} catch (std::exception& e) {
+		cerr << "Error: " << e.what() << "\n";
+		LOG_ERROR ("Error: %1", e.what());
+	}
+
+	socket.reset ();
+
+	boost::mutex::scoped_lock lm (_mutex);
+	--_connections;
+	_connections_condition.notify_all ();
 }
 
 
 void
-EncodeServer::worker_thread ()
+EncodeServer::worker_thread (int index)
 {
+	if (Config::instance()->numa_aware_encoding()) {
+		set_thread_numa_node (index);
+	}
+
 	while (true) {
 		boost::mutex::scoped_lock lock (_mutex);
 		while (_queue.empty () && !_terminate) {
@@ -186,54 +364,142 @@ EncodeServer::worker_thread ()
 			return;
 		}
 
-		auto socket = _queue.front ();
+		auto request = _queue.front ();
 		_queue.pop_front ();
+		++_encoding;
 
 		lock.unlock ();
 
-		int frame = -1;
-		string ip;
-
 		struct timeval start;
-		struct timeval after_read;
-		struct timeval after_encode;
-		struct timeval end;
-
 		gettimeofday (&start, 0);
 
+		ArrayData encoded;
 		try {
-			frame = process (socket, after_read, after_encode);
-			ip = socket->socket().remote_endpoint().address().to_string();
+			encoded = request.frame->encode_locally ();
 		} catch (std::exception& e) {
 			cerr << "Error: " << e.what() << "\n";
 			LOG_ERROR ("Error: %1", e.what());
 		}
 
-		gettimeofday (&end, 0);
+		/* Hash the data while it's still in our cache, so that the master doesn't have to */
+		Digester digester;
+		digester.add (encoded.data(), encoded.size());
 
-		socket.reset ();
+		struct timeval after_encode;
+		gettimeofday (&after_encode, 0);
 
 		lock.lock ();
+		--_encoding;
+		if (encoded.size() > 0) {
+			auto const time = seconds(after_encode) - seconds(start);
+			_encode_time = _encode_time ? (*_encode_time * 0.9 + time * 0.1) : time;
+		}
+		lock.unlock ();
+
+		boost::mutex::scoped_lock lm (request.connection->mutex);
+		request.connection->done.push_back (
+			{ request.frame->index(), request.frame->eyes(), encoded, digester.get(), request.receive, seconds(after_encode) - seconds(start), 0 }
+			);
+		request.connection->condition.notify_all ();
+	}
+}
 
-		if (frame >= 0) {
-			struct timeval end;
-			gettimeofday (&end, 0);
 
-			auto e = make_shared<EncodedLogEntry>(
-				frame, ip,
-				seconds(after_read) - seconds(start),
-				seconds(after_encode) - seconds(after_read),
-				seconds(end) - seconds(after_encode)
-				);
+/** @return Number of frames that can wait in _queue before we start telling masters that we are busy */
+size_t
+EncodeServer::queue_capacity () const
+{
+	return _worker_threads.size() * 2;
+}
+
+
+/** @return Time in milliseconds after which a master that we turn away should try again;
+ *  roughly how long it will be before a worker takes a frame off a full queue.
+ *  Caller must hold a lock on _mutex.
+ */
+int
+EncodeServer::busy_retry_time () const
+{
+	if (!_encode_time || _worker_threads.size() == 0) {
+		return 100;
+	}
+
+	return std::max(10, static_cast<int>(lrint(*_encode_time * 1000 / _worker_threads.size())));
+}
+
+
+/** @return Frames waiting or being encoded per worker thread; 1 means that every thread is busy
+ *  and 3 that the queue is full too.  Caller must hold a lock on _mutex.
+ */
+float
+EncodeServer::load () const
+{
+	if (_worker_threads.size() == 0) {
+		return 0;
+	}
+
+	return static_cast<float>(_queue.size() + _encoding) / _worker_threads.size();
+}
 
-			if (_verbose) {
-				cout << e->get() << "\n";
-			}
 
-			dcpomatic_log->log (e);
+/** Encode some frames of test content on as many threads as we will use for real
+ *  work, so that we can tell masters how quickly we can encode before we have done
+ *  any work for them.  This should be called before run().
+ */
+void
+EncodeServer::benchmark ()
+{
+	int const frames_per_thread = 2;
+
+	auto image = make_shared<Image>(AV_PIX_FMT_RGB48LE, Size(1998, 1080), Image::Alignment::PADDED);
+	for (int y = 0; y < image->size().height; ++y) {
+		auto p = reinterpret_cast<uint16_t*>(image->data()[0] + y * image->stride()[0]);
+		for (int x = 0; x < image->size().width * 3; ++x) {
+			*p++ = (x * 37 + y * 101) & 0xffff;
 		}
+	}
+
+	auto pvf = make_shared<PlayerVideo>(
+		make_shared<RawImageProxy>(image),
+		Crop(),
+		optional<double>(),
+		image->size(),
+		image->size(),
+		Eyes::BOTH,
+		Part::WHOLE,
+		ColourConversion(),
+		VideoRange::FULL,
+		std::weak_ptr<Content>(),
+		optional<Frame>(),
+		false
+		);
+
+	DCPVideo frame (pvf, 0, 24, 250000000, Resolution::TWO_K);
+
+	struct timeval start;
+	gettimeofday (&start, 0);
+
+	boost::thread_group threads;
+	for (int i = 0; i < _num_threads; ++i) {
+		threads.create_thread ([&frame]() {
+			for (int j = 0; j < frames_per_thread; ++j) {
+				frame.encode_locally ();
+			}
+		});
+	}
+	threads.join_all ();
+
+	struct timeval finish;
+	gettimeofday (&finish, 0);
+
+	auto const time = (seconds(finish) - seconds(start)) / frames_per_thread;
 
-		_full_condition.notify_all ();
+	boost::mutex::scoped_lock lm (_mutex);
+	_encode_time = time;
+
+	LOG_GENERAL ("Server benchmark: %1 threads encode at %2 frames per second", _num_threads, _num_threads / time);
+	if (_verbose) {
+		cout << "Benchmark: " << _num_threads << " threads encode at " << fixed << std::setprecision(1) << (_num_threads / time) << " frames per second.\n";
 	}
 }
 
@@ -246,12 +512,19 @@ EncodeServer::run ()
 		cout << "DCP-o-matic server starting with " << _num_threads << " threads.\n";
 	}
 
+	if (Config::instance()->numa_aware_encoding()) {
+		LOG_GENERAL ("Placing encoding threads on %1", numa_description());
+		if (_verbose) {
+			cout << "Placing encoding threads on " << numa_description() << "\n";
+		}
+	}
+
 	for (int i = 0; i < _num_threads; ++i) {
 #ifdef DCPOMATIC_LINUX
-		boost::thread* t = _worker_threads.create_thread (bind(&EncodeServer::worker_thread, this));
+		boost::thread* t = _worker_threads.create_thread (bind(&EncodeServer::worker_thread, this, i));
 		pthread_setname_np (t->native_handle(), "encode-server-worker");
 #else
-		_worker_threads.create_thread (bind(&EncodeServer::worker_thread, this));
+		_worker_threads.create_thread (bind(&EncodeServer::worker_thread, this, i));
 #endif
 	}
 
@@ -300,6 +573,17 @@ EncodeServer::broadcast_received ()
 		auto root = doc.create_root_node ("ServerAvailable");
 		root->add_child("Threads")->add_child_text (raw_convert<string> (_worker_threads.size ()));
 		root->add_child("Version")->add_child_text (raw_convert<string> (SERVER_LINK_VERSION));
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			if (_encode_time && *_encode_time > 0) {
+				root->add_child("FramesPerSecond")->add_child_text(raw_convert<string>(_worker_threads.size() / *_encode_time));
+			}
+			root->add_child("Load")->add_child_text(raw_convert<string>(load()));
+		}
+#ifdef DCPOMATIC_HAVE_ZSTD
+		root->add_child("Compression")->add_child_text ("zstd");
+#endif
+		root->add_child("Checksum")->add_child_text ("crc32c");
 		auto xml = doc.write_to_string ("UTF-8");
 
 		if (_verbose) {
@@ -340,13 +624,16 @@ EncodeServer::handle (shared_ptr<Socket> socket)
 {
 	boost::mutex::scoped_lock lock (_mutex);
 
-	_waker.nudge ();
-
-	/* Wait until the queue has gone down a bit */
-	while (_queue.size() >= _worker_threads.size() * 2 && !_terminate) {
-		_full_condition.wait (lock);
+	if (_terminate) {
+		return;
 	}
 
-	_queue.push_back (socket);
-	_empty_condition.notify_all ();
+	_waker.nudge ();
+
+	++_connections;
+	thread t (bind(&EncodeServer::connection_thread, this, socket));
+#ifdef DCPOMATIC_LINUX
+	pthread_setname_np (t.native_handle(), "encode-server-connection");
+#endif
+	t.detach ();
 }
@@ -31,12 +31,15 @@
 #include "cross.h"
 #include "exception_store.h"
 #include "server.h"
+#include "types.h"
+#include <dcp/array_data.h>
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
 #include <string>
 
 
+class DCPVideo;
 class Log;
 class Socket;
 
@@ -44,6 +47,11 @@ class Socket;
 /** @class EncodeServer
  *  @brief A class to run a server which can accept requests to perform JPEG2000
  *  encoding work.
+ *
+ *  Each connection from a master is handled by its own thread, which reads frames
+ *  and passes them to a pool of worker threads.  A master can send several frames
+ *  down a connection before collecting any results, and results are sent back in
+ *  the order that they are finished.
  */
 class EncodeServer : public Server, public ExceptionStore
 {
@@ -52,21 +60,68 @@ public:
 	~EncodeServer ();
 
 	void run () override;
+	void benchmark ();
+
+	/** Read a frame to encode, sent with EncodeServerCommand::ENCODE, from a socket */
+	static std::shared_ptr<DCPVideo> read_request (std::shared_ptr<Socket> socket);
+	/** Read a frame to encode, sent with EncodeServerCommand::ENCODE_BINARY, from a socket */
+	static std::shared_ptr<DCPVideo> read_binary_request (std::shared_ptr<Socket> socket);
 
 private:
+	/** Frames which have been encoded but not yet sent back on a connection */
+	struct Connection {
+		struct Result {
+			int index;
+			Eyes eyes;
+			/** Encoded data, or empty if the encode failed */
+			dcp::ArrayData data;
+			/** MD5 of data as hex */
+			std::string hash;
+			double receive;
+			double encode;
+			/** If non-zero, we were too busy to encode this frame and the master should
+			 *  try again after this many milliseconds.
+			 */
+			int busy_retry;
+		};
+
+		boost::mutex mutex;
+		boost::condition condition;
+		std::list<Result> done;
+	};
+
+	struct Request {
+		std::shared_ptr<Connection> connection;
+		std::shared_ptr<DCPVideo> frame;
+		/** Time taken to read the frame from the network, in seconds */
+		double receive;
+	};
+
 	void handle (std::shared_ptr<Socket>) override;
-	void worker_thread ();
-	int process (std::shared_ptr<Socket> socket, struct timeval &, struct timeval &);
+	void connection_thread (std::shared_ptr<Socket> socket);
+	void worker_thread (int index);
+	void send_result (std::shared_ptr<Socket> socket, std::shared_ptr<Connection> connection, std::string ip);
 	void broadcast_thread ();
 	void broadcast_received ();
+	size_t queue_capacity () const;
+	int busy_retry_time () const;
+	float load () const;
 
 	boost::thread_group _worker_threads;
-	std::list<std::shared_ptr<Socket>> _queue;
-	boost::condition _full_condition;
+	std::list<Request> _queue;
 	boost::condition _empty_condition;
+	/** Number of frames which worker threads are encoding */
+	int _encoding = 0;
+	/** Number of connection threads which are running */
+	int _connections = 0;
+	boost::condition _connections_condition;
 	bool _verbose;
 	int _num_threads;
 	Waker _waker;
+	/** Exponentially-weighted mean of the time taken (in seconds) for one worker thread
+	 *  to encode a frame, or empty if we have not yet encoded anything.
+	 */
+	boost::optional<double> _encode_time;
 
 	struct Broadcast {
 
@@ -0,0 +1,215 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "config.h"
+#include "dcpomatic_socket.h"
+#include "encode_server_coordinator.h"
+#include "encode_server_finder.h"
+#include <dcp/raw_convert.h>
+#include <dcp/warnings.h>
+#include <libcxml/cxml.h>
+LIBDCP_DISABLE_WARNINGS
+#include <libxml++/libxml++.h>
+LIBDCP_ENABLE_WARNINGS
+#include <boost/scoped_array.hpp>
+#include <algorithm>
+#include <iostream>
+
+#include "i18n.h"
+
+
+using std::cout;
+using std::list;
+using std::make_pair;
+using std::map;
+using std::max;
+using std::min;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::scoped_array;
+using dcp::raw_convert;
+
+
+/** Time after which we forget about a master which has not asked for servers, in seconds */
+static int const master_timeout = 30;
+
+
+EncodeServerCoordinator::EncodeServerCoordinator (bool verbose)
+	: Server (ENCODE_SERVER_COORDINATOR_PORT)
+	, _verbose (verbose)
+{
+	/* Start looking for servers */
+	EncodeServerFinder::instance ();
+}
+
+
+map<string, vector<EncodeServerDescription>>
+EncodeServerCoordinator::allocate (list<EncodeServerDescription> servers, vector<Master> masters)
+{
+	map<string, vector<EncodeServerDescription>> allocation;
+	for (auto const& i: masters) {
+		allocation[i.name] = {};
+	}
+
+	if (masters.empty()) {
+		return allocation;
+	}
+
+	/* Sort both lists so that a given set of masters and servers always gets the same allocation,
+	 * which means that masters do not restart their encoding threads unless something has changed.
+	 */
+	std::sort (masters.begin(), masters.end(), [](Master const& a, Master const& b) { return a.name < b.name; });
+	servers.remove_if ([](EncodeServerDescription const& s) { return !s.current_link_version() || s.threads() <= 0; });
+	servers.sort ([](EncodeServerDescription const& a, EncodeServerDescription const& b) { return a.host_name() < b.host_name(); });
+
+	int64_t total_threads = 0;
+	for (auto const& i: servers) {
+		total_threads += i.threads();
+	}
+
+	int64_t total_weight = 0;
+	for (auto const& i: masters) {
+		total_weight += max(1, i.priority);
+	}
+
+	/* Share the threads out in proportion to priority, giving any that are left over
+	 * after rounding down to the masters which lost the most in the rounding.
+	 */
+	vector<int64_t> quota (masters.size());
+	vector<pair<int64_t, size_t>> remainders;
+	int64_t left = total_threads;
+	for (size_t i = 0; i < masters.size(); ++i) {
+		auto const share = total_threads * max(1, masters[i].priority);
+		quota[i] = share / total_weight;
+		remainders.push_back (make_pair(share % total_weight, i));
+		left -= quota[i];
+	}
+
+	std::stable_sort (remainders.begin(), remainders.end(), [](pair<int64_t, size_t> const& a, pair<int64_t, size_t> const& b) {
+		return a.first > b.first;
+	});
+
+	for (size_t i = 0; i < remainders.size() && left > 0; ++i, --left) {
+		++quota[remainders[i].second];
+	}
+
+	/* Give each master a run of consecutive slots, so that it uses as few servers as possible */
+	size_t master = 0;
+	for (auto const& server: servers) {
+		int available = server.threads();
+		while (available > 0 && master < masters.size()) {
+			if (quota[master] == 0) {
+				++master;
+				continue;
+			}
+			auto const take = static_cast<int>(min(static_cast<int64_t>(available), quota[master]));
+			auto share = server;
+			share.set_threads (take);
+			if (server.frames_per_second()) {
+				share.set_frames_per_second (*server.frames_per_second() * take / server.threads());
+			}
+			allocation[masters[master].name].push_back (share);
+			available -= take;
+			quota[master] -= take;
+		}
+	}
+
+	return allocation;
+}
+
+
+void
+EncodeServerCoordinator::handle (shared_ptr<Socket> socket)
+{
+	try {
+		auto const length = socket->read_uint32 ();
+		if (length == 0 || length > 65536) {
+			return;
+		}
+
+		scoped_array<char> buffer (new char[length]);
+		socket->read (reinterpret_cast<uint8_t*>(buffer.get()), length);
+		buffer[length - 1] = '\0';
+
+		cxml::Document request ("EncodeServerRequest");
+		request.read_string (buffer.get());
+
+		auto const name = socket->socket().remote_endpoint().address().to_string() + " " + request.string_child("Name");
+		auto const now = time (nullptr);
+
+		if (request.bool_child("Active")) {
+			if (_verbose && _masters.find(name) == _masters.end()) {
+				cout << "Master " << name << " wants servers\n";
+			}
+			_masters[name] = { request.optional_number_child<int>("Priority").get_value_or(1), now };
+		} else if (_masters.erase(name) && _verbose) {
+			cout << "Master " << name << " no longer wants servers\n";
+		}
+
+		vector<Master> masters;
+		for (auto i = _masters.begin(); i != _masters.end(); ) {
+			if ((now - i->second.last_seen) > master_timeout) {
+				if (_verbose) {
+					cout << "Forgetting master " << i->first << "\n";
+				}
+				i = _masters.erase (i);
+			} else {
+				masters.push_back (Master(i->first, i->second.priority));
+				++i;
+			}
+		}
+
+		auto allocation = allocate (EncodeServerFinder::instance()->servers(), masters);
+
+		xmlpp::Document doc;
+		auto root = doc.create_root_node ("EncodeServers");
+		for (auto const& i: allocation[name]) {
+			auto node = root->add_child ("Server");
+			node->add_child("HostName")->add_child_text (i.host_name());
+			node->add_child("Threads")->add_child_text (raw_convert<string>(i.threads()));
+			node->add_child("Version")->add_child_text (raw_convert<string>(SERVER_LINK_VERSION));
+			if (i.frames_per_second()) {
+				node->add_child("FramesPerSecond")->add_child_text (raw_convert<string>(*i.frames_per_second()));
+			}
+			if (i.load()) {
+				node->add_child("Load")->add_child_text (raw_convert<string>(*i.load()));
+			}
+			if (i.transport_compression() == TransportCompression::ZSTD) {
+				node->add_child("Compression")->add_child_text ("zstd");
+			}
+			if (i.transport_checksum() == TransportChecksum::CRC32C) {
+				node->add_child("Checksum")->add_child_text ("crc32c");
+			}
+		}
+
+		auto xml = doc.write_to_string ("UTF-8");
+		socket->write (xml.bytes() + 1);
+		socket->write (reinterpret_cast<uint8_t const *>(xml.c_str()), xml.bytes() + 1);
+	} catch (std::exception& e) {
+		if (_verbose) {
+			cout << "Failed to handle request for servers: " << e.what() << "\n";
+		}
+	}
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_ENCODE_SERVER_COORDINATOR_H
+#define DCPOMATIC_ENCODE_SERVER_COORDINATOR_H
+
+
+/** @file  src/lib/encode_server_coordinator.h
+ *  @brief EncodeServerCoordinator class.
+ */
+
+
+#include "encode_server_description.h"
+#include "server.h"
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/** @class EncodeServerCoordinator
+ *  @brief A server which shares out the encode servers on a network between the masters
+ *  which are using them.
+ *
+ *  The coordinator finds servers in the same way as any master (using EncodeServerFinder).
+ *  Masters which are configured to use a coordinator ask it for servers every few seconds
+ *  instead of looking for them themselves.  Each master which is encoding gets a share
+ *  of the servers' threads in proportion to the priority that it asks for, so that
+ *  several masters encoding at the same time do not all try to use every thread of
+ *  every server.
+ */
+class EncodeServerCoordinator : public Server
+{
+public:
+	explicit EncodeServerCoordinator (bool verbose);
+
+	struct Master
+	{
+		Master (std::string name_, int priority_)
+			: name(name_)
+			, priority(priority_)
+		{}
+
+		std::string name;
+		int priority;
+	};
+
+	/** @param servers Servers which are available.
+	 *  @param masters Masters which want servers.
+	 *  @return Map of master name to the servers that it should use; the thread count
+	 *  of each server is the number of threads on that server that the master may use.
+	 */
+	static std::map<std::string, std::vector<EncodeServerDescription>> allocate (
+		std::list<EncodeServerDescription> servers, std::vector<Master> masters
+		);
+
+private:
+	void handle (std::shared_ptr<Socket> socket) override;
+
+	struct MasterState
+	{
+		int priority;
+		time_t last_seen;
+	};
+
+	/** Masters which have recently asked for servers, indexed by name; this is only
+	 *  used in handle(), which is only ever called from our io_service thread.
+	 */
+	std::map<std::string, MasterState> _masters;
+	bool _verbose;
+};
+
+
+#endif
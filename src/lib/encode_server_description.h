@@ -25,6 +25,7 @@
 
 #include "types.h"
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/optional.hpp>
 
 
 /** @class EncodeServerDescription
@@ -43,11 +44,15 @@ public:
 	/** @param h Server host name or IP address in string form.
 	 *  @param t Number of threads to use on the server.
 	 *  @param l Server link version number of the server.
+	 *  @param c Best compression that the server can accept for images that we send to it.
+	 *  @param s Fastest checksum that the server can use to check data on the connection.
 	 */
-	EncodeServerDescription (std::string h, int t, int l)
+	EncodeServerDescription (std::string h, int t, int l, TransportCompression c = TransportCompression::NONE, TransportChecksum s = TransportChecksum::MD5)
 		: _host_name (h)
 		, _threads (t)
 		, _link_version (l)
+		, _compression (c)
+		, _checksum (s)
 		, _last_seen (boost::posix_time::second_clock::local_time())
 	{}
 
@@ -63,6 +68,20 @@ public:
 		return _threads;
 	}
 
+	/** @return compression to use for images that we send to this server */
+	TransportCompression transport_compression () const {
+#ifdef DCPOMATIC_HAVE_ZSTD
+		return _compression;
+#else
+		return TransportCompression::NONE;
+#endif
+	}
+
+	/** @return checksum that this server can use on connections to it */
+	TransportChecksum transport_checksum () const {
+		return _checksum;
+	}
+
 	bool current_link_version () const {
 		return _link_version == SERVER_LINK_VERSION;
 	}
@@ -75,6 +94,26 @@ public:
 		_threads = t;
 	}
 
+	/** @return the rate at which the server says that it can encode frames using all its threads, if known */
+	boost::optional<float> frames_per_second () const {
+		return _frames_per_second;
+	}
+
+	void set_frames_per_second (boost::optional<float> fps) {
+		_frames_per_second = fps;
+	}
+
+	/** @return frames that the server had waiting or being encoded per thread when it last told us, if known;
+	 *  1 means that all its threads were busy.
+	 */
+	boost::optional<float> load () const {
+		return _load;
+	}
+
+	void set_load (boost::optional<float> load) {
+		_load = load;
+	}
+
 	void set_seen () {
 		_last_seen = boost::posix_time::second_clock::local_time();
 	}
@@ -83,6 +122,43 @@ public:
 		return boost::posix_time::time_duration(boost::posix_time::second_clock::local_time() - _last_seen).total_seconds();
 	}
 
+	/** Note that we have just searched for servers, so we now want to hear from this one again */
+	void set_searched () {
+		if (!_answered) {
+			_reliability *= 1 - health_weight;
+			++_missed_searches;
+		}
+		_answered = false;
+	}
+
+	/** Note that this server has answered a search.
+	 *  @param latency Time between the search and the answer, in seconds.
+	 */
+	void set_answered (double latency) {
+		if (!_answered) {
+			_reliability = _reliability * (1 - health_weight) + health_weight;
+			_latency = _latency ? (*_latency * (1 - health_weight) + latency * health_weight) : latency;
+		}
+		_answered = true;
+		_missed_searches = 0;
+		set_seen ();
+	}
+
+	/** @return mean time that this server takes to answer searches, in seconds, if known */
+	boost::optional<double> latency () const {
+		return _latency;
+	}
+
+	/** @return proportion (from 0 to 1) of recent searches that this server has answered */
+	double reliability () const {
+		return _reliability;
+	}
+
+	/** @return number of searches in a row that this server has not answered */
+	int missed_searches () const {
+		return _missed_searches;
+	}
+
 private:
 	/** server's host name */
 	std::string _host_name;
@@ -90,7 +166,21 @@ private:
 	int _threads;
 	/** server link (i.e. protocol) version number */
 	int _link_version;
+	/** best compression that the server can accept */
+	TransportCompression _compression = TransportCompression::NONE;
+	/** fastest checksum that the server can use */
+	TransportChecksum _checksum = TransportChecksum::MD5;
+	boost::optional<float> _frames_per_second;
+	boost::optional<float> _load;
 	boost::posix_time::ptime _last_seen;
+	/** true if the server has answered our most recent search */
+	bool _answered = false;
+	int _missed_searches = 0;
+	double _reliability = 1;
+	boost::optional<double> _latency;
+
+	/** weight given to each search when updating _reliability and _latency */
+	static constexpr double health_weight = 0.25;
 };
 
 #endif
@@ -19,15 +19,23 @@
 */
 
 
+#include "compose.hpp"
 #include "config.h"
 #include "constants.h"
 #include "cross.h"
+#include "dcpomatic_log.h"
 #include "dcpomatic_socket.h"
 #include "encode_server_description.h"
 #include "encode_server_finder.h"
 #include "exceptions.h"
+#include "util.h"
 #include <dcp/raw_convert.h>
+#include <dcp/util.h>
+#include <dcp/warnings.h>
 #include <libcxml/cxml.h>
+LIBDCP_DISABLE_WARNINGS
+#include <libxml++/libxml++.h>
+LIBDCP_ENABLE_WARNINGS
 #include <boost/bind/placeholders.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <iostream>
@@ -52,11 +60,52 @@ using dcp::raw_convert;
 
 EncodeServerFinder* EncodeServerFinder::_instance = 0;
 
+/** Interval between searches for servers, in seconds */
+static int const search_interval = 10;
+/** Interval between searches when servers may have just appeared or come back, in milliseconds */
+static int const fast_search_interval = 250;
+/** Number of fast searches to make after we start, or after a server misses a search */
+static int const fast_searches = 4;
+/** Time to wait after the list of servers changes before saying so, in case it changes again, in milliseconds */
+static int const change_delay = 200;
+/** Longest time to wait before saying that the list of servers has changed, in milliseconds */
+static int const max_change_delay = 1000;
+/** Timeout for reading a server's reply to a search, in seconds */
+static int const reply_timeout = 2;
+
+
+/** Make a description of a server from what it (or a coordinator) told us about it */
+static
+EncodeServerDescription
+server_description (cxml::Node const& node, string host_name)
+{
+	auto compression = TransportCompression::NONE;
+	for (auto c: node.node_children("Compression")) {
+		if (c->content() == "zstd") {
+			compression = TransportCompression::ZSTD;
+		}
+	}
+	auto checksum = TransportChecksum::MD5;
+	for (auto c: node.node_children("Checksum")) {
+		if (c->content() == "crc32c") {
+			checksum = TransportChecksum::CRC32C;
+		}
+	}
+	EncodeServerDescription sd (host_name, node.number_child<int>("Threads"), node.optional_number_child<int>("Version").get_value_or(0), compression, checksum);
+	sd.set_frames_per_second(node.optional_number_child<float>("FramesPerSecond"));
+	sd.set_load(node.optional_number_child<float>("Load"));
+	return sd;
+}
+
 
 EncodeServerFinder::EncodeServerFinder ()
-	: _stop (false)
+	: _last_search (boost::get_system_time())
+	, _stop (false)
+	, _encodings (0)
+	, _coordinator_name (String::compose("%1 %2", is_batch_converter ? "batch" : "main", dcp::make_uuid()))
+	, _fast_searches_left (fast_searches)
 {
-	Config::instance()->Changed.connect (boost::bind (&EncodeServerFinder::config_changed, this, _1));
+	_config_changed_connection = Config::instance()->Changed.connect (boost::bind (&EncodeServerFinder::config_changed, this, _1));
 }
 
 
@@ -117,10 +166,78 @@ try
         socket.set_option (boost::asio::ip::udp::socket::reuse_address(true));
         socket.set_option (boost::asio::socket_base::broadcast(true));
 
-	string const data = DCPOMATIC_HELLO;
-	int const interval = 10;
+	auto next_search = boost::get_system_time();
 
 	while (!_stop) {
+		auto const now = boost::get_system_time();
+		if (now >= next_search) {
+			auto const fast = search (socket);
+			next_search = now + (fast ? boost::posix_time::time_duration(boost::posix_time::milliseconds(fast_search_interval)) : boost::posix_time::seconds(search_interval));
+		}
+
+		boost::mutex::scoped_lock lm (_search_condition_mutex);
+		auto wake = next_search;
+		if (_change_pending) {
+			auto const emit_at = std::min(_last_change + boost::posix_time::milliseconds(change_delay), _first_change + boost::posix_time::milliseconds(max_change_delay));
+			if (boost::get_system_time() >= emit_at) {
+				_change_pending = false;
+				lm.unlock ();
+				emit (boost::bind(boost::ref(ServersListChanged)));
+				continue;
+			}
+			wake = std::min(wake, emit_at);
+		}
+
+		if (!_stop) {
+			_search_condition.timed_wait (lm, wake);
+		}
+	}
+}
+catch (...)
+{
+	store_current ();
+}
+
+
+/** Search for servers once.
+ *  @return true if we should search again soon.
+ */
+bool
+EncodeServerFinder::search (boost::asio::ip::udp::socket& socket)
+{
+	bool const fast = use_fast_search ();
+
+	auto const coordinator = Config::instance()->encode_server_coordinator();
+	if (!coordinator.empty()) {
+		/* Someone else is finding servers for us */
+		ask_coordinator (coordinator);
+	} else {
+		if (!fast) {
+			bool missing = false;
+			{
+				boost::mutex::scoped_lock lm (_servers_mutex);
+				for (auto& i: _servers) {
+					i.set_searched ();
+					if (i.missed_searches() > 0) {
+						missing = true;
+					}
+				}
+			}
+
+			if (missing) {
+				/* Perhaps there was a glitch; look again a few times soon */
+				boost::mutex::scoped_lock lm (_search_condition_mutex);
+				_fast_searches_left = fast_searches;
+			}
+		}
+
+		{
+			boost::mutex::scoped_lock lm (_servers_mutex);
+			_last_search = boost::get_system_time();
+		}
+
+		string const data = DCPOMATIC_HELLO;
+
 		if (Config::instance()->use_any_servers()) {
 			/* Broadcast to look for servers */
 			try {
@@ -131,48 +248,88 @@ try
 			}
 		}
 
-		/* Query our `definite' servers (if there are any) */
-		for (auto const& i: Config::instance()->servers()) {
-			try {
-				boost::asio::ip::udp::resolver resolver (io_service);
-				boost::asio::ip::udp::resolver::query query (i, raw_convert<string>(HELLO_PORT));
-				boost::asio::ip::udp::endpoint end_point (*resolver.resolve(query));
-				socket.send_to (boost::asio::buffer(data.c_str(), data.size() + 1), end_point);
-			} catch (...) {
+		/* Query our `definite' servers (if there are any).  Looking up their names can be slow, so we
+		 * do them all at the same time, and only on our slower searches.
+		 */
+		auto const definite = Config::instance()->servers();
+		if (!fast || definite != _definite_hosts) {
+			vector<optional<boost::asio::ip::udp::endpoint>> endpoints (definite.size());
+			boost::thread_group resolvers;
+			for (size_t i = 0; i < definite.size(); ++i) {
+				resolvers.create_thread ([&definite, &endpoints, i]() {
+					try {
+						boost::asio::io_service io_service;
+						boost::asio::ip::udp::resolver resolver (io_service);
+						boost::asio::ip::udp::resolver::query query (definite[i], raw_convert<string>(HELLO_PORT));
+						endpoints[i] = *resolver.resolve(query);
+					} catch (...) {
+
+					}
+				});
+			}
+			resolvers.join_all ();
+			_definite_hosts = definite;
+			_definite_endpoints = endpoints;
+		}
+
+		for (auto const& i: _definite_endpoints) {
+			if (i) {
+				try {
+					socket.send_to (boost::asio::buffer(data.c_str(), data.size() + 1), *i);
+				} catch (...) {
 
+				}
 			}
 		}
+	}
 
+	if (!fast) {
 		/* Discard servers that we haven't seen for a while */
 		bool removed = false;
 		{
 			boost::mutex::scoped_lock lm (_servers_mutex);
-
-			auto i = _servers.begin();
-			while (i != _servers.end()) {
-				if (i->last_seen_seconds() > 2 * interval) {
-					auto j = i;
-					++j;
-					_servers.erase (i);
-					i = j;
-					removed = true;
-				} else {
-					++i;
-				}
-			}
+			auto const old_size = _servers.size();
+			_servers.remove_if ([](EncodeServerDescription const& server) { return server.last_seen_seconds() > 2 * search_interval; });
+			removed = _servers.size() != old_size;
 		}
 
 		if (removed) {
-			emit (boost::bind(boost::ref(ServersListChanged)));
+			servers_changed ();
 		}
+	}
 
-		boost::mutex::scoped_lock lm (_search_condition_mutex);
-		_search_condition.timed_wait (lm, boost::get_system_time() + boost::posix_time::seconds(interval));
+	boost::mutex::scoped_lock lm (_search_condition_mutex);
+	return _fast_searches_left > 0;
+}
+
+
+/** @return true if we should make a fast search now */
+bool
+EncodeServerFinder::use_fast_search ()
+{
+	boost::mutex::scoped_lock lm (_search_condition_mutex);
+	if (_fast_searches_left > 0) {
+		--_fast_searches_left;
+		return true;
 	}
+	return false;
 }
-catch (...)
+
+
+/** Note that the list of servers has changed; ServersListChanged will be emitted
+ *  when it has stopped changing for a little while.
+ */
+void
+EncodeServerFinder::servers_changed ()
 {
-	store_current ();
+	boost::mutex::scoped_lock lm (_search_condition_mutex);
+	auto const now = boost::get_system_time();
+	if (!_change_pending) {
+		_first_change = now;
+	}
+	_last_change = now;
+	_change_pending = true;
+	_search_condition.notify_all ();
 }
 
 
@@ -203,7 +360,7 @@ catch (...)
 void
 EncodeServerFinder::start_accept ()
 {
-	_accept_socket = make_shared<Socket>();
+	_accept_socket = make_shared<Socket>(reply_timeout);
 
 	_listen_acceptor->async_accept (
 		_accept_socket->socket(),
@@ -241,10 +398,17 @@ EncodeServerFinder::handle_accept (boost::system::error_code ec)
 		return;
 	}
 
+	if (!Config::instance()->encode_server_coordinator().empty()) {
+		/* We are getting our servers from a coordinator, so we are not interested in this one */
+		start_accept ();
+		return;
+	}
+
 	auto xml = make_shared<cxml::Document>("ServerAvailable");
 	xml->read_string(server_available);
 
 	auto const ip = _accept_socket->socket().remote_endpoint().address().to_string();
+	auto const frames_per_second = xml->optional_number_child<float>("FramesPerSecond");
 	bool changed = false;
 	{
 		boost::mutex::scoped_lock lm (_servers_mutex);
@@ -253,17 +417,22 @@ EncodeServerFinder::handle_accept (boost::system::error_code ec)
 			++i;
 		}
 
+		double const latency = (boost::get_system_time() - _last_search).total_microseconds() / 1e6;
+
 		if (i != _servers.end()) {
-			i->set_seen();
+			i->set_answered(latency);
+			i->set_frames_per_second(frames_per_second);
+			i->set_load(xml->optional_number_child<float>("Load"));
 		} else {
-			EncodeServerDescription sd (ip, xml->number_child<int>("Threads"), xml->optional_number_child<int>("Version").get_value_or(0));
-			_servers.push_back (sd);
+			auto server = server_description(*xml, ip);
+			server.set_answered(latency);
+			_servers.push_back(server);
 			changed = true;
 		}
 	}
 
 	if (changed) {
-		emit (boost::bind(boost::ref (ServersListChanged)));
+		servers_changed ();
 	}
 
 	start_accept ();
@@ -301,12 +470,93 @@ EncodeServerFinder::servers () const
 void
 EncodeServerFinder::config_changed (Config::Property what)
 {
-	if (what == Config::USE_ANY_SERVERS || what == Config::SERVERS) {
+	if (what == Config::USE_ANY_SERVERS || what == Config::SERVERS || what == Config::ENCODE_SERVER_COORDINATOR) {
 		{
 			boost::mutex::scoped_lock lm (_servers_mutex);
 			_servers.clear ();
 		}
 		ServersListChanged ();
+		boost::mutex::scoped_lock lm (_search_condition_mutex);
+		/* Look for the new set of servers quickly */
+		_fast_searches_left = fast_searches;
+		_search_condition.notify_all ();
+	}
+}
+
+
+void
+EncodeServerFinder::ask_coordinator (string coordinator)
+{
+	list<EncodeServerDescription> servers;
+
+	try {
+		xmlpp::Document doc;
+		auto root = doc.create_root_node ("EncodeServerRequest");
+		root->add_child("Name")->add_child_text (_coordinator_name);
+		root->add_child("Priority")->add_child_text (raw_convert<string>(Config::instance()->encode_server_coordinator_priority()));
+		root->add_child("Active")->add_child_text (_encodings > 0 ? "1" : "0");
+		auto const request = doc.write_to_string ("UTF-8");
+
+		boost::asio::io_service io_service;
+		boost::asio::ip::tcp::resolver resolver (io_service);
+		boost::asio::ip::tcp::resolver::query query (coordinator, raw_convert<string>(ENCODE_SERVER_COORDINATOR_PORT));
+		boost::asio::ip::tcp::resolver::iterator endpoint_iterator = resolver.resolve (query);
+
+		auto socket = make_shared<Socket>();
+		socket->connect (*endpoint_iterator);
+		socket->write (request.bytes() + 1);
+		socket->write (reinterpret_cast<uint8_t const *>(request.c_str()), request.bytes() + 1);
+
+		auto const length = socket->read_uint32 ();
+		if (length == 0 || length > 65536) {
+			return;
+		}
+
+		scoped_array<char> buffer (new char[length]);
+		socket->read (reinterpret_cast<uint8_t*>(buffer.get()), length);
+		buffer[length - 1] = '\0';
+
+		cxml::Document reply ("EncodeServers");
+		reply.read_string (buffer.get());
+		for (auto i: reply.node_children("Server")) {
+			servers.push_back (server_description(*i, i->string_child("HostName")));
+		}
+	} catch (std::exception& e) {
+		/* Keep what we had before; it will be discarded if we do not hear from the coordinator for a while */
+		LOG_WARNING ("Could not get servers from coordinator %1 (%2)", coordinator, e.what());
+		return;
+	}
+
+	bool changed = false;
+	{
+		boost::mutex::scoped_lock lm (_servers_mutex);
+		changed = servers.size() != _servers.size() || !std::equal(servers.begin(), servers.end(), _servers.begin(), [](EncodeServerDescription const& a, EncodeServerDescription const& b) {
+			return a.host_name() == b.host_name() && a.threads() == b.threads();
+		});
+		_servers = servers;
+	}
+
+	if (changed) {
+		servers_changed ();
+	}
+}
+
+
+void
+EncodeServerFinder::encoding_started ()
+{
+	if (++_encodings == 1) {
+		/* Ask for some servers now rather than waiting */
+		_search_condition.notify_all ();
+	}
+}
+
+
+void
+EncodeServerFinder::encoding_finished ()
+{
+	if (--_encodings == 0) {
+		/* Give our servers back */
 		_search_condition.notify_all ();
 	}
 }
@@ -30,6 +30,7 @@
 #include "signaller.h"
 #include <boost/signals2.hpp>
 #include <boost/thread/condition.hpp>
+#include <atomic>
 
 
 class Socket;
@@ -42,7 +43,10 @@ class Socket;
  *  configuration it finds servers by:
  *
  *  1. broadcasting a request to the local subnet and
- *  2. checking to see if any of the configured server hosts are up.
+ *  2. checking to see if any of the configured server hosts are up
+ *
+ *  or, if an encode server coordinator is configured, by asking that
+ *  for the servers (and numbers of threads) that we should use.
  */
 class EncodeServerFinder : public Signaller, public ExceptionStore
 {
@@ -54,6 +58,11 @@ public:
 
 	std::list<EncodeServerDescription> servers () const;
 
+	/** Must be called when something starts using our servers to encode */
+	void encoding_started ();
+	/** Must be called when something that called encoding_started() has finished */
+	void encoding_finished ();
+
 	/** Emitted whenever the list of servers changes */
 	boost::signals2::signal<void ()> ServersListChanged;
 
@@ -64,7 +73,11 @@ private:
 	void start ();
 
 	void search_thread ();
+	bool search (boost::asio::ip::udp::socket& socket);
+	bool use_fast_search ();
+	void servers_changed ();
 	void listen_thread ();
+	void ask_coordinator (std::string coordinator);
 
 	void start_accept ();
 	void handle_accept (boost::system::error_code ec);
@@ -78,17 +91,42 @@ private:
 
 	/** Available servers */
 	std::list<EncodeServerDescription> _servers;
-	/** Mutex for _servers */
+	/** Time of our last search */
+	boost::system_time _last_search;
+	/** Mutex for _servers and _last_search */
 	mutable boost::mutex _servers_mutex;
 
+	/** Servers from Config::servers() that we last looked up, and what we found for them;
+	 *  these are only used by the search thread.
+	 */
+	std::vector<std::string> _definite_hosts;
+	std::vector<boost::optional<boost::asio::ip::udp::endpoint>> _definite_endpoints;
+
 	boost::asio::io_service _listen_io_service;
 	std::shared_ptr<boost::asio::ip::tcp::acceptor> _listen_acceptor;
 	bool _stop;
 
+	/** Number of things which are currently encoding using our servers */
+	std::atomic<int> _encodings;
+	/** Name that we give to an encode server coordinator to identify ourselves */
+	std::string _coordinator_name;
+
 	boost::condition _search_condition;
+	/** Mutex for _search_condition and the things below it */
 	boost::mutex _search_condition_mutex;
+	/** Number of fast searches that we should make before we slow down */
+	int _fast_searches_left;
+	/** true if the list of servers has changed but we have not yet emitted ServersListChanged */
+	bool _change_pending = false;
+	/** Time of the first change since we last emitted ServersListChanged */
+	boost::system_time _first_change;
+	/** Time of the most recent change to the list of servers */
+	boost::system_time _last_change;
 
 	std::shared_ptr<Socket> _accept_socket;
 
+	/** Connection to Config::Changed, which must go when we do in case we are dropped */
+	boost::signals2::scoped_connection _config_changed_connection;
+
 	static EncodeServerFinder* _instance;
 };
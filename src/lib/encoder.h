@@ -23,6 +23,7 @@
 #define DCPOMATIC_ENCODER_H
 
 
+#include "metric.h"
 #include "player.h"
 #include "player_text.h"
 #include <boost/signals2.hpp>
@@ -57,6 +58,12 @@ public:
 
 	/** @return the number of frames that are done */
 	virtual Frame frames_done () const = 0;
+
+	/** @return values describing the current state of the encode, for monitoring */
+	virtual std::vector<Metric> metrics () const {
+		return { Metric("frames_done", frames_done()) };
+	}
+
 	virtual bool finishing () const = 0;
 
 protected:
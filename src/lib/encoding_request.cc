@@ -0,0 +1,181 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "encoding_request.h"
+#include "exceptions.h"
+#include <cstring>
+
+
+using std::vector;
+using boost::optional;
+
+
+void
+EncodingRequestWriter::write_uint (uint32_t v)
+{
+	for (int i = 0; i < 4; ++i) {
+		_data.push_back(v & 0xff);
+		v >>= 8;
+	}
+}
+
+
+void
+EncodingRequestWriter::write_uint64 (uint64_t v)
+{
+	for (int i = 0; i < 8; ++i) {
+		_data.push_back(v & 0xff);
+		v >>= 8;
+	}
+}
+
+
+void
+EncodingRequestWriter::write_int (int32_t v)
+{
+	write_uint (static_cast<uint32_t>(v));
+}
+
+
+void
+EncodingRequestWriter::write_double (double v)
+{
+	uint64_t bits;
+	static_assert (sizeof(bits) == sizeof(v), "double must be 64 bits");
+	memcpy (&bits, &v, sizeof(bits));
+	write_uint64 (bits);
+}
+
+
+void
+EncodingRequestWriter::write_bool (bool v)
+{
+	_data.push_back(v ? 1 : 0);
+}
+
+
+void
+EncodingRequestWriter::write_optional_int (optional<int> v)
+{
+	write_bool (static_cast<bool>(v));
+	if (v) {
+		write_int (*v);
+	}
+}
+
+
+void
+EncodingRequestWriter::write_optional_double (optional<double> v)
+{
+	write_bool (static_cast<bool>(v));
+	if (v) {
+		write_double (*v);
+	}
+}
+
+
+EncodingRequestReader::EncodingRequestReader (vector<uint8_t> data)
+	: _data (std::move(data))
+{
+
+}
+
+
+void
+EncodingRequestReader::check (size_t bytes) const
+{
+	if ((_offset + bytes) > _data.size()) {
+		throw NetworkError ("Malformed encode request (too short)");
+	}
+}
+
+
+uint32_t
+EncodingRequestReader::read_uint ()
+{
+	check (4);
+	uint32_t v = 0;
+	for (int i = 3; i >= 0; --i) {
+		v = (v << 8) | _data[_offset + i];
+	}
+	_offset += 4;
+	return v;
+}
+
+
+uint64_t
+EncodingRequestReader::read_uint64 ()
+{
+	check (8);
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; --i) {
+		v = (v << 8) | _data[_offset + i];
+	}
+	_offset += 8;
+	return v;
+}
+
+
+int32_t
+EncodingRequestReader::read_int ()
+{
+	return static_cast<int32_t>(read_uint());
+}
+
+
+double
+EncodingRequestReader::read_double ()
+{
+	auto const bits = read_uint64 ();
+	double v;
+	memcpy (&v, &bits, sizeof(v));
+	return v;
+}
+
+
+bool
+EncodingRequestReader::read_bool ()
+{
+	check (1);
+	return _data[_offset++] != 0;
+}
+
+
+optional<int>
+EncodingRequestReader::read_optional_int ()
+{
+	if (!read_bool()) {
+		return {};
+	}
+	return read_int ();
+}
+
+
+optional<double>
+EncodingRequestReader::read_optional_double ()
+{
+	if (!read_bool()) {
+		return {};
+	}
+	return read_double ();
+}
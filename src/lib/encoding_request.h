@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/encoding_request.h
+ *  @brief EncodingRequestWriter and EncodingRequestReader classes.
+ */
+
+
+#ifndef DCPOMATIC_ENCODING_REQUEST_H
+#define DCPOMATIC_ENCODING_REQUEST_H
+
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <vector>
+
+
+/** @class EncodingRequestWriter
+ *  @brief Builder for the compact binary description of a frame which a master sends to an encode server.
+ *
+ *  Values are written in a fixed byte order, so the master and server need not agree on one.
+ */
+class EncodingRequestWriter
+{
+public:
+	void write_uint (uint32_t v);
+	void write_int (int32_t v);
+	void write_double (double v);
+	void write_bool (bool v);
+	void write_optional_int (boost::optional<int> v);
+	void write_optional_double (boost::optional<double> v);
+
+	std::vector<uint8_t> const& data () const {
+		return _data;
+	}
+
+private:
+	void write_uint64 (uint64_t v);
+
+	std::vector<uint8_t> _data;
+};
+
+
+/** @class EncodingRequestReader
+ *  @brief Parser for the data made by EncodingRequestWriter.
+ *
+ *  The values must be read in the same order as they were written.  A NetworkError is thrown
+ *  if an attempt is made to read beyond the end of the data.
+ */
+class EncodingRequestReader
+{
+public:
+	explicit EncodingRequestReader (std::vector<uint8_t> data);
+
+	uint32_t read_uint ();
+	int32_t read_int ();
+	double read_double ();
+	bool read_bool ();
+	boost::optional<int> read_optional_int ();
+	boost::optional<double> read_optional_double ();
+
+private:
+	uint64_t read_uint64 ();
+	void check (size_t bytes) const;
+
+	std::vector<uint8_t> _data;
+	size_t _offset = 0;
+};
+
+
+#endif
@@ -34,6 +34,9 @@ public:
 	std::string name () const override;
 	std::string json_name () const override;
 	void run () override;
+	bool parallel () const override {
+		return true;
+	}
 
 	std::shared_ptr<Content> content () const {
 		return _content;
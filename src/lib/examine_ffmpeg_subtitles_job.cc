@@ -80,31 +80,7 @@ ExamineFFmpegSubtitlesJob::run ()
 		}
 
 		if (_content->subtitle_stream() && _content->subtitle_stream()->uses_index(_format_context, packet->stream_index) && _content->only_text()->use()) {
-			int got_subtitle;
-			AVSubtitle sub;
-			if (avcodec_decode_subtitle2(subtitle_codec_context(), &sub, &got_subtitle, packet) >= 0 && got_subtitle) {
-				for (unsigned int i = 0; i < sub.num_rects; ++i) {
-					AVSubtitleRect const * rect = sub.rects[i];
-					if (rect->type == SUBTITLE_BITMAP) {
-#ifdef DCPOMATIC_HAVE_AVSUBTITLERECT_PICT
-						/* sub_p looks up into a BGRA palette which is here
-						   (i.e. first byte B, second G, third R, fourth A)
-						*/
-						uint8_t const * palette = rect->pict.data[1];
-#else
-						/* sub_p looks up into a BGRA palette which is here
-						   (i.e. first byte B, second G, third R, fourth A)
-						*/
-						uint8_t const * palette = rect->data[1];
-#endif
-						for (int j = 0; j < rect->nb_colors; ++j) {
-							RGBA c (palette[2], palette[1], palette[0], palette[3]);
-							_content->subtitle_stream()->set_colour (c, c);
-							palette += 4;
-						}
-					}
-				}
-			}
+			find_subtitle_colours (subtitle_codec_context(), packet, _content->subtitle_stream());
 		}
 
 		av_packet_free (&packet);
@@ -59,12 +59,20 @@ extern "C" {
 #include <lwext4/ext4_mkfs.h>
 }
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
 #include <chrono>
+#include <cstring>
+#include <list>
+#include <memory>
 #include <string>
 
 
 using std::exception;
+using std::list;
+using std::make_shared;
 using std::min;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -75,6 +83,72 @@ using std::vector;
 
 /* Use quite a big block size here, as ext4's fwrite() has quite a bit of overhead */
 uint64_t constexpr block_size = 4096 * 4096;
+/* Number of blocks that can be moving through the stages of a copy at any one time */
+int constexpr blocks_in_flight = 3;
+
+
+/** A block of data being copied */
+struct Block
+{
+	Block ()
+		: data (block_size)
+	{}
+
+	std::vector<uint8_t> data;
+	/** number of bytes of data which are used */
+	size_t size = 0;
+};
+
+
+/** A queue of blocks passing from one stage of a copy to the next */
+class BlockQueue
+{
+public:
+	void put (shared_ptr<Block> block)
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_blocks.push_back (block);
+		_condition.notify_all ();
+	}
+
+	/** @return the next block, or nullptr if the previous stage has finished */
+	shared_ptr<Block> get ()
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		while (_blocks.empty() && !_finished) {
+			_condition.wait (lm);
+		}
+		if (_blocks.empty()) {
+			return {};
+		}
+		auto block = _blocks.front();
+		_blocks.pop_front();
+		return block;
+	}
+
+	/** Say that no more blocks will be put into this queue */
+	void finish ()
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_finished = true;
+		_condition.notify_all ();
+	}
+
+	/** Throw away anything in the queue and make any future get() return nullptr */
+	void abort ()
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_blocks.clear ();
+		_finished = true;
+		_condition.notify_all ();
+	}
+
+private:
+	boost::mutex _mutex;
+	boost::condition _condition;
+	list<shared_ptr<Block>> _blocks;
+	bool _finished = false;
+};
 
 
 static
@@ -107,6 +181,12 @@ set_timestamps_to_now (boost::filesystem::path path)
 }
 
 
+/** Copy a file from the source to the ext4 filesystem, calculating its digest as we go.
+ *  Reading the source, digesting and writing to ext4 happen at the same time in different
+ *  threads, with blocks passed between them; the ext4 writes are always made from the
+ *  calling thread.
+ *  @return Digest of the data that was read from the source.
+ */
 static
 string
 write (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total_remaining, uint64_t total, Nanomsg* nanomsg)
@@ -123,34 +203,74 @@ write (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total
 		throw CopyError(String::compose("Failed to open file %1", from.string()), 0);
 	}
 
-	std::vector<uint8_t> buffer(block_size);
-	Digester digester;
+	BlockQueue empty;
+	BlockQueue to_digest;
+	BlockQueue to_write;
+	for (int i = 0; i < blocks_in_flight; ++i) {
+		empty.put (make_shared<Block>());
+	}
 
-	int progress_frequency = 1;
-	int progress_count = 0;
-	uint64_t remaining = file_size (from);
-	while (remaining > 0) {
-		uint64_t const this_time = min(remaining, block_size);
-		size_t read = in.read(buffer.data(), 1, this_time);
-		if (read != this_time) {
-			ext4_fclose (&out);
-			throw CopyError(String::compose("Short read; expected %1 but read %2", this_time, read), 0, ext4_blockdev_errno);
+	/* Error from the reader thread, if there was one.  This is only looked at after the
+	 * reader has been joined.
+	 */
+	boost::optional<string> read_error;
+
+	boost::thread reader ([&in, &empty, &to_digest, &read_error, from]() {
+		uint64_t remaining = file_size (from);
+		while (remaining > 0) {
+			auto block = empty.get();
+			if (!block) {
+				/* The copy has been aborted */
+				break;
+			}
+			block->size = min(remaining, block_size);
+			size_t read = in.read(block->data.data(), 1, block->size);
+			if (read != block->size) {
+				read_error = String::compose("Short read; expected %1 but read %2", block->size, read);
+				break;
+			}
+			to_digest.put (block);
+			remaining -= block->size;
 		}
+		to_digest.finish ();
+	});
+
+	SHA1Digester digester;
 
-		digester.add (buffer.data(), this_time);
+	boost::thread digest ([&to_digest, &to_write, &digester]() {
+		while (auto block = to_digest.get()) {
+			digester.add (block->data.data(), block->size);
+			to_write.put (block);
+		}
+		to_write.finish ();
+	});
+
+	auto stop = [&]() {
+		empty.abort ();
+		to_digest.abort ();
+		to_write.abort ();
+		reader.join ();
+		digest.join ();
+		ext4_fclose (&out);
+	};
 
+	int progress_frequency = 1;
+	int progress_count = 0;
+	while (auto block = to_write.get()) {
 		size_t written;
-		r = ext4_fwrite (&out, buffer.data(), this_time, &written);
+		r = ext4_fwrite (&out, block->data.data(), block->size, &written);
 		if (r != EOK) {
-			ext4_fclose (&out);
+			stop ();
 			throw CopyError("Write failed", r, ext4_blockdev_errno);
 		}
-		if (written != this_time) {
-			ext4_fclose (&out);
-			throw CopyError(String::compose("Short write; expected %1 but wrote %2", this_time, written), 0, ext4_blockdev_errno);
+		if (written != block->size) {
+			stop ();
+			throw CopyError(String::compose("Short write; expected %1 but wrote %2", block->size, written), 0, ext4_blockdev_errno);
 		}
-		remaining -= this_time;
-		total_remaining -= this_time;
+
+		/* Progress is counted when data is written; the other stages can only be a few blocks ahead */
+		total_remaining -= block->size;
+		empty.put (block);
 
 		++progress_count;
 		if ((progress_count % progress_frequency) == 0 && nanomsg) {
@@ -158,7 +278,11 @@ write (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total
 		}
 	}
 
-	ext4_fclose (&out);
+	stop ();
+
+	if (read_error) {
+		throw CopyError(*read_error, 0, ext4_blockdev_errno);
+	}
 
 	set_timestamps_to_now (to);
 
@@ -166,6 +290,10 @@ write (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total
 }
 
 
+/** Read a file back from the ext4 filesystem and calculate its digest.  Reading and
+ *  digesting happen at the same time, with ext4 reads always made from the calling thread.
+ *  @return Digest of the data that was read.
+ */
 static
 string
 read (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total_remaining, uint64_t total, Nanomsg* nanomsg)
@@ -178,28 +306,47 @@ read (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total_
 	}
 	LOG_DISK("Opened %1 for read", to.generic_string());
 
-	std::vector<uint8_t> buffer(block_size);
-	Digester digester;
+	BlockQueue empty;
+	BlockQueue to_digest;
+	for (int i = 0; i < blocks_in_flight; ++i) {
+		empty.put (make_shared<Block>());
+	}
+
+	SHA1Digester digester;
+
+	boost::thread digest ([&empty, &to_digest, &digester]() {
+		while (auto block = to_digest.get()) {
+			digester.add (block->data.data(), block->size);
+			empty.put (block);
+		}
+	});
+
+	auto stop = [&]() {
+		to_digest.finish ();
+		digest.join ();
+		ext4_fclose (&in);
+	};
 
 	uint64_t remaining = file_size (from);
 	while (remaining > 0) {
-		uint64_t const this_time = min(remaining, block_size);
+		auto block = empty.get();
+		block->size = min(remaining, block_size);
 		size_t read;
-		r = ext4_fread (&in, buffer.data(), this_time, &read);
-		if (read != this_time) {
-			ext4_fclose (&in);
-			throw VerifyError (String::compose("Short read; expected %1 but read %2", this_time, read), 0);
+		r = ext4_fread (&in, block->data.data(), block->size, &read);
+		if (read != block->size) {
+			stop ();
+			throw VerifyError (String::compose("Short read; expected %1 but read %2", block->size, read), 0);
 		}
 
-		digester.add (buffer.data(), this_time);
-		remaining -= this_time;
-		total_remaining -= this_time;
+		to_digest.put (block);
+		remaining -= block->size;
+		total_remaining -= block->size;
 		if (nanomsg) {
 			DiskWriterBackEndResponse::verify_progress(1 - float(total_remaining) / total).write_to_nanomsg(*nanomsg, SHORT_TIMEOUT);
 		}
 	}
 
-	ext4_fclose (&in);
+	stop ();
 
 	return digester.get ();
 }
@@ -253,12 +400,82 @@ copy (boost::filesystem::path from, boost::filesystem::path to, uint64_t& total_
 }
 
 
+/** Check some blocks of a file on the ext4 filesystem against the same blocks of the source.
+ *  @param interval Check one block in every \p interval, as well as the last block.
+ */
+static
+void
+read_sampled (boost::filesystem::path from, boost::filesystem::path to, int interval, uint64_t& total_remaining, uint64_t total, Nanomsg* nanomsg)
+{
+	ext4_file in;
+	LOG_DISK("Opening %1 for sampled read", to.generic_string());
+	int r = ext4_fopen(&in, to.generic_string().c_str(), "rb");
+	if (r != EOK) {
+		throw VerifyError (String::compose("Failed to open file %1", to.generic_string()), r);
+	}
+
+	dcp::File source(from, "rb");
+	if (!source) {
+		ext4_fclose (&in);
+		throw VerifyError (String::compose("Failed to open file %1", from.string()), 0);
+	}
+
+	std::vector<uint8_t> written(block_size);
+	std::vector<uint8_t> original(block_size);
+
+	auto const size = file_size (from);
+	auto const blocks = (size + block_size - 1) / block_size;
+	for (uint64_t block = 0; block < blocks; ++block) {
+		auto const offset = block * block_size;
+		auto const this_time = min(size - offset, block_size);
+
+		if ((block % interval) == 0 || block == (blocks - 1)) {
+			r = ext4_fseek (&in, offset, SEEK_SET);
+			size_t read = 0;
+			if (r == EOK) {
+				r = ext4_fread (&in, written.data(), this_time, &read);
+			}
+			if (r != EOK || read != this_time) {
+				ext4_fclose (&in);
+				throw VerifyError (String::compose("Short read; expected %1 but read %2", this_time, read), r);
+			}
+
+			source.seek (offset, SEEK_SET);
+			if (source.read(original.data(), 1, this_time) != this_time) {
+				ext4_fclose (&in);
+				throw VerifyError (String::compose("Short read from %1", from.string()), 0);
+			}
+
+			if (memcmp(written.data(), original.data(), this_time) != 0) {
+				ext4_fclose (&in);
+				throw VerifyError ("Written data is incorrect", 0);
+			}
+		}
+
+		total_remaining -= this_time;
+		if (nanomsg) {
+			DiskWriterBackEndResponse::verify_progress(1 - float(total_remaining) / total).write_to_nanomsg(*nanomsg, SHORT_TIMEOUT);
+		}
+	}
+
+	ext4_fclose (&in);
+}
+
+
+/** @param sample_interval 1 to check the digest of everything that was written, or N to
+ *  check only one in every N blocks (and the last block of each file) against the source.
+ */
 static
 void
-verify (vector<CopiedFile> const& copied_files, uint64_t total, Nanomsg* nanomsg)
+verify (vector<CopiedFile> const& copied_files, uint64_t total, int sample_interval, Nanomsg* nanomsg)
 {
 	uint64_t total_remaining = total;
 	for (auto const& i: copied_files) {
+		if (sample_interval > 1) {
+			read_sampled (i.from, i.to, sample_interval, total_remaining, total, nanomsg);
+			LOG_DISK ("Checked one in %1 blocks of %2 %3", sample_interval, i.from.string(), i.to.generic_string());
+			continue;
+		}
 		string const read_digest = read (i.from, i.to, total_remaining, total, nanomsg);
 		LOG_DISK ("Read %1 %2 was %3 on write, now %4", i.from.string(), i.to.generic_string(), i.write_digest, read_digest);
 		if (read_digest != i.write_digest) {
@@ -280,9 +497,9 @@ format_progress (void* context, float progress)
 
 void
 #ifdef DCPOMATIC_WINDOWS
-dcpomatic::write (vector<boost::filesystem::path> dcp_paths, string device, string, Nanomsg* nanomsg)
+dcpomatic::write (vector<boost::filesystem::path> dcp_paths, string device, string, Nanomsg* nanomsg, int verify_sample_interval)
 #else
-dcpomatic::write (vector<boost::filesystem::path> dcp_paths, string device, string posix_partition, Nanomsg* nanomsg)
+dcpomatic::write (vector<boost::filesystem::path> dcp_paths, string device, string posix_partition, Nanomsg* nanomsg, int verify_sample_interval)
 #endif
 try
 {
@@ -412,7 +629,7 @@ try
 	}
 	LOG_DISK_NC ("Re-mounted device");
 
-	verify (copied_files, total_bytes, nanomsg);
+	verify (copied_files, total_bytes, verify_sample_interval, nanomsg);
 
 	r = ext4_umount("/mp/");
 	if (r != EOK) {
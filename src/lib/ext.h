@@ -29,7 +29,8 @@ class Nanomsg;
 namespace dcpomatic {
 
 
-extern void write (std::vector<boost::filesystem::path> dcp_paths, std::string device, std::string posix_partition, Nanomsg* nanomsg);
+/** @param verify_sample_interval 1 to verify everything after writing, or N to verify only one in every N blocks */
+extern void write (std::vector<boost::filesystem::path> dcp_paths, std::string device, std::string posix_partition, Nanomsg* nanomsg, int verify_sample_interval = 1);
 
 
 }
@@ -0,0 +1,186 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "fast_rgb_to_xyz.h"
+#include "xyz_image_pool.h"
+#include <dcp/colour_conversion.h>
+#include <dcp/openjpeg_image.h>
+#include <dcp/rgb_xyz.h>
+#include <dcp/transfer_function.h>
+#include <boost/thread/mutex.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <list>
+
+
+using std::list;
+using std::make_pair;
+using std::make_shared;
+using std::max;
+using std::min;
+using std::pair;
+using std::shared_ptr;
+
+
+/* Size of the input LUT; RGB48LE values are reduced to this many bits before lookup,
+ * as dcp::rgb_to_xyz does.
+ */
+static int constexpr input_bits = 12;
+/* Size of the output LUT */
+static int constexpr output_bits = 16;
+
+
+static int constexpr shift = 16 - input_bits;
+static float constexpr scale = (1 << output_bits) - 1;
+/* Number of converters to keep in the cache used by FastRGBToXYZ::cached() */
+static size_t constexpr cache_size = 8;
+
+
+FastRGBToXYZ::FastRGBToXYZ(dcp::ColourConversion const& conversion)
+{
+	/* Input gamma LUT, as floats */
+	auto const lut_in = conversion.in()->double_lut(0, 1, input_bits, false);
+	_lut_in.assign(lut_in.begin(), lut_in.end());
+	/* Output gamma LUT, for 12-bit output */
+	auto const lut_out = conversion.out()->int_lut(0, 1, output_bits, true, 4095);
+	_lut_out.assign(lut_out.begin(), lut_out.end());
+
+	/* RGB to XYZ matrix including the Bradford transform and DCI companding */
+	double matrix[9];
+	dcp::combined_rgb_to_xyz(conversion, matrix);
+	std::copy(matrix, matrix + 9, _matrix);
+}
+
+
+shared_ptr<const FastRGBToXYZ>
+FastRGBToXYZ::cached(dcp::ColourConversion const& conversion)
+{
+	static boost::mutex mutex;
+	/* Most-recently used first */
+	static list<pair<dcp::ColourConversion, shared_ptr<const FastRGBToXYZ>>> cache;
+
+	{
+		boost::mutex::scoped_lock lm(mutex);
+		for (auto i = cache.begin(); i != cache.end(); ++i) {
+			if (i->first.about_equal(conversion, 0)) {
+				cache.splice(cache.begin(), cache, i);
+				return cache.front().second;
+			}
+		}
+	}
+
+	/* Build the tables without holding the lock; if another thread does the same
+	 * conversion at the same time we'll just end up with two entries for a while.
+	 */
+	auto converter = make_shared<const FastRGBToXYZ>(conversion);
+
+	boost::mutex::scoped_lock lm(mutex);
+	cache.push_front(make_pair(conversion, converter));
+	if (cache.size() > cache_size) {
+		cache.pop_back();
+	}
+
+	return converter;
+}
+
+
+void
+FastRGBToXYZ::convert(uint8_t const* rgb, int width, int stride, int lines, int32_t* xyz_x, int32_t* xyz_y, int32_t* xyz_z) const
+{
+	auto const lut_in = _lut_in.data();
+	auto const lut_out = _lut_out.data();
+	auto const matrix = _matrix;
+
+#ifdef __SSE2__
+	auto const m0 = _mm_set1_ps(matrix[0]);
+	auto const m1 = _mm_set1_ps(matrix[1]);
+	auto const m2 = _mm_set1_ps(matrix[2]);
+	auto const m3 = _mm_set1_ps(matrix[3]);
+	auto const m4 = _mm_set1_ps(matrix[4]);
+	auto const m5 = _mm_set1_ps(matrix[5]);
+	auto const m6 = _mm_set1_ps(matrix[6]);
+	auto const m7 = _mm_set1_ps(matrix[7]);
+	auto const m8 = _mm_set1_ps(matrix[8]);
+	auto const zero = _mm_setzero_ps();
+	auto const one = _mm_set1_ps(1);
+	auto const sse_scale = _mm_set1_ps(scale);
+#endif
+
+	for (int y = 0; y < lines; ++y) {
+		auto p = reinterpret_cast<uint16_t const*>(rgb + y * stride);
+		int x = 0;
+
+#ifdef __SSE2__
+		/* Four pixels at a time; the LUT lookups are scalar but the matrix, clamp
+		 * and scale are done in SSE registers.
+		 */
+		alignas(16) int32_t out[12];
+		for (; x + 4 <= width; x += 4) {
+			auto const r = _mm_set_ps(lut_in[p[9] >> shift], lut_in[p[6] >> shift], lut_in[p[3] >> shift], lut_in[p[0] >> shift]);
+			auto const g = _mm_set_ps(lut_in[p[10] >> shift], lut_in[p[7] >> shift], lut_in[p[4] >> shift], lut_in[p[1] >> shift]);
+			auto const b = _mm_set_ps(lut_in[p[11] >> shift], lut_in[p[8] >> shift], lut_in[p[5] >> shift], lut_in[p[2] >> shift]);
+			p += 12;
+
+			auto const dx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, m0), _mm_mul_ps(g, m1)), _mm_mul_ps(b, m2));
+			auto const dy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, m3), _mm_mul_ps(g, m4)), _mm_mul_ps(b, m5));
+			auto const dz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, m6), _mm_mul_ps(g, m7)), _mm_mul_ps(b, m8));
+
+			/* _mm_cvtps_epi32 rounds to nearest, like lrint() */
+			_mm_store_si128(reinterpret_cast<__m128i*>(out + 0), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(dx, zero), one), sse_scale)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(out + 4), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(dy, zero), one), sse_scale)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(out + 8), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(dz, zero), one), sse_scale)));
+
+			for (int i = 0; i < 4; ++i) {
+				*xyz_x++ = lut_out[out[i]];
+				*xyz_y++ = lut_out[out[i + 4]];
+				*xyz_z++ = lut_out[out[i + 8]];
+			}
+		}
+#endif
+
+		for (; x < width; ++x) {
+			float const r = lut_in[p[0] >> shift];
+			float const g = lut_in[p[1] >> shift];
+			float const b = lut_in[p[2] >> shift];
+			p += 3;
+
+			float const dx = max(0.0f, min(1.0f, r * matrix[0] + g * matrix[1] + b * matrix[2]));
+			float const dy = max(0.0f, min(1.0f, r * matrix[3] + g * matrix[4] + b * matrix[5]));
+			float const dz = max(0.0f, min(1.0f, r * matrix[6] + g * matrix[7] + b * matrix[8]));
+
+			*xyz_x++ = lut_out[lrintf(dx * scale)];
+			*xyz_y++ = lut_out[lrintf(dy * scale)];
+			*xyz_z++ = lut_out[lrintf(dz * scale)];
+		}
+	}
+}
+
+
+shared_ptr<dcp::OpenJPEGImage>
+fast_rgb_to_xyz(uint8_t const* rgb, dcp::Size size, int stride, dcp::ColourConversion const& conversion)
+{
+	auto xyz = pooled_xyz_image(size);
+	FastRGBToXYZ::cached(conversion)->convert(rgb, size.width, stride, size.height, xyz->data(0), xyz->data(1), xyz->data(2));
+	return xyz;
+}
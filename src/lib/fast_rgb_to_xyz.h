@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DCPOMATIC_FAST_RGB_TO_XYZ_H
+#define DCPOMATIC_FAST_RGB_TO_XYZ_H
+
+
+#include <dcp/types.h>
+#include <memory>
+#include <vector>
+
+
+namespace dcp {
+	class ColourConversion;
+	class OpenJPEGImage;
+}
+
+
+/** @class FastRGBToXYZ
+ *  @brief Converter from RGB48LE to 12-bit XYZ which can be used on part of an image at a time.
+ *
+ *  This does the same as dcp::rgb_to_xyz but using single-precision maths which is vectorised
+ *  with SSE2 where it is available.
+ */
+class FastRGBToXYZ
+{
+public:
+	explicit FastRGBToXYZ(dcp::ColourConversion const& conversion);
+
+	/** @return a converter for `conversion', shared with anything else that has asked for the
+	 *  same conversion recently, so that its tables are only built once.
+	 */
+	static std::shared_ptr<const FastRGBToXYZ> cached(dcp::ColourConversion const& conversion);
+
+	/** Convert some lines of RGB48LE to XYZ.
+	 *  @param rgb Pointer to the first byte of the first line of RGB48LE data.
+	 *  @param width Width of the lines in pixels.
+	 *  @param stride Stride of the RGB data in bytes.
+	 *  @param lines Number of lines to convert.
+	 *  @param x, y, z Pointers to the X, Y and Z output for the first pixel of the first line;
+	 *  the output is assumed to have no padding at the end of each line.
+	 */
+	void convert(uint8_t const* rgb, int width, int stride, int lines, int32_t* x, int32_t* y, int32_t* z) const;
+
+private:
+	std::vector<float> _lut_in;
+	std::vector<int> _lut_out;
+	float _matrix[9];
+};
+
+
+/** Convert an RGB48LE image to 12-bit XYZ, as dcp::rgb_to_xyz does but using
+ *  single-precision maths which is vectorised with SSE2 where it is available.
+ *  The result differs from dcp::rgb_to_xyz by at most one code value.
+ *  @param rgb Pointer to the first byte of RGB48LE data.
+ *  @param size Image size in pixels.
+ *  @param stride Stride of the RGB data in bytes.
+ *  @param conversion Colour conversion to use.
+ */
+extern std::shared_ptr<dcp::OpenJPEGImage> fast_rgb_to_xyz(
+	uint8_t const* rgb, dcp::Size size, int stride, dcp::ColourConversion const& conversion
+	);
+
+
+#endif
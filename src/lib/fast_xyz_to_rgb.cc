@@ -0,0 +1,163 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "dcpomatic_assert.h"
+#include "fast_xyz_to_rgb.h"
+#include "image.h"
+#include <dcp/colour_conversion.h>
+#include <dcp/transfer_function.h>
+#include <boost/numeric/ublas/matrix.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <algorithm>
+#include <cmath>
+
+
+using std::make_shared;
+using std::max;
+using std::min;
+using std::shared_ptr;
+
+
+/* XYZ12LE has 12 significant bits in each 16-bit value */
+static int constexpr input_bits = 12;
+static int constexpr shift = 16 - input_bits;
+/* Size of the output LUT */
+static int constexpr output_bits = 16;
+static float constexpr scale = (1 << output_bits) - 1;
+/* DCI companding coefficient, as used by dcp::xyz_to_rgb */
+static double constexpr dci_coefficient = 48.0 / 52.37;
+
+
+FastXYZToRGB::FastXYZToRGB(dcp::ColourConversion const& conversion)
+{
+	/* Input (DCI) gamma LUT, as floats */
+	auto const lut_in = conversion.out()->double_lut(0, 1, input_bits, false);
+	_lut_in.assign(lut_in.begin(), lut_in.end());
+	/* Output gamma LUT for 16-bit output */
+	auto const lut_out = conversion.in()->int_lut(0, 1, output_bits, true, (1 << output_bits) - 1);
+	_lut_out.assign(lut_out.begin(), lut_out.end());
+
+	/* XYZ to RGB matrix including the DCI companding */
+	auto const matrix = conversion.xyz_to_rgb();
+	for (int y = 0; y < 3; ++y) {
+		for (int x = 0; x < 3; ++x) {
+			_matrix[y * 3 + x] = matrix(y, x) / dci_coefficient;
+		}
+	}
+}
+
+
+shared_ptr<const FastXYZToRGB>
+FastXYZToRGB::rec709()
+{
+	static auto converter = make_shared<const FastXYZToRGB>(dcp::ColourConversion::rec709_to_xyz());
+	return converter;
+}
+
+
+void
+FastXYZToRGB::convert(uint8_t const* xyz, int width, int xyz_stride, int lines, uint8_t* rgb, int rgb_stride) const
+{
+	auto const lut_in = _lut_in.data();
+	auto const lut_out = _lut_out.data();
+	auto const matrix = _matrix;
+
+#ifdef __SSE2__
+	auto const m0 = _mm_set1_ps(matrix[0]);
+	auto const m1 = _mm_set1_ps(matrix[1]);
+	auto const m2 = _mm_set1_ps(matrix[2]);
+	auto const m3 = _mm_set1_ps(matrix[3]);
+	auto const m4 = _mm_set1_ps(matrix[4]);
+	auto const m5 = _mm_set1_ps(matrix[5]);
+	auto const m6 = _mm_set1_ps(matrix[6]);
+	auto const m7 = _mm_set1_ps(matrix[7]);
+	auto const m8 = _mm_set1_ps(matrix[8]);
+	auto const zero = _mm_setzero_ps();
+	auto const one = _mm_set1_ps(1);
+	auto const sse_scale = _mm_set1_ps(scale);
+#endif
+
+	for (int y = 0; y < lines; ++y) {
+		auto p = reinterpret_cast<uint16_t const*>(xyz + y * xyz_stride);
+		auto q = reinterpret_cast<uint16_t*>(rgb + y * rgb_stride);
+		int x = 0;
+
+#ifdef __SSE2__
+		/* Four pixels at a time; the LUT lookups are scalar but the matrix, clamp
+		 * and scale are done in SSE registers.
+		 */
+		alignas(16) int32_t out[12];
+		for (; x + 4 <= width; x += 4) {
+			auto const sx = _mm_set_ps(lut_in[p[9] >> shift], lut_in[p[6] >> shift], lut_in[p[3] >> shift], lut_in[p[0] >> shift]);
+			auto const sy = _mm_set_ps(lut_in[p[10] >> shift], lut_in[p[7] >> shift], lut_in[p[4] >> shift], lut_in[p[1] >> shift]);
+			auto const sz = _mm_set_ps(lut_in[p[11] >> shift], lut_in[p[8] >> shift], lut_in[p[5] >> shift], lut_in[p[2] >> shift]);
+			p += 12;
+
+			auto const r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, m0), _mm_mul_ps(sy, m1)), _mm_mul_ps(sz, m2));
+			auto const g = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, m3), _mm_mul_ps(sy, m4)), _mm_mul_ps(sz, m5));
+			auto const b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, m6), _mm_mul_ps(sy, m7)), _mm_mul_ps(sz, m8));
+
+			/* _mm_cvtps_epi32 rounds to nearest, like lrint() */
+			_mm_store_si128(reinterpret_cast<__m128i*>(out + 0), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(r, zero), one), sse_scale)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(out + 4), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(g, zero), one), sse_scale)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(out + 8), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(b, zero), one), sse_scale)));
+
+			for (int i = 0; i < 4; ++i) {
+				*q++ = lut_out[out[i]];
+				*q++ = lut_out[out[i + 4]];
+				*q++ = lut_out[out[i + 8]];
+			}
+		}
+#endif
+
+		for (; x < width; ++x) {
+			float const sx = lut_in[p[0] >> shift];
+			float const sy = lut_in[p[1] >> shift];
+			float const sz = lut_in[p[2] >> shift];
+			p += 3;
+
+			float const r = max(0.0f, min(1.0f, sx * matrix[0] + sy * matrix[1] + sz * matrix[2]));
+			float const g = max(0.0f, min(1.0f, sx * matrix[3] + sy * matrix[4] + sz * matrix[5]));
+			float const b = max(0.0f, min(1.0f, sx * matrix[6] + sy * matrix[7] + sz * matrix[8]));
+
+			*q++ = lut_out[lrintf(r * scale)];
+			*q++ = lut_out[lrintf(g * scale)];
+			*q++ = lut_out[lrintf(b * scale)];
+		}
+	}
+}
+
+
+shared_ptr<Image>
+fast_xyz_to_rgb(Image const& xyz)
+{
+	DCPOMATIC_ASSERT(xyz.pixel_format() == AV_PIX_FMT_XYZ12LE);
+
+	auto rgb = make_shared<Image>(AV_PIX_FMT_RGB48LE, xyz.size(), Image::Alignment::PADDED);
+	FastXYZToRGB::rec709()->convert(
+		xyz.data()[0], xyz.size().width, xyz.stride()[0], xyz.size().height, rgb->data()[0], rgb->stride()[0]
+		);
+	return rgb;
+}
@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_FAST_XYZ_TO_RGB_H
+#define DCPOMATIC_FAST_XYZ_TO_RGB_H
+
+
+#include <dcp/types.h>
+#include <memory>
+#include <vector>
+
+
+namespace dcp {
+	class ColourConversion;
+}
+
+class Image;
+
+
+/** @class FastXYZToRGB
+ *  @brief Converter from XYZ12LE to RGB48LE which can be used on some lines of an image at a time.
+ *
+ *  This does the same as dcp::xyz_to_rgb but using single-precision maths which is vectorised
+ *  with SSE2 where it is available.
+ */
+class FastXYZToRGB
+{
+public:
+	/** @param conversion Conversion whose RGB colourspace and transfer function the output should have */
+	explicit FastXYZToRGB(dcp::ColourConversion const& conversion);
+
+	/** @return a converter to Rec. 709, as used by the viewer */
+	static std::shared_ptr<const FastXYZToRGB> rec709();
+
+	/** Convert some lines of XYZ12LE to RGB48LE.
+	 *  @param xyz Pointer to the first byte of the first line of XYZ12LE data.
+	 *  @param width Width of the lines in pixels.
+	 *  @param xyz_stride Stride of the XYZ data in bytes.
+	 *  @param lines Number of lines to convert.
+	 *  @param rgb Pointer to the first byte of the first line of the RGB48LE output.
+	 *  @param rgb_stride Stride of the RGB data in bytes.
+	 */
+	void convert(uint8_t const* xyz, int width, int xyz_stride, int lines, uint8_t* rgb, int rgb_stride) const;
+
+private:
+	std::vector<float> _lut_in;
+	std::vector<uint16_t> _lut_out;
+	float _matrix[9];
+};
+
+
+/** Convert an XYZ12LE image to RGB48LE for display using FastXYZToRGB::rec709().
+ *  @return RGB48LE image with padded alignment.
+ */
+extern std::shared_ptr<Image> fast_xyz_to_rgb(Image const& xyz);
+
+
+#endif
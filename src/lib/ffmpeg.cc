@@ -19,6 +19,8 @@
 */
 
 
+#include "audio_buffers.h"
+#include "audio_sample_conversion.h"
 #include "compose.hpp"
 #include "config.h"
 #include "dcpomatic_log.h"
@@ -36,10 +38,15 @@
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 }
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 #include "i18n.h"
 
@@ -48,6 +55,7 @@ using std::string;
 using std::cout;
 using std::cerr;
 using std::vector;
+using std::make_shared;
 using std::shared_ptr;
 using boost::optional;
 using dcp::raw_convert;
@@ -57,8 +65,11 @@ using namespace dcpomatic;
 boost::mutex FFmpeg::_mutex;
 
 
-FFmpeg::FFmpeg (std::shared_ptr<const FFmpegContent> c)
+FFmpeg::FFmpeg (std::shared_ptr<const FFmpegContent> c, bool hardware_decode, optional<int> video_threads, optional<int> video_reduction)
 	: _ffmpeg_content (c)
+	, _hardware_decode (hardware_decode)
+	, _video_threads (video_threads)
+	, _video_reduction (video_reduction)
 {
 	setup_general ();
 	setup_decoders ();
@@ -74,6 +85,8 @@ FFmpeg::~FFmpeg ()
 	}
 
 	av_frame_free (&_video_frame);
+	av_frame_free (&_software_video_frame);
+	av_buffer_unref (&_hardware_device);
 	for (auto& audio_frame: _audio_frame) {
 		av_frame_free (&audio_frame.second);
 	}
@@ -99,7 +112,11 @@ avio_seek_wrapper (void* data, int64_t offset, int whence)
 void
 FFmpeg::setup_general ()
 {
+	auto config = Config::instance();
 	_file_group.set_paths (_ffmpeg_content->paths ());
+	_file_group.set_read_ahead (static_cast<int64_t>(config->content_read_ahead()) * 1024 * 1024);
+	/* A large buffer means fewer, bigger reads, which matters when the content is on network storage */
+	_avio_buffer_size = std::max(4, config->content_read_buffer_size()) * 1024;
 	_avio_buffer = static_cast<uint8_t*> (wrapped_av_malloc(_avio_buffer_size));
 	_avio_context = avio_alloc_context (_avio_buffer, _avio_buffer_size, 0, this, avio_read_wrapper, 0, avio_seek_wrapper);
 	if (!_avio_context) {
@@ -199,10 +216,32 @@ FFmpeg::setup_decoders ()
 				throw DecodeError ("avcodec_parameters_to_context", "FFmpeg::setup_decoders", r);
 			}
 
-			context->thread_count = 8;
-			context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+			bool const is_video = _video_stream && static_cast<int>(i) == *_video_stream;
+
+			if (is_video) {
+				setup_video_threads (codec, context);
+			} else {
+				/* Audio and subtitle decoding is cheap, so leave the threads for video */
+				context->thread_count = 1;
+			}
+
+			bool const hardware = _hardware_decode && is_video && !Config::instance()->ffmpeg_hardware_decode().empty();
+			if (hardware) {
+				setup_hardware_decode (codec, context);
+			}
 
 			AVDictionary* options = nullptr;
+
+			if (is_video && _video_reduction) {
+				/* Trade quality for speed, since this is only for a preview */
+				context->skip_loop_filter = AVDISCARD_ALL;
+				context->flags2 |= AV_CODEC_FLAG2_FAST;
+				if (!hardware && *_video_reduction > 0) {
+					/* Decoders which can't do this much will use the most that they can */
+					av_dict_set_int (&options, "lowres", *_video_reduction, 0);
+				}
+			}
+
 			/* This option disables decoding of DCA frame footers in our patched version
 			   of FFmpeg.  I believe these footers are of no use to us, and they can cause
 			   problems when FFmpeg fails to decode them (mantis #352).
@@ -216,9 +255,14 @@ FFmpeg::setup_decoders ()
 			av_dict_set_int (&options, "enable_drefs", 1, 0);
 
 			r = avcodec_open2 (context, codec, &options);
+			av_dict_free (&options);
 			if (r < 0) {
 				throw DecodeError (N_("avcodec_open2"), N_("FFmpeg::setup_decoders"), r);
 			}
+
+			if (is_video) {
+				_video_lowres = context->lowres;
+			}
 		} else {
 			dcpomatic_log->log (String::compose ("No codec found for stream %1", i), LogEntry::TYPE_WARNING);
 		}
@@ -226,6 +270,118 @@ FFmpeg::setup_decoders ()
 }
 
 
+void
+FFmpeg::setup_video_threads (AVCodec const* codec, AVCodecContext* context)
+{
+	context->thread_count = std::max(1, _video_threads.get_value_or(Config::instance()->ffmpeg_decode_threads()));
+
+	auto const descriptor = avcodec_descriptor_get (codec->id);
+	if (descriptor && (descriptor->props & AV_CODEC_PROP_INTRA_ONLY) && (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS)) {
+		/* Each frame stands alone and can be split between threads, so use slice threading only; this avoids
+		   the extra frames of delay that frame threading adds (which make seeking slower).
+		*/
+		context->thread_type = FF_THREAD_SLICE;
+	} else {
+		context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	}
+}
+
+
+/** Try to set up a video codec context to decode in hardware using the device from the configuration,
+ *  leaving it to decode in software if that can't be done.
+ */
+void
+FFmpeg::setup_hardware_decode (AVCodec const* codec, AVCodecContext* context)
+{
+	auto const name = Config::instance()->ffmpeg_hardware_decode();
+	auto const type = av_hwdevice_find_type_by_name (name.c_str());
+	if (type == AV_HWDEVICE_TYPE_NONE) {
+		LOG_WARNING("Unknown hardware decoding device type %1", name);
+		return;
+	}
+
+	for (int i = 0; ; ++i) {
+		auto config = avcodec_get_hw_config (codec, i);
+		if (!config) {
+			LOG_GENERAL("%1 cannot decode %2; decoding in software", name, codec->name);
+			return;
+		}
+		if ((config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) && config->device_type == type) {
+			_hardware_pixel_format = config->pix_fmt;
+			break;
+		}
+	}
+
+	if (av_hwdevice_ctx_create(&_hardware_device, type, nullptr, nullptr, 0) < 0) {
+		LOG_WARNING("Could not open %1 device; decoding in software", name);
+		_hardware_pixel_format = AV_PIX_FMT_NONE;
+		return;
+	}
+
+	context->hw_device_ctx = av_buffer_ref (_hardware_device);
+	context->opaque = this;
+	context->get_format = &FFmpeg::get_hardware_format;
+
+	LOG_GENERAL("Decoding %1 video using %2", codec->name, name);
+}
+
+
+/** Called by FFmpeg to choose the pixel format that a video decoder should produce */
+AVPixelFormat
+FFmpeg::get_hardware_format (AVCodecContext* context, AVPixelFormat const* formats)
+{
+	auto ffmpeg = reinterpret_cast<FFmpeg*>(context->opaque);
+	for (auto i = formats; *i != AV_PIX_FMT_NONE; ++i) {
+		if (*i == ffmpeg->_hardware_pixel_format) {
+			return *i;
+		}
+	}
+
+	/* The hardware can't decode this stream (perhaps it is an unsupported profile or bit depth),
+	   so fall back to the first software format.
+	*/
+	for (auto i = formats; *i != AV_PIX_FMT_NONE; ++i) {
+		auto const desc = av_pix_fmt_desc_get (*i);
+		if (desc && !(desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+			return *i;
+		}
+	}
+
+	return AV_PIX_FMT_NONE;
+}
+
+
+/** @return _video_frame if it is in main memory, otherwise a copy of it downloaded
+ *  from the hardware decoder.
+ */
+AVFrame*
+FFmpeg::software_video_frame ()
+{
+	if (_hardware_pixel_format == AV_PIX_FMT_NONE || _video_frame->format != _hardware_pixel_format) {
+		return _video_frame;
+	}
+
+	if (!_software_video_frame) {
+		_software_video_frame = av_frame_alloc ();
+		if (!_software_video_frame) {
+			throw std::bad_alloc ();
+		}
+	}
+
+	av_frame_unref (_software_video_frame);
+	int r = av_hwframe_transfer_data (_software_video_frame, _video_frame, 0);
+	if (r < 0) {
+		throw DecodeError (N_("av_hwframe_transfer_data"), N_("FFmpeg::software_video_frame"), r);
+	}
+	r = av_frame_copy_props (_software_video_frame, _video_frame);
+	if (r < 0) {
+		throw DecodeError (N_("av_frame_copy_props"), N_("FFmpeg::software_video_frame"), r);
+	}
+
+	return _software_video_frame;
+}
+
+
 AVCodecContext *
 FFmpeg::video_codec_context () const
 {
@@ -271,6 +427,42 @@ FFmpeg::avio_seek (int64_t const pos, int whence)
 }
 
 
+/** Decode a subtitle packet and add the colours of any bitmap subtitles in it to a stream */
+void
+FFmpeg::find_subtitle_colours (AVCodecContext* context, AVPacket* packet, shared_ptr<FFmpegSubtitleStream> stream)
+{
+	int got_subtitle;
+	AVSubtitle sub;
+	if (avcodec_decode_subtitle2(context, &sub, &got_subtitle, packet) < 0 || !got_subtitle) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < sub.num_rects; ++i) {
+		AVSubtitleRect const * rect = sub.rects[i];
+		if (rect->type == SUBTITLE_BITMAP) {
+#ifdef DCPOMATIC_HAVE_AVSUBTITLERECT_PICT
+			/* sub_p looks up into a BGRA palette which is here
+			   (i.e. first byte B, second G, third R, fourth A)
+			*/
+			uint8_t const * palette = rect->pict.data[1];
+#else
+			/* sub_p looks up into a BGRA palette which is here
+			   (i.e. first byte B, second G, third R, fourth A)
+			*/
+			uint8_t const * palette = rect->data[1];
+#endif
+			for (int j = 0; j < rect->nb_colors; ++j) {
+				RGBA c (palette[2], palette[1], palette[0], palette[3]);
+				stream->set_colour (c, c);
+				palette += 4;
+			}
+		}
+	}
+
+	avsubtitle_free (&sub);
+}
+
+
 FFmpegSubtitlePeriod
 FFmpeg::subtitle_period (AVPacket const* packet, AVStream const* stream, AVSubtitle const & sub)
 {
@@ -344,6 +536,101 @@ FFmpeg::pts_offset (vector<shared_ptr<FFmpegAudioStream>> audio_streams, optiona
 }
 
 
+/** @param frame Decoded audio; only the first buffer will be used for non-planar data,
+ *  otherwise there will be one per channel.
+ *  @return The audio as floats.
+ */
+shared_ptr<AudioBuffers>
+FFmpeg::deinterleave_audio(AVFrame* frame)
+{
+	auto format = static_cast<AVSampleFormat>(frame->format);
+
+	/* XXX: can't we use swr_convert() to do the format conversion? */
+
+	int const channels = frame->channels;
+	int const frames = frame->nb_samples;
+	int const total_samples = frames * channels;
+	auto audio = make_shared<AudioBuffers>(channels, frames);
+	auto data = audio->data();
+
+	if (frames == 0) {
+		return audio;
+	}
+
+	switch (format) {
+	case AV_SAMPLE_FMT_U8:
+	{
+		auto p = reinterpret_cast<uint8_t *> (frame->data[0]);
+		int sample = 0;
+		int channel = 0;
+		for (int i = 0; i < total_samples; ++i) {
+			data[channel][sample] = float(*p++) / (1 << 23);
+
+			++channel;
+			if (channel == channels) {
+				channel = 0;
+				++sample;
+			}
+		}
+	}
+	break;
+
+	case AV_SAMPLE_FMT_S16:
+	{
+		/* Convert all the samples in one go, then split the result into channels */
+		std::vector<float> converted(total_samples);
+		s16_to_float(reinterpret_cast<int16_t *>(frame->data[0]), converted.data(), total_samples);
+		deinterleave_float(converted.data(), data, channels, frames);
+	}
+	break;
+
+	case AV_SAMPLE_FMT_S16P:
+	{
+		auto p = reinterpret_cast<int16_t **> (frame->data);
+		for (int i = 0; i < channels; ++i) {
+			s16_to_float(p[i], data[i], frames);
+		}
+	}
+	break;
+
+	case AV_SAMPLE_FMT_S32:
+	{
+		std::vector<float> converted(total_samples);
+		s32_to_float(reinterpret_cast<int32_t *>(frame->data[0]), converted.data(), total_samples);
+		deinterleave_float(converted.data(), data, channels, frames);
+	}
+	break;
+
+	case AV_SAMPLE_FMT_S32P:
+	{
+		auto p = reinterpret_cast<int32_t **> (frame->data);
+		for (int i = 0; i < channels; ++i) {
+			s32_to_float(p[i], data[i], frames);
+		}
+	}
+	break;
+
+	case AV_SAMPLE_FMT_FLT:
+		deinterleave_float(reinterpret_cast<float*>(frame->data[0]), data, channels, frames);
+		break;
+
+	case AV_SAMPLE_FMT_FLTP:
+	{
+		auto p = reinterpret_cast<float**> (frame->data);
+		for (int i = 0; i < channels; ++i) {
+			memcpy (data[i], p[i], frames * sizeof(float));
+		}
+	}
+	break;
+
+	default:
+		throw DecodeError (String::compose(_("Unrecognised audio sample format (%1)"), static_cast<int>(format)));
+	}
+
+	return audio;
+}
+
+
 AVFrame *
 FFmpeg::audio_frame (shared_ptr<const FFmpegAudioStream> stream)
 {
@@ -31,6 +31,7 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 LIBDCP_ENABLE_WARNINGS
+#include <boost/optional.hpp>
 #include <boost/thread/mutex.hpp>
 
 
@@ -39,15 +40,28 @@ struct AVFrame;
 struct AVStream;
 struct AVIOContext;
 
+class AudioBuffers;
 class FFmpegContent;
 class FFmpegAudioStream;
+class FFmpegSubtitleStream;
 class Log;
 
 
 class FFmpeg
 {
 public:
-	explicit FFmpeg (std::shared_ptr<const FFmpegContent>);
+	/** @param hardware_decode true to decode video in hardware, if the configuration asks for it
+	 *  and the hardware can do it.
+	 *  @param video_threads Number of threads to decode video with, or empty to use the number from the configuration.
+	 *  @param video_reduction If set, decode video faster and at lower quality for previews, reducing its size by
+	 *  2^video_reduction in each direction if the codec can do that.
+	 */
+	explicit FFmpeg (
+		std::shared_ptr<const FFmpegContent>,
+		bool hardware_decode = false,
+		boost::optional<int> video_threads = boost::none,
+		boost::optional<int> video_reduction = boost::none
+		);
 	virtual ~FFmpeg ();
 
 	std::shared_ptr<const FFmpegContent> ffmpeg_content () const {
@@ -65,11 +79,13 @@ protected:
 		) const;
 
 	static FFmpegSubtitlePeriod subtitle_period (AVPacket const* packet, AVStream const* stream, AVSubtitle const & sub);
+	static void find_subtitle_colours (AVCodecContext* context, AVPacket* packet, std::shared_ptr<FFmpegSubtitleStream> stream);
+	static std::shared_ptr<AudioBuffers> deinterleave_audio (AVFrame* frame);
 
 	std::shared_ptr<const FFmpegContent> _ffmpeg_content;
 
 	uint8_t* _avio_buffer = nullptr;
-	int _avio_buffer_size = 4096;
+	int _avio_buffer_size = 0;
 	AVIOContext* _avio_context = nullptr;
 	FileGroup _file_group;
 
@@ -80,8 +96,11 @@ protected:
 	AVFrame* _video_frame = nullptr;
 	/** Index of video stream within AVFormatContext */
 	boost::optional<int> _video_stream;
+	/** log2 of the factor by which the video codec is reducing the size of the frames it decodes */
+	int _video_lowres = 0;
 
 	AVFrame* audio_frame (std::shared_ptr<const FFmpegAudioStream> stream);
+	AVFrame* software_video_frame ();
 
 	/* It would appear (though not completely verified) that one must have
 	   a mutex around calls to avcodec_open* and avcodec_close... and here
@@ -92,6 +111,20 @@ protected:
 private:
 	void setup_general ();
 	void setup_decoders ();
+	void setup_hardware_decode (AVCodec const* codec, AVCodecContext* context);
+	void setup_video_threads (AVCodec const* codec, AVCodecContext* context);
+	static AVPixelFormat get_hardware_format (AVCodecContext* context, AVPixelFormat const* formats);
+
+	bool _hardware_decode;
+	boost::optional<int> _video_threads;
+	boost::optional<int> _video_reduction;
+	AVBufferRef* _hardware_device = nullptr;
+	/** Pixel format of video frames which have been decoded in hardware, or AV_PIX_FMT_NONE
+	 *  if we are decoding in software.
+	 */
+	AVPixelFormat _hardware_pixel_format = AV_PIX_FMT_NONE;
+	/** AVFrame used for video which has been downloaded from the hardware decoder */
+	AVFrame* _software_video_frame = nullptr;
 
 	/** AVFrames used for decoding audio streams; accessed with audio_frame() */
 	std::map<std::shared_ptr<const FFmpegAudioStream>, AVFrame*> _audio_frame;
@@ -23,9 +23,11 @@
 #include "compose.hpp"
 #include "config.h"
 #include "constants.h"
+#include "dcpomatic_log.h"
 #include "exceptions.h"
 #include "ffmpeg_audio_stream.h"
 #include "ffmpeg_content.h"
+#include "ffmpeg_examination.h"
 #include "ffmpeg_examiner.h"
 #include "ffmpeg_subtitle_stream.h"
 #include "film.h"
@@ -132,6 +134,7 @@ FFmpegContent::FFmpegContent (cxml::ConstNodePtr node, int version, list<string>
 	_color_trc = get_optional_enum<AVColorTransferCharacteristic>(node, "ColorTransferCharacteristic");
 	_colorspace = get_optional_enum<AVColorSpace>(node, "Colorspace");
 	_bits_per_pixel = node->optional_number_child<int> ("BitsPerPixel");
+	_keyframes = FFmpegExamination::keyframes_from_string(node->optional_string_child("Keyframes").get_value_or(""));
 }
 
 
@@ -254,6 +257,9 @@ FFmpegContent::as_xml (xmlpp::Node* node, bool with_paths) const
 	if (_bits_per_pixel) {
 		node->add_child("BitsPerPixel")->add_child_text(raw_convert<string>(*_bits_per_pixel));
 	}
+	if (!_keyframes.empty()) {
+		node->add_child("Keyframes")->add_child_text(FFmpegExamination::keyframes_to_string(_keyframes));
+	}
 }
 
 
@@ -269,11 +275,22 @@ FFmpegContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 
 	Content::examine (film, job);
 
-	auto examiner = make_shared<FFmpegExaminer>(shared_from_this (), job);
+	auto const key = FFmpegExamination::cache_key(shared_from_this());
+	auto examination = FFmpegExamination::from_cache(key);
+	if (examination) {
+		LOG_GENERAL("Using cached examination of %1", path(0).string());
+	} else {
+		auto examiner = make_shared<FFmpegExaminer>(shared_from_this(), job);
+		examination = make_shared<FFmpegExamination>(examiner);
+		examination->write_to_cache(key);
+		if (examiner->audio_waveform()) {
+			FFmpegExamination::write_audio_waveform_to_cache(key, *examiner->audio_waveform());
+		}
+	}
 
-	if (examiner->has_video ()) {
+	if (examination->has_video ()) {
 		video.reset (new VideoContent (this));
-		video->take_from_examiner(film, examiner);
+		video->take_from_examiner(film, examination);
 	}
 
 	auto first_path = path (0);
@@ -281,16 +298,17 @@ FFmpegContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 	{
 		boost::mutex::scoped_lock lm (_mutex);
 
-		if (examiner->has_video ()) {
-			_first_video = examiner->first_video ();
-			_color_range = examiner->color_range ();
-			_color_primaries = examiner->color_primaries ();
-			_color_trc = examiner->color_trc ();
-			_colorspace = examiner->colorspace ();
-			_bits_per_pixel = examiner->bits_per_pixel ();
-
-			if (examiner->rotation()) {
-				auto rot = *examiner->rotation ();
+		if (examination->has_video ()) {
+			_first_video = examination->first_video ();
+			_color_range = examination->color_range ();
+			_color_primaries = examination->color_primaries ();
+			_color_trc = examination->color_trc ();
+			_colorspace = examination->colorspace ();
+			_bits_per_pixel = examination->bits_per_pixel ();
+			_keyframes = examination->keyframes ();
+
+			if (examination->rotation()) {
+				auto rot = *examination->rotation ();
 				if (fabs (rot - 180) < 1.0) {
 					_filters.push_back (Filter::from_id ("vflip"));
 					_filters.push_back (Filter::from_id ("hflip"));
@@ -302,10 +320,10 @@ FFmpegContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 			}
 		}
 
-		if (!examiner->audio_streams().empty()) {
+		if (!examination->audio_streams().empty()) {
 			audio = make_shared<AudioContent>(this);
 
-			for (auto i: examiner->audio_streams()) {
+			for (auto i: examination->audio_streams()) {
 				audio->add_stream (i);
 			}
 
@@ -315,7 +333,7 @@ FFmpegContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 			as->set_mapping (m);
 		}
 
-		_subtitle_streams = examiner->subtitle_streams ();
+		_subtitle_streams = examination->subtitle_streams ();
 		if (!_subtitle_streams.empty ()) {
 			text.clear ();
 			text.push_back (make_shared<TextContent>(this, TextType::OPEN_SUBTITLE, TextType::UNKNOWN));
@@ -324,11 +342,11 @@ FFmpegContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 		}
 	}
 
-	if (examiner->has_video ()) {
+	if (examination->has_video ()) {
 		set_default_colour_conversion ();
 	}
 
-	if (examiner->has_video() && examiner->pulldown() && video_frame_rate() && fabs(*video_frame_rate() - 29.97) < 0.001) {
+	if (examination->has_video() && examination->pulldown() && video_frame_rate() && fabs(*video_frame_rate() - 29.97) < 0.001) {
 		/* FFmpeg has detected this file as 29.97 and the examiner thinks it is using "soft" 2:3 pulldown (telecine).
 		 * This means we can treat it as a 23.976fps file.
 		 */
@@ -689,6 +707,16 @@ FFmpegContent::signal_subtitle_stream_changed ()
 }
 
 
+/** @return Summary of our audio for drawing, if one was made when we were examined; this reads
+ *  from disk so callers should keep the result rather than calling it often.
+ */
+shared_ptr<const AudioWaveform>
+FFmpegContent::audio_waveform () const
+{
+	return FFmpegExamination::audio_waveform_from_cache(FFmpegExamination::cache_key(shared_from_this()));
+}
+
+
 vector<shared_ptr<FFmpegAudioStream>>
 FFmpegContent::ffmpeg_audio_streams () const
 {
@@ -27,6 +27,7 @@
 struct AVFormatContext;
 struct AVStream;
 
+class AudioWaveform;
 class Filter;
 class FFmpegSubtitleStream;
 class FFmpegAudioStream;
@@ -84,6 +85,7 @@ public:
 	}
 
 	std::vector<std::shared_ptr<FFmpegAudioStream>> ffmpeg_audio_streams () const;
+	std::shared_ptr<const AudioWaveform> audio_waveform () const;
 
 	std::vector<Filter const *> filters () const {
 		boost::mutex::scoped_lock lm (_mutex);
@@ -97,6 +99,14 @@ public:
 		return _first_video;
 	}
 
+	/** @return PTS of the video keyframes, in the video stream's time base, or an empty
+	 *  vector if they were not indexed when the content was examined.
+	 */
+	std::vector<int64_t> keyframes () const {
+		boost::mutex::scoped_lock lm (_mutex);
+		return _keyframes;
+	}
+
 	void signal_subtitle_stream_changed ();
 
 private:
@@ -116,6 +126,7 @@ private:
 	boost::optional<AVColorTransferCharacteristic> _color_trc;
 	boost::optional<AVColorSpace> _colorspace;
 	boost::optional<int> _bits_per_pixel;
+	std::vector<int64_t> _keyframes;
 };
 
 #endif
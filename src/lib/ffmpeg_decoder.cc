@@ -54,6 +54,7 @@ extern "C" {
 #include <libavformat/avformat.h>
 }
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <vector>
@@ -74,14 +75,16 @@ using dcp::Size;
 using namespace dcpomatic;
 
 
-FFmpegDecoder::FFmpegDecoder (shared_ptr<const Film> film, shared_ptr<const FFmpegContent> c, bool fast)
-	: FFmpeg (c)
+/** @param video_threads Number of threads to decode video with, or empty to use the number from the configuration */
+FFmpegDecoder::FFmpegDecoder (shared_ptr<const Film> film, shared_ptr<const FFmpegContent> c, bool fast, optional<int> video_threads, optional<int> video_reduction)
+	: FFmpeg (c, true, video_threads, video_reduction)
 	, Decoder (film)
 	, _filter_graphs(c->filters(), dcp::Fraction(lrint(_ffmpeg_content->video_frame_rate().get_value_or(24) * 1000), 1000))
 {
 	if (c->video && c->video->use()) {
 		video = make_shared<VideoDecoder>(this, c);
 		_pts_offset = pts_offset (c->ffmpeg_audio_streams(), c->first_video(), c->active_video_frame_rate(film));
+		_keyframes = c->keyframes();
 		/* It doesn't matter what size or pixel format this is, it just needs to be black */
 		_black_image = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size (128, 128), Image::Alignment::PADDED);
 		_black_image->make_black ();
@@ -249,135 +252,6 @@ FFmpegDecoder::pass ()
 }
 
 
-/** @param data pointer to array of pointers to buffers.
- *  Only the first buffer will be used for non-planar data, otherwise there will be one per channel.
- */
-static
-shared_ptr<AudioBuffers>
-deinterleave_audio(AVFrame* frame)
-{
-	auto format = static_cast<AVSampleFormat>(frame->format);
-
-	/* XXX: can't we use swr_convert() to do the format conversion? */
-
-	int const channels = frame->channels;
-	int const frames = frame->nb_samples;
-	int const total_samples = frames * channels;
-	auto audio = make_shared<AudioBuffers>(channels, frames);
-	auto data = audio->data();
-
-	if (frames == 0) {
-		return audio;
-	}
-
-	switch (format) {
-	case AV_SAMPLE_FMT_U8:
-	{
-		auto p = reinterpret_cast<uint8_t *> (frame->data[0]);
-		int sample = 0;
-		int channel = 0;
-		for (int i = 0; i < total_samples; ++i) {
-			data[channel][sample] = float(*p++) / (1 << 23);
-
-			++channel;
-			if (channel == channels) {
-				channel = 0;
-				++sample;
-			}
-		}
-	}
-	break;
-
-	case AV_SAMPLE_FMT_S16:
-	{
-		auto p = reinterpret_cast<int16_t *> (frame->data[0]);
-		int sample = 0;
-		int channel = 0;
-		for (int i = 0; i < total_samples; ++i) {
-			data[channel][sample] = float(*p++) / (1 << 15);
-
-			++channel;
-			if (channel == channels) {
-				channel = 0;
-				++sample;
-			}
-		}
-	}
-	break;
-
-	case AV_SAMPLE_FMT_S16P:
-	{
-		auto p = reinterpret_cast<int16_t **> (frame->data);
-		for (int i = 0; i < channels; ++i) {
-			for (int j = 0; j < frames; ++j) {
-				data[i][j] = static_cast<float>(p[i][j]) / (1 << 15);
-			}
-		}
-	}
-	break;
-
-	case AV_SAMPLE_FMT_S32:
-	{
-		auto p = reinterpret_cast<int32_t *> (frame->data[0]);
-		int sample = 0;
-		int channel = 0;
-		for (int i = 0; i < total_samples; ++i) {
-			data[channel][sample] = static_cast<float>(*p++) / 2147483648;
-
-			++channel;
-			if (channel == channels) {
-				channel = 0;
-				++sample;
-			}
-		}
-	}
-	break;
-
-	case AV_SAMPLE_FMT_S32P:
-	{
-		auto p = reinterpret_cast<int32_t **> (frame->data);
-		for (int i = 0; i < channels; ++i) {
-			for (int j = 0; j < frames; ++j) {
-				data[i][j] = static_cast<float>(p[i][j]) / 2147483648;
-			}
-		}
-	}
-	break;
-
-	case AV_SAMPLE_FMT_FLT:
-	{
-		auto p = reinterpret_cast<float*> (frame->data[0]);
-		int sample = 0;
-		int channel = 0;
-		for (int i = 0; i < total_samples; ++i) {
-			data[channel][sample] = *p++;
-
-			++channel;
-			if (channel == channels) {
-				channel = 0;
-				++sample;
-			}
-		}
-	}
-	break;
-
-	case AV_SAMPLE_FMT_FLTP:
-	{
-		auto p = reinterpret_cast<float**> (frame->data);
-		for (int i = 0; i < channels; ++i) {
-			memcpy (data[i], p[i], frames * sizeof(float));
-		}
-	}
-	break;
-
-	default:
-		throw DecodeError (String::compose(_("Unrecognised audio sample format (%1)"), static_cast<int>(format)));
-	}
-
-	return audio;
-}
-
-
 AVSampleFormat
 FFmpegDecoder::audio_sample_format (shared_ptr<FFmpegAudioStream> stream) const
 {
@@ -397,13 +271,6 @@ FFmpegDecoder::seek (ContentTime time, bool accurate)
 {
 	Decoder::seek (time, accurate);
 
-	/* If we are doing an `accurate' seek, we need to use pre-roll, as
-	   we don't really know what the seek will give us.
-	*/
-
-	auto pre_roll = accurate ? ContentTime::from_seconds (2) : ContentTime (0);
-	time -= pre_roll;
-
 	/* XXX: it seems debatable whether PTS should be used here...
 	   http://www.mjbshaw.com/2012/04/seeking-in-ffmpeg-know-your-timestamp.html
 	*/
@@ -422,16 +289,31 @@ FFmpegDecoder::seek (ContentTime time, bool accurate)
 
 	DCPOMATIC_ASSERT (stream);
 
-	auto u = time - _pts_offset;
-	if (u < ContentTime ()) {
-		u = ContentTime ();
+	auto const time_base = av_q2d (_format_context->streams[stream.get()]->time_base);
+
+	if (accurate && _video_stream && !_keyframes.empty()) {
+		/* We know where the keyframes are, so we can go straight to the one before the time
+		   that we want.  Go a little earlier if there's audio, as its packets may be
+		   interleaved before video packets with the same time.
+		*/
+		auto const margin = audio ? ContentTime::from_seconds(0.5) : ContentTime();
+		auto const target = llrint((time - _pts_offset - margin).seconds() / time_base);
+		auto keyframe = std::upper_bound(_keyframes.begin(), _keyframes.end(), target);
+		if (keyframe != _keyframes.begin()) {
+			--keyframe;
+		}
+		av_seek_frame (_format_context, stream.get(), *keyframe, AVSEEK_FLAG_BACKWARD);
+	} else {
+		/* If we are doing an `accurate' seek, we need to use pre-roll, as
+		   we don't really know what the seek will give us.
+		*/
+		auto pre_roll = accurate ? ContentTime::from_seconds (2) : ContentTime (0);
+		auto u = time - pre_roll - _pts_offset;
+		if (u < ContentTime ()) {
+			u = ContentTime ();
+		}
+		av_seek_frame (_format_context, stream.get(), u.seconds() / time_base, AVSEEK_FLAG_BACKWARD);
 	}
-	av_seek_frame (
-		_format_context,
-		stream.get(),
-		u.seconds() / av_q2d (_format_context->streams[stream.get()]->time_base),
-		AVSEEK_FLAG_BACKWARD
-		);
 
 	/* Force re-creation of filter graphs to reset them and hence to make sure
 	   they don't have any pre-seek frames knocking about.
@@ -609,8 +491,9 @@ FFmpegDecoder::decode_and_process_video_packet (AVPacket* packet)
 void
 FFmpegDecoder::process_video_frame ()
 {
-	auto graph = _filter_graphs.get(dcp::Size(_video_frame->width, _video_frame->height), static_cast<AVPixelFormat>(_video_frame->format));
-	auto images = graph->process (_video_frame);
+	auto frame = software_video_frame ();
+	auto graph = _filter_graphs.get(dcp::Size(frame->width, frame->height), static_cast<AVPixelFormat>(frame->format));
+	auto images = graph->process (frame);
 
 	for (auto const& i: images) {
 
@@ -621,7 +504,7 @@ FFmpegDecoder::process_video_frame ()
 
 			video->emit (
 				film(),
-				make_shared<RawImageProxy>(image),
+				make_shared<RawImageProxy>(image, _video_lowres),
 				llrint(pts * _ffmpeg_content->active_video_frame_rate(film()))
 				);
 		} else {
@@ -49,7 +49,13 @@ struct ffmpeg_pts_offset_test;
 class FFmpegDecoder : public FFmpeg, public Decoder
 {
 public:
-	FFmpegDecoder (std::shared_ptr<const Film> film, std::shared_ptr<const FFmpegContent>, bool fast);
+	FFmpegDecoder (
+		std::shared_ptr<const Film> film,
+		std::shared_ptr<const FFmpegContent>,
+		bool fast,
+		boost::optional<int> video_threads = boost::none,
+		boost::optional<int> video_reduction = boost::none
+		);
 
 	bool pass () override;
 	void seek (dcpomatic::ContentTime time, bool) override;
@@ -87,6 +93,8 @@ private:
 	VideoFilterGraphSet _filter_graphs;
 
 	dcpomatic::ContentTime _pts_offset;
+	/** PTS of the video keyframes (in the video stream's time base) if we know them */
+	std::vector<int64_t> _keyframes;
 	boost::optional<dcpomatic::ContentTime> _current_subtitle_to;
 	/** true if we have a subtitle which has not had emit_stop called for it yet */
 	bool _have_current_subtitle = false;
@@ -20,7 +20,9 @@
 
 
 #include "butler.h"
+#include "config.h"
 #include "cross.h"
+#include "dcpomatic_log.h"
 #include "ffmpeg_encoder.h"
 #include "film.h"
 #include "image.h"
@@ -28,7 +30,9 @@
 #include "log.h"
 #include "player.h"
 #include "player_video.h"
+#include "scope_guard.h"
 #include "compose.hpp"
+#include <algorithm>
 #include <iostream>
 
 #include "i18n.h"
@@ -39,6 +43,7 @@ using std::list;
 using std::make_shared;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using std::weak_ptr;
 using boost::bind;
 using boost::optional;
@@ -59,38 +64,28 @@ FFmpegEncoder::FFmpegEncoder (
 	int x264_crf
 	)
 	: Encoder (film, job)
-	, _output_audio_channels(mixdown_to_stereo ? 2 : (_film->audio_channels() > 8 ? 16 : _film->audio_channels()))
+	, _output_audio_channels(output_audio_channels(film, mixdown_to_stereo))
+	, _mixdown_to_stereo(mixdown_to_stereo)
 	, _history (200)
 	, _output (output)
 	, _format (format)
 	, _split_reels (split_reels)
 	, _audio_stream_per_channel (audio_stream_per_channel)
 	, _x264_crf (x264_crf)
-	, _butler(
-		_film,
-		_player,
-		mixdown_to_stereo ? stereo_map() : many_channel_map(),
-		_output_audio_channels,
-		boost::bind(&PlayerVideo::force, FFmpegFileEncoder::pixel_format(format)),
-		VideoRange::VIDEO,
-		Image::Alignment::PADDED,
-		false,
-		false,
-		Butler::Audio::ENABLED
-		)
 {
 	_player.set_always_burn_open_subtitles();
 	_player.set_play_referenced();
 }
 
 
+static
 AudioMapping
-FFmpegEncoder::stereo_map() const
+stereo_map (int channels)
 {
-	auto map = AudioMapping(_film->audio_channels(), 2);
+	auto map = AudioMapping(channels, 2);
 	float const overall_gain = 2 / (4 + sqrt(2));
 	float const minus_3dB = 1 / sqrt(2);
-	switch (_film->audio_channels()) {
+	switch (channels) {
 	case 2:
 		map.set(dcp::Channel::LEFT, 0, 1);
 		map.set(dcp::Channel::RIGHT, 1, 1);
@@ -116,17 +111,38 @@ FFmpegEncoder::stereo_map() const
 }
 
 
+static
 AudioMapping
-FFmpegEncoder::many_channel_map() const
+many_channel_map (int channels, int output_channels)
 {
-	auto map = AudioMapping(_film->audio_channels(), _output_audio_channels);
-	for (int i = 0; i < _film->audio_channels(); ++i) {
+	auto map = AudioMapping(channels, output_channels);
+	for (int i = 0; i < channels; ++i) {
 		map.set(i, i, 1);
 	}
 	return map;
 }
 
 
+/** @return Number of audio channels that an export of a film should have */
+int
+FFmpegEncoder::output_audio_channels (shared_ptr<const Film> film, bool mixdown_to_stereo)
+{
+	return mixdown_to_stereo ? 2 : (film->audio_channels() > 8 ? 16 : film->audio_channels());
+}
+
+
+/** @return Mapping from a film's audio channels to those of an export of it */
+AudioMapping
+FFmpegEncoder::audio_mapping (shared_ptr<const Film> film, bool mixdown_to_stereo)
+{
+	if (mixdown_to_stereo) {
+		return stereo_map(film->audio_channels());
+	}
+
+	return many_channel_map(film->audio_channels(), output_audio_channels(film, mixdown_to_stereo));
+}
+
+
 void
 FFmpegEncoder::go ()
 {
@@ -169,33 +185,144 @@ FFmpegEncoder::go ()
 			);
 	}
 
-	auto reel_periods = _film->reels ();
-	auto reel = reel_periods.begin ();
-	auto encoder = file_encoders.begin ();
+	vector<Target> targets;
+	if (file_encoders.size() > 1) {
+		auto encoder = file_encoders.begin();
+		for (auto const& reel: _film->reels()) {
+			DCPOMATIC_ASSERT (encoder != file_encoders.end());
+			targets.emplace_back(reel, &(*encoder));
+			++encoder;
+		}
+	} else {
+		targets.emplace_back(DCPTimePeriod({}, _film->length()), &file_encoders.front());
+	}
+
+	if (targets.size() > 1 && Config::instance()->export_concurrent_reels() > 1) {
+		export_reels (targets, waker);
+	} else {
+		export_period (_player, DCPTimePeriod({}, _film->length()), targets, waker);
+	}
+
+	for (auto& i: file_encoders) {
+		i.flush ();
+	}
+}
+
+
+/** Export some reels at the same time, each with its own Player and Butler.  The reels
+ *  are going to separate files, so they do not depend on each other at all.
+ */
+void
+FFmpegEncoder::export_reels (vector<Target> reels, Waker& waker)
+{
+	std::atomic<size_t> next{0};
+	boost::mutex exception_mutex;
+	boost::exception_ptr exception;
+
+	auto worker = [this, &reels, &next, &exception_mutex, &exception, &waker]() {
+		try {
+			while (!_stop) {
+				size_t const index = next++;
+				if (index >= reels.size()) {
+					break;
+				}
+				Player player(_film, Image::Alignment::PADDED);
+				player.set_always_burn_open_subtitles();
+				player.set_play_referenced();
+				export_period (player, reels[index].period, { reels[index] }, waker);
+			}
+		} catch (...) {
+			boost::mutex::scoped_lock lm (exception_mutex);
+			if (!exception) {
+				exception = boost::current_exception();
+			}
+			_stop = true;
+		}
+	};
+
+	int const threads = std::min(Config::instance()->export_concurrent_reels(), static_cast<int>(reels.size()));
+	LOG_GENERAL("Exporting %1 reels using %2 threads", reels.size(), threads);
+
+	boost::thread_group group;
+	for (int i = 0; i < threads; ++i) {
+		group.create_thread(worker);
+	}
+
+	try {
+		group.join_all ();
+	} catch (boost::thread_interrupted&) {
+		/* The job has been cancelled */
+		_stop = true;
+		group.interrupt_all ();
+		group.join_all ();
+		throw;
+	}
+
+	if (exception) {
+		boost::rethrow_exception (exception);
+	}
+}
+
+
+/** Export a period of the film using a given player.
+ *  @param targets Where to write the data; these must cover period, in order.
+ */
+void
+FFmpegEncoder::export_period (Player& player, DCPTimePeriod period, vector<Target> targets, Waker& waker)
+{
+	DCPOMATIC_ASSERT (!targets.empty());
+
+	Butler butler(
+		_film,
+		player,
+		audio_mapping(_film, _mixdown_to_stereo),
+		_output_audio_channels,
+		boost::bind(&PlayerVideo::force, FFmpegFileEncoder::pixel_format(_format)),
+		VideoRange::VIDEO,
+		Image::Alignment::PADDED,
+		false,
+		false,
+		Butler::Audio::ENABLED,
+		TaskScheduler::Priority::ENCODE
+		);
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_butlers.push_back(&butler);
+	}
+
+	ScopeGuard sg = [this, &butler]() {
+		boost::mutex::scoped_lock lm (_mutex);
+		_butlers.erase(std::remove(_butlers.begin(), _butlers.end(), &butler), _butlers.end());
+	};
+
+	if (period.from != DCPTime()) {
+		butler.seek (period.from, true);
+	}
+
+	auto target = targets.begin ();
 
 	auto const video_frame = DCPTime::from_frames (1, _film->video_frame_rate ());
 	int const audio_frames = video_frame.frames_round(_film->audio_frame_rate());
-	std::vector<float> interleaved(_output_audio_channels * audio_frames);
-	auto deinterleaved = make_shared<AudioBuffers>(_output_audio_channels, audio_frames);
 	int const gets_per_frame = _film->three_d() ? 2 : 1;
-	for (DCPTime time; time < _film->length(); time += video_frame) {
+	auto const length = _film->length().frames_round(_film->video_frame_rate());
 
-		if (file_encoders.size() > 1 && !reel->contains(time)) {
+	for (auto time = period.from; time < period.to && !_stop; time += video_frame) {
+
+		if (!target->period.contains(time)) {
 			/* Next reel and file */
-			++reel;
-			++encoder;
-			DCPOMATIC_ASSERT (reel != reel_periods.end());
-			DCPOMATIC_ASSERT (encoder != file_encoders.end());
+			++target;
+			DCPOMATIC_ASSERT (target != targets.end());
 		}
 
 		for (int j = 0; j < gets_per_frame; ++j) {
 			Butler::Error e;
-			auto video = _butler.get_video(Butler::Behaviour::BLOCKING, &e);
-			_butler.rethrow();
+			auto video = butler.get_video(Butler::Behaviour::BLOCKING, &e);
+			butler.rethrow();
 			if (video.first) {
-				auto fe = encoder->get(video.first->eyes());
+				auto fe = target->encoders->get(video.first->eyes());
 				if (fe) {
-					fe->video(video.first, video.second - reel->from);
+					fe->video(video.first, video.second - target->period.from);
 				}
 			} else {
 				if (e.code != Butler::Error::Code::FINISHED) {
@@ -205,35 +332,23 @@ FFmpegEncoder::go ()
 		}
 
 		_history.event ();
-
-		{
-			boost::mutex::scoped_lock lm (_mutex);
-			_last_time = time;
-		}
+		auto const done = ++_frames_done;
 
 		auto job = _job.lock ();
 		if (job) {
-			job->set_progress(float(time.get()) / _film->length().get());
+			job->set_progress(float(done) / length);
 		}
 
 		waker.nudge ();
 
-		_butler.get_audio(Butler::Behaviour::BLOCKING, interleaved.data(), audio_frames);
-		/* XXX: inefficient; butler interleaves and we deinterleave again */
-		float* p = interleaved.data();
-		for (int j = 0; j < audio_frames; ++j) {
-			for (int k = 0; k < _output_audio_channels; ++k) {
-				deinterleaved->data(k)[j] = *p++;
-			}
-		}
-		encoder->audio (deinterleaved);
-	}
-
-	for (auto i: file_encoders) {
-		i.flush ();
+		/* The file encoders will use this in their own threads, so we need a new one each time */
+		auto audio = make_shared<AudioBuffers>(_output_audio_channels, audio_frames);
+		butler.get_audio(Butler::Behaviour::BLOCKING, *audio);
+		target->encoders->audio (audio);
 	}
 }
 
+
 optional<float>
 FFmpegEncoder::current_rate () const
 {
@@ -243,8 +358,23 @@ FFmpegEncoder::current_rate () const
 Frame
 FFmpegEncoder::frames_done () const
 {
+	return _frames_done;
+}
+
+
+vector<Metric>
+FFmpegEncoder::metrics () const
+{
+	auto metrics = Encoder::metrics();
+	if (auto rate = current_rate()) {
+		metrics.emplace_back("encode_frames_per_second", *rate);
+	}
 	boost::mutex::scoped_lock lm (_mutex);
-	return _last_time.frames_round (_film->video_frame_rate ());
+	for (auto butler: _butlers) {
+		auto butler_metrics = butler->metrics();
+		metrics.insert(metrics.end(), butler_metrics.begin(), butler_metrics.end());
+	}
+	return metrics;
 }
 
 FFmpegEncoder::FileEncoderSet::FileEncoderSet (
@@ -26,6 +26,10 @@
 #include "encoder.h"
 #include "event_history.h"
 #include "ffmpeg_file_encoder.h"
+#include <atomic>
+
+
+class Waker;
 
 
 class FFmpegEncoder : public Encoder
@@ -46,12 +50,15 @@ public:
 
 	boost::optional<float> current_rate () const override;
 	Frame frames_done () const override;
+	std::vector<Metric> metrics () const override;
 	bool finishing () const override {
 		return false;
 	}
 
-private:
+	static int output_audio_channels (std::shared_ptr<const Film> film, bool mixdown_to_stereo);
+	static AudioMapping audio_mapping (std::shared_ptr<const Film> film, bool mixdown_to_stereo);
 
+	/** The files that an export is written to: one, or one for each eye of a 3D export */
 	class FileEncoderSet
 	{
 	public:
@@ -76,13 +83,34 @@ private:
 		std::map<Eyes, std::shared_ptr<FFmpegFileEncoder>> _encoders;
 	};
 
-	AudioMapping stereo_map() const;
-	AudioMapping many_channel_map() const;
+private:
+
+	/** A period of the film and the files that it should be written to */
+	struct Target
+	{
+		Target (dcpomatic::DCPTimePeriod period_, FileEncoderSet* encoders_)
+			: period(period_)
+			, encoders(encoders_)
+		{}
+
+		dcpomatic::DCPTimePeriod period;
+		FileEncoderSet* encoders;
+	};
+
+	void export_period (Player& player, dcpomatic::DCPTimePeriod period, std::vector<Target> targets, Waker& waker);
+	void export_reels (std::vector<Target> reels, Waker& waker);
 
 	int _output_audio_channels;
+	bool _mixdown_to_stereo;
 
+	std::atomic<Frame> _frames_done{0};
+	/** set to true to ask any threads exporting reels to stop */
+	std::atomic<bool> _stop{false};
+
+	/** Mutex for _butlers */
 	mutable boost::mutex _mutex;
-	dcpomatic::DCPTime _last_time;
+	/** Butlers that are currently in use by export_period() */
+	std::vector<Butler const*> _butlers;
 
 	EventHistory _history;
 
@@ -91,8 +119,6 @@ private:
 	bool _split_reels;
 	bool _audio_stream_per_channel;
 	int _x264_crf;
-
-	Butler _butler;
 };
 
 #endif
@@ -0,0 +1,328 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "audio_waveform.h"
+#include "config.h"
+#include "dcpomatic_log.h"
+#include "digester.h"
+#include "ffmpeg_audio_stream.h"
+#include "ffmpeg_content.h"
+#include "ffmpeg_examination.h"
+#include "ffmpeg_examiner.h"
+#include "ffmpeg_subtitle_stream.h"
+#include "film.h"
+#include "state.h"
+#include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
+#include <dcp/warnings.h>
+#include <libcxml/cxml.h>
+LIBDCP_DISABLE_WARNINGS
+#include <libxml++/libxml++.h>
+LIBDCP_ENABLE_WARNINGS
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include "i18n.h"
+
+
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::optional;
+using dcp::raw_convert;
+using namespace dcpomatic;
+
+
+template <class T>
+static T
+get_enum (cxml::ConstNodePtr node, string name)
+{
+	return static_cast<T>(node->number_child<int>(name));
+}
+
+
+FFmpegExamination::FFmpegExamination (shared_ptr<const FFmpegExaminer> examiner)
+	: _has_video (examiner->has_video())
+	, _subtitle_streams (examiner->subtitle_streams())
+	, _audio_streams (examiner->audio_streams())
+{
+	if (_has_video) {
+		_video_frame_rate = examiner->video_frame_rate();
+		_video_size = examiner->video_size();
+		_video_length = examiner->video_length();
+		_sample_aspect_ratio = examiner->sample_aspect_ratio();
+		_yuv = examiner->yuv();
+		_range = examiner->range();
+		_pixel_quanta = examiner->pixel_quanta();
+		_first_video = examiner->first_video();
+		_color_range = examiner->color_range();
+		_color_primaries = examiner->color_primaries();
+		_color_trc = examiner->color_trc();
+		_colorspace = examiner->colorspace();
+		_bits_per_pixel = examiner->bits_per_pixel();
+		_rotation = examiner->rotation();
+		_pulldown = examiner->pulldown();
+		_keyframes = examiner->keyframes();
+	}
+}
+
+
+FFmpegExamination::FFmpegExamination (cxml::ConstNodePtr node, int version)
+	: _has_video (node->bool_child("HasVideo"))
+{
+	if (_has_video) {
+		_video_frame_rate = node->optional_number_child<double>("VideoFrameRate");
+		_video_size = dcp::Size(node->number_child<int>("VideoWidth"), node->number_child<int>("VideoHeight"));
+		_video_length = node->number_child<Frame>("VideoLength");
+		_sample_aspect_ratio = node->optional_number_child<double>("SampleAspectRatio");
+		_yuv = node->bool_child("YUV");
+		_range = string_to_video_range(node->string_child("Range"));
+		_pixel_quanta = PixelQuanta(node->node_child("PixelQuanta"));
+		auto const f = node->optional_number_child<ContentTime::Type>("FirstVideo");
+		if (f) {
+			_first_video = ContentTime(*f);
+		}
+		_color_range = get_enum<AVColorRange>(node, "ColorRange");
+		_color_primaries = get_enum<AVColorPrimaries>(node, "ColorPrimaries");
+		_color_trc = get_enum<AVColorTransferCharacteristic>(node, "ColorTransferCharacteristic");
+		_colorspace = get_enum<AVColorSpace>(node, "Colorspace");
+		_bits_per_pixel = node->optional_number_child<int>("BitsPerPixel");
+		_rotation = node->optional_number_child<double>("Rotation");
+		_pulldown = node->bool_child("Pulldown");
+		_keyframes = keyframes_from_string(node->optional_string_child("Keyframes").get_value_or(""));
+	}
+
+	for (auto i: node->node_children("AudioStream")) {
+		_audio_streams.push_back(make_shared<FFmpegAudioStream>(i, version));
+	}
+
+	for (auto i: node->node_children("SubtitleStream")) {
+		_subtitle_streams.push_back(make_shared<FFmpegSubtitleStream>(i, version));
+	}
+}
+
+
+void
+FFmpegExamination::as_xml (xmlpp::Element* node) const
+{
+	node->add_child("HasVideo")->add_child_text(_has_video ? "1" : "0");
+
+	if (_has_video) {
+		if (_video_frame_rate) {
+			node->add_child("VideoFrameRate")->add_child_text(raw_convert<string>(*_video_frame_rate));
+		}
+		node->add_child("VideoWidth")->add_child_text(raw_convert<string>(_video_size.width));
+		node->add_child("VideoHeight")->add_child_text(raw_convert<string>(_video_size.height));
+		node->add_child("VideoLength")->add_child_text(raw_convert<string>(_video_length));
+		if (_sample_aspect_ratio) {
+			node->add_child("SampleAspectRatio")->add_child_text(raw_convert<string>(*_sample_aspect_ratio));
+		}
+		node->add_child("YUV")->add_child_text(_yuv ? "1" : "0");
+		node->add_child("Range")->add_child_text(video_range_to_string(_range));
+		_pixel_quanta.as_xml(node->add_child("PixelQuanta"));
+		if (_first_video) {
+			node->add_child("FirstVideo")->add_child_text(raw_convert<string>(_first_video->get()));
+		}
+		node->add_child("ColorRange")->add_child_text(raw_convert<string>(static_cast<int>(_color_range)));
+		node->add_child("ColorPrimaries")->add_child_text(raw_convert<string>(static_cast<int>(_color_primaries)));
+		node->add_child("ColorTransferCharacteristic")->add_child_text(raw_convert<string>(static_cast<int>(_color_trc)));
+		node->add_child("Colorspace")->add_child_text(raw_convert<string>(static_cast<int>(_colorspace)));
+		if (_bits_per_pixel) {
+			node->add_child("BitsPerPixel")->add_child_text(raw_convert<string>(*_bits_per_pixel));
+		}
+		if (_rotation) {
+			node->add_child("Rotation")->add_child_text(raw_convert<string>(*_rotation));
+		}
+		node->add_child("Pulldown")->add_child_text(_pulldown ? "1" : "0");
+		if (!_keyframes.empty()) {
+			node->add_child("Keyframes")->add_child_text(keyframes_to_string(_keyframes));
+		}
+	}
+
+	for (auto i: _audio_streams) {
+		i->as_xml(node->add_child("AudioStream"));
+	}
+
+	for (auto i: _subtitle_streams) {
+		i->as_xml(node->add_child("SubtitleStream"));
+	}
+}
+
+
+/** @return keyframe PTS as a space-separated list, for writing to XML */
+string
+FFmpegExamination::keyframes_to_string (vector<int64_t> const& keyframes)
+{
+	string s;
+	for (auto i: keyframes) {
+		if (!s.empty()) {
+			s += " ";
+		}
+		s += raw_convert<string>(i);
+	}
+	return s;
+}
+
+
+vector<int64_t>
+FFmpegExamination::keyframes_from_string (string s)
+{
+	vector<string> parts;
+	boost::split (parts, s, boost::is_any_of(" "), boost::token_compress_on);
+
+	vector<int64_t> keyframes;
+	for (auto const& i: parts) {
+		if (!i.empty()) {
+			keyframes.push_back(raw_convert<int64_t>(i));
+		}
+	}
+	return keyframes;
+}
+
+
+/** @return Key to use for the cached examination of some content; this must be called
+ *  after Content::examine() has established the content's digest.
+ */
+string
+FFmpegExamination::cache_key (shared_ptr<const FFmpegContent> content)
+{
+	Digester digester;
+	digester.add(content->digest());
+	for (size_t i = 0; i < content->number_of_paths(); ++i) {
+		digester.add(content->path(i).string());
+		digester.add(content->last_write_time(i));
+	}
+	/* These change what the examiner finds, so examinations with and without it must be kept apart */
+	digester.add(Config::instance()->ffmpeg_trust_container_index());
+	digester.add(Config::instance()->ffmpeg_keyframe_index());
+	return digester.get();
+}
+
+
+static boost::filesystem::path
+cache_file (string key)
+{
+	return State::read_path("examinations") / (key + ".xml");
+}
+
+
+/** @return Examination previously stored with the given key, or nullptr if there is none
+ *  (or it cannot be used).
+ */
+shared_ptr<FFmpegExamination>
+FFmpegExamination::from_cache (string key)
+{
+	auto const file = cache_file(key);
+	if (!dcp::filesystem::exists(file)) {
+		return {};
+	}
+
+	try {
+		cxml::Document doc("Examination");
+		doc.read_file(dcp::filesystem::fix_long_path(file));
+		auto const version = doc.number_child<int>("Version");
+		if (version != Film::current_state_version) {
+			/* Written by a different version; it will be replaced after the content is examined again */
+			return {};
+		}
+		return make_shared<FFmpegExamination>(doc.node_child("FFmpeg"), version);
+	} catch (std::exception& e) {
+		LOG_GENERAL("Could not read cached examination %1 (%2)", file.string(), e.what());
+	}
+
+	return {};
+}
+
+
+void
+FFmpegExamination::write_to_cache (string key) const
+{
+	auto const dir = State::write_path("examinations");
+	boost::system::error_code ec;
+	dcp::filesystem::create_directories(dir, ec);
+
+	xmlpp::Document doc;
+	auto root = doc.create_root_node("Examination");
+	root->add_child("Version")->add_child_text(raw_convert<string>(Film::current_state_version));
+	as_xml(root->add_child("FFmpeg"));
+
+	auto const file = dir / (key + ".xml");
+	/* Content may be examined by more than one job at once, so write to a unique
+	 * temporary name and then move it into place.
+	 */
+	auto const tmp = dir / (key + "." + boost::filesystem::unique_path().string() + ".tmp");
+
+	try {
+		doc.write_to_file_formatted(tmp.string());
+		dcp::filesystem::rename(tmp, file);
+	} catch (std::exception& e) {
+		/* Failing to cache is not fatal; the content will just be examined again next time */
+		LOG_WARNING("Could not write examination cache file %1 (%2)", file.string(), e.what());
+		dcp::filesystem::remove(tmp, ec);
+	}
+}
+
+
+static boost::filesystem::path
+audio_waveform_cache_file (string key)
+{
+	return State::read_path("examinations") / (key + ".waveform");
+}
+
+
+/** @return Audio waveform previously stored with the given key, or nullptr if there is none */
+shared_ptr<AudioWaveform>
+FFmpegExamination::audio_waveform_from_cache (string key)
+{
+	auto const file = audio_waveform_cache_file(key);
+	if (!dcp::filesystem::exists(file)) {
+		return {};
+	}
+
+	try {
+		return make_shared<AudioWaveform>(file);
+	} catch (std::exception& e) {
+		LOG_GENERAL("Could not read cached audio waveform %1 (%2)", file.string(), e.what());
+	}
+
+	return {};
+}
+
+
+void
+FFmpegExamination::write_audio_waveform_to_cache (string key, AudioWaveform const& waveform)
+{
+	auto const dir = State::write_path("examinations");
+	boost::system::error_code ec;
+	dcp::filesystem::create_directories(dir, ec);
+
+	auto const file = dir / (key + ".waveform");
+
+	try {
+		waveform.write(file);
+	} catch (std::exception& e) {
+		/* As with examinations, failing to cache this is not fatal */
+		LOG_WARNING("Could not write audio waveform cache file %1 (%2)", file.string(), e.what());
+	}
+}
@@ -0,0 +1,179 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/ffmpeg_examination.h
+ *  @brief FFmpegExamination class.
+ */
+
+
+#ifndef DCPOMATIC_FFMPEG_EXAMINATION_H
+#define DCPOMATIC_FFMPEG_EXAMINATION_H
+
+
+#include "dcpomatic_time.h"
+#include "video_examiner.h"
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+LIBDCP_ENABLE_WARNINGS
+#include <boost/optional.hpp>
+
+
+class AudioWaveform;
+class FFmpegAudioStream;
+class FFmpegContent;
+class FFmpegExaminer;
+class FFmpegSubtitleStream;
+
+
+/** @class FFmpegExamination
+ *  @brief The results of running an FFmpegExaminer over some content, in a form which
+ *  can be stored on disk so that the same files need not be examined again.
+ *
+ *  Examinations are kept in a global cache in the configuration directory, keyed on
+ *  the content's digest, paths and modification times.
+ */
+class FFmpegExamination : public VideoExaminer
+{
+public:
+	explicit FFmpegExamination (std::shared_ptr<const FFmpegExaminer> examiner);
+	FFmpegExamination (cxml::ConstNodePtr node, int version);
+
+	void as_xml (xmlpp::Element* node) const;
+
+	bool has_video () const override {
+		return _has_video;
+	}
+
+	boost::optional<double> video_frame_rate () const override {
+		return _video_frame_rate;
+	}
+
+	dcp::Size video_size () const override {
+		return _video_size;
+	}
+
+	Frame video_length () const override {
+		return _video_length;
+	}
+
+	boost::optional<double> sample_aspect_ratio () const override {
+		return _sample_aspect_ratio;
+	}
+
+	bool yuv () const override {
+		return _yuv;
+	}
+
+	VideoRange range () const override {
+		return _range;
+	}
+
+	PixelQuanta pixel_quanta () const override {
+		return _pixel_quanta;
+	}
+
+	std::vector<std::shared_ptr<FFmpegSubtitleStream>> subtitle_streams () const {
+		return _subtitle_streams;
+	}
+
+	std::vector<std::shared_ptr<FFmpegAudioStream>> audio_streams () const {
+		return _audio_streams;
+	}
+
+	boost::optional<dcpomatic::ContentTime> first_video () const {
+		return _first_video;
+	}
+
+	AVColorRange color_range () const {
+		return _color_range;
+	}
+
+	AVColorPrimaries color_primaries () const {
+		return _color_primaries;
+	}
+
+	AVColorTransferCharacteristic color_trc () const {
+		return _color_trc;
+	}
+
+	AVColorSpace colorspace () const {
+		return _colorspace;
+	}
+
+	boost::optional<int> bits_per_pixel () const {
+		return _bits_per_pixel;
+	}
+
+	boost::optional<double> rotation () const {
+		return _rotation;
+	}
+
+	bool pulldown () const {
+		return _pulldown;
+	}
+
+	std::vector<int64_t> keyframes () const {
+		return _keyframes;
+	}
+
+	static std::string keyframes_to_string (std::vector<int64_t> const& keyframes);
+	static std::vector<int64_t> keyframes_from_string (std::string s);
+
+	static std::string cache_key (std::shared_ptr<const FFmpegContent> content);
+	static std::shared_ptr<FFmpegExamination> from_cache (std::string key);
+	void write_to_cache (std::string key) const;
+
+	/* Waveforms are cached alongside the examinations but separately, as they can be large
+	 * and only the timeline needs them.
+	 */
+	static std::shared_ptr<AudioWaveform> audio_waveform_from_cache (std::string key);
+	static void write_audio_waveform_to_cache (std::string key, AudioWaveform const& waveform);
+
+private:
+	bool _has_video = false;
+	boost::optional<double> _video_frame_rate;
+	dcp::Size _video_size;
+	Frame _video_length = 0;
+	boost::optional<double> _sample_aspect_ratio;
+	bool _yuv = true;
+	VideoRange _range = VideoRange::FULL;
+	PixelQuanta _pixel_quanta;
+	std::vector<std::shared_ptr<FFmpegSubtitleStream>> _subtitle_streams;
+	std::vector<std::shared_ptr<FFmpegAudioStream>> _audio_streams;
+	boost::optional<dcpomatic::ContentTime> _first_video;
+	AVColorRange _color_range = AVCOL_RANGE_UNSPECIFIED;
+	AVColorPrimaries _color_primaries = AVCOL_PRI_UNSPECIFIED;
+	AVColorTransferCharacteristic _color_trc = AVCOL_TRC_UNSPECIFIED;
+	AVColorSpace _colorspace = AVCOL_SPC_UNSPECIFIED;
+	boost::optional<int> _bits_per_pixel;
+	boost::optional<double> _rotation;
+	bool _pulldown = false;
+	/** PTS of the video keyframes in the video stream's time base, or empty if they were not indexed */
+	std::vector<int64_t> _keyframes;
+};
+
+
+#endif
@@ -19,7 +19,11 @@
 */
 
 
+#include "audio_buffers.h"
+#include "audio_waveform.h"
+#include "config.h"
 #include "dcpomatic_log.h"
+#include "exceptions.h"
 #include "ffmpeg_examiner.h"
 #include "ffmpeg_content.h"
 #include "job.h"
@@ -38,6 +42,8 @@ extern "C" {
 #include <libavutil/eval.h>
 }
 LIBDCP_ENABLE_WARNINGS
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "i18n.h"
@@ -45,6 +51,7 @@ LIBDCP_ENABLE_WARNINGS
 
 using std::cout;
 using std::make_shared;
+using std::map;
 using std::max;
 using std::shared_ptr;
 using std::string;
@@ -58,6 +65,16 @@ using namespace dcpomatic;
  */
 static const int PULLDOWN_CHECK_FRAMES = 16;
 
+/* When we are trusting the container's index, this is the most packets that we will read
+ * from the start of the file to find the first video and audio.
+ */
+static const int INDEX_HEAD_PACKETS = 1024;
+
+/* When we are checking the container's index, we read packets from this many seconds before
+ * the end of the file to see if they agree with it.
+ */
+static const double INDEX_TAIL_SECONDS = 5;
+
 
 /** @param job job that the examiner is operating in, or 0 */
 FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Job> job)
@@ -66,6 +83,11 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 	, _need_video_length (false)
 	, _pulldown (false)
 {
+	bool const trust_index = Config::instance()->ffmpeg_trust_container_index() && index_is_consistent();
+	if (trust_index) {
+		LOG_GENERAL_NC("Taking lengths from the container index");
+	}
+
 	/* Find audio and subtitle streams */
 
 	for (uint32_t i = 0; i < _format_context->nb_streams; ++i) {
@@ -84,13 +106,15 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 			DCPOMATIC_ASSERT (_format_context->duration != AV_NOPTS_VALUE);
 			DCPOMATIC_ASSERT (codec->name);
 
+			auto const length_seconds = trust_index ? (s->duration * av_q2d(s->time_base)) : (double(_format_context->duration) / AV_TIME_BASE);
+
 			_audio_streams.push_back (
 				make_shared<FFmpegAudioStream>(
 					stream_name (s),
 					codec->name,
 					s->id,
 					s->codecpar->sample_rate,
-					llrint ((double(_format_context->duration) / AV_TIME_BASE) * s->codecpar->sample_rate),
+					llrint(length_seconds * s->codecpar->sample_rate),
 					s->codecpar->channels,
 					s->codecpar->bits_per_raw_sample ? s->codecpar->bits_per_raw_sample : s->codecpar->bits_per_coded_sample
 					)
@@ -101,10 +125,14 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 		}
 	}
 
+	_examine_subtitles = Config::instance()->ffmpeg_examine_subtitles() && !_subtitle_streams.empty();
+
 	if (has_video ()) {
 		/* See if the header has duration information in it */
 		_need_video_length = _format_context->duration == AV_NOPTS_VALUE;
-		if (!_need_video_length) {
+		if (trust_index) {
+			_video_length = _format_context->streams[*_video_stream]->nb_frames;
+		} else if (!_need_video_length) {
 			_video_length = llrint ((double (_format_context->duration) / AV_TIME_BASE) * video_frame_rate().get());
 		}
 	}
@@ -113,6 +141,13 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 		job->sub (_("Finding length"));
 	}
 
+	if (!trust_index && !_video_stream && !_audio_streams.empty()) {
+		/* We will read all of the audio to find its start, so we may as well summarise it
+		 * for the timeline while we are about it.
+		 */
+		_audio_waveform = make_shared<AudioWaveform>();
+	}
+
 	/* Run through until we find:
 	 *   - the first video.
 	 *   - the first audio for each stream.
@@ -125,7 +160,8 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 	 * and a string seems a reasonably neat way to do that.
 	 */
 	string temporal_reference;
-	while (true) {
+	int packets = 0;
+	while (!trust_index || packets++ < INDEX_HEAD_PACKETS) {
 		auto packet = av_packet_alloc ();
 		DCPOMATIC_ASSERT (packet);
 		int r = av_read_frame (_format_context, packet);
@@ -148,6 +184,8 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 			video_packet (context, temporal_reference, packet);
 		}
 
+		subtitle_packet (packet);
+
 		bool got_all_audio = true;
 
 		for (size_t i = 0; i < _audio_streams.size(); ++i) {
@@ -177,6 +215,27 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 		audio_packet(context, i, nullptr);
 	}
 
+	if (_audio_waveform) {
+		/* Put the waveform on the same timeline as the decoder will use */
+		_audio_waveform->shift(pts_offset(_audio_streams, _first_video, 24));
+	}
+
+	if (trust_index) {
+		/* We may have stopped before finding the start of everything; if so, the index will have to do */
+		auto start = [this](int index) {
+			auto stream = _format_context->streams[index];
+			return ContentTime::from_seconds(stream->start_time * av_q2d(stream->time_base));
+		};
+		if (_video_stream && !_first_video) {
+			_first_video = start(*_video_stream);
+		}
+		for (auto i: _audio_streams) {
+			if (!i->first_audio) {
+				i->first_audio = start(i->index(_format_context));
+			}
+		}
+	}
+
 	if (_video_stream) {
 		/* This code taken from get_rotation() in ffmpeg:cmdutils.c */
 		auto stream = _format_context->streams[*_video_stream];
@@ -199,6 +258,28 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 		_rotation = *_rotation - 360 * floor (*_rotation / 360 + 0.9 / 360);
 	}
 
+	if (Config::instance()->ffmpeg_keyframe_index() && _video_stream && c->number_of_paths() == 1) {
+		/* This will also look at the subtitles, if required */
+		build_keyframe_index (job);
+	} else if (_examine_subtitles) {
+		/* Carry on from where we stopped to find the rest of the subtitle colours, rather than
+		 * leaving ExamineFFmpegSubtitlesJob to read the whole file again later.
+		 */
+		if (job) {
+			job->sub (_("Examining subtitles"));
+		}
+		auto packet = av_packet_alloc ();
+		DCPOMATIC_ASSERT (packet);
+		while (av_read_frame(_format_context, packet) >= 0) {
+			subtitle_packet (packet);
+			av_packet_unref (packet);
+			if (job && len > 0) {
+				job->set_progress (float (_format_context->pb->pos) / len);
+			}
+		}
+		av_packet_free (&packet);
+	}
+
 	LOG_GENERAL("Temporal reference was %1", temporal_reference);
 	if (temporal_reference.find("T2T3B2B3T2T3B2B3") != string::npos || temporal_reference.find("B2B3T2T3B2B3T2T3") != string::npos) {
 		/* The magical sequence (taken from mediainfo) suggests that 2:3 pull-down is in use */
@@ -208,6 +289,151 @@ FFmpegExaminer::FFmpegExaminer (shared_ptr<const FFmpegContent> c, shared_ptr<Jo
 }
 
 
+/** Find the colours of any bitmap subtitles in a packet, if we are looking for them */
+void
+FFmpegExaminer::subtitle_packet (AVPacket* packet)
+{
+	if (!_examine_subtitles) {
+		return;
+	}
+
+	auto context = _codec_context[packet->stream_index];
+	if (!context) {
+		return;
+	}
+
+	for (auto stream: _subtitle_streams) {
+		if (stream->uses_index(_format_context, packet->stream_index)) {
+			find_subtitle_colours (context, packet, stream);
+		}
+	}
+}
+
+
+/** Read every packet in the file to find the PTS of each video keyframe (and the colours of
+ *  subtitles, if we are looking for them).
+ */
+void
+FFmpegExaminer::build_keyframe_index (shared_ptr<Job> job)
+{
+	if (job) {
+		job->sub (_("Indexing keyframes"));
+	}
+
+	auto const stream = _format_context->streams[*_video_stream];
+	if (av_seek_frame(_format_context, *_video_stream, stream->start_time == AV_NOPTS_VALUE ? 0 : stream->start_time, AVSEEK_FLAG_BACKWARD) < 0) {
+		LOG_WARNING_NC("Could not seek to the start of the file to index its keyframes");
+		return;
+	}
+
+	int64_t const len = _file_group.length ();
+	auto packet = av_packet_alloc ();
+	DCPOMATIC_ASSERT (packet);
+	while (av_read_frame(_format_context, packet) >= 0) {
+		if (packet->stream_index == *_video_stream && (packet->flags & AV_PKT_FLAG_KEY) && packet->pts != AV_NOPTS_VALUE) {
+			_keyframes.push_back (packet->pts);
+		}
+		subtitle_packet (packet);
+		av_packet_unref (packet);
+		if (job && len > 0) {
+			job->set_progress (float (_format_context->pb->pos) / len);
+		}
+	}
+	av_packet_free (&packet);
+
+	std::sort (_keyframes.begin(), _keyframes.end());
+	_keyframes.erase (std::unique(_keyframes.begin(), _keyframes.end()), _keyframes.end());
+
+	LOG_GENERAL("Found %1 keyframes", _keyframes.size());
+}
+
+
+/** @return true if the container's index gives lengths for the video and audio streams which agree
+ *  with each other and with the timestamps of the packets at the end of the file.  The file is left
+ *  positioned at its start.
+ */
+bool
+FFmpegExaminer::index_is_consistent ()
+{
+	if (_format_context->duration == AV_NOPTS_VALUE) {
+		return false;
+	}
+
+	vector<int> streams;
+	if (_video_stream) {
+		streams.push_back (*_video_stream);
+	}
+	for (uint32_t i = 0; i < _format_context->nb_streams; ++i) {
+		if (_format_context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && _codec_context[i]) {
+			streams.push_back (i);
+		}
+	}
+
+	if (streams.empty()) {
+		return false;
+	}
+
+	/* End time of each stream according to the index, in seconds */
+	map<int, double> index_end;
+	for (auto i: streams) {
+		auto s = _format_context->streams[i];
+		if (s->start_time == AV_NOPTS_VALUE || s->duration == AV_NOPTS_VALUE || s->duration <= 0) {
+			return false;
+		}
+		index_end[i] = (s->start_time + s->duration) * av_q2d(s->time_base);
+	}
+
+	optional<double> frame_rate;
+	if (_video_stream) {
+		auto s = _format_context->streams[*_video_stream];
+		frame_rate = video_frame_rate();
+		if (s->nb_frames <= 0 || !frame_rate || *frame_rate <= 0) {
+			return false;
+		}
+		auto const frames_from_duration = s->duration * av_q2d(s->time_base) * *frame_rate;
+		if (std::abs(frames_from_duration - s->nb_frames) > 1) {
+			LOG_GENERAL("Container index has %1 video frames but a duration of %2 frames", s->nb_frames, frames_from_duration);
+			return false;
+		}
+	}
+
+	/* Read the packets near the end of the file to find out where the streams really end */
+	auto const seek_stream = _format_context->streams[streams[0]];
+	auto const seek_seconds = std::max(0.0, index_end[streams[0]] - INDEX_TAIL_SECONDS);
+	if (av_seek_frame(_format_context, streams[0], llrint(seek_seconds / av_q2d(seek_stream->time_base)), AVSEEK_FLAG_BACKWARD) < 0) {
+		return false;
+	}
+
+	map<int, double> packet_end;
+	auto packet = av_packet_alloc ();
+	DCPOMATIC_ASSERT (packet);
+	while (av_read_frame(_format_context, packet) >= 0) {
+		if (index_end.find(packet->stream_index) != index_end.end() && packet->pts != AV_NOPTS_VALUE) {
+			auto const end = (packet->pts + packet->duration) * av_q2d(_format_context->streams[packet->stream_index]->time_base);
+			packet_end[packet->stream_index] = std::max(packet_end[packet->stream_index], end);
+		}
+		av_packet_unref (packet);
+	}
+	av_packet_free (&packet);
+
+	if (av_seek_frame(_format_context, streams[0], seek_stream->start_time, AVSEEK_FLAG_BACKWARD) < 0) {
+		throw DecodeError (N_("av_seek_frame"), N_("FFmpegExaminer::index_is_consistent"));
+	}
+
+	for (auto i: streams) {
+		/* Allow a frame and a half of error for video, and a bit more for audio, which tends to come in bigger packets */
+		auto const tolerance = (frame_rate && i == *_video_stream) ? (1.5 / *frame_rate) : 0.1;
+		auto const end = packet_end.find(i);
+		if (end == packet_end.end() || std::abs(end->second - index_end[i]) > tolerance) {
+			LOG_GENERAL("Container index for stream %1 doesn't agree with the end of the file", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 /** @param temporal_reference A string to which we should add two characters per frame;
  *  the first   is T or B depending on whether it's top- or bottom-field first,
  *  the second  is 3 or 2 depending on whether "repeat_pict" is true or not.
@@ -263,7 +489,7 @@ FFmpegExaminer::video_packet (AVCodecContext* context, string& temporal_referenc
 void
 FFmpegExaminer::audio_packet (AVCodecContext* context, shared_ptr<FFmpegAudioStream> stream, AVPacket* packet)
 {
-	if (stream->first_audio) {
+	if (stream->first_audio && !_audio_waveform) {
 		return;
 	}
 
@@ -275,11 +501,25 @@ FFmpegExaminer::audio_packet (AVCodecContext* context, shared_ptr<FFmpegAudioStr
 
 	auto frame = audio_frame (stream);
 
-	if (avcodec_receive_frame (context, frame) < 0) {
-		return;
-	}
+	while (avcodec_receive_frame(context, frame) >= 0) {
+		auto const time = frame_time (frame, stream->stream(_format_context));
+		if (!stream->first_audio) {
+			stream->first_audio = time;
+		}
 
-	stream->first_audio = frame_time (frame, stream->stream(_format_context));
+		if (_audio_waveform && time) {
+			try {
+				_audio_waveform->add(*deinterleave_audio(frame), frame->sample_rate, *time);
+			} catch (DecodeError& e) {
+				LOG_WARNING("Could not make audio waveform (%1)", e.what());
+				_audio_waveform.reset();
+			}
+		}
+
+		if (!_audio_waveform) {
+			break;
+		}
+	}
 }
 
 
@@ -25,6 +25,7 @@
 
 
 struct AVStream;
+class AudioWaveform;
 class FFmpegAudioStream;
 class FFmpegSubtitleStream;
 class Job;
@@ -85,9 +86,22 @@ public:
 		return _pulldown;
 	}
 
+	/** @return PTS of the video keyframes, in the video stream's time base, if an index was built */
+	std::vector<int64_t> keyframes () const {
+		return _keyframes;
+	}
+
+	/** @return Summary of the audio for drawing, if we read all of it during examination */
+	std::shared_ptr<const AudioWaveform> audio_waveform () const {
+		return _audio_waveform;
+	}
+
 private:
+	bool index_is_consistent ();
+	void build_keyframe_index (std::shared_ptr<Job> job);
 	bool video_packet (AVCodecContext* context, std::string& temporal_reference, AVPacket* packet);
 	void audio_packet (AVCodecContext* context, std::shared_ptr<FFmpegAudioStream>, AVPacket* packet);
+	void subtitle_packet (AVPacket* packet);
 
 	std::string stream_name (AVStream* s) const;
 	std::string subtitle_stream_name (AVStream* s) const;
@@ -104,6 +118,10 @@ private:
 
 	boost::optional<double> _rotation;
 	bool _pulldown;
+	/** true if we are finding the colours of bitmap subtitles as we go */
+	bool _examine_subtitles = false;
+	std::vector<int64_t> _keyframes;
+	std::shared_ptr<AudioWaveform> _audio_waveform;
 
 	struct SubtitleStart
 	{
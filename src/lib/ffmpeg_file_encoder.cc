@@ -273,11 +273,24 @@ FFmpegFileEncoder::FFmpegFileEncoder (
 	}
 
 	_pending_audio = make_shared<AudioBuffers>(channels, 0);
+
+	_thread = boost::thread(boost::bind(&FFmpegFileEncoder::thread, this));
+#ifdef DCPOMATIC_LINUX
+	pthread_setname_np (_thread.native_handle(), "ffmpeg-encoder");
+#endif
 }
 
 
 FFmpegFileEncoder::~FFmpegFileEncoder ()
 {
+	boost::this_thread::disable_interruption dis;
+
+	{
+		boost::mutex::scoped_lock lm (_queue_mutex);
+		_queue.clear ();
+	}
+	stop_thread ();
+
 	_audio_streams.clear ();
 	avcodec_close (_video_codec_context);
 	avio_close (_format_context->pb);
@@ -358,8 +371,86 @@ FFmpegFileEncoder::setup_audio ()
 }
 
 
+void
+FFmpegFileEncoder::thread ()
+try
+{
+	while (true) {
+		std::function<void ()> task;
+		{
+			boost::mutex::scoped_lock lm (_queue_mutex);
+			while (_queue.empty() && !_finishing) {
+				_queue_changed.wait (lm);
+			}
+			if (_queue.empty()) {
+				return;
+			}
+			task = _queue.front();
+			_queue.pop_front();
+		}
+		_queue_changed.notify_all ();
+		task ();
+	}
+}
+catch (...)
+{
+	store_current ();
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	_failed = true;
+	_queue.clear ();
+	_queue_changed.notify_all ();
+}
+
+
+/** Give our thread something to do, waiting if it already has plenty */
+void
+FFmpegFileEncoder::add (std::function<void ()> task)
+{
+	/* Enough to keep the codec busy without holding too many images in memory */
+	size_t const max_queue = 8;
+
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	while (_queue.size() >= max_queue && !_failed) {
+		_queue_changed.wait (lm);
+	}
+
+	if (_failed) {
+		lm.unlock ();
+		rethrow ();
+		return;
+	}
+
+	_queue.push_back (task);
+	_queue_changed.notify_all ();
+}
+
+
+void
+FFmpegFileEncoder::stop_thread ()
+{
+	{
+		boost::mutex::scoped_lock lm (_queue_mutex);
+		_finishing = true;
+		_queue_changed.notify_all ();
+	}
+
+	if (_thread.joinable()) {
+		_thread.join ();
+	}
+}
+
+
 void
 FFmpegFileEncoder::flush ()
+{
+	add (boost::bind(&FFmpegFileEncoder::encode_flush, this));
+	stop_thread ();
+	rethrow ();
+}
+
+
+void
+FFmpegFileEncoder::encode_flush ()
 {
 	if (_pending_audio->frames() > 0) {
 		audio_frame (_pending_audio->frames ());
@@ -403,7 +494,16 @@ FFmpegFileEncoder::flush ()
 void
 FFmpegFileEncoder::video (shared_ptr<PlayerVideo> video, DCPTime time)
 {
-	/* All our output formats are video range at the moment */
+	add (boost::bind(&FFmpegFileEncoder::encode_video, this, video, time));
+}
+
+
+void
+FFmpegFileEncoder::encode_video (shared_ptr<PlayerVideo> video, DCPTime time)
+{
+	/* All our output formats are video range at the moment.  This image will
+	 * usually have been made already by our caller's Butler.
+	 */
 	auto image = video->image (
 		bind (&PlayerVideo::force, _pixel_format),
 		VideoRange::VIDEO,
@@ -433,11 +533,15 @@ FFmpegFileEncoder::video (shared_ptr<PlayerVideo> video, DCPTime time)
 		throw EncodeError (N_("avcodec_send_frame"), N_("FFmpegFileEncoder::video"), r);
 	}
 
-	ffmpeg::Packet packet;
-	r = avcodec_receive_packet (_video_codec_context, packet.get());
-	if (r < 0 && r != AVERROR(EAGAIN)) {
-		throw EncodeError (N_("avcodec_receive_packet"), N_("FFmpegFileEncoder::video"), r);
-	} else if (r >= 0) {
+	/* Frame-threaded codecs may give us more than one packet after a frame, or none */
+	while (true) {
+		ffmpeg::Packet packet;
+		r = avcodec_receive_packet (_video_codec_context, packet.get());
+		if (r == AVERROR(EAGAIN)) {
+			break;
+		} else if (r < 0) {
+			throw EncodeError (N_("avcodec_receive_packet"), N_("FFmpegFileEncoder::video"), r);
+		}
 		packet->stream_index = _video_stream_index;
 		packet->duration = _video_stream->time_base.den / _video_frame_rate;
 		av_interleaved_write_frame (_format_context, packet.get());
@@ -445,9 +549,16 @@ FFmpegFileEncoder::video (shared_ptr<PlayerVideo> video, DCPTime time)
 }
 
 
-/** Called when the player gives us some audio */
+/** Called when the player gives us some audio.  The caller must not change audio after this call. */
 void
 FFmpegFileEncoder::audio (shared_ptr<AudioBuffers> audio)
+{
+	add (boost::bind(&FFmpegFileEncoder::encode_audio, this, shared_ptr<const AudioBuffers>(audio)));
+}
+
+
+void
+FFmpegFileEncoder::encode_audio (shared_ptr<const AudioBuffers> audio)
 {
 	_pending_audio->append (audio);
 
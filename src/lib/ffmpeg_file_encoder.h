@@ -27,6 +27,7 @@
 #include "dcpomatic_time.h"
 #include "encoder.h"
 #include "event_history.h"
+#include "exception_store.h"
 #include "image_store.h"
 #include "log.h"
 #include <dcp/key.h>
@@ -37,6 +38,10 @@ extern "C" {
 #include <libavformat/avformat.h>
 }
 LIBDCP_ENABLE_WARNINGS
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <functional>
+#include <list>
 
 
 class ExportAudioStream;
@@ -51,7 +56,14 @@ enum class ExportFormat
 };
 
 
-class FFmpegFileEncoder
+/** @class FFmpegFileEncoder
+ *  @brief Encoder for one output file.
+ *
+ *  Images are prepared by the caller's Butler, and the encoding and writing
+ *  is done by a thread of our own so that the caller can be fetching the next
+ *  frames while the codec works on the current ones.
+ */
+class FFmpegFileEncoder : public ExceptionStore
 {
 public:
 	FFmpegFileEncoder (
@@ -67,10 +79,14 @@ public:
 
 	~FFmpegFileEncoder ();
 
+	FFmpegFileEncoder (FFmpegFileEncoder const&) = delete;
+	FFmpegFileEncoder& operator= (FFmpegFileEncoder const&) = delete;
+
 	void video (std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime);
 	void audio (std::shared_ptr<AudioBuffers>);
 	void subtitle (PlayerText, dcpomatic::DCPTimePeriod);
 
+	/** Write any remaining data and wait for our thread to finish */
 	void flush ();
 
 	static AVPixelFormat pixel_format (ExportFormat format);
@@ -79,6 +95,13 @@ private:
 	void setup_video ();
 	void setup_audio ();
 
+	void thread ();
+	void add (std::function<void ()> task);
+	void encode_video (std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime);
+	void encode_audio (std::shared_ptr<const AudioBuffers>);
+	void encode_flush ();
+	void stop_thread ();
+
 	void audio_frame (int size);
 
 	AVCodec const * _video_codec = nullptr;
@@ -105,6 +128,16 @@ private:
 
 	ImageStore _pending_images;
 
+	/** Work for _thread to do, in the order that it must be done */
+	std::list<std::function<void ()>> _queue;
+	boost::mutex _queue_mutex;
+	boost::condition _queue_changed;
+	/** true if _thread should finish once _queue is empty */
+	bool _finishing = false;
+	/** true if _thread has stopped because of an exception */
+	bool _failed = false;
+	boost::thread _thread;
+
 	static int _video_stream_index;
 	static int _audio_stream_index_base;
 };
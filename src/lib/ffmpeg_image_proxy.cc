@@ -23,8 +23,10 @@
 #include "cross.h"
 #include "dcpomatic_assert.h"
 #include "dcpomatic_socket.h"
+#include "encoding_request.h"
 #include "exceptions.h"
 #include "ffmpeg_image_proxy.h"
+#include "ffmpeg_wrapper.h"
 #include "image.h"
 #include "memory_util.h"
 #include <dcp/raw_convert.h>
@@ -38,6 +40,8 @@ extern "C" {
 #include <libxml++/libxml++.h>
 LIBDCP_ENABLE_WARNINGS
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include "i18n.h"
 
@@ -69,6 +73,20 @@ FFmpegImageProxy::FFmpegImageProxy (dcp::ArrayData data)
 
 }
 
+
+/** @param data Contents of a file.
+ *  @param path File that the data came from, for error messages.
+ *  @param codec Codec for the data, from probe_codec(), if known.
+ */
+FFmpegImageProxy::FFmpegImageProxy (dcp::ArrayData data, boost::filesystem::path path, optional<AVCodecID> codec)
+	: _data (data)
+	, _pos (0)
+	, _path (path)
+	, _codec (codec)
+{
+
+}
+
 FFmpegImageProxy::FFmpegImageProxy (shared_ptr<Socket> socket)
 	: _pos (0)
 {
@@ -122,16 +140,15 @@ FFmpegImageProxy::avio_seek (int64_t const pos, int whence)
 }
 
 
-ImageProxy::Result
-FFmpegImageProxy::image (Image::Alignment alignment, optional<dcp::Size>) const
+/** @return Format context for _data, opened and with its stream information found; the caller
+ *  must close it with avformat_close_input() and free its pb.
+ */
+AVFormatContext*
+FFmpegImageProxy::open_format () const
 {
-	auto constexpr name_for_errors = "FFmpegImageProxy::image";
+	auto constexpr name_for_errors = "FFmpegImageProxy::open_format";
 
-	boost::mutex::scoped_lock lm (_mutex);
-
-	if (_image) {
-		return Result (_image, 0);
-	}
+	_pos = 0;
 
 	uint8_t* avio_buffer = static_cast<uint8_t*> (wrapped_av_malloc(4096));
 	auto avio_context = avio_alloc_context (avio_buffer, 4096, 0, const_cast<FFmpegImageProxy*>(this), avio_read_wrapper, 0, avio_seek_wrapper);
@@ -157,7 +174,10 @@ FFmpegImageProxy::image (Image::Alignment alignment, optional<dcp::Size>) const
 		format_context->iformat = f;
 		e = avformat_open_input (&format_context, "foo.tga", f, &options);
 	}
+	av_dict_free (&options);
 	if (e < 0) {
+		av_free (avio_context->buffer);
+		av_free (avio_context);
 		if (_path) {
 			throw OpenFileError (_path->string(), e, OpenFileError::READ);
 		} else {
@@ -172,6 +192,182 @@ FFmpegImageProxy::image (Image::Alignment alignment, optional<dcp::Size>) const
 
 	DCPOMATIC_ASSERT (format_context->nb_streams == 1);
 
+	return format_context;
+}
+
+
+/** Find the codec needed to decode some image data.  Images from the same sequence will
+ *  almost always use the same codec, so passing the result of this into the constructor
+ *  for the other images in the sequence saves probing each one separately.
+ *  @return Codec that can decode the data without a demuxer, or none if the data
+ *  must be probed whenever it is decoded.
+ */
+optional<AVCodecID>
+FFmpegImageProxy::probe_codec (dcp::ArrayData data)
+{
+	FFmpegImageProxy proxy (data);
+	auto format_context = proxy.open_format ();
+	auto const codec = format_context->streams[0]->codecpar->codec_id;
+	auto avio_context = format_context->pb;
+	avformat_close_input (&format_context);
+	av_free (avio_context->buffer);
+	av_free (avio_context);
+
+	/* These codecs take one whole image file as a packet and need nothing from the demuxer */
+	switch (codec) {
+	case AV_CODEC_ID_BMP:
+	case AV_CODEC_ID_DPX:
+	case AV_CODEC_ID_MJPEG:
+	case AV_CODEC_ID_PAM:
+	case AV_CODEC_ID_PGM:
+	case AV_CODEC_ID_PNG:
+	case AV_CODEC_ID_PPM:
+	case AV_CODEC_ID_SGI:
+	case AV_CODEC_ID_TARGA:
+	case AV_CODEC_ID_TIFF:
+	case AV_CODEC_ID_WEBP:
+		return codec;
+	default:
+		return {};
+	}
+}
+
+
+/** Decoder contexts which have been opened and can be used again, so that each image of a
+ *  sequence does not have to open its own.
+ */
+class CodecContextPool
+{
+public:
+	~CodecContextPool ()
+	{
+		for (auto& i: _contexts) {
+			for (auto j: i.second) {
+				avcodec_free_context (&j);
+			}
+		}
+	}
+
+	/** @return An open context for codec, or nullptr if one could not be opened */
+	AVCodecContext* take (AVCodecID codec)
+	{
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			auto& free = _contexts[codec];
+			if (!free.empty()) {
+				auto context = free.back();
+				free.pop_back();
+				return context;
+			}
+		}
+
+		auto decoder = avcodec_find_decoder (codec);
+		if (!decoder) {
+			return nullptr;
+		}
+
+		auto context = avcodec_alloc_context3 (decoder);
+		if (!context) {
+			return nullptr;
+		}
+
+		if (avcodec_open2(context, decoder, 0) < 0) {
+			avcodec_free_context (&context);
+			return nullptr;
+		}
+
+		return context;
+	}
+
+	/** Return a context (which has been used successfully) to the pool */
+	void give (AVCodecID codec, AVCodecContext* context)
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		auto& free = _contexts[codec];
+		if (free.size() < max_free) {
+			free.push_back (context);
+		} else {
+			avcodec_free_context (&context);
+		}
+	}
+
+private:
+	/** Most contexts to keep for each codec; roughly the most threads that will decode at once */
+	static size_t constexpr max_free = 16;
+
+	boost::mutex _mutex;
+	std::map<AVCodecID, std::vector<AVCodecContext*>> _contexts;
+};
+
+
+static CodecContextPool codec_context_pool;
+
+
+/** Decode _data by passing it straight to a decoder for _codec.
+ *  @return Image, or nullptr if this did not work (in which case the caller should
+ *  try the slower way with a demuxer).
+ */
+shared_ptr<Image>
+FFmpegImageProxy::decode_without_demuxer (Image::Alignment alignment) const
+{
+	DCPOMATIC_ASSERT (_codec);
+
+	auto context = codec_context_pool.take (*_codec);
+	if (!context) {
+		return {};
+	}
+
+	/* Decoders may read a little past the end of the data, so we must copy it into a packet
+	   which is padded with zeros.
+	*/
+	ffmpeg::Packet packet;
+	if (av_new_packet(packet.get(), _data.size()) < 0) {
+		avcodec_free_context (&context);
+		throw std::bad_alloc ();
+	}
+	memcpy (packet->data, _data.data(), _data.size());
+	packet->flags |= AV_PKT_FLAG_KEY;
+
+	auto frame = av_frame_alloc ();
+	if (!frame) {
+		avcodec_free_context (&context);
+		throw std::bad_alloc ();
+	}
+
+	shared_ptr<Image> image;
+	if (avcodec_send_packet(context, packet.get()) >= 0 && avcodec_receive_frame(context, frame) >= 0) {
+		image = make_shared<Image>(frame, alignment);
+		codec_context_pool.give (*_codec, context);
+	} else {
+		/* Don't risk re-using a context which may be in a strange state */
+		avcodec_free_context (&context);
+	}
+
+	av_frame_free (&frame);
+	return image;
+}
+
+
+ImageProxy::Result
+FFmpegImageProxy::image (Image::Alignment alignment, optional<dcp::Size>) const
+{
+	auto constexpr name_for_errors = "FFmpegImageProxy::image";
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (_image) {
+		return Result (_image, 0);
+	}
+
+	if (_codec) {
+		_image = decode_without_demuxer (alignment);
+		if (_image) {
+			return Result (_image, 0);
+		}
+	}
+
+	auto format_context = open_format ();
+
 	auto frame = av_frame_alloc ();
 	if (!frame) {
 		std::bad_alloc ();
@@ -185,7 +381,7 @@ FFmpegImageProxy::image (Image::Alignment alignment, optional<dcp::Size>) const
 		throw DecodeError (N_("avcodec_alloc_context3"), name_for_errors, *_path);
 	}
 
-	r = avcodec_open2 (context, codec, 0);
+	auto r = avcodec_open2 (context, codec, 0);
 	if (r < 0) {
 		throw DecodeError (N_("avcodec_open2"), name_for_errors, r, *_path);
 	}
@@ -208,6 +404,7 @@ FFmpegImageProxy::image (Image::Alignment alignment, optional<dcp::Size>) const
 
 	_image = make_shared<Image>(frame, alignment);
 
+	auto avio_context = format_context->pb;
 	av_packet_unref (&packet);
 	av_frame_free (&frame);
 	avcodec_free_context (&context);
@@ -226,8 +423,15 @@ FFmpegImageProxy::add_metadata (xmlpp::Node* node) const
 }
 
 void
-FFmpegImageProxy::write_to_socket (shared_ptr<Socket> socket) const
+FFmpegImageProxy::add_metadata (EncodingRequestWriter& writer) const
+{
+	writer.write_uint(static_cast<uint32_t>(Type::FFMPEG));
+}
+
+void
+FFmpegImageProxy::write_to_socket (shared_ptr<Socket> socket, TransportCompression) const
 {
+	/* This data is (almost always) compressed already, so we don't compress it again */
 	socket->write (_data.size());
 	socket->write (_data.data(), _data.size());
 }
@@ -20,14 +20,25 @@
 
 #include "image_proxy.h"
 #include <dcp/array_data.h>
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+LIBDCP_ENABLE_WARNINGS
+#include <boost/optional.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/filesystem.hpp>
 
+struct AVFormatContext;
+
+
 class FFmpegImageProxy : public ImageProxy
 {
 public:
 	explicit FFmpegImageProxy (boost::filesystem::path);
 	explicit FFmpegImageProxy (dcp::ArrayData);
+	FFmpegImageProxy (dcp::ArrayData, boost::filesystem::path path, boost::optional<AVCodecID> codec = boost::none);
 	FFmpegImageProxy (std::shared_ptr<Socket> socket);
 
 	Result image (
@@ -36,20 +47,31 @@ public:
 		) const override;
 
 	void add_metadata (xmlpp::Node *) const override;
-	void write_to_socket (std::shared_ptr<Socket>) const override;
+	void add_metadata (EncodingRequestWriter& writer) const override;
+	void write_to_socket (std::shared_ptr<Socket>, TransportCompression) const override;
 	bool same (std::shared_ptr<const ImageProxy> other) const override;
 	size_t memory_used () const override;
 
 	int avio_read (uint8_t* buffer, int const amount);
 	int64_t avio_seek (int64_t const pos, int whence);
 
+	static boost::optional<AVCodecID> probe_codec (dcp::ArrayData data);
+
 private:
+	AVFormatContext* open_format () const;
+	std::shared_ptr<Image> decode_without_demuxer (Image::Alignment alignment) const;
+
 	dcp::ArrayData _data;
 	mutable int64_t _pos;
 	/** Path of a file that this image came from, if applicable; stored so that
 	    failed-decode errors can give more detail.
 	*/
 	boost::optional<boost::filesystem::path> _path;
+	/** Codec that _data is known to need, if it has been found by calling probe_codec()
+	    for another image from the same sequence; if this is set we can decode without
+	    probing.
+	*/
+	boost::optional<AVCodecID> _codec;
 	mutable std::shared_ptr<Image> _image;
 	mutable boost::mutex _mutex;
 };
@@ -71,6 +71,18 @@ FileGroup::set_paths (vector<boost::filesystem::path> const & p)
 }
 
 
+/** Ask the OS to read some way ahead of wherever we are reading in our files, which
+ *  can help a lot when the files are on network storage.
+ *  @param bytes Number of bytes to read ahead, or 0 to not ask for any read-ahead.
+ */
+void
+FileGroup::set_read_ahead (int64_t bytes)
+{
+	_read_ahead = bytes;
+	_read_ahead_from = _read_ahead_to = 0;
+}
+
+
 /** Ensure that the given path index in the content is the _current_file */
 void
 FileGroup::ensure_open_path (size_t p) const
@@ -90,6 +102,33 @@ FileGroup::ensure_open_path (size_t p) const
 		throw OpenFileError (_paths[_current_path], errno, OpenFileError::READ);
 	}
 	_current_size = dcp::filesystem::file_size(_paths[_current_path]);
+	_read_ahead_from = _read_ahead_to = 0;
+}
+
+
+/** Ask for some read-ahead if we are close to the end of the last part
+ *  that we asked for, or outside it.
+ */
+void
+FileGroup::maybe_read_ahead () const
+{
+	if (_read_ahead == 0) {
+		return;
+	}
+
+	auto const position = _current_file->tell();
+	if (position < 0) {
+		return;
+	}
+
+	if (position >= _read_ahead_from && (position + _read_ahead / 2) < _read_ahead_to) {
+		/* We asked for this part recently */
+		return;
+	}
+
+	advise_read_ahead (_current_file->get(), position, _read_ahead);
+	_read_ahead_from = position;
+	_read_ahead_to = position + _read_ahead;
 }
 
 
@@ -149,6 +188,8 @@ FileGroup::read (uint8_t* buffer, int amount) const
 
 		DCPOMATIC_ASSERT (_current_file);
 
+		maybe_read_ahead ();
+
 		auto const current_position = _current_file->tell();
 		if (current_position == -1) {
 			to_read = 0;
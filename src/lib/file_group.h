@@ -48,6 +48,7 @@ public:
 	FileGroup& operator= (FileGroup const&) = delete;
 
 	void set_paths (std::vector<boost::filesystem::path> const &);
+	void set_read_ahead (int64_t bytes);
 
 	struct Result {
 		Result(int bytes_read_, bool eof_)
@@ -65,6 +66,7 @@ public:
 
 private:
 	void ensure_open_path (size_t) const;
+	void maybe_read_ahead () const;
 
 	std::vector<boost::filesystem::path> _paths;
 	/** Index of path that we are currently reading from */
@@ -72,6 +74,11 @@ private:
 	mutable boost::optional<dcp::File> _current_file;
 	mutable size_t _current_size = 0;
 	mutable int64_t _position = 0;
+	/** Number of bytes to ask the OS to read ahead of our position, or 0 */
+	int64_t _read_ahead = 0;
+	/** Range of _current_file which we last asked the OS to read ahead */
+	mutable int64_t _read_ahead_from = 0;
+	mutable int64_t _read_ahead_to = 0;
 };
 
 
@@ -22,11 +22,15 @@
 #include "file_log.h"
 #include "cross.h"
 #include "config.h"
+#include "util.h"
 #include <dcp/file.h>
 #include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
+#include <boost/thread.hpp>
 #include <cstdio>
 #include <iostream>
 #include <cerrno>
+#include <set>
 
 
 using std::cout;
@@ -35,38 +39,239 @@ using std::max;
 using std::shared_ptr;
 
 
+/** Interval between writes of queued entries to the file, in milliseconds */
+static int const write_interval = 100;
+/** Interval between flushes of the file, in milliseconds */
+static int const flush_interval = 1000;
+/** Size of file, in bytes, after which we move it aside and start a new one */
+static uintmax_t const rotate_size = 64 * 1024 * 1024;
+/** Number of files that have been moved aside to keep */
+static int const rotate_keep = 4;
+
+
+/** The logs that the writer thread is looking after.  This is never destroyed, so
+ *  that it is still safe to use while the program is exiting.
+ */
+struct FileLogRegistry
+{
+	boost::mutex mutex;
+	std::set<FileLog*> logs;
+};
+
+
+/** The registry, once it exists; unlike FileLog::registry() this can be used without creating it */
+static std::atomic<FileLogRegistry*> existing_registry (nullptr);
+
+
+FileLogRegistry*
+FileLog::registry ()
+{
+	static auto instance = new FileLogRegistry;
+	/* Likewise this thread is never stopped */
+	static auto writer = new boost::thread (&FileLog::writer_thread);
+	(void) writer;
+	existing_registry = instance;
+	return instance;
+}
+
+
 /** @param file Filename to write log to */
 FileLog::FileLog (boost::filesystem::path file)
 	: _file (file)
+	, _queue (nullptr)
 {
 	set_types (Config::instance()->log_types());
+
+	auto r = registry ();
+	boost::mutex::scoped_lock lm (r->mutex);
+	r->logs.insert (this);
 }
 
 
 FileLog::FileLog (boost::filesystem::path file, int types)
 	: _file (file)
+	, _queue (nullptr)
 {
 	set_types (types);
+
+	auto r = registry ();
+	boost::mutex::scoped_lock lm (r->mutex);
+	r->logs.insert (this);
+}
+
+
+FileLog::~FileLog ()
+{
+	{
+		/* Once we have been removed the writer thread can't be writing our entries */
+		auto r = registry ();
+		boost::mutex::scoped_lock lm (r->mutex);
+		r->logs.erase (this);
+	}
+
+	flush ();
 }
 
 
 void
 FileLog::do_log (shared_ptr<const LogEntry> entry)
 {
-	dcp::File f(_file, "a");
-	if (!f) {
-		cout << "(could not log to " << _file.string() << " error " << errno << "): " << entry->get() << "\n";
+	auto node = new Node { entry, _queue.load() };
+	while (!_queue.compare_exchange_weak(node->next, node)) {}
+}
+
+
+/** Write any queued entries to the file; _write_mutex must be held */
+void
+FileLog::write_queued ()
+{
+	/* Take everything in the queue, and reverse it so that the oldest entry is first */
+	auto node = _queue.exchange (nullptr);
+	Node* oldest = nullptr;
+	while (node) {
+		auto next = node->next;
+		node->next = oldest;
+		oldest = node;
+		node = next;
+	}
+
+	bool flush_now = false;
+
+	while (oldest) {
+		auto const line = oldest->entry->get();
+
+		if (!_output) {
+			_output.reset (new dcp::File(_file, "a"));
+			if (!*_output) {
+				_output.reset ();
+			} else {
+				boost::system::error_code ec;
+				_size = dcp::filesystem::file_size(_file, ec);
+				if (ec) {
+					_size = 0;
+				}
+			}
+		}
+
+		if (_output) {
+			fprintf (_output->get(), "%s\n", line.c_str());
+			_size += line.size() + 1;
+			_unflushed = true;
+		} else {
+			cout << "(could not log to " << _file.string() << " error " << errno << "): " << line << "\n";
+		}
+
+		if (oldest->entry->type() & LogEntry::TYPE_ERROR) {
+			flush_now = true;
+		}
+
+		auto next = oldest->next;
+		delete oldest;
+		oldest = next;
+
+		if (_size > rotate_size) {
+			rotate ();
+		}
+	}
+
+	auto const now = boost::posix_time::microsec_clock::universal_time();
+	if (_output && _unflushed && (flush_now || _last_flush.is_not_a_date_time() || (now - _last_flush) > boost::posix_time::milliseconds(flush_interval))) {
+		fflush (_output->get());
+		_unflushed = false;
+		_last_flush = now;
+	}
+}
+
+
+/** Move our file aside to <file>.1 (moving any existing <file>.1 to <file>.2 and so on), so that we
+ *  start a new one; _write_mutex must be held.
+ */
+void
+FileLog::rotate ()
+{
+	_output.reset ();
+	_size = 0;
+	_unflushed = false;
+
+	auto numbered = [this](int n) {
+		return boost::filesystem::path(_file.string() + "." + dcp::raw_convert<string>(n));
+	};
+
+	boost::system::error_code ec;
+	dcp::filesystem::remove (numbered(rotate_keep), ec);
+	for (int i = rotate_keep - 1; i > 0; --i) {
+		dcp::filesystem::rename (numbered(i), numbered(i + 1), ec);
+	}
+	dcp::filesystem::rename (_file, numbered(1), ec);
+}
+
+
+/** Write everything that has been logged so far, and flush the file */
+void
+FileLog::flush ()
+{
+	boost::mutex::scoped_lock lm (_write_mutex);
+	write_queued ();
+	if (_output && _unflushed) {
+		fflush (_output->get());
+		_unflushed = false;
+	}
+}
+
+
+/** Try to write everything that has been logged to every FileLog.  This is called when
+ *  we are about to crash, so it gives up on any log that is in use rather than waiting.
+ */
+void
+FileLog::flush_all ()
+{
+	auto r = existing_registry.load ();
+	if (!r) {
 		return;
 	}
 
-	fprintf(f.get(), "%s\n", entry->get().c_str());
+	boost::mutex::scoped_lock lm (r->mutex, boost::try_to_lock);
+	if (!lm) {
+		return;
+	}
+
+	for (auto log: r->logs) {
+		boost::mutex::scoped_lock wm (log->_write_mutex, boost::try_to_lock);
+		if (wm) {
+			log->write_queued ();
+			if (log->_output) {
+				fflush (log->_output->get());
+			}
+		}
+	}
+}
+
+
+void
+FileLog::writer_thread ()
+{
+	start_of_thread ("FileLog");
+
+	while (true) {
+		boost::this_thread::sleep (boost::posix_time::milliseconds(write_interval));
+
+		auto r = registry ();
+		boost::mutex::scoped_lock lm (r->mutex);
+		for (auto log: r->logs) {
+			boost::mutex::scoped_lock wm (log->_write_mutex);
+			log->write_queued ();
+		}
+	}
 }
 
 
 string
 FileLog::head_and_tail (int amount) const
 {
-	boost::mutex::scoped_lock lm (_mutex);
+	/* Make sure that everything logged so far is in the file; this doesn't change anything that anybody can see */
+	const_cast<FileLog*>(this)->flush ();
+
+	boost::mutex::scoped_lock lm (_write_mutex);
 
 	uintmax_t head_amount = amount;
 	uintmax_t tail_amount = amount;
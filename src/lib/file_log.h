@@ -20,19 +20,67 @@
 
 
 #include "log.h"
+#include <dcp/file.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <memory>
 
 
+struct FileLogRegistry;
+
+
+/** @class FileLog
+ *  @brief A log which writes to a file.
+ *
+ *  Entries are put onto a lock-free queue by whichever thread logs them, and a single
+ *  background thread (shared by all FileLogs) writes them to the file, which is kept open.
+ *  The file is flushed every second, or straight away after an error is logged, and
+ *  is moved aside when it becomes large.
+ */
 class FileLog : public Log
 {
 public:
 	explicit FileLog (boost::filesystem::path file);
 	FileLog (boost::filesystem::path file, int types);
+	~FileLog ();
 
 	std::string head_and_tail (int amount = 1024) const override;
 
+	void flush ();
+
+	static void flush_all ();
+
 private:
 	void do_log (std::shared_ptr<const LogEntry> entry) override;
+	bool concurrent_do_log () const override {
+		return true;
+	}
+
+	void write_queued ();
+	void rotate ();
+
+	static FileLogRegistry* registry ();
+	static void writer_thread ();
 
 	/** filename to write to */
 	boost::filesystem::path _file;
+
+	struct Node
+	{
+		std::shared_ptr<const LogEntry> entry;
+		Node* next;
+	};
+
+	/** Entries waiting to be written, most recent first */
+	std::atomic<Node*> _queue;
+
+	/** Mutex held while writing to _output, and protecting the things below it */
+	mutable boost::mutex _write_mutex;
+	std::unique_ptr<dcp::File> _output;
+	/** Size of _file, in bytes */
+	uintmax_t _size = 0;
+	/** true if something has been written to _output since it was last flushed */
+	bool _unflushed = false;
+	boost::posix_time::ptime _last_flush;
 };
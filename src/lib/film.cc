@@ -49,6 +49,7 @@
 #include "font.h"
 #include "job.h"
 #include "job_manager.h"
+#include "kdm_source.h"
 #include "kdm_with_metadata.h"
 #include "null_log.h"
 #include "playlist.h"
@@ -56,6 +57,7 @@
 #include "screen.h"
 #include "text_content.h"
 #include "transcode_job.h"
+#include "ui_watchdog.h"
 #include "upload_job.h"
 #include "video_content.h"
 #include "version.h"
@@ -172,6 +174,7 @@ Film::Film (optional<boost::filesystem::path> dir)
 	, _reel_type (ReelType::SINGLE)
 	, _reel_length (2000000000)
 	, _reencode_j2k (false)
+	, _variable_j2k_bandwidth (false)
 	, _user_explicit_video_frame_rate (false)
 	, _user_explicit_container (false)
 	, _user_explicit_resolution (false)
@@ -266,6 +269,10 @@ Film::video_identifier () const
 		s += "_R";
 	}
 
+	if (_variable_j2k_bandwidth) {
+		s += "_VB";
+	}
+
 	return s;
 }
 
@@ -291,6 +298,13 @@ Film::internal_video_asset_filename (DCPTimePeriod p) const
 	return video_identifier() + "_" + raw_convert<string> (p.from.get()) + "_" + raw_convert<string> (p.to.get()) + ".mxf";
 }
 
+/** @return Directory containing the recipe of each frame in our internal video assets; see FrameRecipes */
+boost::filesystem::path
+Film::frame_recipes_dir () const
+{
+	return dir ("recipes");
+}
+
 boost::filesystem::path
 Film::audio_analysis_path (shared_ptr<const Playlist> playlist) const
 {
@@ -333,6 +347,16 @@ Film::audio_analysis_path (shared_ptr<const Playlist> playlist) const
 }
 
 
+/** @return path to a cached analysis of a region of a playlist, as made by AnalyseAudioJob
+ *  @param digest Digest of the region; see AudioAnalyser::split_by_content.
+ */
+boost::filesystem::path
+Film::audio_analysis_region_path (string digest) const
+{
+	return dir("analysis/regions") / digest;
+}
+
+
 boost::filesystem::path
 Film::subtitle_analysis_path (shared_ptr<const Content> content) const
 {
@@ -366,6 +390,23 @@ Film::subtitle_analysis_path (shared_ptr<const Content> content) const
 }
 
 
+/** @return Path to a VideoComplexity for the film's current video, which may not exist yet */
+boost::filesystem::path
+Film::video_complexity_path () const
+{
+	auto p = dir ("analysis");
+
+	Digester digester;
+	digester.add(container()->id());
+	digester.add(_playlist->video_identifier());
+	digester.add(_video_frame_rate);
+	digester.add(static_cast<int>(_three_d));
+
+	p /= "complexity_" + digester.get();
+	return p;
+}
+
+
 /** Start a job to send our DCP to the configured TMS */
 void
 Film::send_dcp_to_tms ()
@@ -413,6 +454,7 @@ Film::metadata (bool with_content_paths) const
 	root->add_child("ReelType")->add_child_text (raw_convert<string> (static_cast<int> (_reel_type)));
 	root->add_child("ReelLength")->add_child_text (raw_convert<string> (_reel_length));
 	root->add_child("ReencodeJ2K")->add_child_text (_reencode_j2k ? "1" : "0");
+	root->add_child("VariableJ2KBandwidth")->add_child_text(_variable_j2k_bandwidth ? "1" : "0");
 	root->add_child("UserExplicitVideoFrameRate")->add_child_text(_user_explicit_video_frame_rate ? "1" : "0");
 	for (auto const& marker: _markers) {
 		auto m = root->add_child("Marker");
@@ -474,14 +516,30 @@ Film::write_metadata (boost::filesystem::path path) const
 void
 Film::write_metadata ()
 {
+	UIWatchdog::Activity activity("Film::write_metadata");
+
 	DCPOMATIC_ASSERT (directory());
 	dcp::filesystem::create_directories(directory().get());
 	auto const filename = file(metadata_file);
+	/* Write to a temporary file and then move it into place, so that if we are interrupted
+	   we don't leave a half-written metadata file in place of the last good one.
+	*/
+	auto tmp = filename;
+	tmp += "." + boost::filesystem::unique_path().string() + ".tmp";
 	try {
-		metadata()->write_to_file_formatted(filename.string());
+		metadata()->write_to_file_formatted(tmp.string());
 	} catch (xmlpp::exception& e) {
+		boost::system::error_code ec;
+		dcp::filesystem::remove(tmp, ec);
 		throw FileError(String::compose("Could not write metadata file (%1)", e.what()), filename);
 	}
+
+	boost::system::error_code ec;
+	dcp::filesystem::rename(tmp, filename, ec);
+	if (ec) {
+		dcp::filesystem::remove(tmp, ec);
+		throw FileError(String::compose("Could not write metadata file (%1)", ec.message()), filename);
+	}
 	set_dirty (false);
 }
 
@@ -599,6 +657,7 @@ Film::read_metadata (optional<boost::filesystem::path> path)
 	_reel_type = static_cast<ReelType> (f.optional_number_child<int>("ReelType").get_value_or (static_cast<int>(ReelType::SINGLE)));
 	_reel_length = f.optional_number_child<int64_t>("ReelLength").get_value_or (2000000000);
 	_reencode_j2k = f.optional_bool_child("ReencodeJ2K").get_value_or(false);
+	_variable_j2k_bandwidth = f.optional_bool_child("VariableJ2KBandwidth").get_value_or(false);
 	_user_explicit_video_frame_rate = f.optional_bool_child("UserExplicitVideoFrameRate").get_value_or(false);
 
 	for (auto i: f.node_children("Marker")) {
@@ -1221,6 +1280,13 @@ Film::set_reencode_j2k (bool r)
 	_reencode_j2k = r;
 }
 
+void
+Film::set_variable_j2k_bandwidth (bool v)
+{
+	FilmChangeSignaller ch(this, FilmProperty::VARIABLE_J2K_BANDWIDTH);
+	_variable_j2k_bandwidth = v;
+}
+
 void
 Film::signal_change (ChangeType type, int p)
 {
@@ -1259,31 +1325,13 @@ Film::set_isdcf_date_today ()
 }
 
 
+/** @return Path of the file that Writer uses to hold JPEG2000 frames that it has
+ *  no room for in memory.
+ */
 boost::filesystem::path
-Film::j2c_path (int reel, Frame frame, Eyes eyes, bool tmp) const
+Film::spill_journal_path() const
 {
-	boost::filesystem::path p;
-	p /= "j2c";
-	p /= video_identifier ();
-
-	char buffer[256];
-	snprintf(buffer, sizeof(buffer), "%08d_%08" PRId64, reel, frame);
-	string s (buffer);
-
-	if (eyes == Eyes::LEFT) {
-		s += ".L";
-	} else if (eyes == Eyes::RIGHT) {
-		s += ".R";
-	}
-
-	s += ".j2c";
-
-	if (tmp) {
-		s += ".tmp";
-	}
-
-	p /= s;
-	return file (p);
+	return file(boost::filesystem::path("j2c") / (video_identifier() + ".spill"));
 }
 
 
@@ -1299,6 +1347,19 @@ Film::cpls () const
 
 	vector<CPLSummary> out;
 
+	boost::mutex::scoped_lock lm(_cpl_summaries_mutex);
+
+	auto write_time = [](boost::filesystem::path path) -> time_t {
+		boost::system::error_code ec;
+		auto const time = dcp::filesystem::last_write_time(path, ec);
+		return ec ? 0 : time;
+	};
+
+	/* Re-use summaries of DCPs that have not changed since we last looked, since reading
+	 * each one means parsing all its XML.
+	 */
+	std::map<boost::filesystem::path, CachedCPLSummary> summaries;
+
 	auto const dir = directory().get();
 	for (auto const& item: dcp::filesystem::directory_iterator(dir)) {
 		if (
@@ -1306,14 +1367,33 @@ Film::cpls () const
 			item.path().filename() != "j2c" && item.path().filename() != "video" && item.path().filename() != "info" && item.path().filename() != "analysis"
 			) {
 
-			try {
-				out.push_back(CPLSummary(item));
-			} catch (...) {
+			auto const directory_write_time = write_time(item.path());
+			auto& summary = summaries[item.path()];
+			auto cached = _cpl_summaries.find(item.path());
+			if (
+				cached != _cpl_summaries.end() &&
+				cached->second.directory_write_time == directory_write_time &&
+				(!cached->second.summary || cached->second.cpl_write_time == write_time(cached->second.summary->cpl_file))
+			   ) {
+				summary = cached->second;
+			} else {
+				summary = { directory_write_time, 0, {} };
+				try {
+					summary.summary = CPLSummary(item.path());
+					summary.cpl_write_time = write_time(summary.summary->cpl_file);
+				} catch (...) {
 
+				}
+			}
+
+			if (summary.summary) {
+				out.push_back(*summary.summary);
 			}
 		}
 	}
 
+	_cpl_summaries = summaries;
+
 	sort(out.begin(), out.end(), [](CPLSummary const& a, CPLSummary const& b) {
 		return a.last_write_time > b.last_write_time;
 	});
@@ -1346,13 +1426,31 @@ Film::examine_and_add_content (shared_ptr<Content> content, bool disable_audio_a
 
 	auto j = make_shared<ExamineContentJob>(shared_from_this(), content);
 
-	_job_connections.push_back (
-		j->Finished.connect (bind (&Film::maybe_add_content, this, weak_ptr<Job>(j), weak_ptr<Content>(content), disable_audio_analysis))
-		);
+	_examining.push_back ({ j, content, disable_audio_analysis });
+	_job_connections.push_back (j->Finished.connect(bind(&Film::examine_finished, this)));
 
 	JobManager::instance()->add (j);
 }
 
+
+/** Called when one of our examine jobs has finished; adds the content of any examinations at the front
+ *  of the queue that are finished, so that content is added in the same order that it was examined.
+ */
+void
+Film::examine_finished ()
+{
+	while (!_examining.empty()) {
+		auto const front = _examining.front();
+		auto job = front.job.lock();
+		if (job && !job->finished()) {
+			break;
+		}
+		_examining.pop_front ();
+		maybe_add_content (front.job, front.content, front.disable_audio_analysis);
+	}
+}
+
+
 void
 Film::maybe_add_content (weak_ptr<Job> j, weak_ptr<Content> c, bool disable_audio_analysis)
 {
@@ -1366,6 +1464,16 @@ Film::maybe_add_content (weak_ptr<Job> j, weak_ptr<Content> c, bool disable_audi
 		return;
 	}
 
+	add_examined_content (content, disable_audio_analysis);
+}
+
+
+/** Add some content which has already been examined, starting an analysis of its audio
+ *  if the configuration says that we should.
+ */
+void
+Film::add_examined_content (shared_ptr<Content> content, bool disable_audio_analysis)
+{
 	add_content (content);
 
 	if (Config::instance()->automatic_audio_analysis() && content->audio && !disable_audio_analysis) {
@@ -1650,50 +1758,7 @@ Film::active_area () const
 dcp::DecryptedKDM
 Film::make_kdm(boost::filesystem::path cpl_file, dcp::LocalTime from, dcp::LocalTime until) const
 {
-	if (!_encrypted) {
-		throw runtime_error (_("Cannot make a KDM as this project is not encrypted."));
-	}
-
-	auto cpl = make_shared<dcp::CPL>(cpl_file);
-
-	/* Find keys that have been added to imported, encrypted DCP content */
-	list<dcp::DecryptedKDMKey> imported_keys;
-	for (auto i: content()) {
-		auto d = dynamic_pointer_cast<DCPContent> (i);
-		if (d && d->kdm()) {
-			dcp::DecryptedKDM kdm (d->kdm().get(), Config::instance()->decryption_chain()->key().get());
-			auto keys = kdm.keys ();
-			copy (keys.begin(), keys.end(), back_inserter (imported_keys));
-		}
-	}
-
-	map<shared_ptr<const dcp::ReelFileAsset>, dcp::Key> keys;
-
-	for (auto asset: cpl->reel_file_assets()) {
-		if (!asset->encrypted()) {
-			continue;
-		}
-
-		/* Get any imported key for this ID */
-		bool done = false;
-		for (auto const& k: imported_keys) {
-			if (k.id() == asset->key_id().get()) {
-				LOG_GENERAL("Using imported key for %1", asset->key_id().get());
-				keys[asset] = k.key();
-				done = true;
-			}
-		}
-
-		if (!done) {
-			/* No imported key; it must be an asset that we encrypted */
-			LOG_GENERAL("Using our own key for %1", asset->key_id().get());
-			keys[asset] = key();
-		}
-	}
-
-	return dcp::DecryptedKDM (
-		cpl->id(), keys, from, until, cpl->content_title_text(), cpl->content_title_text(), dcp::LocalTime().as_string()
-		);
+	return KDMSource(*this, cpl_file).make(from, until);
 }
 
 
@@ -1795,17 +1860,9 @@ Film::reels () const
 	case ReelType::BY_VIDEO_CONTENT:
 	{
 		/* Collect all reel boundaries */
-		list<DCPTime> split_points;
+		auto split_points = _playlist->video_split_points(shared_from_this());
 		split_points.push_back (DCPTime());
 		split_points.push_back (len);
-		for (auto c: content()) {
-			if (c->video) {
-				for (auto t: c->reel_split_points(shared_from_this())) {
-					split_points.push_back (t);
-				}
-				split_points.push_back (c->end(shared_from_this()));
-			}
-		}
 
 		split_points.sort ();
 		split_points.unique ();
@@ -1866,6 +1923,7 @@ Film::use_template (string name)
 	_container = _template_film->_container;
 	_resolution = _template_film->_resolution;
 	_j2k_bandwidth = _template_film->_j2k_bandwidth;
+	_variable_j2k_bandwidth = _template_film->_variable_j2k_bandwidth;
 	_video_frame_rate = _template_film->_video_frame_rate;
 	_encrypted = _template_film->_encrypted;
 	_audio_channels = _template_film->_audio_channels;
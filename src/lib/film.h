@@ -51,6 +51,7 @@
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <inttypes.h>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -113,12 +114,15 @@ public:
 	Film& operator= (Film const&) = delete;
 
 	std::shared_ptr<InfoFileHandle> info_file_handle (dcpomatic::DCPTimePeriod period, bool read) const;
-	boost::filesystem::path j2c_path (int, Frame, Eyes, bool) const;
+	boost::filesystem::path spill_journal_path() const;
 	boost::filesystem::path internal_video_asset_dir () const;
 	boost::filesystem::path internal_video_asset_filename (dcpomatic::DCPTimePeriod p) const;
+	boost::filesystem::path frame_recipes_dir () const;
 
 	boost::filesystem::path audio_analysis_path (std::shared_ptr<const Playlist>) const;
+	boost::filesystem::path audio_analysis_region_path (std::string digest) const;
 	boost::filesystem::path subtitle_analysis_path (std::shared_ptr<const Content>) const;
+	boost::filesystem::path video_complexity_path () const;
 
 	void send_dcp_to_tms ();
 
@@ -295,6 +299,10 @@ public:
 		return _reencode_j2k;
 	}
 
+	bool variable_j2k_bandwidth () const {
+		return _variable_j2k_bandwidth;
+	}
+
 	typedef std::map<dcp::Marker, dcpomatic::DCPTime> Markers;
 
 	boost::optional<dcpomatic::DCPTime> marker (dcp::Marker type) const;
@@ -381,6 +389,7 @@ public:
 	void set_use_isdcf_name (bool);
 	void examine_and_add_content (std::shared_ptr<Content> content, bool disable_audio_analysis = false);
 	void add_content (std::shared_ptr<Content>);
+	void add_examined_content (std::shared_ptr<Content> content, bool disable_audio_analysis = false);
 	void remove_content (std::shared_ptr<Content>);
 	void remove_content (ContentList);
 	void move_content_earlier (std::shared_ptr<Content>);
@@ -401,6 +410,7 @@ public:
 	void set_reel_type (ReelType);
 	void set_reel_length (int64_t);
 	void set_reencode_j2k (bool);
+	void set_variable_j2k_bandwidth (bool);
 	void set_marker (dcp::Marker type, dcpomatic::DCPTime time);
 	void unset_marker (dcp::Marker type);
 	void clear_markers ();
@@ -463,6 +473,7 @@ private:
 	void playlist_content_change (ChangeType type, std::weak_ptr<Content>, int, bool frequent);
 	void playlist_length_change ();
 	void maybe_add_content (std::weak_ptr<Job>, std::weak_ptr<Content>, bool disable_audio_analysis);
+	void examine_finished ();
 	void audio_analysis_finished ();
 	void check_settings_consistency ();
 	void maybe_set_container_and_resolution ();
@@ -515,6 +526,10 @@ private:
 	/** Desired reel length in bytes, if _reel_type == REELTYPE_BY_LENGTH */
 	int64_t _reel_length;
 	bool _reencode_j2k;
+	/** true to vary the J2K bandwidth of each frame according to its complexity,
+	 *  keeping the average at _j2k_bandwidth (see VideoComplexity).
+	 */
+	bool _variable_j2k_bandwidth;
 	/** true if the user has ever explicitly set the video frame rate of this film */
 	bool _user_explicit_video_frame_rate;
 	bool _user_explicit_container;
@@ -553,11 +568,36 @@ private:
 
 	mutable boost::mutex _info_file_mutex;
 
+	/** A CPLSummary that cpls() made earlier, or an empty optional if the directory
+	 *  could not be read as a DCP.
+	 */
+	struct CachedCPLSummary {
+		time_t directory_write_time;
+		time_t cpl_write_time;
+		boost::optional<CPLSummary> summary;
+	};
+
+	mutable boost::mutex _cpl_summaries_mutex;
+	/** Results from the last call to cpls(), keyed by DCP directory */
+	mutable std::map<boost::filesystem::path, CachedCPLSummary> _cpl_summaries;
+
 	boost::signals2::scoped_connection _playlist_change_connection;
 	boost::signals2::scoped_connection _playlist_order_changed_connection;
 	boost::signals2::scoped_connection _playlist_content_change_connection;
 	boost::signals2::scoped_connection _playlist_length_change_connection;
 	std::list<boost::signals2::connection> _job_connections;
+
+	struct Examining
+	{
+		std::weak_ptr<Job> job;
+		std::weak_ptr<Content> content;
+		bool disable_audio_analysis;
+	};
+
+	/** Content which examine_and_add_content() is examining, in the order that it was asked for.
+	 *  Examination jobs can run in parallel, so this is used to add the content in the same order.
+	 */
+	std::list<Examining> _examining;
 	std::list<boost::signals2::connection> _audio_analysis_connections;
 
 	friend struct paths_test;
@@ -52,6 +52,7 @@ enum class FilmProperty {
 	REEL_TYPE,
 	REEL_LENGTH,
 	REENCODE_J2K,
+	VARIABLE_J2K_BANDWIDTH,
 	MARKERS,
 	RATINGS,
 	CONTENT_VERSIONS,
@@ -24,6 +24,7 @@
  */
 
 
+#include "config.h"
 #include "filter_graph.h"
 #include "filter.h"
 #include "exceptions.h"
@@ -34,6 +35,7 @@ extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavformat/avio.h>
 }
+#include <algorithm>
 #include <iostream>
 
 #include "i18n.h"
@@ -66,6 +68,12 @@ FilterGraph::setup (vector<Filter const *> filters)
 		throw DecodeError (N_("could not create filter graph."));
 	}
 
+	/* Let filters which can (such as deinterlacers and denoisers) process slices of
+	   each frame in parallel, so that they don't hold up the rest of the decode.
+	*/
+	_graph->thread_type = AVFILTER_THREAD_SLICE;
+	_graph->nb_threads = std::max(1, Config::instance()->ffmpeg_filter_threads());
+
 	auto const buffer_src = avfilter_get_by_name (src_name().c_str());
 	if (!buffer_src) {
 		throw DecodeError (N_("could not find buffer src filter"));
@@ -59,6 +59,11 @@ public:
 	void setup (std::vector<Filter const *>);
 	AVFilterContext* get (std::string name);
 
+	/** @return true if this graph has no filters in, so it keeps no state from one frame to the next */
+	bool copy () const {
+		return _copy;
+	}
+
 protected:
 	virtual std::string src_parameters () const = 0;
 	virtual std::string src_name () const = 0;
@@ -21,60 +21,245 @@
 
 #include "content.h"
 #include "find_missing.h"
+#include "job.h"
 #include "util.h"
 #include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <list>
+#include <set>
+#include <unordered_map>
 
+#include "i18n.h"
 
-using std::map;
+
+using std::list;
+using std::pair;
+using std::set;
 using std::shared_ptr;
+using std::string;
+using std::unordered_map;
 using std::vector;
 
 
-typedef map<shared_ptr<Content>, vector<boost::filesystem::path>> Replacements;
+namespace {
 
 
-static
-void
-search (Replacements& replacement_paths, boost::filesystem::path directory, int depth = 0)
+/** A file that we found while looking for missing ones */
+struct Found
 {
-	boost::system::error_code ec;
-	for (auto candidate: dcp::filesystem::directory_iterator(directory, ec)) {
-		if (dcp::filesystem::is_regular_file(candidate.path())) {
-			for (auto& replacement: replacement_paths) {
-				for (auto& path: replacement.second) {
-					if (!dcp::filesystem::exists(path) && path.filename() == candidate.path().filename()) {
-						path = candidate.path();
+	boost::filesystem::path path;
+	std::time_t last_write_time;
+};
+
+
+/** Walks a directory tree on several threads, noting the paths of any files
+ *  which have one of a set of names.
+ */
+class Walker
+{
+public:
+	Walker (set<string> const& names, int max_depth)
+		: _names(names)
+		, _max_depth(max_depth)
+	{}
+
+	Walker (Walker const&) = delete;
+	Walker& operator= (Walker const&) = delete;
+
+	unordered_map<string, vector<Found>> walk (boost::filesystem::path root)
+	{
+		_queue.push_back({root, 0});
+
+		int constexpr threads = 8;
+		boost::thread_group group;
+		for (int i = 0; i < threads; ++i) {
+			group.create_thread([this]() { thread(); });
+		}
+
+		try {
+			boost::mutex::scoped_lock lm (_mutex);
+			while (!_queue.empty() || _busy > 0) {
+				/* Wake up now and again so that our Job can be cancelled */
+				_done.timed_wait (lm, boost::posix_time::milliseconds(100));
+				lm.unlock ();
+				boost::this_thread::interruption_point ();
+				lm.lock ();
+			}
+			_stop = true;
+			_work.notify_all ();
+		} catch (boost::thread_interrupted&) {
+			stop (group);
+			throw;
+		}
+
+		group.join_all ();
+		return _found;
+	}
+
+private:
+	void stop (boost::thread_group& group)
+	{
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			_stop = true;
+		}
+		_work.notify_all ();
+		group.join_all ();
+	}
+
+	void thread ()
+	{
+		while (true) {
+			pair<boost::filesystem::path, int> next;
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				while (_queue.empty() && !_stop) {
+					_work.wait (lm);
+				}
+				if (_stop) {
+					return;
+				}
+				next = _queue.front();
+				_queue.pop_front();
+				++_busy;
+			}
+
+			vector<pair<boost::filesystem::path, int>> directories;
+			vector<pair<string, Found>> found;
+
+			/* Just ignore errors when creating the directory_iterator; they can be triggered by things like
+			 * macOS' love of creating random directories (see #2291).
+			 */
+			boost::system::error_code ec;
+			for (auto candidate: dcp::filesystem::directory_iterator(next.first, ec)) {
+				try {
+					auto const path = candidate.path();
+					if (dcp::filesystem::is_regular_file(path)) {
+						auto const name = path.filename().string();
+						if (_names.find(name) != _names.end()) {
+							boost::system::error_code time_ec;
+							found.push_back({name, {path, dcp::filesystem::last_write_time(path, time_ec)}});
+						}
+					} else if (dcp::filesystem::is_directory(path) && next.second < _max_depth) {
+						directories.push_back({path, next.second + 1});
 					}
+				} catch (boost::filesystem::filesystem_error&) {
+					/* Never mind */
 				}
 			}
-		} else if (dcp::filesystem::is_directory(candidate.path()) && depth <= 2) {
-			search (replacement_paths, candidate, depth + 1);
+
+			boost::mutex::scoped_lock lm (_mutex);
+			for (auto const& i: found) {
+				_found[i.first].push_back(i.second);
+			}
+			for (auto const& i: directories) {
+				_queue.push_back(i);
+			}
+			--_busy;
+			_work.notify_all ();
+			_done.notify_all ();
 		}
 	}
 
-	/* Just ignore errors when creating the directory_iterator; they can be triggered by things like
-	 * macOS' love of creating random directories (see #2291).
-	 */
+	set<string> const& _names;
+	int const _max_depth;
+
+	boost::mutex _mutex;
+	boost::condition _work;
+	boost::condition _done;
+	/** Directories still to look in, with their depths below the root */
+	list<pair<boost::filesystem::path, int>> _queue;
+	/** Number of threads that are looking in a directory */
+	int _busy = 0;
+	bool _stop = false;
+	unordered_map<string, vector<Found>> _found;
+};
+
+
+/** @return true if a set of paths is a plausible replacement for some content's paths, without reading the files */
+bool
+could_be (shared_ptr<const Content> content, vector<boost::filesystem::path> const& paths)
+{
+	boost::system::error_code ec;
+	for (auto const& path: paths) {
+		if (!dcp::filesystem::exists(path, ec)) {
+			return false;
+		}
+	}
+
+	/* simple_digest() ends with the size of the first file, which is much quicker to check than the rest */
+	auto const size = dcp::filesystem::file_size(paths.front(), ec);
+	return !ec && boost::algorithm::ends_with(content->digest(), dcp::raw_convert<string>(size));
+}
+
+
 }
 
 
 void
-dcpomatic::find_missing (vector<shared_ptr<Content>> content_to_fix, boost::filesystem::path clue)
+dcpomatic::find_missing (vector<shared_ptr<Content>> content_to_fix, boost::filesystem::path clue, shared_ptr<Job> job, int max_depth)
 {
 	using namespace boost::filesystem;
 
-	Replacements replacement_paths;
+	/* Names of all the files that we are looking for */
+	set<string> names;
 	for (auto content: content_to_fix) {
-		replacement_paths[content] = content->paths();
+		for (auto const& path: content->paths()) {
+			if (!dcp::filesystem::exists(path)) {
+				names.insert(path.filename().string());
+			}
+		}
 	}
 
-	search (replacement_paths, is_directory(clue) ? clue : clue.parent_path());
+	if (names.empty()) {
+		return;
+	}
+
+	if (job) {
+		job->sub (_("Searching for missing files"));
+		job->set_progress_unknown ();
+	}
+
+	Walker walker(names, max_depth);
+	auto const found = walker.walk(is_directory(clue) ? clue : clue.parent_path());
 
 	for (auto content: content_to_fix) {
-		auto const& repl = replacement_paths[content];
-		bool const replacements_exist = std::find_if(repl.begin(), repl.end(), [](path p) { return !exists(p); }) == repl.end();
-		if (replacements_exist && simple_digest(replacement_paths[content]) == content->digest()) {
-			content->set_paths (repl);
+		auto const paths = content->paths();
+
+		auto missing = std::find_if(paths.begin(), paths.end(), [](path p) { return !dcp::filesystem::exists(p); });
+		if (missing == paths.end()) {
+			continue;
+		}
+
+		auto candidates = found.find(missing->filename().string());
+		if (candidates == found.end()) {
+			continue;
+		}
+
+		/* Try candidates whose modification time is the same as the missing file's first, as
+		   they are most likely to be right.  Other missing files are looked for alongside
+		   each candidate, since (for example) the files of an image sequence will have moved
+		   together.
+		*/
+		auto const expected_time = content->last_write_time(std::distance(paths.begin(), missing));
+		auto ordered = candidates->second;
+		std::stable_sort(ordered.begin(), ordered.end(), [expected_time](Found const& a, Found const& b) {
+			return a.last_write_time == expected_time && b.last_write_time != expected_time;
+		});
+
+		for (auto const& candidate: ordered) {
+			vector<path> replacement;
+			for (auto const& path: paths) {
+				replacement.push_back(dcp::filesystem::exists(path) ? path : candidate.path.parent_path() / path.filename());
+			}
+
+			if (could_be(content, replacement) && simple_digest(replacement) == content->digest()) {
+				content->set_paths (replacement);
+				break;
+			}
 		}
 	}
 }
@@ -25,6 +25,7 @@
 
 
 class Content;
+class Job;
 
 
 namespace dcpomatic {
@@ -35,8 +36,15 @@ namespace dcpomatic {
  *
  *  @param content Content, some of which may have missing files.
  *  @param clue Path to a file which gives a clue about where the missing files might be.
+ *  @param job Job to report progress to, or empty; if this is given the search can be cancelled.
+ *  @param max_depth Number of levels of directory below the clue to look in.
  */
-void find_missing (std::vector<std::shared_ptr<Content>> content, boost::filesystem::path clue);
+void find_missing (
+	std::vector<std::shared_ptr<Content>> content,
+	boost::filesystem::path clue,
+	std::shared_ptr<Job> job = {},
+	int max_depth = 3
+	);
 
 
 }
@@ -54,8 +54,12 @@ FontConfig::~FontConfig()
 }
 
 
+/** Add a font to our config, if it is not already there, without rebuilding the config.
+ *  _mutex must be held.
+ *  @return Family name of the font.
+ */
 string
-FontConfig::make_font_available(shared_ptr<dcpomatic::Font> font)
+FontConfig::add_font(shared_ptr<dcpomatic::Font> font)
 {
 	DCPOMATIC_ASSERT(font);
 
@@ -78,36 +82,23 @@ FontConfig::make_font_available(shared_ptr<dcpomatic::Font> font)
 		font->data()->write(font_file);
 	}
 
-
 	/* Make this font available to DCP-o-matic */
+	auto const font_file_string = font_file.string();
+	auto const font_file_name = reinterpret_cast<FcChar8 const *>(font_file_string.c_str());
+	FcConfigAppFontAddFile(_config, font_file_name);
+
+	/* Read the family name straight from the file (using FreeType) rather than searching the config for it */
 	optional<string> font_name;
-	FcConfigAppFontAddFile (_config, reinterpret_cast<FcChar8 const *>(font_file.string().c_str()));
-	auto pattern = FcPatternBuild (
-		0, FC_FILE, FcTypeString, font_file.string().c_str(), static_cast<char *>(0)
-		);
-	auto object_set = FcObjectSetBuild (FC_FAMILY, FC_STYLE, FC_LANG, FC_FILE, static_cast<char *> (0));
-	auto font_set = FcFontList (_config, pattern, object_set);
-	if (font_set) {
-		for (int i = 0; i < font_set->nfont; ++i) {
-			FcPattern* font = font_set->fonts[i];
-			FcChar8* file;
-			FcChar8* family;
-			FcChar8* style;
-			if (
-				FcPatternGetString (font, FC_FILE, 0, &file) == FcResultMatch &&
-				FcPatternGetString (font, FC_FAMILY, 0, &family) == FcResultMatch &&
-				FcPatternGetString (font, FC_STYLE, 0, &style) == FcResultMatch
-				) {
-				font_name = reinterpret_cast<char const *> (family);
-			}
+	int count = 0;
+	auto pattern = FcFreeTypeQuery(font_file_name, 0, nullptr, &count);
+	if (pattern) {
+		FcChar8* family;
+		if (FcPatternGetString(pattern, FC_FAMILY, 0, &family) == FcResultMatch) {
+			font_name = reinterpret_cast<char const *>(family);
 		}
-
-		FcFontSetDestroy (font_set);
+		FcPatternDestroy(pattern);
 	}
 
-	FcObjectSetDestroy (object_set);
-	FcPatternDestroy (pattern);
-
 	DCPOMATIC_ASSERT(font_name);
 
 	/* We need to use the font object as the key, as we may be passed the same shared_ptr to a modified
@@ -115,14 +106,47 @@ FontConfig::make_font_available(shared_ptr<dcpomatic::Font> font)
 	 */
 	_available_fonts[font->content()] = *font_name;
 
-	FcConfigBuildFonts(_config);
 	return *font_name;
 }
 
 
+string
+FontConfig::make_font_available(shared_ptr<dcpomatic::Font> font)
+{
+	boost::mutex::scoped_lock lm(_mutex);
+
+	auto const size = _available_fonts.size();
+	auto const font_name = add_font(font);
+	if (_available_fonts.size() != size) {
+		FcConfigBuildFonts(_config);
+	}
+	return font_name;
+}
+
+
+/** Make a set of fonts available, rebuilding the config only once at the end; this is much
+ *  quicker than calling make_font_available() for each one.
+ */
+void
+FontConfig::make_fonts_available(std::vector<shared_ptr<dcpomatic::Font>> const& fonts)
+{
+	boost::mutex::scoped_lock lm(_mutex);
+
+	auto const size = _available_fonts.size();
+	for (auto font: fonts) {
+		add_font(font);
+	}
+	if (_available_fonts.size() != size) {
+		FcConfigBuildFonts(_config);
+	}
+}
+
+
 optional<boost::filesystem::path>
 FontConfig::system_font_with_name(string name)
 {
+	boost::mutex::scoped_lock lm(_mutex);
+
 	optional<boost::filesystem::path> path;
 
 	LOG_GENERAL("Searching system for font %1", name);
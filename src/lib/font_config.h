@@ -22,8 +22,10 @@
 #include "font_comparator.h"
 #include <fontconfig/fontconfig.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
 #include <map>
 #include <string>
+#include <vector>
 
 
 /** Wrapper for the fontconfig library */
@@ -33,6 +35,7 @@ public:
 	static FontConfig* instance();
 
 	std::string make_font_available(std::shared_ptr<dcpomatic::Font> font);
+	void make_fonts_available(std::vector<std::shared_ptr<dcpomatic::Font>> const& fonts);
 	boost::optional<boost::filesystem::path> system_font_with_name(std::string name);
 
 	static void drop();
@@ -41,6 +44,10 @@ private:
 	FontConfig();
 	~FontConfig();
 
+	std::string add_font(std::shared_ptr<dcpomatic::Font> font);
+
+	/** Mutex to protect everything, as fonts may be made available from any thread */
+	boost::mutex _mutex;
 	FcConfig* _config = nullptr;
 	std::map<dcpomatic::Font::Content, std::string, FontComparator> _available_fonts;
 
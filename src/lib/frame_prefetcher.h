@@ -0,0 +1,182 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DCPOMATIC_FRAME_PREFETCHER_H
+#define DCPOMATIC_FRAME_PREFETCHER_H
+
+
+#include "util.h"
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory>
+
+
+/** @class FramePrefetcher
+ *  @brief Reads frames from an asset reader (such as a dcp::MonoPictureAssetReader) in a background
+ *  thread, ahead of the frames that are being asked for.
+ *
+ *  This means that a decoder reading frames in order need not wait for slow storage.  get() may be
+ *  called with any frame index; if it is not the one after the last, the read-ahead starts again
+ *  from there.  Frames that could not be read in the background are read (and any error thrown)
+ *  by get().
+ */
+template <class Reader, class Frame>
+class FramePrefetcher
+{
+public:
+	/** @param reader Reader to use; it must not be used by anything else after this call.
+	 *  @param length Number of frames in the asset.
+	 *  @param count Number of frames to read ahead; if this is 0 no thread is started
+	 *  and get() just reads from the reader.
+	 */
+	FramePrefetcher (std::shared_ptr<Reader> reader, int64_t length, int count)
+		: _reader (reader)
+		, _length (length)
+		, _count (count)
+	{
+		if (_count > 0) {
+			_thread = boost::thread(boost::bind(&FramePrefetcher::thread, this));
+#ifdef DCPOMATIC_LINUX
+			pthread_setname_np (_thread.native_handle(), "frame-prefetch");
+#endif
+		}
+	}
+
+	~FramePrefetcher ()
+	{
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			_stop = true;
+			_condition.notify_all ();
+		}
+
+		if (_thread.joinable()) {
+			_thread.join ();
+		}
+	}
+
+	FramePrefetcher (FramePrefetcher const&) = delete;
+	FramePrefetcher& operator= (FramePrefetcher const&) = delete;
+
+	std::shared_ptr<const Frame> get (int64_t index)
+	{
+		if (_count > 0) {
+			boost::mutex::scoped_lock lm (_mutex);
+
+			if (index < _want || index >= _next_read) {
+				/* We haven't read this one, and aren't about to; start again from here */
+				_cache.clear ();
+				_next_read = index + 1;
+				_want = index + 1;
+				_condition.notify_all ();
+			} else {
+				_want = index + 1;
+				_condition.notify_all ();
+
+				/* Wait for it if it's being read now */
+				while (_in_flight && *_in_flight == index) {
+					_condition.wait (lm);
+				}
+
+				auto i = _cache.find (index);
+				if (i != _cache.end()) {
+					auto frame = i->second;
+					_cache.erase (_cache.begin(), std::next(i));
+					return frame;
+				}
+
+				/* It couldn't be read in the background; we'll try again below */
+				_cache.erase (_cache.begin(), _cache.upper_bound(index));
+			}
+		}
+
+		boost::mutex::scoped_lock lm (_reader_mutex);
+		return _reader->get_frame (index);
+	}
+
+private:
+	void thread ()
+	{
+		start_of_thread ("FramePrefetcher");
+
+		while (true) {
+			int64_t index;
+
+			{
+				boost::mutex::scoped_lock lm (_mutex);
+				while (!_stop && _next_read >= std::min(_want + _count, _length)) {
+					_condition.wait (lm);
+				}
+
+				if (_stop) {
+					return;
+				}
+
+				index = _next_read++;
+				_in_flight = index;
+			}
+
+			std::shared_ptr<const Frame> frame;
+			try {
+				boost::mutex::scoped_lock lm (_reader_mutex);
+				frame = _reader->get_frame (index);
+			} catch (...) {
+				/* get() will try again, and report any error */
+			}
+
+			boost::mutex::scoped_lock lm (_mutex);
+			_in_flight = boost::none;
+			if (frame && index >= _want && index < _next_read) {
+				_cache[index] = frame;
+			}
+			_condition.notify_all ();
+		}
+	}
+
+	std::shared_ptr<Reader> _reader;
+	/** Mutex to protect _reader */
+	boost::mutex _reader_mutex;
+	int64_t const _length;
+	int const _count;
+
+	/** Mutex to protect the following */
+	boost::mutex _mutex;
+	boost::condition _condition;
+	/** Frames that have been read, keyed by index */
+	std::map<int64_t, std::shared_ptr<const Frame>> _cache;
+	/** Index of the frame that we expect get() to be asked for next */
+	int64_t _want = 0;
+	/** Index of the next frame that the background thread will read */
+	int64_t _next_read = 0;
+	/** Index of the frame that the background thread is reading, if any */
+	boost::optional<int64_t> _in_flight;
+	bool _stop = false;
+
+	boost::thread _thread;
+};
+
+
+#endif
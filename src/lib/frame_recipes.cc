@@ -0,0 +1,348 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "config.h"
+#include "dcpomatic_assert.h"
+#include "dcpomatic_log.h"
+#include "digester.h"
+#include "exceptions.h"
+#include "film.h"
+#include "frame_recipes.h"
+#include "player_video.h"
+#include <dcp/array_data.h>
+#include <dcp/asset_factory.h>
+#include <dcp/filesystem.h>
+#include <dcp/mono_picture_asset.h>
+#include <dcp/mono_picture_asset_reader.h>
+#include <dcp/stereo_picture_asset.h>
+#include <dcp/stereo_picture_asset_reader.h>
+#include <set>
+
+
+using std::dynamic_pointer_cast;
+using std::make_shared;
+using std::set;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::optional;
+using namespace dcpomatic;
+
+
+/** Size of each recipe in a recipe file; recipes are hex MD5 digests */
+static int constexpr recipe_size = 32;
+
+
+/** @return Offset of a frame's recipe in a recipe file.  There are two slots for each frame:
+ *  the first for Eyes::BOTH or Eyes::LEFT and the second for Eyes::RIGHT, so that a file can
+ *  be read without knowing whether it belongs to a 3D asset.
+ */
+static long
+recipe_position (Frame frame, Eyes eyes)
+{
+	return (frame * 2 + (eyes == Eyes::RIGHT ? 1 : 0)) * recipe_size;
+}
+
+
+/** @return Name of the recipe file for the internal video asset of a reel; it is the asset's
+ *  name without the extension.
+ */
+static boost::filesystem::path
+recipe_file (shared_ptr<const Film> film, DCPTimePeriod reel)
+{
+	auto name = film->internal_video_asset_filename(reel).string();
+	DCPOMATIC_ASSERT (name.size() > 4);
+	return film->frame_recipes_dir() / name.substr(0, name.size() - 4);
+}
+
+
+FrameRecipes::FrameRecipes (shared_ptr<const Film> film)
+	: _film (film)
+	, _video_frame_rate (film->video_frame_rate())
+	, _resolution (film->resolution())
+	, _j2k_comment (Config::instance()->dcp_j2k_comment())
+{
+	/* Frames from an encrypted film should not be left unencrypted on shared storage */
+	if (!film->encrypted()) {
+		_shared = Config::instance()->shared_frame_cache();
+	}
+
+	for (auto const& reel: film->reels()) {
+		_reels.push_back(reel);
+	}
+	_files.resize(_reels.size());
+
+	/* The recipe files of the reels that we are about to write may be overwritten, so they
+	 * cannot tell us about frames to re-use.
+	 */
+	set<boost::filesystem::path> current;
+	for (auto const& reel: _reels) {
+		current.insert(recipe_file(film, reel));
+	}
+
+	auto const dir = film->frame_recipes_dir();
+	for (auto i = dcp::filesystem::directory_iterator(dir); i != dcp::filesystem::directory_iterator(); ++i) {
+		auto const path = i->path();
+		if (current.find(path) != current.end()) {
+			continue;
+		}
+		auto const asset = film->internal_video_asset_dir() / (path.filename().string() + ".mxf");
+		if (!dcp::filesystem::exists(asset)) {
+			continue;
+		}
+		try {
+			read_previous(path, asset);
+		} catch (std::exception& e) {
+			/* Most likely the asset was never finished */
+			LOG_GENERAL("Could not use frames from earlier video asset %1 (%2)", asset.string(), e.what());
+		}
+	}
+
+	LOG_GENERAL("Found %1 frames in earlier video assets which could be re-used", _sources.size());
+}
+
+
+FrameRecipes::~FrameRecipes ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_files.clear();
+}
+
+
+void
+FrameRecipes::read_previous (boost::filesystem::path recipes, boost::filesystem::path asset)
+{
+	auto picture = dynamic_pointer_cast<dcp::PictureAsset>(dcp::asset_factory(asset, false));
+	if (!picture || picture->encrypted()) {
+		/* We can't use encrypted assets since we don't know what key was used */
+		return;
+	}
+
+	Asset entry;
+	entry.path = asset;
+	if (auto mono = dynamic_pointer_cast<dcp::MonoPictureAsset>(picture)) {
+		entry.mono = mono->start_read();
+		entry.mono->set_check_hmac(false);
+	} else if (auto stereo = dynamic_pointer_cast<dcp::StereoPictureAsset>(picture)) {
+		entry.stereo = stereo->start_read();
+		entry.stereo->set_check_hmac(false);
+	} else {
+		return;
+	}
+
+	dcp::ArrayData data(recipes);
+	vector<Eyes> const eyes = entry.stereo ? vector<Eyes>{Eyes::LEFT, Eyes::RIGHT} : vector<Eyes>{Eyes::BOTH};
+	string const empty(recipe_size, '\0');
+
+	auto const index = _assets.size();
+	_assets.push_back(entry);
+
+	for (Frame frame = 0; frame < picture->intrinsic_duration(); ++frame) {
+		for (auto e: eyes) {
+			auto const position = recipe_position(frame, e);
+			if (position + recipe_size > data.size()) {
+				return;
+			}
+			string recipe(reinterpret_cast<char const*>(data.data()) + position, recipe_size);
+			if (recipe != empty) {
+				_sources.insert({recipe, {index, frame, e}});
+			}
+		}
+	}
+}
+
+
+/** @param j2k_bandwidth J2K bandwidth that the frame will be encoded with.
+ *  @return Recipe for a frame that we are about to encode, or an empty optional if it does not really have one.
+ */
+optional<string>
+FrameRecipes::recipe (shared_ptr<const PlayerVideo> video, int j2k_bandwidth) const
+{
+	auto const frame = video->recipe();
+	if (!frame) {
+		return {};
+	}
+
+	/* Add the things that change how a frame's image is made into J2K */
+	Digester digester;
+	digester.add(*frame);
+	digester.add(_video_frame_rate);
+	digester.add(j2k_bandwidth);
+	digester.add(static_cast<int>(_resolution));
+	digester.add(_j2k_comment);
+	return digester.get();
+}
+
+
+/** Note a frame that we are writing to the film's video asset in this encode.
+ *  @param position Frame index within the DCP.
+ */
+void
+FrameRecipes::add (Frame position, Eyes eyes, string const& recipe)
+{
+	DCPOMATIC_ASSERT (recipe.size() == recipe_size);
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (_write_failed) {
+		return;
+	}
+
+	auto const time = DCPTime::from_frames(position, _video_frame_rate);
+	for (size_t i = 0; i < _reels.size(); ++i) {
+		if (!_reels[i].contains(time)) {
+			continue;
+		}
+
+		try {
+			if (!_files[i]) {
+				auto const path = recipe_file(_film, _reels[i]);
+				auto const exists = dcp::filesystem::exists(path);
+				auto file = make_shared<dcp::File>(path, exists ? "r+b" : "wb");
+				if (!*file) {
+					throw OpenFileError(path, errno, exists ? OpenFileError::READ_WRITE : OpenFileError::WRITE);
+				}
+				_files[i] = file;
+			}
+
+			_files[i]->seek(recipe_position(position - _reels[i].from.frames_round(_video_frame_rate), eyes), SEEK_SET);
+			_files[i]->checked_write(recipe.c_str(), recipe.size());
+		} catch (std::exception& e) {
+			/* This only means that the frames can't be re-used next time */
+			LOG_WARNING("Could not write frame recipe (%1)", e.what());
+			_write_failed = true;
+		}
+		return;
+	}
+}
+
+
+/** @return J2K data for a frame with the given recipe from an earlier encode of this film,
+ *  or from the shared frame cache, or nullptr.
+ */
+shared_ptr<const dcp::Data>
+FrameRecipes::find (string const& recipe)
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+
+		auto i = _sources.find(recipe);
+		if (i != _sources.end()) {
+			auto const& asset = _assets[i->second.asset];
+
+			try {
+				if (asset.mono) {
+					return asset.mono->get_frame(i->second.frame);
+				}
+
+				auto frame = asset.stereo->get_frame(i->second.frame);
+				if (i->second.eyes == Eyes::LEFT) {
+					return frame->left();
+				}
+				return frame->right();
+			} catch (std::exception& e) {
+				LOG_GENERAL("Could not read frame %1 of earlier video asset %2 (%3)", i->second.frame, asset.path.string(), e.what());
+				_sources.erase(i);
+			}
+		}
+	}
+
+	if (!_shared) {
+		return {};
+	}
+
+	auto const path = shared_path(recipe);
+	boost::system::error_code ec;
+	if (!dcp::filesystem::exists(path, ec)) {
+		return {};
+	}
+
+	try {
+		return make_shared<dcp::ArrayData>(path);
+	} catch (std::exception& e) {
+		LOG_GENERAL("Could not read frame %1 from shared frame cache (%2)", path.string(), e.what());
+	}
+
+	return {};
+}
+
+
+/** Note that a frame with a recipe is going to be encoded, so that the result can be put in
+ *  the shared frame cache when encoded() is called.
+ */
+void
+FrameRecipes::will_encode (Frame position, Eyes eyes, string const& recipe)
+{
+	if (!_shared) {
+		return;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	_to_share[{position, eyes}] = recipe;
+}
+
+
+/** Called when a frame has been encoded, to add it to the shared frame cache if appropriate */
+void
+FrameRecipes::encoded (Frame position, Eyes eyes, shared_ptr<const dcp::Data> data)
+{
+	string recipe;
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		auto i = _to_share.find({position, eyes});
+		if (i == _to_share.end()) {
+			return;
+		}
+		recipe = i->second;
+		_to_share.erase(i);
+	}
+
+	/* Write to a temporary file and rename it so that others never see half a frame */
+	auto const path = shared_path(recipe);
+	auto const temp = path.string() + "." + boost::filesystem::unique_path().string() + ".tmp";
+	try {
+		boost::system::error_code ec;
+		if (dcp::filesystem::exists(path, ec)) {
+			return;
+		}
+		dcp::filesystem::create_directories(path.parent_path(), ec);
+		data->write(temp);
+		dcp::filesystem::rename(temp, path, ec);
+		if (ec) {
+			dcp::filesystem::remove(temp, ec);
+		}
+	} catch (std::exception& e) {
+		LOG_WARNING("Could not add frame to shared frame cache (%1)", e.what());
+		boost::system::error_code ec;
+		dcp::filesystem::remove(temp, ec);
+	}
+}
+
+
+boost::filesystem::path
+FrameRecipes::shared_path (string const& recipe) const
+{
+	DCPOMATIC_ASSERT (_shared);
+	return *_shared / recipe.substr(0, 2) / (recipe + ".j2c");
+}
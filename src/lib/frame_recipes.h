@@ -0,0 +1,118 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_FRAME_RECIPES_H
+#define DCPOMATIC_FRAME_RECIPES_H
+
+
+#include "dcpomatic_time.h"
+#include "resolution.h"
+#include "types.h"
+#include <dcp/data.h>
+#include <dcp/file.h>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace dcp {
+	class MonoPictureAssetReader;
+	class StereoPictureAssetReader;
+}
+
+class Film;
+class PlayerVideo;
+
+
+/** @class FrameRecipes
+ *  @brief Record of the recipe of each frame written to a film's internal video assets.
+ *
+ *  A recipe is a digest of everything that goes into making a frame's J2K (see recipe()).
+ *  Recipes are kept in a file for each reel, alongside the reel's video asset, so that when
+ *  the film is encoded again after some changes any frame with a recipe that we have seen before
+ *  can be copied from the earlier asset instead of being encoded again.
+ *
+ *  If Config::shared_frame_cache() is set, encoded frames are also kept there, one file per recipe,
+ *  so that other films (and other machines using the same storage) can re-use them.
+ */
+class FrameRecipes
+{
+public:
+	explicit FrameRecipes (std::shared_ptr<const Film> film);
+	~FrameRecipes ();
+
+	FrameRecipes (FrameRecipes const&) = delete;
+	FrameRecipes& operator= (FrameRecipes const&) = delete;
+
+	boost::optional<std::string> recipe (std::shared_ptr<const PlayerVideo> video, int j2k_bandwidth) const;
+	void add (Frame position, Eyes eyes, std::string const& recipe);
+	std::shared_ptr<const dcp::Data> find (std::string const& recipe);
+	void will_encode (Frame position, Eyes eyes, std::string const& recipe);
+	void encoded (Frame position, Eyes eyes, std::shared_ptr<const dcp::Data> data);
+
+private:
+	void read_previous (boost::filesystem::path recipes, boost::filesystem::path asset);
+	boost::filesystem::path shared_path (std::string const& recipe) const;
+
+	std::shared_ptr<const Film> _film;
+	int _video_frame_rate;
+	Resolution _resolution;
+	std::string _j2k_comment;
+	std::vector<dcpomatic::DCPTimePeriod> _reels;
+
+	boost::mutex _mutex;
+
+	/** Files that we are writing this encode's recipes to, one per reel (or nullptr if they are not open yet) */
+	std::vector<std::shared_ptr<dcp::File>> _files;
+	/** true if we failed to write a recipe, so we should not try again */
+	bool _write_failed = false;
+
+	/** A video asset from an earlier encode of the film */
+	struct Asset {
+		boost::filesystem::path path;
+		std::shared_ptr<dcp::MonoPictureAssetReader> mono;
+		std::shared_ptr<dcp::StereoPictureAssetReader> stereo;
+	};
+
+	/** Where we can find a frame with a particular recipe */
+	struct Source {
+		size_t asset;
+		Frame frame;
+		Eyes eyes;
+	};
+
+	std::vector<Asset> _assets;
+	std::unordered_map<std::string, Source> _sources;
+
+	/** Directory of frames shared with other films and machines, keyed by recipe */
+	boost::optional<boost::filesystem::path> _shared;
+	/** Recipes of frames being encoded which should be added to _shared when they are done */
+	std::map<std::pair<Frame, Eyes>, std::string> _to_share;
+};
+
+
+#endif
@@ -24,108 +24,124 @@
 #include "image_proxy.h"
 #include "guess_crop.h"
 #include "image.h"
+#include "task_scheduler.h"
+#include "video_content.h"
 #include "video_decoder.h"
+#include <algorithm>
 
 
+using std::max;
 using std::shared_ptr;
+using std::vector;
+using boost::optional;
 using namespace dcpomatic;
 
 
-Crop
-guess_crop (shared_ptr<const Image> image, double threshold)
+/** Find the brightest pixel in each row and column of an image.  This is done in a single pass
+ *  over the image, a row at a time, so that memory is read in order and the inner loop can be
+ *  vectorised.
+ *  @param components Number of samples to add up to get the brightness of each pixel.
+ */
+template <class Sample, int components>
+static
+void
+line_maxima (Image const& image, vector<int>& rows, vector<int>& columns)
 {
-	auto const width = image->size().width;
-	auto const height = image->size().height;
-
-	auto image_in_line = [image, threshold](int start_x, int start_y, int pixels, bool rows) {
-		double brightest = 0;
-
-		switch (image->pixel_format()) {
-		case AV_PIX_FMT_RGB24:
-		{
-			uint8_t const* data = image->data()[0] + start_x * 3 + start_y * image->stride()[0];
-			for (int p = 0; p < pixels; ++p) {
-				/* Averaging R, G and B */
-				brightest = std::max(brightest, static_cast<double>(data[0] + data[1] + data[2]) / (3 * 256));
-				data += rows ? 3 : image->stride()[0];
-			}
-			break;
-		}
-		case AV_PIX_FMT_YUV420P:
-		{
-			uint8_t const* data = image->data()[0] + start_x + start_y * image->stride()[0];
-			for (int p = 0; p < pixels; ++p) {
-				/* Just using Y */
-				brightest = std::max(brightest, static_cast<double>(*data) / 256);
-				data += rows ? 1 : image->stride()[0];
+	auto const width = image.size().width;
+	auto const height = image.size().height;
+
+	rows.assign(height, 0);
+	columns.assign(width, 0);
+
+	for (int y = 0; y < height; ++y) {
+		auto const line = reinterpret_cast<Sample const*>(image.data()[0] + y * image.stride()[0]);
+		int row = 0;
+		for (int x = 0; x < width; ++x) {
+			int value = 0;
+			for (int c = 0; c < components; ++c) {
+				value += line[x * components + c];
 			}
-			break;
-		}
-		case AV_PIX_FMT_YUV422P10LE:
-		{
-			uint16_t const* data = reinterpret_cast<uint16_t*>(image->data()[0] + (start_x * 2) + (start_y * image->stride()[0]));
-			for (int p = 0; p < pixels; ++p) {
-				/* Just using Y */
-				brightest = std::max(brightest, static_cast<double>(*data) / 1024);
-				data += rows ? 1 : (image->stride()[0] / 2);
-			}
-			break;
-		}
-		default:
-			throw PixelFormatError("guess_crop()", image->pixel_format());
+			row = max(row, value);
+			columns[x] = max(columns[x], value);
 		}
+		rows[y] = row;
+	}
+}
 
-		return brightest > threshold;
-	};
-
-	auto crop = Crop{};
 
-	for (auto y = 0; y < height; ++y) {
-		if (image_in_line(0, y, width, true)) {
-			crop.top = y;
-			break;
-		}
+/** @return Crop for an image, or none if no part of the image is brighter than the threshold */
+static
+optional<Crop>
+guess_crop_if_bright (shared_ptr<const Image> image, double threshold)
+{
+	vector<int> rows;
+	vector<int> columns;
+	/* Brightness of a pixel, as returned by line_maxima, which corresponds to 1 */
+	double scale = 0;
+
+	switch (image->pixel_format()) {
+	case AV_PIX_FMT_RGB24:
+		/* Averaging R, G and B */
+		line_maxima<uint8_t, 3>(*image, rows, columns);
+		scale = 3 * 256;
+		break;
+	case AV_PIX_FMT_YUV420P:
+		/* Just using Y */
+		line_maxima<uint8_t, 1>(*image, rows, columns);
+		scale = 256;
+		break;
+	case AV_PIX_FMT_YUV422P10LE:
+		/* Just using Y */
+		line_maxima<uint16_t, 1>(*image, rows, columns);
+		scale = 1024;
+		break;
+	default:
+		throw PixelFormatError("guess_crop()", image->pixel_format());
 	}
 
-	for (auto y = height - 1; y >= 0; --y) {
-		if (image_in_line(0, y, width, true)) {
-			crop.bottom = height - 1 - y;
-			break;
-		}
-	}
+	auto bright = [scale, threshold](int value) {
+		return value / scale > threshold;
+	};
 
-	for (auto x = 0; x < width; ++x) {
-		if (image_in_line(x, 0, height, false)) {
-			crop.left = x;
-			break;
-		}
+	auto const top = std::find_if(rows.begin(), rows.end(), bright);
+	if (top == rows.end()) {
+		return {};
 	}
 
-	for (auto x = width - 1; x >= 0; --x) {
-		if (image_in_line(x, 0, height, false)) {
-			crop.right = width - 1 - x;
-			break;
-		}
-	}
+	auto const left = std::find_if(columns.begin(), columns.end(), bright);
+	DCPOMATIC_ASSERT (left != columns.end());
 
+	auto crop = Crop{};
+	crop.top = top - rows.begin();
+	crop.bottom = std::find_if(rows.rbegin(), rows.rend(), bright) - rows.rbegin();
+	crop.left = left - columns.begin();
+	crop.right = std::find_if(columns.rbegin(), columns.rend(), bright) - columns.rbegin();
 	return crop;
 }
 
 
-/** @param position Time within the content to get a video frame from when guessing the crop */
 Crop
-guess_crop (shared_ptr<const Film> film, shared_ptr<const Content> content, double threshold, ContentTime position)
+guess_crop (shared_ptr<const Image> image, double threshold)
 {
-	DCPOMATIC_ASSERT (content->video);
+	return guess_crop_if_bright(image, threshold).get_value_or(Crop());
+}
+
 
+/** @return Crop guessed from the first frame at or after position, or none if the frame was
+ *  too dark to say.
+ */
+static
+optional<Crop>
+guess_crop_at (shared_ptr<const Film> film, shared_ptr<const Content> content, double threshold, ContentTime position)
+{
 	auto decoder = decoder_factory (film, content, false, false, {});
 	DCPOMATIC_ASSERT (decoder->video);
 
 	bool done = false;
-	auto crop = Crop{};
+	optional<Crop> crop;
 
 	auto handle_video = [&done, &crop, threshold](ContentVideo video) {
-		crop = guess_crop(video.image->image(Image::Alignment::COMPACT).image, threshold);
+		crop = guess_crop_if_bright(video.image->image(Image::Alignment::COMPACT).image, threshold);
 		done = true;
 	};
 
@@ -141,3 +157,65 @@ guess_crop (shared_ptr<const Film> film, shared_ptr<const Content> content, doub
 	return crop;
 }
 
+
+/** @param position Time within the content to get a video frame from when guessing the crop */
+Crop
+guess_crop (shared_ptr<const Film> film, shared_ptr<const Content> content, double threshold, ContentTime position)
+{
+	DCPOMATIC_ASSERT (content->video);
+	return guess_crop_at(film, content, threshold, position).get_value_or(Crop());
+}
+
+
+/** Guess a crop by looking at several frames spread evenly through the (trimmed) content.
+ *  The frames are decoded in parallel, each after a non-accurate seek so that we need only
+ *  decode from the nearest keyframe.  Frames which are too dark to tell us anything are
+ *  ignored and the others are combined by taking the smallest crop on each edge, so that
+ *  nothing which is bright in any frame is cropped.
+ *  @param samples Number of frames to look at.
+ */
+Crop
+guess_crop_sampled (shared_ptr<const Film> film, shared_ptr<const Content> content, double threshold, int samples)
+{
+	DCPOMATIC_ASSERT (content->video);
+	DCPOMATIC_ASSERT (samples > 0);
+
+	auto const frame_rate = content->active_video_frame_rate(film);
+	auto const start = content->trim_start();
+	auto const end = ContentTime::from_frames(content->video->length(), frame_rate) - content->trim_end();
+	auto const length = max(ContentTime(), end - start);
+
+	vector<optional<Crop>> crops(samples);
+
+	{
+		TaskScheduler::Group tasks(TaskScheduler::instance(), TaskScheduler::Priority::PREVIEW);
+		for (int i = 0; i < samples; ++i) {
+			/* Avoid the very start and end, which are often black */
+			auto const position = start + ContentTime(length.get() * (i * 2 + 1) / (samples * 2));
+			tasks.submit([film, content, threshold, position, &crops, i]() {
+				try {
+					crops[i] = guess_crop_at(film, content, threshold, position);
+				} catch (...) {
+					/* Just leave this one out */
+				}
+			});
+		}
+	}
+
+	optional<Crop> combined;
+	for (auto const& crop: crops) {
+		if (!crop) {
+			continue;
+		}
+		if (!combined) {
+			combined = crop;
+		} else {
+			combined->left = std::min(combined->left, crop->left);
+			combined->right = std::min(combined->right, crop->right);
+			combined->top = std::min(combined->top, crop->top);
+			combined->bottom = std::min(combined->bottom, crop->bottom);
+		}
+	}
+
+	return combined.get_value_or(Crop());
+}
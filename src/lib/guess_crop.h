@@ -30,5 +30,6 @@ class Image;
 
 
 Crop guess_crop (std::shared_ptr<const Image> image, double threshold);
-Crop guess_crop (std::shared_ptr<const Film> fillm, std::shared_ptr<const Content> content, double threshold, dcpomatic::ContentTime position);
+Crop guess_crop (std::shared_ptr<const Film> film, std::shared_ptr<const Content> content, double threshold, dcpomatic::ContentTime position);
+Crop guess_crop_sampled (std::shared_ptr<const Film> film, std::shared_ptr<const Content> content, double threshold, int samples);
 
@@ -27,12 +27,16 @@
 #include "constants.h"
 #include "content.h"
 #include "cross.h"
+#include "dcp_content.h"
 #include "dcp_content_type.h"
+#include "dcpomatic_log.h"
+#include "digester.h"
 #include "film.h"
 #include "font.h"
 #include "hints.h"
 #include "maths_util.h"
 #include "player.h"
+#include "player_video.h"
 #include "ratio.h"
 #include "text_content.h"
 #include "video_content.h"
@@ -44,16 +48,19 @@
 #include <dcp/reel_closed_caption_asset.h>
 #include <dcp/reel_subtitle_asset.h>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <iostream>
 
 #include "i18n.h"
 
 
 using std::cout;
+using std::dynamic_pointer_cast;
 using std::make_shared;
 using std::max;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using std::weak_ptr;
 using boost::optional;
 using boost::bind;
@@ -74,13 +81,96 @@ using namespace boost::placeholders;
  */
 
 
-Hints::Hints (weak_ptr<const Film> weak_film)
+Hints::Hints (weak_ptr<const Film> weak_film, shared_ptr<HintsCache> cache)
 	: WeakConstFilm (weak_film)
 	, _writer (new Writer(weak_film, weak_ptr<Job>(), true))
 	, _analyser (film(), film()->playlist(), true, [](float) {})
 	, _stop (false)
+	, _cache (cache)
+{
+
+}
+
+
+vector<Hints::Check> const&
+Hints::checks ()
+{
+	static vector<Check> const all = {
+		{ &Hints::check_certificates, {}, {} },
+		{ &Hints::check_interop, { FilmProperty::INTEROP }, {} },
+		{ &Hints::check_big_font_files, { FilmProperty::INTEROP, FilmProperty::CONTENT }, { TextContentProperty::FONTS } },
+		{ &Hints::check_few_audio_channels, { FilmProperty::AUDIO_CHANNELS }, {} },
+		{ &Hints::check_upmixers, { FilmProperty::AUDIO_PROCESSOR }, {} },
+		{
+			&Hints::check_incorrect_container,
+			{ FilmProperty::CONTAINER, FilmProperty::RESOLUTION, FilmProperty::CONTENT },
+			{ VideoContentProperty::SIZE, VideoContentProperty::CROP, VideoContentProperty::CUSTOM_RATIO, VideoContentProperty::CUSTOM_SIZE }
+		},
+		{ &Hints::check_unusual_container, { FilmProperty::CONTAINER }, {} },
+		{ &Hints::check_high_j2k_bandwidth, { FilmProperty::J2K_BANDWIDTH }, {} },
+		{ &Hints::check_frame_rate, { FilmProperty::VIDEO_FRAME_RATE, FilmProperty::INTEROP }, {} },
+		{ &Hints::check_4k_3d, { FilmProperty::RESOLUTION, FilmProperty::THREE_D }, {} },
+		{
+			&Hints::check_speed_up,
+			{ FilmProperty::VIDEO_FRAME_RATE, FilmProperty::CONTENT },
+			{ ContentProperty::VIDEO_FRAME_RATE, ContentProperty::POSITION }
+		},
+		{ &Hints::check_vob, { FilmProperty::CONTENT }, { ContentProperty::PATH } },
+		{ &Hints::check_3d_in_2d, { FilmProperty::THREE_D, FilmProperty::CONTENT }, { VideoContentProperty::FRAME_TYPE } },
+		{
+			&Hints::check_ffec_and_ffmc_in_smpte_feature,
+			{ FilmProperty::INTEROP, FilmProperty::DCP_CONTENT_TYPE, FilmProperty::MARKERS },
+			{}
+		},
+		{
+			&Hints::check_out_of_range_markers,
+			{ FilmProperty::MARKERS, FilmProperty::VIDEO_FRAME_RATE, FilmProperty::CONTENT },
+			{ ContentProperty::POSITION, ContentProperty::LENGTH, ContentProperty::TRIM_START, ContentProperty::TRIM_END, ContentProperty::VIDEO_FRAME_RATE }
+		},
+		{
+			&Hints::check_subtitle_languages,
+			{ FilmProperty::CONTENT },
+			{ TextContentProperty::USE, TextContentProperty::TYPE, TextContentProperty::LANGUAGE }
+		},
+		{ &Hints::check_audio_language, { FilmProperty::AUDIO_LANGUAGE, FilmProperty::CONTENT }, { AudioContentProperty::STREAMS } },
+		{ &Hints::check_8_or_16_audio_channels, { FilmProperty::AUDIO_CHANNELS }, {} },
+	};
+
+	return all;
+}
+
+
+void
+HintsCache::film_changed (FilmProperty property)
 {
+	boost::mutex::scoped_lock lm (_mutex);
 
+	auto const& checks = Hints::checks();
+	for (auto i = _checks.begin(); i != _checks.end(); ) {
+		auto const& deps = checks[i->first].film_properties;
+		if (std::find(deps.begin(), deps.end(), property) != deps.end()) {
+			i = _checks.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+
+void
+HintsCache::content_changed (int property)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	auto const& checks = Hints::checks();
+	for (auto i = _checks.begin(); i != _checks.end(); ) {
+		auto const& deps = checks[i->first].content_properties;
+		if (std::find(deps.begin(), deps.end(), property) != deps.end()) {
+			i = _checks.erase(i);
+		} else {
+			++i;
+		}
+	}
 }
 
 
@@ -380,47 +470,95 @@ try
 		return;
 	}
 
-	auto content = film->content ();
-
-	check_certificates ();
-	check_interop ();
-	check_big_font_files ();
-	check_few_audio_channels ();
-	check_upmixers ();
-	check_incorrect_container ();
-	check_unusual_container ();
-	check_high_j2k_bandwidth ();
-	check_frame_rate ();
-	check_4k_3d ();
-	check_speed_up ();
-	check_vob ();
-	check_3d_in_2d ();
+	for (size_t i = 0; i < checks().size(); ++i) {
+		run_check (i);
+	}
+
 	auto const check_loudness_done = check_loudness ();
-	check_ffec_and_ffmc_in_smpte_feature ();
-	check_out_of_range_markers ();
-	check_subtitle_languages();
-	check_audio_language ();
-	check_8_or_16_audio_channels();
+	bool const analyse_audio = !check_loudness_done && !_disable_audio_analysis;
+
+	/* If the film will need to know how complex its frames are we can find out while we're here */
+	if (film->variable_j2k_bandwidth() && !dcp::filesystem::exists(film->video_complexity_path())) {
+		_complexity.reset(new VideoComplexity());
+	}
+
+	/* Anything we find out by examining the text only depends on the text content and
+	 * some of the film's settings, so if we did it before with the same inputs we can
+	 * just give the same hints again.
+	 */
+	auto const digest = text_digest();
+	optional<vector<string>> cached_text;
+	if (_cache) {
+		boost::mutex::scoped_lock lm (_cache->_mutex);
+		auto i = _cache->_text.find(digest);
+		if (i != _cache->_text.end()) {
+			cached_text = i->second;
+		}
+	}
 
-	if (check_loudness_done) {
+	if (cached_text) {
+		for (auto const& i: *cached_text) {
+			hint (i);
+		}
+		if (!analyse_audio && !_complexity) {
+			emit (bind(boost::ref(Finished)));
+			return;
+		}
+		if (analyse_audio) {
+			emit (bind(boost::ref(Progress), _("Examining audio")));
+		} else {
+			emit (bind(boost::ref(Progress), _("Examining video")));
+		}
+	} else if (check_loudness_done) {
 		emit (bind(boost::ref(Progress), _("Examining subtitles and closed captions")));
 	} else {
 		emit (bind(boost::ref(Progress), _("Examining audio, subtitles and closed captions")));
 	}
 
 	auto player = make_shared<Player>(film, Image::Alignment::COMPACT);
-	player->set_ignore_video ();
-	if (check_loudness_done || _disable_audio_analysis) {
+	if (_complexity) {
+		/* A quarter-size image is plenty to see how detailed each frame is */
+		auto const size = film->frame_size();
+		player->set_video_container_size(dcp::Size(size.width / 4, size.height / 4));
+		player->set_fast();
+		player->Video.connect(bind(&Hints::video, this, _1, _2));
+	} else {
+		player->set_ignore_video ();
+	}
+	if (!analyse_audio) {
 		/* We don't need to analyse audio because we already loaded a suitable analysis */
 		player->set_ignore_audio ();
 	}
+	if (cached_text) {
+		player->set_ignore_text ();
+	}
+
+	/* Our player does not play referenced DCP content, so we can't analyse that */
+	auto needing_subtitle_analysis = SubtitleAnalyser::needing_analysis(film, film->playlist());
+	needing_subtitle_analysis.erase(
+		std::remove_if(
+			needing_subtitle_analysis.begin(),
+			needing_subtitle_analysis.end(),
+			[](shared_ptr<Content> content) {
+				auto dcp = dynamic_pointer_cast<DCPContent>(content);
+				return dcp && dcp->reference_text(TextType::OPEN_SUBTITLE);
+			}),
+		needing_subtitle_analysis.end()
+		);
+	_subtitle_analyser.reset(new SubtitleAnalyser(film, needing_subtitle_analysis));
+
 	player->Audio.connect (bind(&Hints::audio, this, _1, _2));
 	player->Text.connect (bind(&Hints::text, this, _1, _2, _3, _4));
 
 	struct timeval last_pulse;
 	gettimeofday (&last_pulse, 0);
 
-	_writer->write (player->get_subtitle_fonts());
+	vector<string> text_hints;
+
+	if (!cached_text) {
+		_writer->write (player->get_subtitle_fonts());
+		_hints_for_cache = &text_hints;
+	}
 
 	while (!player->pass()) {
 
@@ -435,12 +573,31 @@ try
 		}
 	}
 
-	if (!check_loudness_done) {
+	_hints_for_cache = nullptr;
+
+	if (_complexity) {
+		try {
+			_complexity->write(film->video_complexity_path());
+		} catch (std::exception& e) {
+			/* This is not serious enough to stop the hints */
+			LOG_WARNING("Could not write video complexity (%1)", e.what());
+		}
+	}
+
+	if (analyse_audio) {
 		_analyser.finish ();
 		_analyser.get().write(film->audio_analysis_path(film->playlist()));
 		check_loudness ();
 	}
 
+	if (cached_text) {
+		emit (bind(boost::ref(Finished)));
+		return;
+	}
+
+	_subtitle_analyser->write();
+
+	_hints_for_cache = &text_hints;
 
 	if (_long_subtitle && !_very_long_subtitle) {
 		hint (_("At least one of your subtitle lines has more than 52 characters.  It is recommended to make each line 52 characters at most in length."));
@@ -487,6 +644,13 @@ try
 	}
 	dcp::filesystem::remove_all(dcp_dir);
 
+	_hints_for_cache = nullptr;
+
+	if (_cache) {
+		boost::mutex::scoped_lock lm (_cache->_mutex);
+		_cache->_text[digest] = text_hints;
+	}
+
 	emit (bind(boost::ref(Finished)));
 }
 catch (boost::thread_interrupted)
@@ -499,9 +663,75 @@ catch (...)
 }
 
 
+void
+Hints::run_check (int index)
+{
+	auto const& check = checks()[index];
+
+	if (_cache) {
+		boost::mutex::scoped_lock lm (_cache->_mutex);
+		auto i = _cache->_checks.find(index);
+		if (i != _cache->_checks.end()) {
+			auto const hints = i->second;
+			lm.unlock ();
+			for (auto const& j: hints) {
+				hint (j);
+			}
+			return;
+		}
+	}
+
+	vector<string> hints;
+	_hints_for_cache = &hints;
+	(this->*check.method)();
+	_hints_for_cache = nullptr;
+
+	if (_cache && !check.film_properties.empty()) {
+		boost::mutex::scoped_lock lm (_cache->_mutex);
+		_cache->_checks[index] = hints;
+	}
+}
+
+
+/** @return a digest of everything that affects the hints we get from examining the text */
+string
+Hints::text_digest () const
+{
+	auto film = this->film();
+
+	Digester digester;
+	digester.add (film->interop());
+	digester.add (film->video_frame_rate());
+	for (auto const& reel: film->reels()) {
+		digester.add (reel.from.get());
+		digester.add (reel.to.get());
+	}
+
+	for (auto content: film->content()) {
+		if (content->text.empty()) {
+			continue;
+		}
+		digester.add (content->identifier());
+		for (auto text: content->text) {
+			digester.add (text->identifier());
+			digester.add (text->use());
+			digester.add (text->burn());
+			digester.add (static_cast<int>(text->type()));
+			digester.add (text->language() ? text->language()->to_string() : string());
+			digester.add (text->dcp_track() ? text->dcp_track()->summary() : string());
+		}
+	}
+
+	return digester.get();
+}
+
+
 void
 Hints::hint (string h)
 {
+	if (_hints_for_cache) {
+		_hints_for_cache->push_back (h);
+	}
 	emit(bind(boost::ref(Hint), h));
 }
 
@@ -513,10 +743,24 @@ Hints::audio (shared_ptr<AudioBuffers> audio, DCPTime time)
 }
 
 
+void
+Hints::video (shared_ptr<PlayerVideo> video, DCPTime time)
+{
+	if (video->eyes() == Eyes::RIGHT) {
+		/* Both eyes of a 3D frame get the same bandwidth, so just look at the left */
+		return;
+	}
+
+	auto image = video->image([](AVPixelFormat) { return AV_PIX_FMT_RGB24; }, VideoRange::FULL, true);
+	_complexity->add(time.frames_round(film()->video_frame_rate()), VideoComplexity::measure(image));
+}
+
+
 void
 Hints::text (PlayerText text, TextType type, optional<DCPTextTrack> track, DCPTimePeriod period)
 {
 	_writer->write (text, type, track, period);
+	_subtitle_analyser->analyse (text, type);
 
 	switch (type) {
 	case TextType::CLOSED_CAPTION:
@@ -24,21 +24,52 @@
 #include "player_text.h"
 #include "dcp_text_track.h"
 #include "dcpomatic_time.h"
+#include "film_property.h"
+#include "subtitle_analyser.h"
+#include "video_complexity.h"
 #include "weak_film.h"
 #include <boost/signals2.hpp>
 #include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
 #include <vector>
 #include <string>
 
 
 class Film;
+class PlayerVideo;
 class Writer;
 
 
+/** Results of earlier runs of Hints on a film, so that a later run
+ *  need only re-do the work whose inputs have changed.
+ */
+class HintsCache
+{
+public:
+	/** Forget anything which depends on a property of the film */
+	void film_changed (FilmProperty property);
+	/** Forget anything which depends on a property of some content */
+	void content_changed (int property);
+
+private:
+	friend class Hints;
+
+	boost::mutex _mutex;
+	/** Hints given by each check that we know about, indexed by the check's position in Hints::checks() */
+	std::map<int, std::vector<std::string>> _checks;
+	/** Hints given by examining the film's text, keyed by Hints::text_digest() */
+	std::map<std::string, std::vector<std::string>> _text;
+};
+
+
 class Hints : public Signaller, public ExceptionStore, public WeakConstFilm
 {
 public:
-	explicit Hints (std::weak_ptr<const Film> film);
+	/** @param film Film to check.
+	 *  @param cache Results of earlier runs to use, or nullptr.
+	 */
+	explicit Hints (std::weak_ptr<const Film> film, std::shared_ptr<HintsCache> cache = {});
 	~Hints ();
 
 	void start ();
@@ -56,10 +87,28 @@ public:
 
 private:
 	friend struct hint_subtitle_too_early;
+	friend class HintsCache;
+
+	/** A check which needs nothing more than the film's metadata */
+	struct Check
+	{
+		void (Hints::*method)();
+		/** Film properties that the check's result depends on; if this is empty the
+		 *  check depends on something outside the film (e.g. Config) and is always run.
+		 */
+		std::vector<FilmProperty> film_properties;
+		/** Content properties that the check's result depends on */
+		std::vector<int> content_properties;
+	};
+
+	static std::vector<Check> const& checks ();
 
 	void thread ();
+	void run_check (int index);
+	std::string text_digest () const;
 	void hint (std::string h);
 	void audio (std::shared_ptr<AudioBuffers> audio, dcpomatic::DCPTime time);
+	void video (std::shared_ptr<PlayerVideo> video, dcpomatic::DCPTime time);
 	void text (PlayerText text, TextType type, boost::optional<DCPTextTrack> track, dcpomatic::DCPTimePeriod period);
 	void closed_caption (PlayerText text, dcpomatic::DCPTimePeriod period);
 	void open_subtitle (PlayerText text, dcpomatic::DCPTimePeriod period);
@@ -92,6 +141,12 @@ private:
 	std::shared_ptr<Writer> _writer;
 
 	AudioAnalyser _analyser;
+	/** Analyser for the subtitles of any content that needs it, so that
+	 *  AnalyseSubtitlesJob does not need to make a pass of its own.
+	 */
+	std::unique_ptr<SubtitleAnalyser> _subtitle_analyser;
+	/** Complexity of the film's video, if we are finding it out */
+	std::unique_ptr<VideoComplexity> _complexity;
 
 	bool _long_ccap = false;
 	bool _overlap_ccap = false;
@@ -108,5 +163,9 @@ private:
 
 	boost::atomic<bool> _stop;
 
+	std::shared_ptr<HintsCache> _cache;
+	/** If this is not nullptr, hints are added to it as well as being emitted */
+	std::vector<std::string>* _hints_for_cache = nullptr;
+
 	bool _disable_audio_analysis = false;
 };
@@ -30,10 +30,12 @@
 #include "enum_indexed_vector.h"
 #include "exceptions.h"
 #include "image.h"
+#include "image_buffer_pool.h"
 #include "maths_util.h"
-#include "memory_util.h"
+#include "pixel_format_traits.h"
 #include "rect.h"
 #include "timer.h"
+#include "trace.h"
 #include <dcp/rgb_xyz.h>
 #include <dcp/transfer_function.h>
 #include <dcp/warnings.h>
@@ -48,7 +50,15 @@ LIBDCP_ENABLE_WARNINGS
 #if HAVE_VALGRIND_MEMCHECK_H
 #include <valgrind/memcheck.h>
 #endif
+#ifdef DCPOMATIC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <tuple>
+#include <vector>
 
 
 #include "i18n.h"
@@ -56,6 +66,7 @@ LIBDCP_ENABLE_WARNINGS
 
 using std::cerr;
 using std::cout;
+using std::function;
 using std::list;
 using std::make_shared;
 using std::max;
@@ -63,6 +74,7 @@ using std::min;
 using std::runtime_error;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using dcp::Size;
 
 
@@ -71,12 +83,6 @@ int constexpr ALIGNMENT = 64;
 
 /* U/V black value for 8-bit colour */
 static uint8_t const eight_bit_uv =	(1 << 7) - 1;
-/* U/V black value for 9-bit colour */
-static uint16_t const nine_bit_uv =	(1 << 8) - 1;
-/* U/V black value for 10-bit colour */
-static uint16_t const ten_bit_uv =	(1 << 9) - 1;
-/* U/V black value for 16-bit colour */
-static uint16_t const sixteen_bit_uv =	(1 << 15) - 1;
 
 
 int
@@ -160,6 +166,117 @@ round_height_for_subsampling (int p, AVPixFmtDescriptor const * desc)
 }
 
 
+/** A cache of idle SwsContexts, so that a new context (which is expensive to set up) need not be
+ *  made for every scale.  A context is taken out of the cache while it is being used, so the same
+ *  one is never used by two threads at once.
+ */
+class ScaleContextCache
+{
+public:
+	/** Everything that goes into setting up a context */
+	typedef std::tuple<int, int, AVPixelFormat, int, int, AVPixelFormat, int, int, int, int> Key;
+
+	~ScaleContextCache()
+	{
+		for (auto i: _idle) {
+			sws_freeContext(i.second);
+		}
+	}
+
+	SwsContext* get(Key const& key)
+	{
+		{
+			boost::mutex::scoped_lock lm(_mutex);
+			for (auto i = _idle.begin(); i != _idle.end(); ++i) {
+				if (i->first == key) {
+					auto context = i->second;
+					_idle.erase(i);
+					return context;
+				}
+			}
+		}
+
+		auto context = sws_getContext(
+			std::get<0>(key), std::get<1>(key), std::get<2>(key),
+			std::get<3>(key), std::get<4>(key), std::get<5>(key),
+			std::get<6>(key), 0, 0, 0
+			);
+
+		if (!context) {
+			throw runtime_error (N_("Could not allocate SwsContext"));
+		}
+
+		sws_setColorspaceDetails (
+			context,
+			sws_getCoefficients(std::get<7>(key)), std::get<8>(key),
+			sws_getCoefficients(std::get<7>(key)), std::get<9>(key),
+			0, 1 << 16, 1 << 16
+			);
+
+		return context;
+	}
+
+	/** Give a context back once it has finished a (complete) scale */
+	void put(Key const& key, SwsContext* context)
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		/* Most-recently used at the front */
+		_idle.push_front(std::make_pair(key, context));
+		while (_idle.size() > _max_idle) {
+			sws_freeContext(_idle.back().second);
+			_idle.pop_back();
+		}
+	}
+
+private:
+	boost::mutex _mutex;
+	list<std::pair<Key, SwsContext*>> _idle;
+	/* Enough for a few scales to be going on at once in each of a few different configurations */
+	static size_t constexpr _max_idle = 32;
+};
+
+
+static ScaleContextCache scale_context_cache;
+
+
+/** A context from scale_context_cache which goes back to the cache when release() is called,
+ *  or is freed if it is destroyed without release() being called (for example if an exception
+ *  interrupts a scale half-way through).
+ */
+class ScaleContext
+{
+public:
+	explicit ScaleContext(ScaleContextCache::Key key)
+		: _key(key)
+		, _context(scale_context_cache.get(key))
+	{}
+
+	~ScaleContext()
+	{
+		if (_context) {
+			sws_freeContext(_context);
+		}
+	}
+
+	ScaleContext(ScaleContext const&) = delete;
+	ScaleContext& operator=(ScaleContext const&) = delete;
+
+	SwsContext* get() const {
+		return _context;
+	}
+
+	void release()
+	{
+		scale_context_cache.put(_key, _context);
+		_context = nullptr;
+	}
+
+private:
+	ScaleContextCache::Key _key;
+	SwsContext* _context;
+};
+
+
 /** Crop this image, scale it to `inter_size' and then place it in a black frame of `out_size'.
  *  @param crop Amount to crop by.
  *  @param inter_size Size to scale the cropped image to.
@@ -171,6 +288,10 @@ round_height_for_subsampling (int p, AVPixFmtDescriptor const * desc)
  *  @param out_video_range Video range to use for the output image.
  *  @param fast Try to be fast at the possible expense of quality; at present this means using
  *  fast bilinear rather than bicubic scaling.
+ *  @param lines_ready If set, this is called with the output image, a first line and a number of lines
+ *  whenever some lines of the output are finished.  When possible the scale is done a slice at a time
+ *  so that this happens while the lines are still in cache.  Only single-plane output formats may be
+ *  used with this.
  */
 shared_ptr<Image>
 Image::crop_scale_window (
@@ -182,13 +303,14 @@ Image::crop_scale_window (
 	AVPixelFormat out_format,
 	VideoRange out_video_range,
 	Alignment out_alignment,
-	bool fast
+	bool fast,
+	function<void (Image const&, int, int)> lines_ready
 	) const
 {
 	/* Empirical testing suggests that sws_scale() will crash if
 	   the input image is not padded.
 	*/
-	DCPOMATIC_ASSERT (alignment() == Alignment::PADDED);
+	DCPOMATIC_ASSERT (has_layout_of(Alignment::PADDED));
 
 	DCPOMATIC_ASSERT (out_size.width >= inter_size.width);
 	DCPOMATIC_ASSERT (out_size.height >= inter_size.height);
@@ -225,40 +347,29 @@ Image::crop_scale_window (
 	/* Size of the image after any crop */
 	auto const cropped_size = corrected_crop.apply (size());
 
-	/* Scale context for a scale from cropped_size to inter_size */
-	auto scale_context = sws_getContext (
-			cropped_size.width, cropped_size.height, pixel_format(),
-			inter_size.width, inter_size.height, out_format,
-			fast ? SWS_FAST_BILINEAR : SWS_BICUBIC, 0, 0, 0
-		);
-
-	if (!scale_context) {
-		throw runtime_error (N_("Could not allocate SwsContext"));
-	}
-
 	DCPOMATIC_ASSERT (yuv_to_rgb < dcp::YUVToRGB::COUNT);
 	EnumIndexedVector<int, dcp::YUVToRGB> lut;
 	lut[dcp::YUVToRGB::REC601] = SWS_CS_ITU601;
 	lut[dcp::YUVToRGB::REC709] = SWS_CS_ITU709;
 	lut[dcp::YUVToRGB::REC2020] = SWS_CS_BT2020;
 
-	/* The 3rd parameter here is:
+	/* Scale context for a scale from cropped_size to inter_size.  The ranges given here are used like this:
 	   0 -> source range MPEG (i.e. "video", 16-235)
 	   1 -> source range JPEG (i.e. "full", 0-255)
-	   And the 5th:
-	   0 -> destination range MPEG (i.e. "video", 16-235)
-	   1 -> destination range JPEG (i.e. "full", 0-255)
+	   for the input and then the output.
 
 	   But remember: sws_setColorspaceDetails ignores these
 	   parameters unless the both source and destination images
 	   are isYUV or isGray.  (If either is not, it uses video range).
 	*/
-	sws_setColorspaceDetails (
-		scale_context,
-		sws_getCoefficients(lut[yuv_to_rgb]), video_range == VideoRange::VIDEO ? 0 : 1,
-		sws_getCoefficients(lut[yuv_to_rgb]), out_video_range == VideoRange::VIDEO ? 0 : 1,
-		0, 1 << 16, 1 << 16
-		);
+	ScaleContext scale_context(std::make_tuple(
+		cropped_size.width, cropped_size.height, pixel_format(),
+		inter_size.width, inter_size.height, out_format,
+		fast ? SWS_FAST_BILINEAR : SWS_BICUBIC,
+		lut[yuv_to_rgb],
+		video_range == VideoRange::VIDEO ? 0 : 1,
+		out_video_range == VideoRange::VIDEO ? 0 : 1
+		));
 
 	/* Prepare input data pointers with crop */
 	uint8_t* scale_in_data[planes()];
@@ -284,14 +395,63 @@ Image::crop_scale_window (
 		scale_out_data[c] = out->data()[c] + x + out->stride()[c] * (corner.y / out->vertical_factor(c));
 	}
 
+	/* libswscale will not convert video range for RGB sources, so we have to do it ourselves */
+	bool const convert_range =
+		video_range == VideoRange::VIDEO &&
+		out_video_range == VideoRange::FULL &&
+		av_pix_fmt_desc_get(_pixel_format)->flags & AV_PIX_FMT_FLAG_RGB;
+
+	auto const pad = (out_size.width - inter_size.width) / 2;
+
+	if (lines_ready && !convert_range) {
+		/* Scale a slice of the input at a time and give each set of output lines to lines_ready as soon
+		 * as it is finished, so that the caller can process them while they are still in the cache.
+		 */
+		DCPOMATIC_ASSERT (out->planes() == 1);
+		int const bpp = out->bytes_per_pixel(0);
+		int const slice = 64 << in_desc->log2_chroma_h;
+		int done = 0;
+		auto emit = [&](int up_to) {
+			/* Clear out the sides of the lines (see below) */
+			for (int y = done; y < up_to; ++y) {
+				auto p = out->data()[0] + y * out->stride()[0];
+				memset(p, 0, pad * bpp);
+				memset(p + (corner.x + inter_size.width) * bpp, 0, pad * bpp);
+			}
+			if (up_to > done) {
+				lines_ready(*out, done, up_to - done);
+			}
+			done = up_to;
+		};
+
+		int scaled = 0;
+		for (int y = 0; y < cropped_size.height; y += slice) {
+			uint8_t* slice_data[planes()];
+			for (int c = 0; c < planes(); ++c) {
+				slice_data[c] = scale_in_data[c] + stride()[c] * (y / vertical_factor(c));
+			}
+			scaled += sws_scale (
+				scale_context.get(),
+				slice_data, stride(),
+				y, min(slice, cropped_size.height - y),
+				scale_out_data, out->stride()
+				);
+			emit(corner.y + scaled);
+		}
+
+		scale_context.release();
+		emit(out_size.height);
+		return out;
+	}
+
 	sws_scale (
-		scale_context,
+		scale_context.get(),
 		scale_in_data, stride(),
 		0, cropped_size.height,
 		scale_out_data, out->stride()
 		);
 
-	sws_freeContext (scale_context);
+	scale_context.release();
 
 	/* There are some cases where there will be unwanted image data left in the image at this point:
 	 *
@@ -301,19 +461,17 @@ Image::crop_scale_window (
 	 *
 	 * Clear out the sides of the image to take care of those cases.
 	 */
-	auto const pad = (out_size.width - inter_size.width) / 2;
 	out->make_part_black(0, pad);
 	out->make_part_black(corner.x + inter_size.width, pad);
 
-	if (
-		video_range == VideoRange::VIDEO &&
-		out_video_range == VideoRange::FULL &&
-		av_pix_fmt_desc_get(_pixel_format)->flags & AV_PIX_FMT_FLAG_RGB
-	   ) {
-		/* libswscale will not convert video range for RGB sources, so we have to do it ourselves */
+	if (convert_range) {
 		out->video_range_to_full_range ();
 	}
 
+	if (lines_ready) {
+		lines_ready(*out, 0, out_size.height);
+	}
+
 	return out;
 }
 
@@ -338,14 +496,7 @@ Image::scale (dcp::Size out_size, dcp::YUVToRGB yuv_to_rgb, AVPixelFormat out_fo
 	/* Empirical testing suggests that sws_scale() will crash if
 	   the input image alignment is not PADDED.
 	*/
-	DCPOMATIC_ASSERT (alignment() == Alignment::PADDED);
-
-	auto scaled = make_shared<Image>(out_format, out_size, out_alignment);
-	auto scale_context = sws_getContext (
-		size().width, size().height, pixel_format(),
-		out_size.width, out_size.height, out_format,
-		(fast ? SWS_FAST_BILINEAR : SWS_BICUBIC) | SWS_ACCURATE_RND, 0, 0, 0
-		);
+	DCPOMATIC_ASSERT (has_layout_of(Alignment::PADDED));
 
 	DCPOMATIC_ASSERT (yuv_to_rgb < dcp::YUVToRGB::COUNT);
 	EnumIndexedVector<int, dcp::YUVToRGB> lut;
@@ -353,81 +504,108 @@ Image::scale (dcp::Size out_size, dcp::YUVToRGB yuv_to_rgb, AVPixelFormat out_fo
 	lut[dcp::YUVToRGB::REC709] = SWS_CS_ITU709;
 	lut[dcp::YUVToRGB::REC2020] = SWS_CS_BT2020;
 
-	/* The 3rd parameter here is:
+	/* The ranges here are:
 	   0 -> source range MPEG (i.e. "video", 16-235)
 	   1 -> source range JPEG (i.e. "full", 0-255)
-	   And the 5th:
-	   0 -> destination range MPEG (i.e. "video", 16-235)
-	   1 -> destination range JPEG (i.e. "full", 0-255)
+	   for the input and then the output.
 
 	   But remember: sws_setColorspaceDetails ignores these
 	   parameters unless the corresponding image isYUV or isGray.
 	   (If it's neither, it uses video range).
 	*/
-	sws_setColorspaceDetails (
-		scale_context,
-		sws_getCoefficients(lut[yuv_to_rgb]), 0,
-		sws_getCoefficients(lut[yuv_to_rgb]), 0,
-		0, 1 << 16, 1 << 16
-		);
+	ScaleContext scale_context(std::make_tuple(
+		size().width, size().height, pixel_format(),
+		out_size.width, out_size.height, out_format,
+		(fast ? SWS_FAST_BILINEAR : SWS_BICUBIC) | SWS_ACCURATE_RND,
+		lut[yuv_to_rgb],
+		0,
+		0
+		));
+
+	auto scaled = make_shared<Image>(out_format, out_size, out_alignment);
 
 	sws_scale (
-		scale_context,
+		scale_context.get(),
 		data(), stride(),
 		0, size().height,
 		scaled->data(), scaled->stride()
 		);
 
-	sws_freeContext (scale_context);
+	scale_context.release();
 
 	return scaled;
 }
 
 
-/** Blacken a YUV image whose bits per pixel is rounded up to 16 */
-void
-Image::yuv_16_black (uint16_t v, bool alpha)
+/** Blacken a planar YUV image */
+template <AVPixelFormat F>
+static void
+make_black_planar_yuv (Image& image)
 {
-	memset (data()[0], 0, sample_size(0).height * stride()[0]);
+	typedef PixelFormatTraits<F> Traits;
+	typedef typename Traits::Sample Sample;
+
+	memset (image.data()[0], 0, image.sample_size(0).height * image.stride()[0]);
+
+	Sample const black = Traits::black_uv;
 	for (int i = 1; i < 3; ++i) {
-		auto p = reinterpret_cast<int16_t*> (data()[i]);
-		int const lines = sample_size(i).height;
-		for (int y = 0; y < lines; ++y) {
-			/* We divide by 2 here because we are writing 2 bytes at a time */
-			for (int x = 0; x < line_size()[i] / 2; ++x) {
-				p[x] = v;
+		if (sizeof(Sample) == 1) {
+			memset (image.data()[i], black, image.sample_size(i).height * image.stride()[i]);
+		} else {
+			auto p = image.data()[i];
+			int const lines = image.sample_size(i).height;
+			int const samples = image.line_size()[i] / sizeof(Sample);
+			for (int y = 0; y < lines; ++y) {
+				std::fill_n (reinterpret_cast<Sample*>(p), samples, black);
+				p += image.stride()[i];
 			}
-			p += stride()[i] / 2;
 		}
 	}
 
-	if (alpha) {
-		memset (data()[3], 0, sample_size(3).height * stride()[3]);
+	if (Traits::alpha) {
+		memset (image.data()[3], 0, image.sample_size(3).height * image.stride()[3]);
 	}
 }
 
 
-uint16_t
-Image::swap_16 (uint16_t v)
+/** Blacken part of a planar YUV image.
+ *  @param start x position of the first pixel to blacken.
+ *  @param width Number of pixels to blacken.
+ */
+template <AVPixelFormat F>
+static void
+make_part_black_planar_yuv (Image& image, int start, int width)
 {
-	return ((v >> 8) & 0xff) | ((v & 0xff) << 8);
+	typedef PixelFormatTraits<F> Traits;
+	typedef typename Traits::Sample Sample;
+
+	auto p = image.data()[0];
+	int const h = image.sample_size(0).height;
+	for (int y = 0; y < h; ++y) {
+		memset (p + start * sizeof(Sample), 0, width * sizeof(Sample));
+		p += image.stride()[0];
+	}
+
+	Sample const black = Traits::black_uv;
+	int const chroma_start = start >> Traits::log2_chroma_width;
+	int const chroma_end = (start + width) >> Traits::log2_chroma_width;
+	for (int i = 1; i < 3; ++i) {
+		auto q = image.data()[i];
+		int const lines = image.sample_size(i).height;
+		for (int y = 0; y < lines; ++y) {
+			auto samples = reinterpret_cast<Sample*>(q);
+			for (int x = chroma_start; x < chroma_end; ++x) {
+				samples[x] = black;
+			}
+			q += image.stride()[i];
+		}
+	}
 }
 
 
 void
 Image::make_part_black (int const start, int const width)
 {
-	auto y_part = [&]() {
-		int const bpp = bytes_per_pixel(0);
-		int const h = sample_size(0).height;
-		int const s = stride()[0];
-		auto p = data()[0];
-		for (int y = 0; y < h; ++y) {
-			memset (p + start * bpp, 0, width * bpp);
-			p += s;
-		}
-	};
-
 	switch (_pixel_format) {
 	case AV_PIX_FMT_RGB24:
 	case AV_PIX_FMT_ARGB:
@@ -450,50 +628,14 @@ Image::make_part_black (int const start, int const width)
 		break;
 	}
 	case AV_PIX_FMT_YUV420P:
-	{
-		y_part ();
-		for (int i = 1; i < 3; ++i) {
-			auto p = data()[i];
-			int const h = sample_size(i).height;
-			for (int y = 0; y < h; ++y) {
-				for (int x = start / 2; x < (start + width) / 2; ++x) {
-					p[x] = eight_bit_uv;
-				}
-				p += stride()[i];
-			}
-		}
+		make_part_black_planar_yuv<AV_PIX_FMT_YUV420P>(*this, start, width);
 		break;
-	}
 	case AV_PIX_FMT_YUV422P10LE:
-	{
-		y_part ();
-		for (int i = 1; i < 3; ++i) {
-			auto p = reinterpret_cast<int16_t*>(data()[i]);
-			int const h = sample_size(i).height;
-			for (int y = 0; y < h; ++y) {
-				for (int x = start / 2; x < (start + width) / 2; ++x) {
-					p[x] = ten_bit_uv;
-				}
-				p += stride()[i] / 2;
-			}
-		}
+		make_part_black_planar_yuv<AV_PIX_FMT_YUV422P10LE>(*this, start, width);
 		break;
-	}
 	case AV_PIX_FMT_YUV444P10LE:
-	{
-		y_part();
-		for (int i = 1; i < 3; ++i) {
-			auto p = reinterpret_cast<int16_t*>(data()[i]);
-			int const h = sample_size(i).height;
-			for (int y = 0; y < h; ++y) {
-				for (int x = start; x < (start + width); ++x) {
-					p[x] = ten_bit_uv;
-				}
-				p += stride()[i] / 2;
-			}
-		}
+		make_part_black_planar_yuv<AV_PIX_FMT_YUV444P10LE>(*this, start, width);
 		break;
-	}
 	default:
 		throw PixelFormatError ("make_part_black()", _pixel_format);
 	}
@@ -505,81 +647,109 @@ Image::make_black ()
 {
 	switch (_pixel_format) {
 	case AV_PIX_FMT_YUV420P:
+		make_black_planar_yuv<AV_PIX_FMT_YUV420P>(*this);
+		break;
 	case AV_PIX_FMT_YUV422P:
+		make_black_planar_yuv<AV_PIX_FMT_YUV422P>(*this);
+		break;
 	case AV_PIX_FMT_YUV444P:
+		make_black_planar_yuv<AV_PIX_FMT_YUV444P>(*this);
+		break;
 	case AV_PIX_FMT_YUV411P:
-		memset (data()[0], 0, sample_size(0).height * stride()[0]);
-		memset (data()[1], eight_bit_uv, sample_size(1).height * stride()[1]);
-		memset (data()[2], eight_bit_uv, sample_size(2).height * stride()[2]);
+		make_black_planar_yuv<AV_PIX_FMT_YUV411P>(*this);
 		break;
-
 	case AV_PIX_FMT_YUVJ420P:
+		make_black_planar_yuv<AV_PIX_FMT_YUVJ420P>(*this);
+		break;
 	case AV_PIX_FMT_YUVJ422P:
+		make_black_planar_yuv<AV_PIX_FMT_YUVJ422P>(*this);
+		break;
 	case AV_PIX_FMT_YUVJ444P:
-		memset (data()[0], 0, sample_size(0).height * stride()[0]);
-		memset (data()[1], eight_bit_uv + 1, sample_size(1).height * stride()[1]);
-		memset (data()[2], eight_bit_uv + 1, sample_size(2).height * stride()[2]);
+		make_black_planar_yuv<AV_PIX_FMT_YUVJ444P>(*this);
 		break;
-
 	case AV_PIX_FMT_YUV422P9LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUV422P9LE>(*this);
+		break;
 	case AV_PIX_FMT_YUV444P9LE:
-		yuv_16_black (nine_bit_uv, false);
+		make_black_planar_yuv<AV_PIX_FMT_YUV444P9LE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUV422P9BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUV422P9BE>(*this);
+		break;
 	case AV_PIX_FMT_YUV444P9BE:
-		yuv_16_black (swap_16 (nine_bit_uv), false);
+		make_black_planar_yuv<AV_PIX_FMT_YUV444P9BE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUV422P10LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUV422P10LE>(*this);
+		break;
 	case AV_PIX_FMT_YUV444P10LE:
-		yuv_16_black (ten_bit_uv, false);
+		make_black_planar_yuv<AV_PIX_FMT_YUV444P10LE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUV422P16LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUV422P16LE>(*this);
+		break;
 	case AV_PIX_FMT_YUV444P16LE:
-		yuv_16_black (sixteen_bit_uv, false);
+		make_black_planar_yuv<AV_PIX_FMT_YUV444P16LE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUV444P10BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUV444P10BE>(*this);
+		break;
 	case AV_PIX_FMT_YUV422P10BE:
-		yuv_16_black (swap_16 (ten_bit_uv), false);
+		make_black_planar_yuv<AV_PIX_FMT_YUV422P10BE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUVA420P9BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA420P9BE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA422P9BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA422P9BE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA444P9BE:
-		yuv_16_black (swap_16 (nine_bit_uv), true);
+		make_black_planar_yuv<AV_PIX_FMT_YUVA444P9BE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUVA420P9LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA420P9LE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA422P9LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA422P9LE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA444P9LE:
-		yuv_16_black (nine_bit_uv, true);
+		make_black_planar_yuv<AV_PIX_FMT_YUVA444P9LE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUVA420P10BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA420P10BE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA422P10BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA422P10BE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA444P10BE:
-		yuv_16_black (swap_16 (ten_bit_uv), true);
+		make_black_planar_yuv<AV_PIX_FMT_YUVA444P10BE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUVA420P10LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA420P10LE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA422P10LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA422P10LE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA444P10LE:
-		yuv_16_black (ten_bit_uv, true);
+		make_black_planar_yuv<AV_PIX_FMT_YUVA444P10LE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUVA420P16BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA420P16BE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA422P16BE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA422P16BE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA444P16BE:
-		yuv_16_black (swap_16 (sixteen_bit_uv), true);
+		make_black_planar_yuv<AV_PIX_FMT_YUVA444P16BE>(*this);
 		break;
-
 	case AV_PIX_FMT_YUVA420P16LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA420P16LE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA422P16LE:
+		make_black_planar_yuv<AV_PIX_FMT_YUVA422P16LE>(*this);
+		break;
 	case AV_PIX_FMT_YUVA444P16LE:
-		yuv_16_black (sixteen_bit_uv, true);
+		make_black_planar_yuv<AV_PIX_FMT_YUVA444P16LE>(*this);
 		break;
 
 	case AV_PIX_FMT_RGB24:
@@ -658,23 +828,43 @@ struct OtherParams
 	float alpha_divisor() const {
 		return pow(2, bpp * 2) - 1;
 	}
+
+	/** @return the alpha value of a fully-opaque pixel */
+	int alpha_max() const {
+		return (1 << (bpp * 2)) - 1;
+	}
 };
 
 
-template <class OtherType>
+/* In the alpha_blend_onto_* kernels below the component getter is a template parameter, so that it
+ * can be inlined.  Subtitle images are mostly either fully transparent or fully opaque, so these
+ * pixels are handled without any floating-point work; the results are the same as those of the
+ * general case.
+ */
+
+
+template <class OtherType, class Get>
 void
-alpha_blend_onto_rgb24(TargetParams const& target, OtherParams const& other, int red, int blue, std::function<float (OtherType*)> get, int value_divisor)
+alpha_blend_onto_rgb24(TargetParams const& target, OtherParams const& other, int red, int blue, Get get, int value_divisor)
 {
 	/* Going onto RGB24.  First byte is red, second green, third blue */
 	auto const alpha_divisor = other.alpha_divisor();
+	auto const alpha_max = other.alpha_max();
 	for (int ty = target.start_y, oy = other.start_y; ty < target.size.height && oy < other.size.height; ++ty, ++oy) {
 		auto tp = target.line_pointer(ty);
 		auto op = reinterpret_cast<OtherType*>(other.line_pointer(oy));
 		for (int tx = target.start_x, ox = other.start_x; tx < target.size.width && ox < other.size.width; ++tx, ++ox) {
-			float const alpha = get(op + 3) / alpha_divisor;
-			tp[0] = (get(op + red) / value_divisor) * alpha + tp[0] * (1 - alpha);
-			tp[1] = (get(op + 1) / value_divisor) * alpha + tp[1] * (1 - alpha);
-			tp[2] = (get(op + blue) / value_divisor) * alpha + tp[2] * (1 - alpha);
+			int const a = get(op + 3);
+			if (a == alpha_max) {
+				tp[0] = get(op + red) / value_divisor;
+				tp[1] = get(op + 1) / value_divisor;
+				tp[2] = get(op + blue) / value_divisor;
+			} else if (a) {
+				float const alpha = a / alpha_divisor;
+				tp[0] = (float(get(op + red)) / value_divisor) * alpha + tp[0] * (1 - alpha);
+				tp[1] = (float(get(op + 1)) / value_divisor) * alpha + tp[1] * (1 - alpha);
+				tp[2] = (float(get(op + blue)) / value_divisor) * alpha + tp[2] * (1 - alpha);
+			}
 
 			tp += target.bpp;
 			op += other.bpp / sizeof(OtherType);
@@ -683,20 +873,29 @@ alpha_blend_onto_rgb24(TargetParams const& target, OtherParams const& other, int
 }
 
 
-template <class OtherType>
+template <class OtherType, class Get>
 void
-alpha_blend_onto_bgra(TargetParams const& target, OtherParams const& other, int red, int blue, std::function<float (OtherType*)> get, int value_divisor)
+alpha_blend_onto_bgra(TargetParams const& target, OtherParams const& other, int red, int blue, Get get, int value_divisor)
 {
 	auto const alpha_divisor = other.alpha_divisor();
+	auto const alpha_max = other.alpha_max();
 	for (int ty = target.start_y, oy = other.start_y; ty < target.size.height && oy < other.size.height; ++ty, ++oy) {
 		auto tp = target.line_pointer(ty);
 		auto op = reinterpret_cast<OtherType*>(other.line_pointer(oy));
 		for (int tx = target.start_x, ox = other.start_x; tx < target.size.width && ox < other.size.width; ++tx, ++ox) {
-			float const alpha = get(op + 3) / alpha_divisor;
-			tp[0] = (get(op + blue) / value_divisor) * alpha + tp[0] * (1 - alpha);
-			tp[1] = (get(op + 1) / value_divisor) * alpha + tp[1] * (1 - alpha);
-			tp[2] = (get(op + red) / value_divisor) * alpha + tp[2] * (1 - alpha);
-			tp[3] = (get(op + 3) / value_divisor) * alpha + tp[3] * (1 - alpha);
+			int const a = get(op + 3);
+			if (a == alpha_max) {
+				tp[0] = get(op + blue) / value_divisor;
+				tp[1] = get(op + 1) / value_divisor;
+				tp[2] = get(op + red) / value_divisor;
+				tp[3] = a / value_divisor;
+			} else if (a) {
+				float const alpha = a / alpha_divisor;
+				tp[0] = (float(get(op + blue)) / value_divisor) * alpha + tp[0] * (1 - alpha);
+				tp[1] = (float(get(op + 1)) / value_divisor) * alpha + tp[1] * (1 - alpha);
+				tp[2] = (float(get(op + red)) / value_divisor) * alpha + tp[2] * (1 - alpha);
+				tp[3] = (float(a) / value_divisor) * alpha + tp[3] * (1 - alpha);
+			}
 
 			tp += target.bpp;
 			op += other.bpp / sizeof(OtherType);
@@ -705,20 +904,29 @@ alpha_blend_onto_bgra(TargetParams const& target, OtherParams const& other, int
 }
 
 
-template <class OtherType>
+template <class OtherType, class Get>
 void
-alpha_blend_onto_rgba(TargetParams const& target, OtherParams const& other, int red, int blue, std::function<float (OtherType*)> get, int value_divisor)
+alpha_blend_onto_rgba(TargetParams const& target, OtherParams const& other, int red, int blue, Get get, int value_divisor)
 {
 	auto const alpha_divisor = other.alpha_divisor();
+	auto const alpha_max = other.alpha_max();
 	for (int ty = target.start_y, oy = other.start_y; ty < target.size.height && oy < other.size.height; ++ty, ++oy) {
 		auto tp = target.line_pointer(ty);
 		auto op = reinterpret_cast<OtherType*>(other.line_pointer(oy));
 		for (int tx = target.start_x, ox = other.start_x; tx < target.size.width && ox < other.size.width; ++tx, ++ox) {
-			float const alpha = get(op + 3) / alpha_divisor;
-			tp[0] = (get(op + red) / value_divisor) * alpha + tp[0] * (1 - alpha);
-			tp[1] = (get(op + 1) / value_divisor) * alpha + tp[1] * (1 - alpha);
-			tp[2] = (get(op + blue) / value_divisor) * alpha + tp[2] * (1 - alpha);
-			tp[3] = (get(op + 3) / value_divisor) * alpha + tp[3] * (1 - alpha);
+			int const a = get(op + 3);
+			if (a == alpha_max) {
+				tp[0] = get(op + red) / value_divisor;
+				tp[1] = get(op + 1) / value_divisor;
+				tp[2] = get(op + blue) / value_divisor;
+				tp[3] = a / value_divisor;
+			} else if (a) {
+				float const alpha = a / alpha_divisor;
+				tp[0] = (float(get(op + red)) / value_divisor) * alpha + tp[0] * (1 - alpha);
+				tp[1] = (float(get(op + 1)) / value_divisor) * alpha + tp[1] * (1 - alpha);
+				tp[2] = (float(get(op + blue)) / value_divisor) * alpha + tp[2] * (1 - alpha);
+				tp[3] = (float(a) / value_divisor) * alpha + tp[3] * (1 - alpha);
+			}
 
 			tp += target.bpp;
 			op += other.bpp / sizeof(OtherType);
@@ -727,19 +935,27 @@ alpha_blend_onto_rgba(TargetParams const& target, OtherParams const& other, int
 }
 
 
-template <class OtherType>
+template <class OtherType, class Get>
 void
-alpha_blend_onto_rgb48le(TargetParams const& target, OtherParams const& other, int red, int blue, std::function<float (OtherType*)> get, int value_scale)
+alpha_blend_onto_rgb48le(TargetParams const& target, OtherParams const& other, int red, int blue, Get get, int value_scale)
 {
 	auto const alpha_divisor = other.alpha_divisor();
+	auto const alpha_max = other.alpha_max();
 	for (int ty = target.start_y, oy = other.start_y; ty < target.size.height && oy < other.size.height; ++ty, ++oy) {
 		auto tp = reinterpret_cast<uint16_t*>(target.line_pointer(ty));
 		auto op = reinterpret_cast<OtherType*>(other.line_pointer(oy));
 		for (int tx = target.start_x, ox = other.start_x; tx < target.size.width && ox < other.size.width; ++tx, ++ox) {
-			float const alpha = get(op + 3) / alpha_divisor;
-			tp[0] = get(op + red) * value_scale * alpha + tp[0] * (1 - alpha);
-			tp[1] = get(op + 1) * value_scale * alpha + tp[1] * (1 - alpha);
-			tp[2] = get(op + blue) * value_scale * alpha + tp[2] * (1 - alpha);
+			int const a = get(op + 3);
+			if (a == alpha_max) {
+				tp[0] = get(op + red) * value_scale;
+				tp[1] = get(op + 1) * value_scale;
+				tp[2] = get(op + blue) * value_scale;
+			} else if (a) {
+				float const alpha = a / alpha_divisor;
+				tp[0] = get(op + red) * value_scale * alpha + tp[0] * (1 - alpha);
+				tp[1] = get(op + 1) * value_scale * alpha + tp[1] * (1 - alpha);
+				tp[2] = get(op + blue) * value_scale * alpha + tp[2] * (1 - alpha);
+			}
 
 			tp += target.bpp / 2;
 			op += other.bpp / sizeof(OtherType);
@@ -748,9 +964,9 @@ alpha_blend_onto_rgb48le(TargetParams const& target, OtherParams const& other, i
 }
 
 
-template <class OtherType>
+template <class OtherType, class Get>
 void
-alpha_blend_onto_xyz12le(TargetParams const& target, OtherParams const& other, int red, int blue, std::function<float (OtherType*)> get, int value_divisor)
+alpha_blend_onto_xyz12le(TargetParams const& target, OtherParams const& other, int red, int blue, Get get, int value_divisor)
 {
 	auto const alpha_divisor = other.alpha_divisor();
 	auto conv = dcp::ColourConversion::srgb_to_xyz();
@@ -762,22 +978,25 @@ alpha_blend_onto_xyz12le(TargetParams const& target, OtherParams const& other, i
 		auto tp = reinterpret_cast<uint16_t*>(target.data[0] + ty * target.stride[0] + target.start_x * target.bpp);
 		auto op = reinterpret_cast<OtherType*>(other.data[0] + oy * other.stride[0]);
 		for (int tx = target.start_x, ox = other.start_x; tx < target.size.width && ox < other.size.width; ++tx, ++ox) {
-			float const alpha = get(op + 3) / alpha_divisor;
-
-			/* Convert sRGB to XYZ; op is BGRA.  First, input gamma LUT */
-			double const r = lut_in[get(op + red) / value_divisor];
-			double const g = lut_in[get(op + 1) / value_divisor];
-			double const b = lut_in[get(op + blue) / value_divisor];
-
-			/* RGB to XYZ, including Bradford transform and DCI companding */
-			double const x = max(0.0, min(1.0, r * fast_matrix[0] + g * fast_matrix[1] + b * fast_matrix[2]));
-			double const y = max(0.0, min(1.0, r * fast_matrix[3] + g * fast_matrix[4] + b * fast_matrix[5]));
-			double const z = max(0.0, min(1.0, r * fast_matrix[6] + g * fast_matrix[7] + b * fast_matrix[8]));
-
-			/* Out gamma LUT and blend */
-			tp[0] = lut_out[lrint(x * 65535)] * alpha + tp[0] * (1 - alpha);
-			tp[1] = lut_out[lrint(y * 65535)] * alpha + tp[1] * (1 - alpha);
-			tp[2] = lut_out[lrint(z * 65535)] * alpha + tp[2] * (1 - alpha);
+			int const a = get(op + 3);
+			if (a) {
+				float const alpha = a / alpha_divisor;
+
+				/* Convert sRGB to XYZ; op is BGRA.  First, input gamma LUT */
+				double const r = lut_in[get(op + red) / value_divisor];
+				double const g = lut_in[get(op + 1) / value_divisor];
+				double const b = lut_in[get(op + blue) / value_divisor];
+
+				/* RGB to XYZ, including Bradford transform and DCI companding */
+				double const x = max(0.0, min(1.0, r * fast_matrix[0] + g * fast_matrix[1] + b * fast_matrix[2]));
+				double const y = max(0.0, min(1.0, r * fast_matrix[3] + g * fast_matrix[4] + b * fast_matrix[5]));
+				double const z = max(0.0, min(1.0, r * fast_matrix[6] + g * fast_matrix[7] + b * fast_matrix[8]));
+
+				/* Out gamma LUT and blend */
+				tp[0] = lut_out[lrint(x * 65535)] * alpha + tp[0] * (1 - alpha);
+				tp[1] = lut_out[lrint(y * 65535)] * alpha + tp[1] * (1 - alpha);
+				tp[2] = lut_out[lrint(z * 65535)] * alpha + tp[2] * (1 - alpha);
+			}
 
 			tp += target.bpp / 2;
 			op += other.bpp / sizeof(OtherType);
@@ -786,106 +1005,44 @@ alpha_blend_onto_xyz12le(TargetParams const& target, OtherParams const& other, i
 }
 
 
-static
-void
-alpha_blend_onto_yuv420p(TargetParams const& target, OtherParams const& other, uint8_t* const* alpha_data, int const* alpha_stride)
+/** Blend an RGBA image, which has already been converted to the target's format, onto a planar YUV image.
+ *  @param alpha_data Data of the original image, which is used for its alpha channel.
+ *  @param alpha_stride Strides of the original image.
+ */
+template <AVPixelFormat F>
+static void
+alpha_blend_onto_planar_yuv(TargetParams const& target, OtherParams const& other, uint8_t* const* alpha_data, int const* alpha_stride)
 {
-	auto const ts = target.size;
-	auto const os = other.size;
-	for (int ty = target.start_y, oy = other.start_y; ty < ts.height && oy < os.height; ++ty, ++oy) {
-		int const hty = ty / 2;
-		int const hoy = oy / 2;
-		uint8_t* tY = target.data[0] + (ty * target.stride[0]) + target.start_x;
-		uint8_t* tU = target.data[1] + (hty * target.stride[1]) + target.start_x / 2;
-		uint8_t* tV = target.data[2] + (hty * target.stride[2]) + target.start_x / 2;
-		uint8_t* oY = other.data[0] + (oy * other.stride[0]) + other.start_x;
-		uint8_t* oU = other.data[1] + (hoy * other.stride[1]) + other.start_x / 2;
-		uint8_t* oV = other.data[2] + (hoy * other.stride[2]) + other.start_x / 2;
-		uint8_t* alpha = alpha_data[0] + (oy * alpha_stride[0]) + other.start_x * 4;
-		for (int tx = target.start_x, ox = other.start_x; tx < ts.width && ox < os.width; ++tx, ++ox) {
-			float const a = float(alpha[3]) / 255;
-			*tY = *oY * a + *tY * (1 - a);
-			*tU = *oU * a + *tU * (1 - a);
-			*tV = *oV * a + *tV * (1 - a);
-			++tY;
-			++oY;
-			if (tx % 2) {
-				++tU;
-				++tV;
-			}
-			if (ox % 2) {
-				++oU;
-				++oV;
-			}
-			alpha += 4;
-		}
-	}
-}
-
+	typedef PixelFormatTraits<F> Traits;
+	typedef typename Traits::Sample Sample;
+	int const chroma_step = 1 << Traits::log2_chroma_width;
 
-static
-void
-alpha_blend_onto_yuv420p10(TargetParams const& target, OtherParams const& other, uint8_t* const* alpha_data, int const* alpha_stride)
-{
 	auto const ts = target.size;
 	auto const os = other.size;
 	for (int ty = target.start_y, oy = other.start_y; ty < ts.height && oy < os.height; ++ty, ++oy) {
-		int const hty = ty / 2;
-		int const hoy = oy / 2;
-		uint16_t* tY = reinterpret_cast<uint16_t*>(target.data[0] + (ty * target.stride[0])) + target.start_x;
-		uint16_t* tU = reinterpret_cast<uint16_t*>(target.data[1] + (hty * target.stride[1])) + target.start_x / 2;
-		uint16_t* tV = reinterpret_cast<uint16_t*>(target.data[2] + (hty * target.stride[2])) + target.start_x / 2;
-		uint16_t* oY = reinterpret_cast<uint16_t*>(other.data[0] + (oy * other.stride[0])) + other.start_x;
-		uint16_t* oU = reinterpret_cast<uint16_t*>(other.data[1] + (hoy * other.stride[1])) + other.start_x / 2;
-		uint16_t* oV = reinterpret_cast<uint16_t*>(other.data[2] + (hoy * other.stride[2])) + other.start_x / 2;
+		int const hty = ty >> Traits::log2_chroma_height;
+		int const hoy = oy >> Traits::log2_chroma_height;
+		auto tY = reinterpret_cast<Sample*>(target.data[0] + (ty * target.stride[0])) + target.start_x;
+		auto tU = reinterpret_cast<Sample*>(target.data[1] + (hty * target.stride[1])) + (target.start_x >> Traits::log2_chroma_width);
+		auto tV = reinterpret_cast<Sample*>(target.data[2] + (hty * target.stride[2])) + (target.start_x >> Traits::log2_chroma_width);
+		auto oY = reinterpret_cast<Sample*>(other.data[0] + (oy * other.stride[0])) + other.start_x;
+		auto oU = reinterpret_cast<Sample*>(other.data[1] + (hoy * other.stride[1])) + (other.start_x >> Traits::log2_chroma_width);
+		auto oV = reinterpret_cast<Sample*>(other.data[2] + (hoy * other.stride[2])) + (other.start_x >> Traits::log2_chroma_width);
 		uint8_t* alpha = alpha_data[0] + (oy * alpha_stride[0]) + other.start_x * 4;
 		for (int tx = target.start_x, ox = other.start_x; tx < ts.width && ox < os.width; ++tx, ++ox) {
-			float const a = float(alpha[3]) / 255;
-			*tY = *oY * a + *tY * (1 - a);
-			*tU = *oU * a + *tU * (1 - a);
-			*tV = *oV * a + *tV * (1 - a);
-			++tY;
-			++oY;
-			if (tx % 2) {
-				++tU;
-				++tV;
+			if (alpha[3]) {
+				float const a = float(alpha[3]) / 255;
+				*tY = *oY * a + *tY * (1 - a);
+				*tU = *oU * a + *tU * (1 - a);
+				*tV = *oV * a + *tV * (1 - a);
 			}
-			if (ox % 2) {
-				++oU;
-				++oV;
-			}
-			alpha += 4;
-		}
-	}
-}
-
-
-static
-void
-alpha_blend_onto_yuv422p10le(TargetParams const& target, OtherParams const& other, uint8_t* const* alpha_data, int const* alpha_stride)
-{
-	auto const ts = target.size;
-	auto const os = other.size;
-	for (int ty = target.start_y, oy = other.start_y; ty < ts.height && oy < os.height; ++ty, ++oy) {
-		uint16_t* tY = reinterpret_cast<uint16_t*>(target.data[0] + (ty * target.stride[0])) + target.start_x;
-		uint16_t* tU = reinterpret_cast<uint16_t*>(target.data[1] + (ty * target.stride[1])) + target.start_x / 2;
-		uint16_t* tV = reinterpret_cast<uint16_t*>(target.data[2] + (ty * target.stride[2])) + target.start_x / 2;
-		uint16_t* oY = reinterpret_cast<uint16_t*>(other.data[0] + (oy * other.stride[0])) + other.start_x;
-		uint16_t* oU = reinterpret_cast<uint16_t*>(other.data[1] + (oy * other.stride[1])) + other.start_x / 2;
-		uint16_t* oV = reinterpret_cast<uint16_t*>(other.data[2] + (oy * other.stride[2])) + other.start_x / 2;
-		uint8_t* alpha = alpha_data[0] + (oy * alpha_stride[0]) + other.start_x * 4;
-		for (int tx = target.start_x, ox = other.start_x; tx < ts.width && ox < os.width; ++tx, ++ox) {
-			float const a = float(alpha[3]) / 255;
-			*tY = *oY * a + *tY * (1 - a);
-			*tU = *oU * a + *tU * (1 - a);
-			*tV = *oV * a + *tV * (1 - a);
 			++tY;
 			++oY;
-			if (tx % 2) {
+			if (((tx + 1) % chroma_step) == 0) {
 				++tU;
 				++tV;
 			}
-			if (ox % 2) {
+			if (((ox + 1) % chroma_step) == 0) {
 				++oU;
 				++oV;
 			}
@@ -995,7 +1152,7 @@ Image::alpha_blend (shared_ptr<const Image> other, Position<int> position)
 		auto yuv = other->convert_pixel_format (dcp::YUVToRGB::REC709, _pixel_format, Alignment::COMPACT, false);
 		other_params.data = yuv->data();
 		other_params.stride = yuv->stride();
-		alpha_blend_onto_yuv420p(target_params, other_params, other->data(), other->stride());
+		alpha_blend_onto_planar_yuv<AV_PIX_FMT_YUV420P>(target_params, other_params, other->data(), other->stride());
 		break;
 	}
 	case AV_PIX_FMT_YUV420P10:
@@ -1003,7 +1160,7 @@ Image::alpha_blend (shared_ptr<const Image> other, Position<int> position)
 		auto yuv = other->convert_pixel_format (dcp::YUVToRGB::REC709, _pixel_format, Alignment::COMPACT, false);
 		other_params.data = yuv->data();
 		other_params.stride = yuv->stride();
-		alpha_blend_onto_yuv420p10(target_params, other_params, other->data(), other->stride());
+		alpha_blend_onto_planar_yuv<AV_PIX_FMT_YUV420P10>(target_params, other_params, other->data(), other->stride());
 		break;
 	}
 	case AV_PIX_FMT_YUV422P10LE:
@@ -1011,7 +1168,7 @@ Image::alpha_blend (shared_ptr<const Image> other, Position<int> position)
 		auto yuv = other->convert_pixel_format (dcp::YUVToRGB::REC709, _pixel_format, Alignment::COMPACT, false);
 		other_params.data = yuv->data();
 		other_params.stride = yuv->stride();
-		alpha_blend_onto_yuv422p10le(target_params, other_params, other->data(), other->stride());
+		alpha_blend_onto_planar_yuv<AV_PIX_FMT_YUV422P10LE>(target_params, other_params, other->data(), other->stride());
 		break;
 	}
 	default:
@@ -1036,30 +1193,119 @@ Image::copy (shared_ptr<const Image> other, Position<int> position)
 }
 
 
+/** Read this image's data from a socket, as written by write_to_socket().
+ *  @param compression Compression that the sender used.
+ */
 void
-Image::read_from_socket (shared_ptr<Socket> socket)
+Image::read_from_socket (shared_ptr<Socket> socket, TransportCompression compression)
 {
-	for (int i = 0; i < planes(); ++i) {
-		uint8_t* p = data()[i];
-		int const lines = sample_size(i).height;
-		for (int y = 0; y < lines; ++y) {
-			socket->read (p, line_size()[i]);
-			p += stride()[i];
+	switch (compression) {
+	case TransportCompression::NONE:
+	{
+		/* Read the whole image in one go, straight into our planes */
+		vector<boost::asio::mutable_buffer> buffers;
+		for (int i = 0; i < planes(); ++i) {
+			uint8_t* p = data()[i];
+			int const lines = sample_size(i).height;
+			if (stride()[i] == line_size()[i]) {
+				buffers.push_back(boost::asio::buffer(p, static_cast<size_t>(line_size()[i]) * lines));
+			} else {
+				for (int y = 0; y < lines; ++y) {
+					buffers.push_back(boost::asio::buffer(p, line_size()[i]));
+					p += stride()[i];
+				}
+			}
 		}
+		socket->read(buffers);
+		break;
+	}
+	case TransportCompression::ZSTD:
+	{
+#ifdef DCPOMATIC_HAVE_ZSTD
+		vector<uint8_t> compressed;
+		vector<uint8_t> plane;
+		for (int i = 0; i < planes(); ++i) {
+			int const lines = sample_size(i).height;
+			compressed.resize(socket->read_uint32());
+			socket->read (compressed.data(), compressed.size());
+			plane.resize(static_cast<size_t>(line_size()[i]) * lines);
+			auto const size = ZSTD_decompress(plane.data(), plane.size(), compressed.data(), compressed.size());
+			if (ZSTD_isError(size) || size != plane.size()) {
+				throw NetworkError ("Could not decompress image data");
+			}
+			uint8_t* p = data()[i];
+			uint8_t const* q = plane.data();
+			for (int y = 0; y < lines; ++y) {
+				memcpy (p, q, line_size()[i]);
+				p += stride()[i];
+				q += line_size()[i];
+			}
+		}
+#else
+		throw NetworkError ("Received compressed image data, but this build cannot decompress it");
+#endif
+		break;
+	}
 	}
 }
 
 
+/** Write this image's data to a socket.
+ *  @param compression Compression to use; the receiver must be told about this so that
+ *  it can pass the same value to read_from_socket().
+ */
 void
-Image::write_to_socket (shared_ptr<Socket> socket) const
+Image::write_to_socket (shared_ptr<Socket> socket, TransportCompression compression) const
 {
-	for (int i = 0; i < planes(); ++i) {
-		uint8_t* p = data()[i];
-		int const lines = sample_size(i).height;
-		for (int y = 0; y < lines; ++y) {
-			socket->write (p, line_size()[i]);
-			p += stride()[i];
+	switch (compression) {
+	case TransportCompression::NONE:
+	{
+		/* Send the whole image with one call, leaving out any padding at the ends of lines */
+		vector<boost::asio::const_buffer> buffers;
+		for (int i = 0; i < planes(); ++i) {
+			uint8_t const* p = data()[i];
+			int const lines = sample_size(i).height;
+			if (stride()[i] == line_size()[i]) {
+				buffers.push_back(boost::asio::buffer(p, static_cast<size_t>(line_size()[i]) * lines));
+			} else {
+				for (int y = 0; y < lines; ++y) {
+					buffers.push_back(boost::asio::buffer(p, line_size()[i]));
+					p += stride()[i];
+				}
+			}
+		}
+		socket->write(buffers);
+		break;
+	}
+	case TransportCompression::ZSTD:
+	{
+#ifdef DCPOMATIC_HAVE_ZSTD
+		vector<uint8_t> plane;
+		vector<uint8_t> compressed;
+		for (int i = 0; i < planes(); ++i) {
+			int const lines = sample_size(i).height;
+			plane.resize(static_cast<size_t>(line_size()[i]) * lines);
+			uint8_t const* p = data()[i];
+			uint8_t* q = plane.data();
+			for (int y = 0; y < lines; ++y) {
+				memcpy (q, p, line_size()[i]);
+				p += stride()[i];
+				q += line_size()[i];
+			}
+			compressed.resize(ZSTD_compressBound(plane.size()));
+			/* Level 1 is the fastest; we want to spend as little time as possible here */
+			auto const size = ZSTD_compress(compressed.data(), compressed.size(), plane.data(), plane.size(), 1);
+			if (ZSTD_isError(size)) {
+				throw NetworkError ("Could not compress image data");
+			}
+			socket->write (static_cast<uint32_t>(size));
+			socket->write (compressed.data(), size);
 		}
+#else
+		DCPOMATIC_ASSERT (false);
+#endif
+		break;
+	}
 	}
 }
 
@@ -1130,13 +1376,8 @@ Image::Image (AVPixelFormat p, dcp::Size s, Alignment alignment)
 void
 Image::allocate ()
 {
-	_data = (uint8_t **) wrapped_av_malloc (4 * sizeof (uint8_t *));
 	_data[0] = _data[1] = _data[2] = _data[3] = 0;
-
-	_line_size = (int *) wrapped_av_malloc (4 * sizeof (int));
 	_line_size[0] = _line_size[1] = _line_size[2] = _line_size[3] = 0;
-
-	_stride = (int *) wrapped_av_malloc (4 * sizeof (int));
 	_stride[0] = _stride[1] = _stride[2] = _stride[3] = 0;
 
 	auto stride_round_up = [](int stride, int t) {
@@ -1185,17 +1426,25 @@ Image::allocate ()
 		   |XXXwrittenXXX|<------line-size------------->|XXXwrittenXXXXXXwrittenXXX
 		                                                               ^^^^ out of bounds
 		*/
-		_data[i] = (uint8_t *) wrapped_av_malloc (_stride[i] * (sample_size(i).height + 1) + ALIGNMENT);
+		_data[i] = static_cast<uint8_t*>(ImageBufferPool::instance()->get(plane_allocation_size(i)));
 #if HAVE_VALGRIND_MEMCHECK_H
 		/* The data between the end of the line size and the stride is undefined but processed by
 		   libswscale, causing lots of valgrind errors.  Mark it all defined to quell these errors.
 		*/
-		VALGRIND_MAKE_MEM_DEFINED (_data[i], _stride[i] * (sample_size(i).height + 1) + ALIGNMENT);
+		VALGRIND_MAKE_MEM_DEFINED (_data[i], plane_allocation_size(i));
 #endif
 	}
 }
 
 
+/** @return Number of bytes that allocate() allocates for a plane; see the comment there */
+size_t
+Image::plane_allocation_size (int plane) const
+{
+	return _stride[plane] * (sample_size(plane).height + 1) + ALIGNMENT;
+}
+
+
 Image::Image (Image const & other)
 	: std::enable_shared_from_this<Image>(other)
 	, _size (other._size)
@@ -1293,12 +1542,8 @@ Image::swap (Image & other)
 Image::~Image ()
 {
 	for (int i = 0; i < planes(); ++i) {
-		av_free (_data[i]);
+		ImageBufferPool::instance()->put(_data[i], plane_allocation_size(i));
 	}
-
-	av_free (_data);
-	av_free (_line_size);
-	av_free (_stride);
 }
 
 
@@ -1337,6 +1582,29 @@ Image::alignment () const
 }
 
 
+/** @return true if this image's memory is laid out as it would be if it had been
+ *  created with the given alignment.  A COMPACT image whose lines happen to be a multiple
+ *  of ALIGNMENT bytes long is the same in memory as the PADDED version, and vice versa.
+ */
+bool
+Image::has_layout_of (Alignment alignment) const
+{
+	if (alignment == _alignment) {
+		return true;
+	}
+
+	for (int i = 0; i < planes(); ++i) {
+		if (alignment == Alignment::COMPACT && _stride[i] != _line_size[i]) {
+			return false;
+		} else if (alignment == Alignment::PADDED && (_stride[i] % ALIGNMENT) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 PositionImage
 merge (list<PositionImage> images, Image::Alignment alignment)
 {
@@ -1396,131 +1664,130 @@ operator== (Image const & a, Image const & b)
 /** Fade the image.
  *  @param f Amount to fade by; 0 is black, 1 is no fade.
  */
-void
-Image::fade (float f)
+/** @return a look-up table with an entry for every possible value of T
+ *  @param f Function to give the table entry for a value.
+ */
+template <class T>
+static vector<T>
+make_lut (std::function<int (int)> f)
 {
-	/* U/V black value for 8-bit colour */
-	static int const eight_bit_uv =    (1 << 7) - 1;
-	/* U/V black value for 10-bit colour */
-	static uint16_t const ten_bit_uv = (1 << 9) - 1;
+	vector<T> lut(std::numeric_limits<T>::max() + 1);
+	for (size_t i = 0; i < lut.size(); ++i) {
+		lut[i] = f(i);
+	}
+	return lut;
+}
 
-	switch (_pixel_format) {
-	case AV_PIX_FMT_YUV420P:
-	{
-		/* Y */
-		uint8_t* p = data()[0];
-		int const lines = sample_size(0).height;
-		for (int y = 0; y < lines; ++y) {
-			uint8_t* q = p;
-			for (int x = 0; x < line_size()[0]; ++x) {
-				*q = int(float(*q) * f);
-				++q;
-			}
-			p += stride()[0];
-		}
 
-		/* U, V */
-		for (int c = 1; c < 3; ++c) {
-			uint8_t* p = data()[c];
-			int const lines = sample_size(c).height;
-			for (int y = 0; y < lines; ++y) {
-				uint8_t* q = p;
-				for (int x = 0; x < line_size()[c]; ++x) {
-					*q = eight_bit_uv + int((int(*q) - eight_bit_uv) * f);
-					++q;
-				}
-				p += stride()[c];
-			}
+/** Replace every sample in one plane of an image with its entry in a look-up table.
+ *  @param in Image to read from.
+ *  @param out Image to write to, which may be the same as in, and must have the same format and size.
+ */
+template <class T>
+static void
+apply_lut (Image const& in, Image& out, int plane, vector<T> const& lut)
+{
+	int const lines = in.sample_size(plane).height;
+	int const samples = in.line_size()[plane] / sizeof(T);
+	auto const table = lut.data();
+	auto p = in.data()[plane];
+	auto q = out.data()[plane];
+	for (int y = 0; y < lines; ++y) {
+		auto from = reinterpret_cast<T const*>(p);
+		auto to = reinterpret_cast<T*>(q);
+		for (int x = 0; x < samples; ++x) {
+			to[x] = table[from[x]];
 		}
+		p += in.stride()[plane];
+		q += out.stride()[plane];
+	}
+}
+
+
+template <class T>
+static void
+apply_lut (Image& image, int plane, vector<T> const& lut)
+{
+	apply_lut(image, image, plane, lut);
+}
 
+
+/** Fade a planar YUV image towards black */
+template <AVPixelFormat F>
+static void
+fade_planar_yuv (Image const& in, Image& out, float f)
+{
+	typedef PixelFormatTraits<F> Traits;
+	typedef typename Traits::Sample Sample;
+	static_assert (!Traits::big_endian, "fade_planar_yuv only works on little-endian samples");
+
+	int const black = Traits::black_uv;
+	apply_lut(in, out, 0, make_lut<Sample>([f](int v) { return int(float(v) * f); }));
+	auto const uv = make_lut<Sample>([f, black](int v) { return black + int((v - black) * f); });
+	apply_lut(in, out, 1, uv);
+	apply_lut(in, out, 2, uv);
+}
+
+
+/** Write a faded version of in to out, which may be the same image */
+static void
+fade_image (Image const& in, Image& out, float f)
+{
+	switch (in.pixel_format()) {
+	case AV_PIX_FMT_YUV420P:
+		fade_planar_yuv<AV_PIX_FMT_YUV420P>(in, out, f);
 		break;
-	}
 
 	case AV_PIX_FMT_RGB24:
-	{
-		/* 8-bit */
-		uint8_t* p = data()[0];
-		int const lines = sample_size(0).height;
-		for (int y = 0; y < lines; ++y) {
-			uint8_t* q = p;
-			for (int x = 0; x < line_size()[0]; ++x) {
-				*q = int (float (*q) * f);
-				++q;
-			}
-			p += stride()[0];
-		}
+	case AV_PIX_FMT_BGRA:
+		/* 8-bit; BGRA images come from Cairo with pre-multiplied alpha so all
+		 * four components can be scaled in the same way.
+		 */
+		apply_lut(in, out, 0, make_lut<uint8_t>([f](int v) { return int(float(v) * f); }));
 		break;
-	}
 
 	case AV_PIX_FMT_XYZ12LE:
 	case AV_PIX_FMT_RGB48LE:
 		/* 16-bit little-endian */
-		for (int c = 0; c < 3; ++c) {
-			int const stride_pixels = stride()[c] / 2;
-			int const line_size_pixels = line_size()[c] / 2;
-			uint16_t* p = reinterpret_cast<uint16_t*> (data()[c]);
-			int const lines = sample_size(c).height;
-			for (int y = 0; y < lines; ++y) {
-				uint16_t* q = p;
-				for (int x = 0; x < line_size_pixels; ++x) {
-					*q = int (float (*q) * f);
-					++q;
-				}
-				p += stride_pixels;
-			}
-		}
+		apply_lut(in, out, 0, make_lut<uint16_t>([f](int v) { return int(float(v) * f); }));
 		break;
 
 	case AV_PIX_FMT_YUV422P10LE:
-	{
-		/* Y */
-		{
-			int const stride_pixels = stride()[0] / 2;
-			int const line_size_pixels = line_size()[0] / 2;
-			uint16_t* p = reinterpret_cast<uint16_t*> (data()[0]);
-			int const lines = sample_size(0).height;
-			for (int y = 0; y < lines; ++y) {
-				uint16_t* q = p;
-				for (int x = 0; x < line_size_pixels; ++x) {
-					*q = int(float(*q) * f);
-					++q;
-				}
-				p += stride_pixels;
-			}
-		}
-
-		/* U, V */
-		for (int c = 1; c < 3; ++c) {
-			int const stride_pixels = stride()[c] / 2;
-			int const line_size_pixels = line_size()[c] / 2;
-			uint16_t* p = reinterpret_cast<uint16_t*> (data()[c]);
-			int const lines = sample_size(c).height;
-			for (int y = 0; y < lines; ++y) {
-				uint16_t* q = p;
-				for (int x = 0; x < line_size_pixels; ++x) {
-					*q = ten_bit_uv + int((int(*q) - ten_bit_uv) * f);
-					++q;
-				}
-				p += stride_pixels;
-			}
-		}
+		fade_planar_yuv<AV_PIX_FMT_YUV422P10LE>(in, out, f);
 		break;
 
-	}
-
 	default:
-		throw PixelFormatError ("fade()", _pixel_format);
+		throw PixelFormatError ("fade()", in.pixel_format());
 	}
 }
 
 
+void
+Image::fade (float f)
+{
+	fade_image (*this, *this, f);
+}
+
+
+/** @return A faded copy of this image; this is quicker than copying and then calling fade() */
+shared_ptr<Image>
+Image::faded (float f) const
+{
+	auto out = make_shared<Image>(_pixel_format, _size, _alignment);
+	fade_image (*this, *out, f);
+	return out;
+}
+
+
 shared_ptr<const Image>
 Image::ensure_alignment (shared_ptr<const Image> image, Image::Alignment alignment)
 {
-	if (image->alignment() == alignment) {
+	if (image->has_layout_of(alignment)) {
 		return image;
 	}
 
+	/* Count these copies so that we can see if there are any left worth getting rid of */
+	TraceSpan span("ensure-alignment-copy", "image");
 	return make_shared<Image>(image, alignment);
 }
 
@@ -1542,49 +1809,30 @@ Image::video_range_to_full_range ()
 	switch (_pixel_format) {
 	case AV_PIX_FMT_RGB24:
 	{
-		float const factor = 256.0 / 219.0;
-		uint8_t* p = data()[0];
-		int const lines = sample_size(0).height;
-		for (int y = 0; y < lines; ++y) {
-			uint8_t* q = p;
-			for (int x = 0; x < line_size()[0]; ++x) {
-				*q = clamp(lrintf((*q - 16) * factor), 0L, 255L);
-				++q;
-			}
-			p += stride()[0];
-		}
+		static auto const lut = make_lut<uint8_t>([](int v) {
+			float const factor = 256.0 / 219.0;
+			return clamp(lrintf((v - 16) * factor), 0L, 255L);
+		});
+		apply_lut(*this, 0, lut);
 		break;
 	}
 	case AV_PIX_FMT_RGB48LE:
 	{
-		float const factor = 65536.0 / 56064.0;
-		uint16_t* p = reinterpret_cast<uint16_t*>(data()[0]);
-		int const lines = sample_size(0).height;
-		for (int y = 0; y < lines; ++y) {
-			uint16_t* q = p;
-			int const line_size_pixels = line_size()[0] / 2;
-			for (int x = 0; x < line_size_pixels; ++x) {
-				*q = clamp(lrintf((*q - 4096) * factor), 0L, 65535L);
-				++q;
-			}
-			p += stride()[0] / 2;
-		}
+		static auto const lut = make_lut<uint16_t>([](int v) {
+			float const factor = 65536.0 / 56064.0;
+			return clamp(lrintf((v - 4096) * factor), 0L, 65535L);
+		});
+		apply_lut(*this, 0, lut);
 		break;
 	}
 	case AV_PIX_FMT_GBRP12LE:
 	{
-		float const factor = 4096.0 / 3504.0;
+		static auto const lut = make_lut<uint16_t>([](int v) {
+			float const factor = 4096.0 / 3504.0;
+			return clamp(lrintf((v - 256) * factor), 0L, 4095L);
+		});
 		for (int c = 0; c < 3; ++c) {
-			uint16_t* p = reinterpret_cast<uint16_t*>(data()[c]);
-			int const lines = sample_size(c).height;
-			for (int y = 0; y < lines; ++y) {
-				uint16_t* q = p;
-				int const line_size_pixels = line_size()[c] / 2;
-				for (int x = 0; x < line_size_pixels; ++x) {
-					*q = clamp(lrintf((*q - 256) * factor), 0L, 4095L);
-					++q;
-				}
-			}
+			apply_lut(*this, c, lut);
 		}
 		break;
 	}
@@ -29,12 +29,14 @@
 #include "crop.h"
 #include "position.h"
 #include "position_image.h"
+#include "types.h"
 #include "video_range.h"
 extern "C" {
 #include <libavutil/pixfmt.h>
 }
 #include <dcp/array_data.h>
 #include <dcp/colour_conversion.h>
+#include <functional>
 
 
 struct AVFrame;
@@ -63,6 +65,7 @@ public:
 	int const * stride () const;
 	dcp::Size size () const;
 	Alignment alignment () const;
+	bool has_layout_of (Alignment alignment) const;
 
 	int planes () const;
 	int vertical_factor (int) const;
@@ -81,7 +84,8 @@ public:
 		AVPixelFormat out_format,
 		VideoRange out_video_range,
 		Alignment alignment,
-		bool fast
+		bool fast,
+		std::function<void (Image const&, int, int)> lines_ready = {}
 		) const;
 
 	void make_black ();
@@ -89,9 +93,10 @@ public:
 	void alpha_blend (std::shared_ptr<const Image> image, Position<int> pos);
 	void copy (std::shared_ptr<const Image> image, Position<int> pos);
 	void fade (float);
+	std::shared_ptr<Image> faded (float) const;
 
-	void read_from_socket (std::shared_ptr<Socket>);
-	void write_to_socket (std::shared_ptr<Socket>) const;
+	void read_from_socket (std::shared_ptr<Socket>, TransportCompression compression = TransportCompression::NONE);
+	void write_to_socket (std::shared_ptr<Socket>, TransportCompression compression = TransportCompression::NONE) const;
 
 	AVPixelFormat pixel_format () const {
 		return _pixel_format;
@@ -104,19 +109,19 @@ public:
 private:
 	friend struct pixel_formats_test;
 	friend struct make_part_black_test;
+	friend struct video_range_to_full_range_test;
 
 	void allocate ();
+	size_t plane_allocation_size (int plane) const;
 	void swap (Image &);
 	void make_part_black (int x, int w);
-	void yuv_16_black (uint16_t, bool);
-	static uint16_t swap_16 (uint16_t);
 	void video_range_to_full_range ();
 
 	dcp::Size _size;
 	AVPixelFormat _pixel_format; ///< FFmpeg's way of describing the pixel format of this Image
-	uint8_t** _data; ///< array of pointers to components
-	int* _line_size; ///< array of sizes of the data in each line, in bytes (without any alignment padding bytes)
-	int* _stride; ///< array of strides for each line, in bytes (including any alignment padding bytes)
+	uint8_t* _data[4]; ///< array of pointers to components
+	int _line_size[4]; ///< array of sizes of the data in each line, in bytes (without any alignment padding bytes)
+	int _stride[4]; ///< array of strides for each line, in bytes (including any alignment padding bytes)
 	Alignment _alignment;
 };
 
@@ -0,0 +1,183 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "cross.h"
+#include "image_buffer_pool.h"
+#include "memory_util.h"
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+extern "C" {
+#include <libavutil/mem.h>
+}
+LIBDCP_ENABLE_WARNINGS
+#include <boost/bind/bind.hpp>
+#include <algorithm>
+
+
+#if BOOST_VERSION >= 106100
+using namespace boost::placeholders;
+#endif
+
+
+/** Smallest buffer that we will try to allocate from huge pages */
+static size_t constexpr huge_page_size = 2 * 1024 * 1024;
+
+
+ImageBufferPool::ImageBufferPool()
+{
+	set_limit();
+	_config_connection = Config::instance()->Changed.connect(boost::bind(&ImageBufferPool::config_changed, this, _1));
+}
+
+
+ImageBufferPool::~ImageBufferPool()
+{
+	clear();
+}
+
+
+/** @return A buffer of at least `size' bytes, whose contents are undefined */
+void*
+ImageBufferPool::get(size_t size)
+{
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		auto i = _buffers.find(size);
+		if (i != _buffers.end() && !i->second.empty()) {
+			auto buffer = i->second.back();
+			i->second.pop_back();
+			_statistics.bytes_held -= size;
+			++_statistics.hits;
+			return buffer;
+		}
+		++_statistics.misses;
+
+		if (_huge_pages && size >= huge_page_size) {
+			if (auto buffer = allocate_huge_pages(size)) {
+				_huge_buffers.insert(buffer);
+				++_statistics.huge_page_allocations;
+				_statistics.huge_page_bytes += size;
+				return buffer;
+			}
+		}
+	}
+
+	return wrapped_av_malloc(size);
+}
+
+
+/** Free a buffer which came from either allocate_huge_pages() or av_malloc().
+ *  A lock must be held on _mutex.
+ */
+void
+ImageBufferPool::free_buffer(void* buffer, size_t size)
+{
+	auto huge = _huge_buffers.find(buffer);
+	if (huge != _huge_buffers.end()) {
+		_huge_buffers.erase(huge);
+		_statistics.huge_page_bytes -= size;
+		free_huge_pages(buffer, size);
+	} else {
+		av_free(buffer);
+	}
+}
+
+
+/** Return a buffer that was obtained from get() so that it can be re-used; if the
+ *  pool already holds Config::image_buffer_pool_size() worth of buffers it will
+ *  be freed instead.
+ *  @param size Size that was passed to get().
+ */
+void
+ImageBufferPool::put(void* buffer, size_t size)
+{
+	if (!buffer) {
+		return;
+	}
+
+	boost::mutex::scoped_lock lm(_mutex);
+	if (_statistics.bytes_held + size <= _limit) {
+		_buffers[size].push_back(buffer);
+		_statistics.bytes_held += size;
+		return;
+	}
+
+	++_statistics.discards;
+	free_buffer(buffer, size);
+}
+
+
+void
+ImageBufferPool::config_changed(Config::Property)
+{
+	set_limit();
+}
+
+
+void
+ImageBufferPool::set_limit()
+{
+	size_t const limit = static_cast<size_t>(std::max(0, Config::instance()->image_buffer_pool_size())) * 1024 * 1024;
+	bool const huge_pages = Config::instance()->image_huge_pages();
+
+	boost::mutex::scoped_lock lm(_mutex);
+	_limit = limit;
+	_huge_pages = huge_pages;
+	/* Free buffers until we are within the new limit */
+	for (auto i = _buffers.begin(); i != _buffers.end() && _statistics.bytes_held > _limit; ++i) {
+		while (!i->second.empty() && _statistics.bytes_held > _limit) {
+			free_buffer(i->second.back(), i->first);
+			i->second.pop_back();
+			_statistics.bytes_held -= i->first;
+		}
+	}
+}
+
+
+void
+ImageBufferPool::clear()
+{
+	boost::mutex::scoped_lock lm(_mutex);
+	for (auto& i: _buffers) {
+		for (auto j: i.second) {
+			free_buffer(j, i.first);
+		}
+	}
+	_buffers.clear();
+	_statistics.bytes_held = 0;
+}
+
+
+ImageBufferPool::Statistics
+ImageBufferPool::statistics() const
+{
+	boost::mutex::scoped_lock lm(_mutex);
+	return _statistics;
+}
+
+
+ImageBufferPool*
+ImageBufferPool::instance()
+{
+	/* This is never destroyed, since Images may be freed during static destruction */
+	static auto instance = new ImageBufferPool();
+	return instance;
+}
@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DCPOMATIC_IMAGE_BUFFER_POOL_H
+#define DCPOMATIC_IMAGE_BUFFER_POOL_H
+
+
+#include "config.h"
+#include <boost/signals2.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <set>
+#include <vector>
+
+
+/** @class ImageBufferPool
+ *  @brief A thread-safe pool of the buffers that Image uses for its planes.
+ *
+ *  Images are allocated and freed at a high rate during transcoding, and they are mostly
+ *  of the same few sizes.  Keeping the buffers for re-use saves the cost of getting them
+ *  back from the OS (and page-faulting them in again) each time.
+ *
+ *  If Config::image_huge_pages() is set, buffers of a huge page or more are allocated
+ *  from huge pages where the OS allows, so that large frames need fewer TLB entries and
+ *  page faults.
+ */
+class ImageBufferPool
+{
+public:
+	ImageBufferPool();
+	~ImageBufferPool();
+
+	ImageBufferPool(ImageBufferPool const&) = delete;
+	ImageBufferPool& operator=(ImageBufferPool const&) = delete;
+
+	void* get(size_t size);
+	void put(void* buffer, size_t size);
+
+	/** Free all unused buffers */
+	void clear();
+
+	struct Statistics
+	{
+		/** Number of get() calls which were satisfied by the pool */
+		int64_t hits = 0;
+		/** Number of get() calls which needed a new allocation */
+		int64_t misses = 0;
+		/** Number of buffers freed because the pool was full */
+		int64_t discards = 0;
+		/** Total size of unused buffers currently being kept */
+		size_t bytes_held = 0;
+		/** Number of buffers allocated from huge pages */
+		int64_t huge_page_allocations = 0;
+		/** Total size of buffers allocated from huge pages which have not been freed */
+		size_t huge_page_bytes = 0;
+	};
+
+	Statistics statistics() const;
+
+	static ImageBufferPool* instance();
+
+private:
+	void config_changed(Config::Property);
+	void set_limit();
+	void free_buffer(void* buffer, size_t size);
+
+	mutable boost::mutex _mutex;
+	/** Maximum total size of unused buffers to keep, in bytes */
+	size_t _limit = 0;
+	/** Unused buffers, keyed by size in bytes */
+	std::map<size_t, std::vector<void*>> _buffers;
+	/** true to allocate large buffers from huge pages */
+	bool _huge_pages = false;
+	/** Buffers (in use or not) which were allocated from huge pages */
+	std::set<void*> _huge_buffers;
+	Statistics _statistics;
+
+	boost::signals2::scoped_connection _config_connection;
+};
+
+
+#endif
@@ -20,6 +20,7 @@
 
 
 #include "compose.hpp"
+#include "digester.h"
 #include "exceptions.h"
 #include "film.h"
 #include "frame_rate_change.h"
@@ -30,8 +31,12 @@
 #include "util.h"
 #include "video_content.h"
 #include <libcxml/cxml.h>
+#include <dcp/file.h>
 #include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
 #include <libxml++/libxml++.h>
+#include <boost/algorithm/string.hpp>
+#include <ctime>
 #include <iostream>
 
 #include "i18n.h"
@@ -43,6 +48,8 @@ using std::make_shared;
 using std::shared_ptr;
 using std::string;
 using std::vector;
+using boost::optional;
+using dcp::raw_convert;
 using namespace dcpomatic;
 
 
@@ -110,22 +117,92 @@ ImageContent::as_xml (xmlpp::Node* node, bool with_paths) const
 }
 
 
+/** @return the image files in a directory, in no particular order.  The list is cached in the film's
+ *  directory and the cached version is used if the directory has not been modified since it was made.
+ */
+static
+vector<boost::filesystem::path>
+scan_directory (shared_ptr<const Film> film, boost::filesystem::path dir, shared_ptr<Job> job)
+{
+	boost::system::error_code ec;
+	auto const modified = dcp::filesystem::last_write_time(dir, ec);
+
+	optional<boost::filesystem::path> cache;
+	if (film && film->directory() && !ec) {
+		Digester digester;
+		digester.add (dir.string());
+		cache = film->dir("image_listings") / digester.get();
+	}
+
+	vector<boost::filesystem::path> paths;
+
+	if (cache && dcp::filesystem::exists(*cache)) {
+		auto const size = dcp::filesystem::file_size(*cache);
+		dcp::File f(*cache, "rb");
+		if (f && size > 0) {
+			string listing(size, '\0');
+			f.checked_read (&listing[0], size);
+			vector<string> lines;
+			boost::split (lines, listing, boost::is_any_of("\n"));
+			if (lines.size() > 1 && lines[0] == raw_convert<string>(modified)) {
+				for (size_t i = 1; i < lines.size(); ++i) {
+					if (!lines[i].empty()) {
+						paths.push_back (dir / lines[i]);
+					}
+				}
+				return paths;
+			}
+		}
+	}
+
+	vector<boost::filesystem::path> candidates;
+	int n = 0;
+	for (auto i: dcp::filesystem::directory_iterator(dir)) {
+		if (valid_image_file(i.path())) {
+			candidates.push_back (i.path());
+		}
+		++n;
+		if ((n % 1000) == 0) {
+			job->set_progress_unknown ();
+		}
+	}
+
+	/* This means a stat() for each file, which can be slow on network filesystems */
+	vector<uint8_t> regular(candidates.size());
+	parallel_for (candidates.size(), [&candidates, &regular](size_t i) {
+		regular[i] = dcp::filesystem::is_regular_file(candidates[i]);
+	});
+
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (regular[i]) {
+			paths.push_back (candidates[i]);
+		}
+	}
+
+	/* Don't cache if the directory was modified very recently, as it might be modified again
+	 * without its modification time changing.
+	 */
+	if (cache && modified < (time(nullptr) - 1)) {
+		string listing = raw_convert<string>(modified) + "\n";
+		for (auto const& i: paths) {
+			listing += i.filename().string() + "\n";
+		}
+		dcp::File f(*cache, "wb");
+		if (f) {
+			f.checked_write (listing.c_str(), listing.length());
+		}
+	}
+
+	return paths;
+}
+
+
 void
 ImageContent::examine (shared_ptr<const Film> film, shared_ptr<Job> job)
 {
 	if (_path_to_scan) {
 		job->sub (_("Scanning image files"));
-		vector<boost::filesystem::path> paths;
-		int n = 0;
-		for (auto i: dcp::filesystem::directory_iterator(*_path_to_scan)) {
-			if (dcp::filesystem::is_regular_file(i.path()) && valid_image_file(i.path())) {
-				paths.push_back (i.path());
-			}
-			++n;
-			if ((n % 1000) == 0) {
-				job->set_progress_unknown ();
-			}
-		}
+		auto paths = scan_directory (film, *_path_to_scan, job);
 
 		if (paths.empty()) {
 			throw FileError (_("No valid image files were found in the folder."), *_path_to_scan);
@@ -19,10 +19,14 @@
 */
 
 
+#include "config.h"
+#include "cross.h"
+#include "dcpomatic_log.h"
 #include "exceptions.h"
 #include "ffmpeg_image_proxy.h"
 #include "film.h"
 #include "frame_interval_checker.h"
+#include "frame_prefetcher.h"
 #include "image.h"
 #include "image_content.h"
 #include "image_decoder.h"
@@ -30,24 +34,131 @@
 #include "util.h"
 #include "video_content.h"
 #include "video_decoder.h"
+#include <dcp/file.h>
+#include <dcp/filesystem.h>
 #include <boost/filesystem.hpp>
+#include <algorithm>
 #include <iostream>
+#ifdef DCPOMATIC_LINUX
+#include <fcntl.h>
+#endif
 
 #include "i18n.h"
 
 
 using std::cout;
 using std::make_shared;
+using std::max;
+using std::min;
 using std::shared_ptr;
 using dcp::Size;
 using namespace dcpomatic;
 
 
+/** Most frames that we will read ahead, however small they are */
+static int constexpr maximum_read_ahead_frames = 64;
+
+
+/** Reader for FramePrefetcher which reads whole files from an image sequence */
+class ImageFileReader
+{
+public:
+	/** @param advise Number of files after each one that is read to ask the OS to start reading */
+	explicit ImageFileReader (shared_ptr<const ImageContent> content, int advise = 0)
+		: _content (content)
+		, _advise (advise)
+	{}
+
+	shared_ptr<const dcp::ArrayData> get_frame (int64_t index) const
+	{
+		advise (index);
+
+		auto const path = _content->path(index);
+		auto const size = dcp::filesystem::file_size(path);
+
+		dcp::File file(path, "rb");
+		if (!file) {
+			throw OpenFileError (path, errno, OpenFileError::READ);
+		}
+
+#ifdef DCPOMATIC_LINUX
+		/* We read each file once, from start to finish, and never again */
+		posix_fadvise (fileno(file.get()), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+		auto data = make_shared<dcp::ArrayData>(size);
+		file.checked_read (data->data(), size);
+
+#ifdef DCPOMATIC_LINUX
+		/* ...so there's no point in it pushing other things out of the page cache */
+		posix_fadvise (fileno(file.get()), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+
+		return data;
+	}
+
+private:
+	/** Ask the OS to start reading the files after index, so that the storage has a queue of
+	 *  reads to get on with rather than just the one that we are waiting for.
+	 */
+	void advise (int64_t index) const
+	{
+		if (_advise == 0) {
+			return;
+		}
+
+		if (index != _last_index + 1) {
+			/* We've been seeked, so start again */
+			_advised_to = 0;
+		}
+		_last_index = index;
+
+		auto const to = min(index + 1 + _advise, static_cast<int64_t>(_content->number_of_paths()));
+		for (auto i = max(index + 1, _advised_to); i < to; ++i) {
+			try {
+				auto const path = _content->path(i);
+				dcp::File file(path, "rb");
+				if (file) {
+					advise_read_ahead (file.get(), 0, dcp::filesystem::file_size(path));
+				}
+			} catch (...) {
+				/* This was only a hint */
+			}
+		}
+
+		_advised_to = max(_advised_to, to);
+	}
+
+	shared_ptr<const ImageContent> _content;
+	int _advise;
+	/** Index of the last file that get_frame() was asked for */
+	mutable int64_t _last_index = -1;
+	/** Index of the file after the last one that we have advised the OS about */
+	mutable int64_t _advised_to = 0;
+};
+
+
 ImageDecoder::ImageDecoder (shared_ptr<const Film> film, shared_ptr<const ImageContent> c)
 	: Decoder (film)
 	, _image_content (c)
 {
 	video = make_shared<VideoDecoder>(this, c);
+
+	if (!c->still() && c->number_of_paths() > 1) {
+		/* Work out how many files to read ahead, so that slow storage doesn't hold us up */
+		int read_ahead = 0;
+		auto const read_ahead_bytes = static_cast<int64_t>(Config::instance()->image_read_ahead()) * 1024 * 1024;
+		if (read_ahead_bytes > 0) {
+			try {
+				auto const frame_size = max(static_cast<int64_t>(1), static_cast<int64_t>(dcp::filesystem::file_size(c->path(0))));
+				read_ahead = min(static_cast<int64_t>(maximum_read_ahead_frames), max(static_cast<int64_t>(1), read_ahead_bytes / frame_size));
+			} catch (...) {
+				/* Never mind; we just won't read ahead */
+			}
+		}
+
+		_reader = make_shared<FramePrefetcher<ImageFileReader, dcp::ArrayData>>(make_shared<ImageFileReader>(c, read_ahead), c->number_of_paths(), read_ahead);
+	}
 }
 
 
@@ -61,7 +172,21 @@ ImageDecoder::pass ()
 	if (!_image_content->still() || !_image) {
 		/* Either we need an image or we are using moving images, so load one */
 		auto path = _image_content->path (_image_content->still() ? 0 : _frame_video_position);
-		if (valid_j2k_file (path)) {
+
+		shared_ptr<const dcp::ArrayData> data;
+		try {
+			data = _reader ? _reader->get(_frame_video_position) : ImageFileReader(_image_content).get_frame(0);
+		} catch (std::exception& e) {
+			if (!_image) {
+				throw;
+			}
+			/* Carry on with the previous image rather than give up on the whole sequence */
+			LOG_WARNING ("Could not read image %1 (%2); using the previous one instead", path.string(), e.what());
+		}
+
+		if (!data) {
+			/* Use the last image again */
+		} else if (valid_j2k_file (path)) {
 			AVPixelFormat pf;
 			if (_image_content->video->colour_conversion()) {
 				/* We have a specified colour conversion: assume the image is RGB */
@@ -73,9 +198,18 @@ ImageDecoder::pass ()
 			/* We can't extract image size from a JPEG2000 codestream without decoding it,
 			   so pass in the image content's size here.
 			*/
-			_image = make_shared<J2KImageProxy>(path, _image_content->video->size(), pf);
+			_image = make_shared<J2KImageProxy>(*data, _image_content->video->size(), pf);
 		} else {
-			_image = make_shared<FFmpegImageProxy>(path);
+			if (!_image_content->still() && !_codec_probed) {
+				/* Find the codec once so that the proxies for the rest of the sequence needn't probe */
+				try {
+					_codec = FFmpegImageProxy::probe_codec (*data);
+				} catch (...) {
+					/* The proxy can report the problem when it comes to decode */
+				}
+				_codec_probed = true;
+			}
+			_image = make_shared<FFmpegImageProxy>(*data, path, _codec);
 		}
 	}
 
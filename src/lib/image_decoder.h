@@ -21,11 +21,23 @@
 
 #include "decoder.h"
 #include "types.h"
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+LIBDCP_ENABLE_WARNINGS
+#include <boost/optional.hpp>
 
 
 class ImageContent;
+class ImageFileReader;
 class Log;
 class ImageProxy;
+template <class Reader, class Frame> class FramePrefetcher;
+namespace dcp {
+	class ArrayData;
+}
 
 
 class ImageDecoder : public Decoder
@@ -45,4 +57,9 @@ private:
 	std::shared_ptr<const ImageContent> _image_content;
 	std::shared_ptr<ImageProxy> _image;
 	Frame _frame_video_position = 0;
+	/** Reads the files of a moving image sequence ahead of _frame_video_position */
+	std::shared_ptr<FramePrefetcher<ImageFileReader, dcp::ArrayData>> _reader;
+	/** Codec for the images in a moving sequence, if they can be decoded without probing */
+	boost::optional<AVCodecID> _codec;
+	bool _codec_probed = false;
 };
@@ -22,6 +22,7 @@
 #include "compose.hpp"
 #include "config.h"
 #include "cross.h"
+#include "dcpomatic_log.h"
 #include "exceptions.h"
 #include "ffmpeg_image_proxy.h"
 #include "film.h"
@@ -29,10 +30,12 @@
 #include "image_content.h"
 #include "image_examiner.h"
 #include "job.h"
+#include <dcp/file.h>
 #include <dcp/openjpeg_image.h>
 #include <dcp/exceptions.h>
 #include <dcp/filesystem.h>
 #include <dcp/j2k_transcode.h>
+#include <algorithm>
 #include <iostream>
 
 #include "i18n.h"
@@ -42,15 +45,99 @@ using std::cout;
 using std::list;
 using std::shared_ptr;
 using std::sort;
+using std::string;
+using std::vector;
 using boost::optional;
 
 
+static
+uint32_t
+read_uint32 (uint8_t const* p, bool big_endian)
+{
+	if (big_endian) {
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+	}
+	return (uint32_t(p[3]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+}
+
+
+/** Try to find the size of an image by looking only at the start of the file, without decoding it.
+ *  This is possible for JPEG2000 (raw codestreams and JP2) and DPX files.
+ *  @return size, or an empty optional if we couldn't find it this way.
+ */
+static
+optional<dcp::Size>
+size_from_header (boost::filesystem::path path)
+{
+	/* Enough to get past the boxes before the codestream in JP2 files */
+	int constexpr max_header = 65536;
+
+	dcp::File f(path, "rb");
+	if (!f) {
+		return {};
+	}
+
+	vector<uint8_t> header(max_header);
+	auto const got = f.read(header.data(), 1, max_header);
+	header.resize(got);
+
+	if (valid_j2k_file(path)) {
+		/* Look for the start of the codestream (SOC) followed by the image and tile size marker (SIZ) */
+		uint8_t const soc_siz[] = { 0xff, 0x4f, 0xff, 0x51 };
+		auto i = std::search(header.begin(), header.end(), soc_siz, soc_siz + 4);
+		/* SOC, SIZ, Lsiz, Rsiz, then Xsiz, Ysiz, XOsiz, YOsiz */
+		if (std::distance(i, header.end()) < 24) {
+			return {};
+		}
+		auto const siz = &*i;
+		auto const width = read_uint32(siz + 8, true) - read_uint32(siz + 16, true);
+		auto const height = read_uint32(siz + 12, true) - read_uint32(siz + 20, true);
+		if (width == 0 || height == 0) {
+			return {};
+		}
+		return dcp::Size(width, height);
+	}
+
+	auto ext = path.extension().string();
+	transform (ext.begin(), ext.end(), ext.begin(), ::tolower);
+	if (ext == ".dpx" && header.size() >= 780) {
+		bool big_endian;
+		if (std::equal(header.begin(), header.begin() + 4, "SDPX")) {
+			big_endian = true;
+		} else if (std::equal(header.begin(), header.begin() + 4, "XPDS")) {
+			big_endian = false;
+		} else {
+			return {};
+		}
+		/* Pixels per line and lines per element from the image information header */
+		auto const width = read_uint32(header.data() + 772, big_endian);
+		auto const height = read_uint32(header.data() + 776, big_endian);
+		if (width == 0 || height == 0) {
+			return {};
+		}
+		return dcp::Size(width, height);
+	}
+
+	return {};
+}
+
+
 ImageExaminer::ImageExaminer (shared_ptr<const Film> film, shared_ptr<const ImageContent> content, shared_ptr<Job>)
 	: _film (film)
 	, _image_content (content)
 {
 	auto path = content->path(0);
-	if (valid_j2k_file (path)) {
+	_video_size = size_from_header(path);
+	if (_video_size) {
+		/* Check a few of the other files to see if they look the same */
+		auto const paths = content->number_of_paths();
+		for (auto index: { paths / 2, paths - 1 }) {
+			auto const other = size_from_header(content->path(index));
+			if (other && *other != *_video_size) {
+				LOG_WARNING("Image %1 is %2x%3 but %4 is %5x%6", content->path(index).string(), other->width, other->height, path.string(), _video_size->width, _video_size->height);
+			}
+		}
+	} else if (valid_j2k_file (path)) {
 		auto size = dcp::filesystem::file_size(path);
 		dcp::File f(path, "rb");
 		if (!f) {
@@ -20,6 +20,7 @@
 
 
 #include "cross.h"
+#include "encoding_request.h"
 #include "exceptions.h"
 #include "ffmpeg_image_proxy.h"
 #include "image.h"
@@ -40,10 +41,10 @@ using std::string;
 
 
 shared_ptr<ImageProxy>
-image_proxy_factory (shared_ptr<cxml::Node> xml, shared_ptr<Socket> socket)
+image_proxy_factory (shared_ptr<cxml::Node> xml, shared_ptr<Socket> socket, TransportCompression compression)
 {
 	if (xml->string_child("Type") == N_("Raw")) {
-		return make_shared<RawImageProxy>(xml, socket);
+		return make_shared<RawImageProxy>(xml, socket, compression);
 	} else if (xml->string_child("Type") == N_("FFmpeg")) {
 		return make_shared<FFmpegImageProxy>(socket);
 	} else if (xml->string_child("Type") == N_("J2K")) {
@@ -52,3 +53,19 @@ image_proxy_factory (shared_ptr<cxml::Node> xml, shared_ptr<Socket> socket)
 
 	throw NetworkError (_("Unexpected image type received by server"));
 }
+
+
+shared_ptr<ImageProxy>
+image_proxy_factory (EncodingRequestReader& reader, shared_ptr<Socket> socket, TransportCompression compression)
+{
+	switch (static_cast<ImageProxy::Type>(reader.read_uint())) {
+	case ImageProxy::Type::RAW:
+		return make_shared<RawImageProxy>(reader, socket, compression);
+	case ImageProxy::Type::FFMPEG:
+		return make_shared<FFmpegImageProxy>(socket);
+	case ImageProxy::Type::J2K:
+		return make_shared<J2KImageProxy>(reader, socket);
+	}
+
+	throw NetworkError (_("Unexpected image type received by server"));
+}
@@ -37,6 +37,8 @@ extern "C" {
 #include <boost/utility.hpp>
 
 
+class EncodingRequestReader;
+class EncodingRequestWriter;
 class Image;
 class Socket;
 
@@ -69,6 +71,14 @@ public:
 	ImageProxy (ImageProxy const&) = delete;
 	ImageProxy& operator= (ImageProxy const&) = delete;
 
+	/** Identifiers for the types of proxy in binary encoding requests */
+	enum class Type : uint32_t
+	{
+		RAW = 1,
+		FFMPEG = 2,
+		J2K = 3
+	};
+
 	struct Result {
 		Result (std::shared_ptr<const Image> image_, int log2_scaling_)
 			: image (image_)
@@ -102,7 +112,8 @@ public:
 		) const = 0;
 
 	virtual void add_metadata (xmlpp::Node *) const = 0;
-	virtual void write_to_socket (std::shared_ptr<Socket>) const = 0;
+	virtual void add_metadata (EncodingRequestWriter& writer) const = 0;
+	virtual void write_to_socket (std::shared_ptr<Socket>, TransportCompression compression) const = 0;
 	/** @return true if our image is definitely the same as another, false if it is probably not */
 	virtual bool same (std::shared_ptr<const ImageProxy>) const = 0;
 	/** Do any useful work that would speed up a subsequent call to ::image().
@@ -114,7 +125,8 @@ public:
 };
 
 
-std::shared_ptr<ImageProxy> image_proxy_factory (std::shared_ptr<cxml::Node> xml, std::shared_ptr<Socket> socket);
+std::shared_ptr<ImageProxy> image_proxy_factory (std::shared_ptr<cxml::Node> xml, std::shared_ptr<Socket> socket, TransportCompression compression);
+std::shared_ptr<ImageProxy> image_proxy_factory (EncodingRequestReader& reader, std::shared_ptr<Socket> socket, TransportCompression compression);
 
 
 #endif
@@ -0,0 +1,196 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "j2k_compress.h"
+#include <dcp/exceptions.h>
+#include <dcp/j2k_transcode.h>
+#include <dcp/openjpeg_image.h>
+#ifdef DCPOMATIC_HAVE_OPENJPEG_ENCODE_THREADS
+#include <openjpeg.h>
+#endif
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+
+#ifdef DCPOMATIC_HAVE_OPENJPEG_ENCODE_THREADS
+
+namespace {
+
+class WriteBuffer
+{
+public:
+	OPJ_SIZE_T write(void const* buffer, OPJ_SIZE_T nb_bytes)
+	{
+		auto const end = _offset + nb_bytes;
+		if (end > _data.size()) {
+			_data.resize(end);
+		}
+		memcpy(_data.data() + _offset, buffer, nb_bytes);
+		_offset = end;
+		return nb_bytes;
+	}
+
+	OPJ_BOOL seek(OPJ_OFF_T n)
+	{
+		if (n < 0) {
+			return OPJ_FALSE;
+		}
+		_offset = n;
+		return OPJ_TRUE;
+	}
+
+	OPJ_OFF_T skip(OPJ_OFF_T n)
+	{
+		_offset += n;
+		return n;
+	}
+
+	vector<uint8_t> const& data() const {
+		return _data;
+	}
+
+private:
+	vector<uint8_t> _data;
+	size_t _offset = 0;
+};
+
+
+OPJ_SIZE_T
+write_function(void* buffer, OPJ_SIZE_T nb_bytes, void* data)
+{
+	return reinterpret_cast<WriteBuffer*>(data)->write(buffer, nb_bytes);
+}
+
+
+OPJ_BOOL
+seek_function(OPJ_OFF_T n, void* data)
+{
+	return reinterpret_cast<WriteBuffer*>(data)->seek(n);
+}
+
+
+OPJ_OFF_T
+skip_function(OPJ_OFF_T n, void* data)
+{
+	return reinterpret_cast<WriteBuffer*>(data)->skip(n);
+}
+
+
+void
+error_callback(char const* message, void* data)
+{
+	*reinterpret_cast<string*>(data) += message;
+}
+
+}
+
+#endif
+
+
+dcp::ArrayData
+compress_j2k(shared_ptr<const dcp::OpenJPEGImage> xyz, int bandwidth, int frames_per_second, bool threed, bool fourk, string comment, int threads)
+{
+#ifdef DCPOMATIC_HAVE_OPENJPEG_ENCODE_THREADS
+	if (threads <= 1) {
+		return dcp::compress_j2k(xyz, bandwidth, frames_per_second, threed, fourk, comment);
+	}
+
+	if (comment.empty()) {
+		/* As with dcp::compress_j2k; asdcplib can't read frames with an empty comment */
+		throw dcp::MiscError("compress_j2k comment can not be an empty string");
+	}
+
+	auto encoder = opj_create_compress(OPJ_CODEC_J2K);
+	if (!encoder) {
+		throw dcp::MiscError("could not create JPEG2000 encoder");
+	}
+
+	string errors;
+	opj_set_error_handler(encoder, error_callback, &errors);
+
+	/* These are the parameters that dcp::compress_j2k uses */
+	opj_cparameters_t parameters;
+	opj_set_default_encoder_parameters(&parameters);
+	if (fourk) {
+		parameters.numresolution = 7;
+	}
+	parameters.rsiz = fourk ? OPJ_PROFILE_CINEMA_4K : OPJ_PROFILE_CINEMA_2K;
+	vector<char> comment_buffer(comment.begin(), comment.end());
+	comment_buffer.push_back('\0');
+	parameters.cp_comment = comment_buffer.data();
+	parameters.max_cs_size = (bandwidth / 8) / frames_per_second;
+	if (threed) {
+		/* In 3D we have only half the normal bandwidth per eye */
+		parameters.max_cs_size /= 2;
+	}
+	parameters.max_comp_size = parameters.max_cs_size / 1.25;
+	parameters.tcp_numlayers = 1;
+	parameters.tcp_mct = 1;
+	parameters.numgbits = fourk ? 2 : 1;
+
+	if (!opj_setup_encoder(encoder, &parameters, xyz->opj_image())) {
+		opj_destroy_codec(encoder);
+		throw dcp::MiscError("could not set up JPEG2000 encoder");
+	}
+
+	/* This may fail if OpenJPEG was built without thread support, in which case it
+	 * will just encode using one thread.
+	 */
+	opj_codec_set_threads(encoder, threads);
+
+	auto stream = opj_stream_default_create(OPJ_FALSE);
+	if (!stream) {
+		opj_destroy_codec(encoder);
+		throw dcp::MiscError("could not create JPEG2000 stream");
+	}
+
+	WriteBuffer buffer;
+	opj_stream_set_write_function(stream, write_function);
+	opj_stream_set_seek_function(stream, seek_function);
+	opj_stream_set_skip_function(stream, skip_function);
+	opj_stream_set_user_data(stream, &buffer, nullptr);
+
+	bool const ok =
+		opj_start_compress(encoder, xyz->opj_image(), stream) &&
+		opj_encode(encoder, stream) &&
+		opj_end_compress(encoder, stream);
+
+	opj_stream_destroy(stream);
+	opj_destroy_codec(encoder);
+
+	if (!ok) {
+		throw dcp::MiscError(errors.empty() ? string("JPEG2000 encoding failed") : errors);
+	}
+
+	return dcp::ArrayData(buffer.data().data(), buffer.data().size());
+#else
+	(void) threads;
+	return dcp::compress_j2k(xyz, bandwidth, frames_per_second, threed, fourk, comment);
+#endif
+}
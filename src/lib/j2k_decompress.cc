@@ -0,0 +1,201 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "config.h"
+#include "j2k_decompress.h"
+#include <dcp/exceptions.h>
+#include <dcp/j2k_transcode.h>
+#include <dcp/openjpeg_image.h>
+#ifdef DCPOMATIC_HAVE_OPENJPEG_THREADS
+#include <openjpeg.h>
+#endif
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "i18n.h"
+
+
+using std::make_shared;
+using std::max;
+using std::min;
+using std::shared_ptr;
+using std::string;
+
+
+int
+j2k_decode_threads()
+{
+	auto const configured = Config::instance()->j2k_decode_threads();
+	if (configured > 0) {
+		return configured;
+	}
+
+	/* The butler already decodes several frames at once, so only take a share of the
+	 * machine for each frame.
+	 */
+	return max(1, static_cast<int>(boost::thread::hardware_concurrency()) / 4);
+}
+
+
+#ifdef DCPOMATIC_HAVE_OPENJPEG_THREADS
+
+namespace {
+
+class ReadBuffer
+{
+public:
+	ReadBuffer(uint8_t const* data, int64_t size)
+		: _data(data)
+		, _size(size)
+	{}
+
+	OPJ_SIZE_T read(void* buffer, OPJ_SIZE_T nb_bytes)
+	{
+		auto const n = min(static_cast<int64_t>(nb_bytes), _size - _offset);
+		if (n <= 0) {
+			return static_cast<OPJ_SIZE_T>(-1);
+		}
+		memcpy(buffer, _data + _offset, n);
+		_offset += n;
+		return n;
+	}
+
+	OPJ_OFF_T skip(OPJ_OFF_T n)
+	{
+		auto const from = _offset;
+		_offset = max(static_cast<int64_t>(0), min(_size, _offset + n));
+		return _offset - from;
+	}
+
+	OPJ_BOOL seek(OPJ_OFF_T n)
+	{
+		if (n < 0 || n > _size) {
+			return OPJ_FALSE;
+		}
+		_offset = n;
+		return OPJ_TRUE;
+	}
+
+private:
+	uint8_t const* _data;
+	int64_t _size;
+	int64_t _offset = 0;
+};
+
+
+OPJ_SIZE_T
+read_function(void* buffer, OPJ_SIZE_T nb_bytes, void* data)
+{
+	return reinterpret_cast<ReadBuffer*>(data)->read(buffer, nb_bytes);
+}
+
+
+OPJ_OFF_T
+skip_function(OPJ_OFF_T n, void* data)
+{
+	return reinterpret_cast<ReadBuffer*>(data)->skip(n);
+}
+
+
+OPJ_BOOL
+seek_function(OPJ_OFF_T n, void* data)
+{
+	return reinterpret_cast<ReadBuffer*>(data)->seek(n);
+}
+
+
+void
+error_callback(char const* message, void* data)
+{
+	*reinterpret_cast<string*>(data) += message;
+}
+
+}
+
+
+shared_ptr<dcp::OpenJPEGImage>
+decompress_j2k(uint8_t const* data, int64_t size, int reduce, int threads)
+{
+	ReadBuffer buffer(data, size);
+
+	auto stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, OPJ_TRUE);
+	if (!stream) {
+		throw dcp::J2KDecompressionError("could not create JPEG2000 stream");
+	}
+
+	opj_stream_set_read_function(stream, read_function);
+	opj_stream_set_skip_function(stream, skip_function);
+	opj_stream_set_seek_function(stream, seek_function);
+	opj_stream_set_user_data(stream, &buffer, nullptr);
+	opj_stream_set_user_data_length(stream, size);
+
+	auto decoder = opj_create_decompress(OPJ_CODEC_J2K);
+	if (!decoder) {
+		opj_stream_destroy(stream);
+		throw dcp::J2KDecompressionError("could not create JPEG2000 decompressor");
+	}
+
+	string errors;
+	opj_set_error_handler(decoder, error_callback, &errors);
+
+	opj_dparameters_t parameters;
+	opj_set_default_decoder_parameters(&parameters);
+	parameters.cp_reduce = reduce;
+	opj_setup_decoder(decoder, &parameters);
+	/* This may fail if OpenJPEG was built without thread support, in which case it
+	 * will just decode using one thread.
+	 */
+	opj_codec_set_threads(decoder, threads > 0 ? threads : j2k_decode_threads());
+
+	opj_image_t* image = nullptr;
+	bool const ok =
+		opj_read_header(stream, decoder, &image) &&
+		opj_decode(decoder, stream, image) &&
+		opj_end_decompress(decoder, stream);
+
+	opj_destroy_codec(decoder);
+	opj_stream_destroy(stream);
+
+	if (!ok) {
+		if (image) {
+			opj_image_destroy(image);
+		}
+		throw dcp::J2KDecompressionError(errors.empty() ? string("could not decode JPEG2000 codestream") : errors);
+	}
+
+	/* As dcp::decompress_j2k does, make the image's size reflect the reduction */
+	image->x1 = rint(float(image->x1) / pow(2.0f, reduce));
+	image->y1 = rint(float(image->y1) / pow(2.0f, reduce));
+
+	return make_shared<dcp::OpenJPEGImage>(image);
+}
+
+#else
+
+shared_ptr<dcp::OpenJPEGImage>
+decompress_j2k(uint8_t const* data, int64_t size, int reduce, int)
+{
+	return dcp::decompress_j2k(const_cast<uint8_t*>(data), size, reduce);
+}
+
+#endif
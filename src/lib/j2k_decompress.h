@@ -0,0 +1,40 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <cstdint>
+#include <memory>
+
+
+namespace dcp {
+	class OpenJPEGImage;
+}
+
+
+/** Decompress a J2K codestream, using several threads within the frame if our
+ *  OpenJPEG supports it; otherwise this is the same as dcp::decompress_j2k.
+ *  @param reduce Number of resolution levels to discard (0 for full resolution).
+ *  @param threads Number of threads to use, or 0 to use the value from Config.
+ *  Throws dcp::J2KDecompressionError on failure.
+ */
+extern std::shared_ptr<dcp::OpenJPEGImage> decompress_j2k(uint8_t const* data, int64_t size, int reduce, int threads = 0);
+
+/** @return the number of threads that decompress_j2k will use when given 0 */
+extern int j2k_decode_threads();
@@ -29,37 +29,64 @@
 #include "cross.h"
 #include "dcp_video.h"
 #include "dcpomatic_log.h"
+#include "dcpomatic_socket.h"
 #include "encode_server_description.h"
 #include "encode_server_finder.h"
+#include "exceptions.h"
 #include "film.h"
+#include "frame_recipes.h"
 #include "j2k_encoder.h"
+#include "j2k_encoder_backend.h"
 #include "log.h"
 #include "player_video.h"
+#include "scope_guard.h"
+#include "trace.h"
 #include "util.h"
+#include "video_complexity.h"
 #include "writer.h"
 #include <libcxml/cxml.h>
+#include <dcp/filesystem.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "i18n.h"
 
 
 using std::cout;
+using std::dynamic_pointer_cast;
 using std::exception;
 using std::list;
+using std::make_pair;
 using std::make_shared;
+using std::map;
+using std::pair;
 using std::shared_ptr;
+using std::string;
+using std::vector;
 using std::weak_ptr;
 using boost::optional;
 using dcp::Data;
 using namespace dcpomatic;
 
 
+/** Number of frames that each remote encoding thread will send to its server before
+ *  waiting for one to come back.
+ */
+static size_t const remote_frames_in_flight = 2;
+
+/** Number of recently-encoded frames to look at when checking for duplicates of a new frame */
+static size_t const recent_frames = 4;
+
+
 /** @param film Film that we are encoding.
  *  @param writer Writer that we are using.
  */
 J2KEncoder::J2KEncoder(shared_ptr<const Film> film, Writer& writer)
 	: _film (film)
 	, _history (200)
+	, _prepare_history (200)
+	, _local_backend (make_shared<CPUJ2KEncoderBackend>())
 	, _writer (writer)
 {
 	servers_list_changed ();
@@ -69,6 +96,11 @@ J2KEncoder::J2KEncoder(shared_ptr<const Film> film, Writer& writer)
 J2KEncoder::~J2KEncoder ()
 {
 	_server_found_connection.disconnect();
+	if (_encoding_with_servers) {
+		EncodeServerFinder::instance()->encoding_finished();
+	}
+
+	stop_preparing ();
 
 	boost::mutex::scoped_lock lm (_threads_mutex);
 	terminate_threads ();
@@ -78,9 +110,81 @@ J2KEncoder::~J2KEncoder ()
 void
 J2KEncoder::begin ()
 {
+	if (Config::instance()->reuse_previous_frames() && _film->directory()) {
+		try {
+			_recipes = make_shared<FrameRecipes>(_film);
+		} catch (std::exception& e) {
+			LOG_WARNING("Could not look for frames to re-use from earlier encodes (%1)", e.what());
+		}
+	}
+
+	if (_film->variable_j2k_bandwidth()) {
+		auto const path = _film->video_complexity_path();
+		if (dcp::filesystem::exists(path)) {
+			try {
+				_complexity.reset(new VideoComplexity(path));
+			} catch (std::exception& e) {
+				LOG_WARNING("Could not read video complexity (%1); using the same bandwidth for every frame", e.what());
+			}
+		} else {
+			LOG_GENERAL_NC("No video complexity has been found yet; using the same bandwidth for every frame");
+		}
+	}
+
 	_server_found_connection = EncodeServerFinder::instance()->ServersListChanged.connect(
 		boost::bind(&J2KEncoder::servers_list_changed, this)
 		);
+
+	if (!_encoding_with_servers) {
+		EncodeServerFinder::instance()->encoding_started();
+		_encoding_with_servers = true;
+	}
+
+	/* Making the XYZ is a fraction of the work of compressing it, so we don't need many of these */
+	auto const prepare_threads = std::max(1U, boost::thread::hardware_concurrency() / 4);
+	_prepare_work = make_shared<boost::asio::io_service::work>(_prepare_service);
+	for (size_t i = 0; i < prepare_threads; ++i) {
+		_prepare_pool.create_thread (boost::bind(&boost::asio::io_service::run, &_prepare_service));
+	}
+}
+
+
+/** Stop and join the threads which prepare frames, abandoning any preparation which
+ *  they have not started.
+ */
+void
+J2KEncoder::stop_preparing ()
+{
+	_prepare_work.reset ();
+	_prepare_service.stop ();
+	_prepare_pool.join_all ();
+}
+
+
+/** Make the XYZ image for a frame in the queue; run in one of the _prepare_pool threads */
+void
+J2KEncoder::prepare (DCPVideo frame)
+{
+	struct timeval start;
+	gettimeofday (&start, 0);
+
+	try {
+		TraceSpan span("prepare", "encode");
+		frame.prepare ();
+	} catch (std::exception& e) {
+		/* The encoding thread will try again, and deal with any error properly */
+		LOG_DEBUG_ENCODE("Could not prepare frame %1 (%2)", frame.index(), e.what());
+		return;
+	}
+
+	struct timeval finish;
+	gettimeofday (&finish, 0);
+	auto const time = seconds(finish) - seconds(start);
+
+	_prepare_history.event ();
+
+	boost::mutex::scoped_lock lm (_statistics_mutex);
+	_prepare_time = _prepare_time ? (*_prepare_time * 0.9 + time * 0.1) : time;
 }
 
 
@@ -91,8 +195,11 @@ J2KEncoder::end ()
 
 	LOG_GENERAL (N_("Clearing queue of %1"), _queue.size ());
 
-	/* Keep waking workers until the queue is empty */
-	while (!_queue.empty ()) {
+	/* Keep waking workers until the queue is empty and everything that they took from it
+	   has been written; while we wait, idle workers may pick up copies of frames which are
+	   taking a long time on other workers.
+	*/
+	while (!_queue.empty() || !_outstanding.empty()) {
 		rethrow ();
 		_empty_condition.notify_all ();
 		_full_condition.wait (lock);
@@ -100,13 +207,28 @@ J2KEncoder::end ()
 
 	lock.unlock ();
 
+	if (_video_frames_passed_through > 0) {
+		LOG_GENERAL (N_("Wrote %1 frames from existing J2K without re-encoding"), _video_frames_passed_through.load());
+	}
+
+	if (_video_frames_from_previous > 0) {
+		LOG_GENERAL (N_("Copied %1 unchanged frames from earlier encodes"), _video_frames_from_previous.load());
+	}
+
 	LOG_GENERAL_NC (N_("Terminating encoder threads"));
 
+	stop_preparing ();
+
 	{
 		boost::mutex::scoped_lock lm (_threads_mutex);
 		terminate_threads ();
 	}
 
+	if (_encoding_with_servers) {
+		EncodeServerFinder::instance()->encoding_finished();
+		_encoding_with_servers = false;
+	}
+
 	/* Something might have been thrown during terminate_threads */
 	rethrow ();
 
@@ -124,16 +246,15 @@ J2KEncoder::end ()
 	for (auto const& i: _queue) {
 		LOG_GENERAL(N_("Encode left-over frame %1"), i.index());
 		try {
-			_writer.write(
-				make_shared<dcp::ArrayData>(i.encode_locally()),
-				i.index(),
-				i.eyes()
-				);
-			frame_done ();
+			/* All the encoding threads have gone, so use the whole machine for each frame */
+			write_encoded (make_shared<dcp::ArrayData>(i.encode_locally(boost::thread::hardware_concurrency())), i.index(), i.eyes());
 		} catch (std::exception& e) {
 			LOG_ERROR (N_("Local encode failed (%1)"), e.what ());
 		}
 	}
+
+	/* Close our recipe files */
+	_recipes.reset ();
 }
 
 
@@ -147,15 +268,304 @@ J2KEncoder::current_encoding_rate () const
 }
 
 
-/** @return Number of video frames that have been queued for encoding */
+/** @param server Host name of an encoding server, or the name of a J2KEncoderBackend
+ *  (empty for the CPU) for threads on this machine.
+ *  @return an estimate of the current number of frames per second that are being
+ *  encoded by the given server, if known.
+ */
+optional<float>
+J2KEncoder::current_encoding_rate (string const& server) const
+{
+	boost::mutex::scoped_lock lm (_statistics_mutex);
+	auto i = _statistics.find(server);
+	if (i == _statistics.end()) {
+		return {};
+	}
+	return i->second.history.rate();
+}
+
+
+vector<Metric>
+J2KEncoder::metrics () const
+{
+	vector<Metric> metrics;
+
+	{
+		boost::mutex::scoped_lock lm (_queue_mutex);
+		metrics.emplace_back("encode_queue_length", _queue.size());
+	}
+
+	if (auto rate = current_encoding_rate()) {
+		metrics.emplace_back("encode_frames_per_second", *rate);
+	}
+
+	if (auto rate = _prepare_history.rate()) {
+		metrics.emplace_back("prepare_frames_per_second", *rate);
+	}
+
+	boost::mutex::scoped_lock lm (_statistics_mutex);
+	if (_prepare_time) {
+		metrics.emplace_back("prepare_seconds", *_prepare_time);
+	}
+	for (auto const& i: _statistics) {
+		metrics.emplace_back("encode_threads", i.second.threads, i.first);
+		if (auto rate = i.second.history.rate()) {
+			metrics.emplace_back("encode_frames_per_second", *rate, i.first);
+		}
+		if (i.second.latency) {
+			metrics.emplace_back("encode_latency_seconds", *i.second.latency, i.first);
+		}
+		if (i.second.busy) {
+			metrics.emplace_back("encode_frames_refused_busy", i.second.busy, i.first);
+		}
+	}
+
+	return metrics;
+}
+
+
+/** Should be called by a worker thread when it has got a frame encoded.
+ *  @param worker Host name of the server that encoded the frame, or the name of the J2KEncoderBackend that was used.
+ *  @param time Time taken (in seconds) from taking the frame off the queue to getting the encoded data.
+ */
+void
+J2KEncoder::worker_finished_frame (string const& worker, double time)
+{
+	boost::mutex::scoped_lock lm (_statistics_mutex);
+	auto& stats = _statistics[worker];
+	if (stats.latency) {
+		stats.latency = *stats.latency * 0.9 + time * 0.1;
+	} else {
+		stats.latency = time;
+	}
+	stats.history.event();
+}
+
+
+/** @param threads Total number of encoding threads.
+ *  @return Number of frames that encode() should allow to wait in the queue before it blocks.
+ */
+size_t
+J2KEncoder::maximum_queue_size (size_t threads) const
+{
+	/* Allow one thing in the queue even when there are no threads */
+	size_t const fixed = threads * 2 + 1;
+	if (!Config::instance()->adaptive_encoding_queue()) {
+		return fixed;
+	}
+
+	double rate = 0;
+	double longest = 0;
+	{
+		boost::mutex::scoped_lock lm (_statistics_mutex);
+		for (auto const& i: _statistics) {
+			if (i.second.threads > 0 && i.second.latency && *i.second.latency > 0) {
+				rate += i.second.threads / *i.second.latency;
+				longest = std::max(longest, *i.second.latency);
+			}
+		}
+	}
+
+	/* By Little's law we need about rate * longest frames waiting to keep everything busy
+	 * while the slowest worker has a frame in flight; but don't let the queue grow
+	 * without limit, as each frame in it takes up memory.
+	 */
+	auto const adaptive = static_cast<size_t>(std::ceil(rate * longest)) + threads + 1;
+	return std::min(std::max(fixed, adaptive), threads * 8 + 1);
+}
+
+
+/** Decide whether a thread belonging to a worker should leave the frames on the queue to be
+ *  picked up by workers which are much faster than it.  This stops a slow server holding on to
+ *  the last few frames of an encode while faster ones sit idle.  Caller must hold a lock on
+ *  _queue_mutex.
+ *
+ *  @param worker Host name of a server, or the name of a J2KEncoderBackend.
+ *  @param queue_length Number of frames currently waiting to be encoded.
+ *  @return true if the frames should be left for faster workers.
+ */
+bool
+J2KEncoder::leave_for_faster_workers (string const& worker, size_t queue_length) const
+{
+	/* Estimate of the time that one of a worker's threads takes to encode a frame */
+	auto seconds_per_frame = [](WorkerStatistics const& stats) -> optional<double> {
+		if (stats.threads == 0) {
+			return {};
+		}
+		auto rate = stats.history.rate();
+		if (!rate) {
+			rate = stats.advertised_rate;
+		}
+		if (!rate || *rate <= 0) {
+			return {};
+		}
+		return stats.threads / *rate;
+	};
+
+	boost::mutex::scoped_lock lm (_statistics_mutex);
+
+	auto us = _statistics.find(worker);
+	if (us == _statistics.end()) {
+		return false;
+	}
+
+	auto const ours = seconds_per_frame(us->second);
+	if (!ours) {
+		return false;
+	}
+
+	/* Count the threads which could finish what they are doing and then encode a frame
+	 * before one of our threads could encode it.
+	 */
+	size_t faster = 0;
+	for (auto const& i: _statistics) {
+		if (i.first != worker) {
+			auto const theirs = seconds_per_frame(i.second);
+			if (theirs && *theirs * 2 < *ours) {
+				faster += i.second.threads;
+			}
+		}
+	}
+
+	return queue_length <= faster;
+}
+
+
+/** Decide how many threads one of a worker's threads should use to encode the frame that it
+ *  has just taken.  Usually this is 1, as there are enough frames waiting to keep all the worker's
+ *  threads busy, but for short encodes, near the end of an encode, or when frames are arriving more
+ *  slowly than they can be encoded, some of the worker's threads would otherwise be idle; frames
+ *  can then be split between several threads.  Caller must hold a lock on _queue_mutex.
+ *
+ *  @param worker Name of a J2KEncoderBackend.
+ */
 int
-J2KEncoder::video_frames_enqueued () const
+J2KEncoder::threads_per_frame (string const& worker) const
+{
+	int threads = 0;
+	{
+		boost::mutex::scoped_lock lm (_statistics_mutex);
+		auto i = _statistics.find(worker);
+		if (i != _statistics.end()) {
+			threads = i->second.threads;
+		}
+	}
+
+	/* Frames which this worker's threads have or will soon have, including the caller's */
+	int frames = _queue.size();
+	auto i = _frames_in_progress.find(worker);
+	if (i != _frames_in_progress.end()) {
+		frames += i->second;
+	}
+
+	return std::max(1, threads / std::max(1, frames));
+}
+
+
+/** Note that a worker has taken a frame off the queue.  Caller must hold a lock on _queue_mutex */
+void
+J2KEncoder::start_frame (DCPVideo const& frame)
+{
+	auto const key = make_pair(frame.index(), frame.eyes());
+	auto i = _outstanding.find(key);
+	if (i != _outstanding.end()) {
+		++i->second.copies;
+	} else {
+		struct timeval now;
+		gettimeofday (&now, 0);
+		_outstanding.emplace(key, OutstandingFrame(frame, now));
+	}
+}
+
+
+/** Note that a worker has finished encoding a frame.
+ *  @return true if the caller should write the encoded data, false if another worker
+ *  has already finished this frame.
+ */
+bool
+J2KEncoder::finish_frame (int index, Eyes eyes)
 {
-	if (!_last_player_video_time) {
-		return 0;
+	boost::mutex::scoped_lock lm (_queue_mutex);
+	return _outstanding.erase(make_pair(index, eyes)) > 0;
+}
+
+
+/** Note that a worker has failed to encode a frame.  Caller must hold a lock on _queue_mutex.
+ *  @return true if the frame should be put back on the queue, false if it has already been
+ *  written or another worker is still encoding it.
+ */
+bool
+J2KEncoder::give_up_frame (DCPVideo const& frame)
+{
+	auto i = _outstanding.find(make_pair(frame.index(), frame.eyes()));
+	if (i == _outstanding.end()) {
+		return false;
+	}
+
+	if (--i->second.copies > 0) {
+		return false;
+	}
+
+	_outstanding.erase (i);
+	return true;
+}
+
+
+/** Find a frame which a worker with nothing to do should encode as well as the worker
+ *  that already has it.  Near the end of an encode this stops us waiting for frames
+ *  which are stuck on slow or dying servers.  Caller must hold a lock on _queue_mutex.
+ *
+ *  @param worker Host name of a server, or the name of a J2KEncoderBackend.
+ *  @return Frame to encode, if there is one which has been outstanding for much longer
+ *  than this worker would take to encode it.
+ */
+optional<DCPVideo>
+J2KEncoder::speculative_frame (string const& worker)
+{
+	if (_outstanding.empty()) {
+		return {};
+	}
+
+	optional<double> latency;
+	{
+		boost::mutex::scoped_lock lm (_statistics_mutex);
+		auto i = _statistics.find(worker);
+		if (i != _statistics.end()) {
+			latency = i->second.latency;
+		}
 	}
 
-	return _last_player_video_time->frames_floor (_film->video_frame_rate ());
+	if (!latency) {
+		return {};
+	}
+
+	struct timeval now;
+	gettimeofday (&now, 0);
+
+	auto oldest = _outstanding.end();
+	for (auto i = _outstanding.begin(); i != _outstanding.end(); ++i) {
+		if (i->second.copies == 1 && (seconds(now) - seconds(i->second.started)) > *latency * 2) {
+			if (oldest == _outstanding.end() || seconds(i->second.started) < seconds(oldest->second.started)) {
+				oldest = i;
+			}
+		}
+	}
+
+	if (oldest == _outstanding.end()) {
+		return {};
+	}
+
+	LOG_DEBUG_ENCODE("Frame %1 sent speculatively to %2", oldest->second.frame.index(), worker);
+	++oldest->second.copies;
+	return oldest->second.frame;
+}
+
+
+/** @return Number of video frames that have been queued for encoding */
+int
+J2KEncoder::video_frames_enqueued () const
+{
+	return _video_frames_enqueued;
 }
 
 
@@ -167,6 +577,84 @@ J2KEncoder::frame_done ()
 }
 
 
+/** Write a frame which has just been encoded, along with any frames which have
+ *  the same content and were waiting for it.
+ */
+void
+J2KEncoder::write_encoded (shared_ptr<const Data> data, int index, Eyes eyes, optional<string> hash)
+{
+	_writer.write(data, index, eyes, hash);
+	frame_done ();
+
+	if (_recipes) {
+		_recipes->encoded(index, eyes, data);
+	}
+
+	list<pair<int, Eyes>> waiting;
+	{
+		boost::mutex::scoped_lock lm (_recent_mutex);
+		for (auto& i: _recent) {
+			if (i.index == index && i.eyes == eyes && !i.encoded) {
+				i.encoded = data;
+				std::swap (waiting, i.waiting);
+				break;
+			}
+		}
+	}
+
+	for (auto const& i: waiting) {
+		LOG_DEBUG_ENCODE("Frame %1 written using encode of frame %2", i.first, index);
+		_writer.write(data, i.first, i.second, hash);
+		frame_done ();
+	}
+}
+
+
+/** See if a frame has the same content as one that we have recently queued for encoding,
+ *  and if so arrange for the encoded data to be used for this frame too.
+ *  @return true if we have taken care of writing the frame, otherwise false.
+ */
+bool
+J2KEncoder::reuse_recent (shared_ptr<PlayerVideo> pv, int index)
+{
+	shared_ptr<const Data> encoded;
+
+	{
+		boost::mutex::scoped_lock lm (_recent_mutex);
+
+		auto i = std::find_if (_recent.begin(), _recent.end(), [pv](RecentFrame const& r) {
+			return r.video->same(pv);
+		});
+
+		if (i == _recent.end()) {
+			/* Remember this one, as we are about to queue it for encoding */
+			_recent.push_front ({pv, index, pv->eyes(), {}, {}});
+			/* Don't throw away frames that others are waiting for */
+			auto j = _recent.end();
+			while (_recent.size() > recent_frames && j != _recent.begin()) {
+				--j;
+				if (j->waiting.empty()) {
+					j = _recent.erase (j);
+				}
+			}
+			return false;
+		}
+
+		if (!i->encoded) {
+			/* Write this frame when the original has been encoded */
+			i->waiting.push_back (make_pair(index, pv->eyes()));
+			return true;
+		}
+
+		encoded = i->encoded;
+	}
+
+	_writer.write(encoded, index, pv->eyes());
+	frame_done ();
+	return true;
+}
+
+
 /** Called to request encoding of the next video frame in the DCP.  This is called in order,
  *  so each time the supplied frame is the one after the previous one.
  *  pv represents one video frame, and could be empty if there is nothing to encode
@@ -183,18 +671,21 @@ J2KEncoder::encode (shared_ptr<PlayerVideo> pv, DCPTime time)
 	size_t threads = 0;
 	{
 		boost::mutex::scoped_lock lm (_threads_mutex);
-		threads = _threads->size();
+		threads = thread_count();
 	}
 
+	auto const maximum = maximum_queue_size(threads);
+
 	boost::mutex::scoped_lock queue_lock (_queue_mutex);
 
-	/* Wait until the queue has gone down a bit.  Allow one thing in the queue even
-	   when there are no threads.
-	*/
-	while (_queue.size() >= (threads * 2) + 1) {
-		LOG_TIMING ("decoder-sleep queue=%1 threads=%2", _queue.size(), threads);
-		_full_condition.wait (queue_lock);
-		LOG_TIMING ("decoder-wake queue=%1 threads=%2", _queue.size(), threads);
+	/* Wait until the queue has gone down a bit */
+	if (_queue.size() >= maximum) {
+		TraceSpan span("wait-for-encoders", "encode");
+		while (_queue.size() >= maximum) {
+			LOG_TIMING ("decoder-sleep queue=%1 threads=%2", _queue.size(), threads);
+			_full_condition.wait (queue_lock);
+			LOG_TIMING ("decoder-wake queue=%1 threads=%2", _queue.size(), threads);
+		}
 	}
 
 	_writer.rethrow();
@@ -206,6 +697,18 @@ J2KEncoder::encode (shared_ptr<PlayerVideo> pv, DCPTime time)
 
 	auto const position = time.frames_floor(_film->video_frame_rate());
 
+	auto j2k_bandwidth = _film->j2k_bandwidth();
+	if (_complexity) {
+		/* Don't let any frame go over the DCI limit unless the user has asked for more than that on average */
+		j2k_bandwidth = _complexity->j2k_bandwidth(position, j2k_bandwidth, std::min(250000000, Config::instance()->maximum_j2k_bandwidth()));
+	}
+
+	optional<string> recipe;
+	if (_recipes) {
+		recipe = _recipes->recipe(pv, j2k_bandwidth);
+	}
+	shared_ptr<const Data> previous;
+
 	if (_writer.can_fake_write(position)) {
 		/* We can fake-write this frame */
 		LOG_DEBUG_ENCODE("Frame @ %1 FAKE", to_string(time));
@@ -215,141 +718,390 @@ J2KEncoder::encode (shared_ptr<PlayerVideo> pv, DCPTime time)
 		LOG_DEBUG_ENCODE("Frame @ %1 J2K", to_string(time));
 		/* This frame already has J2K data, so just write it */
 		_writer.write(pv->j2k(), position, pv->eyes ());
+		++_video_frames_passed_through;
 		frame_done ();
-	} else if (_last_player_video[pv->eyes()] && _writer.can_repeat(position) && pv->same(_last_player_video[pv->eyes()])) {
+	} else if (
+		_last_player_video[pv->eyes()] &&
+		_last_player_video_position[pv->eyes()] == position - 1 &&
+		_writer.can_repeat(position) &&
+		pv->same(_last_player_video[pv->eyes()])
+		) {
 		LOG_DEBUG_ENCODE("Frame @ %1 REPEAT", to_string(time));
 		_writer.repeat(position, pv->eyes());
+	} else if (recipe && (previous = _recipes->find(*recipe))) {
+		LOG_DEBUG_ENCODE("Frame @ %1 PREVIOUS", to_string(time));
+		/* This frame is just the same as one we made in an earlier encode */
+		_writer.write(previous, position, pv->eyes());
+		++_video_frames_from_previous;
+		frame_done ();
+	} else if (reuse_recent(pv, position)) {
+		LOG_DEBUG_ENCODE("Frame @ %1 REUSE", to_string(time));
 	} else {
 		LOG_DEBUG_ENCODE("Frame @ %1 ENCODE", to_string(time));
+		if (recipe) {
+			_recipes->will_encode(position, pv->eyes(), *recipe);
+		}
 		/* Queue this new frame for encoding */
 		LOG_TIMING ("add-frame-to-queue queue=%1", _queue.size ());
+		Trace::counter("encode-queue", _queue.size() + 1);
 		_queue.push_back (DCPVideo(
 				pv,
 				position,
 				_film->video_frame_rate(),
-				_film->j2k_bandwidth(),
+				j2k_bandwidth,
 				_film->resolution()
 				));
 
+		if (_prepare_frames) {
+			_prepare_service.post (boost::bind(&J2KEncoder::prepare, this, _queue.back()));
+		}
+
 		/* The queue might not be empty any more, so notify anything which is
 		   waiting on that.
 		*/
 		_empty_condition.notify_all ();
 	}
 
+	if (recipe) {
+		_recipes->add(position, pv->eyes(), *recipe);
+	}
+
 	_last_player_video[pv->eyes()] = pv;
-	_last_player_video_time = time;
+	_last_player_video_position[pv->eyes()] = position;
+	if (pv->eyes() != Eyes::RIGHT) {
+		++_video_frames_enqueued;
+	}
 }
 
 
 /** Caller must hold a lock on _threads_mutex */
 void
 J2KEncoder::terminate_threads ()
+{
+	terminate_threads (_local_threads);
+	_local_threads.reset ();
+
+	terminate_threads (_external_threads);
+	_external_threads.reset ();
+
+	for (auto const& i: _remote_threads) {
+		terminate_threads (i.second.threads);
+	}
+	_remote_threads.clear ();
+}
+
+
+/** Interrupt and join a group of threads.  Any frame that one of the threads
+ *  is working on will be either written or put back on the queue before the
+ *  thread finishes, so the remaining threads can carry on undisturbed.
+ */
+void
+J2KEncoder::terminate_threads (shared_ptr<boost::thread_group> threads)
 {
 	boost::this_thread::disable_interruption dis;
 
-	if (!_threads) {
+	if (!threads) {
 		return;
 	}
 
-	_threads->interrupt_all ();
+	threads->interrupt_all ();
 	try {
-		_threads->join_all ();
+		threads->join_all ();
 	} catch (exception& e) {
 		LOG_ERROR ("join() threw an exception: %1", e.what());
 	} catch (...) {
 		LOG_ERROR_NC ("join() threw an exception");
 	}
+}
+
 
-	_threads.reset ();
+/** @return Total number of encoding threads, local and remote.
+ *  Caller must hold a lock on _threads_mutex.
+ */
+int
+J2KEncoder::thread_count () const
+{
+	int count = _local_threads ? _local_threads->size() : 0;
+	if (_external_threads) {
+		count += _external_threads->size();
+	}
+	for (auto const& i: _remote_threads) {
+		count += i.second.threads->size();
+	}
+	return count;
 }
 
 
+/** Thread to encode frames on this machine.
+ *  @param backend Backend to encode with.
+ */
 void
-J2KEncoder::encoder_thread (optional<EncodeServerDescription> server)
+J2KEncoder::local_encoder_thread (shared_ptr<J2KEncoderBackend> backend, int index)
 try
 {
 	start_of_thread ("J2KEncoder");
 
-	if (server) {
-		LOG_TIMING ("start-encoder-thread thread=%1 server=%2", thread_id (), server->host_name ());
-	} else {
-		LOG_TIMING ("start-encoder-thread thread=%1 server=localhost", thread_id ());
+	if (index >= 0 && Config::instance()->numa_aware_encoding()) {
+		set_thread_numa_node (index);
 	}
 
-	/* Number of seconds that we currently wait between attempts
-	   to connect to the server; not relevant for localhost
-	   encodings.
-	*/
-	int remote_backoff = 0;
+	LOG_TIMING ("start-encoder-thread thread=%1 server=localhost backend=%2", thread_id (), backend->name());
 
 	while (true) {
 
 		LOG_TIMING ("encoder-sleep thread=%1", thread_id ());
 		boost::mutex::scoped_lock lock (_queue_mutex);
-		while (_queue.empty ()) {
-			_empty_condition.wait (lock);
+		optional<DCPVideo> speculative;
+		if (_queue.empty()) {
+			TraceSpan span("wait-for-frame", "encode");
+			while (_queue.empty() && !(speculative = speculative_frame(backend->name()))) {
+				if (_outstanding.empty()) {
+					_empty_condition.wait (lock);
+				} else {
+					/* Wake up now and again to see if any outstanding frame is worth encoding again */
+					_empty_condition.timed_wait (lock, boost::posix_time::seconds(1));
+				}
+			}
+		}
+
+		if (!speculative && leave_for_faster_workers(backend->name(), _queue.size())) {
+			/* Look again in a little while in case the faster workers don't get to it */
+			_empty_condition.timed_wait (lock, boost::posix_time::milliseconds(100));
+			continue;
 		}
 
 		LOG_TIMING ("encoder-wake thread=%1 queue=%2", thread_id(), _queue.size());
-		auto vf = _queue.front ();
+		auto vf = speculative ? *speculative : _queue.front();
+
+		/* We're about to commit to encoding this frame, so we must not be interrupted until
+		   that has happened.  This block has thread interruption disabled.
+		*/
+		{
+			boost::this_thread::disable_interruption dis;
+
+			if (!speculative) {
+				LOG_TIMING ("encoder-pop thread=%1 frame=%2 eyes=%3", thread_id(), vf.index(), static_cast<int>(vf.eyes()));
+				_queue.pop_front ();
+				start_frame (vf);
+			}
 
-		/* We're about to commit to either encoding this frame or putting it back onto the queue,
+			++_frames_in_progress[backend->name()];
+			ScopeGuard sg = [this, backend]() {
+				boost::mutex::scoped_lock lm (_queue_mutex);
+				--_frames_in_progress[backend->name()];
+			};
+
+			auto const threads = threads_per_frame (backend->name());
+			Trace::counter("encode-threads-per-frame", threads);
+
+			lock.unlock ();
+
+			struct timeval start;
+			gettimeofday (&start, 0);
+
+			shared_ptr<Data> encoded;
+
+			try {
+				LOG_TIMING ("start-local-encode thread=%1 frame=%2 frame-threads=%3", thread_id(), vf.index(), threads);
+				TraceSpan span("local-encode", "encode");
+				encoded = make_shared<dcp::ArrayData>(backend->encode(vf, threads));
+				LOG_TIMING ("finish-local-encode thread=%1 frame=%2", thread_id(), vf.index());
+			} catch (std::exception& e) {
+				/* This is very bad, so don't cope with it, just pass it on */
+				LOG_ERROR (N_("Local encode failed (%1)"), e.what ());
+				throw;
+			}
+
+			struct timeval finish;
+			gettimeofday (&finish, 0);
+			worker_finished_frame (backend->name(), seconds(finish) - seconds(start));
+			if (finish_frame(vf.index(), vf.eyes())) {
+				write_encoded (encoded, vf.index(), vf.eyes());
+			}
+		}
+
+		/* The queue might not be full any more, so notify anything that is waiting on that */
+		lock.lock ();
+		_full_condition.notify_all ();
+	}
+}
+catch (boost::thread_interrupted& e) {
+	/* Ignore these and just stop the thread */
+	_full_condition.notify_all ();
+}
+catch (...)
+{
+	store_current ();
+	/* Wake anything waiting on _full_condition so it can see the exception */
+	_full_condition.notify_all ();
+}
+
+
+/** Thread to send frames to a remote server.  Each thread keeps a connection open to its
+ *  server and keeps a few frames in flight on that connection, so that the time taken to
+ *  send and receive frames overlaps with the server's encoding.
+ */
+void
+J2KEncoder::remote_encoder_thread (EncodeServerDescription server)
+try
+{
+	start_of_thread ("J2KEncoder");
+
+	LOG_TIMING ("start-encoder-thread thread=%1 server=%2", thread_id (), server.host_name ());
+	Trace::set_thread_name(String::compose("J2KEncoder (%1)", server.host_name()));
+
+	/* Number of seconds that we currently wait between attempts
+	   to connect to the server.
+	*/
+	int remote_backoff = 0;
+	/* Number of milliseconds that the server last asked us to wait, when it was too busy for
+	   a frame, before sending it any more.
+	*/
+	int busy_retry = 0;
+
+	shared_ptr<Socket> socket;
+	/* Time that we last heard from the server on socket */
+	struct timeval last_used;
+	gettimeofday (&last_used, 0);
+
+	/* Frames that we have sent to the server and not yet got back, with the time each one was sent */
+	list<pair<DCPVideo, struct timeval>> in_flight;
+
+	while (true) {
+
+		boost::mutex::scoped_lock lock (_queue_mutex);
+
+		/* We only wait for new frames (and hence can be interrupted) when we have nothing in flight */
+		optional<DCPVideo> speculative;
+		if (in_flight.empty()) {
+			LOG_TIMING ("encoder-sleep thread=%1", thread_id ());
+			TraceSpan span("wait-for-frame", "encode");
+			while (_queue.empty() && !(speculative = speculative_frame(server.host_name()))) {
+				if (_outstanding.empty()) {
+					_empty_condition.wait (lock);
+				} else {
+					/* Wake up now and again to see if any outstanding frame is worth encoding again */
+					_empty_condition.timed_wait (lock, boost::posix_time::seconds(1));
+				}
+			}
+			LOG_TIMING ("encoder-wake thread=%1 queue=%2", thread_id(), _queue.size());
+
+			if (!speculative && leave_for_faster_workers(server.host_name(), _queue.size())) {
+				/* Look again in a little while in case the faster workers don't get to it */
+				_empty_condition.timed_wait (lock, boost::posix_time::milliseconds(100));
+				continue;
+			}
+		}
+
+		/* We're about to commit to either encoding some frames or putting them back onto the queue,
 		   so we must not be interrupted until one or other of these things have happened.  This
 		   block has thread interruption disabled.
 		*/
 		{
 			boost::this_thread::disable_interruption dis;
 
-			LOG_TIMING ("encoder-pop thread=%1 frame=%2 eyes=%3", thread_id(), vf.index(), static_cast<int>(vf.eyes()));
-			_queue.pop_front ();
+			auto const already_in_flight = in_flight.size();
+
+			struct timeval now;
+			gettimeofday (&now, 0);
+			if (speculative) {
+				in_flight.push_back (make_pair(*speculative, now));
+			}
+			while (!_queue.empty() && in_flight.size() < remote_frames_in_flight && busy_retry == 0 && !leave_for_faster_workers(server.host_name(), _queue.size())) {
+				auto vf = _queue.front ();
+				LOG_TIMING ("encoder-pop thread=%1 frame=%2 eyes=%3", thread_id(), vf.index(), static_cast<int>(vf.eyes()));
+				_queue.pop_front ();
+				start_frame (vf);
+				in_flight.push_back (make_pair(vf, now));
+			}
 
 			lock.unlock ();
 
-			shared_ptr<Data> encoded;
+			try {
+				/* The server will give up on a connection which has been idle for a while */
+				if (socket && already_in_flight == 0 && (seconds(now) - seconds(last_used)) > 15) {
+					socket.reset ();
+				}
 
-			/* We need to encode this input */
-			if (server) {
-				try {
-					encoded = make_shared<dcp::ArrayData>(vf.encode_remotely(server.get()));
+				if (!socket) {
+					socket = DCPVideo::connect_to_server (server);
+				}
 
-					if (remote_backoff > 0) {
-						LOG_GENERAL ("%1 was lost, but now she is found; removing backoff", server->host_name ());
+				auto to_send = in_flight.begin();
+				std::advance (to_send, already_in_flight);
+				{
+					TraceSpan span("remote-send", "encode");
+					for (; to_send != in_flight.end(); ++to_send) {
+						to_send->first.send_to_server (socket, server.transport_compression());
 					}
+				}
 
-					/* This job succeeded, so remove any backoff */
-					remote_backoff = 0;
+				auto encoded = [this, &socket]() -> DCPVideo::RemotelyEncoded {
+					TraceSpan span("remote-encode", "encode");
+					/* The writer checks the server's hash against the one that libdcp makes as it
+					   writes the frame, unless the film is encrypted; in that case libdcp hashes
+					   the encrypted data, so we must check here.
+					*/
+					return DCPVideo::collect_from_server (socket, _film->encrypted());
+				}();
+				gettimeofday (&last_used, 0);
+
+				auto sent = std::find_if (in_flight.begin(), in_flight.end(), [&encoded](pair<DCPVideo, struct timeval> const& i) {
+					return i.first.index() == encoded.index && i.first.eyes() == encoded.eyes;
+				});
+
+				if (sent == in_flight.end()) {
+					throw NetworkError (String::compose("Server sent back frame %1, which was not asked for", encoded.index));
+				}
 
-				} catch (std::exception& e) {
-					if (remote_backoff < 60) {
-						/* back off more */
-						remote_backoff += 10;
+				if (encoded.busy_retry > 0) {
+					/* The server has too much to do (probably for other masters), so let another
+					   worker have this frame and leave the server alone for a while.
+					*/
+					lock.lock ();
+					if (give_up_frame(sent->first)) {
+						_queue.push_front (sent->first);
+						_empty_condition.notify_all ();
+					}
+					lock.unlock ();
+					busy_retry = encoded.busy_retry;
+					boost::mutex::scoped_lock slm (_statistics_mutex);
+					++_statistics[server.host_name()].busy;
+				} else {
+					worker_finished_frame (server.host_name(), seconds(last_used) - seconds(sent->second));
+					if (finish_frame(encoded.index, encoded.eyes)) {
+						write_encoded (make_shared<dcp::ArrayData>(encoded.data), encoded.index, encoded.eyes, encoded.hash);
 					}
-					LOG_ERROR (
-						N_("Remote encode of %1 on %2 failed (%3); thread sleeping for %4s"),
-						vf.index(), server->host_name(), e.what(), remote_backoff
-						);
 				}
+				in_flight.erase (sent);
 
-			} else {
-				try {
-					LOG_TIMING ("start-local-encode thread=%1 frame=%2", thread_id(), vf.index());
-					encoded = make_shared<dcp::ArrayData>(vf.encode_locally());
-					LOG_TIMING ("finish-local-encode thread=%1 frame=%2", thread_id(), vf.index());
-				} catch (std::exception& e) {
-					/* This is very bad, so don't cope with it, just pass it on */
-					LOG_ERROR (N_("Local encode failed (%1)"), e.what ());
-					throw;
+				if (remote_backoff > 0) {
+					LOG_GENERAL ("%1 was lost, but now she is found; removing backoff", server.host_name ());
 				}
-			}
 
-			if (encoded) {
-				_writer.write(encoded, vf.index(), vf.eyes());
-				frame_done ();
-			} else {
+				/* This job succeeded, so remove any backoff */
+				remote_backoff = 0;
+
+			} catch (std::exception& e) {
+				if (remote_backoff < 60) {
+					/* back off more */
+					remote_backoff += 10;
+				}
+				LOG_ERROR (
+					N_("Remote encode on %1 failed (%2); thread sleeping for %3s"),
+					server.host_name(), e.what(), remote_backoff
+					);
+
+				socket.reset ();
+
 				lock.lock ();
-				LOG_GENERAL (N_("[%1] J2KEncoder thread pushes frame %2 back onto queue after failure"), thread_id(), vf.index());
-				_queue.push_front (vf);
+				for (auto i = in_flight.rbegin(); i != in_flight.rend(); ++i) {
+					if (give_up_frame(i->first)) {
+						LOG_GENERAL (N_("[%1] J2KEncoder thread pushes frame %2 back onto queue after failure"), thread_id(), i->first.index());
+						_queue.push_front (i->first);
+					}
+				}
+				in_flight.clear ();
 				lock.unlock ();
 			}
 		}
@@ -358,6 +1110,12 @@ try
 			boost::this_thread::sleep (boost::posix_time::seconds (remote_backoff));
 		}
 
+		if (busy_retry > 0 && in_flight.empty()) {
+			/* We have collected everything that we sent before the server said it was busy */
+			boost::this_thread::sleep (boost::posix_time::milliseconds (busy_retry));
+			busy_retry = 0;
+		}
+
 		/* The queue might not be full any more, so notify anything that is waiting on that */
 		lock.lock ();
 		_full_condition.notify_all ();
@@ -375,37 +1133,101 @@ catch (...)
 }
 
 
+/** Bring our set of encoding threads into line with the configuration and the
+ *  servers that EncodeServerFinder currently knows about.  Only threads which
+ *  need to change are stopped or started; everything else carries on encoding.
+ */
 void
 J2KEncoder::servers_list_changed ()
 {
 	boost::mutex::scoped_lock lm (_threads_mutex);
 
-	terminate_threads ();
-	_threads = make_shared<boost::thread_group>();
-
-	/* XXX: could re-use threads */
+	auto const wanted_local = Config::instance()->only_servers_encode() ? 0 : Config::instance()->master_encoding_threads();
 
-	if (!Config::instance()->only_servers_encode ()) {
-		for (int i = 0; i < Config::instance()->master_encoding_threads (); ++i) {
+	if (!_local_threads || static_cast<int>(_local_threads->size()) != wanted_local) {
+		terminate_threads (_local_threads);
+		_local_threads = make_shared<boost::thread_group>();
+		if (wanted_local > 0 && Config::instance()->numa_aware_encoding()) {
+			LOG_GENERAL ("Placing encoding threads on %1", numa_description());
+		}
+		for (int i = 0; i < wanted_local; ++i) {
 #ifdef DCPOMATIC_LINUX
-			auto t = _threads->create_thread(boost::bind(&J2KEncoder::encoder_thread, this, optional<EncodeServerDescription>()));
+			auto t = _local_threads->create_thread(boost::bind(&J2KEncoder::local_encoder_thread, this, _local_backend, i));
 			pthread_setname_np (t->native_handle(), "encode-worker");
 #else
-			_threads->create_thread(boost::bind(&J2KEncoder::encoder_thread, this, optional<EncodeServerDescription>()));
+			_local_threads->create_thread(boost::bind(&J2KEncoder::local_encoder_thread, this, _local_backend, i));
 #endif
 		}
 	}
 
+	auto const external_command = Config::instance()->external_j2k_encoder_command();
+	auto const wanted_external = external_command.empty() ? 0 : Config::instance()->external_j2k_encoder_threads();
+	auto const external_backend = dynamic_pointer_cast<ExternalJ2KEncoderBackend>(_external_backend);
+
+	if (!_external_threads || static_cast<int>(_external_threads->size()) != wanted_external || !external_backend || external_backend->command() != external_command) {
+		terminate_threads (_external_threads);
+		_external_threads = make_shared<boost::thread_group>();
+		_external_backend = make_shared<ExternalJ2KEncoderBackend>(external_command);
+		if (wanted_external > 0) {
+			LOG_GENERAL (N_("Adding %1 worker threads for external encoder"), wanted_external);
+		}
+		for (int i = 0; i < wanted_external; ++i) {
+			_external_threads->create_thread(boost::bind(&J2KEncoder::local_encoder_thread, this, _external_backend, -1));
+		}
+	}
+
+	map<string, EncodeServerDescription> wanted_remote;
 	for (auto i: EncodeServerFinder::instance()->servers()) {
-		if (!i.current_link_version()) {
+		if (i.current_link_version()) {
+			wanted_remote[i.host_name()] = i;
+		}
+	}
+
+	/* Stop threads for servers which have gone away, or whose thread count has changed */
+	for (auto i = _remote_threads.begin(); i != _remote_threads.end(); ) {
+		auto wanted = wanted_remote.find(i->first);
+		if (wanted == wanted_remote.end() || wanted->second.threads() != i->second.server.threads()) {
+			LOG_GENERAL (N_("Removing %1 worker threads for remote %2"), i->second.threads->size(), i->first);
+			terminate_threads (i->second.threads);
+			i = _remote_threads.erase (i);
+		} else {
+			++i;
+		}
+	}
+
+	/* Start threads for servers which are new to us */
+	for (auto const& i: wanted_remote) {
+		if (_remote_threads.find(i.first) != _remote_threads.end()) {
 			continue;
 		}
 
-		LOG_GENERAL (N_("Adding %1 worker threads for remote %2"), i.threads(), i.host_name ());
-		for (int j = 0; j < i.threads(); ++j) {
-			_threads->create_thread(boost::bind(&J2KEncoder::encoder_thread, this, i));
+		LOG_GENERAL (N_("Adding %1 worker threads for remote %2"), i.second.threads(), i.first);
+		auto threads = make_shared<boost::thread_group>();
+		for (int j = 0; j < i.second.threads(); ++j) {
+			threads->create_thread(boost::bind(&J2KEncoder::remote_encoder_thread, this, i.second));
+		}
+		_remote_threads[i.first] = { i.second, threads };
+	}
+
+	{
+		boost::mutex::scoped_lock slm (_statistics_mutex);
+		for (auto& i: _statistics) {
+			i.second.threads = 0;
+		}
+		if (_local_threads) {
+			_statistics[_local_backend->name()].threads = _local_threads->size();
+		}
+		if (_external_threads) {
+			_statistics[_external_backend->name()].threads = _external_threads->size();
+		}
+		for (auto const& i: _remote_threads) {
+			_statistics[i.first].threads = i.second.threads->size();
+			_statistics[i.first].advertised_rate = wanted_remote[i.first].frames_per_second();
 		}
 	}
 
-	_writer.set_encoder_threads(_threads->size());
+	/* Frames are only worth preparing if they might be encoded here */
+	_prepare_frames = (_local_threads && !_local_threads->empty()) || (_external_threads && !_external_threads->empty());
+
+	_writer.set_encoder_threads(thread_count());
 }
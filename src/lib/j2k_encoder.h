@@ -29,24 +29,31 @@
 
 
 #include "cross.h"
+#include "encode_server_description.h"
 #include "enum_indexed_vector.h"
 #include "event_history.h"
 #include "exception_store.h"
+#include "metric.h"
 #include "writer.h"
+#include <boost/asio.hpp>
 #include <boost/optional.hpp>
 #include <boost/signals2.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
 #include <boost/thread/mutex.hpp>
+#include <atomic>
 #include <list>
+#include <map>
 #include <stdint.h>
 
 
 class DCPVideo;
-class EncodeServerDescription;
+class FrameRecipes;
+class J2KEncoderBackend;
 class Film;
 class Job;
 class PlayerVideo;
+class VideoComplexity;
 
 
 /** @class J2KEncoder
@@ -74,24 +81,65 @@ public:
 	void end ();
 
 	boost::optional<float> current_encoding_rate () const;
+	boost::optional<float> current_encoding_rate (std::string const& server) const;
 	int video_frames_enqueued () const;
+	std::vector<Metric> metrics () const;
 
 	void servers_list_changed ();
 
 private:
 
 	void frame_done ();
+	void write_encoded (std::shared_ptr<const dcp::Data> data, int index, Eyes eyes, boost::optional<std::string> hash = boost::none);
+	bool reuse_recent (std::shared_ptr<PlayerVideo> pv, int index);
 
-	void encoder_thread (boost::optional<EncodeServerDescription>);
+	void prepare (DCPVideo frame);
+	void stop_preparing ();
+	void local_encoder_thread (std::shared_ptr<J2KEncoderBackend> backend, int index);
+	void remote_encoder_thread (EncodeServerDescription server);
 	void terminate_threads ();
+	void terminate_threads (std::shared_ptr<boost::thread_group> threads);
+	int thread_count () const;
+	void worker_finished_frame (std::string const& worker, double time);
+	size_t maximum_queue_size (size_t threads) const;
+	bool leave_for_faster_workers (std::string const& worker, size_t queue_length) const;
+	int threads_per_frame (std::string const& worker) const;
+	void start_frame (DCPVideo const& frame);
+	bool finish_frame (int index, Eyes eyes);
+	bool give_up_frame (DCPVideo const& frame);
+	boost::optional<DCPVideo> speculative_frame (std::string const& worker);
 
 	/** Film that we are encoding */
 	std::shared_ptr<const Film> _film;
 
 	EventHistory _history;
 
-	boost::mutex _threads_mutex;
-	std::shared_ptr<boost::thread_group> _threads;
+	mutable boost::mutex _threads_mutex;
+	/** Threads encoding on this machine's CPU */
+	std::shared_ptr<boost::thread_group> _local_threads;
+	std::shared_ptr<J2KEncoderBackend> _local_backend;
+	/** Threads encoding on this machine using an external encoder */
+	std::shared_ptr<boost::thread_group> _external_threads;
+	std::shared_ptr<J2KEncoderBackend> _external_backend;
+
+	struct RemoteThreads {
+		/** Server description, as it was when the threads were started */
+		EncodeServerDescription server;
+		std::shared_ptr<boost::thread_group> threads;
+	};
+
+	/** Threads feeding remote servers, indexed by server host name */
+	std::map<std::string, RemoteThreads> _remote_threads;
+
+	/** Threads which make XYZ images for frames in the queue before the local or external
+	 *  encoding threads get to them, so that those threads need only compress.
+	 */
+	boost::thread_group _prepare_pool;
+	boost::asio::io_service _prepare_service;
+	std::shared_ptr<boost::asio::io_service::work> _prepare_work;
+	/** true if frames should be prepared, i.e. if there are any local or external encoding threads */
+	std::atomic<bool> _prepare_frames{false};
+	EventHistory _prepare_history;
 
 	mutable boost::mutex _queue_mutex;
 	std::list<DCPVideo> _queue;
@@ -100,13 +148,99 @@ private:
 	/** condition to manage thread wakeups when we have too much to do */
 	boost::condition _full_condition;
 
+	/** A frame which has been taken off the queue by one or more workers but not yet written */
+	struct OutstandingFrame {
+		OutstandingFrame (DCPVideo f, struct timeval s)
+			: frame (f)
+			, started (s)
+		{}
+
+		DCPVideo frame;
+		/** time that the first worker took the frame */
+		struct timeval started;
+		/** number of workers which are encoding the frame */
+		int copies = 1;
+	};
+
+	/** Frames which workers are currently encoding, indexed by frame index and eyes.
+	 *  Protected by _queue_mutex.
+	 */
+	std::map<std::pair<int, Eyes>, OutstandingFrame> _outstanding;
+	/** Number of frames that the threads for each J2KEncoderBackend are encoding, indexed by
+	 *  the backend's name.  Protected by _queue_mutex.
+	 */
+	std::map<std::string, int> _frames_in_progress;
+
 	Writer& _writer;
 	Waker _waker;
 
 	EnumIndexedVector<std::shared_ptr<PlayerVideo>, Eyes> _last_player_video;
-	boost::optional<dcpomatic::DCPTime> _last_player_video_time;
+	/** Position of each of _last_player_video, since with more than one Player feeding us
+	 *  they are not necessarily the frames just before the next ones that we get.
+	 */
+	EnumIndexedVector<boost::optional<Frame>, Eyes> _last_player_video_position;
+	/** Number of frames (counting each pair of 3D frames once) passed to encode() */
+	std::atomic<int> _video_frames_enqueued{0};
+	/** Number of frames (counting each 3D eye) whose existing J2K was written without re-encoding */
+	std::atomic<int> _video_frames_passed_through{0};
+	/** Number of frames (counting each 3D eye) copied from an earlier encode of the film */
+	std::atomic<int> _video_frames_from_previous{0};
+
+	/** Recipes of the frames we are writing, and of those from earlier encodes, or nullptr if we
+	 *  are not re-using frames from earlier encodes.
+	 */
+	std::shared_ptr<FrameRecipes> _recipes;
+	/** Complexity of each frame, if we are varying the J2K bandwidth between frames */
+	std::unique_ptr<VideoComplexity> _complexity;
 
 	boost::signals2::scoped_connection _server_found_connection;
+	/** true if we have told EncodeServerFinder that we are encoding */
+	bool _encoding_with_servers = false;
+
+	/** A frame which we have recently queued for encoding */
+	struct RecentFrame {
+		std::shared_ptr<PlayerVideo> video;
+		int index;
+		Eyes eyes;
+		/** Encoded data, or empty if the frame has not yet been encoded */
+		std::shared_ptr<const dcp::Data> encoded;
+		/** Other frames with the same content which should be written using the encoded data when it arrives */
+		std::list<std::pair<int, Eyes>> waiting;
+	};
+
+	boost::mutex _recent_mutex;
+	/** Frames recently queued for encoding, most recent first, so that identical frames
+	 *  which are not adjacent can be written without encoding them again.
+	 */
+	std::list<RecentFrame> _recent;
+
+	struct WorkerStatistics {
+		WorkerStatistics ()
+			: history (50)
+		{}
+
+		/** Number of threads using this worker */
+		int threads = 0;
+		/** Exponentially-weighted mean of the time taken (in seconds) for one thread to get a frame
+		 *  encoded, including any network round-trip.
+		 */
+		boost::optional<double> latency;
+		/** Rate (in frames per second, using all its threads) at which the worker says that it can encode */
+		boost::optional<float> advertised_rate;
+		/** Number of frames that the worker (a server) has been too busy to encode */
+		int busy = 0;
+		EventHistory history;
+	};
+
+	mutable boost::mutex _statistics_mutex;
+	/** Exponentially-weighted mean of the time taken (in seconds) for one thread to prepare a frame;
+	 *  protected by _statistics_mutex.
+	 */
+	boost::optional<double> _prepare_time;
+	/** Statistics for each host that we are encoding on, indexed by host name; threads
+	 *  encoding on this machine use the name of their J2KEncoderBackend.
+	 */
+	std::map<std::string, WorkerStatistics> _statistics;
 };
 
 
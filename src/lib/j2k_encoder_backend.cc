@@ -0,0 +1,106 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "compose.hpp"
+#include "dcp_video.h"
+#include "dcpomatic_log.h"
+#include "exceptions.h"
+#include "j2k_encoder_backend.h"
+#include "player_video.h"
+#include "scoped_temporary.h"
+#include <dcp/openjpeg_image.h>
+#include <dcp/raw_convert.h>
+#include <boost/algorithm/string.hpp>
+#include <cstdlib>
+#include <vector>
+
+#include "i18n.h"
+
+
+using std::string;
+using std::vector;
+using dcp::raw_convert;
+
+
+dcp::ArrayData
+CPUJ2KEncoderBackend::encode (DCPVideo const& frame, int threads)
+{
+	return frame.encode_locally(threads);
+}
+
+
+ExternalJ2KEncoderBackend::ExternalJ2KEncoderBackend (string command)
+	: _command (command)
+{
+
+}
+
+
+dcp::ArrayData
+ExternalJ2KEncoderBackend::encode (DCPVideo const& frame, int)
+{
+	auto xyz = frame.take_xyz();
+	auto const size = xyz->size();
+
+	ScopedTemporary input;
+	ScopedTemporary output;
+
+	{
+		vector<uint16_t> line(size.width);
+		auto& f = input.open("wb");
+		for (int c = 0; c < 3; ++c) {
+			auto p = xyz->data(c);
+			for (int y = 0; y < size.height; ++y) {
+				for (int x = 0; x < size.width; ++x) {
+					auto const v = static_cast<uint16_t>(*p++);
+					/* Little-endian, whatever the host */
+					auto b = reinterpret_cast<uint8_t*>(&line[x]);
+					b[0] = v & 0xff;
+					b[1] = v >> 8;
+				}
+				f.checked_write(line.data(), size.width * 2);
+			}
+		}
+		f.close();
+	}
+
+	auto command = _command;
+	boost::algorithm::replace_all (command, "%i", String::compose("\"%1\"", input.path().string()));
+	boost::algorithm::replace_all (command, "%o", String::compose("\"%1\"", output.path().string()));
+	boost::algorithm::replace_all (command, "%w", raw_convert<string>(size.width));
+	boost::algorithm::replace_all (command, "%h", raw_convert<string>(size.height));
+	boost::algorithm::replace_all (command, "%f", raw_convert<string>(frame.frames_per_second()));
+	boost::algorithm::replace_all (command, "%b", raw_convert<string>(frame.j2k_bandwidth()));
+	boost::algorithm::replace_all (command, "%r", frame.resolution() == Resolution::FOUR_K ? "4K" : "2K");
+
+	LOG_DEBUG_ENCODE (N_("Running external encoder: %1"), command);
+
+	int const r = system (command.c_str());
+	if (r != 0) {
+		throw EncodeError (String::compose(_("External JPEG2000 encoder failed (%1)"), r));
+	}
+
+	if (!boost::filesystem::exists(output.path())) {
+		throw EncodeError (_("External JPEG2000 encoder did not write any output"));
+	}
+
+	return dcp::ArrayData(output.path());
+}
@@ -0,0 +1,108 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DCPOMATIC_J2K_ENCODER_BACKEND_H
+#define DCPOMATIC_J2K_ENCODER_BACKEND_H
+
+
+/** @file  src/lib/j2k_encoder_backend.h
+ *  @brief J2KEncoderBackend and implementations.
+ */
+
+
+#include <dcp/array_data.h>
+#include <string>
+
+
+class DCPVideo;
+
+
+/** @class J2KEncoderBackend
+ *  @brief Something that can JPEG2000-encode a DCPVideo on this machine.
+ *
+ *  J2KEncoder runs a group of threads for each backend that it uses, alongside any
+ *  threads which send frames to remote servers.
+ */
+class J2KEncoderBackend
+{
+public:
+	virtual ~J2KEncoderBackend () {}
+
+	/** @param threads Number of threads that may be used to encode this frame; backends
+	 *  are free to ignore this.
+	 */
+	virtual dcp::ArrayData encode (DCPVideo const& frame, int threads) = 0;
+
+	/** @return name to use in logs and statistics */
+	virtual std::string name () const = 0;
+};
+
+
+/** @class CPUJ2KEncoderBackend
+ *  @brief Backend which encodes using libdcp (and hence OpenJPEG) on the CPU.
+ */
+class CPUJ2KEncoderBackend : public J2KEncoderBackend
+{
+public:
+	dcp::ArrayData encode (DCPVideo const& frame, int threads) override;
+
+	std::string name () const override {
+		return {};
+	}
+};
+
+
+/** @class ExternalJ2KEncoderBackend
+ *  @brief Backend which runs an external program (for example a GPU-accelerated encoder) to encode each frame.
+ *
+ *  The program is given an uncompressed frame as a file of planar, 16-bit little-endian
+ *  X, Y and Z samples with 12 significant bits, and must write a JPEG2000 codestream.
+ *  The command may contain the following, which are replaced before it is run:
+ *
+ *  %i  path to the uncompressed input file
+ *  %o  path to write the JPEG2000 codestream to
+ *  %w  frame width in pixels
+ *  %h  frame height in pixels
+ *  %f  DCP frame rate
+ *  %b  J2K bandwidth in bits per second
+ *  %r  2K or 4K
+ */
+class ExternalJ2KEncoderBackend : public J2KEncoderBackend
+{
+public:
+	explicit ExternalJ2KEncoderBackend (std::string command);
+
+	dcp::ArrayData encode (DCPVideo const& frame, int threads) override;
+
+	std::string name () const override {
+		return "external";
+	}
+
+	std::string command () const {
+		return _command;
+	}
+
+private:
+	std::string _command;
+};
+
+
+#endif
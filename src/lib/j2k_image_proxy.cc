@@ -21,8 +21,12 @@
 
 #include "dcpomatic_assert.h"
 #include "dcpomatic_socket.h"
+#include "encoding_request.h"
+#include "exceptions.h"
 #include "image.h"
+#include "j2k_decompress.h"
 #include "j2k_image_proxy.h"
+#include "xyz_image_pool.h"
 #include <dcp/colour_conversion.h>
 #include <dcp/j2k_transcode.h>
 #include <dcp/mono_picture_frame.h>
@@ -51,6 +55,10 @@ using dcp::ArrayData;
 using dcp::raw_convert;
 
 
+/** Maximum number of resolution levels that J2KImageProxy will discard when decoding */
+static int constexpr max_reduction = 6;
+
+
 /** Construct a J2KImageProxy from a JPEG2000 file */
 J2KImageProxy::J2KImageProxy (boost::filesystem::path path, dcp::Size size, AVPixelFormat pixel_format)
 	: _data (new dcp::ArrayData(path))
@@ -107,16 +115,75 @@ J2KImageProxy::J2KImageProxy (shared_ptr<cxml::Node> xml, shared_ptr<Socket> soc
 		_eye = static_cast<dcp::Eye>(xml->number_child<int>("Eye"));
 	}
 	auto data = make_shared<ArrayData>(xml->number_child<int>("Size"));
-	/* This only matters when we are using J2KImageProxy for the preview, which
-	   will never use this constructor (which is only used for passing data to
-	   encode servers).  So we can put anything in here.  It's a bit of a hack.
+	/* The server does all the work of making the final image from this proxy, so it must
+	   treat the data in the same way as the master would have done.
 	*/
-	_pixel_format = AV_PIX_FMT_XYZ12LE;
+	_pixel_format = static_cast<AVPixelFormat>(xml->optional_number_child<int>("PixelFormat").get_value_or(AV_PIX_FMT_XYZ12LE));
+	if (_pixel_format != AV_PIX_FMT_RGB48 && _pixel_format != AV_PIX_FMT_XYZ12LE) {
+		throw NetworkError ("Unexpected pixel format for J2K image received by server");
+	}
+	_forced_reduction = xml->optional_number_child<int>("ForcedReduction");
+	socket->read (data->data(), data->size());
+	_data = data;
+}
+
+
+J2KImageProxy::J2KImageProxy (EncodingRequestReader& reader, shared_ptr<Socket> socket)
+	: _error (false)
+{
+	auto const width = reader.read_int();
+	auto const height = reader.read_int();
+	_size = dcp::Size(width, height);
+	auto const eye = reader.read_optional_int();
+	if (eye) {
+		_eye = static_cast<dcp::Eye>(*eye);
+	}
+	auto data = make_shared<ArrayData>(reader.read_int());
+	/* As in the XML constructor, we must treat the data in the same way as the master would have done */
+	_pixel_format = static_cast<AVPixelFormat>(reader.read_int());
+	if (_pixel_format != AV_PIX_FMT_RGB48 && _pixel_format != AV_PIX_FMT_XYZ12LE) {
+		throw NetworkError ("Unexpected pixel format for J2K image received by server");
+	}
+	_forced_reduction = reader.read_optional_int();
 	socket->read (data->data(), data->size());
 	_data = data;
 }
 
 
+/** @return the size of our image when decoded with some resolution levels discarded */
+dcp::Size
+J2KImageProxy::reduced_size (int reduce) const
+{
+	/* OpenJPEG rounds up when it discards resolution levels */
+	int const scale = 1 << reduce;
+	return dcp::Size((_size.width + scale - 1) / scale, (_size.height + scale - 1) / scale);
+}
+
+
+/** @return the number of JPEG2000 resolution levels to discard when decoding an image
+ *  which will be scaled to target_size: the largest number which still gives an image
+ *  at least as big as target_size.
+ */
+int
+J2KImageProxy::reduction (optional<dcp::Size> target_size) const
+{
+	if (_forced_reduction) {
+		return *_forced_reduction;
+	}
+
+	if (!target_size) {
+		return 0;
+	}
+
+	int reduce = 0;
+	while (reduce < max_reduction && reduced_size(reduce + 1).width >= target_size->width && reduced_size(reduce + 1).height >= target_size->height) {
+		++reduce;
+	}
+
+	return reduce;
+}
+
+
 int
 J2KImageProxy::prepare (Image::Alignment alignment, optional<dcp::Size> target_size) const
 {
@@ -127,22 +194,11 @@ J2KImageProxy::prepare (Image::Alignment alignment, optional<dcp::Size> target_s
 		return *_reduce;
 	}
 
-	int reduce = 0;
-
-	if (_forced_reduction) {
-		reduce = *_forced_reduction;
-	} else {
-		while (target_size && (_size.width / pow(2, reduce)) > target_size->width && (_size.height / pow(2, reduce)) > target_size->height) {
-			++reduce;
-		}
-
-		--reduce;
-		reduce = max (0, reduce);
-	}
+	int const reduce = reduction (target_size);
 
 	try {
 		/* XXX: should check that potentially trashing _data here doesn't matter */
-		auto decompressed = dcp::decompress_j2k (const_cast<uint8_t*>(_data->data()), _data->size(), reduce);
+		auto decompressed = decompress_j2k(_data->data(), _data->size(), reduce);
 		_image = make_shared<Image>(_pixel_format, decompressed->size(), alignment);
 
 		int const shift = 16 - decompressed->precision (0);
@@ -179,6 +235,72 @@ J2KImageProxy::prepare (Image::Alignment alignment, optional<dcp::Size> target_s
 }
 
 
+/** Decode our JPEG2000 straight into an image which can be given to the J2K encoder,
+ *  without going through an Image.  This can only be done for XYZ data which
+ *  decodes, perhaps with some resolution levels discarded, to exactly the requested size.
+ *  @param size Size of the image that is wanted.
+ *  @return The decoded image, which belongs to the caller, or nullptr if it could not be made.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+J2KImageProxy::xyz (dcp::Size size) const
+{
+	if (_pixel_format != AV_PIX_FMT_XYZ12LE) {
+		return {};
+	}
+
+	/* Find a number of resolution levels to discard which gives exactly the size we want
+	 * (e.g. to make 2K from 4K); this is much quicker than decoding everything and then
+	 * scaling, and the wavelet transform's own low-pass gives a good picture.
+	 */
+	optional<int> reduce;
+	if (_forced_reduction) {
+		if (reduced_size(*_forced_reduction) == size) {
+			reduce = *_forced_reduction;
+		}
+	} else {
+		for (int r = 0; r <= max_reduction && !reduce; ++r) {
+			if (reduced_size(r) == size) {
+				reduce = r;
+			}
+		}
+	}
+
+	if (!reduce) {
+		return {};
+	}
+
+	shared_ptr<dcp::OpenJPEGImage> decompressed;
+	try {
+		decompressed = decompress_j2k(_data->data(), _data->size(), *reduce);
+	} catch (dcp::J2KDecompressionError&) {
+		/* Let image() deal with this */
+		return {};
+	}
+
+	if (decompressed->size() != size) {
+		return {};
+	}
+
+	for (int c = 0; c < 3; ++c) {
+		if (decompressed->precision(c) != 12) {
+			return {};
+		}
+	}
+
+	/* The decoded image carries details of how it was decoded (e.g. the reduction) which
+	 * we don't want the encoder to see, so copy the components into a new one; this is
+	 * still one copy instead of a copy into an Image and another back out of it.
+	 */
+	auto xyz = pooled_xyz_image(size);
+	auto const pixels = size.width * size.height;
+	for (int c = 0; c < 3; ++c) {
+		std::copy(decompressed->data(c), decompressed->data(c) + pixels, xyz->data(c));
+	}
+
+	return xyz;
+}
+
+
 ImageProxy::Result
 J2KImageProxy::image (Image::Alignment alignment, optional<dcp::Size> target_size) const
 {
@@ -201,12 +323,30 @@ J2KImageProxy::add_metadata (xmlpp::Node* node) const
 		node->add_child("Eye")->add_child_text(raw_convert<string>(static_cast<int>(_eye.get())));
 	}
 	node->add_child("Size")->add_child_text(raw_convert<string>(_data->size()));
+	node->add_child("PixelFormat")->add_child_text(raw_convert<string>(static_cast<int>(_pixel_format)));
+	if (_forced_reduction) {
+		node->add_child("ForcedReduction")->add_child_text(raw_convert<string>(*_forced_reduction));
+	}
+}
+
+
+void
+J2KImageProxy::add_metadata (EncodingRequestWriter& writer) const
+{
+	writer.write_uint(static_cast<uint32_t>(Type::J2K));
+	writer.write_int(_size.width);
+	writer.write_int(_size.height);
+	writer.write_optional_int(_eye ? boost::optional<int>(static_cast<int>(*_eye)) : boost::none);
+	writer.write_int(_data->size());
+	writer.write_int(static_cast<int>(_pixel_format));
+	writer.write_optional_int(_forced_reduction);
 }
 
 
 void
-J2KImageProxy::write_to_socket (shared_ptr<Socket> socket) const
+J2KImageProxy::write_to_socket (shared_ptr<Socket> socket, TransportCompression) const
 {
+	/* This data is already compressed, so there's no point in compressing it again */
 	socket->write (_data->data(), _data->size());
 }
 
@@ -27,6 +27,7 @@
 
 namespace dcp {
 	class MonoPictureFrame;
+	class OpenJPEGImage;
 	class StereoPictureFrame;
 }
 
@@ -52,6 +53,7 @@ public:
 		);
 
 	J2KImageProxy (std::shared_ptr<cxml::Node> xml, std::shared_ptr<Socket> socket);
+	J2KImageProxy (EncodingRequestReader& reader, std::shared_ptr<Socket> socket);
 
 	/* For tests */
 	J2KImageProxy (dcp::ArrayData data, dcp::Size size, AVPixelFormat pixel_format);
@@ -62,10 +64,12 @@ public:
 		) const override;
 
 	void add_metadata (xmlpp::Node *) const override;
-	void write_to_socket (std::shared_ptr<Socket> override) const override;
+	void add_metadata (EncodingRequestWriter& writer) const override;
+	void write_to_socket (std::shared_ptr<Socket>, TransportCompression) const override;
 	/** @return true if our image is definitely the same as another, false if it is probably not */
 	bool same (std::shared_ptr<const ImageProxy>) const override;
 	int prepare (Image::Alignment alignment, boost::optional<dcp::Size> = boost::optional<dcp::Size>()) const override;
+	std::shared_ptr<dcp::OpenJPEGImage> xyz (dcp::Size size) const;
 
 	std::shared_ptr<const dcp::Data> j2k () const {
 		return _data;
@@ -82,6 +86,9 @@ public:
 	size_t memory_used () const override;
 
 private:
+	dcp::Size reduced_size (int reduce) const;
+	int reduction (boost::optional<dcp::Size> target_size) const;
+
 	std::shared_ptr<const dcp::Data> _data;
 	dcp::Size _size;
 	boost::optional<dcp::Eye> _eye;
@@ -57,8 +57,11 @@ using namespace dcpomatic;
 Job::Job (shared_ptr<const Film> film)
 	: _film (film)
 	, _state (NEW)
+	, _paused (false)
 	, _sub_start_time (0)
 	, _progress (0)
+	, _last_progress_update (0)
+	, _progress_emission_pending (false)
 {
 
 }
@@ -333,6 +336,30 @@ Job::paused_by_priority () const
 }
 
 
+/** Say that this job has done the work that needs the encoding threads and servers, and is
+ *  now just finishing off (writing metadata, computing digests, uploading and so on).
+ *  The JobManager may then start the next serial job alongside this one.
+ */
+void
+Job::set_finishing ()
+{
+	{
+		boost::mutex::scoped_lock lm (_state_mutex);
+		_finishing = true;
+	}
+
+	FinishingImmediate ();
+}
+
+
+bool
+Job::finishing () const
+{
+	boost::mutex::scoped_lock lm (_state_mutex);
+	return _finishing;
+}
+
+
 /** Set the state of this job.
  *  @param s New state.
  */
@@ -348,6 +375,7 @@ Job::set_state (State s)
 		}
 
 		_state = s;
+		_paused = _state == PAUSED_BY_USER || _state == PAUSED_BY_PRIORITY;
 
 		if (_state == FINISHED_OK || _state == FINISHED_ERROR || _state == FINISHED_CANCELLED) {
 			_finish_time = time(nullptr);
@@ -400,6 +428,11 @@ Job::check_for_interruption_or_pause ()
 {
 	boost::this_thread::interruption_point ();
 
+	if (!_paused) {
+		/* Avoid taking the lock in the common case, as this is called whenever progress is set */
+		return;
+	}
+
 	boost::mutex::scoped_lock lm (_state_mutex);
 	while (_state == PAUSED_BY_USER || _state == PAUSED_BY_PRIORITY) {
 		emit (boost::bind (boost::ref (Progress)));
@@ -408,22 +441,31 @@ Job::check_for_interruption_or_pause ()
 }
 
 
+/** @return Current time in microseconds since the epoch */
+static
+int64_t
+now_us ()
+{
+	struct timeval now;
+	gettimeofday (&now, 0);
+	return int64_t(now.tv_sec) * 1000000 + now.tv_usec;
+}
+
+
 optional<float>
 Job::seconds_since_last_progress_update () const
 {
-	boost::mutex::scoped_lock lm (_progress_mutex);
-	if (!_last_progress_update) {
+	auto const last = _last_progress_update.load();
+	if (last == 0) {
 		return {};
 	}
 
-	struct timeval now;
-	gettimeofday (&now, 0);
-
-	return seconds(now) - seconds(*_last_progress_update);
+	return (now_us() - last) / 1e6;
 }
 
 
-/** Set the progress of the current part of the job.
+/** Set the progress of the current part of the job.  This is cheap enough to call
+ *  very often; updates which come too soon after the last one are dropped.
  *  @param p Progress (from 0 to 1)
  *  @param force Do not ignore this update, even if it hasn't been long since the last one.
  */
@@ -432,18 +474,19 @@ Job::set_progress (float p, bool force)
 {
 	check_for_interruption_or_pause ();
 
-	if (!force) {
+	auto const now = now_us ();
+	if (force) {
+		_last_progress_update = now;
+	} else {
 		/* Check for excessively frequent progress reporting */
-		boost::mutex::scoped_lock lm (_progress_mutex);
-		struct timeval now;
-		gettimeofday (&now, 0);
-		if (_last_progress_update && _last_progress_update->tv_sec > 0) {
-			double const elapsed = seconds(now) - seconds(*_last_progress_update);
-			if (elapsed < 0.5) {
-				return;
-			}
+		auto last = _last_progress_update.load();
+		if (last != 0 && (now - last) < 500000) {
+			return;
+		}
+		if (!_last_progress_update.compare_exchange_strong(last, now)) {
+			/* Another thread just did an update */
+			return;
 		}
-		_last_progress_update = now;
 	}
 
 	set_progress_common (p);
@@ -453,21 +496,34 @@ Job::set_progress (float p, bool force)
 void
 Job::set_progress_common (optional<float> p)
 {
-	{
-		boost::mutex::scoped_lock lm (_progress_mutex);
-		_progress = p;
+	_progress = p ? *p : -1;
+
+	/* Only have one Progress emission waiting for the UI thread at a time; when it
+	   arrives the handlers will see whatever the latest progress is.
+	*/
+	if (!_progress_emission_pending.exchange(true)) {
+		emit (boost::bind(&Job::emit_progress, this));
 	}
+}
 
-	emit (boost::bind (boost::ref (Progress)));
+
+void
+Job::emit_progress ()
+{
+	_progress_emission_pending = false;
+	Progress ();
 }
 
 
-/** @return fractional progress of the current sub-job, if known */
+/** @return Progress of the current sub-job (from 0 to 1), or empty if it is not known */
 optional<float>
 Job::progress () const
 {
-	boost::mutex::scoped_lock lm (_progress_mutex);
-	return _progress;
+	auto const p = _progress.load();
+	if (p < 0) {
+		return {};
+	}
+	return p;
 }
 
 
@@ -678,6 +734,7 @@ Job::pause_by_user ()
 		if (_state == RUNNING) {
 			paused = true;
 			_state = PAUSED_BY_USER;
+			_paused = true;
 		}
 	}
 
@@ -26,6 +26,7 @@
 #define DCPOMATIC_JOB_H
 
 #include "signaller.h"
+#include <boost/atomic.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/signals2.hpp>
 #include <boost/thread.hpp>
@@ -54,6 +55,26 @@ public:
 	virtual bool enable_notify () const {
 		return false;
 	}
+	/** @return true if this job can run at the same time as other jobs which return true here.
+	 *  Such jobs must not depend on each other's results.
+	 */
+	virtual bool parallel () const {
+		return false;
+	}
+
+	/** The resource that a job spends most of its time waiting for */
+	enum class Resource {
+		CPU,
+		DISK,
+		NETWORK
+	};
+
+	/** @return the resource that this job mostly uses; jobs which are not parallel() can run
+	 *  at the same time as each other if they use different resources.
+	 */
+	virtual Resource resource () const {
+		return Resource::CPU;
+	}
 
 	void start ();
 	bool pause_by_user ();
@@ -91,6 +112,9 @@ public:
 		return _film;
 	}
 
+	void set_finishing ();
+	bool finishing () const;
+
 	enum class Result {
 		RESULT_OK,
 		RESULT_ERROR,     // we can't have plain ERROR on Windows
@@ -104,6 +128,8 @@ public:
 	boost::signals2::signal<void (Result)> Finished;
 	/** Emitted from the job thread when the job is finished */
 	boost::signals2::signal<void (Result)> FinishedImmediate;
+	/** Emitted from the job thread when set_finishing() is called */
+	boost::signals2::signal<void ()> FinishingImmediate;
 
 protected:
 
@@ -137,6 +163,7 @@ private:
 
 	void run_wrapper ();
 	void set_progress_common (boost::optional<float> p);
+	void emit_progress ();
 
 	boost::thread _thread;
 
@@ -144,20 +171,28 @@ private:
 	mutable boost::mutex _state_mutex;
 	/** current state of the job */
 	State _state;
+	/** true if _state is PAUSED_BY_USER or PAUSED_BY_PRIORITY; this can be read without the lock */
+	boost::atomic<bool> _paused;
 	/** summary of an error that has occurred (when state == FINISHED_ERROR) */
 	std::string _error_summary;
 	std::string _error_details;
 	/** a message that should be given to the user when the job finishes */
 	boost::optional<std::string> _message;
+	/** true if the job has done its heavy work and is just finishing off */
+	bool _finishing = false;
 
 	/** time that this sub-job was started */
 	time_t _sub_start_time;
 	std::string _sub_name;
 
-	/** mutex for _progress and _last_progress_update */
+	/** mutex for _sub_name */
 	mutable boost::mutex _progress_mutex;
-	boost::optional<float> _progress;
-	boost::optional<struct timeval> _last_progress_update;
+	/** progress of the current sub-job from 0 to 1, or negative if it is unknown */
+	boost::atomic<float> _progress;
+	/** time of the last progress update in microseconds since the epoch, or 0 if there has been none */
+	boost::atomic<int64_t> _last_progress_update;
+	/** true if a Progress emission is waiting to be made in the UI thread */
+	boost::atomic<bool> _progress_emission_pending;
 
 	/** condition to signal changes to pause/resume so that we know when to wake;
 	    this could be a general _state_change if it made more sense.
@@ -26,18 +26,22 @@
 
 #include "analyse_audio_job.h"
 #include "analyse_subtitles_job.h"
+#include "config.h"
 #include "cross.h"
 #include "film.h"
 #include "job.h"
 #include "job_manager.h"
 #include "util.h"
 #include <boost/thread.hpp>
+#include <map>
+#include <set>
 
 
 using std::dynamic_pointer_cast;
 using std::function;
 using std::list;
 using std::make_shared;
+using std::max;
 using std::shared_ptr;
 using std::string;
 using std::weak_ptr;
@@ -151,6 +155,25 @@ JobManager::errors () const
 }
 
 
+/** @return the number of serial jobs using a resource which may run at the same time */
+static int
+resource_limit (Job::Resource resource)
+{
+	switch (resource) {
+	case Job::Resource::CPU:
+		/* Jobs using the CPU will use all of it */
+		return 1;
+	case Job::Resource::DISK:
+		/* Jobs using the same disk at the same time will only slow each other down */
+		return 1;
+	case Job::Resource::NETWORK:
+		return 2;
+	}
+
+	return 1;
+}
+
+
 void
 JobManager::scheduler ()
 {
@@ -164,45 +187,159 @@ JobManager::scheduler ()
 			break;
 		}
 
-		bool have_running = false;
+		int const parallel_limit = max(1, Config::instance()->parallel_examine_jobs());
+		int parallel_running = 0;
+
+		/* Parallel jobs must not run alongside a serial job for the same film, as the serial
+		 * job might be using the content that they are examining.  A serial job must also wait
+		 * for any parallel jobs for its film which are running or come before it, so that (for
+		 * example) a transcode sees the results of examinations that were asked for first.
+		 */
+		std::set<shared_ptr<const Film>> serial_films;
+		std::set<shared_ptr<const Film>> parallel_films;
+		for (auto i: _jobs) {
+			if (i->running() && i->film()) {
+				(i->parallel() ? parallel_films : serial_films).insert(i->film());
+			}
+		}
+
+		/* Number of serial jobs which are running, or are next in line to run, using each resource */
+		std::map<Job::Resource, int> claimed;
+		/* Resources for which a serial job is finishing off, with the next serial job allowed to run alongside it */
+		std::set<Job::Resource> finishing;
+		/* Films of serial jobs that are earlier in the list and not yet finished; later serial jobs for these films must wait */
+		std::set<shared_ptr<const Film>> earlier_films;
 		for (auto i: _jobs) {
-			if ((have_running || _paused) && i->running()) {
-				/* We already have a running job, or are totally paused, so this job should not be running */
+			if (i->parallel()) {
+				if (!i->finished() && i->film()) {
+					parallel_films.insert(i->film());
+				}
+				if (i->running()) {
+					if (_paused || parallel_running >= parallel_limit) {
+						i->pause_by_priority();
+					} else {
+						++parallel_running;
+					}
+				} else if (
+					!_paused &&
+					parallel_running < parallel_limit &&
+					(i->is_new() || i->paused_by_priority()) &&
+					serial_films.find(i->film()) == serial_films.end()) {
+					start_or_resume (i);
+					++parallel_running;
+				}
+				continue;
+			}
+
+			auto const resource = i->resource();
+			auto const film = i->film();
+			bool const film_waiting = film && earlier_films.find(film) != earlier_films.end();
+			if (film && !i->finished() && !i->paused_by_user()) {
+				earlier_films.insert(film);
+			}
+
+			if (claimed[resource] == 0 && finishing.find(resource) == finishing.end() && !_paused && i->running() && i->finishing()) {
+				/* This job no longer needs its resource, so the next one can start */
+				finishing.insert(resource);
+				continue;
+			}
+
+			bool const full = claimed[resource] >= resource_limit(resource);
+
+			if ((full || _paused || film_waiting) && i->running()) {
+				/* We already have enough running jobs using this resource, or an earlier job for the
+				 * same film must run first, or we are totally paused, so this job should not be running.
+				 */
 				i->pause_by_priority();
-			} else if (!have_running && !_paused && (i->is_new() || i->paused_by_priority())) {
-				/* We don't have a running job, and we should have one, so start/resume this */
-				if (i->is_new()) {
-					_connections.push_back (i->FinishedImmediate.connect(bind(&JobManager::job_finished, this)));
-					i->start ();
-				} else {
-					i->resume ();
+			} else if (!full && !_paused && (i->is_new() || i->paused_by_priority())) {
+				if (film) {
+					/* Stop any later parallel jobs for this film starting */
+					serial_films.insert(film);
+				}
+				++claimed[resource];
+				if (film_waiting) {
+					/* This job must wait for an earlier one for the same film (perhaps one which is
+					 * finishing off), and so must everything after it which uses the same resource.
+					 */
+					continue;
 				}
-				emit (boost::bind (boost::ref (ActiveJobsChanged), _last_active_job, i->json_name()));
-				_last_active_job = i->json_name ();
-				have_running = true;
-			} else if (!have_running && i->running()) {
-				have_running = true;
+				if (film && parallel_films.find(film) != parallel_films.end()) {
+					/* This job must wait for some parallel jobs, and so must everything after it which uses the same resource */
+					continue;
+				}
+				/* We have room for a job using this resource, so start/resume this */
+				start_or_resume (i);
+			} else if (!full && i->running()) {
+				++claimed[resource];
 			}
 		}
 
+		update_active_job ();
+
 		_schedule_condition.wait(lm);
 	}
 }
 
 
+/** Start a job if it is new, otherwise resume it.  Must be called with _mutex held */
+void
+JobManager::start_or_resume (shared_ptr<Job> job)
+{
+	if (job->is_new()) {
+		_connections.push_back (job->FinishedImmediate.connect(bind(&JobManager::job_finished, this)));
+		_connections.push_back (job->FinishingImmediate.connect(bind(&JobManager::job_finished, this)));
+		job->start ();
+	} else {
+		job->resume ();
+	}
+}
+
+
 void
 JobManager::job_finished ()
 {
 	{
 		boost::mutex::scoped_lock lm (_mutex);
-		emit (boost::bind(boost::ref (ActiveJobsChanged), _last_active_job, optional<string>()));
-		_last_active_job = optional<string>();
+		update_active_job ();
 	}
 
 	_schedule_condition.notify_all();
 }
 
 
+/** Emit ActiveJobsChanged if the job that we consider active has changed.  This is
+ *  the running job which is not parallel, if there is one, otherwise one which
+ *  the user has paused, otherwise the first running parallel job.  Must be called
+ *  with _mutex held.
+ */
+void
+JobManager::update_active_job ()
+{
+	optional<string> serial;
+	optional<string> paused;
+	optional<string> parallel;
+	for (auto i: _jobs) {
+		if (i->running()) {
+			if (!i->parallel()) {
+				serial = i->json_name();
+				break;
+			} else if (!parallel) {
+				parallel = i->json_name();
+			}
+		} else if (i->paused_by_user() && !paused) {
+			paused = i->json_name();
+		}
+	}
+
+	auto const active = serial ? serial : (paused ? paused : parallel);
+
+	if (active != _last_active_job) {
+		emit (boost::bind(boost::ref(ActiveJobsChanged), _last_active_job, active));
+		_last_active_job = active;
+	}
+}
+
+
 JobManager *
 JobManager::instance ()
 {
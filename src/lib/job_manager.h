@@ -21,6 +21,12 @@
 
 /** @file  src/job_manager.h
  *  @brief A simple scheduler for jobs.
+ *
+ *  Jobs are run in order, with a limited number at a time for each resource that they
+ *  use (see Job::resource()), so that (for example) an upload can run alongside a
+ *  transcode.  Jobs for the same film still run one at a time, in order.  A limited
+ *  number of jobs which say that they can run in parallel (see Job::parallel()) run
+ *  at the same time as each other and as the other jobs.
  */
 
 
@@ -96,7 +102,9 @@ private:
 	~JobManager ();
 	void scheduler ();
 	void start ();
+	void start_or_resume (std::shared_ptr<Job> job);
 	void job_finished ();
+	void update_active_job ();
 
 	mutable boost::mutex _mutex;
 	boost::condition _schedule_condition;
@@ -105,6 +113,7 @@ private:
 	std::list<boost::signals2::connection> _connections;
 	bool _terminate = false;
 
+	/** json_name of the job that we last announced as active with ActiveJobsChanged */
 	boost::optional<std::string> _last_active_job;
 	boost::thread _scheduler;
 
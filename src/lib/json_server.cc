@@ -25,6 +25,7 @@
 #include "json_server.h"
 #include "transcode_job.h"
 #include <dcp/raw_convert.h>
+#include <boost/algorithm/string.hpp>
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/thread.hpp>
@@ -36,8 +37,10 @@ using std::dynamic_pointer_cast;
 using std::list;
 using std::make_shared;
 using std::map;
+using std::pair;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using boost::asio::ip::tcp;
 using boost::thread;
 using dcp::raw_convert;
@@ -198,6 +201,81 @@ split_get_request(string url)
 }
 
 
+/** @return the TranscodeJobs that are currently running, with their indices in the JobManager's list */
+static
+vector<pair<int, shared_ptr<TranscodeJob>>>
+running_transcode_jobs ()
+{
+	vector<pair<int, shared_ptr<TranscodeJob>>> running;
+
+	int index = 0;
+	for (auto job: JobManager::instance()->get()) {
+		auto transcode = dynamic_pointer_cast<TranscodeJob>(job);
+		if (transcode && transcode->running()) {
+			running.push_back({index, transcode});
+		}
+		++index;
+	}
+
+	return running;
+}
+
+
+/** @return metrics for any running encodes in Prometheus' text format */
+static
+string
+prometheus_metrics ()
+{
+	string text;
+	for (auto const& job: running_transcode_jobs()) {
+		for (auto const& metric: job.second->metrics()) {
+			text += "dcpomatic_" + metric.name + "{job=\"" + raw_convert<string>(job.first) + "\"";
+			if (metric.server) {
+				text += ",server=\"" + *metric.server + "\"";
+			}
+			text += "} " + raw_convert<string>(metric.value) + "\n";
+		}
+	}
+	return text;
+}
+
+
+/** @return metrics for any running encodes as JSON */
+static
+string
+json_metrics ()
+{
+	string json = "{ \"jobs\": [";
+
+	auto const jobs = running_transcode_jobs();
+	for (auto i = jobs.begin(); i != jobs.end(); ++i) {
+		if (i != jobs.begin()) {
+			json += ", ";
+		}
+		json += "{ \"index\": " + raw_convert<string>(i->first) + ", ";
+		if (i->second->film()) {
+			json += "\"dcp\": \"" + i->second->film()->dcp_name() + "\", ";
+		}
+		json += "\"metrics\": [";
+		auto const metrics = i->second->metrics();
+		for (auto j = metrics.begin(); j != metrics.end(); ++j) {
+			if (j != metrics.begin()) {
+				json += ", ";
+			}
+			json += "{ \"name\": \"" + j->name + "\", ";
+			if (j->server) {
+				json += "\"server\": \"" + *j->server + "\", ";
+			}
+			json += "\"value\": " + raw_convert<string>(j->value) + " }";
+		}
+		json += "] }";
+	}
+
+	json += "] }";
+	return json;
+}
+
+
 void
 JSONServer::request (string url, shared_ptr<tcp::socket> socket)
 {
@@ -214,7 +292,13 @@ JSONServer::request (string url, shared_ptr<tcp::socket> socket)
 	}
 
 	string json;
-	if (action == "status") {
+	string content_type = "application/json";
+	if (boost::algorithm::starts_with(url, "/metrics")) {
+		json = prometheus_metrics ();
+		content_type = "text/plain; version=0.0.4";
+	} else if (action == "metrics") {
+		json = json_metrics ();
+	} else if (action == "status") {
 
 		auto jobs = JobManager::instance()->get();
 
@@ -246,7 +330,7 @@ JSONServer::request (string url, shared_ptr<tcp::socket> socket)
 
 	string reply = "HTTP/1.1 200 OK\r\n"
 		"Content-Length: " + raw_convert<string>(json.length()) + "\r\n"
-		"Content-Type: application/json\r\n"
+		"Content-Type: " + content_type + "\r\n"
 		"\r\n"
 		+ json + "\r\n";
 	cout << "reply: " << json << "\n";
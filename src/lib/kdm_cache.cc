@@ -0,0 +1,164 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "config.h"
+#include "dcpomatic_log.h"
+#include "digester.h"
+#include "kdm_cache.h"
+#include "state.h"
+#include <dcp/certificate_chain.h>
+#include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
+#include <dcp/util.h>
+
+
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::optional;
+using dcp::raw_convert;
+
+
+KDMCache* KDMCache::_instance = nullptr;
+
+
+KDMCache::KDMCache(boost::filesystem::path directory)
+	: _directory(directory)
+{
+
+}
+
+
+KDMCache*
+KDMCache::instance()
+{
+	if (!_instance) {
+		_instance = new KDMCache(State::write_path("kdm_cache"));
+	}
+
+	return _instance;
+}
+
+
+dcp::EncryptedKDM
+KDMCache::encrypt(
+	dcp::DecryptedKDM const& kdm,
+	dcp::LocalTime valid_from,
+	dcp::LocalTime valid_to,
+	shared_ptr<const dcp::CertificateChain> signer,
+	dcp::Certificate recipient,
+	vector<string> trusted_devices,
+	dcp::Formulation formulation,
+	bool disable_forensic_marking_picture,
+	optional<int> disable_forensic_marking_audio
+	)
+{
+	/* Everything that ends up in the KDM, except the issue date */
+	string description;
+	auto add = [&description](string const& s) {
+		description += s;
+		description += '\n';
+	};
+
+	for (auto const& key: kdm.keys()) {
+		add(key.cpl_id());
+		add(key.id());
+		add(key.type().get_value_or(""));
+		add(key.key().hex());
+		add(raw_convert<string>(static_cast<int>(key.standard())));
+	}
+	add(kdm.annotation_text().get_value_or(""));
+	add(kdm.content_title_text());
+	add(valid_from.as_string());
+	add(valid_to.as_string());
+	add(signer->leaf().thumbprint());
+	add(recipient.thumbprint());
+	for (auto const& device: trusted_devices) {
+		add(device);
+	}
+	add(raw_convert<string>(static_cast<int>(formulation)));
+	add(disable_forensic_marking_picture ? "1" : "0");
+	add(disable_forensic_marking_audio ? raw_convert<string>(*disable_forensic_marking_audio) : "");
+
+	Digester digester;
+	digester.add(description);
+	auto const digest = digester.get();
+
+	shared_ptr<boost::mutex> kdm_mutex;
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		auto& m = _kdm_mutexes[digest];
+		if (!m) {
+			m = make_shared<boost::mutex>();
+		}
+		kdm_mutex = m;
+	}
+
+	boost::mutex::scoped_lock lm(*kdm_mutex);
+
+	auto const file = _directory / (digest + ".xml");
+	if (dcp::filesystem::exists(file)) {
+		try {
+			return dcp::EncryptedKDM(dcp::file_to_string(file));
+		} catch (std::exception& e) {
+			LOG_WARNING("Could not read cached KDM %1 (%2); making it again", file.string(), e.what());
+		}
+	}
+
+	auto encrypted = kdm.encrypt(signer, recipient, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
+
+	try {
+		/* Write to a temporary file first so that another process never sees half a KDM */
+		auto const tmp = _directory / (digest + ".xml.tmp");
+		dcp::filesystem::create_directories(_directory);
+		encrypted.as_xml(tmp);
+		dcp::filesystem::rename(tmp, file);
+	} catch (std::exception& e) {
+		LOG_WARNING("Could not write KDM to cache (%1)", e.what());
+	}
+
+	return encrypted;
+}
+
+
+dcp::EncryptedKDM
+encrypt_kdm(
+	dcp::DecryptedKDM const& kdm,
+	dcp::LocalTime valid_from,
+	dcp::LocalTime valid_to,
+	shared_ptr<const dcp::CertificateChain> signer,
+	dcp::Certificate recipient,
+	vector<string> trusted_devices,
+	dcp::Formulation formulation,
+	bool disable_forensic_marking_picture,
+	optional<int> disable_forensic_marking_audio
+	)
+{
+	if (Config::instance()->kdm_cache()) {
+		return KDMCache::instance()->encrypt(
+			kdm, valid_from, valid_to, signer, recipient, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio
+			);
+	}
+
+	return kdm.encrypt(signer, recipient, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
+}
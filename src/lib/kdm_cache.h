@@ -0,0 +1,105 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef DCPOMATIC_KDM_CACHE_H
+#define DCPOMATIC_KDM_CACHE_H
+
+
+#include <dcp/certificate.h>
+#include <dcp/decrypted_kdm.h>
+#include <dcp/encrypted_kdm.h>
+#include <dcp/local_time.h>
+#include <dcp/types.h>
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace dcp {
+	class CertificateChain;
+}
+
+
+/** @class KDMCache
+ *  @brief Store of KDMs that have been made, so that identical ones need not be made again.
+ *
+ *  Encrypting and signing KDMs is slow, so when a release's screens or validity periods
+ *  change it's better to make only the KDMs which are different.  Each KDM is kept on disk,
+ *  named by a digest of everything that went into it: the keys, validity period, recipient,
+ *  trusted devices, formulation, forensic marking settings and signer.  Screens with the
+ *  same certificate therefore share a KDM, even within one run.
+ */
+class KDMCache
+{
+public:
+	explicit KDMCache(boost::filesystem::path directory);
+
+	KDMCache(KDMCache const&) = delete;
+	KDMCache& operator=(KDMCache const&) = delete;
+
+	dcp::EncryptedKDM encrypt(
+		dcp::DecryptedKDM const& kdm,
+		dcp::LocalTime valid_from,
+		dcp::LocalTime valid_to,
+		std::shared_ptr<const dcp::CertificateChain> signer,
+		dcp::Certificate recipient,
+		std::vector<std::string> trusted_devices,
+		dcp::Formulation formulation,
+		bool disable_forensic_marking_picture,
+		boost::optional<int> disable_forensic_marking_audio
+		);
+
+	static KDMCache* instance();
+
+private:
+	boost::filesystem::path _directory;
+
+	boost::mutex _mutex;
+	/** A mutex for each KDM that has been asked for, so that when several threads ask for the
+	 *  same one at once only the first makes it.
+	 */
+	std::map<std::string, std::shared_ptr<boost::mutex>> _kdm_mutexes;
+
+	static KDMCache* _instance;
+};
+
+
+/** Encrypt a KDM for a recipient, using KDMCache if Config says that we should */
+dcp::EncryptedKDM
+encrypt_kdm(
+	dcp::DecryptedKDM const& kdm,
+	dcp::LocalTime valid_from,
+	dcp::LocalTime valid_to,
+	std::shared_ptr<const dcp::CertificateChain> signer,
+	dcp::Certificate recipient,
+	std::vector<std::string> trusted_devices,
+	dcp::Formulation formulation,
+	bool disable_forensic_marking_picture,
+	boost::optional<int> disable_forensic_marking_audio
+	);
+
+
+#endif
@@ -30,8 +30,11 @@
 #include "emailer.h"
 #include "exceptions.h"
 #include "film.h"
+#include "kdm_cache.h"
+#include "kdm_source.h"
 #include "kdm_with_metadata.h"
 #include "screen.h"
+#include "util.h"
 #include <dcp/certificate.h>
 #include <dcp/decrypted_kdm.h>
 #include <dcp/encrypted_kdm.h>
@@ -184,21 +187,12 @@ static
 shared_ptr<Cinema>
 find_cinema (string cinema_name)
 {
-	auto cinemas = Config::instance()->cinemas ();
-	auto i = cinemas.begin();
-	while (
-		i != cinemas.end() &&
-		(*i)->name != cinema_name &&
-		find ((*i)->emails.begin(), (*i)->emails.end(), cinema_name) == (*i)->emails.end()) {
-
-		++i;
-	}
-
-	if (i == cinemas.end ()) {
+	auto cinema = Config::instance()->cinema_by_name_or_email(cinema_name);
+	if (!cinema) {
 		throw KDMCLIError (String::compose("could not find cinema \"%1\"", cinema_name));
 	}
 
-	return *i;
+	return cinema;
 }
 
 
@@ -245,17 +239,11 @@ from_film (
 	std::vector<KDMCertificatePeriod> period_checks;
 
 	try {
-		list<KDMWithMetadataPtr> kdms;
-		for (auto i: screens) {
-			std::function<dcp::DecryptedKDM (dcp::LocalTime, dcp::LocalTime)> make_kdm = [film, cpl](dcp::LocalTime begin, dcp::LocalTime end) {
-				return film->make_kdm(cpl, begin, end);
-			};
-			auto p = kdm_for_screen(make_kdm, i, valid_from, valid_to, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio, period_checks);
-			if (p) {
-				kdms.push_back (p);
-			}
-		}
-
+		auto source = make_shared<const KDMSource>(*film, cpl);
+		std::function<dcp::DecryptedKDM (dcp::LocalTime, dcp::LocalTime)> make_kdm = [source](dcp::LocalTime begin, dcp::LocalTime end) {
+			return source->make(begin, end);
+		};
+		auto kdms = kdms_for_screens(make_kdm, screens, valid_from, valid_to, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio, period_checks);
 
 		if (find(period_checks.begin(), period_checks.end(), KDMCertificatePeriod::KDM_OUTSIDE_CERTIFICATE) != period_checks.end()) {
 			throw KDMCLIError(
@@ -324,7 +312,7 @@ kdm_from_dkdm (
 {
 	/* Signer for new KDM */
 	auto signer = Config::instance()->signer_chain ();
-	if (!signer->valid ()) {
+	if (!certificate_chain_valid(signer)) {
 		throw KDMCLIError ("signing certificate chain is invalid.");
 	}
 
@@ -341,7 +329,7 @@ kdm_from_dkdm (
 		kdm.add_key(j);
 	}
 
-	return kdm.encrypt (signer, target, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
+	return encrypt_kdm(kdm, valid_from, valid_to, signer, target, trusted_devices, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio);
 }
 
 
@@ -369,7 +357,7 @@ from_dkdm (
 	try {
 		list<KDMWithMetadataPtr> kdms;
 		for (auto i: screens) {
-			if (!i->recipient) {
+			if (!i->recipient()) {
 				continue;
 			}
 
@@ -381,7 +369,7 @@ from_dkdm (
 
 			auto const kdm = kdm_from_dkdm(
 							dkdm,
-							i->recipient.get(),
+							i->recipient().get(),
 							i->trusted_device_thumbprints(),
 							begin,
 							end,
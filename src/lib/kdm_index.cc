@@ -0,0 +1,152 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "constants.h"
+#include "kdm_index.h"
+#include <dcp/filesystem.h>
+#include <dcp/util.h>
+
+
+using std::map;
+using std::string;
+using boost::optional;
+
+
+KDMIndex* KDMIndex::_instance = nullptr;
+
+
+KDMIndex*
+KDMIndex::instance ()
+{
+	if (!_instance) {
+		_instance = new KDMIndex ();
+	}
+
+	return _instance;
+}
+
+
+/** Bring _entries up to date with the files in directory.  A lock must be held on _mutex */
+void
+KDMIndex::refresh (boost::filesystem::path directory)
+{
+	if (directory != _directory) {
+		_entries.clear ();
+		_directory = directory;
+	}
+
+	map<boost::filesystem::path, Entry> entries;
+
+	for (auto i: dcp::filesystem::directory_iterator(directory)) {
+		auto const path = i.path();
+		uintmax_t size = 0;
+		std::time_t modified = 0;
+		try {
+			if (!dcp::filesystem::is_regular_file(path)) {
+				continue;
+			}
+			size = dcp::filesystem::file_size(path);
+			modified = dcp::filesystem::last_write_time(path);
+		} catch (boost::filesystem::filesystem_error&) {
+			continue;
+		}
+
+		if (size >= MAX_KDM_SIZE) {
+			continue;
+		}
+
+		auto existing = _entries.find(path);
+		if (existing != _entries.end() && existing->second.modified == modified && existing->second.size == size) {
+			entries[path] = existing->second;
+			continue;
+		}
+
+		Entry entry = { modified, size, {}, {}, {} };
+		try {
+			dcp::EncryptedKDM kdm (dcp::file_to_string(path));
+			entry.cpl_id = kdm.cpl_id();
+			entry.not_valid_before = kdm.not_valid_before();
+			entry.not_valid_after = kdm.not_valid_after();
+		} catch (std::exception&) {
+			/* Not a KDM; we'll remember that so that we don't look at it again */
+		}
+
+		entries[path] = entry;
+	}
+
+	_entries = entries;
+}
+
+
+/** @return A KDM for a CPL from a directory.  KDMs which are valid now are preferred (the one
+ *  that lasts longest if there is more than one), then any which will become valid later.
+ *  Expired KDMs are never returned.
+ */
+optional<dcp::EncryptedKDM>
+KDMIndex::find (boost::filesystem::path directory, string cpl_id)
+{
+	if (cpl_id.empty()) {
+		return {};
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	try {
+		refresh (directory);
+	} catch (std::exception&) {
+		/* Perhaps the directory has gone; we'll use what we have */
+	}
+
+	dcp::LocalTime const now;
+
+	optional<boost::filesystem::path> best;
+	bool best_valid_now = false;
+	optional<dcp::LocalTime> best_not_valid_after;
+
+	for (auto const& i: _entries) {
+		auto const& entry = i.second;
+		if (entry.cpl_id != cpl_id || !entry.not_valid_after || *entry.not_valid_after < now) {
+			continue;
+		}
+
+		bool const valid_now = entry.not_valid_before && *entry.not_valid_before < now;
+		if (!best || (valid_now && !best_valid_now) || (valid_now == best_valid_now && *best_not_valid_after < *entry.not_valid_after)) {
+			best = i.first;
+			best_valid_now = valid_now;
+			best_not_valid_after = entry.not_valid_after;
+		}
+	}
+
+	if (!best) {
+		return {};
+	}
+
+	try {
+		return dcp::EncryptedKDM(dcp::file_to_string(*best));
+	} catch (std::exception&) {
+		/* It must have changed since we looked at it */
+		_entries.erase (*best);
+	}
+
+	return {};
+}
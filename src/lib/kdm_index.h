@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_KDM_INDEX_H
+#define DCPOMATIC_KDM_INDEX_H
+
+
+#include <dcp/encrypted_kdm.h>
+#include <dcp/local_time.h>
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+
+
+/** @class KDMIndex
+ *  @brief A record of which CPL each KDM in a directory is for, and when it is valid.
+ *
+ *  Each KDM file is only parsed again if its modification time or size changes, so
+ *  looking up the KDM for a CPL in a directory containing thousands of them is cheap.
+ */
+class KDMIndex
+{
+public:
+	KDMIndex (KDMIndex const&) = delete;
+	KDMIndex& operator= (KDMIndex const&) = delete;
+
+	boost::optional<dcp::EncryptedKDM> find (boost::filesystem::path directory, std::string cpl_id);
+
+	static KDMIndex* instance ();
+
+private:
+	KDMIndex () {}
+
+	void refresh (boost::filesystem::path directory);
+
+	struct Entry
+	{
+		std::time_t modified;
+		uintmax_t size;
+		/** ID of the CPL that this KDM is for, or empty if the file is not a valid KDM */
+		std::string cpl_id;
+		boost::optional<dcp::LocalTime> not_valid_before;
+		boost::optional<dcp::LocalTime> not_valid_after;
+	};
+
+	boost::mutex _mutex;
+	/** Directory that _entries describe */
+	boost::filesystem::path _directory;
+	std::map<boost::filesystem::path, Entry> _entries;
+
+	static KDMIndex* _instance;
+};
+
+
+#endif
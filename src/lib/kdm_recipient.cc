@@ -27,9 +27,9 @@ KDMRecipient::KDMRecipient (cxml::ConstNodePtr node)
 	, notes (node->optional_string_child("Notes").get_value_or(""))
 {
 	if (node->optional_string_child("Certificate")) {
-		recipient = dcp::Certificate (node->string_child("Certificate"));
+		_recipient_pem = node->string_child("Certificate");
 	} else if (node->optional_string_child("Recipient")) {
-		recipient = dcp::Certificate (node->string_child("Recipient"));
+		_recipient_pem = node->string_child("Recipient");
 	}
 
 	recipient_file = node->optional_string_child("RecipientFile");
@@ -40,8 +40,8 @@ void
 KDMRecipient::as_xml (xmlpp::Element* parent) const
 {
 	parent->add_child("Name")->add_child_text(name);
-	if (recipient) {
-		parent->add_child("Recipient")->add_child_text(recipient->certificate(true));
+	if (auto r = recipient()) {
+		parent->add_child("Recipient")->add_child_text(r->certificate(true));
 	}
 	if (recipient_file) {
 		parent->add_child("RecipientFile")->add_child_text(*recipient_file);
@@ -50,3 +50,25 @@ KDMRecipient::as_xml (xmlpp::Element* parent) const
 	parent->add_child("Notes")->add_child_text(notes);
 }
 
+
+/** This may parse the certificate, so it is not safe to call it on the same object from
+ *  more than one thread at once.
+ */
+boost::optional<dcp::Certificate>
+KDMRecipient::recipient () const
+{
+	if (_recipient_pem) {
+		_recipient = dcp::Certificate(*_recipient_pem);
+		_recipient_pem = boost::none;
+	}
+
+	return _recipient;
+}
+
+
+void
+KDMRecipient::set_recipient (boost::optional<dcp::Certificate> certificate)
+{
+	_recipient_pem = boost::none;
+	_recipient = certificate;
+}
@@ -39,8 +39,8 @@ public:
 	KDMRecipient (std::string const& name_, std::string const& notes_, boost::optional<dcp::Certificate> recipient_, boost::optional<std::string> recipient_file_)
 		: name (name_)
 		, notes (notes_)
-		, recipient (recipient_)
 		, recipient_file (recipient_file_)
+		, _recipient (recipient_)
 	{}
 
 	explicit KDMRecipient (cxml::ConstNodePtr);
@@ -49,13 +49,22 @@ public:
 
 	virtual void as_xml (xmlpp::Element *) const;
 
+	boost::optional<dcp::Certificate> recipient () const;
+	void set_recipient (boost::optional<dcp::Certificate> certificate);
+
 	std::string name;
 	std::string notes;
-	boost::optional<dcp::Certificate> recipient;
 	/** The pathname or URL that the recipient certificate was obtained from; purely
 	 *  to inform the user.
 	 */
 	boost::optional<std::string> recipient_file;
+
+private:
+	/** Recipient certificate as read from XML; it is only parsed (into _recipient) when
+	 *  someone asks for it, since there can be thousands of these in the config.
+	 */
+	mutable boost::optional<std::string> _recipient_pem;
+	mutable boost::optional<dcp::Certificate> _recipient;
 };
 
 
@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "config.h"
+#include "dcp_content.h"
+#include "dcpomatic_log.h"
+#include "film.h"
+#include "kdm_source.h"
+#include <dcp/cpl.h>
+#include <dcp/reel_file_asset.h>
+#include <list>
+
+#include "i18n.h"
+
+
+using std::dynamic_pointer_cast;
+using std::list;
+using std::make_shared;
+using std::runtime_error;
+
+
+KDMSource::KDMSource (Film const& film, boost::filesystem::path cpl_file)
+{
+	if (!film.encrypted()) {
+		throw runtime_error (_("Cannot make a KDM as this project is not encrypted."));
+	}
+
+	auto cpl = make_shared<dcp::CPL>(cpl_file);
+	_cpl = cpl;
+
+	/* Find keys that have been added to imported, encrypted DCP content */
+	list<dcp::DecryptedKDMKey> imported_keys;
+	for (auto i: film.content()) {
+		auto d = dynamic_pointer_cast<DCPContent> (i);
+		if (d && d->kdm()) {
+			dcp::DecryptedKDM kdm (d->kdm().get(), Config::instance()->decryption_chain()->key().get());
+			auto keys = kdm.keys ();
+			copy (keys.begin(), keys.end(), back_inserter (imported_keys));
+		}
+	}
+
+	for (auto asset: cpl->reel_file_assets()) {
+		if (!asset->encrypted()) {
+			continue;
+		}
+
+		/* Get any imported key for this ID */
+		bool done = false;
+		for (auto const& k: imported_keys) {
+			if (k.id() == asset->key_id().get()) {
+				LOG_GENERAL("Using imported key for %1", asset->key_id().get());
+				_keys[asset] = k.key();
+				done = true;
+			}
+		}
+
+		if (!done) {
+			/* No imported key; it must be an asset that we encrypted */
+			LOG_GENERAL("Using our own key for %1", asset->key_id().get());
+			_keys[asset] = film.key();
+		}
+	}
+}
+
+
+/*  @param from KDM from time expressed as a local time with an offset from UTC.
+ *  @param until KDM to time expressed as a local time with an offset from UTC.
+ */
+dcp::DecryptedKDM
+KDMSource::make (dcp::LocalTime from, dcp::LocalTime until) const
+{
+	return dcp::DecryptedKDM (
+		_cpl->id(), _keys, from, until, _cpl->content_title_text(), _cpl->content_title_text(), dcp::LocalTime().as_string()
+		);
+}
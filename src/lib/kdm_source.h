@@ -0,0 +1,68 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_KDM_SOURCE_H
+#define DCPOMATIC_KDM_SOURCE_H
+
+
+#include <dcp/decrypted_kdm.h>
+#include <dcp/key.h>
+#include <dcp/local_time.h>
+#include <boost/filesystem.hpp>
+#include <map>
+#include <memory>
+
+
+namespace dcp {
+	class CPL;
+	class ReelFileAsset;
+}
+
+class Film;
+
+
+/** @class KDMSource
+ *  @brief Everything needed to make KDMs for one of a film's CPLs.
+ *
+ *  Making one of these reads the CPL and decrypts the KDMs of any imported encrypted
+ *  DCPs, so that making many KDMs (e.g. one for each of a long list of screens) only
+ *  needs to do that once.  make() may be called from several threads at once.
+ */
+class KDMSource
+{
+public:
+	KDMSource (Film const& film, boost::filesystem::path cpl_file);
+
+	KDMSource (KDMSource const&) = delete;
+	KDMSource& operator= (KDMSource const&) = delete;
+
+	dcp::DecryptedKDM make (dcp::LocalTime from, dcp::LocalTime until) const;
+
+private:
+	std::shared_ptr<const dcp::CPL> _cpl;
+	/** Key for each of the CPL's encrypted assets */
+	std::map<std::shared_ptr<const dcp::ReelFileAsset>, dcp::Key> _keys;
+};
+
+
+#endif
@@ -24,12 +24,14 @@
 #include "cross.h"
 #include "dcpomatic_log.h"
 #include "emailer.h"
+#include "exceptions.h"
 #include "kdm_with_metadata.h"
 #include "screen.h"
 #include "util.h"
 #include "zipper.h"
 #include <dcp/file.h>
 #include <dcp/filesystem.h>
+#include <boost/thread.hpp>
 
 #include "i18n.h"
 
@@ -99,7 +101,8 @@ make_zip_file (list<KDMWithMetadataPtr> kdms, boost::filesystem::path zip_file,
 
 	for (auto i: kdms) {
 		auto const name = careful_string_filter(name_format.get(i->name_values(), ".xml"));
-		zipper.add (name, i->kdm_as_xml());
+		/* Only make each KDM's XML as it goes into the ZIP, so we don't need all of it at once */
+		zipper.add (name, [i]() { return i->kdm_as_xml(); });
 	}
 
 	zipper.close ();
@@ -191,7 +194,93 @@ write_zip_files (
 }
 
 
-/** Email one ZIP file per cinema to the cinema.
+/** Email one ZIP file to a cinema */
+static void
+send_email (
+	EmailSession& session,
+	list<KDMWithMetadataPtr> const& kdms_for_cinema,
+	dcp::NameFormat container_name_format,
+	dcp::NameFormat filename_format,
+	string cpl_name,
+	vector<string> extra_addresses
+	)
+{
+	auto config = Config::instance ();
+
+	auto first = kdms_for_cinema.front();
+
+	auto emails = first->emails();
+	std::copy(extra_addresses.begin(), extra_addresses.end(), std::back_inserter(emails));
+	if (emails.empty()) {
+		return;
+	}
+
+	auto zip_file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	dcp::filesystem::create_directories(zip_file);
+	zip_file /= container_name_format.get(first->name_values(), ".zip");
+	make_zip_file (kdms_for_cinema, zip_file, filename_format);
+
+	auto substitute_variables = [cpl_name, first](string target) {
+		boost::algorithm::replace_all(target, "$CPL_NAME", cpl_name);
+		boost::algorithm::replace_all(target, "$START_TIME", first->get('b').get_value_or(""));
+		boost::algorithm::replace_all(target, "$END_TIME", first->get('e').get_value_or(""));
+		boost::algorithm::replace_all(target, "$CINEMA_NAME", first->get('c').get_value_or(""));
+		boost::algorithm::replace_all(target, "$CINEMA_SHORT_NAME", first->get('c').get_value_or("").substr(0, 14));
+		return target;
+	};
+
+	auto subject = substitute_variables(config->kdm_subject());
+	auto body = substitute_variables(config->kdm_email());
+
+	string screens;
+	for (auto kdm: kdms_for_cinema) {
+		auto screen_name = kdm->get('s');
+		if (screen_name) {
+			screens += *screen_name + ", ";
+		}
+	}
+	boost::algorithm::replace_all (body, "$SCREENS", screens.substr (0, screens.length() - 2));
+
+	Emailer email (config->kdm_from(), { emails.front() }, subject, body);
+
+	/* Use CC for the second and subsequent email addresses, so we seem less spammy (#2310) */
+	for (auto cc = std::next(emails.begin()); cc != emails.end(); ++cc) {
+		email.add_cc(*cc);
+	}
+
+	for (auto cc: config->kdm_cc()) {
+		email.add_cc (cc);
+	}
+	if (!config->kdm_bcc().empty()) {
+		email.add_bcc (config->kdm_bcc());
+	}
+
+	email.add_attachment (zip_file, container_name_format.get(first->name_values(), ".zip"), "application/zip");
+
+	auto log_details = [](Emailer& email) {
+		dcpomatic_log->log("Email content follows", LogEntry::TYPE_DEBUG_EMAIL);
+		dcpomatic_log->log(email.email(), LogEntry::TYPE_DEBUG_EMAIL);
+		dcpomatic_log->log("Email session follows", LogEntry::TYPE_DEBUG_EMAIL);
+		dcpomatic_log->log(email.notes(), LogEntry::TYPE_DEBUG_EMAIL);
+	};
+
+	try {
+		email.send (session);
+	} catch (...) {
+		dcp::filesystem::remove(zip_file);
+		log_details (email);
+		throw;
+	}
+
+	log_details (email);
+
+	dcp::filesystem::remove(zip_file);
+}
+
+
+/** Email one ZIP file per cinema to the cinema.  Each connection to the mail server is
+ *  used for as many emails as possible, and Config::kdm_email_connections() connections
+ *  are used at the same time.  An email which fails is tried again once on a new connection.
  *  @param kdms KDMs to email.
  *  @param container_name_format Format of folder / ZIP to use.
  *  @param filename_format Format of filenames to use.
@@ -217,75 +306,62 @@ send_emails (
 		throw NetworkError(_("No KDM from address configured in preferences"));
 	}
 
-	for (auto const& kdms_for_cinema: kdms) {
+	vector<list<KDMWithMetadataPtr>> const kdms_by_cinema(kdms.begin(), kdms.end());
 
-		auto first = kdms_for_cinema.front();
+	boost::mutex mutex;
+	size_t next = 0;
+	std::exception_ptr exception;
 
-		auto zip_file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
-		dcp::filesystem::create_directories(zip_file);
-		zip_file /= container_name_format.get(first->name_values(), ".zip");
-		make_zip_file (kdms_for_cinema, zip_file, filename_format);
-
-		auto substitute_variables = [cpl_name, first](string target) {
-			boost::algorithm::replace_all(target, "$CPL_NAME", cpl_name);
-			boost::algorithm::replace_all(target, "$START_TIME", first->get('b').get_value_or(""));
-			boost::algorithm::replace_all(target, "$END_TIME", first->get('e').get_value_or(""));
-			boost::algorithm::replace_all(target, "$CINEMA_NAME", first->get('c').get_value_or(""));
-			boost::algorithm::replace_all(target, "$CINEMA_SHORT_NAME", first->get('c').get_value_or("").substr(0, 14));
-			return target;
+	auto worker = [&]() {
+		std::unique_ptr<EmailSession> session;
+		auto new_session = [&session, config]() {
+			session.reset(new EmailSession(config->mail_server(), config->mail_port(), config->mail_protocol(), config->mail_user(), config->mail_password()));
 		};
 
-		auto subject = substitute_variables(config->kdm_subject());
-		auto body = substitute_variables(config->kdm_email());
-
-		string screens;
-		for (auto kdm: kdms_for_cinema) {
-			auto screen_name = kdm->get('s');
-			if (screen_name) {
-				screens += *screen_name + ", ";
+		while (true) {
+			size_t index;
+			{
+				boost::mutex::scoped_lock lm (mutex);
+				if (next == kdms_by_cinema.size() || exception) {
+					return;
+				}
+				index = next++;
 			}
-		}
-		boost::algorithm::replace_all (body, "$SCREENS", screens.substr (0, screens.length() - 2));
-
-		auto emails = first->emails();
-		std::copy(extra_addresses.begin(), extra_addresses.end(), std::back_inserter(emails));
-		if (emails.empty()) {
-			continue;
-		}
-
-		Emailer email (config->kdm_from(), { emails.front() }, subject, body);
 
-		/* Use CC for the second and subsequent email addresses, so we seem less spammy (#2310) */
-		for (auto cc = std::next(emails.begin()); cc != emails.end(); ++cc) {
-			email.add_cc(*cc);
-		}
-
-		for (auto cc: config->kdm_cc()) {
-			email.add_cc (cc);
-		}
-		if (!config->kdm_bcc().empty()) {
-			email.add_bcc (config->kdm_bcc());
+			try {
+				try {
+					if (!session) {
+						new_session();
+					}
+					send_email(*session, kdms_by_cinema[index], container_name_format, filename_format, cpl_name, extra_addresses);
+				} catch (NetworkError& e) {
+					/* The server may have closed our connection, so try once more on a new one */
+					LOG_WARNING("Failed to send KDM email (%1); trying again", e.what());
+					new_session();
+					send_email(*session, kdms_by_cinema[index], container_name_format, filename_format, cpl_name, extra_addresses);
+				}
+			} catch (...) {
+				boost::mutex::scoped_lock lm (mutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+				return;
+			}
 		}
-
-		email.add_attachment (zip_file, container_name_format.get(first->name_values(), ".zip"), "application/zip");
-
-		auto log_details = [](Emailer& email) {
-			dcpomatic_log->log("Email content follows", LogEntry::TYPE_DEBUG_EMAIL);
-			dcpomatic_log->log(email.email(), LogEntry::TYPE_DEBUG_EMAIL);
-			dcpomatic_log->log("Email session follows", LogEntry::TYPE_DEBUG_EMAIL);
-			dcpomatic_log->log(email.notes(), LogEntry::TYPE_DEBUG_EMAIL);
-		};
-
-		try {
-			email.send (config->mail_server(), config->mail_port(), config->mail_protocol(), config->mail_user(), config->mail_password());
-		} catch (...) {
-			dcp::filesystem::remove(zip_file);
-			log_details (email);
-			throw;
+	};
+
+	auto const connections = std::min(static_cast<size_t>(std::max(1, config->kdm_email_connections())), kdms_by_cinema.size());
+	if (connections < 2) {
+		worker();
+	} else {
+		boost::thread_group group;
+		for (size_t i = 0; i < connections; ++i) {
+			group.create_thread(worker);
 		}
+		group.join_all();
+	}
 
-		log_details (email);
-
-		dcp::filesystem::remove(zip_file);
+	if (exception) {
+		std::rethrow_exception(exception);
 	}
 }
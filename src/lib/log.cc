@@ -41,6 +41,7 @@ using std::string;
 
 
 Log::Log ()
+	: _types (0)
 {
 
 }
@@ -49,12 +50,16 @@ Log::Log ()
 void
 Log::log (shared_ptr<const LogEntry> e)
 {
-	boost::mutex::scoped_lock lm (_mutex);
-
 	if ((_types & e->type()) == 0) {
 		return;
 	}
 
+	if (concurrent_do_log()) {
+		do_log (e);
+		return;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
 	do_log (e);
 }
 
@@ -63,15 +68,11 @@ Log::log (shared_ptr<const LogEntry> e)
 void
 Log::log (string message, int type)
 {
-	boost::mutex::scoped_lock lm (_mutex);
-
 	if ((_types & type) == 0) {
 		return;
 	}
 
-	auto e = make_shared<StringLogEntry>(type, message);
-
-	do_log (e);
+	log (make_shared<StringLogEntry>(type, message));
 }
 
 
@@ -95,6 +96,5 @@ Log::dcp_log (dcp::NoteType type, string m)
 void
 Log::set_types (int t)
 {
-	boost::mutex::scoped_lock lm (_mutex);
 	_types = t;
 }
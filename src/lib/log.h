@@ -33,6 +33,7 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/signals2.hpp>
+#include <atomic>
 #include <string>
 
 
@@ -72,9 +73,15 @@ protected:
 
 private:
 	virtual void do_log (std::shared_ptr<const LogEntry> entry) = 0;
+	/** @return true if do_log() may be called from several threads at the same time,
+	 *  so that log() need not take _mutex.
+	 */
+	virtual bool concurrent_do_log () const {
+		return false;
+	}
 
 	/** bit-field of log types which should be put into the log (others are ignored) */
-	int _types = 0;
+	std::atomic<int> _types;
 };
 
 
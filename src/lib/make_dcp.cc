@@ -28,6 +28,7 @@
 #include "film.h"
 #include "job_manager.h"
 #include "make_dcp.h"
+#include "review_export.h"
 #include <stdexcept>
 
 #include "i18n.h"
@@ -38,11 +39,15 @@ using std::make_shared;
 using std::runtime_error;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 
 
-/** Add suitable Jobs to the JobManager to create a DCP for a Film */
+/** Add suitable Jobs to the JobManager to create a DCP for a Film.
+ *  @param exports Files to export as well as the DCP; these will be made
+ *  in the same pass as the DCP if possible, or by jobs of their own otherwise.
+ */
 void
-make_dcp (shared_ptr<Film> film, TranscodeJob::ChangedBehaviour behaviour)
+make_dcp (shared_ptr<Film> film, TranscodeJob::ChangedBehaviour behaviour, vector<shared_ptr<ReviewExport>> exports)
 {
 	if (film->dcp_name().find("/") != string::npos) {
 		throw BadSettingError (_("name"), _("Cannot contain slashes"));
@@ -99,7 +104,25 @@ make_dcp (shared_ptr<Film> film, TranscodeJob::ChangedBehaviour behaviour)
 	LOG_GENERAL ("J2K bandwidth %1", film->j2k_bandwidth());
 
 	auto tj = make_shared<DCPTranscodeJob>(film, behaviour);
-	tj->set_encoder (make_shared<DCPEncoder>(film, tj));
+	auto encoder = make_shared<DCPEncoder>(film, tj);
+	bool const share_pass = ReviewExport::possible(film);
+	if (share_pass) {
+		for (auto i: exports) {
+			encoder->add_export(i);
+		}
+	}
+	tj->set_encoder (encoder);
 	JobManager::instance()->add (tj);
+
+	if (!share_pass) {
+		if (!exports.empty()) {
+			LOG_GENERAL_NC ("Exports cannot share the DCP's pass, so they will be made separately");
+		}
+		for (auto i: exports) {
+			auto job = make_shared<TranscodeJob>(film, behaviour);
+			job->set_encoder (i->make_encoder(film, job));
+			JobManager::instance()->add (job);
+		}
+	}
 }
 
@@ -20,10 +20,16 @@
 
 
 #include "transcode_job.h"
+#include <vector>
 
 
 class Film;
+class ReviewExport;
 
 
-void make_dcp (std::shared_ptr<Film> film, TranscodeJob::ChangedBehaviour behaviour);
+void make_dcp (
+	std::shared_ptr<Film> film,
+	TranscodeJob::ChangedBehaviour behaviour,
+	std::vector<std::shared_ptr<ReviewExport>> exports = {}
+	);
 
@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "dcpomatic_assert.h"
+#include "exceptions.h"
+#include "mapped_file.h"
+#ifdef DCPOMATIC_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <cerrno>
+
+
+using std::vector;
+
+
+MappedFile::MappedFile(boost::filesystem::path path)
+	: _path(path)
+{
+	_size = boost::filesystem::file_size(path);
+
+#ifdef DCPOMATIC_POSIX
+	auto fd = open(path.string().c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw OpenFileError(path, errno, OpenFileError::READ);
+	}
+	if (_size > 0) {
+		auto map = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			_map = reinterpret_cast<uint8_t const*>(map);
+			/* We will mostly be reading straight through */
+			madvise(map, _size, MADV_SEQUENTIAL);
+		}
+	}
+	/* The mapping stays valid after the descriptor is closed */
+	close(fd);
+	if (_map || _size == 0) {
+		return;
+	}
+#endif
+
+	_file.reset(new dcp::File(path, "rb"));
+	if (!*_file) {
+		throw OpenFileError(path, errno, OpenFileError::READ);
+	}
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef DCPOMATIC_POSIX
+	if (_map) {
+		munmap(const_cast<uint8_t*>(_map), _size);
+	}
+#endif
+}
+
+
+uint8_t const*
+MappedFile::get(int64_t offset, int64_t size)
+{
+	DCPOMATIC_ASSERT(offset >= 0 && size >= 0 && (offset + size) <= _size);
+
+	if (_map) {
+		return _map + offset;
+	}
+
+	if (size == 0) {
+		return nullptr;
+	}
+
+	_buffer.resize(size);
+	_file->seek(offset, SEEK_SET);
+	_file->checked_read(_buffer.data(), size);
+	return _buffer.data();
+}
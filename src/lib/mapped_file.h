@@ -0,0 +1,73 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  src/lib/mapped_file.h
+ *  @brief MappedFile class.
+ */
+
+
+#ifndef DCPOMATIC_MAPPED_FILE_H
+#define DCPOMATIC_MAPPED_FILE_H
+
+
+#include <dcp/file.h>
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+/** @class MappedFile
+ *  @brief Read-only random access to a file, which is memory-mapped where we know how to do that.
+ *
+ *  On other platforms the requested parts of the file are read into a buffer instead.
+ */
+class MappedFile
+{
+public:
+	explicit MappedFile(boost::filesystem::path path);
+	~MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	int64_t size() const {
+		return _size;
+	}
+
+	/** @return Pointer to size bytes of the file starting at offset.  This remains valid
+	 *  until the next call to get().
+	 */
+	uint8_t const* get(int64_t offset, int64_t size);
+
+private:
+	boost::filesystem::path _path;
+	int64_t _size = 0;
+	/** Start of the mapping, or nullptr if the file is not mapped */
+	uint8_t const* _map = nullptr;
+	/** File to read from when it is not mapped */
+	std::unique_ptr<dcp::File> _file;
+	std::vector<uint8_t> _buffer;
+};
+
+
+#endif
@@ -0,0 +1,52 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_METRIC_H
+#define DCPOMATIC_METRIC_H
+
+
+#include <boost/optional.hpp>
+#include <string>
+
+
+/** @class Metric
+ *  @brief A value describing the current state of some part of an encode, for monitoring.
+ */
+class Metric
+{
+public:
+	Metric (std::string name_, double value_, boost::optional<std::string> server_ = boost::none)
+		: name (name_)
+		, value (value_)
+		, server (server_)
+	{}
+
+	/** Name, in lower case with words separated by underscores */
+	std::string name;
+	double value;
+	/** Host name of the encoding server (or name of the local J2K backend) that this value is about, if any */
+	boost::optional<std::string> server;
+};
+
+
+#endif
@@ -37,17 +37,25 @@ using boost::optional;
 
 
 Nanomsg::Nanomsg (bool server)
+	: Nanomsg (server, NANOMSG_URL)
+{
+
+}
+
+
+/** @param url nanomsg URL to bind to (if server is true) or connect to */
+Nanomsg::Nanomsg (bool server, string url)
 {
 	_socket = nn_socket (AF_SP, NN_PAIR);
 	if (_socket < 0) {
 		throw runtime_error("Could not set up nanomsg socket");
 	}
 	if (server) {
-		if ((_endpoint = nn_bind(_socket, NANOMSG_URL)) < 0) {
+		if ((_endpoint = nn_bind(_socket, url.c_str())) < 0) {
 			throw runtime_error(String::compose("Could not bind nanomsg socket (%1)", errno));
 		}
 	} else {
-		if ((_endpoint = nn_connect(_socket, NANOMSG_URL)) < 0) {
+		if ((_endpoint = nn_connect(_socket, url.c_str())) < 0) {
 			throw runtime_error(String::compose("Could not connect nanomsg socket (%1)", errno));
 		}
 	}
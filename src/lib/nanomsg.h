@@ -28,6 +28,7 @@ class Nanomsg
 {
 public:
 	explicit Nanomsg (bool server);
+	Nanomsg (bool server, std::string url);
 	~Nanomsg ();
 
 	Nanomsg (Nanomsg const&) = delete;
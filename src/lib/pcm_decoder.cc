@@ -0,0 +1,261 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "audio_buffers.h"
+#include "audio_decoder.h"
+#include "audio_sample_conversion.h"
+#include "compose.hpp"
+#include "dcpomatic_log.h"
+#include "ffmpeg_audio_stream.h"
+#include "ffmpeg_content.h"
+#include "film.h"
+#include "pcm_decoder.h"
+#include <dcp/file.h>
+#include <cstring>
+
+
+using std::make_shared;
+using std::max;
+using std::min;
+using std::shared_ptr;
+using boost::optional;
+using namespace dcpomatic;
+
+
+/** Number of frames to emit from each call to pass() */
+static Frame const frames_per_pass = 4096;
+
+
+static uint32_t
+get_le(uint8_t const* p, int bytes)
+{
+	uint32_t v = 0;
+	for (int i = bytes - 1; i >= 0; --i) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+
+optional<PCMFormat>
+pcm_format(boost::filesystem::path path)
+{
+	dcp::File file(path, "rb");
+	if (!file) {
+		return {};
+	}
+
+	auto const file_size = static_cast<int64_t>(boost::filesystem::file_size(path));
+
+	uint8_t header[12];
+	/* RF64 files (for data larger than 4GB) aren't handled here; FFmpeg can read them */
+	if (file.read(header, 1, sizeof(header)) != sizeof(header) || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+		return {};
+	}
+
+	PCMFormat format;
+	bool have_format = false;
+	int64_t position = sizeof(header);
+
+	/* Look through the chunks for the format and then the data, skipping anything
+	 * else (e.g. the bext chunk in a BWF).
+	 */
+	while (position + 8 <= file_size) {
+		uint8_t chunk[8];
+		file.seek(position, SEEK_SET);
+		if (file.read(chunk, 1, sizeof(chunk)) != sizeof(chunk)) {
+			return {};
+		}
+		int64_t const size = get_le(chunk + 4, 4);
+		position += sizeof(chunk);
+
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			uint8_t fmt[40];
+			if (size < 16 || size > static_cast<int64_t>(sizeof(fmt)) || file.read(fmt, 1, size) != static_cast<size_t>(size)) {
+				return {};
+			}
+			auto code = get_le(fmt, 2);
+			if (code == 0xfffe) {
+				/* WAVE_FORMAT_EXTENSIBLE: the real format code is at the start of the sub-format GUID */
+				if (size < 40) {
+					return {};
+				}
+				code = get_le(fmt + 24, 2);
+			}
+			format.channels = get_le(fmt + 2, 2);
+			format.frame_rate = get_le(fmt + 4, 4);
+			format.block_align = get_le(fmt + 12, 2);
+			auto const bits = get_le(fmt + 14, 2);
+
+			if (code == 1 && bits == 16) {
+				format.sample = PCMFormat::Sample::S16;
+			} else if (code == 1 && bits == 24) {
+				format.sample = PCMFormat::Sample::S24;
+			} else if (code == 1 && bits == 32) {
+				format.sample = PCMFormat::Sample::S32;
+			} else if (code == 3 && bits == 32) {
+				format.sample = PCMFormat::Sample::FLOAT;
+			} else {
+				return {};
+			}
+
+			if (format.channels < 1 || format.frame_rate < 1 || format.block_align != static_cast<int>(format.channels * bits / 8)) {
+				return {};
+			}
+			have_format = true;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			if (!have_format) {
+				return {};
+			}
+			format.data_offset = position;
+			/* Some writers leave the size unset; just use whatever is in the file in that case */
+			format.frames = min(size, file_size - position) / format.block_align;
+			return format;
+		}
+
+		/* Chunks are padded to an even number of bytes */
+		position += size + (size & 1);
+	}
+
+	return {};
+}
+
+
+PCMDecoder::PCMDecoder(shared_ptr<const Film> film, shared_ptr<const FFmpegContent> content, bool fast)
+	: Decoder(film)
+	, _content(content)
+	, _stream(content->ffmpeg_audio_streams().front())
+	, _format(*pcm_format(content->path(0)))
+	, _file(content->path(0))
+{
+	audio = make_shared<AudioDecoder>(this, content->audio, fast);
+}
+
+
+bool
+PCMDecoder::can_decode(shared_ptr<const FFmpegContent> content)
+{
+	if (content->number_of_paths() != 1 || content->video || !content->audio || !content->subtitle_streams().empty()) {
+		return false;
+	}
+
+	auto streams = content->ffmpeg_audio_streams();
+	if (streams.size() != 1) {
+		return false;
+	}
+
+	auto format = pcm_format(content->path(0));
+	return format && format->channels == streams.front()->channels() && format->frame_rate == streams.front()->frame_rate();
+}
+
+
+bool
+PCMDecoder::pass()
+{
+	if (_next >= _format.frames) {
+		if (!_flushed) {
+			audio->flush();
+			_flushed = true;
+		}
+		return !flush_fill();
+	}
+
+	auto const frames = min(frames_per_pass, _format.frames - _next);
+	auto const samples = frames * _format.channels;
+	auto const bytes = frames * _format.block_align;
+
+	auto data = _file.get(_format.data_offset + _next * _format.block_align, bytes);
+
+	int const sample_bytes = _format.sample == PCMFormat::Sample::S16 ? 2 : 4;
+	if (_format.sample != PCMFormat::Sample::S24 && (reinterpret_cast<uintptr_t>(data) % sample_bytes) != 0) {
+		/* The data chunk need only be aligned to 2 bytes so 32-bit samples might not be
+		 * aligned well enough to read them directly.
+		 */
+		_aligned.resize(bytes);
+		memcpy(_aligned.data(), data, bytes);
+		data = _aligned.data();
+	}
+
+	_interleaved.resize(samples);
+
+	switch (_format.sample) {
+	case PCMFormat::Sample::S16:
+		s16_to_float(reinterpret_cast<int16_t const*>(data), _interleaved.data(), samples);
+		break;
+	case PCMFormat::Sample::S24:
+		s24_to_float(data, _interleaved.data(), samples);
+		break;
+	case PCMFormat::Sample::S32:
+		s32_to_float(reinterpret_cast<int32_t const*>(data), _interleaved.data(), samples);
+		break;
+	case PCMFormat::Sample::FLOAT:
+		memcpy(_interleaved.data(), data, samples * sizeof(float));
+		break;
+	}
+
+	auto buffers = make_shared<AudioBuffers>(_format.channels, frames);
+	deinterleave_float(_interleaved.data(), buffers->data(), _format.channels, frames);
+	audio->emit(film(), _stream, buffers, ContentTime::from_frames(_next, _format.frame_rate));
+
+	_next += frames;
+	return false;
+}
+
+
+/** Pad the end of the content with silence, as FFmpegDecoder does.
+ *  @return true if there was something to do.
+ */
+bool
+PCMDecoder::flush_fill()
+{
+	auto const frc = film()->active_frame_rate_change(_content->position());
+	auto const full_length = ContentTime(_content->full_length(film()), frc).ceil(frc.source);
+
+	if (audio->ignore()) {
+		return false;
+	}
+
+	auto const a = audio->stream_position(film(), _stream);
+	if (a <= ContentTime() || a >= full_length) {
+		return false;
+	}
+
+	LOG_DEBUG_PLAYER("PCM flush inserts silence at %1", to_string(a));
+	auto to_do = min(full_length - a, ContentTime::from_seconds(0.1));
+	auto silence = make_shared<AudioBuffers>(_format.channels, to_do.frames_ceil(_format.frame_rate));
+	silence->make_silent();
+	audio->emit(film(), _stream, silence, a, true);
+	return true;
+}
+
+
+void
+PCMDecoder::seek(ContentTime time, bool accurate)
+{
+	Decoder::seek(time, accurate);
+
+	/* Every frame is at a known offset in the file so there is no difference between
+	 * accurate and inaccurate seeks.
+	 */
+	_next = max(Frame(0), min(time.frames_floor(_format.frame_rate), _format.frames));
+	_flushed = false;
+}
@@ -0,0 +1,105 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  src/lib/pcm_decoder.h
+ *  @brief PCMDecoder class.
+ */
+
+
+#ifndef DCPOMATIC_PCM_DECODER_H
+#define DCPOMATIC_PCM_DECODER_H
+
+
+#include "decoder.h"
+#include "mapped_file.h"
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <vector>
+
+
+class FFmpegAudioStream;
+class FFmpegContent;
+
+
+/** Description of the sample data in an uncompressed WAV (or BWF) file */
+struct PCMFormat
+{
+	enum class Sample {
+		S16,
+		S24,
+		S32,
+		FLOAT
+	};
+
+	Sample sample = Sample::S16;
+	int channels = 0;
+	int frame_rate = 0;
+	/** Offset of the first sample from the start of the file, in bytes */
+	int64_t data_offset = 0;
+	/** Bytes per frame of all channels */
+	int block_align = 0;
+	int64_t frames = 0;
+};
+
+
+/** @return Format of the PCM sample data in a WAV file, or an empty optional if the
+ *  file is not a WAV that we can read ourselves.
+ */
+extern boost::optional<PCMFormat> pcm_format(boost::filesystem::path path);
+
+
+/** @class PCMDecoder
+ *  @brief A decoder for FFmpegContent which is a single uncompressed WAV/BWF file.
+ *
+ *  The samples are read straight out of a memory-mapping of the file, avoiding the
+ *  demuxing and decoding that FFmpeg would do, and seeks are exact.
+ */
+class PCMDecoder : public Decoder
+{
+public:
+	PCMDecoder(std::shared_ptr<const Film> film, std::shared_ptr<const FFmpegContent> content, bool fast);
+
+	/** @return true if content could be decoded by a PCMDecoder */
+	static bool can_decode(std::shared_ptr<const FFmpegContent> content);
+
+	bool pass() override;
+	void seek(dcpomatic::ContentTime time, bool accurate) override;
+
+private:
+	bool flush_fill();
+
+	std::shared_ptr<const FFmpegContent> _content;
+	std::shared_ptr<FFmpegAudioStream> _stream;
+	PCMFormat _format;
+	MappedFile _file;
+	/** Index of the next frame to emit */
+	Frame _next = 0;
+	/** true if we have flushed our AudioDecoder since the end of the data */
+	bool _flushed = false;
+	/** Samples converted to float, still interleaved */
+	std::vector<float> _interleaved;
+	/** Space for copies of samples which are not suitably aligned in the file */
+	std::vector<uint8_t> _aligned;
+};
+
+
+#endif
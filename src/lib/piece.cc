@@ -0,0 +1,73 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "content.h"
+#include "decode_ahead.h"
+#include "decoder.h"
+#include "piece.h"
+
+
+using std::shared_ptr;
+using namespace dcpomatic;
+
+
+Piece::Piece (shared_ptr<const Film> film, shared_ptr<Content> c, shared_ptr<Decoder> d, FrameRateChange f)
+	: content (c)
+	, decoder (d)
+	, frc (f)
+	, done (false)
+{
+	if (content && film) {
+		position = content->position();
+		length_after_trim = content->length_after_trim(film);
+		end = position + length_after_trim;
+		trim_start = content->trim_start();
+		trim_start_dcp = DCPTime(trim_start, frc);
+	}
+}
+
+
+ContentTime
+Piece::decoder_position () const
+{
+	return decode_ahead ? decode_ahead->position() : decoder->position();
+}
+
+
+/** @return true if the decoder will emit no more data unless a seek() happens */
+bool
+Piece::decoder_pass ()
+{
+	return decode_ahead ? decode_ahead->pass() : decoder->pass();
+}
+
+
+void
+Piece::decoder_seek (ContentTime time, bool accurate)
+{
+	if (decode_ahead) {
+		decode_ahead->seek(time, accurate);
+	} else {
+		decoder->seek(time, accurate);
+	}
+}
@@ -25,28 +25,52 @@
 
 #include "dcpomatic_time.h"
 #include "frame_rate_change.h"
+#include <boost/optional.hpp>
+#include <memory>
 #include <vector>
 
 
 class Content;
+class DecodeAhead;
 class Decoder;
+class Film;
 
 
 class Piece
 {
 public:
-	Piece (std::shared_ptr<Content> c, std::shared_ptr<Decoder> d, FrameRateChange f)
-		: content (c)
-		, decoder (d)
-		, frc (f)
-		, done (false)
-	{}
+	Piece (std::shared_ptr<const Film> film, std::shared_ptr<Content> c, std::shared_ptr<Decoder> d, FrameRateChange f);
+
+	dcpomatic::ContentTime decoder_position () const;
+	bool decoder_pass ();
+	void decoder_seek (dcpomatic::ContentTime time, bool accurate);
 
 	std::shared_ptr<Content> content;
 	std::shared_ptr<Decoder> decoder;
+	/** If set, this is running our decoder on its own thread and decoder_{position,pass,seek}
+	 *  must go through it rather than straight to the decoder.
+	 */
+	std::shared_ptr<DecodeAhead> decode_ahead;
 	std::vector<dcpomatic::DCPTimePeriod> ignore_video;
 	std::vector<dcpomatic::DCPTimePeriod> ignore_atmos;
 	FrameRateChange frc;
+
+	/* These come from content when the piece is made, so that Player does not have to work
+	   them out for every frame; any change to them makes Player make new pieces.
+	*/
+	/** content's position in the DCP */
+	dcpomatic::DCPTime position;
+	/** content's end in the DCP */
+	dcpomatic::DCPTime end;
+	/** content's length in the DCP after trimming */
+	dcpomatic::DCPTime length_after_trim;
+	/** content's start trim */
+	dcpomatic::ContentTime trim_start;
+	/** trim_start converted to DCP time using frc */
+	dcpomatic::DCPTime trim_start_dcp;
+
+	/** log2 of the reduction that our decoder was asked to use for FFmpeg video, if any */
+	boost::optional<int> ffmpeg_decode_reduction;
 	bool done;
 };
 
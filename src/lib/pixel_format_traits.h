@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/pixel_format_traits.h
+ *  @brief Compile-time descriptions of the pixel formats which have specialised code in Image.
+ */
+
+
+#ifndef DCPOMATIC_PIXEL_FORMAT_TRAITS_H
+#define DCPOMATIC_PIXEL_FORMAT_TRAITS_H
+
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+#include <cstdint>
+
+
+/** @return v as it should be stored in memory */
+template <typename Sample, bool big_endian>
+constexpr Sample
+pixel_format_traits_stored (int v)
+{
+	return (big_endian && sizeof(Sample) == 2) ? static_cast<Sample>(((v >> 8) & 0xff) | ((v & 0xff) << 8)) : static_cast<Sample>(v);
+}
+
+
+/** Description of a planar YUV format, optionally with an alpha plane.
+ *  @tparam Sample_ Type of each sample.
+ *  @tparam bits_ Number of bits used in each sample.
+ *  @tparam log2_chroma_width_ log2 of the horizontal subsampling of the U and V planes.
+ *  @tparam log2_chroma_height_ log2 of the vertical subsampling of the U and V planes.
+ *  @tparam big_endian_ true if samples are stored big-endian.
+ *  @tparam alpha_ true if there is an alpha plane.
+ *  @tparam full_range_ true if this is a "J" format, which uses the full range for U and V.
+ */
+template <typename Sample_, int bits_, int log2_chroma_width_, int log2_chroma_height_, bool big_endian_, bool alpha_, bool full_range_ = false>
+struct PlanarYUVTraits
+{
+	static_assert (sizeof(Sample_) * 8 >= bits_, "Sample type is too small");
+	static_assert (sizeof(Sample_) <= 2, "Only 8- and 16-bit samples are supported");
+
+	typedef Sample_ Sample;
+	static constexpr int bits = bits_;
+	static constexpr int log2_chroma_width = log2_chroma_width_;
+	static constexpr int log2_chroma_height = log2_chroma_height_;
+	static constexpr bool big_endian = big_endian_;
+	static constexpr bool alpha = alpha_;
+	static constexpr int planes = alpha_ ? 4 : 3;
+
+	/** U/V value for black, as it is stored in memory */
+	static constexpr Sample black_uv = pixel_format_traits_stored<Sample_, big_endian_>(full_range_ ? (1 << (bits_ - 1)) : ((1 << (bits_ - 1)) - 1));
+};
+
+
+/** Traits for the pixel formats that have specialised code.  There is deliberately no
+ *  definition for other formats, so trying to use one is a compile-time error.
+ */
+template <AVPixelFormat>
+struct PixelFormatTraits;
+
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV420P> : PlanarYUVTraits<uint8_t, 8, 1, 1, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV422P> : PlanarYUVTraits<uint8_t, 8, 1, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV444P> : PlanarYUVTraits<uint8_t, 8, 0, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV411P> : PlanarYUVTraits<uint8_t, 8, 2, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVJ420P> : PlanarYUVTraits<uint8_t, 8, 1, 1, false, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVJ422P> : PlanarYUVTraits<uint8_t, 8, 1, 0, false, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVJ444P> : PlanarYUVTraits<uint8_t, 8, 0, 0, false, false, true> {};
+
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV422P9LE> : PlanarYUVTraits<uint16_t, 9, 1, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV444P9LE> : PlanarYUVTraits<uint16_t, 9, 0, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV422P9BE> : PlanarYUVTraits<uint16_t, 9, 1, 0, true, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV444P9BE> : PlanarYUVTraits<uint16_t, 9, 0, 0, true, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV420P10LE> : PlanarYUVTraits<uint16_t, 10, 1, 1, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV420P10BE> : PlanarYUVTraits<uint16_t, 10, 1, 1, true, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV422P10LE> : PlanarYUVTraits<uint16_t, 10, 1, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV444P10LE> : PlanarYUVTraits<uint16_t, 10, 0, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV422P10BE> : PlanarYUVTraits<uint16_t, 10, 1, 0, true, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV444P10BE> : PlanarYUVTraits<uint16_t, 10, 0, 0, true, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV422P16LE> : PlanarYUVTraits<uint16_t, 16, 1, 0, false, false> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUV444P16LE> : PlanarYUVTraits<uint16_t, 16, 0, 0, false, false> {};
+
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA420P9LE> : PlanarYUVTraits<uint16_t, 9, 1, 1, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA422P9LE> : PlanarYUVTraits<uint16_t, 9, 1, 0, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA444P9LE> : PlanarYUVTraits<uint16_t, 9, 0, 0, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA420P9BE> : PlanarYUVTraits<uint16_t, 9, 1, 1, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA422P9BE> : PlanarYUVTraits<uint16_t, 9, 1, 0, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA444P9BE> : PlanarYUVTraits<uint16_t, 9, 0, 0, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA420P10LE> : PlanarYUVTraits<uint16_t, 10, 1, 1, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA422P10LE> : PlanarYUVTraits<uint16_t, 10, 1, 0, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA444P10LE> : PlanarYUVTraits<uint16_t, 10, 0, 0, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA420P10BE> : PlanarYUVTraits<uint16_t, 10, 1, 1, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA422P10BE> : PlanarYUVTraits<uint16_t, 10, 1, 0, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA444P10BE> : PlanarYUVTraits<uint16_t, 10, 0, 0, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA420P16LE> : PlanarYUVTraits<uint16_t, 16, 1, 1, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA422P16LE> : PlanarYUVTraits<uint16_t, 16, 1, 0, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA444P16LE> : PlanarYUVTraits<uint16_t, 16, 0, 0, false, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA420P16BE> : PlanarYUVTraits<uint16_t, 16, 1, 1, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA422P16BE> : PlanarYUVTraits<uint16_t, 16, 1, 0, true, true> {};
+template <> struct PixelFormatTraits<AV_PIX_FMT_YUVA444P16BE> : PlanarYUVTraits<uint16_t, 16, 0, 0, true, true> {};
+
+
+#endif
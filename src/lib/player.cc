@@ -31,10 +31,12 @@
 #include "dcp_content.h"
 #include "dcp_decoder.h"
 #include "dcpomatic_log.h"
+#include "decode_ahead.h"
 #include "decoder.h"
 #include "decoder_factory.h"
 #include "ffmpeg_content.h"
 #include "film.h"
+#include "font_config.h"
 #include "frame_rate_change.h"
 #include "image.h"
 #include "image_decoder.h"
@@ -52,6 +54,7 @@
 #include "text_content.h"
 #include "text_decoder.h"
 #include "timer.h"
+#include "trace.h"
 #include "video_decoder.h"
 #include <dcp/reel.h>
 #include <dcp/reel_closed_caption_asset.h>
@@ -59,6 +62,7 @@
 #include <dcp/reel_sound_asset.h>
 #include <dcp/reel_subtitle_asset.h>
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <stdint.h>
 
@@ -103,13 +107,16 @@ int const PlayerProperty::PLAY_REFERENCED = 710;
 Player::Player (shared_ptr<const Film> film, Image::Alignment subtitle_alignment)
 	: _film (film)
 	, _suspended (0)
+	, _setup_pieces_pending (false)
 	, _ignore_video(false)
 	, _ignore_audio(false)
 	, _ignore_text(false)
 	, _always_burn_open_subtitles(false)
 	, _fast(false)
+	, _reduce_ffmpeg_decode(false)
 	, _tolerant (film->tolerant())
 	, _play_referenced(false)
+	, _unscaled_bitmap_text(false)
 	, _audio_merger(film->audio_frame_rate())
 	, _subtitle_alignment (subtitle_alignment)
 {
@@ -121,13 +128,16 @@ Player::Player (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist
 	: _film (film)
 	, _playlist (playlist_)
 	, _suspended (0)
+	, _setup_pieces_pending (false)
 	, _ignore_video(false)
 	, _ignore_audio(false)
 	, _ignore_text(false)
 	, _always_burn_open_subtitles(false)
 	, _fast(false)
+	, _reduce_ffmpeg_decode(false)
 	, _tolerant (film->tolerant())
 	, _play_referenced(false)
+	, _unscaled_bitmap_text(false)
 	, _audio_merger(film->audio_frame_rate())
 {
 	construct ();
@@ -161,7 +171,7 @@ Player::connect()
 	   be first.
 	*/
 	_playlist_change_connection = playlist()->Change.connect (bind (&Player::playlist_change, this, _1), boost::signals2::at_front);
-	_playlist_content_change_connection = playlist()->ContentChange.connect (bind(&Player::playlist_content_change, this, _1, _3, _4));
+	_playlist_content_change_connection = playlist()->ContentChange.connect (bind(&Player::playlist_content_change, this, _1, _2, _3, _4));
 }
 
 
@@ -169,7 +179,11 @@ Player::Player(Player&& other)
 	: _film(other._film)
 	, _playlist(std::move(other._playlist))
 	, _suspended(other._suspended.load())
+	, _setup_pieces_pending(other._setup_pieces_pending.load())
 	, _pieces(std::move(other._pieces))
+	, _changed_content(std::move(other._changed_content))
+	, _pass_queue(std::move(other._pass_queue))
+	, _pass_keys(std::move(other._pass_keys))
 	, _video_container_size(other._video_container_size.load())
 	, _black_image(std::move(other._black_image))
 	, _ignore_video(other._ignore_video.load())
@@ -177,8 +191,10 @@ Player::Player(Player&& other)
 	, _ignore_text(other._ignore_text.load())
 	, _always_burn_open_subtitles(other._always_burn_open_subtitles.load())
 	, _fast(other._fast.load())
+	, _reduce_ffmpeg_decode(other._reduce_ffmpeg_decode.load())
 	, _tolerant(other._tolerant)
 	, _play_referenced(other._play_referenced.load())
+	, _unscaled_bitmap_text(other._unscaled_bitmap_text.load())
 	, _next_video_time(other._next_video_time)
 	, _next_audio_time(other._next_audio_time)
 	, _dcp_decode_reduction(other._dcp_decode_reduction.load())
@@ -208,7 +224,11 @@ Player::operator=(Player&& other)
 	_film = std::move(other._film);
 	_playlist = std::move(other._playlist);
 	_suspended = other._suspended.load();
+	_setup_pieces_pending = other._setup_pieces_pending.load();
 	_pieces = std::move(other._pieces);
+	_changed_content = std::move(other._changed_content);
+	_pass_queue = std::move(other._pass_queue);
+	_pass_keys = std::move(other._pass_keys);
 	_video_container_size = other._video_container_size.load();
 	_black_image = std::move(other._black_image);
 	_ignore_video = other._ignore_video.load();
@@ -216,8 +236,10 @@ Player::operator=(Player&& other)
 	_ignore_text = other._ignore_text.load();
 	_always_burn_open_subtitles = other._always_burn_open_subtitles.load();
 	_fast = other._fast.load();
+	_reduce_ffmpeg_decode = other._reduce_ffmpeg_decode.load();
 	_tolerant = other._tolerant;
 	_play_referenced = other._play_referenced.load();
+	_unscaled_bitmap_text = other._unscaled_bitmap_text.load();
 	_next_video_time = other._next_video_time;
 	_next_audio_time = other._next_audio_time;
 	_dcp_decode_reduction = other._dcp_decode_reduction.load();
@@ -253,13 +275,87 @@ have_audio (shared_ptr<const Content> content)
 }
 
 
+/** Connect a handler to one of a piece's decoder signals, going via the piece's DecodeAhead if it has one */
+template <class Signal, class Handler>
+static void
+connect_to_piece (Signal& signal, shared_ptr<Piece> piece, Handler handler)
+{
+	if (piece->decode_ahead) {
+		signal.connect (DecodeAheadHandler<Handler>(piece->decode_ahead.get(), handler));
+	} else {
+		signal.connect (handler);
+	}
+}
+
+
+/** @return the largest number of pieces of FFmpeg content that play at the same time (or 1 if there are none) */
+static int
+most_overlapping_ffmpeg_content (shared_ptr<const Film> film, ContentList const& content)
+{
+	/* Starts (+1) and ends (-1) of each piece of FFmpeg content */
+	vector<pair<DCPTime, int>> edges;
+	for (auto i: content) {
+		if (dynamic_pointer_cast<FFmpegContent>(i)) {
+			edges.push_back(make_pair(i->position(), 1));
+			edges.push_back(make_pair(i->end(film), -1));
+		}
+	}
+
+	/* Ends come before starts at the same time, so abutting content is not counted as overlapping */
+	std::sort(edges.begin(), edges.end());
+
+	int current = 0;
+	int most = 1;
+	for (auto const& i: edges) {
+		current += i.second;
+		most = max(most, current);
+	}
+
+	return most;
+}
+
+
+/** Disconnect everything from the signals of a decoder that was used by an old piece */
+static void
+disconnect_from_pieces (shared_ptr<Decoder> decoder)
+{
+	if (decoder->video) {
+		decoder->video->Data.disconnect_all_slots ();
+	}
+	if (decoder->audio) {
+		decoder->audio->Data.disconnect_all_slots ();
+	}
+	for (auto i: decoder->text) {
+		i->BitmapStart.disconnect_all_slots ();
+		i->PlainStart.disconnect_all_slots ();
+		i->Stop.disconnect_all_slots ();
+	}
+	if (decoder->atmos) {
+		decoder->atmos->Data.disconnect_all_slots ();
+	}
+}
+
+
+/** @param reuse_decoders true to re-use the decoders of any old pieces whose content has not had
+ *  a decode-affecting change since the last call, rather than making new ones.
+ */
 void
-Player::setup_pieces ()
+Player::setup_pieces (bool reuse_decoders)
 {
 	boost::mutex::scoped_lock lm (_mutex);
 
 	auto old_pieces = _pieces;
 	_pieces.clear ();
+	_pass_queue.clear ();
+	_pass_keys.clear ();
+
+	/* Stop any decoding ahead before the old decoders are offered for re-use */
+	for (auto i: old_pieces) {
+		i->decode_ahead.reset ();
+	}
+
+	auto changed_content = std::move(_changed_content);
+	_changed_content.clear ();
 
 	auto film = _film.lock();
 	if (!film) {
@@ -282,6 +378,12 @@ Player::setup_pieces ()
 		_shuffler->Video.connect(bind(&Player::video, this, _1, _2));
 	}
 
+	/* Decoding ahead on separate threads only helps when there is more than one piece to decode */
+	bool const decode_ahead = Config::instance()->player_decode_ahead() && playlist_content.size() > 1;
+
+	/* Share the FFmpeg video decoding threads between the FFmpeg content that plays at the same time */
+	int const ffmpeg_video_threads = std::max(1, Config::instance()->ffmpeg_decode_threads() / most_overlapping_ffmpeg_content(film, playlist_content));
+
 	for (auto content: playlist()->content()) {
 
 		if (!content->paths_valid()) {
@@ -294,14 +396,28 @@ Player::setup_pieces ()
 		}
 
 		shared_ptr<Decoder> old_decoder;
+		optional<int> old_reduction;
 		for (auto j: old_pieces) {
 			if (j->content == content) {
 				old_decoder = j->decoder;
+				old_reduction = j->ffmpeg_decode_reduction;
 				break;
 			}
 		}
 
-		auto decoder = decoder_factory(film, content, _fast, _tolerant, old_decoder);
+		auto const reduction = ffmpeg_decode_reduction(content);
+
+		shared_ptr<Decoder> decoder;
+		if (old_decoder && reuse_decoders && changed_content.find(content) == changed_content.end() && old_reduction == reduction) {
+			/* Nothing that affects decoding has changed, so we can carry on with the old decoder
+			   (and avoid re-opening its files) once it has been rewound to where a new one would start.
+			*/
+			disconnect_from_pieces (old_decoder);
+			old_decoder->seek (ContentTime(), true);
+			decoder = old_decoder;
+		} else {
+			decoder = decoder_factory(film, content, _fast, _tolerant, old_decoder, ffmpeg_video_threads, reduction);
+		}
 		DCPOMATIC_ASSERT (decoder);
 
 		FrameRateChange frc(film, content);
@@ -328,32 +444,39 @@ Player::setup_pieces ()
 			}
 		}
 
-		auto piece = make_shared<Piece>(content, decoder, frc);
+		auto piece = make_shared<Piece>(film, content, decoder, frc);
+		piece->ffmpeg_decode_reduction = reduction;
+		if (decode_ahead) {
+			piece->decode_ahead = make_shared<DecodeAhead>(decoder);
+		}
 		_pieces.push_back (piece);
 
 		if (decoder->video) {
 			if (have_threed) {
 				/* We need a Shuffler to cope with 3D L/R video data arriving out of sequence */
-				decoder->video->Data.connect (bind(&Shuffler::video, _shuffler.get(), weak_ptr<Piece>(piece), _1));
+				connect_to_piece (decoder->video->Data, piece, bind(&Shuffler::video, _shuffler.get(), weak_ptr<Piece>(piece), _1));
 			} else {
-				decoder->video->Data.connect (bind(&Player::video, this, weak_ptr<Piece>(piece), _1));
+				connect_to_piece (decoder->video->Data, piece, bind(&Player::video, this, weak_ptr<Piece>(piece), _1));
 			}
 		}
 
 		if (decoder->audio) {
-			decoder->audio->Data.connect (bind (&Player::audio, this, weak_ptr<Piece> (piece), _1, _2));
+			connect_to_piece (decoder->audio->Data, piece, bind(&Player::audio, this, weak_ptr<Piece>(piece), _1, _2));
 		}
 
 		auto j = decoder->text.begin();
 
 		while (j != decoder->text.end()) {
-			(*j)->BitmapStart.connect (
+			connect_to_piece (
+				(*j)->BitmapStart, piece,
 				bind(&Player::bitmap_text_start, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
 				);
-			(*j)->PlainStart.connect (
+			connect_to_piece (
+				(*j)->PlainStart, piece,
 				bind(&Player::plain_text_start, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
 				);
-			(*j)->Stop.connect (
+			connect_to_piece (
+				(*j)->Stop, piece,
 				bind(&Player::subtitle_stop, this, weak_ptr<Piece>(piece), weak_ptr<const TextContent>((*j)->content()), _1)
 				);
 
@@ -361,10 +484,24 @@ Player::setup_pieces ()
 		}
 
 		if (decoder->atmos) {
-			decoder->atmos->Data.connect (bind(&Player::atmos, this, weak_ptr<Piece>(piece), _1));
+			connect_to_piece (decoder->atmos->Data, piece, bind(&Player::atmos, this, weak_ptr<Piece>(piece), _1));
 		}
 	}
 
+	if (!_ignore_text) {
+		/* Make all the fonts that we might render available now; this is much quicker than
+		   letting each one be added (and fontconfig rebuilt) as its first subtitle comes up.
+		*/
+		vector<shared_ptr<Font>> fonts;
+		for (auto piece: _pieces) {
+			for (auto text: piece->content->text) {
+				auto text_fonts = text->fonts();
+				copy (text_fonts.begin(), text_fonts.end(), back_inserter(fonts));
+			}
+		}
+		FontConfig::instance()->make_fonts_available(fonts);
+	}
+
 	_stream_states.clear ();
 	for (auto i: _pieces) {
 		if (i->content->audio) {
@@ -378,11 +515,24 @@ Player::setup_pieces ()
 		return v && v->use() && v->frame_type() != VideoFrameType::THREE_D_LEFT && v->frame_type() != VideoFrameType::THREE_D_RIGHT;
 	};
 
+	/* The playlist is normally sorted by position, in which case we can stop looking for
+	   overlaps with a piece as soon as we find a later one which starts after it has ended.
+	*/
+	bool const sorted = std::is_sorted(
+		_pieces.begin(),
+		_pieces.end(),
+		[](shared_ptr<const Piece> a, shared_ptr<const Piece> b) {
+			return a->content->position() < b->content->position();
+		});
+
 	for (auto piece = _pieces.begin(); piece != _pieces.end(); ++piece) {
 		if (ignore_overlap((*piece)->content->video)) {
 			/* Look for content later in the content list with in-use video that overlaps this */
 			auto const period = (*piece)->content->period(film);
 			for (auto later_piece = std::next(piece); later_piece != _pieces.end(); ++later_piece) {
+				if (sorted && (*later_piece)->content->position() >= period.to) {
+					break;
+				}
 				if (ignore_overlap((*later_piece)->content->video)) {
 					if (auto overlap = (*later_piece)->content->period(film).overlap(period)) {
 						(*piece)->ignore_video.push_back(*overlap);
@@ -397,6 +547,9 @@ Player::setup_pieces ()
 			/* Look for content later in the content list with ATMOS that overlaps this */
 			auto const period = (*piece)->content->period(film);
 			for (auto later_piece = std::next(piece); later_piece != _pieces.end(); ++later_piece) {
+				if (sorted && (*later_piece)->content->position() >= period.to) {
+					break;
+				}
 				if ((*later_piece)->content->atmos) {
 					if (auto overlap = (*later_piece)->content->period(film).overlap(period)) {
 						(*piece)->ignore_atmos.push_back(*overlap);
@@ -406,6 +559,8 @@ Player::setup_pieces ()
 		}
 	}
 
+	setup_pass_queue (film);
+
 	_black = Empty(film, playlist(), bind(&have_video, _1), _playback_length);
 	_silent = Empty(film, playlist(), bind(&have_audio, _1), _playback_length);
 
@@ -416,7 +571,7 @@ Player::setup_pieces ()
 
 
 void
-Player::playlist_content_change (ChangeType type, int property, bool frequent)
+Player::playlist_content_change (ChangeType type, weak_ptr<Content> content, int property, bool frequent)
 {
 	auto film = _film.lock();
 	if (!film) {
@@ -437,11 +592,30 @@ Player::playlist_content_change (ChangeType type, int property, bool frequent)
 			   and seek() from working until then.
 			*/
 			++_suspended;
+			/* A change of position does not affect how the content is decoded, but anything else might */
+			auto c = content.lock();
+			if (c && property != ContentProperty::POSITION) {
+				boost::mutex::scoped_lock lm (_mutex);
+				_changed_content.insert (c);
+			}
 		} else if (type == ChangeType::DONE) {
-			/* A change in our content has gone through.  Re-build our pieces. */
-			setup_pieces ();
+			/* A change in our content has gone through.  Re-build our pieces, unless there are
+			   more changes still to come (such as when many content are being changed in one go),
+			   in which case we can wait and re-build once for them all.
+			*/
+			if (_suspended == 1) {
+				_setup_pieces_pending = false;
+				setup_pieces (true);
+			} else {
+				_setup_pieces_pending = true;
+			}
 			--_suspended;
 		} else if (type == ChangeType::CANCELLED) {
+			if (_suspended == 1 && _setup_pieces_pending) {
+				/* This one was cancelled but some that came before it were not */
+				_setup_pieces_pending = false;
+				setup_pieces (true);
+			}
 			--_suspended;
 		}
 	}
@@ -467,6 +641,23 @@ Player::set_video_container_size (dcp::Size s)
 		_black_image = make_shared<Image>(AV_PIX_FMT_RGB24, _video_container_size, Image::Alignment::PADDED);
 		_black_image->make_black ();
 	}
+
+	if (_reduce_ffmpeg_decode) {
+		bool changed = false;
+		{
+			boost::mutex::scoped_lock lm(_mutex);
+			for (auto piece: _pieces) {
+				if (piece->ffmpeg_decode_reduction != ffmpeg_decode_reduction(piece->content)) {
+					changed = true;
+					break;
+				}
+			}
+		}
+		if (changed) {
+			/* Only the decoders whose reduction has changed need to be re-made */
+			setup_pieces(true);
+		}
+	}
 }
 
 
@@ -474,7 +665,8 @@ void
 Player::playlist_change (ChangeType type)
 {
 	if (type == ChangeType::DONE) {
-		setup_pieces ();
+		/* Content has been added, removed or re-ordered; the rest can keep its decoders */
+		setup_pieces (true);
 	}
 	Change (type, PlayerProperty::PLAYLIST, false);
 }
@@ -542,12 +734,9 @@ Player::black_player_video_frame (Eyes eyes) const
 Frame
 Player::dcp_to_content_video (shared_ptr<const Piece> piece, DCPTime t) const
 {
-	auto film = _film.lock();
-	DCPOMATIC_ASSERT(film);
-
-	auto s = t - piece->content->position ();
-	s = min (piece->content->length_after_trim(film), s);
-	s = max (DCPTime(), s + DCPTime (piece->content->trim_start(), piece->frc));
+	auto s = t - piece->position;
+	s = min (piece->length_after_trim, s);
+	s = max (DCPTime(), s + piece->trim_start_dcp);
 
 	/* It might seem more logical here to convert s to a ContentTime (using the FrameRateChange)
 	   then convert that ContentTime to frames at the content's rate.  However this fails for
@@ -564,8 +753,8 @@ DCPTime
 Player::content_video_to_dcp (shared_ptr<const Piece> piece, Frame f) const
 {
 	/* See comment in dcp_to_content_video */
-	auto const d = DCPTime::from_frames (f * piece->frc.factor(), piece->frc.dcp) - DCPTime(piece->content->trim_start(), piece->frc);
-	return d + piece->content->position();
+	auto const d = DCPTime::from_frames (f * piece->frc.factor(), piece->frc.dcp) - piece->trim_start_dcp;
+	return d + piece->position;
 }
 
 
@@ -575,10 +764,10 @@ Player::dcp_to_resampled_audio (shared_ptr<const Piece> piece, DCPTime t) const
 	auto film = _film.lock();
 	DCPOMATIC_ASSERT(film);
 
-	auto s = t - piece->content->position ();
-	s = min (piece->content->length_after_trim(film), s);
+	auto s = t - piece->position;
+	s = min (piece->length_after_trim, s);
 	/* See notes in dcp_to_content_video */
-	return max (DCPTime(), DCPTime(piece->content->trim_start(), piece->frc) + s).frames_floor(film->audio_frame_rate());
+	return max (DCPTime(), piece->trim_start_dcp + s).frames_floor(film->audio_frame_rate());
 }
 
 
@@ -590,27 +779,24 @@ Player::resampled_audio_to_dcp (shared_ptr<const Piece> piece, Frame f) const
 
 	/* See comment in dcp_to_content_video */
 	return DCPTime::from_frames(f, film->audio_frame_rate())
-		- DCPTime (piece->content->trim_start(), piece->frc)
-		+ piece->content->position();
+		- piece->trim_start_dcp
+		+ piece->position;
 }
 
 
 ContentTime
 Player::dcp_to_content_time (shared_ptr<const Piece> piece, DCPTime t) const
 {
-	auto film = _film.lock();
-	DCPOMATIC_ASSERT(film);
-
-	auto s = t - piece->content->position ();
-	s = min (piece->content->length_after_trim(film), s);
-	return max (ContentTime (), ContentTime (s, piece->frc) + piece->content->trim_start());
+	auto s = t - piece->position;
+	s = min (piece->length_after_trim, s);
+	return max (ContentTime (), ContentTime (s, piece->frc) + piece->trim_start);
 }
 
 
 DCPTime
 Player::content_time_to_dcp (shared_ptr<const Piece> piece, ContentTime t) const
 {
-	return max (DCPTime(), DCPTime(t - piece->content->trim_start(), piece->frc) + piece->content->position());
+	return max (DCPTime(), DCPTime(t - piece->trim_start, piece->frc) + piece->position);
 }
 
 
@@ -677,6 +863,52 @@ Player::set_fast ()
 }
 
 
+/** Set whether FFmpeg video should be decoded at a reduced resolution (where the codec
+ *  allows it) when the content is going to be scaled down to fit the video container
+ *  anyway, e.g. for a small preview.
+ */
+void
+Player::set_reduce_ffmpeg_decode (bool reduce)
+{
+	if (reduce == _reduce_ffmpeg_decode) {
+		return;
+	}
+
+	_reduce_ffmpeg_decode = reduce;
+	setup_pieces(true);
+}
+
+
+/** @return log2 of the factor by which to reduce the resolution of the decode of
+ *  some content's video, or none to decode at full resolution.
+ */
+optional<int>
+Player::ffmpeg_decode_reduction (shared_ptr<const Content> content) const
+{
+	if (!_reduce_ffmpeg_decode || !content->video || !dynamic_pointer_cast<const FFmpegContent>(content)) {
+		return {};
+	}
+
+	auto const crop = content->video->size_after_crop();
+	dcp::Size const container = _video_container_size;
+	if (crop.width <= 0 || crop.height <= 0 || container.width <= 0 || container.height <= 0) {
+		return {};
+	}
+
+	/* Halve the decoded size for as long as it stays at least as big as the container */
+	int reduction = 0;
+	while (reduction < 3 && (crop.width >> (reduction + 1)) >= container.width && (crop.height >> (reduction + 1)) >= container.height) {
+		++reduction;
+	}
+
+	if (reduction == 0) {
+		return {};
+	}
+
+	return reduction;
+}
+
+
 void
 Player::set_play_referenced ()
 {
@@ -686,6 +918,61 @@ Player::set_play_referenced ()
 }
 
 
+/** Set this player to pass bitmap text on without scaling it to the video container size;
+ *  its rectangles will still be correct.
+ */
+void
+Player::set_unscaled_bitmap_text ()
+{
+	_unscaled_bitmap_text = true;
+}
+
+
+/** Re-build _pass_queue from scratch; must be called with _mutex held */
+void
+Player::setup_pass_queue (shared_ptr<const Film> film)
+{
+	_pass_queue.clear ();
+	_pass_keys.assign (_pieces.size(), boost::none);
+
+	for (size_t i = 0; i < _pieces.size(); ++i) {
+		update_pass_queue (film, i);
+	}
+}
+
+
+/** Update the position of _pieces[index] in _pass_queue after its decoder position may have changed.
+ *  Must be called with _mutex held.
+ */
+void
+Player::update_pass_queue (shared_ptr<const Film> film, int index)
+{
+	auto& key = _pass_keys[index];
+	if (key) {
+		_pass_queue.erase (*key);
+		key = boost::none;
+	}
+
+	auto piece = _pieces[index];
+	if (piece->done) {
+		return;
+	}
+
+	auto const t = content_time_to_dcp (piece, max(piece->decoder_position(), piece->trim_start));
+	if (t > piece->end) {
+		piece->done = true;
+		return;
+	}
+
+	/* Given two choices at the same time, pick the one with texts so we see it before
+	   the video.
+	*/
+	bool const text = !piece->decoder->text.empty();
+	key = PassKey(t, text ? 0 : 1, text ? -index : index);
+	_pass_queue.insert (*key);
+}
+
+
 bool
 Player::pass ()
 {
@@ -697,6 +984,8 @@ Player::pass ()
 		return false;
 	}
 
+	TraceSpan span("pass", "player");
+
 	auto film = _film.lock();
 
 	if (_playback_length.load() == DCPTime() || !film) {
@@ -708,26 +997,14 @@ Player::pass ()
 	/* Find the decoder or empty which is farthest behind where we are and make it emit some data */
 
 	shared_ptr<Piece> earliest_content;
+	int earliest_index = 0;
 	optional<DCPTime> earliest_time;
 
-	for (auto i: _pieces) {
-		if (i->done) {
-			continue;
-		}
-
-		auto const t = content_time_to_dcp (i, max(i->decoder->position(), i->content->trim_start()));
-		if (t > i->content->end(film)) {
-			i->done = true;
-		} else {
-
-			/* Given two choices at the same time, pick the one with texts so we see it before
-			   the video.
-			*/
-			if (!earliest_time || t < *earliest_time || (t == *earliest_time && !i->decoder->text.empty())) {
-				earliest_time = t;
-				earliest_content = i;
-			}
-		}
+	if (!_pass_queue.empty()) {
+		auto const& first = *_pass_queue.begin();
+		earliest_time = std::get<0>(first);
+		earliest_index = std::abs(std::get<2>(first));
+		earliest_content = _pieces[earliest_index];
 	}
 
 	bool done = false;
@@ -757,7 +1034,11 @@ Player::pass ()
 	case CONTENT:
 	{
 		LOG_DEBUG_PLAYER ("Calling pass() on %1", earliest_content->content->path(0));
-		earliest_content->done = earliest_content->decoder->pass ();
+		{
+			TraceSpan span("decode", "decode");
+			earliest_content->done = earliest_content->decoder_pass ();
+		}
+		update_pass_queue (film, earliest_index);
 		auto dcp = dynamic_pointer_cast<DCPContent>(earliest_content->content);
 		if (dcp && !_play_referenced && dcp->reference_audio()) {
 			/* We are skipping some referenced DCP audio content, so we need to update _next_audio_time
@@ -849,7 +1130,7 @@ Player::pass ()
 
 	auto pull_to = _playback_length.load();
 	for (auto const& i: alive_stream_states) {
-		auto position = i.second.last_push_end.get_value_or(i.second.piece->content->position());
+		auto position = i.second.last_push_end.get_value_or(i.second.piece->position);
 		if (!i.second.piece->done && position < pull_to) {
 			pull_to = position;
 		}
@@ -950,7 +1231,22 @@ Player::open_subtitles_for_frame (DCPTime time) const
 		return {};
 	}
 
-	return merge (captions, _subtitle_alignment);
+	/* The same subtitles usually stay on screen for many frames, and then render_text()'s
+	 * cache and the already-scaled bitmap subtitles will give us the same images again;
+	 * if so, we can use the same merged image too.
+	 */
+	auto same_images = [](list<PositionImage> const& a, list<PositionImage> const& b) {
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](PositionImage const& x, PositionImage const& y) {
+			return x.image == y.image && x.position == y.position;
+		});
+	};
+
+	if (!_last_open_subtitles || !same_images(captions, _last_open_subtitle_images)) {
+		_last_open_subtitles = merge(captions, _subtitle_alignment);
+		_last_open_subtitle_images = captions;
+	}
+
+	return _last_open_subtitles;
 }
 
 
@@ -1022,7 +1318,7 @@ Player::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 	   if it's after the content's period here as in that case we still need to fill any gap between
 	   `now' and the end of the content's period.
 	*/
-	if (time < piece->content->position() || (_next_video_time && time < *_next_video_time)) {
+	if (time < piece->position || (_next_video_time && time < *_next_video_time)) {
 		return;
 	}
 
@@ -1038,10 +1334,10 @@ Player::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 	/* Fill gaps that we discover now that we have some video which needs to be emitted.
 	   This is where we need to fill to.
 	*/
-	DCPTime fill_to = min(time, piece->content->end(film));
+	DCPTime fill_to = min(time, piece->end);
 
 	if (_next_video_time) {
-		DCPTime fill_from = max (*_next_video_time, piece->content->position());
+		DCPTime fill_from = max (*_next_video_time, piece->position);
 
 		/* Fill if we have more than half a frame to do */
 		if ((fill_to - fill_from) > one_video_frame() / 2) {
@@ -1051,7 +1347,7 @@ Player::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 				if (fill_to_eyes == Eyes::BOTH) {
 					fill_to_eyes = Eyes::LEFT;
 				}
-				if (fill_to == piece->content->end(film)) {
+				if (fill_to == piece->end) {
 					/* Don't fill after the end of the content */
 					fill_to_eyes = Eyes::LEFT;
 				}
@@ -1090,7 +1386,8 @@ Player::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 	auto const content_video = piece->content->video;
 
 	for (auto eyes: eyes_to_emit) {
-		_last_video[weak_piece] = std::make_shared<PlayerVideo>(
+		auto previous = _last_video.find(weak_piece);
+		auto player_video = std::make_shared<PlayerVideo>(
 			video.image,
 			content_video->actual_crop(),
 			content_video->fade(film, video.frame),
@@ -1110,9 +1407,17 @@ Player::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 			false
 			);
 
+		if (previous != _last_video.end() && previous->second) {
+			/* Still image content gives us the same image for every frame, so if this is one of
+			 * those we need only crop and scale it once.
+			 */
+			player_video->share_scaled_image(previous->second);
+		}
+		_last_video[weak_piece] = player_video;
+
 		DCPTime t = time;
 		for (int i = 0; i < frc.repeat; ++i) {
-			if (t < piece->content->end(film)) {
+			if (t < piece->end) {
 				emit_video (_last_video[weak_piece], t);
 			}
 			t += one_video_frame ();
@@ -1153,19 +1458,19 @@ Player::audio (weak_ptr<Piece> weak_piece, AudioStreamPtr stream, ContentAudio c
 	LOG_DEBUG_PLAYER("Received audio frame %1 covering %2 to %3 (%4)", content_audio.frame, to_string(time), to_string(end), piece->content->path(0).filename());
 
 	/* Remove anything that comes before the start or after the end of the content */
-	if (time < piece->content->position()) {
-		auto cut = discard_audio (content_audio.audio, time, piece->content->position());
+	if (time < piece->position) {
+		auto cut = discard_audio (content_audio.audio, time, piece->position);
 		if (!cut.first) {
 			/* This audio is entirely discarded */
 			return;
 		}
 		content_audio.audio = cut.first;
 		time = cut.second;
-	} else if (time > piece->content->end(film)) {
+	} else if (time > piece->end) {
 		/* Discard it all */
 		return;
-	} else if (end > piece->content->end(film)) {
-		Frame const remaining_frames = DCPTime(piece->content->end(film) - time).frames_round(rfr);
+	} else if (end > piece->end) {
+		Frame const remaining_frames = DCPTime(piece->end - time).frames_round(rfr);
 		if (remaining_frames == 0) {
 			return;
 		}
@@ -1200,7 +1505,7 @@ Player::audio (weak_ptr<Piece> weak_piece, AudioStreamPtr stream, ContentAudio c
 
 	/* Remap */
 
-	content_audio.audio = remap(content_audio.audio, film->audio_channels(), stream->mapping());
+	content_audio.audio = stream->sparse_mapping(film->audio_channels())->run(content_audio.audio);
 
 	/* Process */
 
@@ -1253,6 +1558,11 @@ Player::bitmap_text_start (weak_ptr<Piece> weak_piece, weak_ptr<const TextConten
 			return;
 		}
 
+		if (_unscaled_bitmap_text) {
+			ps.bitmap.push_back (BitmapText(image, sub.rectangle));
+			continue;
+		}
+
 		dcp::Size scaled_size (width, height);
 		ps.bitmap.push_back (BitmapText(image->scale(scaled_size, dcp::YUVToRGB::REC601, image->pixel_format(), Image::Alignment::PADDED, _fast), sub.rectangle));
 	}
@@ -1279,7 +1589,7 @@ Player::plain_text_start (weak_ptr<Piece> weak_piece, weak_ptr<const TextContent
 	PlayerText ps;
 	DCPTime const from (content_time_to_dcp (piece, subtitle.from()));
 
-	if (from > piece->content->end(film)) {
+	if (from > piece->end) {
 		return;
 	}
 
@@ -1335,7 +1645,7 @@ Player::subtitle_stop (weak_ptr<Piece> weak_piece, weak_ptr<const TextContent> w
 
 	DCPTime const dcp_to = content_time_to_dcp (piece, to);
 
-	if (dcp_to > piece->content->end(film)) {
+	if (dcp_to > piece->end) {
 		return;
 	}
 
@@ -1343,6 +1653,7 @@ Player::subtitle_stop (weak_ptr<Piece> weak_piece, weak_ptr<const TextContent> w
 
 	bool const always = (content->type() == TextType::OPEN_SUBTITLE && _always_burn_open_subtitles);
 	if (content->use() && !always && !content->burn()) {
+		from.first.content = piece->content;
 		Text (from.first, content->type(), content->dcp_track().get_value_or(DCPTextTrack()), DCPTimePeriod(from.second, dcp_to));
 	}
 }
@@ -1378,17 +1689,17 @@ Player::seek (DCPTime time, bool accurate)
 	std::for_each(_active_texts.begin(), _active_texts.end(), [](ActiveText& a) { a.clear(); });
 
 	for (auto i: _pieces) {
-		if (time < i->content->position()) {
+		if (time < i->position) {
 			/* Before; seek to the start of the content.  Even if this request is for an inaccurate seek
 			   we must seek this (following) content accurately, otherwise when we come to the end of the current
 			   content we may not start right at the beginning of the next, causing a gap (if the next content has
 			   been trimmed to a point between keyframes, or something).
 			*/
-			i->decoder->seek (dcp_to_content_time (i, i->content->position()), true);
+			i->decoder_seek (dcp_to_content_time (i, i->position), true);
 			i->done = false;
-		} else if (i->content->position() <= time && time < i->content->end(film)) {
+		} else if (i->position <= time && time < i->end) {
 			/* During; seek to position */
-			i->decoder->seek (dcp_to_content_time (i, time), accurate);
+			i->decoder_seek (dcp_to_content_time (i, time), accurate);
 			i->done = false;
 		} else {
 			/* After; this piece is done */
@@ -1396,6 +1707,8 @@ Player::seek (DCPTime time, bool accurate)
 		}
 	}
 
+	setup_pass_queue (film);
+
 	if (accurate) {
 		_next_video_time = time;
 		_next_video_eyes = Eyes::LEFT;
@@ -1604,8 +1917,8 @@ Player::atmos (weak_ptr<Piece> weak_piece, ContentAtmos data)
 
 	auto const vfr = film->video_frame_rate();
 
-	DCPTime const dcp_time = DCPTime::from_frames(data.frame, vfr) - DCPTime(piece->content->trim_start(), FrameRateChange(vfr, vfr));
-	if (dcp_time < piece->content->position() || dcp_time >= (piece->content->end(film))) {
+	DCPTime const dcp_time = DCPTime::from_frames(data.frame, vfr) - DCPTime(piece->trim_start, FrameRateChange(vfr, vfr));
+	if (dcp_time < piece->position || dcp_time >= (piece->end)) {
 		return;
 	}
 
@@ -41,6 +41,8 @@
 #include "shuffler.h"
 #include <boost/atomic.hpp>
 #include <list>
+#include <set>
+#include <tuple>
 
 
 namespace dcp {
@@ -103,7 +105,9 @@ public:
 	void set_ignore_text ();
 	void set_always_burn_open_subtitles ();
 	void set_fast ();
+	void set_reduce_ffmpeg_decode (bool reduce);
 	void set_play_referenced ();
+	void set_unscaled_bitmap_text ();
 	void set_dcp_decode_reduction (boost::optional<int> reduction);
 
 	boost::optional<dcpomatic::DCPTime> content_time_to_dcp (std::shared_ptr<const Content> content, dcpomatic::ContentTime t) const;
@@ -140,13 +144,15 @@ private:
 	friend struct empty_test2;
 	friend struct check_reuse_old_data_test;
 	friend struct overlap_video_test1;
+	friend struct player_reuse_decoders_test;
 
 	void construct ();
 	void connect();
-	void setup_pieces ();
+	void setup_pieces (bool reuse_decoders = false);
+	boost::optional<int> ffmpeg_decode_reduction (std::shared_ptr<const Content> content) const;
 	void film_change(ChangeType, FilmProperty);
 	void playlist_change (ChangeType);
-	void playlist_content_change (ChangeType, int, bool);
+	void playlist_content_change (ChangeType, std::weak_ptr<Content>, int, bool);
 	Frame dcp_to_content_video (std::shared_ptr<const Piece> piece, dcpomatic::DCPTime t) const;
 	dcpomatic::DCPTime content_video_to_dcp (std::shared_ptr<const Piece> piece, Frame f) const;
 	Frame dcp_to_resampled_audio (std::shared_ptr<const Piece> piece, dcpomatic::DCPTime t) const;
@@ -172,6 +178,8 @@ private:
 	void do_emit_video (std::shared_ptr<PlayerVideo> pv, dcpomatic::DCPTime time);
 	void emit_audio (std::shared_ptr<AudioBuffers> data, dcpomatic::DCPTime time);
 	std::shared_ptr<const Playlist> playlist () const;
+	void setup_pass_queue (std::shared_ptr<const Film> film);
+	void update_pass_queue (std::shared_ptr<const Film> film, int index);
 
 	/** Mutex to protect the most of the Player state.  When it's used for the preview we have
 	    seek() and pass() called from the Butler thread and lots of other stuff called
@@ -185,7 +193,26 @@ private:
 
 	/** > 0 if we are suspended (i.e. pass() and seek() do nothing) */
 	boost::atomic<int> _suspended;
+	/** true if content changes have gone through but we are waiting for others to finish before
+	 *  re-building our pieces.
+	 */
+	boost::atomic<bool> _setup_pieces_pending;
 	std::vector<std::shared_ptr<Piece>> _pieces;
+	/** Content which has had a change that might affect how it is decoded since
+	 *  the last setup_pieces(), so that its old decoder cannot be re-used.
+	 */
+	std::set<std::shared_ptr<const Content>> _changed_content;
+
+	/** Key used to order _pass_queue: the DCP time of the piece's decoder position, then 0 if
+	 *  the piece has texts (so that they are seen before the video at the same time) or 1 if not,
+	 *  then the index of the piece in _pieces (negated if the piece has texts).  This gives the
+	 *  same choice as scanning all the pieces for the earliest.
+	 */
+	typedef std::tuple<dcpomatic::DCPTime, int, int> PassKey;
+	/** Keys of the pieces which are not done; the first is the piece that pass() should pass next */
+	std::set<PassKey> _pass_queue;
+	/** Key of each piece in _pass_queue (with the same indices as _pieces), or none if it is done */
+	std::vector<boost::optional<PassKey>> _pass_keys;
 
 	/** Size of the image we are rendering to; this may be the DCP frame size, or
 	 *  the size of preview in a window.
@@ -203,10 +230,16 @@ private:
 	boost::atomic<bool> _always_burn_open_subtitles;
 	/** true if we should try to be fast rather than high quality */
 	boost::atomic<bool> _fast;
+	/** true to decode FFmpeg video at reduced resolution when it will be scaled down anyway */
+	boost::atomic<bool> _reduce_ffmpeg_decode;
 	/** true if we should keep going in the face of `survivable' errors */
 	bool _tolerant;
 	/** true if we should `play' (i.e output) referenced DCP data (e.g. for preview) */
 	boost::atomic<bool> _play_referenced;
+	/** true to emit bitmap text without scaling its images to fit the video container,
+	 *  for when only the positions of the text are needed.
+	 */
+	boost::atomic<bool> _unscaled_bitmap_text;
 
 	/** Time of the next video that we will emit, or the time of the last accurate seek */
 	boost::optional<dcpomatic::DCPTime> _next_video_time;
@@ -224,6 +257,10 @@ private:
 	std::unique_ptr<Shuffler> _shuffler;
 	std::list<std::pair<std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime>> _delay;
 
+	/** The images that were last merged by open_subtitles_for_frame(), and the result */
+	mutable std::list<PositionImage> _last_open_subtitle_images;
+	mutable boost::optional<PositionImage> _last_open_subtitles;
+
 	class StreamState
 	{
 	public:
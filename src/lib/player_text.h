@@ -27,6 +27,8 @@
 #include "string_text.h"
 
 
+class Content;
+
 namespace dcpomatic {
 	class Font;
 }
@@ -39,6 +41,8 @@ public:
 	/** BitmapTexts, with their rectangles transformed as specified by their content */
 	std::vector<BitmapText> bitmap;
 	std::vector<StringText> string;
+	/** Content that this text came from */
+	std::weak_ptr<const Content> content;
 };
 
 
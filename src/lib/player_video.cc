@@ -20,6 +20,10 @@
 
 
 #include "content.h"
+#include "digester.h"
+#include "encoding_request.h"
+#include "fast_rgb_to_xyz.h"
+#include "fast_xyz_to_rgb.h"
 #include "film.h"
 #include "image.h"
 #include "image_proxy.h"
@@ -27,6 +31,8 @@
 #include "player.h"
 #include "player_video.h"
 #include "video_content.h"
+#include "xyz_image_pool.h"
+#include <dcp/openjpeg_image.h>
 #include <dcp/raw_convert.h>
 extern "C" {
 #include <libavutil/pixfmt.h>
@@ -93,7 +99,9 @@ PlayerVideo::PlayerVideo (shared_ptr<cxml::Node> node, shared_ptr<Socket> socket
 	/* Assume that the ColourConversion uses the current state version */
 	_colour_conversion = ColourConversion::from_xml (node, Film::current_state_version);
 
-	_in = image_proxy_factory (node->node_child("In"), socket);
+	auto const compression = node->optional_string_child("Compression").get_value_or("") == "zstd" ? TransportCompression::ZSTD : TransportCompression::NONE;
+
+	_in = image_proxy_factory (node->node_child("In"), socket, compression);
 
 	if (node->optional_number_child<int>("SubtitleX")) {
 
@@ -101,13 +109,61 @@ PlayerVideo::PlayerVideo (shared_ptr<cxml::Node> node, shared_ptr<Socket> socket
 			AV_PIX_FMT_BGRA, dcp::Size(node->number_child<int>("SubtitleWidth"), node->number_child<int>("SubtitleHeight")), Image::Alignment::PADDED
 			);
 
-		image->read_from_socket (socket);
+		image->read_from_socket (socket, compression);
 
 		_text = PositionImage (image, Position<int>(node->number_child<int>("SubtitleX"), node->number_child<int>("SubtitleY")));
 	}
 }
 
 
+/** Construct a PlayerVideo from the binary form of an encoding request, as written by
+ *  add_metadata(EncodingRequestWriter&), and the image data which follows it on a socket.
+ */
+PlayerVideo::PlayerVideo (EncodingRequestReader& reader, shared_ptr<Socket> socket, TransportCompression compression)
+{
+	_crop.left = reader.read_int();
+	_crop.right = reader.read_int();
+	_crop.top = reader.read_int();
+	_crop.bottom = reader.read_int();
+	_fade = reader.read_optional_double();
+
+	auto const inter_width = reader.read_int();
+	auto const inter_height = reader.read_int();
+	_inter_size = dcp::Size(inter_width, inter_height);
+	auto const out_width = reader.read_int();
+	auto const out_height = reader.read_int();
+	_out_size = dcp::Size(out_width, out_height);
+	_eyes = static_cast<Eyes>(reader.read_int());
+	_part = static_cast<Part>(reader.read_int());
+	_video_range = static_cast<VideoRange>(reader.read_int());
+	_error = reader.read_bool();
+
+	if (reader.read_bool()) {
+		_colour_conversion = ColourConversion(reader);
+	}
+
+	/* Read the rest of the metadata before any image data is read from the socket */
+	auto const has_text = reader.read_bool();
+	int text_width = 0;
+	int text_height = 0;
+	Position<int> text_position;
+	if (has_text) {
+		text_width = reader.read_int();
+		text_height = reader.read_int();
+		text_position.x = reader.read_int();
+		text_position.y = reader.read_int();
+	}
+
+	_in = image_proxy_factory (reader, socket, compression);
+
+	if (has_text) {
+		auto image = make_shared<Image>(AV_PIX_FMT_BGRA, dcp::Size(text_width, text_height), Image::Alignment::PADDED);
+		image->read_from_socket (socket, compression);
+		_text = PositionImage (image, text_position);
+	}
+}
+
+
 void
 PlayerVideo::set_text (PositionImage image)
 {
@@ -149,6 +205,57 @@ PlayerVideo::make_image (function<AVPixelFormat (AVPixelFormat)> pixel_format, V
 	_image_out_size = _out_size;
 	_image_fade = _fade;
 
+	if (_scaled) {
+		boost::mutex::scoped_lock slm (_scaled->mutex);
+		auto& scaled = *_scaled;
+		if (
+			!scaled.image ||
+			scaled.crop != _crop ||
+			scaled.inter_size != _inter_size ||
+			scaled.out_size != _out_size ||
+			scaled.video_range != video_range ||
+			scaled.fast != fast) {
+			scaled.image = crop_scale (pixel_format, video_range, fast, {});
+			scaled.crop = _crop;
+			scaled.inter_size = _inter_size;
+			scaled.out_size = _out_size;
+			scaled.video_range = video_range;
+			scaled.fast = fast;
+			scaled.error = _error;
+		}
+		_error = scaled.error;
+		/* Nobody changes the images that we give out, so we need only copy this one if we are about to */
+		if (_fade && !_text) {
+			/* Copy and fade in one go */
+			_image = scaled.image->faded(_fade.get());
+			return;
+		}
+		_image = (_text || _fade) ? make_shared<Image>(*scaled.image) : scaled.image;
+	} else {
+		_image = crop_scale (pixel_format, video_range, fast, {});
+	}
+
+	if (_text) {
+		_image->alpha_blend (_text->image, _text->position);
+	}
+
+	if (_fade) {
+		_image->fade (_fade.get ());
+	}
+}
+
+
+/** Crop and scale our input image.  A lock must be held on _mutex.
+ *  @param lines_ready Function to pass to Image::crop_scale_window, or empty.
+ */
+shared_ptr<Image>
+PlayerVideo::crop_scale (
+	function<AVPixelFormat (AVPixelFormat)> pixel_format,
+	VideoRange video_range,
+	bool fast,
+	function<void (Image const&, int, int)> lines_ready
+	) const
+{
 	auto prox = _in->image (Image::Alignment::PADDED, _inter_size);
 	_error = prox.error;
 
@@ -184,17 +291,88 @@ PlayerVideo::make_image (function<AVPixelFormat (AVPixelFormat)> pixel_format, V
 		yuv_to_rgb = _colour_conversion.get().yuv_to_rgb();
 	}
 
-	_image = prox.image->crop_scale_window (
-		total_crop, _inter_size, _out_size, yuv_to_rgb, _video_range, pixel_format (prox.image->pixel_format()), video_range, Image::Alignment::COMPACT, fast
+	auto image = prox.image;
+	auto const out_format = pixel_format(image->pixel_format());
+	if (fast && image->pixel_format() == AV_PIX_FMT_XYZ12LE && out_format != AV_PIX_FMT_XYZ12LE) {
+		/* This is for the viewer, and libswscale's XYZ to RGB conversion is slow, so do our own
+		 * (before scaling, as J2KImageProxy will already have got the image close to the size we want).
+		 */
+		image = fast_xyz_to_rgb(*image);
+	}
+
+	return image->crop_scale_window (
+		total_crop, _inter_size, _out_size, yuv_to_rgb, _video_range, out_format, video_range, Image::Alignment::COMPACT, fast, lines_ready
 		);
+}
 
-	if (_text) {
-		_image->alpha_blend (_text->image, _text->position);
+
+/** @return This frame converted to XYZ using its colour conversion, or nullptr if that cannot be done
+ *  here.  The conversion to XYZ is done a few lines at a time as the scaler produces them, rather than
+ *  in a second pass over the whole RGB image, and the RGB image is not kept.
+ *  XYZ JPEG2000 which needs no crop or scale (other than by discarding resolution levels)
+ *  is decoded straight into the returned image.
+ *  Otherwise, if the frame has no colour conversion, has subtitles or a fade (which must be applied
+ *  to the RGB first), or its source is already XYZ, nullptr is returned and the caller should
+ *  use image(&PlayerVideo::keep_xyz_or_rgb, VideoRange::FULL, false) instead.
+ */
+shared_ptr<dcp::OpenJPEGImage>
+PlayerVideo::xyz_image () const
+{
+	if (_text || _fade) {
+		return {};
 	}
 
-	if (_fade) {
-		_image->fade (_fade.get ());
+	if (!_colour_conversion && _crop == Crop() && _part == Part::WHOLE && _inter_size == _out_size && _video_range == VideoRange::FULL) {
+		/* If we have XYZ JPEG2000 which just needs decoding (perhaps at a lower resolution)
+		 * we can decode it straight into the XYZ image.
+		 */
+		if (auto j2k = dynamic_pointer_cast<const J2KImageProxy>(_in)) {
+			if (auto xyz = j2k->xyz(_out_size)) {
+				return xyz;
+			}
+		}
+	}
+
+	if (!_colour_conversion) {
+		return {};
 	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	auto const converter = FastRGBToXYZ::cached(_colour_conversion.get());
+	auto xyz = pooled_xyz_image(_out_size);
+
+	bool rgb = true;
+	auto convert = [&converter, &rgb, xyz](Image const& image, int y, int lines) {
+		if (image.pixel_format() != AV_PIX_FMT_RGB48LE) {
+			rgb = false;
+			return;
+		}
+		auto const offset = y * image.size().width;
+		converter->convert(
+			image.data()[0] + y * image.stride()[0], image.size().width, image.stride()[0], lines,
+			xyz->data(0) + offset, xyz->data(1) + offset, xyz->data(2) + offset
+			);
+	};
+
+	if (_image && _crop == _image_crop && _inter_size == _image_inter_size && _out_size == _image_out_size && !_image_fade) {
+		/* We already have the image, so just convert that */
+		convert(*_image, 0, _image->size().height);
+		return rgb ? xyz : nullptr;
+	}
+
+	auto image = crop_scale (&PlayerVideo::keep_xyz_or_rgb, VideoRange::FULL, false, convert);
+	if (!rgb) {
+		/* Keep the image so that image() does not have to make it again */
+		_image_crop = _crop;
+		_image_inter_size = _inter_size;
+		_image_out_size = _out_size;
+		_image_fade = _fade;
+		_image = image;
+		return {};
+	}
+
+	return xyz;
 }
 
 
@@ -226,12 +404,47 @@ PlayerVideo::add_metadata (xmlpp::Node* node) const
 }
 
 
+/** Write the same information as add_metadata(xmlpp::Node*), but in the compact
+ *  binary form.  The image proxy's metadata is written last as it is followed
+ *  directly by the image data.
+ */
+void
+PlayerVideo::add_metadata (EncodingRequestWriter& writer) const
+{
+	writer.write_int(_crop.left);
+	writer.write_int(_crop.right);
+	writer.write_int(_crop.top);
+	writer.write_int(_crop.bottom);
+	writer.write_optional_double(_fade);
+	writer.write_int(_inter_size.width);
+	writer.write_int(_inter_size.height);
+	writer.write_int(_out_size.width);
+	writer.write_int(_out_size.height);
+	writer.write_int(static_cast<int>(_eyes));
+	writer.write_int(static_cast<int>(_part));
+	writer.write_int(static_cast<int>(_video_range));
+	writer.write_bool(_error);
+	writer.write_bool(static_cast<bool>(_colour_conversion));
+	if (_colour_conversion) {
+		_colour_conversion->as_binary(writer);
+	}
+	writer.write_bool(static_cast<bool>(_text));
+	if (_text) {
+		writer.write_int(_text->image->size().width);
+		writer.write_int(_text->image->size().height);
+		writer.write_int(_text->position.x);
+		writer.write_int(_text->position.y);
+	}
+	_in->add_metadata(writer);
+}
+
+
 void
-PlayerVideo::write_to_socket (shared_ptr<Socket> socket) const
+PlayerVideo::write_to_socket (shared_ptr<Socket> socket, TransportCompression compression) const
 {
-	_in->write_to_socket (socket);
+	_in->write_to_socket (socket, compression);
 	if (_text) {
-		_text->image->write_to_socket (socket);
+		_text->image->write_to_socket (socket, compression);
 	}
 }
 
@@ -239,14 +452,22 @@ PlayerVideo::write_to_socket (shared_ptr<Socket> socket) const
 bool
 PlayerVideo::has_j2k () const
 {
-	/* XXX: maybe other things */
+	/* The J2K can be used as-is only if nothing would change any pixel of the picture it
+	 * decodes to: no crop, scale, 3D split, burnt-in text, fade or colour conversion.
+	 */
 
 	auto j2k = dynamic_pointer_cast<const J2KImageProxy> (_in);
 	if (!j2k) {
 		return false;
 	}
 
-	return _crop == Crop() && _out_size == j2k->size() && _inter_size == j2k->size() && !_text && !_fade && !_colour_conversion;
+	return _crop == Crop() &&
+		_part == Part::WHOLE &&
+		_out_size == j2k->size() &&
+		_inter_size == j2k->size() &&
+		!_text &&
+		!_fade &&
+		!_colour_conversion;
 }
 
 
@@ -297,6 +518,93 @@ PlayerVideo::same (shared_ptr<const PlayerVideo> other) const
 }
 
 
+/** Share our cropped and scaled image with another PlayerVideo made from the same input,
+ *  so that only one of us needs to make it.  This is useful for the many PlayerVideos
+ *  made from a piece of still image content.  Nothing is shared if other has a
+ *  different input or settings.
+ */
+void
+PlayerVideo::share_scaled_image (shared_ptr<const PlayerVideo> other)
+{
+	if (
+		_in != other->_in ||
+		_crop != other->_crop ||
+		_inter_size != other->_inter_size ||
+		_out_size != other->_out_size ||
+		_part != other->_part ||
+		_colour_conversion != other->_colour_conversion ||
+		_video_range != other->_video_range) {
+		return;
+	}
+
+	shared_ptr<Scaled> scaled;
+	{
+		boost::mutex::scoped_lock lm (other->_mutex);
+		if (!other->_scaled) {
+			other->_scaled = make_shared<Scaled>();
+		}
+		scaled = other->_scaled;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	_scaled = scaled;
+}
+
+
+/** @return A digest of everything that goes into making this frame's image (its source content
+ *  and frame, and how they are cropped, scaled, faded, converted and overlaid) or an empty
+ *  optional if the frame cannot be described that way (for example, if it is not from content).
+ *  Frames with the same recipe will produce the same image.
+ */
+optional<string>
+PlayerVideo::recipe () const
+{
+	auto content = _content.lock();
+	if (!content || !_video_frame || _error) {
+		return {};
+	}
+
+	/* The content's position and trim don't change its frames, so leave them out; then frames
+	 * which have just moved in the timeline can still be recognised.
+	 */
+	auto identifier = content->identifier();
+	identifier.replace(0, content->Content::identifier().size(), content->digest());
+
+	Digester digester;
+	digester.add(identifier);
+	digester.add(*_video_frame);
+	digester.add(_crop.left);
+	digester.add(_crop.right);
+	digester.add(_crop.top);
+	digester.add(_crop.bottom);
+	digester.add(_fade.get_value_or(-1));
+	digester.add(_inter_size.width);
+	digester.add(_inter_size.height);
+	digester.add(_out_size.width);
+	digester.add(_out_size.height);
+	digester.add(static_cast<int>(_eyes));
+	digester.add(static_cast<int>(_part));
+	digester.add(_colour_conversion ? _colour_conversion->identifier() : string("none"));
+	digester.add(static_cast<int>(_video_range));
+
+	if (_text) {
+		auto const& image = _text->image;
+		digester.add(_text->position.x);
+		digester.add(_text->position.y);
+		digester.add(static_cast<int>(image->pixel_format()));
+		digester.add(image->size().width);
+		digester.add(image->size().height);
+		for (int c = 0; c < image->planes(); ++c) {
+			for (int y = 0; y < image->sample_size(c).height; ++y) {
+				digester.add(image->data()[c] + y * image->stride()[c], image->line_size()[c]);
+			}
+		}
+	}
+
+	return digester.get();
+}
+
+
 AVPixelFormat
 PlayerVideo::force (AVPixelFormat force_to)
 {
@@ -310,6 +618,14 @@ PlayerVideo::keep_xyz_or_rgb (AVPixelFormat p)
 }
 
 
+/** Keep the YUV formats that a viewer can convert to RGB itself, and convert anything else to RGB24 */
+AVPixelFormat
+PlayerVideo::keep_yuv_or_rgb (AVPixelFormat p)
+{
+	return (p == AV_PIX_FMT_YUV420P || p == AV_PIX_FMT_YUV422P10LE) ? p : AV_PIX_FMT_RGB24;
+}
+
+
 void
 PlayerVideo::prepare (function<AVPixelFormat (AVPixelFormat)> pixel_format, VideoRange video_range, Image::Alignment alignment, bool fast, bool proxy_only)
 {
@@ -324,7 +640,17 @@ PlayerVideo::prepare (function<AVPixelFormat (AVPixelFormat)> pixel_format, Vide
 size_t
 PlayerVideo::memory_used () const
 {
-	return _in->memory_used();
+	auto m = _in->memory_used();
+
+	/* If someone is preparing our image we'll not wait for them, and count
+	 * it next time.
+	 */
+	boost::mutex::scoped_lock lm (_mutex, boost::try_to_lock);
+	if (lm && _image) {
+		m += _image->memory_used();
+	}
+
+	return m;
 }
 
 
@@ -35,6 +35,12 @@ extern "C" {
 #include <boost/thread/mutex.hpp>
 
 
+namespace dcp {
+	class OpenJPEGImage;
+}
+
+class EncodingRequestReader;
+class EncodingRequestWriter;
 class Image;
 class ImageProxy;
 class Film;
@@ -64,6 +70,7 @@ public:
 		);
 
 	PlayerVideo (std::shared_ptr<cxml::Node>, std::shared_ptr<Socket>);
+	PlayerVideo (EncodingRequestReader& reader, std::shared_ptr<Socket> socket, TransportCompression compression);
 
 	PlayerVideo (PlayerVideo const&) = delete;
 	PlayerVideo& operator= (PlayerVideo const&) = delete;
@@ -78,12 +85,15 @@ public:
 	void prepare (std::function<AVPixelFormat (AVPixelFormat)> pixel_format, VideoRange video_range, Image::Alignment alignment, bool fast, bool proxy_only);
 	std::shared_ptr<Image> image (std::function<AVPixelFormat (AVPixelFormat)> pixel_format, VideoRange video_range, bool fast) const;
 	std::shared_ptr<const Image> raw_image () const;
+	std::shared_ptr<dcp::OpenJPEGImage> xyz_image () const;
 
 	static AVPixelFormat force (AVPixelFormat);
 	static AVPixelFormat keep_xyz_or_rgb (AVPixelFormat);
+	static AVPixelFormat keep_yuv_or_rgb (AVPixelFormat);
 
 	void add_metadata (xmlpp::Node* node) const;
-	void write_to_socket (std::shared_ptr<Socket> socket) const;
+	void add_metadata (EncodingRequestWriter& writer) const;
+	void write_to_socket (std::shared_ptr<Socket> socket, TransportCompression compression) const;
 
 	bool reset_metadata (std::shared_ptr<const Film> film, dcp::Size player_video_container_size);
 
@@ -115,7 +125,10 @@ public:
 	}
 
 	bool same (std::shared_ptr<const PlayerVideo> other) const;
+	void share_scaled_image (std::shared_ptr<const PlayerVideo> other);
+	boost::optional<std::string> recipe () const;
 
+	/** @return approximate memory used by our input and any image that we have prepared from it */
 	size_t memory_used () const;
 
 	std::weak_ptr<Content> content () const {
@@ -128,6 +141,12 @@ public:
 
 private:
 	void make_image (std::function<AVPixelFormat (AVPixelFormat)> pixel_format, VideoRange video_range, bool fast) const;
+	std::shared_ptr<Image> crop_scale (
+		std::function<AVPixelFormat (AVPixelFormat)> pixel_format,
+		VideoRange video_range,
+		bool fast,
+		std::function<void (Image const&, int, int)> lines_ready
+		) const;
 
 	std::shared_ptr<const ImageProxy> _in;
 	Crop _crop;
@@ -144,7 +163,25 @@ private:
 	/** Video frame that we came from.  Again, this is for reset_metadata() */
 	boost::optional<Frame> _video_frame;
 
+	/** Our input after crop and scale (but before any text or fade), which can be
+	 *  shared by PlayerVideos that have the same input (see share_scaled_image()).
+	 */
+	struct Scaled
+	{
+		boost::mutex mutex;
+		std::shared_ptr<Image> image;
+		/** Settings that were used to make image */
+		Crop crop;
+		dcp::Size inter_size;
+		dcp::Size out_size;
+		VideoRange video_range = VideoRange::FULL;
+		bool fast = false;
+		bool error = false;
+	};
+
 	mutable boost::mutex _mutex;
+	/** The scaled image that we can share with others, which may be nullptr */
+	mutable std::shared_ptr<Scaled> _scaled;
 	mutable std::shared_ptr<Image> _image;
 	/** _crop that was used to make _image */
 	mutable Crop _image_crop;
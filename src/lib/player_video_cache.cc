@@ -0,0 +1,131 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "player_video.h"
+#include "player_video_cache.h"
+
+
+using std::make_pair;
+using std::pair;
+using std::shared_ptr;
+using boost::optional;
+using namespace dcpomatic;
+
+
+PlayerVideoCache::PlayerVideoCache (size_t memory_limit)
+	: _memory_limit (memory_limit)
+{
+
+}
+
+
+void
+PlayerVideoCache::put (shared_ptr<PlayerVideo> video, DCPTime time)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	auto existing = _frames.find(time);
+	if (existing != _frames.end()) {
+		_memory_used -= existing->second.memory;
+		_frames.erase (existing);
+	}
+
+	auto const memory = video->memory_used();
+	_frames[time] = { video, memory };
+	_memory_used += memory;
+	_focus = time;
+
+	evict ();
+}
+
+
+/** @return The frame within tolerance of time which is nearest to it, if there is one */
+optional<pair<shared_ptr<PlayerVideo>, DCPTime>>
+PlayerVideoCache::get (DCPTime time, DCPTime tolerance)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	auto best = _frames.end();
+	for (auto i = _frames.lower_bound(time - tolerance); i != _frames.end() && i->first <= (time + tolerance); ++i) {
+		if (best == _frames.end() || (i->first - time).abs() < (best->first - time).abs()) {
+			best = i;
+		}
+	}
+
+	if (best == _frames.end()) {
+		return {};
+	}
+
+	_focus = best->first;
+	return make_pair(best->second.video, best->first);
+}
+
+
+void
+PlayerVideoCache::clear ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_frames.clear ();
+	_memory_used = 0;
+}
+
+
+void
+PlayerVideoCache::set_memory_limit (size_t limit)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_memory_limit = limit;
+	evict ();
+}
+
+
+size_t
+PlayerVideoCache::memory_used () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	return _memory_used;
+}
+
+
+size_t
+PlayerVideoCache::size () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	return _frames.size();
+}
+
+
+/** Remove frames, furthest from _focus first, until we are within our limit.
+ *  A lock must be held on _mutex.
+ */
+void
+PlayerVideoCache::evict ()
+{
+	while (_memory_used > _memory_limit && !_frames.empty()) {
+		auto const first = _frames.begin();
+		auto const last = std::prev(_frames.end());
+		auto const victim = (_focus - first->first) > (last->first - _focus) ? first : last;
+		_memory_used -= victim->second.memory;
+		_frames.erase (victim);
+	}
+}
@@ -0,0 +1,79 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_PLAYER_VIDEO_CACHE_H
+#define DCPOMATIC_PLAYER_VIDEO_CACHE_H
+
+
+#include "dcpomatic_time.h"
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <memory>
+
+
+class PlayerVideo;
+
+
+/** @class PlayerVideoCache
+ *  @brief A memory-limited store of PlayerVideo objects keyed on their time.
+ *
+ *  When the cache is over its limit the frames furthest from the one most recently
+ *  added or found are thrown away first, so it tends to hold the frames either side
+ *  of a viewer's playhead.
+ */
+class PlayerVideoCache
+{
+public:
+	explicit PlayerVideoCache (size_t memory_limit);
+
+	PlayerVideoCache (PlayerVideoCache const&) = delete;
+	PlayerVideoCache& operator= (PlayerVideoCache const&) = delete;
+
+	void put (std::shared_ptr<PlayerVideo> video, dcpomatic::DCPTime time);
+	boost::optional<std::pair<std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime>> get (dcpomatic::DCPTime time, dcpomatic::DCPTime tolerance);
+	void clear ();
+	void set_memory_limit (size_t limit);
+
+	size_t memory_used () const;
+	size_t size () const;
+
+private:
+	void evict ();
+
+	struct Entry
+	{
+		std::shared_ptr<PlayerVideo> video;
+		size_t memory;
+	};
+
+	mutable boost::mutex _mutex;
+	std::map<dcpomatic::DCPTime, Entry> _frames;
+	size_t _memory_used = 0;
+	size_t _memory_limit;
+	/** Time of the frame that was most recently added or found */
+	dcpomatic::DCPTime _focus;
+};
+
+
+#endif
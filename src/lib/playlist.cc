@@ -27,6 +27,7 @@
 #include "digester.h"
 #include "ffmpeg_content.h"
 #include "ffmpeg_decoder.h"
+#include "film.h"
 #include "image_decoder.h"
 #include "job.h"
 #include "playlist.h"
@@ -44,6 +45,7 @@
 using std::cout;
 using std::dynamic_pointer_cast;
 using std::list;
+using std::make_shared;
 using std::max;
 using std::min;
 using std::pair;
@@ -94,6 +96,9 @@ Playlist::content_change (weak_ptr<const Film> weak_film, ChangeType type, weak_
 	auto film = weak_film.lock ();
 	DCPOMATIC_ASSERT (film);
 
+	/* We don't know which properties affect what Content::end() returns, so assume they all might */
+	invalidate_geometry ();
+
 	if (type == ChangeType::DONE) {
 		if (
 			property == ContentProperty::TRIM_START ||
@@ -275,6 +280,7 @@ Playlist::set_from_xml (shared_ptr<const Film> film, cxml::ConstNodePtr node, in
 	sort (_content.begin(), _content.end(), ContentSorter ());
 
 	reconnect (film);
+	invalidate_geometry ();
 }
 
 
@@ -300,6 +306,7 @@ Playlist::add (shared_ptr<const Film> film, shared_ptr<Content> c)
 		_content.push_back (c);
 		sort (_content.begin(), _content.end(), ContentSorter ());
 		reconnect (film);
+		invalidate_geometry ();
 	}
 
 	Change (ChangeType::DONE);
@@ -325,6 +332,7 @@ Playlist::remove (shared_ptr<Content> c)
 
 		if (i != _content.end()) {
 			_content.erase (i);
+			invalidate_geometry ();
 		} else {
 			cancelled = true;
 		}
@@ -360,6 +368,8 @@ Playlist::remove (ContentList c)
 				_content.erase (j);
 			}
 		}
+
+		invalidate_geometry ();
 	}
 
 	Change (ChangeType::DONE);
@@ -403,6 +413,8 @@ Playlist::best_video_frame_rate () const
 		candidates.push_back (FrameRateCandidate (float(i) * 2, i));
 	}
 
+	auto const cont = content ();
+
 	/* Pick the best one */
 	float error = std::numeric_limits<float>::max ();
 	optional<FrameRateCandidate> best;
@@ -410,7 +422,7 @@ Playlist::best_video_frame_rate () const
 	while (i != candidates.end()) {
 
 		float this_error = 0;
-		for (auto j: content()) {
+		for (auto j: cont) {
 			if (!j->video || !j->video_frame_rate()) {
 				continue;
 			}
@@ -445,12 +457,7 @@ Playlist::best_video_frame_rate () const
 DCPTime
 Playlist::length (shared_ptr<const Film> film) const
 {
-	DCPTime len;
-	for (auto i: content()) {
-		len = max (len, i->end(film));
-	}
-
-	return len;
+	return geometry(film)->length;
 }
 
 
@@ -458,6 +465,12 @@ Playlist::length (shared_ptr<const Film> film) const
 optional<DCPTime>
 Playlist::start () const
 {
+	/* This doesn't depend on the film, so any Geometry we have will do */
+	auto cached = std::atomic_load (&_geometry);
+	if (cached) {
+		return cached->start;
+	}
+
 	auto cont = content ();
 	if (cont.empty()) {
 		return {};
@@ -499,28 +512,87 @@ Playlist::reconnect (shared_ptr<const Film> film)
 DCPTime
 Playlist::video_end (shared_ptr<const Film> film) const
 {
-	DCPTime end;
-	for (auto i: content()) {
-		if (i->video) {
-			end = max (end, i->end(film));
-		}
-	}
-
-	return end;
+	return geometry(film)->video_end;
 }
 
 
 DCPTime
 Playlist::text_end (shared_ptr<const Film> film) const
 {
-	DCPTime end;
-	for (auto i: content()) {
-		if (!i->text.empty ()) {
-			end = max (end, i->end(film));
+	return geometry(film)->text_end;
+}
+
+
+/** @return sorted list of the times at which video content asks for a new reel to start,
+ *  or ends.
+ */
+list<DCPTime>
+Playlist::video_split_points (shared_ptr<const Film> film) const
+{
+	return geometry(film)->video_split_points;
+}
+
+
+/** @return a Geometry for `film', either one that we made earlier or a new one */
+shared_ptr<const Playlist::Geometry>
+Playlist::geometry (shared_ptr<const Film> film) const
+{
+	auto cached = std::atomic_load (&_geometry);
+	if (cached && cached->film == film.get() && cached->video_frame_rate == film->video_frame_rate()) {
+		return cached;
+	}
+
+	int64_t generation;
+	{
+		boost::mutex::scoped_lock lm (_geometry_mutex);
+		generation = _geometry_generation;
+	}
+
+	auto geometry = make_shared<Geometry>();
+	geometry->film = film.get();
+	geometry->video_frame_rate = film->video_frame_rate();
+	geometry->content = content ();
+
+	for (auto i: geometry->content) {
+		auto const period = i->period(film);
+		geometry->periods.push_back (period);
+		geometry->length = max (geometry->length, period.to);
+		geometry->start = geometry->start ? min(*geometry->start, period.from) : period.from;
+		if (i->video) {
+			geometry->video_end = max (geometry->video_end, period.to);
+			for (auto t: i->reel_split_points(film)) {
+				geometry->video_split_points.push_back (t);
+			}
+			geometry->video_split_points.push_back (period.to);
+		}
+		if (!i->text.empty()) {
+			geometry->text_end = max (geometry->text_end, period.to);
 		}
 	}
 
-	return end;
+	geometry->video_split_points.sort ();
+	geometry->video_split_points.unique ();
+
+	/* Content::end() depends on the film's playlist, so if we are not that playlist we
+	 * won't hear about everything that might change our answers.
+	 */
+	if (film->playlist().get() == this) {
+		boost::mutex::scoped_lock lm (_geometry_mutex);
+		if (generation == _geometry_generation) {
+			std::atomic_store (&_geometry, shared_ptr<const Geometry>(geometry));
+		}
+	}
+
+	return geometry;
+}
+
+
+void
+Playlist::invalidate_geometry ()
+{
+	boost::mutex::scoped_lock lm (_geometry_mutex);
+	++_geometry_generation;
+	std::atomic_store (&_geometry, shared_ptr<const Geometry>());
 }
 
 
@@ -595,6 +667,7 @@ Playlist::repeat (shared_ptr<const Film> film, ContentList c, int n)
 
 		sort (_content.begin(), _content.end(), ContentSorter ());
 		reconnect (film);
+		invalidate_geometry ();
 	}
 
 	Change (ChangeType::DONE);
@@ -670,11 +743,14 @@ Playlist::required_disk_space (shared_ptr<const Film> film, int j2k_bandwidth, i
 string
 Playlist::content_summary (shared_ptr<const Film> film, DCPTimePeriod period) const
 {
+	auto const geom = geometry (film);
+
 	string best_summary;
 	int best_score = -1;
-	for (auto i: content()) {
+	for (size_t index = 0; index < geom->content.size(); ++index) {
+		auto i = geom->content[index];
 		int score = 0;
-		auto const o = i->period(film).overlap(period);
+		auto const o = geom->periods[index].overlap(period);
 		if (o) {
 			score += 100 * o.get().duration().get() / period.duration().get();
 		}
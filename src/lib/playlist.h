@@ -31,6 +31,7 @@
 #include <boost/signals2.hpp>
 #include <boost/thread.hpp>
 #include <list>
+#include <vector>
 
 
 class Film;
@@ -70,6 +71,7 @@ public:
 	int best_video_frame_rate () const;
 	dcpomatic::DCPTime video_end (std::shared_ptr<const Film> film) const;
 	dcpomatic::DCPTime text_end (std::shared_ptr<const Film> film) const;
+	std::list<dcpomatic::DCPTime> video_split_points (std::shared_ptr<const Film> film) const;
 	FrameRateChange active_frame_rate_change (dcpomatic::DCPTime, int dcp_frame_rate) const;
 	std::string content_summary (std::shared_ptr<const Film> film, dcpomatic::DCPTimePeriod period) const;
 	std::pair<double, double> speed_up_range (int dcp_video_frame_rate) const;
@@ -92,12 +94,44 @@ private:
 	void disconnect ();
 	void reconnect (std::shared_ptr<const Film> film);
 
+	/** Positions of things on the timeline, which are slow to work out (Content::end()
+	 *  does frame rate change sums) but asked for very often.
+	 */
+	struct Geometry
+	{
+		/** Film and video frame rate that this was worked out for */
+		Film const* film = nullptr;
+		int video_frame_rate = 0;
+		/** Content, in the same order as _content */
+		ContentList content;
+		/** DCP period of each piece of content in `content' */
+		std::vector<dcpomatic::DCPTimePeriod> periods;
+		dcpomatic::DCPTime length;
+		boost::optional<dcpomatic::DCPTime> start;
+		dcpomatic::DCPTime video_end;
+		dcpomatic::DCPTime text_end;
+		/** Sorted points where video content starts new reels or ends */
+		std::list<dcpomatic::DCPTime> video_split_points;
+	};
+
+	std::shared_ptr<const Geometry> geometry (std::shared_ptr<const Film> film) const;
+	void invalidate_geometry ();
+
 	mutable boost::mutex _mutex;
 	/** List of content, kept sorted by ContentSorter() */
 	ContentList _content;
 	bool _sequence = true;
 	bool _sequencing = false;
 	std::list<boost::signals2::connection> _content_connections;
+
+	/** Our most recent Geometry, or nullptr if it must be worked out again.  This is only read
+	 *  and written using std::atomic_load and std::atomic_store so it needs no lock to look at.
+	 */
+	mutable std::shared_ptr<const Geometry> _geometry;
+	/** Mutex to stop a Geometry being kept if an invalidation happened while it was being made */
+	mutable boost::mutex _geometry_mutex;
+	/** Incremented on every invalidation; protected by _geometry_mutex */
+	int64_t _geometry_generation = 0;
 };
 
 
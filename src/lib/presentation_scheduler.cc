@@ -0,0 +1,171 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "presentation_scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+using std::max;
+using boost::optional;
+
+
+/** Number of presentations to look at when guessing the refresh period */
+static int constexpr intervals_for_guess = 16;
+/** Longest refresh period that we will guess (i.e. the lowest refresh rate is 30Hz) */
+static double constexpr longest_guess = 1.0 / 30;
+
+
+void
+PresentationScheduler::start ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_statistics = Statistics();
+	_last_presented = boost::none;
+}
+
+
+void
+PresentationScheduler::set_vsync (bool vsync)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_vsync = vsync;
+}
+
+
+/** @param period Refresh period of the display, or empty if it is not known */
+void
+PresentationScheduler::set_refresh_period (optional<double> period)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_refresh_period = period;
+}
+
+
+optional<double>
+PresentationScheduler::refresh_period () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	return _refresh_period;
+}
+
+
+/** @return How long after drawing a frame we expect it to appear.  A lock must be held on _mutex */
+double
+PresentationScheduler::lead () const
+{
+	return (_vsync && _refresh_period) ? *_refresh_period / 2 : 0;
+}
+
+
+/** @param due_in Time until the next frame is due to be seen.
+ *  @return Time to wait before drawing it.
+ */
+double
+PresentationScheduler::wait (double due_in) const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	return max(0.0, due_in - lead());
+}
+
+
+/** @param due_in Time until the next frame is due to be seen (negative if it is overdue).
+ *  @param frame_period Time between video frames.
+ *  @return true if the frame would appear so late that the one after it would be due by then,
+ *  so that it should be dropped.
+ */
+bool
+PresentationScheduler::too_late (double due_in, double frame_period) const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	return (due_in + frame_period) < lead();
+}
+
+
+/** Record that a frame has been drawn.
+ *  @param now Time that it was drawn, as given by now().
+ *  @param lateness How long after its due time it was drawn (negative if it was early).
+ *  @param frame_period Time between video frames.
+ */
+void
+PresentationScheduler::presented (double now, double lateness, double frame_period)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (_last_presented) {
+		auto const interval = now - *_last_presented;
+		if (_vsync && _refresh_period) {
+			/* Presentations should be some whole number of refreshes apart; use that to refine our idea
+			 * of the refresh period, since the one we were given may have been rounded.
+			 */
+			auto const refreshes = std::lrint(interval / *_refresh_period);
+			if (refreshes >= 1 && refreshes <= 4 && std::abs(interval - refreshes * *_refresh_period) < *_refresh_period / 4) {
+				*_refresh_period += (interval / refreshes - *_refresh_period) / 20;
+			}
+		} else if (_vsync && interval > 0) {
+			if (!_shortest_interval || interval < *_shortest_interval) {
+				_shortest_interval = interval;
+			}
+			if (++_intervals >= intervals_for_guess && *_shortest_interval < longest_guess) {
+				_refresh_period = _shortest_interval;
+			}
+		}
+	}
+
+	_last_presented = now;
+
+	++_statistics.presented;
+	/* With vsync a frame will appear anywhere up to half a refresh after it is due, so only count it as
+	 * late if it is later than that; without vsync, if it is drawn nearer to the next frame's time.
+	 */
+	auto const allowed = (_vsync && _refresh_period) ? *_refresh_period / 2 : frame_period / 2;
+	if (lateness > allowed + 1e-3) {
+		++_statistics.late;
+	}
+	_statistics.worst_lateness = max(_statistics.worst_lateness, lateness);
+}
+
+
+void
+PresentationScheduler::dropped ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	++_statistics.missed;
+}
+
+
+PresentationScheduler::Statistics
+PresentationScheduler::statistics () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	return _statistics;
+}
+
+
+/** @return Current time from a monotonic clock */
+double
+PresentationScheduler::now ()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,92 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_PRESENTATION_SCHEDULER_H
+#define DCPOMATIC_PRESENTATION_SCHEDULER_H
+
+
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+/** @class PresentationScheduler
+ *  @brief Decides when a viewer should draw its video frames, and keeps statistics about how
+ *  well it is keeping up.
+ *
+ *  If the display is synchronised to its vertical refresh a frame will appear on the refresh
+ *  after it is drawn, so the scheduler aims to draw frames half a refresh period before they
+ *  are due; that way they appear on the refresh nearest to their due time.
+ *
+ *  All times are in seconds.  The methods may be called from any thread.
+ */
+class PresentationScheduler
+{
+public:
+	/** Reset statistics; called when playback starts */
+	void start ();
+
+	void set_vsync (bool vsync);
+	void set_refresh_period (boost::optional<double> period);
+	boost::optional<double> refresh_period () const;
+
+	double wait (double due_in) const;
+	bool too_late (double due_in, double frame_period) const;
+
+	void presented (double now, double lateness, double frame_period);
+	void dropped ();
+
+	struct Statistics
+	{
+		/** Number of frames that were drawn */
+		int presented = 0;
+		/** Number of frames that were drawn noticeably after they were due */
+		int late = 0;
+		/** Number of frames that were not drawn because they could not be drawn in time */
+		int missed = 0;
+		/** Greatest lateness of any drawn frame */
+		double worst_lateness = 0;
+	};
+
+	Statistics statistics () const;
+
+	static double now ();
+
+private:
+	double lead () const;
+
+	mutable boost::mutex _mutex;
+	bool _vsync = false;
+	/** Period of the display's refresh, if we know it */
+	boost::optional<double> _refresh_period;
+	/** Time that the last frame was presented */
+	boost::optional<double> _last_presented;
+	/** Shortest time between presentations since start(), used to guess the refresh period
+	 *  if we were not told it.
+	 */
+	boost::optional<double> _shortest_interval;
+	int _intervals = 0;
+	Statistics _statistics;
+};
+
+
+#endif
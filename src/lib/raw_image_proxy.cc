@@ -19,8 +19,9 @@
 */
 
 
-#include "raw_image_proxy.h"
+#include "encoding_request.h"
 #include "image.h"
+#include "raw_image_proxy.h"
 #include <dcp/raw_convert.h>
 #include <dcp/util.h>
 #include <dcp/warnings.h>
@@ -45,21 +46,34 @@ using boost::optional;
 using dcp::raw_convert;
 
 
-RawImageProxy::RawImageProxy(shared_ptr<const Image> image)
+RawImageProxy::RawImageProxy(shared_ptr<const Image> image, int log2_scaling)
 	: _image (image)
+	, _log2_scaling (log2_scaling)
 {
 
 }
 
 
-RawImageProxy::RawImageProxy (shared_ptr<cxml::Node> xml, shared_ptr<Socket> socket)
+RawImageProxy::RawImageProxy (shared_ptr<cxml::Node> xml, shared_ptr<Socket> socket, TransportCompression compression)
 {
 	dcp::Size size (
 		xml->number_child<int>("Width"), xml->number_child<int>("Height")
 		);
 
 	auto image = make_shared<Image>(static_cast<AVPixelFormat>(xml->number_child<int>("PixelFormat")), size, Image::Alignment::PADDED);
-	image->read_from_socket (socket);
+	image->read_from_socket (socket, compression);
+	_image = image;
+}
+
+
+RawImageProxy::RawImageProxy (EncodingRequestReader& reader, shared_ptr<Socket> socket, TransportCompression compression)
+{
+	auto const width = reader.read_int();
+	auto const height = reader.read_int();
+	auto const pixel_format = static_cast<AVPixelFormat>(reader.read_int());
+
+	auto image = make_shared<Image>(pixel_format, dcp::Size(width, height), Image::Alignment::PADDED);
+	image->read_from_socket (socket, compression);
 	_image = image;
 }
 
@@ -67,8 +81,8 @@ RawImageProxy::RawImageProxy (shared_ptr<cxml::Node> xml, shared_ptr<Socket> soc
 ImageProxy::Result
 RawImageProxy::image (Image::Alignment alignment, optional<dcp::Size>) const
 {
-	/* This ensure_alignment could be wasteful */
-	return Result (Image::ensure_alignment(_image, alignment), 0);
+	/* This only copies if _image is not already laid out in the way that the caller wants */
+	return Result (Image::ensure_alignment(_image, alignment), _log2_scaling);
 }
 
 
@@ -83,9 +97,19 @@ RawImageProxy::add_metadata (xmlpp::Node* node) const
 
 
 void
-RawImageProxy::write_to_socket (shared_ptr<Socket> socket) const
+RawImageProxy::add_metadata (EncodingRequestWriter& writer) const
+{
+	writer.write_uint(static_cast<uint32_t>(Type::RAW));
+	writer.write_int(_image->size().width);
+	writer.write_int(_image->size().height);
+	writer.write_int(static_cast<int>(_image->pixel_format()));
+}
+
+
+void
+RawImageProxy::write_to_socket (shared_ptr<Socket> socket, TransportCompression compression) const
 {
-	_image->write_to_socket (socket);
+	_image->write_to_socket (socket, compression);
 }
 
 
@@ -97,7 +121,7 @@ RawImageProxy::same (shared_ptr<const ImageProxy> other) const
 		return false;
 	}
 
-	return (*_image.get()) == (*rp->image(_image->alignment()).image.get());
+	return _log2_scaling == rp->_log2_scaling && (*_image.get()) == (*rp->image(_image->alignment()).image.get());
 }
 
 
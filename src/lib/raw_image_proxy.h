@@ -29,8 +29,9 @@
 class RawImageProxy : public ImageProxy
 {
 public:
-	explicit RawImageProxy(std::shared_ptr<const Image>);
-	RawImageProxy (std::shared_ptr<cxml::Node> xml, std::shared_ptr<Socket> socket);
+	explicit RawImageProxy(std::shared_ptr<const Image>, int log2_scaling = 0);
+	RawImageProxy (std::shared_ptr<cxml::Node> xml, std::shared_ptr<Socket> socket, TransportCompression compression);
+	RawImageProxy (EncodingRequestReader& reader, std::shared_ptr<Socket> socket, TransportCompression compression);
 
 	Result image (
 		Image::Alignment alignment,
@@ -38,12 +39,15 @@ public:
 		) const override;
 
 	void add_metadata (xmlpp::Node *) const override;
-	void write_to_socket (std::shared_ptr<Socket>) const override;
+	void add_metadata (EncodingRequestWriter& writer) const override;
+	void write_to_socket (std::shared_ptr<Socket>, TransportCompression compression) const override;
 	bool same (std::shared_ptr<const ImageProxy>) const override;
 	size_t memory_used () const override;
 
 private:
 	std::shared_ptr<const Image> _image;
+	/** log2 of the factor by which _image has already been scaled down from its source */
+	int _log2_scaling = 0;
 };
 
 
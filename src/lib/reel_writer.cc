@@ -19,6 +19,7 @@
 */
 
 
+#include "atmos_mxf_content.h"
 #include "audio_buffers.h"
 #include "compose.hpp"
 #include "config.h"
@@ -57,6 +58,7 @@
 #include <dcp/sound_asset_writer.h>
 #include <dcp/stereo_picture_asset.h>
 #include <dcp/subtitle_image.h>
+#include <algorithm>
 
 #include "i18n.h"
 
@@ -66,6 +68,7 @@ using std::exception;
 using std::list;
 using std::make_shared;
 using std::map;
+using std::min;
 using std::set;
 using std::shared_ptr;
 using std::string;
@@ -83,6 +86,13 @@ using namespace dcpomatic;
 
 int const ReelWriter::_info_size = 48;
 
+/** Number of frames' info to save up before writing them to the info file */
+static size_t constexpr frame_info_batch_size = 64;
+/** Number of batches of frame info to write before making sure that the info file is on disk */
+static int constexpr frame_info_batches_per_sync = 4;
+/** Number of frames to check one by one at the end of an existing asset when resuming */
+static int constexpr existing_frames_to_check = 8;
+
 
 static dcp::MXFMetadata
 mxf_metadata ()
@@ -212,6 +222,31 @@ ReelWriter::ReelWriter (
 	}
 
 	_default_font = dcp::ArrayData(default_font_file());
+
+	if (!text_only && !film()->encrypted()) {
+		/* See if we can use an Atmos MXF as it is, rather than writing it again frame-by-frame */
+		for (auto content: film()->content()) {
+			auto atmos = dynamic_pointer_cast<const AtmosMXFContent>(content);
+			if (
+				atmos &&
+				atmos->position() == _period.from &&
+				atmos->end(film()) == _period.to &&
+				atmos->trim_start() == ContentTime() &&
+				atmos->video_frame_rate() &&
+				lrint(*atmos->video_frame_rate()) == film()->video_frame_rate()
+			   ) {
+				try {
+					dcp::AtmosAsset asset(atmos->path(0));
+					if (!asset.key_id()) {
+						_atmos_passthrough = atmos->path(0);
+						LOG_GENERAL("Using Atmos asset %1 as it is for reel %2", atmos->path(0).string(), _reel_index);
+					}
+				} catch (std::exception& e) {
+					LOG_WARNING("Could not read Atmos asset %1 (%2)", atmos->path(0).string(), e.what());
+				}
+			}
+		}
+	}
 }
 
 
@@ -219,7 +254,13 @@ ReelWriter::ReelWriter (
 void
 ReelWriter::write_frame_info (Frame frame, Eyes eyes, dcp::FrameInfo info) const
 {
-	auto handle = film()->info_file_handle(_period, false);
+	write_frame_info (film()->info_file_handle(_period, false), frame, eyes, info);
+}
+
+
+void
+ReelWriter::write_frame_info (shared_ptr<InfoFileHandle> handle, Frame frame, Eyes eyes, dcp::FrameInfo const& info) const
+{
 	handle->get().seek(frame_info_position(frame, eyes), SEEK_SET);
 	handle->get().checked_write(&info.offset, sizeof(info.offset));
 	handle->get().checked_write(&info.size, sizeof(info.size));
@@ -227,6 +268,45 @@ ReelWriter::write_frame_info (Frame frame, Eyes eyes, dcp::FrameInfo info) const
 }
 
 
+/** Add some frame info to be written to the info file later.  Opening, writing and closing
+ *  the info file for each frame is slow, particularly on network filesystems, so we save
+ *  up a batch and write them together.  If we are interrupted before the batch is written
+ *  the frames will be checked and re-made when resuming, since the info file will not
+ *  yet mention them.
+ */
+void
+ReelWriter::queue_frame_info (Frame frame, Eyes eyes, dcp::FrameInfo info)
+{
+	_pending_frame_info.push_back({frame, eyes, info});
+	if (_pending_frame_info.size() >= frame_info_batch_size) {
+		flush_frame_info ();
+	}
+}
+
+
+void
+ReelWriter::flush_frame_info ()
+{
+	if (_pending_frame_info.empty()) {
+		return;
+	}
+
+	auto handle = film()->info_file_handle(_period, false);
+	for (auto const& i: _pending_frame_info) {
+		write_frame_info (handle, i.frame, i.eyes, i.info);
+	}
+	_pending_frame_info.clear();
+
+	/* Periodically make sure the info is really on disk, so that we can trust it if we have
+	   to resume after a crash.
+	*/
+	if (++_frame_info_batches_since_sync >= frame_info_batches_per_sync) {
+		sync_file (handle->get().get());
+		_frame_info_batches_since_sync = 0;
+	}
+}
+
+
 dcp::FrameInfo
 ReelWriter::read_frame_info (shared_ptr<InfoFileHandle> info, Frame frame, Eyes eyes) const
 {
@@ -301,8 +381,29 @@ ReelWriter::check_existing_picture_asset (boost::filesystem::path asset)
 		first_nonexistent_frame = n;
 	}
 
-	while (!existing_picture_frame_ok(asset_file, info_file, first_nonexistent_frame) && first_nonexistent_frame > 0) {
+	/* Check the last few frames one by one, since that is where any damage from an interruption will be */
+	int checked = 0;
+	while (first_nonexistent_frame > 0 && checked < existing_frames_to_check && !existing_picture_frame_ok(asset_file, info_file, first_nonexistent_frame)) {
 		--first_nonexistent_frame;
+		++checked;
+	}
+
+	if (first_nonexistent_frame > 0 && checked == existing_frames_to_check) {
+		/* None of those were any good.  Frames are written in order, so the good ones should
+		   be at the start; rather than hashing every frame on the way back, look for the last
+		   good one with a binary search.
+		*/
+		Frame good = 0;
+		Frame unknown = first_nonexistent_frame;
+		while (good < unknown) {
+			auto const mid = (good + unknown + 1) / 2;
+			if (existing_picture_frame_ok(asset_file, info_file, mid)) {
+				good = mid;
+			} else {
+				unknown = mid - 1;
+			}
+		}
+		first_nonexistent_frame = good;
 	}
 
 	if (!film()->three_d() && first_nonexistent_frame > 0) {
@@ -319,7 +420,7 @@ ReelWriter::check_existing_picture_asset (boost::filesystem::path asset)
 
 
 void
-ReelWriter::write (shared_ptr<const Data> encoded, Frame frame, Eyes eyes)
+ReelWriter::write (shared_ptr<const Data> encoded, Frame frame, Eyes eyes, optional<string> hash)
 {
 	if (!_picture_asset_writer) {
 		/* We're not writing any data */
@@ -327,14 +428,41 @@ ReelWriter::write (shared_ptr<const Data> encoded, Frame frame, Eyes eyes)
 	}
 
 	auto fin = _picture_asset_writer->write (encoded->data(), encoded->size());
-	write_frame_info (frame, eyes, fin);
+	/* libdcp's hash is of the data as written, so we can only compare with an unencrypted one */
+	if (hash && !film()->encrypted() && fin.hash != *hash) {
+		throw NetworkError (String::compose("Frame %1 was damaged after being encoded", frame));
+	}
+	queue_frame_info (frame, eyes, fin);
 	_last_written[eyes] = encoded;
+	maybe_preallocate_picture ();
+}
+
+
+/** Reserve disk space for our picture asset, if we have not already done so.  This must be called
+ *  after something has been written, as the asset writer only opens (and truncates) the file then.
+ *  Whatever we don't use is given back in finish_picture().
+ */
+void
+ReelWriter::maybe_preallocate_picture ()
+{
+	if (_picture_preallocated || !Config::instance()->preallocate_video_assets()) {
+		return;
+	}
+
+	auto const estimate = static_cast<int64_t>(film()->j2k_bandwidth() / 8 * _period.duration().seconds());
+	preallocate_file (film()->internal_video_asset_dir() / film()->internal_video_asset_filename(_period), estimate);
+	_picture_preallocated = true;
 }
 
 
 void
 ReelWriter::write (shared_ptr<const dcp::AtmosFrame> atmos, AtmosMetadata metadata)
 {
+	if (_atmos_passthrough) {
+		/* We will put the source asset into the DCP when we finish */
+		return;
+	}
+
 	if (!_atmos_asset) {
 		_atmos_asset = metadata.create (dcp::Fraction(film()->video_frame_rate(), 1));
 		if (film()->encrypted()) {
@@ -369,19 +497,44 @@ ReelWriter::repeat_write (Frame frame, Eyes eyes)
 	}
 
 	auto fin = _picture_asset_writer->write(_last_written[eyes]->data(), _last_written[eyes]->size());
-	write_frame_info (frame, eyes, fin);
+	queue_frame_info (frame, eyes, fin);
 }
 
 
+/** Finish our picture asset.  This can be called as soon as the last frame has been written
+ *  to it, before the other assets are finished.  It will be called by finish() if it has not
+ *  been already.
+ */
 void
-ReelWriter::finish (boost::filesystem::path output_dcp)
+ReelWriter::finish_picture ()
 {
+	if (_picture_finished) {
+		return;
+	}
+
+	_picture_finished = true;
+
+	flush_frame_info ();
+
 	if (_picture_asset_writer && !_picture_asset_writer->finalize ()) {
 		/* Nothing was written to the picture asset */
 		LOG_GENERAL ("Nothing was written to reel %1 of %2", _reel_index, _reel_count);
 		_picture_asset.reset ();
 	}
 
+	if (_picture_preallocated) {
+		release_file_preallocation (film()->internal_video_asset_dir() / film()->internal_video_asset_filename(_period));
+		_picture_preallocated = false;
+	}
+}
+
+
+void
+ReelWriter::finish (boost::filesystem::path output_dcp)
+{
+	finish_picture ();
+	flush_audio ();
+
 	if (_sound_asset_writer && !_sound_asset_writer->finalize ()) {
 		/* Nothing was written to the sound asset */
 		_sound_asset.reset ();
@@ -421,6 +574,10 @@ ReelWriter::finish (boost::filesystem::path output_dcp)
 		}
 
 		_picture_asset->set_file (video_to);
+		if (_picture_digest) {
+			/* The link or copy has the same contents as the file that was hashed */
+			_picture_asset->set_hash (*_picture_digest);
+		}
 	}
 
 	/* Move the audio asset into the DCP */
@@ -455,6 +612,34 @@ ReelWriter::finish (boost::filesystem::path output_dcp)
 		}
 
 		_atmos_asset->set_file (atmos_to);
+	} else if (_atmos_passthrough) {
+		auto asset = make_shared<dcp::AtmosAsset>(*_atmos_passthrough);
+		auto const atmos_to = output_dcp / atmos_asset_filename(asset, _reel_index, _reel_count, _content_summary);
+
+		if (clone_file(*_atmos_passthrough, atmos_to)) {
+			LOG_GENERAL("Cloned Atmos asset %1 to %2", _atmos_passthrough->string(), atmos_to.string());
+		} else {
+			boost::system::error_code ec;
+			dcp::filesystem::create_hard_link(*_atmos_passthrough, atmos_to, ec);
+			if (!ec) {
+				LOG_GENERAL("Hard-linked Atmos asset %1 to %2", _atmos_passthrough->string(), atmos_to.string());
+			} else {
+				LOG_GENERAL("Hard-link failed (%1); copying Atmos asset %2 to %3", error_details(ec), _atmos_passthrough->string(), atmos_to.string());
+				auto job = _job.lock();
+				try {
+					if (job) {
+						job->sub(_("Copying Atmos file into DCP"));
+						copy_in_bits(*_atmos_passthrough, atmos_to, bind(&Job::set_progress, job.get(), _1, false));
+					} else {
+						dcp::filesystem::copy_file(*_atmos_passthrough, atmos_to);
+					}
+				} catch (exception& e) {
+					throw FileError(e.what(), *_atmos_passthrough);
+				}
+			}
+		}
+
+		_atmos_asset = make_shared<dcp::AtmosAsset>(atmos_to);
 	}
 }
 
@@ -773,25 +958,39 @@ ReelWriter::create_reel (
 	return reel;
 }
 
-void
-ReelWriter::calculate_digests (std::function<void (float)> set_progress)
-try
+/** @return File of our finished picture asset, if we have one */
+optional<boost::filesystem::path>
+ReelWriter::picture_asset_file () const
 {
-	if (_picture_asset) {
-		_picture_asset->hash (set_progress);
+	DCPOMATIC_ASSERT (_picture_finished);
+
+	if (!_picture_asset) {
+		return {};
+	}
+
+	return _picture_asset->file();
+}
+
+
+/** @return Assets that we have written, whose digests should be calculated */
+vector<shared_ptr<dcp::Asset>>
+ReelWriter::assets_needing_digests () const
+{
+	vector<shared_ptr<dcp::Asset>> assets;
+
+	if (_picture_asset && !_picture_digest) {
+		assets.push_back(_picture_asset);
 	}
 
 	if (_sound_asset) {
-		_sound_asset->hash (set_progress);
+		assets.push_back(_sound_asset);
 	}
 
 	if (_atmos_asset) {
-		_atmos_asset->hash (set_progress);
+		assets.push_back(_atmos_asset);
 	}
-} catch (boost::thread_interrupted) {
-	/* set_progress contains an interruption_point, so any of these methods
-	 * may throw thread_interrupted, at which point we just give up.
-	 */
+
+	return assets;
 }
 
 
@@ -810,7 +1009,38 @@ ReelWriter::write (shared_ptr<const AudioBuffers> audio)
 	}
 
 	DCPOMATIC_ASSERT (audio);
-	_sound_asset_writer->write(audio->data(), audio->channels(), audio->frames());
+
+	if (!_audio_block) {
+		/* Collect a second of audio at a time so that the sound asset writer gets fewer, larger blocks */
+		_audio_block = make_shared<AudioBuffers>(audio->channels(), film()->audio_frame_rate());
+		_audio_block_frames = 0;
+	}
+
+	DCPOMATIC_ASSERT (audio->channels() == _audio_block->channels());
+
+	int done = 0;
+	while (done < audio->frames()) {
+		auto const this_time = min(audio->frames() - done, _audio_block->frames() - _audio_block_frames);
+		_audio_block->copy_from(audio.get(), this_time, done, _audio_block_frames);
+		_audio_block_frames += this_time;
+		done += this_time;
+		if (_audio_block_frames == _audio_block->frames()) {
+			flush_audio ();
+		}
+	}
+}
+
+
+/** Write any audio that we have collected in _audio_block */
+void
+ReelWriter::flush_audio ()
+{
+	if (!_sound_asset_writer || !_audio_block || _audio_block_frames == 0) {
+		return;
+	}
+
+	_sound_asset_writer->write(_audio_block->data(), _audio_block->channels(), _audio_block_frames);
+	_audio_block_frames = 0;
 }
 
 
@@ -968,8 +1198,12 @@ ReelWriter::write(PlayerText subs, TextType type, optional<DCPTextTrack> track,
 		/* Give this subtitle the correct font ID */
 		sub->set_font(font_id_to_use);
 		asset->add(sub);
-		/* Make sure the asset LoadFonts the font we just asked for */
-		asset->ensure_font(font_id_to_use, font->data().get_value_or(_default_font));
+		/* Make sure the asset LoadFonts the font we just asked for.  Getting the font's data
+		 * can mean reading it from disk, so only do it the first time that this asset sees the font.
+		 */
+		if (_text_asset_fonts[asset].insert(font_id_to_use).second) {
+			asset->ensure_font(font_id_to_use, font->data().get_value_or(_default_font));
+		}
 	}
 
 	for (auto i: subs.bitmap) {
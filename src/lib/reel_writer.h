@@ -31,6 +31,8 @@
 #include <dcp/atmos_asset_writer.h>
 #include <dcp/file.h>
 #include <dcp/picture_asset_writer.h>
+#include <map>
+#include <set>
 
 
 class AudioBuffers;
@@ -40,6 +42,7 @@ class Job;
 struct write_frame_info_test;
 
 namespace dcp {
+	class Asset;
 	class AtmosAsset;
 	class MonoPictureAsset;
 	class MonoPictureAssetWriter;
@@ -68,13 +71,14 @@ public:
 		bool text_only
 		);
 
-	void write (std::shared_ptr<const dcp::Data> encoded, Frame frame, Eyes eyes);
+	void write (std::shared_ptr<const dcp::Data> encoded, Frame frame, Eyes eyes, boost::optional<std::string> hash = boost::none);
 	void fake_write (int size);
 	void repeat_write (Frame frame, Eyes eyes);
 	void write (std::shared_ptr<const AudioBuffers> audio);
 	void write(PlayerText text, TextType type, boost::optional<DCPTextTrack> track, dcpomatic::DCPTimePeriod period, FontIdMap const& fonts, std::shared_ptr<dcpomatic::Font> chosen_interop_font);
 	void write (std::shared_ptr<const dcp::AtmosFrame> atmos, AtmosMetadata metadata);
 
+	void finish_picture ();
 	void finish (boost::filesystem::path output_dcp);
 	std::shared_ptr<dcp::Reel> create_reel (
 		std::list<ReferencedReelAsset> const & refs,
@@ -82,7 +86,13 @@ public:
 		bool ensure_subtitles,
 		std::set<DCPTextTrack> ensure_closed_captions
 		);
-	void calculate_digests (std::function<void (float)> set_progress);
+	std::vector<std::shared_ptr<dcp::Asset>> assets_needing_digests () const;
+	boost::optional<boost::filesystem::path> picture_asset_file () const;
+
+	/** Give the digest of our picture asset, if it has been calculated before finish() */
+	void set_picture_digest (std::string digest) {
+		_picture_digest = digest;
+	}
 
 	Frame start () const;
 
@@ -101,6 +111,11 @@ private:
 	friend struct ::write_frame_info_test;
 
 	void write_frame_info (Frame frame, Eyes eyes, dcp::FrameInfo info) const;
+	void write_frame_info (std::shared_ptr<InfoFileHandle> handle, Frame frame, Eyes eyes, dcp::FrameInfo const& info) const;
+	void queue_frame_info (Frame frame, Eyes eyes, dcp::FrameInfo info);
+	void flush_frame_info ();
+	void maybe_preallocate_picture ();
+	void flush_audio ();
 	long frame_info_position (Frame frame, Eyes eyes) const;
 	Frame check_existing_picture_asset (boost::filesystem::path asset);
 	bool existing_picture_frame_ok (dcp::File& asset_file, std::shared_ptr<InfoFileHandle> info_file, Frame frame) const;
@@ -124,6 +139,17 @@ private:
 	int _first_nonexistent_frame;
 	/** the data of the last written frame, if there is one */
 	EnumIndexedVector<std::shared_ptr<const dcp::Data>, Eyes> _last_written;
+
+	struct PendingFrameInfo
+	{
+		Frame frame;
+		Eyes eyes;
+		dcp::FrameInfo info;
+	};
+
+	/** frame info which has not yet been written to the info file */
+	std::vector<PendingFrameInfo> _pending_frame_info;
+	int _frame_info_batches_since_sync = 0;
 	/** index of this reel within the DCP (starting from 0) */
 	int _reel_index;
 	/** number of reels in the DCP */
@@ -137,12 +163,28 @@ private:
 	std::shared_ptr<dcp::PictureAsset> _picture_asset;
 	/** picture asset writer, or 0 if we are not writing any picture because we already have one */
 	std::shared_ptr<dcp::PictureAssetWriter> _picture_asset_writer;
+	/** true if finish_picture() has been called */
+	bool _picture_finished = false;
+	/** true if we asked for space to be reserved for our picture asset, which we must give back when we finish it */
+	bool _picture_preallocated = false;
+	/** digest of _picture_asset's file, if it was calculated before finish() */
+	boost::optional<std::string> _picture_digest;
 	std::shared_ptr<dcp::SoundAsset> _sound_asset;
 	std::shared_ptr<dcp::SoundAssetWriter> _sound_asset_writer;
+	/** Audio waiting to be written to _sound_asset_writer */
+	std::shared_ptr<AudioBuffers> _audio_block;
+	/** Number of frames of _audio_block that are in use */
+	int _audio_block_frames = 0;
 	std::shared_ptr<dcp::SubtitleAsset> _subtitle_asset;
 	std::map<DCPTextTrack, std::shared_ptr<dcp::SubtitleAsset>> _closed_caption_assets;
+	/** IDs of the fonts that we have given to each of _subtitle_asset and _closed_caption_assets */
+	std::map<std::shared_ptr<const dcp::SubtitleAsset>, std::set<std::string>> _text_asset_fonts;
 	std::shared_ptr<dcp::AtmosAsset> _atmos_asset;
 	std::shared_ptr<dcp::AtmosAssetWriter> _atmos_asset_writer;
+	/** Atmos MXF which exactly fills this reel and can be put into the DCP as it is, without
+	 *  re-writing its frames.
+	 */
+	boost::optional<boost::filesystem::path> _atmos_passthrough;
 
 	mutable FontMetrics _font_metrics;
 
@@ -34,13 +34,18 @@ LIBDCP_DISABLE_WARNINGS
 LIBDCP_ENABLE_WARNINGS
 #include <pango/pangocairo.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/mutex.hpp>
 #include <iostream>
+#include <list>
+#include <map>
 
 
 using std::cerr;
 using std::cout;
+using std::list;
 using std::make_pair;
 using std::make_shared;
+using std::map;
 using std::max;
 using std::min;
 using std::pair;
@@ -135,9 +140,9 @@ marked_up(vector<StringText> subtitles, int target_height, float fade_factor, st
 
 
 static void
-set_source_rgba (Cairo::RefPtr<Cairo::Context> context, dcp::Colour colour, float fade_factor)
+set_source_rgba (Cairo::RefPtr<Cairo::Context> context, dcp::Colour colour, float alpha)
 {
-	context->set_source_rgba (float(colour.r) / 255, float(colour.g) / 255, float(colour.b) / 255, fade_factor);
+	context->set_source_rgba (float(colour.r) / 255, float(colour.g) / 255, float(colour.b) / 255, alpha);
 }
 
 
@@ -159,7 +164,7 @@ create_surface (shared_ptr<Image> image)
 	/* XXX: I don't think it's guaranteed that format_stride_for_width will return a stride without any padding,
 	 * so it's lucky that this works.
 	 */
-	DCPOMATIC_ASSERT (image->alignment() == Image::Alignment::COMPACT);
+	DCPOMATIC_ASSERT (image->has_layout_of(Image::Alignment::COMPACT));
 	DCPOMATIC_ASSERT (image->pixel_format() == AV_PIX_FMT_BGRA);
 	return Cairo::ImageSurface::create (
 		image->data()[0],
@@ -299,18 +304,9 @@ struct Layout
 };
 
 
-/** @param subtitles A list of subtitles that are all on the same line,
- *  at the same time and with the same fade in/out.
- */
 static Layout
-setup_layout(vector<StringText> subtitles, dcp::Size target, DCPTime time, int frame_rate)
+setup_layout(string font_name, string markup)
 {
-	DCPOMATIC_ASSERT(!subtitles.empty());
-	auto const& first = subtitles.front();
-
-	auto const font_name = FontConfig::instance()->make_font_available(first.font);
-	auto const fade_factor = calculate_fade_factor(first, time, frame_rate);
-	auto const markup = marked_up(subtitles, target.height, fade_factor, font_name);
 	auto layout = create_layout(font_name, markup);
 	auto ink = layout->get_ink_extents();
 
@@ -324,6 +320,18 @@ setup_layout(vector<StringText> subtitles, dcp::Size target, DCPTime time, int f
 }
 
 
+/** @param subtitles A list of subtitles that are all on the same line,
+ *  at the same time and with the same fade in/out.
+ */
+static Layout
+setup_layout(vector<StringText> subtitles, dcp::Size target)
+{
+	DCPOMATIC_ASSERT(!subtitles.empty());
+	auto const font_name = FontConfig::instance()->make_font_available(subtitles.front().font);
+	return setup_layout(font_name, marked_up(subtitles, target.height, 1, font_name));
+}
+
+
 static
 int
 border_width_for_subtitle(StringText const& subtitle, dcp::Size target)
@@ -332,11 +340,12 @@ border_width_for_subtitle(StringText const& subtitle, dcp::Size target)
 }
 
 
-/** @param subtitles A list of subtitles that are all on the same line,
+/** Draw a line of subtitles at full opacity.
+ *  @param subtitles A list of subtitles that are all on the same line,
  *  at the same time and with the same fade in/out.
  */
 static PositionImage
-render_line(vector<StringText> subtitles, dcp::Size target, DCPTime time, int frame_rate)
+draw_line(vector<StringText> subtitles, dcp::Size target, string font_name, string markup)
 {
 	/* XXX: this method can only handle italic / bold changes mid-line,
 	   nothing else yet.
@@ -344,9 +353,8 @@ render_line(vector<StringText> subtitles, dcp::Size target, DCPTime time, int fr
 
 	DCPOMATIC_ASSERT(!subtitles.empty ());
 	auto const& first = subtitles.front();
-	auto const fade_factor = calculate_fade_factor(first, time, frame_rate);
 
-	auto layout = setup_layout(subtitles, target, time, frame_rate);
+	auto layout = setup_layout(font_name, markup);
 
 	/* Calculate x and y scale factors.  These are only used to stretch
 	   the font away from its normal aspect ratio.
@@ -384,7 +392,7 @@ render_line(vector<StringText> subtitles, dcp::Size target, DCPTime time, int fr
 
 	if (first.effect() == dcp::Effect::SHADOW) {
 		/* Drop-shadow effect */
-		set_source_rgba (context, first.effect_colour(), fade_factor);
+		set_source_rgba (context, first.effect_colour(), 1);
 		context->move_to (x_offset + 4, y_offset + 4);
 		layout.pango->add_to_cairo_context(context);
 		context->fill ();
@@ -392,7 +400,7 @@ render_line(vector<StringText> subtitles, dcp::Size target, DCPTime time, int fr
 
 	if (first.effect() == dcp::Effect::BORDER) {
 		/* Border effect */
-		set_source_rgba (context, first.effect_colour(), fade_factor);
+		set_source_rgba (context, first.effect_colour(), 1);
 		context->set_line_width (border_width);
 		context->set_line_join (Cairo::LINE_JOIN_ROUND);
 		context->move_to (x_offset, y_offset);
@@ -402,7 +410,7 @@ render_line(vector<StringText> subtitles, dcp::Size target, DCPTime time, int fr
 
 	/* The actual subtitle */
 
-	set_source_rgba (context, first.colour(), fade_factor);
+	set_source_rgba (context, first.colour(), 1);
 
 	context->move_to (x_offset, y_offset);
 	layout.pango->add_to_cairo_context (context);
@@ -419,6 +427,99 @@ render_line(vector<StringText> subtitles, dcp::Size target, DCPTime time, int fr
 }
 
 
+/** Cache of recently-drawn lines, so that a subtitle which stays on screen for many
+ *  frames need only be laid out and drawn once.  Lines are drawn at full opacity and
+ *  any fade is applied to a copy of the cached image.
+ */
+class RenderedLineCache
+{
+public:
+	optional<PositionImage> get(string const& key)
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		auto iter = _index.find(key);
+		if (iter == _index.end()) {
+			return {};
+		}
+		/* Move this line to the front as it is now the most-recently used */
+		_lines.splice(_lines.begin(), _lines, iter->second);
+		return iter->second->second;
+	}
+
+	void add(string const& key, PositionImage image)
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		if (_index.find(key) != _index.end()) {
+			return;
+		}
+		_lines.push_front(make_pair(key, image));
+		_index[key] = _lines.begin();
+		while (_lines.size() > _max_lines) {
+			_index.erase(_lines.back().first);
+			_lines.pop_back();
+		}
+	}
+
+private:
+	boost::mutex _mutex;
+	/** Lines with the most-recently used at the front */
+	list<pair<string, PositionImage>> _lines;
+	map<string, list<pair<string, PositionImage>>::iterator> _index;
+	static size_t constexpr _max_lines = 32;
+};
+
+
+static RenderedLineCache rendered_line_cache;
+
+
+/** @return a string which includes everything that affects how a line of subtitles is drawn
+ *  and where it ends up, apart from any fade.
+ */
+static string
+line_cache_key(vector<StringText> const& subtitles, dcp::Size target, string const& font_name, string const& markup)
+{
+	using dcp::raw_convert;
+
+	auto const& first = subtitles.front();
+	return raw_convert<string>(target.width) + "_" + raw_convert<string>(target.height) + "_" + font_name
+		+ "_" + raw_convert<string>(static_cast<int>(first.effect())) + "_" + first.effect_colour().to_rgb_string()
+		+ "_" + raw_convert<string>(first.outline_width) + "_" + raw_convert<string>(first.aspect_adjust())
+		+ "_" + raw_convert<string>(static_cast<int>(first.valign_standard))
+		+ "_" + raw_convert<string>(static_cast<int>(first.h_align())) + "_" + raw_convert<string>(first.h_position())
+		+ "_" + raw_convert<string>(static_cast<int>(first.v_align())) + "_" + raw_convert<string>(first.v_position())
+		+ "_" + markup;
+}
+
+
+/** @param subtitles A list of subtitles that are all on the same line,
+ *  at the same time and with the same fade in/out.
+ */
+static PositionImage
+render_line(vector<StringText> subtitles, dcp::Size target, DCPTime time, int frame_rate)
+{
+	DCPOMATIC_ASSERT(!subtitles.empty());
+
+	auto const font_name = FontConfig::instance()->make_font_available(subtitles.front().font);
+	auto const markup = marked_up(subtitles, target.height, 1, font_name);
+	auto const key = line_cache_key(subtitles, target, font_name, markup);
+
+	auto line = rendered_line_cache.get(key);
+	if (!line) {
+		line = draw_line(subtitles, target, font_name, markup);
+		rendered_line_cache.add(key, *line);
+	}
+
+	auto const fade_factor = calculate_fade_factor(subtitles.front(), time, frame_rate);
+	if (fade_factor < 1) {
+		auto faded = make_shared<Image>(*line->image);
+		faded->fade(fade_factor);
+		return PositionImage(faded, line->position);
+	}
+
+	return *line;
+}
+
+
 /** @param time Time of the frame that these subtitles are going on.
  *  @param target Size of the container that this subtitle will end up in.
  *  @param frame_rate DCP frame rate.
@@ -451,21 +552,33 @@ render_text(vector<StringText> subtitles, dcp::Size target, DCPTime time, int fr
 }
 
 
+/** @param override_standards Standards to use to interpret the vertical positions of the subtitles,
+ *  or empty to use the one in each subtitle.
+ *  @return rectangles covering each line of the subtitles, for each of the standards.  The layout
+ *  of each line is only worked out once however many standards are given.
+ */
 vector<dcpomatic::Rect<int>>
-bounding_box(vector<StringText> subtitles, dcp::Size target, optional<dcp::SubtitleStandard> override_standard)
+bounding_box(vector<StringText> subtitles, dcp::Size target, vector<dcp::SubtitleStandard> override_standards)
 {
 	vector<StringText> pending;
 	vector<dcpomatic::Rect<int>> rects;
 
-	auto use_pending = [&pending, &rects, target, override_standard]() {
+	auto use_pending = [&pending, &rects, target, &override_standards]() {
 		auto const& subtitle = pending.front();
-		auto standard = override_standard.get_value_or(subtitle.valign_standard);
-		/* We can provide dummy values for time and frame rate here as they are only used to calculate fades */
-		auto layout = setup_layout(pending, target, DCPTime(), 24);
+		auto layout = setup_layout(pending, target);
 		int const x = x_position(subtitle.h_align(), subtitle.h_position(), target.width, layout.size.width);
 		auto const border_width = border_width_for_subtitle(subtitle, target);
-		int const y = y_position(standard, subtitle.v_align(), subtitle.v_position(), target.height, layout.baseline_to_bottom(border_width), layout.size.height);
-		rects.push_back({Position<int>(x, y), layout.size.width, layout.size.height});
+		auto add = [&](dcp::SubtitleStandard standard) {
+			int const y = y_position(standard, subtitle.v_align(), subtitle.v_position(), target.height, layout.baseline_to_bottom(border_width), layout.size.height);
+			rects.push_back({Position<int>(x, y), layout.size.width, layout.size.height});
+		};
+		if (override_standards.empty()) {
+			add(subtitle.valign_standard);
+		} else {
+			for (auto standard: override_standards) {
+				add(standard);
+			}
+		}
 	};
 
 	for (auto const& i: subtitles) {
@@ -39,20 +39,37 @@ using std::runtime_error;
 using std::shared_ptr;
 
 
+static
+int
+converter_type (ResamplerQuality quality)
+{
+	switch (quality) {
+	case ResamplerQuality::BEST:
+		return SRC_SINC_BEST_QUALITY;
+	case ResamplerQuality::MEDIUM:
+		return SRC_SINC_MEDIUM_QUALITY;
+	case ResamplerQuality::FASTEST:
+		return SRC_SINC_FASTEST;
+	case ResamplerQuality::LINEAR:
+		return SRC_LINEAR;
+	}
+
+	DCPOMATIC_ASSERT (false);
+	return SRC_SINC_BEST_QUALITY;
+}
+
+
 /** @param in Input sampling rate (Hz)
  *  @param out Output sampling rate (Hz)
  *  @param channels Number of channels.
+ *  @param quality Converter to use.
  */
-Resampler::Resampler (int in, int out, int channels)
+Resampler::Resampler (int in, int out, int channels, ResamplerQuality quality)
 	: _in_rate (in)
 	, _out_rate (out)
 	, _channels (channels)
 {
-	int error;
-	_src = src_new (SRC_SINC_BEST_QUALITY, _channels, &error);
-	if (!_src) {
-		throw runtime_error (String::compose(N_("could not create sample-rate converter (%1)"), error));
-	}
+	set_quality (quality);
 }
 
 
@@ -65,13 +82,15 @@ Resampler::~Resampler ()
 
 
 void
-Resampler::set_fast ()
+Resampler::set_quality (ResamplerQuality quality)
 {
-	src_delete (_src);
-	_src = nullptr;
+	if (_src) {
+		src_delete (_src);
+		_src = nullptr;
+	}
 
 	int error;
-	_src = src_new (SRC_LINEAR, _channels, &error);
+	_src = src_new (converter_type(quality), _channels, &error);
 	if (!_src) {
 		throw runtime_error (String::compose(N_("could not create sample-rate converter (%1)"), error));
 	}
@@ -86,32 +105,39 @@ Resampler::run (shared_ptr<const AudioBuffers> in)
 	int in_frames = in->frames ();
 	int in_offset = 0;
 	int out_offset = 0;
-	auto resampled = make_shared<AudioBuffers>(_channels, 0);
 
-	while (in_frames > 0) {
+	/* Compute the resampled frames count and add 32 for luck */
+	int const max_resampled_frames = ceil (static_cast<double>(in_frames) * _out_rate / _in_rate) + 32;
+	auto resampled = make_shared<AudioBuffers>(_channels, max_resampled_frames);
+
+	/* Interleave all the input once, rather than on each trip around the loop */
+	_in_buffer.resize(in_frames * _channels);
+	{
+		auto p = in->data ();
+		auto q = _in_buffer.data();
+		for (int i = 0; i < in_frames; ++i) {
+			for (int j = 0; j < _channels; ++j) {
+				*q++ = p[j][i];
+			}
+		}
+	}
 
-		/* Compute the resampled frames count and add 32 for luck */
-		int const max_resampled_frames = ceil (static_cast<double>(in_frames) * _out_rate / _in_rate) + 32;
+	_out_buffer.resize(max_resampled_frames * _channels);
 
-		SRC_DATA data;
-		std::vector<float> in_buffer(in_frames * _channels);
-		std::vector<float> out_buffer(max_resampled_frames * _channels);
+	while (in_frames > 0) {
 
-		{
-			auto p = in->data ();
-			auto q = in_buffer.data();
-			for (int i = 0; i < in_frames; ++i) {
-				for (int j = 0; j < _channels; ++j) {
-					*q++ = p[j][in_offset + i];
-				}
-			}
+		/* Make sure we have space for as much output as this remaining input could give */
+		int const space = ceil (static_cast<double>(in_frames) * _out_rate / _in_rate) + 32;
+		if (out_offset + space > resampled->frames()) {
+			resampled->set_frames (out_offset + space);
 		}
 
-		data.data_in = in_buffer.data();
+		SRC_DATA data;
+		data.data_in = _in_buffer.data() + in_offset * _channels;
 		data.input_frames = in_frames;
 
-		data.data_out = out_buffer.data();
-		data.output_frames = max_resampled_frames;
+		data.data_out = _out_buffer.data();
+		data.output_frames = std::min(space, max_resampled_frames);
 
 		data.end_of_input = 0;
 		data.src_ratio = double (_out_rate) / _in_rate;
@@ -123,7 +149,7 @@ Resampler::run (shared_ptr<const AudioBuffers> in)
 					N_("could not run sample-rate converter (%1) [processing %2 to %3, %4 channels]"),
 					src_strerror (r),
 					in_frames,
-					max_resampled_frames,
+					data.output_frames,
 					_channels
 					)
 				);
@@ -133,8 +159,6 @@ Resampler::run (shared_ptr<const AudioBuffers> in)
 			break;
 		}
 
-		resampled->set_frames (out_offset + data.output_frames_gen);
-
 		{
 			auto p = data.data_out;
 			auto q = resampled->data ();
@@ -150,6 +174,7 @@ Resampler::run (shared_ptr<const AudioBuffers> in)
 		out_offset += data.output_frames_gen;
 	}
 
+	resampled->set_frames (out_offset);
 	return resampled;
 }
 
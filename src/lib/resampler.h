@@ -19,8 +19,10 @@
 */
 
 
+#include "types.h"
 #include <samplerate.h>
 #include <memory>
+#include <vector>
 
 
 class AudioBuffers;
@@ -29,7 +31,7 @@ class AudioBuffers;
 class Resampler
 {
 public:
-	Resampler (int, int, int);
+	Resampler (int, int, int, ResamplerQuality quality = ResamplerQuality::BEST);
 	~Resampler ();
 
 	Resampler (Resampler const&) = delete;
@@ -38,7 +40,7 @@ public:
 	std::shared_ptr<const AudioBuffers> run (std::shared_ptr<const AudioBuffers>);
 	std::shared_ptr<const AudioBuffers> flush ();
 	void reset ();
-	void set_fast ();
+	void set_quality (ResamplerQuality quality);
 
 	int channels() const {
 		return _channels;
@@ -49,4 +51,7 @@ private:
 	int _in_rate;
 	int _out_rate;
 	int _channels;
+	/** Interleaved buffers to pass to and from libsamplerate, kept between calls to run() */
+	std::vector<float> _in_buffer;
+	std::vector<float> _out_buffer;
 };
@@ -0,0 +1,138 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "audio_buffers.h"
+#include "content.h"
+#include "dcpomatic_assert.h"
+#include "film.h"
+#include "player_video.h"
+#include "review_export.h"
+#include "text_content.h"
+#include "util.h"
+#include <dcp/filesystem.h>
+
+
+using std::make_shared;
+using std::shared_ptr;
+using std::weak_ptr;
+using namespace dcpomatic;
+
+
+ReviewExport::ReviewExport (
+	boost::filesystem::path output,
+	ExportFormat format,
+	bool mixdown_to_stereo,
+	bool audio_stream_per_channel,
+	int x264_crf
+	)
+	: _output(output)
+	, _format(format)
+	, _mixdown_to_stereo(mixdown_to_stereo)
+	, _audio_stream_per_channel(audio_stream_per_channel)
+	, _x264_crf(x264_crf)
+{
+
+}
+
+
+/** @return true if a DCPEncoder's Player gives the same video and audio for a film
+ *  as an FFmpegEncoder's would.
+ */
+bool
+ReviewExport::possible (shared_ptr<const Film> film)
+{
+	/* Exports include referenced DCP content, but we don't play it when making a DCP */
+	if (film->references_dcp_video() || film->references_dcp_audio()) {
+		return false;
+	}
+
+	/* Exports always burn in open subtitles */
+	for (auto content: film->content()) {
+		for (auto text: content->text) {
+			if (text->use() && !text->burn() && text->type() == TextType::OPEN_SUBTITLE) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/** @return An encoder to make this export in a pass of its own, for when possible() is false */
+shared_ptr<FFmpegEncoder>
+ReviewExport::make_encoder (shared_ptr<const Film> film, weak_ptr<Job> job) const
+{
+	return make_shared<FFmpegEncoder>(film, job, _output, _format, _mixdown_to_stereo, false, _audio_stream_per_channel, _x264_crf);
+}
+
+
+void
+ReviewExport::start (shared_ptr<const Film> film)
+{
+	_output_audio_channels = FFmpegEncoder::output_audio_channels(film, _mixdown_to_stereo);
+	_audio_mapping = FFmpegEncoder::audio_mapping(film, _mixdown_to_stereo);
+
+	_encoders.reset(
+		new FFmpegEncoder::FileEncoderSet(
+			film->frame_size(),
+			film->video_frame_rate(),
+			film->audio_frame_rate(),
+			_output_audio_channels,
+			_format,
+			_audio_stream_per_channel,
+			_x264_crf,
+			film->three_d(),
+			dcp::filesystem::change_extension(_output, ""),
+			dcp::filesystem::extension(_output)
+			)
+		);
+}
+
+
+void
+ReviewExport::video (shared_ptr<PlayerVideo> video, DCPTime time)
+{
+	DCPOMATIC_ASSERT (_encoders);
+	if (auto encoder = _encoders->get(video->eyes())) {
+		encoder->video(video, time);
+	}
+}
+
+
+/** @param audio Audio with the film's channels */
+void
+ReviewExport::audio (shared_ptr<const AudioBuffers> audio)
+{
+	DCPOMATIC_ASSERT (_encoders);
+	_encoders->audio(remap(audio, _output_audio_channels, _audio_mapping));
+}
+
+
+void
+ReviewExport::flush ()
+{
+	if (_encoders) {
+		_encoders->flush();
+	}
+}
@@ -0,0 +1,85 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_REVIEW_EXPORT_H
+#define DCPOMATIC_REVIEW_EXPORT_H
+
+
+#include "audio_mapping.h"
+#include "dcpomatic_time.h"
+#include "ffmpeg_encoder.h"
+#include "ffmpeg_file_encoder.h"
+#include <boost/filesystem.hpp>
+#include <memory>
+
+
+class AudioBuffers;
+class Film;
+class Job;
+class PlayerVideo;
+
+
+/** @class ReviewExport
+ *  @brief A file (e.g. a H.264 review copy) to export from the same Player pass that makes a DCP.
+ *
+ *  This gets the same video and audio as the DCP, so it can only be used if that is what an
+ *  FFmpegEncoder would have exported (see possible()).
+ */
+class ReviewExport
+{
+public:
+	ReviewExport (
+		boost::filesystem::path output,
+		ExportFormat format,
+		bool mixdown_to_stereo,
+		bool audio_stream_per_channel,
+		int x264_crf
+		);
+
+	ReviewExport (ReviewExport const&) = delete;
+	ReviewExport& operator= (ReviewExport const&) = delete;
+
+	static bool possible (std::shared_ptr<const Film> film);
+
+	std::shared_ptr<FFmpegEncoder> make_encoder (std::shared_ptr<const Film> film, std::weak_ptr<Job> job) const;
+
+	void start (std::shared_ptr<const Film> film);
+	void video (std::shared_ptr<PlayerVideo> video, dcpomatic::DCPTime time);
+	void audio (std::shared_ptr<const AudioBuffers> audio);
+	void flush ();
+
+private:
+	boost::filesystem::path _output;
+	ExportFormat _format;
+	bool _mixdown_to_stereo;
+	bool _audio_stream_per_channel;
+	int _x264_crf;
+
+	/** Files that we are writing to, once start() has been called */
+	std::unique_ptr<FFmpegEncoder::FileEncoderSet> _encoders;
+	int _output_audio_channels = 0;
+	AudioMapping _audio_mapping;
+};
+
+
+#endif
@@ -22,9 +22,11 @@
 #include "cinema.h"
 #include "config.h"
 #include "film.h"
+#include "kdm_cache.h"
 #include "kdm_util.h"
 #include "kdm_with_metadata.h"
 #include "screen.h"
+#include "util.h"
 #include <libxml++/libxml++.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -85,7 +87,7 @@ kdm_for_screen (
 	vector<KDMCertificatePeriod>& period_checks
 	)
 {
-	if (!screen->recipient) {
+	if (!screen->recipient()) {
 		return {};
 	}
 
@@ -93,15 +95,15 @@ kdm_for_screen (
 	dcp::LocalTime const begin(valid_from, dcp::UTCOffset(cinema ? cinema->utc_offset_hour() : 0, cinema ? cinema->utc_offset_minute() : 0));
 	dcp::LocalTime const end  (valid_to,   dcp::UTCOffset(cinema ? cinema->utc_offset_hour() : 0, cinema ? cinema->utc_offset_minute() : 0));
 
-	period_checks.push_back(check_kdm_and_certificate_validity_periods(screen->recipient.get(), begin, end));
+	period_checks.push_back(check_kdm_and_certificate_validity_periods(screen->recipient().get(), begin, end));
 
 	auto signer = Config::instance()->signer_chain();
-	if (!signer->valid()) {
+	if (!certificate_chain_valid(signer)) {
 		throw InvalidSignerError();
 	}
 
-	auto kdm = make_kdm(begin, end).encrypt(
-		signer, screen->recipient.get(), screen->trusted_device_thumbprints(), formulation, disable_forensic_marking_picture, disable_forensic_marking_audio
+	auto kdm = encrypt_kdm(
+		make_kdm(begin, end), begin, end, signer, screen->recipient().get(), screen->trusted_device_thumbprints(), formulation, disable_forensic_marking_picture, disable_forensic_marking_audio
 		);
 
 	dcp::NameFormat::Map name_values;
@@ -119,3 +121,41 @@ kdm_for_screen (
 	return make_shared<KDMWithMetadata>(name_values, cinema.get(), cinema ? cinema->emails : vector<string>(), kdm);
 }
 
+
+
+/** Call kdm_for_screen() for each of some screens, making the KDMs (which is mostly encryption
+ *  and signing) on a thread for each CPU.  The KDMs and period checks are returned in the same
+ *  order as the screens they are for; screens without a recipient are skipped.
+ *  make_kdm will be called from several threads at once.
+ */
+list<KDMWithMetadataPtr>
+kdms_for_screens (
+	std::function<dcp::DecryptedKDM (dcp::LocalTime, dcp::LocalTime)> make_kdm,
+	vector<shared_ptr<Screen>> const& screens,
+	boost::posix_time::ptime valid_from,
+	boost::posix_time::ptime valid_to,
+	dcp::Formulation formulation,
+	bool disable_forensic_marking_picture,
+	optional<int> disable_forensic_marking_audio,
+	vector<KDMCertificatePeriod>& period_checks
+	)
+{
+	vector<KDMWithMetadataPtr> screen_kdms(screens.size());
+	vector<vector<KDMCertificatePeriod>> screen_period_checks(screens.size());
+
+	parallel_for_cpu (screens.size(), [&](size_t i) {
+		screen_kdms[i] = kdm_for_screen(
+			make_kdm, screens[i], valid_from, valid_to, formulation, disable_forensic_marking_picture, disable_forensic_marking_audio, screen_period_checks[i]
+			);
+	});
+
+	list<KDMWithMetadataPtr> kdms;
+	for (size_t i = 0; i < screens.size(); ++i) {
+		if (screen_kdms[i]) {
+			kdms.push_back(screen_kdms[i]);
+		}
+		period_checks.insert(period_checks.end(), screen_period_checks[i].begin(), screen_period_checks[i].end());
+	}
+
+	return kdms;
+}
@@ -87,4 +87,17 @@ kdm_for_screen (
 	);
 
 
+std::list<KDMWithMetadataPtr>
+kdms_for_screens (
+	std::function<dcp::DecryptedKDM (dcp::LocalTime, dcp::LocalTime)> make_kdm,
+	std::vector<std::shared_ptr<dcpomatic::Screen>> const& screens,
+	boost::posix_time::ptime valid_from,
+	boost::posix_time::ptime valid_to,
+	dcp::Formulation formulation,
+	bool disable_forensic_marking_picture,
+	boost::optional<int> disable_forensic_marking_audio,
+	std::vector<KDMCertificatePeriod>& period_checks
+	);
+
+
 #endif
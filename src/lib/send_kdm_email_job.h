@@ -60,6 +60,10 @@ public:
 	std::string json_name () const override;
 	void run () override;
 
+	Resource resource () const override {
+		return Resource::NETWORK;
+	}
+
 private:
 	dcp::NameFormat _container_name_format;
 	dcp::NameFormat _filename_format;
@@ -32,6 +32,10 @@ public:
 	std::string json_name () const override;
 	void run () override;
 
+	Resource resource () const override {
+		return Resource::NETWORK;
+	}
+
 private:
 	std::string _body;
 };
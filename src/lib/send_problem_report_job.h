@@ -39,6 +39,10 @@ public:
 	std::string json_name () const override;
 	void run () override;
 
+	Resource resource () const override {
+		return Resource::NETWORK;
+	}
+
 private:
 	void add_file (std::string& body, boost::filesystem::path file) const;
 
@@ -0,0 +1,141 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "serial_worker.h"
+#include "util.h"
+#include <boost/bind/bind.hpp>
+
+
+using std::function;
+using std::string;
+
+
+SerialWorker::SerialWorker (string name, int maximum_queue_size)
+	: _name (name)
+	, _maximum_queue_size (maximum_queue_size)
+{
+	_thread = boost::thread(boost::bind(&SerialWorker::thread, this));
+#ifdef DCPOMATIC_LINUX
+	pthread_setname_np (_thread.native_handle(), _name.substr(0, 15).c_str());
+#endif
+}
+
+
+/** Discard any jobs which have not yet been started, and wait for the current one to finish */
+SerialWorker::~SerialWorker ()
+{
+	boost::this_thread::disable_interruption dis;
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_queue.clear ();
+		_stop = true;
+		_condition.notify_all ();
+	}
+
+	try {
+		_thread.join ();
+	} catch (...) {}
+}
+
+
+/** Add a job to the end of the queue, waiting for space if the queue is full.
+ *  Throws anything that an earlier job threw.
+ */
+void
+SerialWorker::submit (function<void ()> job)
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		while (!_failed && _queue.size() >= _maximum_queue_size) {
+			_condition.wait (lm);
+		}
+
+		if (!_failed) {
+			_queue.push_back (job);
+			_condition.notify_all ();
+		}
+	}
+
+	rethrow ();
+}
+
+
+/** Wait for all the jobs to be run, then stop the thread.  Throws anything that a job threw. */
+void
+SerialWorker::finish ()
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		while (!_queue.empty() || _busy) {
+			_condition.wait (lm);
+		}
+		_stop = true;
+		_condition.notify_all ();
+	}
+
+	if (_thread.joinable()) {
+		_thread.join ();
+	}
+
+	rethrow ();
+}
+
+
+void
+SerialWorker::thread ()
+{
+	start_of_thread (_name);
+
+	while (true) {
+		function<void ()> job;
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			while (!_stop && _queue.empty()) {
+				_condition.wait (lm);
+			}
+
+			if (_queue.empty()) {
+				return;
+			}
+
+			job = _queue.front ();
+			_queue.pop_front ();
+			_busy = true;
+		}
+
+		try {
+			job ();
+		} catch (...) {
+			store_current ();
+			boost::mutex::scoped_lock lm (_mutex);
+			_failed = true;
+			_queue.clear ();
+		}
+
+		boost::mutex::scoped_lock lm (_mutex);
+		_busy = false;
+		_condition.notify_all ();
+	}
+}
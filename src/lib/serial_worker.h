@@ -0,0 +1,80 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_SERIAL_WORKER_H
+#define DCPOMATIC_SERIAL_WORKER_H
+
+
+#include "exception_store.h"
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <functional>
+#include <string>
+
+
+/** @class SerialWorker
+ *  @brief A thread which runs jobs one at a time, in the order that they were given to it.
+ *
+ *  submit() waits if too many jobs are already waiting, so that a producer which is faster
+ *  than the jobs cannot use up all our memory.  If a job throws, any jobs still waiting are
+ *  discarded and the exception is thrown by the next call to submit() or finish().
+ */
+class SerialWorker : public ExceptionStore
+{
+public:
+	/** @param name Name for the thread.
+	 *  @param maximum_queue_size Number of jobs that can be waiting before submit() blocks.
+	 */
+	SerialWorker (std::string name, int maximum_queue_size);
+	~SerialWorker ();
+
+	SerialWorker (SerialWorker const&) = delete;
+	SerialWorker& operator= (SerialWorker const&) = delete;
+
+	void submit (std::function<void ()> job);
+	void finish ();
+
+private:
+	void thread ();
+
+	std::string _name;
+	size_t const _maximum_queue_size;
+
+	/** Mutex to protect the following */
+	boost::mutex _mutex;
+	/** Condition to wake the thread when there is a job, and to wake submit() and finish() when one is done */
+	boost::condition _condition;
+	std::deque<std::function<void ()>> _queue;
+	/** true if the thread is running a job */
+	bool _busy = false;
+	/** true if a job has thrown an exception */
+	bool _failed = false;
+	bool _stop = false;
+
+	boost::thread _thread;
+};
+
+
+#endif
@@ -37,17 +37,6 @@ using boost::optional;
 int const Shuffler::_max_size = 64;
 
 
-struct Comparator
-{
-	bool operator()(Shuffler::Store const & a, Shuffler::Store const & b) {
-		if (a.second.frame != b.second.frame) {
-			return a.second.frame < b.second.frame;
-		}
-		return a.second.eyes < b.second.eyes;
-	}
-};
-
-
 void
 Shuffler::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 {
@@ -70,8 +59,7 @@ Shuffler::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 		return;
 	}
 
-	_store.push_back (make_pair (weak_piece, video));
-	_store.sort (Comparator());
+	_store.insert (make_pair(weak_piece, video));
 
 	while (true) {
 
@@ -79,12 +67,12 @@ Shuffler::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 			!_store.empty() &&
 			_last &&
 			(
-				(_store.front().second.frame == _last->frame       && _store.front().second.eyes == Eyes::RIGHT && _last->eyes == Eyes::LEFT) ||
-				(_store.front().second.frame >= (_last->frame + 1) && _store.front().second.eyes == Eyes::LEFT  && _last->eyes == Eyes::RIGHT)
+				(_store.begin()->second.frame == _last->frame       && _store.begin()->second.eyes == Eyes::RIGHT && _last->eyes == Eyes::LEFT) ||
+				(_store.begin()->second.frame >= (_last->frame + 1) && _store.begin()->second.eyes == Eyes::LEFT  && _last->eyes == Eyes::RIGHT)
 				);
 
 		if (!store_front_in_sequence) {
-			string const store = _store.empty() ? "store empty" : String::compose("store front frame=%1 eyes=%2", _store.front().second.frame, static_cast<int>(_store.front().second.eyes));
+			string const store = _store.empty() ? "store empty" : String::compose("store front frame=%1 eyes=%2", _store.begin()->second.frame, static_cast<int>(_store.begin()->second.eyes));
 			string const last = _last ? String::compose("last frame=%1 eyes=%2", _last->frame, static_cast<int>(_last->eyes)) : "no last";
 			LOG_DEBUG_THREE_D("Shuffler not in sequence: %1 %2", store, last);
 		}
@@ -101,10 +89,10 @@ Shuffler::video (weak_ptr<Piece> weak_piece, ContentVideo video)
 			LOG_WARNING ("Shuffler is full after receiving frame %1; 3D sync may be incorrect.", video.frame);
 		}
 
-		LOG_DEBUG_THREE_D("Shuffler emits frame=%1 eyes=%2 store=%3", _store.front().second.frame, static_cast<int>(_store.front().second.eyes), _store.size());
-		Video (_store.front().first, _store.front().second);
-		_last = _store.front().second;
-		_store.pop_front ();
+		LOG_DEBUG_THREE_D("Shuffler emits frame=%1 eyes=%2 store=%3", _store.begin()->second.frame, static_cast<int>(_store.begin()->second.eyes), _store.size());
+		Video (_store.begin()->first, _store.begin()->second);
+		_last = _store.begin()->second;
+		_store.erase (_store.begin());
 	}
 }
 
@@ -25,6 +25,7 @@
 
 #include "content_video.h"
 #include <boost/signals2.hpp>
+#include <set>
 
 
 struct shuffler_test5;
@@ -46,7 +47,21 @@ public:
 private:
 	friend struct ::shuffler_test5;
 
-	std::list<Store> _store;
+	/** Order by frame, then eye */
+	struct Comparator
+	{
+		bool operator() (Store const& a, Store const& b) const {
+			if (a.second.frame != b.second.frame) {
+				return a.second.frame < b.second.frame;
+			}
+			return a.second.eyes < b.second.eyes;
+		}
+	};
+
+	/** Frames that we are holding on to, kept in order as they are added so that
+	 *  we only ever need to look at the first one.
+	 */
+	std::multiset<Store, Comparator> _store;
 	boost::optional<ContentVideo> _last;
 	static int const _max_size;
 };
@@ -26,6 +26,7 @@
 #include "exception_store.h"
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
+#include <atomic>
 
 
 class Signaller;
@@ -52,6 +53,7 @@ public:
 	/* Do something next time the UI is idle */
 	template <typename T>
 	void when_idle (T f) {
+		++_queued;
 		_service.post (f);
 	}
 
@@ -60,7 +62,14 @@ public:
 	 */
 	size_t ui_idle () {
 		/* This executes one of the functors that has been post()ed to _service */
-		return _service.poll_one ();
+		auto const n = _service.poll_one ();
+		_queued -= n;
+		return n;
+	}
+
+	/** @return Number of things waiting to be done in the UI thread */
+	size_t queue_depth () const {
+		return _queued;
 	}
 
 	/** This should wake the UI and make it call ui_idle() */
@@ -86,6 +95,7 @@ private:
 			}
 		} else {
 			/* non-UI thread; post to the service and wake up the UI */
+			++_queued;
 			_service.post (f);
 			wake_ui ();
 		}
@@ -99,6 +109,8 @@ private:
 	boost::asio::io_service::work _work;
 	/** The UI thread's ID */
 	boost::thread::id _ui_thread;
+	/** Number of functors that have been post()ed to _service and not yet run */
+	std::atomic<size_t> _queued{0};
 };
 
 
@@ -0,0 +1,117 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "dcpomatic_assert.h"
+#include "exceptions.h"
+#include "spill_journal.h"
+#include <dcp/filesystem.h>
+#ifdef DCPOMATIC_LINUX
+#include <fcntl.h>
+#endif
+#include <algorithm>
+#include <cerrno>
+
+
+using std::make_shared;
+using std::make_tuple;
+using std::max;
+using std::shared_ptr;
+
+
+/** Amount by which to grow the space reserved for the file */
+static int64_t const allocation_step = 256 * 1024 * 1024;
+
+
+SpillJournal::SpillJournal(boost::filesystem::path path)
+	: _path(path)
+	, _file(path, "w+b")
+{
+	if (!_file) {
+		throw OpenFileError(path, errno, OpenFileError::READ_WRITE);
+	}
+}
+
+
+SpillJournal::~SpillJournal()
+{
+	_file.close();
+	boost::system::error_code ec;
+	dcp::filesystem::remove(_path, ec);
+}
+
+
+/** Make sure that at least size bytes of the file are allocated, where we know how */
+void
+SpillJournal::allocate(int64_t size)
+{
+	if (size <= _allocated) {
+		return;
+	}
+
+	auto const wanted = ((size + allocation_step - 1) / allocation_step) * allocation_step;
+#ifdef DCPOMATIC_LINUX
+	/* Failure here doesn't matter; the file will grow as we write to it */
+	posix_fallocate(fileno(_file.get()), _allocated, wanted - _allocated);
+#endif
+	_allocated = wanted;
+}
+
+
+void
+SpillJournal::write(size_t reel, int frame, Eyes eyes, dcp::Data const& data)
+{
+	auto const key = make_tuple(reel, frame, eyes);
+	DCPOMATIC_ASSERT(_index.find(key) == _index.end());
+
+	allocate(_end + data.size());
+
+	_file.seek(_end, SEEK_SET);
+	_file.checked_write(data.data(), data.size());
+
+	_index[key] = { _end, data.size() };
+	_end += data.size();
+}
+
+
+shared_ptr<dcp::ArrayData>
+SpillJournal::read(size_t reel, int frame, Eyes eyes)
+{
+	auto i = _index.find(make_tuple(reel, frame, eyes));
+	DCPOMATIC_ASSERT(i != _index.end());
+
+	auto const extent = i->second;
+	_index.erase(i);
+
+	auto data = make_shared<dcp::ArrayData>(extent.size);
+	_file.seek(extent.offset, SEEK_SET);
+	_file.checked_read(data->data(), extent.size);
+
+	if (extent.offset + extent.size == _end) {
+		/* Let the next write re-use this frame's space, and that of any earlier ones which have also gone */
+		_end = 0;
+		for (auto const& j: _index) {
+			_end = max(_end, j.second.offset + j.second.size);
+		}
+	}
+
+	return data;
+}
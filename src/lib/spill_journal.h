@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  src/lib/spill_journal.h
+ *  @brief SpillJournal class.
+ */
+
+
+#ifndef DCPOMATIC_SPILL_JOURNAL_H
+#define DCPOMATIC_SPILL_JOURNAL_H
+
+
+#include "types.h"
+#include <dcp/array_data.h>
+#include <dcp/file.h>
+#include <boost/filesystem.hpp>
+#include <map>
+#include <memory>
+#include <tuple>
+
+
+/** @class SpillJournal
+ *  @brief A single file to hold JPEG2000 frames which Writer has no room to keep in memory.
+ *
+ *  Frames are appended to the file and an index of where each one is kept in memory.
+ *  When a frame at the end of the file is taken back out its space is used again, so
+ *  since Writer spills the latest frames first and takes the earliest ones back first
+ *  the file tends not to grow much.  The file is made bigger in large steps and
+ *  removed when the journal is destroyed.
+ */
+class SpillJournal
+{
+public:
+	explicit SpillJournal(boost::filesystem::path path);
+	~SpillJournal();
+
+	SpillJournal(SpillJournal const&) = delete;
+	SpillJournal& operator=(SpillJournal const&) = delete;
+
+	void write(size_t reel, int frame, Eyes eyes, dcp::Data const& data);
+	/** Read a frame that was written with write() and forget about it */
+	std::shared_ptr<dcp::ArrayData> read(size_t reel, int frame, Eyes eyes);
+
+	bool empty() const {
+		return _index.empty();
+	}
+
+	/** @return Offset in the file of the end of the last frame in it */
+	int64_t end() const {
+		return _end;
+	}
+
+private:
+	struct Extent {
+		int64_t offset;
+		int64_t size;
+	};
+
+	void allocate(int64_t size);
+
+	boost::filesystem::path _path;
+	dcp::File _file;
+	/** Where each frame is in the file, indexed by reel, frame and eyes */
+	std::map<std::tuple<size_t, int, Eyes>, Extent> _index;
+	/** Offset of the end of the last frame in the file */
+	int64_t _end = 0;
+	/** Amount of space that we have asked the OS to reserve for the file */
+	int64_t _allocated = 0;
+};
+
+
+#endif
@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "stress_command.h"
+#include <dcp/raw_convert.h>
+#include <dcp/util.h>
+#include <boost/algorithm/string.hpp>
+#include <vector>
+
+
+using std::list;
+using std::string;
+using std::vector;
+using dcp::raw_convert;
+
+
+Command::Command (string line)
+	: type (NONE)
+	, int_param (0)
+{
+	vector<string> bits;
+	boost::split (bits, line, boost::is_any_of(" "));
+	if (bits[0] == "O") {
+		if (bits.size() != 2) {
+			return;
+		}
+		type = OPEN;
+		string_param = bits[1];
+	} else if (bits[0] == "P") {
+		type = PLAY;
+	} else if (bits[0] == "W") {
+		if (bits.size() != 2) {
+			return;
+		}
+		type = WAIT;
+		int_param = raw_convert<int>(bits[1]);
+	} else if (bits[0] == "S") {
+		type = STOP;
+	} else if (bits[0] == "K") {
+		if (bits.size() != 2) {
+			return;
+		}
+		type = SEEK;
+		int_param = raw_convert<int>(bits[1]);
+	} else if (bits[0] == "E") {
+		type = EXIT;
+	}
+}
+
+
+list<Command>
+read_stress_script(boost::filesystem::path file)
+{
+	vector<string> lines;
+	string const script = dcp::file_to_string(file);
+	boost::split (lines, script, boost::is_any_of("\n"));
+
+	list<Command> commands;
+	for (auto i: lines) {
+		commands.push_back (Command(i));
+	}
+	return commands;
+}
@@ -0,0 +1,60 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef DCPOMATIC_STRESS_COMMAND_H
+#define DCPOMATIC_STRESS_COMMAND_H
+
+
+#include <boost/filesystem.hpp>
+#include <list>
+#include <string>
+
+
+/** @class Command
+ *  @brief One line of a script for stress-testing the player.
+ */
+class Command
+{
+public:
+	enum Type {
+		NONE,
+		OPEN,
+		PLAY,
+		WAIT,
+		STOP,
+		SEEK,
+		EXIT
+	};
+
+	Command(std::string line);
+
+	Type type;
+	std::string string_param;
+	int int_param;
+};
+
+
+extern std::list<Command> read_stress_script(boost::filesystem::path file);
+
+
+#endif
@@ -19,11 +19,13 @@
 */
 
 
+#include "compose.hpp"
 #include "cross.h"
 #include "exceptions.h"
 #include "string_text_file.h"
 #include "string_text_file_content.h"
 #include <dcp/file.h>
+#include <dcp/filesystem.h>
 #include <sub/collect.h>
 #include <sub/ssa_reader.h>
 #include <sub/stl_binary_reader.h>
@@ -31,7 +33,10 @@
 #include <sub/web_vtt_reader.h>
 #include <unicode/ucsdet.h>
 #include <unicode/ucnv.h>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
 #include <iostream>
+#include <map>
 
 #include "i18n.h"
 
@@ -46,7 +51,56 @@ using dcp::ArrayData;
 using namespace dcpomatic;
 
 
+/** Recently-parsed files, keyed on their path, size and modification time, so that the
+ *  examiner and the decoders for the same file can share one copy of its subtitles.
+ */
+static std::map<string, std::weak_ptr<const StringTextFile::Parsed>> parsed_cache;
+/** The most recently parsed file, kept so that it is still there for the decoder after it has been examined */
+static std::shared_ptr<const StringTextFile::Parsed> last_parsed;
+static boost::mutex parsed_cache_mutex;
+
+
 StringTextFile::StringTextFile (shared_ptr<const StringTextFileContent> content)
+{
+	auto const path = content->path(0);
+	boost::system::error_code ec;
+	auto const key = String::compose(
+		"%1 %2 %3",
+		path.string(),
+		dcp::filesystem::file_size(path, ec),
+		dcp::filesystem::last_write_time(path, ec)
+		);
+
+	{
+		boost::mutex::scoped_lock lm(parsed_cache_mutex);
+		auto existing = parsed_cache.find(key);
+		if (existing != parsed_cache.end()) {
+			_parsed = existing->second.lock();
+		}
+	}
+
+	if (_parsed) {
+		return;
+	}
+
+	auto parsed = parse(content);
+	_parsed = parsed;
+
+	boost::mutex::scoped_lock lm(parsed_cache_mutex);
+	for (auto i = parsed_cache.begin(); i != parsed_cache.end(); ) {
+		if (i->second.expired()) {
+			i = parsed_cache.erase(i);
+		} else {
+			++i;
+		}
+	}
+	parsed_cache[key] = _parsed;
+	last_parsed = _parsed;
+}
+
+
+shared_ptr<StringTextFile::Parsed>
+StringTextFile::parse (shared_ptr<const StringTextFileContent> content)
 {
 	string ext = content->path(0).extension().string();
 	transform (ext.begin(), ext.end(), ext.begin(), ::tolower);
@@ -116,28 +170,49 @@ StringTextFile::StringTextFile (shared_ptr<const StringTextFileContent> content)
 		}
 	}
 
+	auto parsed = std::make_shared<Parsed>();
+
 	if (reader) {
-		_subtitles = sub::collect<vector<sub::Subtitle>>(reader->subtitles());
+		parsed->subtitles = sub::collect<vector<sub::Subtitle>>(reader->subtitles());
+	}
+
+	parsed->latest_from.reserve(parsed->subtitles.size());
+	for (auto const& subtitle: parsed->subtitles) {
+		auto const from = ContentTime::from_seconds(subtitle.from.all_as_seconds());
+		parsed->latest_from.push_back(parsed->latest_from.empty() ? from : std::max(parsed->latest_from.back(), from));
 	}
+
+	return parsed;
+}
+
+
+/** @return Index of the first subtitle which starts on or after time, or the number of subtitles
+ *  if there is no such subtitle.
+ */
+size_t
+StringTextFile::first_from (ContentTime time) const
+{
+	auto const& latest_from = _parsed->latest_from;
+	return std::lower_bound(latest_from.begin(), latest_from.end(), time) - latest_from.begin();
 }
 
 /** @return time of first subtitle, if there is one */
 optional<ContentTime>
 StringTextFile::first () const
 {
-	if (_subtitles.empty()) {
+	if (_parsed->subtitles.empty()) {
 		return {};
 	}
 
-	return ContentTime::from_seconds(_subtitles[0].from.all_as_seconds());
+	return ContentTime::from_seconds(_parsed->subtitles[0].from.all_as_seconds());
 }
 
 ContentTime
 StringTextFile::length () const
 {
-	if (_subtitles.empty ()) {
+	if (_parsed->subtitles.empty ()) {
 		return {};
 	}
 
-	return ContentTime::from_seconds (_subtitles.back().to.all_as_seconds ());
+	return ContentTime::from_seconds (_parsed->subtitles.back().to.all_as_seconds ());
 }
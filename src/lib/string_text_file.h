@@ -23,6 +23,7 @@
 
 #include "dcpomatic_time.h"
 #include <sub/subtitle.h>
+#include <memory>
 #include <vector>
 
 class StringTextFileContent;
@@ -45,11 +46,26 @@ public:
 	boost::optional<dcpomatic::ContentTime> first () const;
 	dcpomatic::ContentTime length () const;
 	std::vector<sub::Subtitle> const& subtitles() const {
-		return _subtitles;
+		return _parsed->subtitles;
 	}
 
+	/** The contents of a subtitle file, which can be shared by everything that reads the same file */
+	struct Parsed
+	{
+		std::vector<sub::Subtitle> subtitles;
+		/** For each subtitle, the latest start time of it and all the subtitles before it; this
+		 *  is sorted even if the subtitles are not, so it can be searched for a time.
+		 */
+		std::vector<dcpomatic::ContentTime> latest_from;
+	};
+
 protected:
-	std::vector<sub::Subtitle> _subtitles;
+	size_t first_from (dcpomatic::ContentTime time) const;
+
+	std::shared_ptr<const Parsed> _parsed;
+
+private:
+	static std::shared_ptr<Parsed> parse (std::shared_ptr<const StringTextFileContent> content);
 };
 
 #endif
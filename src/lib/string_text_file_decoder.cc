@@ -58,10 +58,7 @@ StringTextFileDecoder::seek (ContentTime time, bool accurate)
 
 	Decoder::seek (time, accurate);
 
-	_next = 0;
-	while (_next < _subtitles.size() && ContentTime::from_seconds (_subtitles[_next].from.all_as_seconds ()) < time) {
-		++_next;
-	}
+	_next = first_from (time);
 
 	update_position();
 }
@@ -70,12 +67,13 @@ StringTextFileDecoder::seek (ContentTime time, bool accurate)
 bool
 StringTextFileDecoder::pass ()
 {
-	if (_next >= _subtitles.size ()) {
+	auto const& subtitles = _parsed->subtitles;
+	if (_next >= subtitles.size ()) {
 		return true;
 	}
 
-	ContentTimePeriod const p = content_time_period (_subtitles[_next]);
-	only_text()->emit_plain (p, _subtitles[_next]);
+	ContentTimePeriod const p = content_time_period (subtitles[_next]);
+	only_text()->emit_plain (p, subtitles[_next]);
 
 	++_next;
 
@@ -86,7 +84,7 @@ StringTextFileDecoder::pass ()
 
 
 ContentTimePeriod
-StringTextFileDecoder::content_time_period (sub::Subtitle s) const
+StringTextFileDecoder::content_time_period (sub::Subtitle const& s) const
 {
 	return ContentTimePeriod (
 		ContentTime::from_seconds (s.from.all_as_seconds()),
@@ -98,9 +96,10 @@ StringTextFileDecoder::content_time_period (sub::Subtitle s) const
 void
 StringTextFileDecoder::update_position ()
 {
-	if (_next < _subtitles.size()) {
+	auto const& subtitles = _parsed->subtitles;
+	if (_next < subtitles.size()) {
 		only_text()->maybe_set_position(
-			ContentTime::from_seconds(_subtitles[_next].from.all_as_seconds())
+			ContentTime::from_seconds(subtitles[_next].from.all_as_seconds())
 			);
 	}
 }
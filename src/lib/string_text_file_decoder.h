@@ -35,7 +35,7 @@ public:
 	bool pass () override;
 
 private:
-	dcpomatic::ContentTimePeriod content_time_period (sub::Subtitle s) const;
+	dcpomatic::ContentTimePeriod content_time_period (sub::Subtitle const& s) const;
 	void update_position();
 
 	size_t _next;
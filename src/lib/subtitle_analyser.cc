@@ -0,0 +1,129 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "content.h"
+#include "film.h"
+#include "playlist.h"
+#include "render_text.h"
+#include "subtitle_analyser.h"
+#include "subtitle_analysis.h"
+#include "text_content.h"
+#include <dcp/filesystem.h>
+#include <algorithm>
+
+
+using std::shared_ptr;
+using std::vector;
+
+
+SubtitleAnalyser::SubtitleAnalyser (shared_ptr<const Film> film, vector<shared_ptr<Content>> content)
+	: _film (film)
+{
+	for (auto i: content) {
+		_results.push_back (Result(i));
+	}
+}
+
+
+vector<shared_ptr<Content>>
+SubtitleAnalyser::needing_analysis (shared_ptr<const Film> film, shared_ptr<const Playlist> playlist)
+{
+	vector<shared_ptr<Content>> content;
+	for (auto i: playlist->content()) {
+		if (!i->text.empty() && !dcp::filesystem::exists(film->subtitle_analysis_path(i))) {
+			content.push_back (i);
+		}
+	}
+	return content;
+}
+
+
+void
+SubtitleAnalyser::analyse (PlayerText const& text, TextType type)
+{
+	if (type != TextType::OPEN_SUBTITLE) {
+		return;
+	}
+
+	auto content = text.content.lock ();
+	auto result = std::find_if (_results.begin(), _results.end(), [content](Result const& r) { return r.content.lock() == content; });
+	if (!content || result == _results.end()) {
+		return;
+	}
+
+	auto extend = [result](dcpomatic::Rect<double> rect) {
+		if (!result->bounding_box) {
+			result->bounding_box = rect;
+		} else {
+			result->bounding_box->extend (rect);
+		}
+	};
+
+	for (auto const& i: text.bitmap) {
+		extend (i.rectangle);
+	}
+
+	if (text.string.empty()) {
+		return;
+	}
+
+	/* We can provide dummy values for time and frame rate here as they are only used to calculate fades */
+	dcp::Size const frame = _film->frame_size();
+	std::vector<dcp::SubtitleStandard> override_standard;
+	if (_film->interop()) {
+		/* Since the film is Interop there is only one way the vpositions in the subs can be interpreted
+		 * (we assume).
+		 */
+		override_standard.push_back(dcp::SubtitleStandard::INTEROP);
+	} else {
+		/* We're using the great new SMPTE standard, which means there are two different ways that vposition
+		 * could be interpreted; we will write SMPTE-2014 standard assets, but if the projection system uses
+		 * SMPTE 20{07,10} instead they won't be placed how we intended.  To show the user this, make the
+		 * bounding rectangle enclose both possibilities.
+		 */
+		override_standard.push_back(dcp::SubtitleStandard::SMPTE_2007);
+		override_standard.push_back(dcp::SubtitleStandard::SMPTE_2014);
+	}
+
+	for (auto i: bounding_box(text.string, frame, override_standard)) {
+		extend (
+			dcpomatic::Rect<double>(
+				double(i.x) / frame.width, double(i.y) / frame.height,
+				double(i.width) / frame.width, double(i.height) / frame.height
+				)
+		       );
+	}
+}
+
+
+void
+SubtitleAnalyser::write () const
+{
+	for (auto const& i: _results) {
+		auto content = i.content.lock ();
+		if (!content || content->text.empty()) {
+			continue;
+		}
+
+		SubtitleAnalysis analysis (i.bounding_box, content->text.front()->x_offset(), content->text.front()->y_offset());
+		analysis.write (_film->subtitle_analysis_path(content));
+	}
+}
@@ -0,0 +1,81 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DCPOMATIC_SUBTITLE_ANALYSER_H
+#define DCPOMATIC_SUBTITLE_ANALYSER_H
+
+
+#include "player_text.h"
+#include "rect.h"
+#include "text_type.h"
+#include <boost/optional.hpp>
+#include <memory>
+#include <vector>
+
+
+class Content;
+class Film;
+class Playlist;
+
+
+/** @class SubtitleAnalyser
+ *  @brief Find the bounding boxes of the open subtitles of some pieces of content.
+ *
+ *  This can be fed with the text from any Player pass which includes the content,
+ *  so that the analysis can be done alongside other work (e.g. audio analysis)
+ *  rather than needing a pass of its own.
+ */
+class SubtitleAnalyser
+{
+public:
+	SubtitleAnalyser (std::shared_ptr<const Film> film, std::vector<std::shared_ptr<Content>> content);
+
+	SubtitleAnalyser (SubtitleAnalyser const&) = delete;
+	SubtitleAnalyser& operator= (SubtitleAnalyser const&) = delete;
+
+	void analyse (PlayerText const& text, TextType type);
+	/** Write a SubtitleAnalysis for each of our content to its Film::subtitle_analysis_path */
+	void write () const;
+
+	bool empty () const {
+		return _results.empty();
+	}
+
+	/** @return content in playlist which has text but no subtitle analysis yet */
+	static std::vector<std::shared_ptr<Content>> needing_analysis (std::shared_ptr<const Film> film, std::shared_ptr<const Playlist> playlist);
+
+private:
+	struct Result
+	{
+		explicit Result (std::shared_ptr<Content> c)
+			: content (c)
+		{}
+
+		std::weak_ptr<Content> content;
+		boost::optional<dcpomatic::Rect<double>> bounding_box;
+	};
+
+	std::shared_ptr<const Film> _film;
+	std::vector<Result> _results;
+};
+
+
+#endif
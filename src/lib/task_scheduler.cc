@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "dcpomatic_assert.h"
+#include "task_scheduler.h"
+#include <algorithm>
+
+
+using std::function;
+using std::make_shared;
+using std::unique_ptr;
+
+
+TaskScheduler::TaskScheduler(int threads)
+	: _next(0)
+	, _pending(0)
+{
+	DCPOMATIC_ASSERT(threads > 0);
+
+	for (int i = 0; i < threads; ++i) {
+		_workers.push_back(unique_ptr<Worker>(new Worker));
+	}
+
+	for (int i = 0; i < threads; ++i) {
+		_workers[i]->thread = boost::thread(boost::bind(&TaskScheduler::thread, this, i));
+#ifdef DCPOMATIC_LINUX
+		pthread_setname_np(_workers[i]->thread.native_handle(), "task-scheduler");
+#endif
+	}
+}
+
+
+/** Stop the workers; any tasks which have not yet been started are discarded */
+TaskScheduler::~TaskScheduler()
+{
+	boost::this_thread::disable_interruption dis;
+
+	{
+		boost::mutex::scoped_lock lm(_wake_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+
+	for (auto& worker: _workers) {
+		try {
+			worker->thread.join();
+		} catch (...) {}
+	}
+}
+
+
+void
+TaskScheduler::submit(Priority priority, function<void ()> task)
+{
+	auto& worker = *_workers[_next++ % _workers.size()];
+
+	{
+		boost::mutex::scoped_lock lm(worker.mutex);
+		worker.queues[static_cast<int>(priority)].push_back(std::move(task));
+	}
+
+	{
+		boost::mutex::scoped_lock lm(_wake_mutex);
+		++_pending;
+	}
+	_wake.notify_one();
+}
+
+
+/** Find the next task for a worker: the oldest task of the highest priority in its own queues,
+ *  or failing that the newest task of that priority from another worker.
+ *  @return true if a task was found.
+ */
+bool
+TaskScheduler::take(int index, function<void ()>& task)
+{
+	int const N = _workers.size();
+
+	for (int priority = 0; priority < priorities; ++priority) {
+		{
+			auto& own = *_workers[index];
+			boost::mutex::scoped_lock lm(own.mutex);
+			auto& queue = own.queues[priority];
+			if (!queue.empty()) {
+				task = std::move(queue.front());
+				queue.pop_front();
+				--_pending;
+				return true;
+			}
+		}
+
+		for (int i = 1; i < N; ++i) {
+			auto& victim = *_workers[(index + i) % N];
+			boost::mutex::scoped_lock lm(victim.mutex);
+			auto& queue = victim.queues[priority];
+			if (!queue.empty()) {
+				task = std::move(queue.back());
+				queue.pop_back();
+				--_pending;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+void
+TaskScheduler::thread(int index)
+{
+	while (true) {
+		function<void ()> task;
+		if (!take(index, task)) {
+			boost::mutex::scoped_lock lm(_wake_mutex);
+			while (_pending == 0 && !_stop) {
+				_wake.wait(lm);
+			}
+			if (_stop) {
+				return;
+			}
+			continue;
+		}
+
+		try {
+			task();
+		} catch (...) {
+			/* Tasks are supposed to deal with their own exceptions */
+		}
+	}
+}
+
+
+TaskScheduler*
+TaskScheduler::instance()
+{
+	/* This is never destroyed, since tasks may still be running during static destruction */
+	static auto instance = new TaskScheduler(std::max(1U, boost::thread::hardware_concurrency()));
+	return instance;
+}
+
+
+TaskScheduler::Group::Group(TaskScheduler* scheduler, Priority priority)
+	: _scheduler(scheduler)
+	, _priority(priority)
+	, _state(make_shared<State>())
+{
+
+}
+
+
+TaskScheduler::Group::~Group()
+{
+	wait();
+}
+
+
+void
+TaskScheduler::Group::submit(function<void ()> task)
+{
+	{
+		boost::mutex::scoped_lock lm(_state->mutex);
+		++_state->outstanding;
+	}
+
+	auto state = _state;
+	_scheduler->submit(_priority, [state, task]() {
+		try {
+			task();
+		} catch (...) {}
+		boost::mutex::scoped_lock lm(state->mutex);
+		--state->outstanding;
+		state->done.notify_all();
+	});
+}
+
+
+void
+TaskScheduler::Group::wait()
+{
+	boost::this_thread::disable_interruption dis;
+	boost::mutex::scoped_lock lm(_state->mutex);
+	while (_state->outstanding > 0) {
+		_state->done.wait(lm);
+	}
+}
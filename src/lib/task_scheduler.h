@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef DCPOMATIC_TASK_SCHEDULER_H
+#define DCPOMATIC_TASK_SCHEDULER_H
+
+
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+/** @class TaskScheduler
+ *  @brief A pool of worker threads which run short, CPU-bound tasks for the whole process.
+ *
+ *  Each worker has its own queue of tasks for each priority; submitted tasks are spread
+ *  around the workers and a worker with nothing to do steals from the others.  A higher
+ *  priority task is always taken before a lower priority one.
+ *
+ *  Tasks must not block waiting for other tasks, otherwise the pool may deadlock.  They
+ *  must also handle their own exceptions; anything thrown out of a task is discarded.
+ */
+class TaskScheduler
+{
+public:
+	enum class Priority
+	{
+		/** Work that someone is waiting to see, e.g. preparing frames for the viewer */
+		PREVIEW,
+		/** Work for an encode / export */
+		ENCODE,
+		/** Work that can happen whenever there is time, e.g. analysis */
+		BACKGROUND,
+	};
+
+	explicit TaskScheduler(int threads);
+	~TaskScheduler();
+
+	TaskScheduler(TaskScheduler const&) = delete;
+	TaskScheduler& operator=(TaskScheduler const&) = delete;
+
+	void submit(Priority priority, std::function<void ()> task);
+
+	int threads() const {
+		return _workers.size();
+	}
+
+	static TaskScheduler* instance();
+
+	/** @class Group
+	 *  @brief A set of tasks submitted by one owner, which can be waited for.
+	 *
+	 *  The destructor waits for any outstanding tasks, so an object can safely submit
+	 *  tasks which refer to itself as long as it owns the Group.
+	 */
+	class Group
+	{
+	public:
+		Group(TaskScheduler* scheduler, Priority priority);
+		~Group();
+
+		Group(Group const&) = delete;
+		Group& operator=(Group const&) = delete;
+
+		void submit(std::function<void ()> task);
+		/** Wait until all the tasks submitted so far have finished */
+		void wait();
+
+	private:
+		struct State
+		{
+			boost::mutex mutex;
+			boost::condition done;
+			int outstanding = 0;
+		};
+
+		TaskScheduler* _scheduler;
+		Priority _priority;
+		std::shared_ptr<State> _state;
+	};
+
+private:
+	static int constexpr priorities = 3;
+
+	struct Worker
+	{
+		boost::mutex mutex;
+		std::deque<std::function<void ()>> queues[priorities];
+		boost::thread thread;
+	};
+
+	void thread(int index);
+	bool take(int index, std::function<void ()>& task);
+
+	std::vector<std::unique_ptr<Worker>> _workers;
+	/** Worker to give the next submitted task to */
+	std::atomic<unsigned int> _next;
+	/** Number of tasks waiting in all the queues */
+	std::atomic<int> _pending;
+
+	/** mutex to protect _stop and to make sure that wake-ups are not missed */
+	boost::mutex _wake_mutex;
+	boost::condition _wake;
+	bool _stop = false;
+};
+
+
+#endif
@@ -19,6 +19,7 @@
 */
 
 
+#include "image.h"
 #include "text_ring_buffers.h"
 
 
@@ -52,5 +53,23 @@ TextRingBuffers::get ()
 void
 TextRingBuffers::clear ()
 {
+	boost::mutex::scoped_lock lm (_mutex);
 	_data.clear ();
 }
+
+
+size_t
+TextRingBuffers::memory_used () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	size_t m = 0;
+	for (auto const& i: _data) {
+		for (auto const& j: i.text.bitmap) {
+			m += j.image->memory_used();
+		}
+		for (auto const& j: i.text.string) {
+			m += sizeof(j) + j.text().size();
+		}
+	}
+	return m;
+}
@@ -50,8 +50,11 @@ public:
 	boost::optional<Data> get ();
 	void clear ();
 
+	/** @return approximate number of bytes used by the texts that we are holding */
+	size_t memory_used () const;
+
 private:
-	boost::mutex _mutex;
+	mutable boost::mutex _mutex;
 
 	std::list<Data> _data;
 };
@@ -0,0 +1,296 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "content.h"
+#include "dcpomatic_log.h"
+#include "digester.h"
+#include "ffmpeg_image_proxy.h"
+#include "film.h"
+#include "frame_rate_change.h"
+#include "image.h"
+#include "image_png.h"
+#include "player.h"
+#include "player_video.h"
+#include "playlist.h"
+#include "state.h"
+#include "thumbnail_cache.h"
+#include "util.h"
+#include "video_content.h"
+#include <dcp/filesystem.h>
+#include <boost/bind/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <cmath>
+
+
+using std::make_pair;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using namespace dcpomatic;
+
+
+ThumbnailCache* ThumbnailCache::_instance = nullptr;
+
+
+ThumbnailCache::ThumbnailCache ()
+{
+
+}
+
+
+void
+ThumbnailCache::start ()
+{
+	_thread = boost::thread (boost::bind(&ThumbnailCache::thread, this));
+#ifdef DCPOMATIC_LINUX
+	pthread_setname_np (_thread.native_handle(), "thumbnails");
+#endif
+}
+
+
+ThumbnailCache::~ThumbnailCache ()
+{
+	boost::this_thread::disable_interruption dis;
+
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_terminate = true;
+	}
+
+	_condition.notify_all ();
+	try {
+		_thread.join ();
+	} catch (...) {}
+}
+
+
+/** @return A key which identifies the thumbnails of some content; it changes whenever
+ *  anything that affects how the content's video looks changes.
+ */
+string
+ThumbnailCache::key (shared_ptr<const Content> content)
+{
+	DCPOMATIC_ASSERT (content->video);
+
+	Digester digester;
+	digester.add (content->digest());
+	digester.add (content->video->identifier());
+	return digester.get ();
+}
+
+
+/** Get a thumbnail of some content at some time.  If we don't have it already it will be
+ *  made in the background, and Ready will be emitted when it (or some other thumbnail)
+ *  can be had.
+ *  @return Thumbnail, or nullptr if it is not available yet.
+ */
+shared_ptr<const Image>
+ThumbnailCache::get (shared_ptr<const Film> film, shared_ptr<Content> content, ContentTime time)
+{
+	auto const content_key = key (content);
+	auto const id = content_key + "_" + std::to_string(time.get());
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	auto i = _image_index.find (id);
+	if (i != _image_index.end()) {
+		_images.splice (_images.begin(), _images, i->second);
+		return i->second->second;
+	}
+
+	if (_requested.find(id) == _requested.end()) {
+		_requests.push_front ({ film, content, content_key, time, id });
+		_requested.insert (id);
+		if (static_cast<int>(_requests.size()) > _max_requests) {
+			_requested.erase (_requests.back().id);
+			_requests.pop_back ();
+		}
+		_condition.notify_all ();
+	}
+
+	return {};
+}
+
+
+void
+ThumbnailCache::add (string id, shared_ptr<const Image> image)
+{
+	_images.push_front (make_pair(id, image));
+	_image_index[id] = _images.begin();
+
+	while (static_cast<int>(_images.size()) > _max_images) {
+		_image_index.erase (_images.back().first);
+		_images.pop_back ();
+	}
+}
+
+
+void
+ThumbnailCache::thread ()
+{
+	start_of_thread ("ThumbnailCache");
+
+	while (true) {
+		Request request;
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			while (_requests.empty() && !_terminate) {
+				/* Let go of the player (and so any open files) while there is nothing to do */
+				_player.reset ();
+				_condition.wait (lm);
+			}
+
+			if (_terminate) {
+				return;
+			}
+
+			request = _requests.front ();
+			_requests.pop_front ();
+		}
+
+		shared_ptr<const Image> image;
+		try {
+			image = make (request);
+		} catch (std::exception& e) {
+			LOG_GENERAL ("Could not make thumbnail (%1)", e.what());
+		}
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			/* If there was a failure we still store the (null) image, so that we don't keep trying */
+			add (request.id, image);
+			_requested.erase (request.id);
+		}
+
+		if (image) {
+			emit (boost::bind(boost::ref(Ready)));
+		}
+	}
+}
+
+
+/** Read a thumbnail from disk, or make it (and write it to disk) if it is not there */
+shared_ptr<const Image>
+ThumbnailCache::make (Request const& request)
+{
+	auto film = request.film.lock ();
+	auto content = request.content.lock ();
+	if (!film || !content || !content->video) {
+		return {};
+	}
+
+	auto const file = State::read_path("thumbnails") / (request.id + ".png");
+	if (dcp::filesystem::exists(file)) {
+		try {
+			auto image = FFmpegImageProxy(file).image(Image::Alignment::COMPACT).image;
+			if (image->pixel_format() != AV_PIX_FMT_RGBA) {
+				image = image->convert_pixel_format(dcp::YUVToRGB::REC709, AV_PIX_FMT_RGBA, Image::Alignment::COMPACT, false);
+			}
+			return image;
+		} catch (std::exception& e) {
+			LOG_GENERAL ("Could not read cached thumbnail %1 (%2)", file.string(), e.what());
+		}
+	}
+
+	if (!_player || _player_key != request.content_key || _player_film.lock() != film) {
+		auto playlist = make_shared<Playlist>();
+		playlist->add (film, content);
+		_player = make_shared<Player>(film, playlist);
+		_player->set_ignore_audio ();
+		_player->set_ignore_text ();
+		_player->set_fast ();
+		_player->set_video_container_size (
+			dcp::Size(std::lrint(height * film->frame_size().ratio()) & ~1, height)
+			);
+
+		/* Reduce the resolution of any JPEG2000 decoding as much as we can */
+		auto const content_height = content->video->size().height;
+		int reduction = 0;
+		while (reduction < 5 && (content_height >> (reduction + 1)) >= height) {
+			++reduction;
+		}
+		_player->set_dcp_decode_reduction (reduction);
+
+		_player_key = request.content_key;
+		_player_film = film;
+	}
+
+	shared_ptr<PlayerVideo> video;
+	boost::signals2::scoped_connection connection (
+		_player->Video.connect([&video](shared_ptr<PlayerVideo> pv, DCPTime) {
+			if (!video) {
+				video = pv;
+			}
+		})
+		);
+
+	/* An inaccurate seek here lets decoders start at the nearest key frame, which is
+	 * close enough for a thumbnail and much quicker.
+	 */
+	FrameRateChange const frc (film, content);
+	_player->seek (content->position() + DCPTime(request.time - content->trim_start(), frc), false);
+
+	for (int i = 0; i < 64 && !video; ++i) {
+		if (_player->pass()) {
+			break;
+		}
+	}
+
+	if (!video) {
+		return {};
+	}
+
+	auto image = Image::ensure_alignment (
+		video->image([](AVPixelFormat) { return AV_PIX_FMT_RGBA; }, VideoRange::FULL, true),
+		Image::Alignment::COMPACT
+		);
+
+	auto const dir = State::write_path("thumbnails");
+	boost::system::error_code ec;
+	dcp::filesystem::create_directories(dir, ec);
+	auto const tmp = dir / (request.id + "." + boost::filesystem::unique_path().string() + ".tmp");
+
+	try {
+		image_as_png(image).write(tmp);
+		dcp::filesystem::rename(tmp, dir / (request.id + ".png"));
+	} catch (std::exception& e) {
+		/* Failing to cache is not fatal; the thumbnail will just be made again next time */
+		LOG_WARNING ("Could not write thumbnail cache file %1 (%2)", tmp.string(), e.what());
+		dcp::filesystem::remove(tmp, ec);
+	}
+
+	return image;
+}
+
+
+ThumbnailCache*
+ThumbnailCache::instance ()
+{
+	if (!_instance) {
+		_instance = new ThumbnailCache ();
+		_instance->start ();
+	}
+
+	return _instance;
+}
@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/thumbnail_cache.h
+ *  @brief ThumbnailCache class.
+ */
+
+
+#ifndef DCPOMATIC_THUMBNAIL_CACHE_H
+#define DCPOMATIC_THUMBNAIL_CACHE_H
+
+
+#include "dcpomatic_time.h"
+#include "signaller.h"
+#include <boost/signals2.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+
+
+class Content;
+class Film;
+class Image;
+class Player;
+
+
+/** @class ThumbnailCache
+ *  @brief Small RGBA images of video content, made in the background for the timeline.
+ *
+ *  Thumbnails are kept in memory for as long as they are used, and written to disk
+ *  (keyed on the content's digest) so that they need not be made again.
+ */
+class ThumbnailCache : public Signaller
+{
+public:
+	~ThumbnailCache ();
+
+	ThumbnailCache (ThumbnailCache const&) = delete;
+	ThumbnailCache& operator= (ThumbnailCache const&) = delete;
+
+	std::shared_ptr<const Image> get (std::shared_ptr<const Film> film, std::shared_ptr<Content> content, dcpomatic::ContentTime time);
+
+	/** Emitted in the UI thread when a thumbnail that was asked for becomes available */
+	boost::signals2::signal<void ()> Ready;
+
+	static std::string key (std::shared_ptr<const Content> content);
+
+	static ThumbnailCache* instance ();
+
+	/** Height of the thumbnails that we make, in pixels */
+	static int constexpr height = 64;
+
+private:
+	ThumbnailCache ();
+
+	struct Request
+	{
+		std::weak_ptr<const Film> film;
+		std::weak_ptr<Content> content;
+		std::string content_key;
+		dcpomatic::ContentTime time;
+		std::string id;
+	};
+
+	void start ();
+	void thread ();
+	std::shared_ptr<const Image> make (Request const& request);
+	void add (std::string id, std::shared_ptr<const Image> image);
+
+	static ThumbnailCache* _instance;
+
+	/** Mutex to protect the things below */
+	boost::mutex _mutex;
+	boost::condition _condition;
+	/** Thumbnails in memory, most-recently-used first */
+	std::list<std::pair<std::string, std::shared_ptr<const Image>>> _images;
+	std::map<std::string, std::list<std::pair<std::string, std::shared_ptr<const Image>>>::iterator> _image_index;
+	/** Thumbnails to make, most-recently-requested first */
+	std::list<Request> _requests;
+	/** IDs of everything in _requests, and of the request that is currently being made */
+	std::set<std::string> _requested;
+	bool _terminate = false;
+
+	/** Player for the content of the last request; only used by our thread */
+	std::shared_ptr<Player> _player;
+	std::string _player_key;
+	std::weak_ptr<const Film> _player_film;
+
+	boost::thread _thread;
+
+	/** Maximum number of thumbnails to keep in memory */
+	static int constexpr _max_images = 1024;
+	/** Maximum number of requests to keep; older ones are forgotten about and will
+	 *  be made again if they are asked for again.
+	 */
+	static int constexpr _max_requests = 256;
+};
+
+
+#endif
@@ -0,0 +1,284 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "compose.hpp"
+#include "dcpomatic_assert.h"
+#include "exceptions.h"
+#include "trace.h"
+#include <dcp/file.h>
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+
+std::atomic<bool> Trace::_enabled(false);
+size_t constexpr Trace::events_per_thread;
+
+
+namespace {
+
+struct Event
+{
+	char const* name = nullptr;
+	/** category, or nullptr if this is a counter */
+	char const* category = nullptr;
+	int64_t start = 0;
+	/** duration for a span, value for a counter */
+	int64_t value = 0;
+};
+
+
+/** The events from one thread.  The mutex is only ever contended when the trace is being written */
+struct ThreadEvents
+{
+	explicit ThreadEvents (int id_)
+		: id(id_)
+		, events(Trace::events_per_thread)
+	{}
+
+	int const id;
+	boost::mutex mutex;
+	string name;
+	vector<Event> events;
+	/** Total number of events ever added; the next one goes at events[added % events.size()] */
+	size_t added = 0;
+};
+
+
+boost::mutex threads_mutex;
+vector<shared_ptr<ThreadEvents>> threads;
+std::chrono::steady_clock::time_point start_time;
+
+
+ThreadEvents&
+this_thread_events ()
+{
+	/* This keeps the events for each thread after the thread has gone, since threads
+	 * holds another reference to them.
+	 */
+	thread_local shared_ptr<ThreadEvents> events;
+	if (!events) {
+		boost::mutex::scoped_lock lm (threads_mutex);
+		events = std::make_shared<ThreadEvents>(static_cast<int>(threads.size()) + 1);
+		threads.push_back(events);
+	}
+	return *events;
+}
+
+
+void
+add (Event const& event)
+{
+	auto& thread = this_thread_events();
+	boost::mutex::scoped_lock lm (thread.mutex);
+	thread.events[thread.added % thread.events.size()] = event;
+	++thread.added;
+}
+
+
+string
+escape (string s)
+{
+	string out;
+	for (auto c: s) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+		}
+		if (static_cast<unsigned char>(c) >= 0x20) {
+			out += c;
+		}
+	}
+	return out;
+}
+
+}
+
+
+/** Start recording events.  This should be called before any of the threads which are to
+ *  be traced are started.
+ */
+void
+Trace::enable ()
+{
+	start_time = std::chrono::steady_clock::now();
+	_enabled = true;
+}
+
+
+int64_t
+Trace::now ()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+
+/** Set the name that the calling thread will have in the trace */
+void
+Trace::set_thread_name (string name)
+{
+	if (!_enabled) {
+		return;
+	}
+
+	auto& thread = this_thread_events();
+	boost::mutex::scoped_lock lm (thread.mutex);
+	thread.name = name;
+}
+
+
+void
+Trace::span (char const* name, char const* category, int64_t start, int64_t end)
+{
+	if (!_enabled) {
+		return;
+	}
+
+	DCPOMATIC_ASSERT (category);
+
+	Event event;
+	event.name = name;
+	event.category = category;
+	event.start = start;
+	event.value = end - start;
+	add (event);
+}
+
+
+void
+Trace::counter (char const* name, int64_t value)
+{
+	if (!_enabled) {
+		return;
+	}
+
+	Event event;
+	event.name = name;
+	event.start = now();
+	event.value = value;
+	add (event);
+}
+
+
+std::map<string, Trace::Totals>
+Trace::totals ()
+{
+	vector<shared_ptr<ThreadEvents>> all_threads;
+	{
+		boost::mutex::scoped_lock lm (threads_mutex);
+		all_threads = threads;
+	}
+
+	std::map<string, Totals> totals;
+	for (auto thread: all_threads) {
+		boost::mutex::scoped_lock lm (thread->mutex);
+		auto const size = thread->events.size();
+		auto const count = std::min(thread->added, size);
+		for (auto i = thread->added - count; i < thread->added; ++i) {
+			auto const& event = thread->events[i % size];
+			if (event.category) {
+				auto& total = totals[string(event.category) + "/" + event.name];
+				++total.count;
+				total.duration += event.value;
+			}
+		}
+	}
+
+	return totals;
+}
+
+
+void
+Trace::clear ()
+{
+	boost::mutex::scoped_lock lm (threads_mutex);
+	for (auto thread: threads) {
+		boost::mutex::scoped_lock lm2 (thread->mutex);
+		thread->added = 0;
+	}
+}
+
+
+/** Write all the events that we have kept in Chrome's JSON trace format */
+void
+Trace::write (boost::filesystem::path file)
+{
+	vector<shared_ptr<ThreadEvents>> all_threads;
+	{
+		boost::mutex::scoped_lock lm (threads_mutex);
+		all_threads = threads;
+	}
+
+	string json = "{\"traceEvents\":[\n";
+	bool first = true;
+	char buffer[512];
+
+	auto add_to_json = [&json, &first](string const& s) {
+		if (!first) {
+			json += ",\n";
+		}
+		json += s;
+		first = false;
+	};
+
+	for (auto thread: all_threads) {
+		boost::mutex::scoped_lock lm (thread->mutex);
+
+		if (!thread->name.empty()) {
+			add_to_json(String::compose("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}}", thread->id, escape(thread->name)));
+		}
+
+		auto const size = thread->events.size();
+		auto const count = std::min(thread->added, size);
+		for (auto i = thread->added - count; i < thread->added; ++i) {
+			auto const& event = thread->events[i % size];
+			if (event.category) {
+				snprintf(
+					buffer, sizeof(buffer), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+					event.name, event.category, thread->id, static_cast<long long>(event.start), static_cast<long long>(event.value)
+					);
+			} else {
+				snprintf(
+					buffer, sizeof(buffer), "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"args\":{\"value\":%lld}}",
+					event.name, thread->id, static_cast<long long>(event.start), static_cast<long long>(event.value)
+					);
+			}
+			add_to_json(buffer);
+		}
+	}
+
+	json += "\n]}\n";
+
+	dcp::File f(file, "w");
+	if (!f) {
+		throw OpenFileError (file, errno, OpenFileError::WRITE);
+	}
+	f.checked_write(json.c_str(), json.length());
+}
@@ -0,0 +1,124 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/trace.h
+ *  @brief Trace and TraceSpan classes, for profiling the encoding pipeline.
+ */
+
+
+#ifndef DCPOMATIC_TRACE_H
+#define DCPOMATIC_TRACE_H
+
+
+#include <boost/filesystem.hpp>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+
+/** @class Trace
+ *  @brief Collector of timed spans (and counter values) from the threads of the encoding pipeline.
+ *
+ *  Each thread records into its own fixed-size ring buffer, so when a trace runs for a long
+ *  time only the most recent events from each thread are kept.  The whole lot can be written
+ *  in Chrome's trace event format, which chrome://tracing and Perfetto can both open.
+ *
+ *  Nothing is recorded until enable() has been called, and until then all the recording
+ *  methods cost no more than checking a flag.
+ */
+class Trace
+{
+public:
+	static void enable ();
+
+	static bool enabled () {
+		return _enabled;
+	}
+
+	static void set_thread_name (std::string name);
+	/** Record a span.  name and category must be string literals (or otherwise live forever).
+	 *  @param start Start time, from now().
+	 *  @param end End time, from now().
+	 */
+	static void span (char const* name, char const* category, int64_t start, int64_t end);
+	/** Record the value of a counter (such as a queue length) at the current time.
+	 *  name must be a string literal.
+	 */
+	static void counter (char const* name, int64_t value);
+	static void write (boost::filesystem::path file);
+
+	struct Totals {
+		/** number of spans */
+		int64_t count = 0;
+		/** total duration of the spans in microseconds */
+		int64_t duration = 0;
+	};
+
+	/** @return totals of the spans currently kept by all threads, indexed by category/name */
+	static std::map<std::string, Totals> totals ();
+	/** Forget all the events that have been recorded so far */
+	static void clear ();
+
+	/** @return Current time in microseconds since enable() was called */
+	static int64_t now ();
+
+	/** Number of events that each thread keeps */
+	static size_t constexpr events_per_thread = 65536;
+
+private:
+	static std::atomic<bool> _enabled;
+};
+
+
+/** @class TraceSpan
+ *  @brief Record a Trace span from construction to destruction.
+ */
+class TraceSpan
+{
+public:
+	/** name and category must be string literals */
+	TraceSpan (char const* name, char const* category)
+		: _name (name)
+		, _category (category)
+		, _start (Trace::enabled() ? Trace::now() : -1)
+	{}
+
+	~TraceSpan ()
+	{
+		if (_start >= 0) {
+			Trace::span (_name, _category, _start, Trace::now());
+		}
+	}
+
+	TraceSpan (TraceSpan const&) = delete;
+	TraceSpan& operator= (TraceSpan const&) = delete;
+
+private:
+	char const* _name;
+	char const* _category;
+	int64_t _start;
+};
+
+
+#endif
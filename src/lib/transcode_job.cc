@@ -33,6 +33,7 @@
 #include "encoder.h"
 #include "examine_content_job.h"
 #include "film.h"
+#include "image_buffer_pool.h"
 #include "job_manager.h"
 #include "log.h"
 #include "transcode_job.h"
@@ -49,6 +50,7 @@ using std::make_shared;
 using std::setprecision;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using boost::optional;
 using std::dynamic_pointer_cast;
 
@@ -128,6 +130,11 @@ TranscodeJob::run ()
 		set_state (FINISHED_OK);
 
 		LOG_GENERAL(N_("Transcode job completed successfully: %1 fps"), dcp::locale_convert<string>(frames_per_second(), 2, true));
+		auto const pool = ImageBufferPool::instance()->statistics();
+		LOG_GENERAL(N_("Image buffer pool: %1 hits, %2 misses, %3 discards, %4MB held"), pool.hits, pool.misses, pool.discards, pool.bytes_held / 1048576);
+		if (pool.huge_page_allocations) {
+			LOG_GENERAL(N_("Image buffer pool: %1 huge page allocations, %2MB in use"), pool.huge_page_allocations, pool.huge_page_bytes / 1048576);
+		}
 
 		if (dynamic_pointer_cast<DCPEncoder>(_encoder)) {
 			try {
@@ -169,6 +176,20 @@ TranscodeJob::status () const
 }
 
 
+/** @return values describing the current state of the encode, or an empty vector if we are not encoding */
+vector<Metric>
+TranscodeJob::metrics () const
+{
+	/* _encoder might be destroyed by the job-runner thread */
+	auto e = _encoder;
+	if (!e) {
+		return {};
+	}
+
+	return e->metrics();
+}
+
+
 /** @return Approximate remaining time in seconds */
 int
 TranscodeJob::remaining_time () const
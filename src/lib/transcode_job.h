@@ -29,6 +29,7 @@
 
 
 #include "job.h"
+#include "metric.h"
 
 
 /* Defined by Windows */
@@ -63,6 +64,8 @@ public:
 
 	void set_encoder (std::shared_ptr<Encoder> t);
 
+	std::vector<Metric> metrics () const;
+
 private:
 	virtual void post_transcode () {}
 	float frames_per_second() const;
@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "audio_buffers.h"
+#include "dcpomatic_assert.h"
+#include "true_peak_meter.h"
+#include <algorithm>
+#include <cmath>
+
+
+using std::max;
+using std::min;
+using std::vector;
+
+
+/** Number of frames processed at a time, so that the working buffers stay in cache */
+static int constexpr block = 1024;
+
+
+TruePeakMeter::TruePeakMeter (int channels)
+	: _history (channels, vector<float>(taps_per_phase - 1, 0.0f))
+	, _output (block)
+	, _peaks (channels, 0.0f)
+{
+	/* Hann-windowed sinc, centred on the middle tap so that phase 0 gives back the input samples */
+	int constexpr taps = (taps_per_phase - 1) * oversampling + 1;
+	for (int p = 0; p < oversampling; ++p) {
+		for (int k = 0; k < taps_per_phase; ++k) {
+			int const n = p + k * oversampling;
+			if (n >= taps) {
+				_coefficients[p][k] = 0;
+				continue;
+			}
+			double const x = static_cast<double>(n - (taps - 1) / 2) / oversampling;
+			double const sinc = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+			double const window = 0.5 * (1 - cos(2 * M_PI * n / (taps - 1)));
+			_coefficients[p][k] = sinc * window;
+		}
+	}
+}
+
+
+void
+TruePeakMeter::process (AudioBuffers const& audio)
+{
+	DCPOMATIC_ASSERT (audio.channels() == static_cast<int>(_history.size()));
+
+	for (int c = 0; c < audio.channels(); ++c) {
+		process (c, audio.data(c), audio.frames());
+	}
+}
+
+
+/** Run some silence through the filter so that the last samples given to process() are measured */
+void
+TruePeakMeter::flush ()
+{
+	vector<float> silence(taps_per_phase, 0.0f);
+	for (size_t c = 0; c < _history.size(); ++c) {
+		process (c, silence.data(), silence.size());
+	}
+}
+
+
+void
+TruePeakMeter::process (int channel, float const* data, int frames)
+{
+	auto& history = _history[channel];
+	int constexpr keep = taps_per_phase - 1;
+
+	for (int offset = 0; offset < frames; offset += block) {
+		int const this_block = min(block, frames - offset);
+
+		/* history is the last `keep' input samples followed by this block */
+		history.resize(keep + this_block);
+		std::copy(data + offset, data + offset + this_block, history.begin() + keep);
+
+		float peak = _peaks[channel];
+		for (int p = 0; p < oversampling; ++p) {
+			auto const coefficients = _coefficients[p];
+			auto in = history.data() + keep;
+			auto out = _output.data();
+			std::fill(out, out + this_block, 0.0f);
+			/* Output i comes from inputs i, i - 1, ... i - keep; write it as a sum of
+			 * shifted copies of the input so that the inner loop vectorises.
+			 */
+			for (int k = 0; k < taps_per_phase; ++k) {
+				auto const coefficient = coefficients[k];
+				auto const shifted = in - k;
+				for (int i = 0; i < this_block; ++i) {
+					out[i] += coefficient * shifted[i];
+				}
+			}
+			for (int i = 0; i < this_block; ++i) {
+				peak = max(peak, std::abs(out[i]));
+			}
+		}
+		_peaks[channel] = peak;
+
+		std::copy(history.end() - keep, history.end(), history.begin());
+	}
+
+	history.resize(keep);
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef DCPOMATIC_TRUE_PEAK_METER_H
+#define DCPOMATIC_TRUE_PEAK_METER_H
+
+
+#include <vector>
+
+
+class AudioBuffers;
+
+
+/** @class TruePeakMeter
+ *  @brief Measure the true peak of some audio by finding the largest absolute sample of
+ *  a 4x oversampled version of it.
+ */
+class TruePeakMeter
+{
+public:
+	explicit TruePeakMeter (int channels);
+
+	void process (AudioBuffers const& audio);
+	void flush ();
+
+	/** @return Linear true peak of each channel so far */
+	std::vector<float> peaks () const {
+		return _peaks;
+	}
+
+	static int constexpr oversampling = 4;
+	static int constexpr taps_per_phase = 13;
+
+private:
+	void process (int channel, float const* data, int frames);
+
+	/** Interpolation filter coefficients, indexed by phase then tap */
+	float _coefficients[oversampling][taps_per_phase];
+	/** The last taps_per_phase - 1 input samples for each channel, followed by space for new input */
+	std::vector<std::vector<float>> _history;
+	std::vector<float> _output;
+	std::vector<float> _peaks;
+};
+
+
+#endif
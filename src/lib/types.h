@@ -43,8 +43,54 @@ class FFmpegContent;
  *
  *  64 - first version used
  *  65 - v2.16.0 - checksums added to communication
+ *  66 - persistent connections with several frames in flight
+ *  67 - binary encoding requests
+ *  68 - servers send a hash of each encoded frame
+ *  69 - servers can say that they are too busy to encode a frame, and report their load
  */
-#define SERVER_LINK_VERSION (64+1)
+#define SERVER_LINK_VERSION (64+5)
+
+
+/** Commands sent by a master to an EncodeServer over an encoding connection */
+enum class EncodeServerCommand : uint32_t
+{
+	/** The following data is a frame to encode */
+	ENCODE = 1,
+	/** Send back the next frame to be finished; the reply is its index, eyes, a time in
+	 *  milliseconds after which to try again if the server was too busy to encode it (or 0),
+	 *  size and the MD5 of its data as hex (covered by the connection's checksum), followed
+	 *  by the data.
+	 */
+	COLLECT = 2,
+	/** The following uint32 is a TransportChecksum to use for the rest of the connection */
+	SET_CHECKSUM = 3,
+	/** As ENCODE, but the frame is described in binary rather than XML */
+	ENCODE_BINARY = 4
+};
+
+/** Ways in which a master can describe a frame that it sends to an encode server */
+enum class EncodingRequestFormat
+{
+	/** Compact and quick to read; the default */
+	BINARY,
+	/** Easier to read when debugging */
+	XML
+};
+
+/** Ways in which images can be compressed when they are sent to encode servers */
+enum class TransportCompression
+{
+	NONE,
+	ZSTD
+};
+
+/** Checksums that can be used to check data sent to and from encode servers */
+enum class TransportChecksum : uint32_t
+{
+	MD5 = 0,
+	CRC32C = 1
+};
+
 
 /** A film of F seconds at f FPS will be Ff frames;
     Consider some delta FPS d, so if we run the same
@@ -80,6 +126,8 @@ class FFmpegContent;
 #define BATCH_JOB_PORT (Config::instance()->server_port_base()+4)
 /** Port on which player listens for play requests */
 #define PLAYER_PLAY_PORT (Config::instance()->server_port_base()+5)
+/** Port on which EncodeServerCoordinator listens for requests for servers from masters */
+#define ENCODE_SERVER_COORDINATOR_PORT (Config::instance()->server_port_base()+6)
 
 typedef std::vector<std::shared_ptr<Content>> ContentList;
 typedef std::vector<std::shared_ptr<FFmpegContent>> FFmpegContentList;
@@ -145,5 +193,15 @@ enum class EmailProtocol {
 	SSL
 };
 
+/** Trade-off between quality and speed when resampling audio; these
+ *  correspond to libsamplerate's converters.
+ */
+enum class ResamplerQuality {
+	BEST,
+	MEDIUM,
+	FASTEST,
+	LINEAR
+};
+
 
 #endif
@@ -0,0 +1,255 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "compose.hpp"
+#include "dcpomatic_log.h"
+#include "signal_manager.h"
+#include "ui_watchdog.h"
+#ifdef DCPOMATIC_LINUX
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#endif
+#include <cstdlib>
+
+
+using std::max;
+using std::string;
+
+
+UIWatchdog* UIWatchdog::_instance = nullptr;
+boost::thread::id UIWatchdog::_ui_thread_id;
+std::atomic<char const*> UIWatchdog::_activity{nullptr};
+
+/** Interval between our checks on the UI thread, in milliseconds */
+static int const check_interval = 50;
+
+
+#ifdef DCPOMATIC_LINUX
+
+/* The UI thread's stack, written by a signal handler in that thread */
+static void* stall_stack[64];
+static std::atomic<int> stall_stack_depth{-1};
+
+static void
+capture_stack(int)
+{
+	stall_stack_depth = backtrace(stall_stack, sizeof(stall_stack) / sizeof(void*));
+}
+
+#endif
+
+
+UIWatchdog*
+UIWatchdog::instance()
+{
+	if (!_instance) {
+		_instance = new UIWatchdog();
+	}
+
+	return _instance;
+}
+
+
+void
+UIWatchdog::drop()
+{
+	delete _instance;
+	_instance = nullptr;
+}
+
+
+UIWatchdog::~UIWatchdog()
+{
+	stop();
+}
+
+
+void
+UIWatchdog::start(int threshold)
+{
+	if (_running) {
+		return;
+	}
+
+	_statistics = Statistics();
+	_statistics.limits = { 5, 10, 20, 50, 100, 250, 500, 1000, 2000, 5000 };
+	_statistics.counts.resize(_statistics.limits.size() + 1);
+	_threshold = threshold;
+	_stop = false;
+	_sent = boost::none;
+	_ui_thread_id = boost::this_thread::get_id();
+
+#ifdef DCPOMATIC_LINUX
+	_ui_thread = pthread_self();
+	/* The first call to backtrace() can allocate memory, which we must not do in a signal handler */
+	void* dummy[1];
+	backtrace(dummy, 1);
+	signal(SIGUSR2, capture_stack);
+#endif
+
+	_running = true;
+	_thread = boost::thread(boost::bind(&UIWatchdog::thread, this));
+}
+
+
+void
+UIWatchdog::stop()
+{
+	if (!_running) {
+		return;
+	}
+
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		_stop = true;
+		_condition.notify_all();
+	}
+
+	try {
+		_thread.join();
+	} catch (...) {}
+
+	_running = false;
+}
+
+
+void
+UIWatchdog::thread()
+{
+	while (true) {
+		boost::mutex::scoped_lock lm(_mutex);
+		if (_stop) {
+			break;
+		}
+
+		auto const now = Clock::now();
+		_statistics.deepest_queue = max(_statistics.deepest_queue, signal_manager->queue_depth());
+
+		if (!_sent) {
+			_sent = now;
+			_stall_reported = false;
+			auto const sent = now;
+			lm.unlock();
+			signal_manager->when_idle(boost::bind(&UIWatchdog::returned, this, sent));
+			signal_manager->wake_ui();
+			lm.lock();
+		} else if (!_stall_reported) {
+			auto const waiting = std::chrono::duration_cast<std::chrono::milliseconds>(now - *_sent).count();
+			if (waiting > _threshold) {
+				_stall_reported = true;
+				++_statistics.stalls;
+				lm.unlock();
+				report_stall(waiting);
+				lm.lock();
+			}
+		}
+
+		if (!_stop) {
+			_condition.timed_wait(lm, boost::posix_time::milliseconds(check_interval));
+		}
+	}
+}
+
+
+UIWatchdog::Statistics
+UIWatchdog::statistics() const
+{
+	boost::mutex::scoped_lock lm(_mutex);
+	return _statistics;
+}
+
+
+/** Called in the UI thread when it gets round to doing what we asked */
+void
+UIWatchdog::returned(Clock::time_point sent)
+{
+	auto const latency = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - sent).count());
+
+	boost::mutex::scoped_lock lm(_mutex);
+
+	size_t bucket = 0;
+	while (bucket < _statistics.limits.size() && latency >= _statistics.limits[bucket]) {
+		++bucket;
+	}
+	++_statistics.counts[bucket];
+	_statistics.longest = max(_statistics.longest, latency);
+
+	if (_stall_reported) {
+		LOG_WARNING("UI thread was blocked for %1ms", latency);
+	}
+
+	_sent = boost::none;
+}
+
+
+void
+UIWatchdog::report_stall(int milliseconds)
+{
+	auto activity = _activity.load();
+	LOG_WARNING("UI thread has been blocked for %1ms%2", milliseconds, activity ? String::compose(" in %1", activity) : string());
+
+#ifdef DCPOMATIC_LINUX
+	stall_stack_depth = -1;
+	if (pthread_kill(_ui_thread, SIGUSR2) != 0) {
+		return;
+	}
+
+	/* Give the UI thread a little while to notice the signal */
+	for (int i = 0; i < 20 && stall_stack_depth < 0; ++i) {
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	}
+
+	auto const depth = stall_stack_depth.load();
+	if (depth <= 0) {
+		return;
+	}
+
+	auto symbols = backtrace_symbols(stall_stack, depth);
+	if (!symbols) {
+		return;
+	}
+
+	/* Skip the frames for capture_stack() and the signal trampoline */
+	for (int i = 2; i < depth; ++i) {
+		LOG_WARNING("UI thread stack: %1", symbols[i]);
+	}
+	free(symbols);
+#endif
+}
+
+
+UIWatchdog::Activity::Activity(char const* name)
+	: _ui(boost::this_thread::get_id() == _ui_thread_id)
+{
+	if (_ui) {
+		_previous = _activity.exchange(name);
+	}
+}
+
+
+UIWatchdog::Activity::~Activity()
+{
+	if (_ui) {
+		_activity = _previous;
+	}
+}
@@ -0,0 +1,140 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  src/lib/ui_watchdog.h
+ *  @brief UIWatchdog class.
+ */
+
+
+#ifndef DCPOMATIC_UI_WATCHDOG_H
+#define DCPOMATIC_UI_WATCHDOG_H
+
+
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+
+/** @class UIWatchdog
+ *  @brief Measure how long it takes the UI thread to get round to things that
+ *  other threads ask it to do, and log what it was doing if it takes too long.
+ *
+ *  A thread of our own asks the UI thread (via signal_manager) to run a little
+ *  function every so often, and keeps a histogram of how long it takes for that
+ *  to happen.  If the UI thread is blocked for longer than a threshold we log what
+ *  UIWatchdog::Activity it is in and, on Linux, its stack.
+ */
+class UIWatchdog
+{
+public:
+	~UIWatchdog();
+
+	UIWatchdog(UIWatchdog const&) = delete;
+	UIWatchdog& operator=(UIWatchdog const&) = delete;
+
+	static UIWatchdog* instance();
+	static void drop();
+
+	/** Start watching.  Must be called from the UI thread after signal_manager has
+	 *  been created.
+	 *  @param threshold Time in milliseconds for which the UI thread must be blocked
+	 *  before we log it.
+	 */
+	void start(int threshold);
+	void stop();
+
+	bool running() const {
+		return _running;
+	}
+
+	struct Statistics
+	{
+		/** Upper limit of each bucket of the histogram in milliseconds; there is one more
+		 *  bucket after these for everything longer.
+		 */
+		std::vector<int> limits;
+		/** Number of measurements in each bucket */
+		std::vector<int64_t> counts;
+		/** Longest latency that has been seen, in milliseconds */
+		int longest = 0;
+		/** Largest number of things that we have seen waiting in signal_manager */
+		size_t deepest_queue = 0;
+		/** Number of times that the UI thread has been blocked for longer than the threshold */
+		int stalls = 0;
+	};
+
+	Statistics statistics() const;
+
+	/** Put one of these on the stack to describe what the UI thread is doing, so that
+	 *  the description can be logged if it stalls.  It does nothing in other threads.
+	 */
+	class Activity
+	{
+	public:
+		/** @param name Description, which must exist for as long as this object */
+		explicit Activity(char const* name);
+		~Activity();
+
+		Activity(Activity const&) = delete;
+		Activity& operator=(Activity const&) = delete;
+
+	private:
+		bool _ui = false;
+		char const* _previous = nullptr;
+	};
+
+private:
+	UIWatchdog() = default;
+
+	typedef std::chrono::steady_clock Clock;
+
+	void thread();
+	void returned(Clock::time_point sent);
+	void report_stall(int milliseconds);
+
+	mutable boost::mutex _mutex;
+	boost::condition _condition;
+	boost::thread _thread;
+	std::atomic<bool> _running{false};
+	bool _stop = false;
+	int _threshold = 500;
+	/** Time that we last asked the UI thread to do something, if it has not yet done it */
+	boost::optional<Clock::time_point> _sent;
+	/** true if we have already logged a stall while waiting for _sent to be done */
+	bool _stall_reported = false;
+	Statistics _statistics;
+#ifdef DCPOMATIC_LINUX
+	pthread_t _ui_thread;
+#endif
+
+	/** ID of the UI thread, set before we start watching */
+	static boost::thread::id _ui_thread_id;
+	static std::atomic<char const*> _activity;
+	static UIWatchdog* _instance;
+};
+
+
+#endif
@@ -26,9 +26,12 @@
 #include "i18n.h"
 
 
-using std::string;
-using std::shared_ptr;
 using std::function;
+using std::make_pair;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::vector;
 
 
 Uploader::Uploader (function<void (string)> set_status, function<void (float)> set_progress)
@@ -72,14 +75,35 @@ Uploader::upload_directory (boost::filesystem::path base, boost::filesystem::pat
 	using namespace boost::filesystem;
 
 	create_directory (remove_prefix(base, directory));
+
+	/* Send all the files in this directory together, so that uploaders can send more than one
+	   at once if they are able, then go into the sub-directories.
+	*/
+	vector<pair<path, path>> files;
+	vector<path> directories;
 	for (auto i: directory_iterator(directory)) {
 		if (is_directory(i.path())) {
-			upload_directory (base, i.path(), transferred, total_size);
+			directories.push_back (i.path());
 		} else {
-			_set_status(String::compose(_("copying %1"), i.path().filename()));
-			upload_file (i.path(), remove_prefix (base, i.path()), transferred, total_size);
+			files.push_back (make_pair(i.path(), remove_prefix(base, i.path())));
 		}
 	}
+
+	upload_files (files, transferred, total_size);
+
+	for (auto const& i: directories) {
+		upload_directory (base, i, transferred, total_size);
+	}
+}
+
+
+void
+Uploader::upload_files (vector<pair<boost::filesystem::path, boost::filesystem::path>> const& files, boost::uintmax_t& transferred, boost::uintmax_t total_size)
+{
+	for (auto const& file: files) {
+		_set_status(String::compose(_("copying %1"), file.first.filename()));
+		upload_file (file.first, file.second, transferred, total_size);
+	}
 }
 
 
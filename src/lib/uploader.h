@@ -24,6 +24,9 @@
 
 
 #include <boost/filesystem.hpp>
+#include <functional>
+#include <utility>
+#include <vector>
 
 
 class Job;
@@ -41,15 +44,18 @@ protected:
 
 	virtual void create_directory (boost::filesystem::path directory) = 0;
 	virtual void upload_file (boost::filesystem::path from, boost::filesystem::path to, boost::uintmax_t& transferred, boost::uintmax_t total_size) = 0;
+	/** Upload some files, each given as a (local path, remote path) pair.  This default implementation
+	 *  calls upload_file() for each one in turn.
+	 */
+	virtual void upload_files (std::vector<std::pair<boost::filesystem::path, boost::filesystem::path>> const& files, boost::uintmax_t& transferred, boost::uintmax_t total_size);
 
 	std::function<void (float)> _set_progress;
+	std::function<void (std::string)> _set_status;
 
 private:
 	void upload_directory (boost::filesystem::path base, boost::filesystem::path directory, boost::uintmax_t& transferred, boost::uintmax_t total_size);
 	boost::uintmax_t count_file_sizes (boost::filesystem::path) const;
 	boost::filesystem::path remove_prefix (boost::filesystem::path prefix, boost::filesystem::path target) const;
-
-	std::function<void (std::string)> _set_status;
 };
 
 #endif
@@ -38,6 +38,7 @@
 #include "digester.h"
 #include "exceptions.h"
 #include "ffmpeg_image_proxy.h"
+#include "file_log.h"
 #include "filter.h"
 #include "font.h"
 #include "image.h"
@@ -49,9 +50,11 @@
 #include "scope_guard.h"
 #include "string_text.h"
 #include "text_decoder.h"
+#include "trace.h"
 #include "util.h"
 #include "video_content.h"
 #include <dcp/atmos_asset.h>
+#include <dcp/certificate_chain.h>
 #include <dcp/decrypted_kdm.h>
 #include <dcp/file.h>
 #include <dcp/filesystem.h>
@@ -91,6 +94,7 @@ LIBDCP_ENABLE_WARNINGS
 #include <iostream>
 #include <fstream>
 #include <climits>
+#include <exception>
 #include <stdexcept>
 #ifdef DCPOMATIC_POSIX
 #include <execinfo.h>
@@ -254,6 +258,8 @@ LIBDCP_DISABLE_WARNINGS
 LONG WINAPI
 exception_handler(struct _EXCEPTION_POINTERS * info)
 {
+	FileLog::flush_all();
+
 	dcp::File f(backtrace_file, "w");
 	if (f) {
 		fprintf(f.get(), "C-style exception %d\n", info->ExceptionRecord->ExceptionCode);
@@ -339,9 +345,26 @@ terminate ()
 			  << std::endl;
 	}
 
+	FileLog::flush_all ();
 	abort();
 }
 
+
+#ifdef DCPOMATIC_POSIX
+/** Called when we get a signal that means that we are about to crash; write out
+ *  whatever we can of our logs, then carry on crashing.
+ */
+static
+void
+crash_signal_handler (int signal_number)
+{
+	FileLog::flush_all ();
+	signal (signal_number, SIG_DFL);
+	raise (signal_number);
+}
+#endif
+
+
 void
 dcpomatic_setup_path_encoding ()
 {
@@ -446,6 +469,12 @@ LIBDCP_ENABLE_WARNINGS
 
 	set_terminate (terminate);
 
+#ifdef DCPOMATIC_POSIX
+	for (auto signal_number: { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT }) {
+		signal (signal_number, crash_signal_handler);
+	}
+#endif
+
 #ifdef DCPOMATIC_WINDOWS
 	putenv ("PANGOCAIRO_BACKEND=fontconfig");
 	if (dcp::filesystem::exists(resources_path() / "fonts.conf")) {
@@ -602,6 +631,109 @@ simple_digest (vector<boost::filesystem::path> paths)
 }
 
 
+/** Call function(i) for each i from 0 to count - 1 using the given number of threads.  Any
+ *  exception thrown by function is re-thrown once all the threads have finished.
+ */
+static void
+parallel_for_with_threads (size_t count, size_t threads, std::function<void (size_t)> function)
+{
+	if (threads < 2) {
+		for (size_t i = 0; i < count; ++i) {
+			function (i);
+		}
+		return;
+	}
+
+	boost::mutex mutex;
+	std::exception_ptr exception;
+
+	boost::thread_group group;
+	for (size_t t = 0; t < threads; ++t) {
+		group.create_thread([t, threads, count, &function, &mutex, &exception]() {
+			try {
+				for (size_t i = t; i < count; i += threads) {
+					function (i);
+				}
+			} catch (...) {
+				boost::mutex::scoped_lock lm (mutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+			}
+		});
+	}
+
+	group.join_all ();
+
+	if (exception) {
+		std::rethrow_exception (exception);
+	}
+}
+
+
+/** Call function(i) for each i from 0 to count - 1.  If count is large the calls are
+ *  spread over some threads; this is meant for work which is mostly waiting for I/O
+ *  (like stat()ing lots of files) so it uses more threads than we have CPUs.  Any
+ *  exception thrown by function is re-thrown once all the threads have finished.
+ */
+void
+parallel_for (size_t count, std::function<void (size_t)> function)
+{
+	size_t constexpr threshold = 256;
+	size_t constexpr max_threads = 16;
+
+	parallel_for_with_threads (count, count < threshold ? 1 : std::min(max_threads, count / (threshold / 2)), function);
+}
+
+
+/** Call function(i) for each i from 0 to count - 1, with the calls spread over a thread
+ *  for each CPU.  This is meant for expensive calculations (like signing things).  Any
+ *  exception thrown by function is re-thrown once all the threads have finished.
+ */
+void
+parallel_for_cpu (size_t count, std::function<void (size_t)> function)
+{
+	parallel_for_with_threads (count, std::min(count, static_cast<size_t>(std::max(1U, boost::thread::hardware_concurrency()))), function);
+}
+
+
+/** Equivalent to chain->valid(reason) but the result is remembered (keyed on the chain's
+ *  certificates and private key) so that checking the same chain again is cheap.
+ *  This can be called from any thread.
+ */
+bool
+certificate_chain_valid (shared_ptr<const dcp::CertificateChain> chain, string* reason)
+{
+	static boost::mutex mutex;
+	/* Fingerprint (certificates and key) -> reason if the chain is invalid, or none if it is OK */
+	static map<string, optional<string>> cache;
+
+	auto const fingerprint = chain->chain() + chain->key().get_value_or("");
+
+	{
+		boost::mutex::scoped_lock lm (mutex);
+		auto iter = cache.find(fingerprint);
+		if (iter != cache.end()) {
+			if (iter->second && reason) {
+				*reason = *iter->second;
+			}
+			return !iter->second;
+		}
+	}
+
+	string why;
+	auto const valid = chain->valid(&why);
+
+	boost::mutex::scoped_lock lm (mutex);
+	cache[fingerprint] = valid ? optional<string>() : why;
+
+	if (!valid && reason) {
+		*reason = why;
+	}
+	return valid;
+}
+
+
 /** Trip an assert if the caller is not in the UI thread */
 void
 ensure_ui_thread ()
@@ -855,25 +987,7 @@ audio_channel_types (list<int> mapped, int channels)
 shared_ptr<AudioBuffers>
 remap (shared_ptr<const AudioBuffers> input, int output_channels, AudioMapping map)
 {
-	auto mapped = make_shared<AudioBuffers>(output_channels, input->frames());
-	mapped->make_silent ();
-
-	int to_do = min (map.input_channels(), input->channels());
-
-	for (int i = 0; i < to_do; ++i) {
-		for (int j = 0; j < mapped->channels(); ++j) {
-			if (map.get(i, j) > 0) {
-				mapped->accumulate_channel(
-					input.get(),
-					i,
-					j,
-					map.get(i, j)
-					);
-			}
-		}
-	}
-
-	return mapped;
+	return SparseAudioMapping(map, output_channels).run(input);
 }
 
 Eyes
@@ -1059,19 +1173,14 @@ default_font_file ()
 /* Set to 1 to print the IDs of some of our threads to stdout on creation */
 #define DCPOMATIC_DEBUG_THREADS 0
 
-#if DCPOMATIC_DEBUG_THREADS
 void
 start_of_thread (string name)
 {
+#if DCPOMATIC_DEBUG_THREADS
 	std::cout << "THREAD:" << name << ":" << std::hex << pthread_self() << "\n";
-}
-#else
-void
-start_of_thread (string)
-{
-
-}
 #endif
+	Trace::set_thread_name(name);
+}
 
 
 string
@@ -39,6 +39,7 @@
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
+#include <functional>
 #include <string>
 #include <map>
 #include <vector>
@@ -47,6 +48,7 @@
 
 
 namespace dcp {
+	class CertificateChain;
 	class PictureAsset;
 	class SoundAsset;
 	class SubtitleAsset;
@@ -67,6 +69,9 @@ extern void dcpomatic_setup_path_encoding ();
 extern void dcpomatic_setup_gettext_i18n (std::string);
 extern std::string digest_head_tail (std::vector<boost::filesystem::path>, boost::uintmax_t size);
 extern std::string simple_digest (std::vector<boost::filesystem::path> paths);
+extern void parallel_for (size_t count, std::function<void (size_t)> function);
+extern void parallel_for_cpu (size_t count, std::function<void (size_t)> function);
+extern bool certificate_chain_valid (std::shared_ptr<const dcp::CertificateChain> chain, std::string* reason = nullptr);
 extern void ensure_ui_thread ();
 extern std::string audio_channel_name (int);
 extern std::string short_audio_channel_name (int);
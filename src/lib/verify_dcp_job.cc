@@ -20,16 +20,32 @@
 
 
 #include "cross.h"
+#include "dcpomatic_log.h"
+#include "digester.h"
+#include "state.h"
 #include "verify_dcp_job.h"
 #include "content.h"
+#include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
+#include <dcp/version.h>
+#include <dcp/warnings.h>
+#include <libcxml/cxml.h>
+LIBDCP_DISABLE_WARNINGS
+#include <libxml++/libxml++.h>
+LIBDCP_ENABLE_WARNINGS
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <atomic>
 
 #include "i18n.h"
 
 
+using std::pair;
 using std::string;
 using std::vector;
 using std::shared_ptr;
 using boost::optional;
+using dcp::raw_convert;
 #if BOOST_VERSION >= 106100
 using namespace boost::placeholders;
 #endif
@@ -73,10 +89,274 @@ VerifyDCPJob::update_stage (string s, optional<boost::filesystem::path> path)
 }
 
 
+/** @return Key for the cached verification notes of a DCP directory; this changes if any file
+ *  in the directory is added, removed, resized or touched, or if libdcp (and hence what is checked) changes.
+ */
+static string
+cache_key (boost::filesystem::path directory)
+{
+	vector<pair<string, boost::filesystem::path>> files;
+	for (
+		auto i = dcp::filesystem::recursive_directory_iterator(directory);
+		i != dcp::filesystem::recursive_directory_iterator();
+		++i) {
+		if (dcp::filesystem::is_regular_file(i->path())) {
+			files.push_back({i->path().string().substr(directory.string().size()), i->path()});
+		}
+	}
+
+	/* Directory iteration order is not defined */
+	std::sort(files.begin(), files.end());
+
+	Digester digester;
+	digester.add(string(dcp::version));
+	digester.add(string(dcp::git_commit));
+	digester.add(directory.string());
+	for (auto const& i: files) {
+		digester.add(i.first);
+		digester.add(static_cast<uint64_t>(dcp::filesystem::file_size(i.second)));
+		digester.add(static_cast<int64_t>(dcp::filesystem::last_write_time(i.second)));
+	}
+	return digester.get();
+}
+
+
+static boost::filesystem::path
+cache_file (string key)
+{
+	return State::read_path("verifications") / (key + ".xml");
+}
+
+
+static dcp::VerificationNote
+note_from_xml (cxml::ConstNodePtr node)
+{
+	auto const type = static_cast<dcp::VerificationNote::Type>(node->number_child<int>("Type"));
+	auto const code = static_cast<dcp::VerificationNote::Code>(node->number_child<int>("Code"));
+	auto const text = node->optional_string_child("Note");
+	auto const file_name = node->optional_string_child("File");
+	auto const line = node->optional_number_child<uint64_t>("Line");
+
+	optional<boost::filesystem::path> file;
+	if (file_name) {
+		file = boost::filesystem::path(*file_name);
+	}
+
+	auto note = [&]() -> dcp::VerificationNote {
+		if (text && file && line) {
+			return dcp::VerificationNote(type, code, *text, *file, *line);
+		} else if (file && line) {
+			return dcp::VerificationNote(type, code, *file, *line);
+		} else if (text && file) {
+			return dcp::VerificationNote(type, code, *text, *file);
+		} else if (file) {
+			return dcp::VerificationNote(type, code, *file);
+		} else if (text) {
+			return dcp::VerificationNote(type, code, *text);
+		}
+		return dcp::VerificationNote(type, code);
+	}();
+
+	if (auto frame = node->optional_number_child<int>("Frame")) {
+		note.set_frame(*frame);
+	}
+	if (auto component = node->optional_number_child<int>("Component")) {
+		note.set_component(*component);
+	}
+	if (auto size = node->optional_number_child<int>("Size")) {
+		note.set_size(*size);
+	}
+	if (auto id = node->optional_string_child("Id")) {
+		note.set_id(*id);
+	}
+	if (auto other_id = node->optional_string_child("OtherId")) {
+		note.set_other_id(*other_id);
+	}
+
+	return note;
+}
+
+
+static void
+note_as_xml (dcp::VerificationNote const& note, xmlpp::Element* node)
+{
+	node->add_child("Type")->add_child_text(raw_convert<string>(static_cast<int>(note.type())));
+	node->add_child("Code")->add_child_text(raw_convert<string>(static_cast<int>(note.code())));
+	if (note.note()) {
+		node->add_child("Note")->add_child_text(*note.note());
+	}
+	if (note.file()) {
+		node->add_child("File")->add_child_text(note.file()->string());
+	}
+	if (note.line()) {
+		node->add_child("Line")->add_child_text(raw_convert<string>(*note.line()));
+	}
+	if (note.frame()) {
+		node->add_child("Frame")->add_child_text(raw_convert<string>(*note.frame()));
+	}
+	if (note.component()) {
+		node->add_child("Component")->add_child_text(raw_convert<string>(*note.component()));
+	}
+	if (note.size()) {
+		node->add_child("Size")->add_child_text(raw_convert<string>(*note.size()));
+	}
+	if (note.id()) {
+		node->add_child("Id")->add_child_text(*note.id());
+	}
+	if (note.other_id()) {
+		node->add_child("OtherId")->add_child_text(*note.other_id());
+	}
+}
+
+
+/** @return Notes previously stored with the given key, or an empty optional if there are none
+ *  (or they cannot be used).
+ */
+static optional<vector<dcp::VerificationNote>>
+notes_from_cache (string key)
+{
+	auto const file = cache_file(key);
+	if (!dcp::filesystem::exists(file)) {
+		return {};
+	}
+
+	try {
+		cxml::Document doc("Verification");
+		doc.read_file(dcp::filesystem::fix_long_path(file));
+		vector<dcp::VerificationNote> notes;
+		for (auto i: doc.node_children("Note")) {
+			notes.push_back(note_from_xml(i));
+		}
+		return notes;
+	} catch (std::exception& e) {
+		LOG_GENERAL("Could not read cached verification %1 (%2)", file.string(), e.what());
+	}
+
+	return {};
+}
+
+
+static void
+write_notes_to_cache (string key, vector<dcp::VerificationNote> const& notes)
+{
+	auto const dir = State::write_path("verifications");
+	boost::system::error_code ec;
+	dcp::filesystem::create_directories(dir, ec);
+
+	xmlpp::Document doc;
+	auto root = doc.create_root_node("Verification");
+	for (auto const& i: notes) {
+		note_as_xml(i, root->add_child("Note"));
+	}
+
+	auto const file = dir / (key + ".xml");
+	/* The same DCP may be verified by more than one job at once, so write to a unique
+	 * temporary name and then move it into place.
+	 */
+	auto const tmp = dir / (key + "." + boost::filesystem::unique_path().string() + ".tmp");
+
+	try {
+		doc.write_to_file_formatted(tmp.string());
+		dcp::filesystem::rename(tmp, file);
+	} catch (std::exception& e) {
+		/* Failing to cache is not fatal; the DCP will just be verified again next time */
+		LOG_WARNING("Could not write verification cache file %1 (%2)", file.string(), e.what());
+		dcp::filesystem::remove(tmp, ec);
+	}
+}
+
+
+void
+VerifyDCPJob::update_progress (size_t index, float progress)
+{
+	float total = 0;
+	{
+		boost::mutex::scoped_lock lm (_directory_progress_mutex);
+		_directory_progress[index] = progress;
+		for (auto i: _directory_progress) {
+			total += i;
+		}
+	}
+
+	set_progress (total / _directory_progress.size(), false);
+}
+
+
+vector<dcp::VerificationNote>
+VerifyDCPJob::verify_directory (size_t index)
+{
+	auto const& directory = _directories[index];
+
+	auto const key = cache_key(directory);
+	if (auto cached = notes_from_cache(key)) {
+		LOG_GENERAL("Using cached verification of %1", directory.string());
+		update_progress (index, 1);
+		return *cached;
+	}
+
+	auto notes = dcp::verify({directory}, bind(&VerifyDCPJob::update_stage, this, _1, _2), bind(&VerifyDCPJob::update_progress, this, index, _1), {}, libdcp_resources_path() / "xsd");
+	write_notes_to_cache(key, notes);
+	return notes;
+}
+
+
 void
 VerifyDCPJob::run ()
 {
-	_notes = dcp::verify(_directories, bind(&VerifyDCPJob::update_stage, this, _1, _2), bind(&VerifyDCPJob::set_progress, this, _1, false), {}, libdcp_resources_path() / "xsd");
+	_directory_progress.assign(_directories.size(), 0);
+
+	/* Each directory is verified on its own (references to assets in other directories
+	 * come out as EXTERNAL_ASSET notes just as they do when verifying them all together)
+	 * so the directories can be checked at the same time, and the results for any that
+	 * have not changed since they were last checked can be re-used.
+	 */
+	vector<vector<dcp::VerificationNote>> directory_notes(_directories.size());
+	std::atomic<size_t> next{0};
+	boost::mutex exception_mutex;
+	boost::exception_ptr exception;
+
+	auto worker = [this, &directory_notes, &next, &exception_mutex, &exception]() {
+		try {
+			while (true) {
+				size_t const index = next++;
+				if (index >= _directories.size()) {
+					break;
+				}
+				directory_notes[index] = verify_directory(index);
+			}
+		} catch (...) {
+			boost::mutex::scoped_lock lm (exception_mutex);
+			if (!exception) {
+				exception = boost::current_exception();
+			}
+			/* Stop the other workers picking up anything else */
+			next = _directories.size();
+		}
+	};
+
+	size_t const threads = std::max(std::min(_directories.size(), static_cast<size_t>(boost::thread::hardware_concurrency())), static_cast<size_t>(1));
+
+	boost::thread_group group;
+	for (size_t i = 0; i < threads; ++i) {
+		group.create_thread(worker);
+	}
+
+	try {
+		group.join_all ();
+	} catch (boost::thread_interrupted&) {
+		group.interrupt_all ();
+		group.join_all ();
+		throw;
+	}
+
+	if (exception) {
+		boost::rethrow_exception (exception);
+	}
+
+	_notes.clear ();
+	for (auto const& i: directory_notes) {
+		_notes.insert (_notes.end(), i.begin(), i.end());
+	}
 
 	bool failed = false;
 	for (auto i: _notes) {
@@ -21,6 +21,7 @@
 
 #include "job.h"
 #include <dcp/verify.h>
+#include <boost/thread/mutex.hpp>
 
 
 class Content;
@@ -36,13 +37,23 @@ public:
 	std::string json_name () const override;
 	void run () override;
 
+	Resource resource () const override {
+		return Resource::DISK;
+	}
+
 	std::vector<dcp::VerificationNote> notes () const {
 		return _notes;
 	}
 
 private:
 	void update_stage (std::string s, boost::optional<boost::filesystem::path> path);
+	void update_progress (size_t index, float progress);
+	std::vector<dcp::VerificationNote> verify_directory (size_t index);
 
 	std::vector<boost::filesystem::path> _directories;
 	std::vector<dcp::VerificationNote> _notes;
+
+	boost::mutex _directory_progress_mutex;
+	/** progress of each of _directories, protected by _directory_progress_mutex */
+	std::vector<float> _directory_progress;
 };
@@ -0,0 +1,213 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "dcpomatic_assert.h"
+#include "exceptions.h"
+#include "image.h"
+#include "video_complexity.h"
+#include <dcp/file.h>
+#include <dcp/filesystem.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+using std::max;
+using std::min;
+using std::shared_ptr;
+using std::vector;
+
+
+/* A video complexity file is:
+ *   8 bytes  binary_magic
+ *   uint32   _current_version
+ *   uint64   number of frames
+ *   for each frame: its complexity as a float
+ */
+int const VideoComplexity::_current_version = 1;
+static char const binary_magic[8] = { 'D', 'O', 'M', 'V', 'C', 'O', 'M', 'P' };
+
+/** Smallest and largest share of the average bandwidth that any frame will get, before
+ *  the shares are adjusted to make their average 1.
+ */
+static float const minimum_weight = 0.5;
+static float const maximum_weight = 1.5;
+
+
+VideoComplexity::VideoComplexity (boost::filesystem::path path)
+{
+	dcp::File f(path, "rb");
+	if (!f) {
+		throw OpenFileError(path, errno, OpenFileError::READ);
+	}
+
+	char magic[sizeof(binary_magic)];
+	f.checked_read(magic, sizeof(magic));
+	if (memcmp(magic, binary_magic, sizeof(magic)) != 0) {
+		throw FileError("Video complexity file is corrupt", path);
+	}
+
+	uint32_t version;
+	f.checked_read(&version, sizeof(version));
+	if (version != _current_version) {
+		throw OldFormatError("Video complexity file is an unknown version");
+	}
+
+	uint64_t frames;
+	f.checked_read(&frames, sizeof(frames));
+	_complexity.resize(frames);
+	if (frames) {
+		f.checked_read(_complexity.data(), frames * sizeof(float));
+	}
+}
+
+
+void
+VideoComplexity::add (Frame frame, float complexity)
+{
+	DCPOMATIC_ASSERT (frame >= 0);
+
+	if (frame >= static_cast<Frame>(_complexity.size())) {
+		/* Any frames that we are never told about will get the average share */
+		_complexity.resize(frame + 1, -1);
+	}
+
+	_complexity[frame] = complexity;
+	_weights.clear();
+}
+
+
+void
+VideoComplexity::write (boost::filesystem::path path) const
+{
+	auto tmp = path;
+	tmp += ".tmp";
+
+	{
+		dcp::File f(tmp, "wb");
+		if (!f) {
+			throw OpenFileError(tmp, errno, OpenFileError::WRITE);
+		}
+
+		f.checked_write(binary_magic, sizeof(binary_magic));
+		uint32_t const version = _current_version;
+		f.checked_write(&version, sizeof(version));
+		uint64_t const frames = _complexity.size();
+		f.checked_write(&frames, sizeof(frames));
+		if (frames) {
+			f.checked_write(_complexity.data(), frames * sizeof(float));
+		}
+	}
+
+	dcp::filesystem::rename(tmp, path);
+}
+
+
+void
+VideoComplexity::compute_weights () const
+{
+	double total = 0;
+	int known = 0;
+	for (auto i: _complexity) {
+		if (i >= 0) {
+			total += i;
+			++known;
+		}
+	}
+
+	/* Add 1 to everything so that black frames don't give us divisions by zero */
+	auto const mean = known ? (total / known + 1) : 1;
+
+	_weights.resize(_complexity.size());
+	double total_weight = 0;
+	for (size_t i = 0; i < _complexity.size(); ++i) {
+		if (_complexity[i] < 0) {
+			_weights[i] = 1;
+		} else {
+			/* Using the square root means that detailed frames do not take too much from everything else */
+			_weights[i] = min(maximum_weight, max(minimum_weight, static_cast<float>(std::sqrt((_complexity[i] + 1) / mean))));
+		}
+		total_weight += _weights[i];
+	}
+
+	if (total_weight > 0) {
+		auto const scale = _weights.size() / total_weight;
+		for (auto& i: _weights) {
+			i *= scale;
+		}
+	}
+}
+
+
+/** @param frame DCP frame index.
+ *  @param average J2K bandwidth that the film's frames should have on average, in bits per second.
+ *  @param maximum Largest J2K bandwidth that any frame should have, in bits per second; if this is
+ *  less than average, average will be used instead.
+ *  @return J2K bandwidth to use for the frame, in bits per second.
+ *
+ *  This is not thread-safe.
+ */
+int
+VideoComplexity::j2k_bandwidth (Frame frame, int average, int maximum) const
+{
+	if (frame < 0 || frame >= static_cast<Frame>(_complexity.size())) {
+		return average;
+	}
+
+	if (_weights.empty()) {
+		compute_weights();
+	}
+
+	return min(static_cast<int>(std::lrint(average * static_cast<double>(_weights[frame]))), max(average, maximum));
+}
+
+
+/** @param image An image in AV_PIX_FMT_RGB24.
+ *  @return A measure of how much detail the image has, which is 0 for a flat image.
+ */
+float
+VideoComplexity::measure (shared_ptr<const Image> image)
+{
+	DCPOMATIC_ASSERT (image->pixel_format() == AV_PIX_FMT_RGB24);
+
+	auto const size = image->size();
+	if (size.width < 2 || size.height < 2) {
+		return 0;
+	}
+
+	/* Sum the differences between each pixel and the ones to its right and below it,
+	 * looking at every other line to save a little time.
+	 */
+	uint64_t total = 0;
+	int lines = 0;
+	for (int y = 0; y < size.height - 1; y += 2) {
+		auto p = image->data()[0] + y * image->stride()[0];
+		auto q = p + image->stride()[0];
+		for (int x = 0; x < (size.width - 1) * 3; ++x) {
+			total += std::abs(p[x] - p[x + 3]) + std::abs(p[x] - q[x]);
+		}
+		++lines;
+	}
+
+	return total / (static_cast<double>(lines) * (size.width - 1) * 3);
+}
@@ -0,0 +1,80 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/lib/video_complexity.h
+ *  @brief VideoComplexity class.
+ */
+
+
+#ifndef DCPOMATIC_VIDEO_COMPLEXITY_H
+#define DCPOMATIC_VIDEO_COMPLEXITY_H
+
+
+#include "types.h"
+#include <boost/filesystem.hpp>
+#include <memory>
+#include <vector>
+
+
+class Image;
+
+
+/** @class VideoComplexity
+ *  @brief A measure of how detailed each frame of a film's video is, used to share
+ *  the film's J2K bandwidth between frames.
+ *
+ *  Frames that are more complex than average are given more than the film's J2K bandwidth,
+ *  and simpler ones less, so that the average over the whole film stays the same.
+ */
+class VideoComplexity
+{
+public:
+	VideoComplexity () = default;
+	explicit VideoComplexity (boost::filesystem::path path);
+
+	/** Set the complexity of a frame, as a value from measure() */
+	void add (Frame frame, float complexity);
+	void write (boost::filesystem::path path) const;
+
+	/** @return The number of frames that we know about */
+	Frame frames () const {
+		return _complexity.size();
+	}
+
+	int j2k_bandwidth (Frame frame, int average, int maximum) const;
+
+	static float measure (std::shared_ptr<const Image> image);
+
+private:
+	void compute_weights () const;
+
+	/** Complexity of each frame, indexed by DCP frame */
+	std::vector<float> _complexity;
+	/** Share of the average bandwidth that each frame should get, or empty if it needs to be recomputed */
+	mutable std::vector<float> _weights;
+
+	static int const _current_version;
+};
+
+
+#endif
@@ -51,11 +51,14 @@ VideoFilterGraph::VideoFilterGraph (dcp::Size s, AVPixelFormat p, dcp::Fraction
 }
 
 
+/** @param alignment Alignment for the output images; asking for whatever the consumer
+ *  of the images needs saves a copy later on.
+ */
 list<shared_ptr<const Image>>
-VideoFilterGraph::process(shared_ptr<const Image> image)
+VideoFilterGraph::process(shared_ptr<const Image> image, Image::Alignment alignment)
 {
 	if (_copy) {
-		return { image };
+		return { Image::ensure_alignment(image, alignment) };
 	}
 
 	auto frame = av_frame_alloc();
@@ -86,7 +89,7 @@ VideoFilterGraph::process(shared_ptr<const Image> image)
 			break;
 		}
 
-		images.push_back(make_shared<Image>(_frame, Image::Alignment::PADDED));
+		images.push_back(make_shared<Image>(_frame, alignment));
 		av_frame_unref (_frame);
 	}
 
@@ -20,6 +20,7 @@
 
 
 #include "filter_graph.h"
+#include "image.h"
 
 
 class VideoFilterGraph : public FilterGraph
@@ -29,7 +30,7 @@ public:
 
 	bool can_process (dcp::Size s, AVPixelFormat p) const;
 	std::list<std::pair<std::shared_ptr<const Image>, int64_t>> process (AVFrame * frame);
-	std::list<std::shared_ptr<const Image>> process(std::shared_ptr<const Image> image);
+	std::list<std::shared_ptr<const Image>> process(std::shared_ptr<const Image> image, Image::Alignment alignment = Image::Alignment::PADDED);
 
 protected:
 	std::string src_parameters () const override;
@@ -20,43 +20,148 @@
 
 
 #include "dcpomatic_log.h"
+#include "filter.h"
 #include "video_filter_graph.h"
 #include "video_filter_graph_set.h"
+#include <dcp/raw_convert.h>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <list>
 
 #include "i18n.h"
 
 
+using std::list;
+using std::make_pair;
 using std::make_shared;
+using std::pair;
 using std::shared_ptr;
+using std::string;
+using std::vector;
+
+
+/** Spare graphs left over by VideoFilterGraphSets that have been destroyed, so that a new set
+ *  for the same filters (such as one made when the player re-creates its decoders) can use
+ *  them rather than setting up its own.
+ */
+class SpareVideoFilterGraphs
+{
+public:
+	void put(string key, shared_ptr<VideoFilterGraph> graph)
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		_graphs.push_front(make_pair(key, graph));
+		while (_graphs.size() > max_graphs) {
+			_graphs.pop_back();
+		}
+	}
+
+	shared_ptr<VideoFilterGraph> take(string key, dcp::Size size, AVPixelFormat format)
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		auto i = std::find_if(_graphs.begin(), _graphs.end(), [key, size, format](pair<string, shared_ptr<VideoFilterGraph>> const& g) {
+			return g.first == key && g.second->can_process(size, format);
+		});
+		if (i == _graphs.end()) {
+			return {};
+		}
+		auto graph = i->second;
+		_graphs.erase(i);
+		return graph;
+	}
+
+private:
+	static size_t constexpr max_graphs = 8;
+
+	boost::mutex _mutex;
+	/** Key and graph, most-recently added first */
+	list<pair<string, shared_ptr<VideoFilterGraph>>> _graphs;
+};
+
+
+static SpareVideoFilterGraphs spare_graphs;
+
+
+VideoFilterGraphSet::VideoFilterGraphSet(vector<Filter const*> filters, dcp::Fraction frame_rate)
+	: _filters(filters)
+	, _frame_rate(frame_rate)
+	, _key(Filter::ffmpeg_string(filters) + "/" + dcp::raw_convert<string>(frame_rate.numerator) + "/" + dcp::raw_convert<string>(frame_rate.denominator))
+{
+
+}
+
+
+VideoFilterGraphSet::~VideoFilterGraphSet()
+{
+	for (auto graph: _spares) {
+		spare_graphs.put(_key, graph);
+	}
+}
+
+
+shared_ptr<VideoFilterGraph>
+VideoFilterGraphSet::make(dcp::Size size, AVPixelFormat format) const
+{
+	auto graph = make_shared<VideoFilterGraph>(size, format, _frame_rate);
+	graph->setup(_filters);
+
+	LOG_GENERAL(N_("New graph for %1x%2, pixel format %3"), size.width, size.height, static_cast<int>(format));
+
+	return graph;
+}
 
 
 shared_ptr<VideoFilterGraph>
 VideoFilterGraphSet::get(dcp::Size size, AVPixelFormat format)
 {
-	auto graph = std::find_if(
-		_graphs.begin(),
-		_graphs.end(),
-		[size, format](shared_ptr<VideoFilterGraph> g) {
-			return g->can_process(size, format);
-		});
+	auto can_process = [size, format](shared_ptr<VideoFilterGraph> g) {
+		return g->can_process(size, format);
+	};
 
+	auto graph = std::find_if(_graphs.begin(), _graphs.end(), can_process);
 	if (graph != _graphs.end()) {
+		if (_spare_wanted) {
+			/* We have already given out the graph for the first frame after a seek, so now
+			 * we can make the spare that will be used after the next one.
+			 */
+			_spares.push_back(make(_spare_wanted->first, _spare_wanted->second));
+			_spare_wanted = boost::none;
+		}
 		return *graph;
 	}
 
-	auto new_graph = make_shared<VideoFilterGraph>(size, format, _frame_rate);
-	new_graph->setup(_filters);
+	shared_ptr<VideoFilterGraph> new_graph;
+	auto spare = std::find_if(_spares.begin(), _spares.end(), can_process);
+	if (spare != _spares.end()) {
+		new_graph = *spare;
+		_spares.erase(spare);
+	} else {
+		new_graph = spare_graphs.take(_key, size, format);
+	}
+
+	if (!new_graph) {
+		new_graph = make(size, format);
+	}
+
 	_graphs.push_back(new_graph);
 
-	LOG_GENERAL(N_("New graph for %1x%2, pixel format %3"), size.width, size.height, static_cast<int>(format));
+	if (_cleared && !new_graph->copy()) {
+		_spare_wanted = make_pair(size, format);
+	}
 
 	return new_graph;
 }
 
 
+/** Remove any graphs which may hold frames that were given to them before now (for example,
+ *  before a seek).  Graphs without filters have no such state and are kept.
+ */
 void
 VideoFilterGraphSet::clear()
 {
-	_graphs.clear();
+	_cleared = true;
+	_graphs.erase(
+		std::remove_if(_graphs.begin(), _graphs.end(), [](shared_ptr<VideoFilterGraph> g) { return !g->copy(); }),
+		_graphs.end()
+		);
 }
-
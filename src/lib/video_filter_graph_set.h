@@ -27,7 +27,9 @@
 extern "C" {
 #include <libavutil/avutil.h>
 }
+#include <boost/optional.hpp>
 #include <memory>
+#include <string>
 #include <vector>
 
 
@@ -38,10 +40,8 @@ class VideoFilterGraph;
 class VideoFilterGraphSet
 {
 public:
-	VideoFilterGraphSet(std::vector<Filter const*> filters, dcp::Fraction frame_rate)
-		: _filters(filters)
-		, _frame_rate(frame_rate)
-	{}
+	VideoFilterGraphSet(std::vector<Filter const*> filters, dcp::Fraction frame_rate);
+	~VideoFilterGraphSet();
 
 	VideoFilterGraphSet(VideoFilterGraphSet const&) = delete;
 	VideoFilterGraphSet& operator=(VideoFilterGraphSet const&) = delete;
@@ -51,9 +51,23 @@ public:
 	void clear();
 
 private:
+	std::shared_ptr<VideoFilterGraph> make(dcp::Size size, AVPixelFormat format) const;
+
 	std::vector<Filter const*> _filters;
 	dcp::Fraction _frame_rate;
+	/** Description of our filters and frame rate, so that spare graphs can be shared between sets
+	 *  which would make the same graphs.
+	 */
+	std::string _key;
 	std::vector<std::shared_ptr<VideoFilterGraph>> _graphs;
+	/** Graphs which are set up but have not been used, ready to replace a graph in _graphs
+	 *  when clear() has removed it.
+	 */
+	std::vector<std::shared_ptr<VideoFilterGraph>> _spares;
+	/** Size and format of a spare graph that we should make when we next have time */
+	boost::optional<std::pair<dcp::Size, AVPixelFormat>> _spare_wanted;
+	/** true if clear() has been called, which suggests that we are being seeked and that spares are worth making */
+	bool _cleared = false;
 };
 
 
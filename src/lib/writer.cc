@@ -28,20 +28,26 @@
 #include "dcp_content_type.h"
 #include "dcp_video.h"
 #include "dcpomatic_log.h"
+#include "digester.h"
 #include "film.h"
 #include "film_util.h"
 #include "job.h"
 #include "log.h"
 #include "ratio.h"
 #include "reel_writer.h"
+#include "serial_worker.h"
+#include "spill_journal.h"
 #include "text_content.h"
+#include "trace.h"
 #include "util.h"
 #include "version.h"
 #include "writer.h"
 #include <dcp/cpl.h>
+#include <dcp/filesystem.h>
 #include <dcp/locale_convert.h>
 #include <dcp/raw_convert.h>
 #include <dcp/reel_file_asset.h>
+#include <algorithm>
 #include <cerrno>
 #include <cfloat>
 #include <set>
@@ -58,6 +64,7 @@ using std::dynamic_pointer_cast;
 using std::make_shared;
 using std::max;
 using std::min;
+using std::pair;
 using std::shared_ptr;
 using std::set;
 using std::string;
@@ -79,7 +86,7 @@ Writer::Writer(weak_ptr<const Film> weak_film, weak_ptr<Job> weak_job, bool text
 	: WeakConstFilm (weak_film)
 	, _job(weak_job)
 	/* These will be reset to sensible values when J2KEncoder is created */
-	, _maximum_frames_in_memory (8)
+	, _maximum_bytes_in_memory (static_cast<size_t>(Config::instance()->writer_memory_limit()) * 1024 * 1024)
 	, _maximum_queue_size (8)
 	, _text_only (text_only)
 {
@@ -105,7 +112,7 @@ Writer::Writer(weak_ptr<const Film> weak_film, weak_ptr<Job> weak_job, bool text
 
 	/* Check that the signer is OK */
 	string reason;
-	if (!Config::instance()->signer_chain()->valid(&reason)) {
+	if (!certificate_chain_valid(Config::instance()->signer_chain(), &reason)) {
 		throw InvalidSignerError (reason);
 	}
 }
@@ -119,6 +126,9 @@ Writer::start ()
 #ifdef DCPOMATIC_LINUX
 		pthread_setname_np (_thread.native_handle(), "writer");
 #endif
+		/* Enough that a short stall in writing either of these need not hold up the caller */
+		_sound_worker.reset(new SerialWorker("writer-sound", 64));
+		_atmos_worker.reset(new SerialWorker("writer-atmos", 128));
 	}
 }
 
@@ -128,6 +138,9 @@ Writer::~Writer ()
 	if (!_text_only) {
 		terminate_thread (false);
 	}
+
+	_stop_early_digests = true;
+	_early_digests.wait ();
 }
 
 
@@ -138,11 +151,11 @@ Writer::~Writer ()
  *  @param eyes Eyes that this frame image is for.
  */
 void
-Writer::write (shared_ptr<const Data> encoded, Frame frame, Eyes eyes)
+Writer::write (shared_ptr<const Data> encoded, Frame frame, Eyes eyes, optional<string> hash)
 {
 	boost::mutex::scoped_lock lock (_state_mutex);
 
-	while (_queued_full_in_memory > _maximum_frames_in_memory) {
+	while (_queued_full_bytes > _maximum_bytes_in_memory) {
 		/* There are too many full frames in memory; wake the main writer thread and
 		   wait until it sorts everything out */
 		_empty_condition.notify_all ();
@@ -152,6 +165,7 @@ Writer::write (shared_ptr<const Data> encoded, Frame frame, Eyes eyes)
 	QueueItem qi;
 	qi.type = QueueItem::Type::FULL;
 	qi.encoded = encoded;
+	qi.hash = hash;
 	qi.reel = video_reel (frame);
 	qi.frame = frame - _reels[qi.reel].start ();
 
@@ -160,6 +174,7 @@ Writer::write (shared_ptr<const Data> encoded, Frame frame, Eyes eyes)
 	qi.eyes = eyes;
 	_queue.push_back(qi);
 	++_queued_full_in_memory;
+	_queued_full_bytes += encoded->size();
 
 	/* Now there's something to do: wake anything wait()ing on _empty_condition */
 	_empty_condition.notify_all ();
@@ -255,6 +270,18 @@ Writer::write (shared_ptr<const AudioBuffers> audio, DCPTime const time)
 {
 	DCPOMATIC_ASSERT (audio);
 
+	if (_sound_worker) {
+		_sound_worker->submit([this, audio, time]() { write_sound(audio, time); });
+	} else {
+		write_sound (audio, time);
+	}
+}
+
+
+/** Called in the sound worker's thread (if there is one) to write audio to the reels */
+void
+Writer::write_sound (shared_ptr<const AudioBuffers> audio, DCPTime const time)
+{
 	int const afr = film()->audio_frame_rate();
 
 	DCPTime const end = time + DCPTime::from_frames(audio->frames(), afr);
@@ -311,6 +338,18 @@ Writer::write (shared_ptr<const AudioBuffers> audio, DCPTime const time)
 
 void
 Writer::write (shared_ptr<const dcp::AtmosFrame> atmos, DCPTime time, AtmosMetadata metadata)
+{
+	if (_atmos_worker) {
+		_atmos_worker->submit([this, atmos, time, metadata]() { write_atmos(atmos, time, metadata); });
+	} else {
+		write_atmos (atmos, time, metadata);
+	}
+}
+
+
+/** Called in the Atmos worker's thread (if there is one) to write Atmos to the reels */
+void
+Writer::write_atmos (shared_ptr<const dcp::AtmosFrame> atmos, DCPTime time, AtmosMetadata metadata)
 {
 	if (_atmos_reel->period().to == time) {
 		++_atmos_reel;
@@ -372,21 +411,26 @@ try
 {
 	start_of_thread ("Writer");
 
+	/* Index of the reel whose picture we are currently writing */
+	size_t picture_reel = 0;
+
 	while (true)
 	{
 		boost::mutex::scoped_lock lock (_state_mutex);
 
 		while (true) {
 
-			if (_finish || _queued_full_in_memory > _maximum_frames_in_memory || have_sequenced_image_at_queue_head ()) {
+			if (_finish || _queued_full_bytes > _maximum_bytes_in_memory || have_sequenced_image_at_queue_head ()) {
 				/* We've got something to do: go and do it */
 				break;
 			}
 
 			/* Nothing to do: wait until something happens which may indicate that we do */
 			LOG_TIMING (N_("writer-sleep queue=%1"), _queue.size());
+			TraceSpan span("wait-for-frame", "writer");
 			_empty_condition.wait (lock);
 			LOG_TIMING (N_("writer-wake queue=%1"), _queue.size());
+			Trace::counter("writer-queue", _queue.size());
 		}
 
 		/* We stop here if we have been asked to finish, and if either the queue
@@ -416,19 +460,29 @@ try
 			_queue.pop_front ();
 			if (qi.type == QueueItem::Type::FULL && qi.encoded) {
 				--_queued_full_in_memory;
+				_queued_full_bytes -= qi.encoded->size();
 			}
 
 			lock.unlock ();
 
+			/* Frames are written in order, so once we move on to a new reel the
+			   pictures of all the earlier ones are complete.
+			*/
+			for (; picture_reel < qi.reel; ++picture_reel) {
+				picture_finished (picture_reel);
+			}
+
 			auto& reel = _reels[qi.reel];
 
+			TraceSpan span("write", "writer");
 			switch (qi.type) {
 			case QueueItem::Type::FULL:
 				LOG_DEBUG_ENCODE (N_("Writer FULL-writes %1 (%2)"), qi.frame, (int) qi.eyes);
 				if (!qi.encoded) {
-					qi.encoded.reset (new ArrayData(film()->j2c_path(qi.reel, qi.frame, qi.eyes, false)));
+					qi.encoded = _spill_journal->read(qi.reel, qi.frame, qi.eyes);
+					++_read_back_from_disk;
 				}
-				reel.write (qi.encoded, qi.frame, qi.eyes);
+				reel.write (qi.encoded, qi.frame, qi.eyes, qi.hash);
 				++_full_written;
 				break;
 			case QueueItem::Type::FAKE:
@@ -447,8 +501,8 @@ try
 			_full_condition.notify_all ();
 		}
 
-		while (_queued_full_in_memory > _maximum_frames_in_memory) {
-			/* Too many frames in memory which can't yet be written to the stream.
+		while (_queued_full_bytes > _maximum_bytes_in_memory) {
+			/* Too much frame data in memory which can't yet be written to the stream.
 			   Write some FULL frames to disk.
 			*/
 
@@ -463,6 +517,8 @@ try
 			++_pushed_to_disk;
 			/* For the log message below */
 			int const awaiting = _last_written[_queue.front().reel].frame() + 1;
+			int const in_memory = _queued_full_in_memory;
+			auto const bytes_in_memory = _queued_full_bytes;
 			lock.unlock ();
 
 			/* i is valid here, even though we don't hold a lock on the mutex,
@@ -470,14 +526,15 @@ try
 			   thread could erase the last item in the list.
 			*/
 
-			LOG_GENERAL("Writer full; pushes %1 to disk while awaiting %2", item->frame, awaiting);
+			LOG_GENERAL("Writer full (%1 frames, %2MB); pushes %3 to disk while awaiting %4", in_memory, bytes_in_memory / 1048576, item->frame, awaiting);
 
-			item->encoded->write_via_temp(
-				film()->j2c_path(item->reel, item->frame, item->eyes, true),
-				film()->j2c_path(item->reel, item->frame, item->eyes, false)
-				);
+			if (!_spill_journal) {
+				_spill_journal.reset(new SpillJournal(film()->spill_journal_path()));
+			}
+			_spill_journal->write(item->reel, item->frame, item->eyes, *item->encoded);
 
 			lock.lock ();
+			_queued_full_bytes -= item->encoded->size();
 			item->encoded.reset();
 			--_queued_full_in_memory;
 			_full_condition.notify_all ();
@@ -540,10 +597,54 @@ Writer::calculate_digests ()
 		};
 	}
 
-	for (auto& i: _reels) {
-		service.post (boost::bind (&ReelWriter::calculate_digests, &i, set_progress));
+	/* Hash each asset as a separate job, so that we can hash the assets within a reel in parallel
+	 * as well as the reels themselves.
+	 */
+	vector<pair<shared_ptr<dcp::Asset>, shared_ptr<dcp::ReelFileAsset>>> assets;
+	for (auto const& reel: _reels) {
+		for (auto asset: reel.assets_needing_digests()) {
+			assets.push_back({asset, {}});
+		}
+	}
+	/* Any referenced MXF assets which do not already have a hash */
+	for (auto const& i: _reel_assets) {
+		auto file = dynamic_pointer_cast<dcp::ReelFileAsset>(i.asset);
+		if (file && !file->hash()) {
+			assets.push_back({file->asset_ref().asset(), file});
+		}
+	}
+
+	/* Start with the biggest so that we don't end up waiting for one big asset at the end */
+	auto size = [](shared_ptr<dcp::Asset> asset) -> uintmax_t {
+		try {
+			return asset->file() ? dcp::filesystem::file_size(*asset->file()) : 0;
+		} catch (...) {
+			return 0;
+		}
+	};
+	std::stable_sort(assets.begin(), assets.end(), [size](pair<shared_ptr<dcp::Asset>, shared_ptr<dcp::ReelFileAsset>> const& a, pair<shared_ptr<dcp::Asset>, shared_ptr<dcp::ReelFileAsset>> const& b) {
+		return size(a.first) > size(b.first);
+	});
+
+	for (auto const& asset: assets) {
+		service.post ([asset, set_progress]() {
+			try {
+				TraceSpan span("digest", "digest");
+				if (asset.first->file()) {
+					asset.first->set_hash (sha1_digest_file(*asset.first->file(), set_progress));
+				} else {
+					asset.first->hash (set_progress);
+				}
+				if (asset.second) {
+					asset.second->set_hash (asset.first->hash());
+				}
+			} catch (boost::thread_interrupted) {
+				/* set_progress contains an interruption_point, so hash() may throw
+				 * thread_interrupted, at which point we just give up.
+				 */
+			}
+		});
 	}
-	service.post (boost::bind (&Writer::calculate_referenced_digests, this, set_progress));
 
 	work.reset ();
 
@@ -561,6 +662,40 @@ Writer::calculate_digests ()
 }
 
 
+/** Called in our thread when the picture asset of a reel is complete, so that it can be
+ *  finished and its digest calculated while we get on with the later reels.
+ */
+void
+Writer::picture_finished (size_t reel_index)
+{
+	auto& reel = _reels[reel_index];
+	reel.finish_picture ();
+
+	auto const file = reel.picture_asset_file();
+	if (!file) {
+		return;
+	}
+
+	LOG_GENERAL("Calculating digest of reel %1 picture early", reel_index);
+
+	auto file_path = *file;
+	_early_digests.submit([this, &reel, file_path]() {
+		try {
+			TraceSpan span("early-digest", "digest");
+			reel.set_picture_digest(
+				sha1_digest_file(file_path, [this](float) {
+					if (_stop_early_digests) {
+						throw boost::thread_interrupted();
+					}
+				})
+			);
+		} catch (...) {
+			/* calculate_digests() will do it instead */
+		}
+	});
+}
+
+
 /** @param output_dcp Path to DCP folder to write */
 void
 Writer::finish (boost::filesystem::path output_dcp)
@@ -570,6 +705,17 @@ Writer::finish (boost::filesystem::path output_dcp)
 		terminate_thread (true);
 	}
 
+	if (_sound_worker) {
+		_sound_worker->finish ();
+	}
+
+	if (_atmos_worker) {
+		_atmos_worker->finish ();
+	}
+
+	/* Don't stop these, as we need them now */
+	_early_digests.wait ();
+
 	LOG_GENERAL_NC ("Finishing ReelWriters");
 
 	for (auto& reel: _reels) {
@@ -682,7 +828,7 @@ Writer::finish (boost::filesystem::path output_dcp)
 	auto signer = Config::instance()->signer_chain();
 	/* We did check earlier, but check again here to be on the safe side */
 	string reason;
-	if (!signer->valid (&reason)) {
+	if (!certificate_chain_valid(signer, &reason)) {
 		throw InvalidSignerError (reason);
 	}
 
@@ -693,7 +839,7 @@ Writer::finish (boost::filesystem::path output_dcp)
 	dcp.write_xml(signer, !film()->limit_to_smpte_bv20(), Config::instance()->dcp_metadata_filename_format());
 
 	LOG_GENERAL (
-		N_("Wrote %1 FULL, %2 FAKE, %3 REPEAT, %4 pushed to disk"), _full_written, _fake_written, _repeat_written, _pushed_to_disk
+		N_("Wrote %1 FULL, %2 FAKE, %3 REPEAT, %4 pushed to disk, %5 read back from disk"), _full_written.load(), _fake_written.load(), _repeat_written.load(), _pushed_to_disk.load(), _read_back_from_disk.load()
 		);
 
 	write_cover_sheet (output_dcp);
@@ -907,12 +1053,42 @@ operator== (QueueItem const & a, QueueItem const & b)
 void
 Writer::set_encoder_threads (int threads)
 {
+	/* Allow at least frames_in_memory_multiplier frames per thread of a typically-sized frame,
+	 * and more if the configured memory limit is higher than that.
+	 */
+	auto const frame_bytes = static_cast<size_t>(film()->j2k_bandwidth() / 8 / film()->video_frame_rate());
+	auto const minimum = static_cast<size_t>(lrint(threads * Config::instance()->frames_in_memory_multiplier())) * frame_bytes;
+	auto const limit = static_cast<size_t>(Config::instance()->writer_memory_limit()) * 1024 * 1024;
+
 	boost::mutex::scoped_lock lm (_state_mutex);
-	_maximum_frames_in_memory = lrint (threads * Config::instance()->frames_in_memory_multiplier());
+	_maximum_bytes_in_memory = max(minimum, limit);
 	_maximum_queue_size = threads * 16;
 }
 
 
+vector<Metric>
+Writer::metrics () const
+{
+	vector<Metric> metrics;
+
+	{
+		boost::mutex::scoped_lock lm (_state_mutex);
+		metrics.emplace_back("writer_queue_length", _queue.size());
+		metrics.emplace_back("writer_frames_in_memory", _queued_full_in_memory);
+		metrics.emplace_back("writer_bytes_in_memory", _queued_full_bytes);
+		metrics.emplace_back("writer_maximum_bytes_in_memory", _maximum_bytes_in_memory);
+	}
+
+	metrics.emplace_back("writer_full_frames_written", _full_written.load());
+	metrics.emplace_back("writer_fake_frames_written", _fake_written.load());
+	metrics.emplace_back("writer_repeat_frames_written", _repeat_written.load());
+	metrics.emplace_back("writer_frames_pushed_to_disk", _pushed_to_disk.load());
+	metrics.emplace_back("writer_frames_read_back_from_disk", _read_back_from_disk.load());
+
+	return metrics;
+}
+
+
 void
 Writer::write (ReferencedReelAsset asset)
 {
@@ -954,25 +1130,6 @@ Writer::set_digest_progress (Job* job, float progress)
 }
 
 
-/** Calculate hashes for any referenced MXF assets which do not already have one */
-void
-Writer::calculate_referenced_digests (std::function<void (float)> set_progress)
-try
-{
-	for (auto const& i: _reel_assets) {
-		auto file = dynamic_pointer_cast<dcp::ReelFileAsset>(i.asset);
-		if (file && !file->hash()) {
-			file->asset_ref().asset()->hash (set_progress);
-			file->set_hash (file->asset_ref().asset()->hash());
-		}
-	}
-} catch (boost::thread_interrupted) {
-	/* set_progress contains an interruption_point, so any of these methods
-	 * may throw thread_interrupted, at which point we just give up.
-	 */
-}
-
-
 void
 Writer::write_hanging_text (ReelWriter& reel)
 {
@@ -33,12 +33,16 @@
 #include "dcpomatic_time.h"
 #include "exception_store.h"
 #include "font_id_map.h"
+#include "metric.h"
 #include "player_text.h"
+#include "task_scheduler.h"
 #include "weak_film.h"
 #include <dcp/atmos_frame.h>
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
+#include <atomic>
 #include <list>
+#include <memory>
 
 
 namespace dcp {
@@ -50,6 +54,8 @@ class Film;
 class Job;
 class ReelWriter;
 class ReferencedReelAsset;
+class SerialWorker;
+class SpillJournal;
 struct writer_disambiguate_font_ids1;
 struct writer_disambiguate_font_ids2;
 struct writer_disambiguate_font_ids3;
@@ -81,6 +87,8 @@ public:
 	int frame = 0;
 	/** eyes for FULL, FAKE and REPEAT */
 	Eyes eyes = Eyes::BOTH;
+	/** MD5 of encoded as hex for FULL, if we were given it */
+	boost::optional<std::string> hash;
 };
 
 
@@ -97,6 +105,9 @@ bool operator== (QueueItem const & a, QueueItem const & b);
  *
  *  write() for Data (picture) can be called out of order, and the Writer
  *  will sort it out.  write() for AudioBuffers must be called in order.
+ *
+ *  Picture, sound and Atmos are each written to their assets by a separate
+ *  thread, so that none of them has to wait for the others.
  */
 
 class Writer : public ExceptionStore, public WeakConstFilm
@@ -112,7 +123,7 @@ public:
 
 	bool can_fake_write (Frame) const;
 
-	void write (std::shared_ptr<const dcp::Data>, Frame, Eyes);
+	void write (std::shared_ptr<const dcp::Data>, Frame, Eyes, boost::optional<std::string> hash = boost::none);
 	void fake_write (Frame, Eyes);
 	bool can_repeat (Frame) const;
 	void repeat (Frame, Eyes);
@@ -125,6 +136,8 @@ public:
 
 	void set_encoder_threads (int threads);
 
+	std::vector<Metric> metrics () const;
+
 private:
 	friend struct ::writer_disambiguate_font_ids1;
 	friend struct ::writer_disambiguate_font_ids2;
@@ -136,9 +149,11 @@ private:
 	size_t video_reel (int frame) const;
 	void set_digest_progress (Job* job, float progress);
 	void write_cover_sheet (boost::filesystem::path output_dcp);
-	void calculate_referenced_digests (std::function<void (float)> set_progress);
 	void write_hanging_text (ReelWriter& reel);
 	void calculate_digests ();
+	void picture_finished (size_t reel);
+	void write_sound (std::shared_ptr<const AudioBuffers> audio, dcpomatic::DCPTime time);
+	void write_atmos (std::shared_ptr<const dcp::AtmosFrame> atmos, dcpomatic::DCPTime time, AtmosMetadata metadata);
 
 	std::weak_ptr<Job> _job;
 	std::vector<ReelWriter> _reels;
@@ -147,24 +162,30 @@ private:
 	std::map<DCPTextTrack, std::vector<ReelWriter>::iterator> _caption_reels;
 	std::vector<ReelWriter>::iterator _atmos_reel;
 
-	/** our thread */
+	/** our thread, which writes pictures */
 	boost::thread _thread;
+	/** thread which runs write_sound() for each block of audio, in order, or null to write audio in the caller's thread */
+	std::unique_ptr<SerialWorker> _sound_worker;
+	/** thread which runs write_atmos() for each Atmos frame, in order, or null to write Atmos in the caller's thread */
+	std::unique_ptr<SerialWorker> _atmos_worker;
 	/** true if our thread should finish */
 	bool _finish = false;
 	/** queue of things to write to disk */
 	std::list<QueueItem> _queue;
 	/** number of FULL frames whose JPEG200 data is currently held in RAM */
 	int _queued_full_in_memory = 0;
+	/** total size of the JPEG2000 data of FULL frames currently held in RAM */
+	size_t _queued_full_bytes = 0;
 	/** mutex for thread state */
 	mutable boost::mutex _state_mutex;
 	/** condition to manage thread wakeups when we have nothing to do  */
 	boost::condition _empty_condition;
 	/** condition to manage thread wakeups when we have too much to do */
 	boost::condition _full_condition;
-	/** maximum number of frames to hold in memory, for when we are managing
+	/** maximum size of JPEG2000 data to hold in memory, for when we are managing
 	 *  ordering
 	 */
-	int _maximum_frames_in_memory;
+	size_t _maximum_bytes_in_memory;
 	unsigned int _maximum_queue_size;
 
 	class LastWritten
@@ -191,21 +212,32 @@ private:
 	/** The last frame written to each reel */
 	std::vector<LastWritten> _last_written;
 
+	/* These counts are atomic so that metrics() can read them while our thread is running */
+
 	/** number of FULL written frames */
-	int _full_written = 0;
+	std::atomic<int> _full_written{0};
 	/** number of FAKE written frames */
-	int _fake_written = 0;
-	int _repeat_written = 0;
+	std::atomic<int> _fake_written{0};
+	std::atomic<int> _repeat_written{0};
 	/** number of frames pushed to disk and then recovered
 	    due to the limit of frames to be held in memory.
 	*/
-	int _pushed_to_disk = 0;
+	std::atomic<int> _pushed_to_disk{0};
+	/** number of frames read back from disk after being pushed there */
+	std::atomic<int> _read_back_from_disk{0};
+	/** Where frames that are pushed to disk are kept; only used by our thread */
+	std::unique_ptr<SpillJournal> _spill_journal;
 
 	bool _text_only;
 
 	boost::mutex _digest_progresses_mutex;
 	std::map<boost::thread::id, float> _digest_progresses;
 
+	/** true to give up on the digests in _early_digests */
+	std::atomic<bool> _stop_early_digests{false};
+	/** Digests of the picture assets of reels which finished while later ones were still being written */
+	TaskScheduler::Group _early_digests{TaskScheduler::instance(), TaskScheduler::Priority::BACKGROUND};
+
 	std::list<ReferencedReelAsset> _reel_assets;
 
 	FontIdMap _fonts;
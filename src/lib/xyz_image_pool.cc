@@ -0,0 +1,105 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "xyz_image_pool.h"
+#include <dcp/openjpeg_image.h>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <list>
+
+
+using std::list;
+using std::shared_ptr;
+using std::unique_ptr;
+
+
+namespace {
+
+/** Maximum total size of the free images that we keep, in bytes */
+size_t constexpr maximum_free_bytes = 512 * 1024 * 1024;
+
+
+size_t
+bytes(dcp::OpenJPEGImage const& image)
+{
+	return static_cast<size_t>(image.size().width) * image.size().height * 3 * sizeof(int32_t);
+}
+
+
+/** Free images of the sizes that we have been asked for recently */
+class XYZImagePool
+{
+public:
+	unique_ptr<dcp::OpenJPEGImage> get(dcp::Size size)
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		auto i = std::find_if(_free.begin(), _free.end(), [size](unique_ptr<dcp::OpenJPEGImage> const& image) {
+			return image->size() == size;
+		});
+		if (i == _free.end()) {
+			return {};
+		}
+		auto image = std::move(*i);
+		_free.erase(i);
+		_free_bytes -= bytes(*image);
+		return image;
+	}
+
+	void put(dcp::OpenJPEGImage* image)
+	{
+		unique_ptr<dcp::OpenJPEGImage> owned(image);
+		boost::mutex::scoped_lock lm(_mutex);
+		/* Newest first, so that if we have to drop any it's ones of sizes we haven't used for a while */
+		_free_bytes += bytes(*owned);
+		_free.push_front(std::move(owned));
+		while (_free_bytes > maximum_free_bytes && !_free.empty()) {
+			_free_bytes -= bytes(*_free.back());
+			_free.pop_back();
+		}
+	}
+
+private:
+	boost::mutex _mutex;
+	list<unique_ptr<dcp::OpenJPEGImage>> _free;
+	size_t _free_bytes = 0;
+};
+
+
+/* Never destroyed, so that images released during static destruction can still be put back */
+XYZImagePool* pool = new XYZImagePool;
+
+}
+
+
+shared_ptr<dcp::OpenJPEGImage>
+pooled_xyz_image(dcp::Size size)
+{
+	auto image = pool->get(size);
+	if (!image) {
+		image.reset(new dcp::OpenJPEGImage(size));
+	}
+
+	return shared_ptr<dcp::OpenJPEGImage>(image.release(), [](dcp::OpenJPEGImage* released) {
+		pool->put(released);
+	});
+}
@@ -0,0 +1,43 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef DCPOMATIC_XYZ_IMAGE_POOL_H
+#define DCPOMATIC_XYZ_IMAGE_POOL_H
+
+
+#include <dcp/types.h>
+#include <memory>
+
+
+namespace dcp {
+	class OpenJPEGImage;
+}
+
+
+/** @return an XYZ image of the given size, which will have been used before if one of the right
+ *  size is free.  Its contents are undefined, so the caller must write every pixel.  When the
+ *  last reference to it goes the image is kept for re-use instead of being freed.
+ */
+extern std::shared_ptr<dcp::OpenJPEGImage> pooled_xyz_image(dcp::Size size);
+
+
+#endif
@@ -25,9 +25,12 @@
 #include <dcp/filesystem.h>
 #include <zip.h>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 
+using std::function;
 using std::runtime_error;
 using std::shared_ptr;
 using std::string;
@@ -49,7 +52,7 @@ Zipper::Zipper (boost::filesystem::path file)
 void
 Zipper::add (string name, string content)
 {
-	shared_ptr<string> copy(new string(content));
+	auto copy = std::make_shared<string>(std::move(content));
 	_store.push_back (copy);
 
 	auto source = zip_source_buffer (_zip, copy->c_str(), copy->length(), 0);
@@ -63,6 +66,101 @@ Zipper::add (string name, string content)
 }
 
 
+#ifdef DCPOMATIC_HAVE_ZIP_SOURCE_T
+
+/** A ZIP source whose data is only made while libzip is writing it to the archive */
+struct DeferredSource
+{
+	explicit DeferredSource (function<string ()> make_)
+		: make (make_)
+	{
+		zip_error_init (&error);
+	}
+
+	~DeferredSource ()
+	{
+		zip_error_fini (&error);
+	}
+
+	function<string ()> make;
+	string data;
+	size_t position = 0;
+	zip_error_t error;
+};
+
+
+static zip_int64_t
+deferred_source_callback (void* user, void* data, zip_uint64_t length, zip_source_cmd_t command)
+{
+	auto source = reinterpret_cast<DeferredSource*>(user);
+
+	switch (command) {
+	case ZIP_SOURCE_OPEN:
+		try {
+			source->data = source->make();
+		} catch (...) {
+			zip_error_set (&source->error, ZIP_ER_READ, 0);
+			return -1;
+		}
+		source->position = 0;
+		return 0;
+	case ZIP_SOURCE_READ:
+	{
+		auto const n = std::min(static_cast<size_t>(length), source->data.size() - source->position);
+		memcpy (data, source->data.data() + source->position, n);
+		source->position += n;
+		return n;
+	}
+	case ZIP_SOURCE_CLOSE:
+		/* We don't need this any more, and there may be many more entries to make */
+		string().swap(source->data);
+		return 0;
+	case ZIP_SOURCE_STAT:
+		zip_stat_init (reinterpret_cast<zip_stat_t*>(data));
+		return sizeof(zip_stat_t);
+	case ZIP_SOURCE_ERROR:
+		return zip_error_to_data (&source->error, data, length);
+	case ZIP_SOURCE_FREE:
+		delete source;
+		return 0;
+	case ZIP_SOURCE_SUPPORTS:
+		return zip_source_make_command_bitmap (
+			ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1
+			);
+	default:
+		zip_error_set (&source->error, ZIP_ER_OPNOTSUPP, 0);
+		return -1;
+	}
+}
+
+#endif
+
+
+/** Add an entry whose content is only made when it is written to the archive,
+ *  so that an archive with many entries need not have all of them in memory at once.
+ *  @param content Function to make the entry's content; this will be called from close().
+ */
+void
+Zipper::add (string name, function<string ()> content)
+{
+#ifdef DCPOMATIC_HAVE_ZIP_SOURCE_T
+	auto deferred = new DeferredSource(content);
+	auto source = zip_source_function (_zip, deferred_source_callback, deferred);
+	if (!source) {
+		delete deferred;
+		throw runtime_error ("could not create ZIP source");
+	}
+
+	if (zip_file_add(_zip, name.c_str(), source, ZIP_FL_ENC_GUESS) == -1) {
+		zip_source_free (source);
+		throw runtime_error(String::compose("failed to add data to ZIP archive (%1)", zip_strerror(_zip)));
+	}
+#else
+	add (name, content());
+#endif
+}
+
+
 void
 Zipper::close ()
 {
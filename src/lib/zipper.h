@@ -20,6 +20,7 @@
 
 
 #include <boost/filesystem.hpp>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -34,6 +35,7 @@ public:
 	Zipper& operator= (Zipper const&) = delete;
 
 	void add (std::string name, std::string content);
+	void add (std::string name, std::function<std::string ()> content);
 	void close ();
 
 private:
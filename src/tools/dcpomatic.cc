@@ -87,7 +87,9 @@
 #include "lib/subtitle_encoder.h"
 #include "lib/text_content.h"
 #include "lib/transcode_job.h"
+#include "lib/ui_watchdog.h"
 #include "lib/update_checker.h"
+#include "lib/util.h"
 #include "lib/version.h"
 #include "lib/video_content.h"
 #include <dcp/exceptions.h>
@@ -948,7 +950,7 @@ private:
 		to.add_days (-1);
 
 		auto signer = Config::instance()->signer_chain();
-		if (!signer->valid()) {
+		if (!certificate_chain_valid(signer)) {
 			error_dialog(this, _("The certificate chain for signing is invalid"));
 			return;
 		}
@@ -1677,6 +1679,10 @@ private:
 			signal_manager = new wxSignalManager (this);
 			Bind (wxEVT_IDLE, boost::bind (&App::idle, this, _1));
 
+			if (Config::instance()->ui_watchdog()) {
+				UIWatchdog::instance()->start(Config::instance()->ui_watchdog_threshold());
+			}
+
 			if (!_film_to_load.empty() && dcp::filesystem::is_directory(_film_to_load)) {
 				try {
 					_frame->load_film (_film_to_load);
@@ -0,0 +1,580 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/tools/dcpomatic_bench.cc
+ *  @brief Run a set of canned transcode scenarios and report how fast they go.
+ *
+ *  Source material is generated deterministically so that runs on different
+ *  machines (or of different versions) can be compared.  Results are written
+ *  as one JSON object per scenario.
+ */
+
+
+#include "lib/config.h"
+#include "lib/content_factory.h"
+#include "lib/compose.hpp"
+#include "lib/cross.h"
+#include "lib/dcp_content.h"
+#include "lib/dcp_content_type.h"
+#include "lib/dcpomatic_log.h"
+#include "lib/encode_server_finder.h"
+#include "lib/exceptions.h"
+#include "lib/ffmpeg_encoder.h"
+#include "lib/film.h"
+#include "lib/image.h"
+#include "lib/image_content.h"
+#include "lib/image_png.h"
+#include "lib/job_manager.h"
+#include "lib/make_dcp.h"
+#include "lib/ratio.h"
+#include "lib/signal_manager.h"
+#include "lib/state.h"
+#include "lib/text_content.h"
+#include "lib/trace.h"
+#include "lib/transcode_job.h"
+#include "lib/util.h"
+#include "lib/version.h"
+#include "lib/video_content.h"
+#include <dcp/file.h>
+#include <dcp/filesystem.h>
+#include <dcp/locale_convert.h>
+#include <sndfile.h>
+#include <getopt.h>
+#ifndef DCPOMATIC_WINDOWS
+#include <sys/resource.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+using std::cerr;
+using std::cout;
+using std::dynamic_pointer_cast;
+using std::function;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::optional;
+
+
+static int const frame_rate = 24;
+
+
+struct Usage
+{
+	double wall = 0;
+	double cpu = 0;
+	long peak_rss_kib = 0;
+};
+
+
+static Usage
+usage_now ()
+{
+	Usage usage;
+	usage.wall = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#ifndef DCPOMATIC_WINDOWS
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0) {
+		usage.cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+		usage.peak_rss_kib = ru.ru_maxrss;
+	}
+#endif
+	return usage;
+}
+
+
+/** Wait for all jobs to finish.
+ *  @return true if any job failed.
+ */
+static bool
+wait_for_bench_jobs ()
+{
+	auto jm = JobManager::instance();
+	while (jm->work_to_do()) {
+		while (signal_manager->ui_idle()) {}
+		dcpomatic_sleep_milliseconds (100);
+	}
+
+	bool failed = false;
+	for (auto job: jm->get()) {
+		if (job->finished_in_error()) {
+			cerr << job->error_summary() << "\n" << job->error_details() << "\n";
+			failed = true;
+		}
+	}
+
+	return failed;
+}
+
+
+/** Write a sequence of PNGs with a pattern which changes smoothly from frame to frame */
+static boost::filesystem::path
+make_image_sequence (boost::filesystem::path dir, dcp::Size size, int frames)
+{
+	if (dcp::filesystem::exists(dir)) {
+		return dir;
+	}
+
+	dcp::filesystem::create_directories(dir);
+	for (int frame = 0; frame < frames; ++frame) {
+		auto image = make_shared<Image>(AV_PIX_FMT_RGB24, size, Image::Alignment::PADDED);
+		for (int y = 0; y < size.height; ++y) {
+			auto p = image->data()[0] + y * image->stride()[0];
+			for (int x = 0; x < size.width; ++x) {
+				*p++ = static_cast<uint8_t>(128 + 127 * sin(x * 0.013 + frame * 0.2));
+				*p++ = static_cast<uint8_t>(128 + 127 * sin(y * 0.017 - frame * 0.1));
+				*p++ = static_cast<uint8_t>((x + y + frame * 4) & 0xff);
+			}
+		}
+		image_as_png(image).write(dir / String::compose("%1.png", dcp::locale_convert<string>(frame)));
+	}
+
+	return dir;
+}
+
+
+/** Write a 24-bit WAV with a different tone on each channel */
+static boost::filesystem::path
+make_wav (boost::filesystem::path file, int channels, int frames)
+{
+	if (dcp::filesystem::exists(file)) {
+		return file;
+	}
+
+	int const sample_rate = 48000;
+	SF_INFO info;
+	info.samplerate = sample_rate;
+	info.channels = channels;
+	info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_24;
+	auto sf = sf_open (file.string().c_str(), SFM_WRITE, &info);
+	if (!sf) {
+		throw OpenFileError (file, errno, OpenFileError::WRITE);
+	}
+
+	int64_t const samples = static_cast<int64_t>(frames) * sample_rate / frame_rate;
+	vector<float> buffer (sample_rate * channels);
+	for (int64_t done = 0; done < samples; ) {
+		auto const this_time = std::min(samples - done, static_cast<int64_t>(sample_rate));
+		for (int64_t i = 0; i < this_time; ++i) {
+			for (int c = 0; c < channels; ++c) {
+				buffer[i * channels + c] = 0.25 * sin(2 * M_PI * (220 + c * 55) * (done + i) / sample_rate);
+			}
+		}
+		sf_writef_float (sf, buffer.data(), this_time);
+		done += this_time;
+	}
+
+	sf_close (sf);
+	return file;
+}
+
+
+/** Write a subtitle file with one subtitle every second */
+static boost::filesystem::path
+make_srt (boost::filesystem::path file, int frames)
+{
+	if (dcp::filesystem::exists(file)) {
+		return file;
+	}
+
+	dcp::File f(file, "w");
+	if (!f) {
+		throw OpenFileError (file, errno, OpenFileError::WRITE);
+	}
+
+	auto timecode = [](int seconds, int millis) -> string {
+		char buffer[64];
+		snprintf (buffer, sizeof(buffer), "%02d:%02d:%02d,%03d", seconds / 3600, (seconds / 60) % 60, seconds % 60, millis);
+		return string(buffer);
+	};
+
+	for (int i = 0; i < frames / frame_rate; ++i) {
+		auto const block = String::compose(
+			"%1\n%2 --> %3\nBenchmark subtitle number %4\nwith a second line\n\n",
+			i + 1, timecode(i, 100), timecode(i, 900), i + 1
+			);
+		f.checked_write(block.c_str(), block.length());
+	}
+
+	return file;
+}
+
+
+class Bench
+{
+public:
+	Bench (boost::filesystem::path dir, int frames, optional<boost::filesystem::path> trace)
+		: _dir (dir)
+		, _frames (frames)
+		, _trace (trace)
+	{}
+
+	boost::filesystem::path sources () const {
+		return _dir / "sources";
+	}
+
+	shared_ptr<Film> new_film (string name) const
+	{
+		auto const path = _dir / "films" / name;
+		if (dcp::filesystem::exists(path)) {
+			dcp::filesystem::remove_all(path);
+		}
+		auto film = make_shared<Film>(path);
+		film->set_name (name);
+		film->set_dcp_content_type (DCPContentType::from_isdcf_name("TST"));
+		film->set_container (Ratio::from_id("185"));
+		film->set_video_frame_rate (frame_rate);
+		film->write_metadata ();
+		return film;
+	}
+
+	void add (shared_ptr<Film> film, boost::filesystem::path path, function<void (shared_ptr<Content>)> setup = {}) const
+	{
+		for (auto content: content_factory(path)) {
+			if (dynamic_pointer_cast<ImageContent>(content)) {
+				content->set_video_frame_rate (film, frame_rate);
+			}
+			film->examine_and_add_content (content, true);
+			if (wait_for_bench_jobs()) {
+				throw std::runtime_error (String::compose("Could not examine %1", path.string()));
+			}
+			if (setup) {
+				setup (content);
+			}
+		}
+	}
+
+	boost::filesystem::path flat_2k () const {
+		return make_image_sequence (sources() / "flat_2k", dcp::Size(1998, 1080), _frames);
+	}
+
+	boost::filesystem::path flat_4k () const {
+		return make_image_sequence (sources() / "flat_4k", dcp::Size(3996, 2160), _frames);
+	}
+
+	boost::filesystem::path three_d () const {
+		return make_image_sequence (sources() / "three_d", dcp::Size(3996, 1080), _frames);
+	}
+
+	boost::filesystem::path wav_16 () const {
+		return make_wav (sources() / "16.wav", 16, _frames);
+	}
+
+	boost::filesystem::path srt () const {
+		return make_srt (sources() / "subs.srt", _frames);
+	}
+
+	/** @return An H.264 file made by exporting the 2K image sequence */
+	boost::filesystem::path h264 () const
+	{
+		auto const file = sources() / "source.mp4";
+		if (dcp::filesystem::exists(file)) {
+			return file;
+		}
+
+		auto film = new_film ("source_mp4");
+		add (film, flat_2k());
+		add (film, wav_16());
+		auto job = make_shared<TranscodeJob>(film, TranscodeJob::ChangedBehaviour::IGNORE);
+		job->set_encoder (make_shared<FFmpegEncoder>(film, job, file, ExportFormat::H264_AAC, true, false, false, 23));
+		JobManager::instance()->add (job);
+		if (wait_for_bench_jobs()) {
+			throw std::runtime_error ("Could not make H.264 source");
+		}
+		return file;
+	}
+
+	/** @return A DCP made from the 2K image sequence */
+	boost::filesystem::path dcp () const
+	{
+		auto const dir = sources() / "source_dcp";
+		if (dcp::filesystem::exists(dir)) {
+			return dir;
+		}
+
+		auto film = new_film ("source_dcp");
+		add (film, flat_2k());
+		make_dcp (film, TranscodeJob::ChangedBehaviour::IGNORE);
+		if (wait_for_bench_jobs()) {
+			throw std::runtime_error ("Could not make DCP source");
+		}
+		dcp::filesystem::rename (film->dir(film->dcp_name(false)), dir);
+		return dir;
+	}
+
+	/** Make a DCP from film and print the results */
+	bool run (string name, shared_ptr<Film> film) const
+	{
+		Trace::clear ();
+		auto const before = usage_now ();
+		make_dcp (film, TranscodeJob::ChangedBehaviour::IGNORE);
+		bool const failed = wait_for_bench_jobs ();
+		auto const after = usage_now ();
+
+		if (_trace) {
+			Trace::write (*_trace / (name + ".json"));
+		}
+
+		auto const seconds = after.wall - before.wall;
+		auto const frames = film->length().frames_round(film->video_frame_rate());
+
+		cout << std::fixed << std::setprecision(3)
+		     << "{\"scenario\": \"" << name << "\""
+		     << ", \"ok\": " << (failed ? "false" : "true")
+		     << ", \"frames\": " << frames
+		     << ", \"seconds\": " << seconds
+		     << ", \"frames_per_second\": " << (seconds > 0 ? frames / seconds : 0)
+		     << ", \"cpu_utilisation\": " << (seconds > 0 ? (after.cpu - before.cpu) / seconds : 0)
+		     << ", \"peak_rss_kib\": " << after.peak_rss_kib
+		     << ", \"stages\": {";
+
+		bool first = true;
+		for (auto const& i: Trace::totals()) {
+			if (!first) {
+				cout << ", ";
+			}
+			first = false;
+			auto const busy = i.second.duration / 1e6;
+			cout << "\"" << i.first << "\": {\"count\": " << i.second.count
+			     << ", \"busy_seconds\": " << busy
+			     << ", \"per_second\": " << (busy > 0 ? i.second.count / busy : 0) << "}";
+		}
+
+		cout << "}}\n" << std::flush;
+		return !failed;
+	}
+
+private:
+	boost::filesystem::path _dir;
+	int _frames;
+	optional<boost::filesystem::path> _trace;
+};
+
+
+struct Scenario
+{
+	string name;
+	string description;
+	function<shared_ptr<Film> (Bench const&)> make;
+};
+
+
+static vector<Scenario>
+scenarios ()
+{
+	return {
+		{
+			"2k", "2K flat from a PNG sequence with 16-channel audio",
+			[](Bench const& bench) -> shared_ptr<Film> {
+				auto film = bench.new_film("2k");
+				film->set_audio_channels (16);
+				bench.add (film, bench.flat_2k());
+				bench.add (film, bench.wav_16());
+				return film;
+			}
+		},
+		{
+			"4k", "4K flat from a PNG sequence",
+			[](Bench const& bench) -> shared_ptr<Film> {
+				auto film = bench.new_film("4k");
+				film->set_resolution (Resolution::FOUR_K);
+				bench.add (film, bench.flat_4k());
+				return film;
+			}
+		},
+		{
+			"3d", "2K 3D from a left/right PNG sequence",
+			[](Bench const& bench) -> shared_ptr<Film> {
+				auto film = bench.new_film("3d");
+				film->set_three_d (true);
+				bench.add (film, bench.three_d(), [](shared_ptr<Content> content) {
+					content->video->set_frame_type (VideoFrameType::THREE_D_LEFT_RIGHT);
+				});
+				return film;
+			}
+		},
+		{
+			"subtitles", "2K flat from a PNG sequence with burnt-in subtitles",
+			[](Bench const& bench) -> shared_ptr<Film> {
+				auto film = bench.new_film("subtitles");
+				bench.add (film, bench.flat_2k());
+				bench.add (film, bench.srt(), [](shared_ptr<Content> content) {
+					content->only_text()->set_use (true);
+					content->only_text()->set_burn (true);
+				});
+				return film;
+			}
+		},
+		{
+			"h264", "2K flat from an H.264 file with stereo audio",
+			[](Bench const& bench) -> shared_ptr<Film> {
+				auto source = bench.h264();
+				auto film = bench.new_film("h264");
+				bench.add (film, source);
+				return film;
+			}
+		},
+		{
+			"reencode", "2K flat re-encoded from an existing DCP",
+			[](Bench const& bench) -> shared_ptr<Film> {
+				auto source = bench.dcp();
+				auto film = bench.new_film("reencode");
+				film->set_reencode_j2k (true);
+				bench.add (film, source);
+				return film;
+			}
+		}
+	};
+}
+
+
+static void
+help (string n)
+{
+	cerr << "Syntax: " << n << " [OPTION]\n"
+	     << "  -v, --version                show DCP-o-matic version\n"
+	     << "  -h, --help                   show this help\n"
+	     << "  -s, --scenario <name>        run only the given scenario (may be given more than once)\n"
+	     << "  -l, --list                   list the available scenarios\n"
+	     << "  -f, --frames <n>             length of each scenario in frames (default 48)\n"
+	     << "  -t, --threads <n>            number of local encoding threads (default: as configured)\n"
+	     << "  -d, --directory <dir>        directory for sources, films and configuration\n"
+	     << "  -F, --trace <dir>            write a trace of each scenario to <dir>\n"
+	     << "\n"
+	     << "Results are written to stdout with one JSON object per scenario.\n";
+}
+
+
+int
+main (int argc, char* argv[])
+{
+	vector<string> wanted;
+	int frames = 48;
+	optional<int> threads;
+	auto dir = boost::filesystem::temp_directory_path() / "dcpomatic_bench";
+	optional<boost::filesystem::path> trace;
+
+	int option_index = 0;
+	while (true) {
+		static struct option long_options[] = {
+			{ "version", no_argument, 0, 'v' },
+			{ "help", no_argument, 0, 'h' },
+			{ "scenario", required_argument, 0, 's' },
+			{ "list", no_argument, 0, 'l' },
+			{ "frames", required_argument, 0, 'f' },
+			{ "threads", required_argument, 0, 't' },
+			{ "directory", required_argument, 0, 'd' },
+			{ "trace", required_argument, 0, 'F' },
+			{ 0, 0, 0, 0 }
+		};
+
+		int c = getopt_long (argc, argv, "vhs:lf:t:d:F:", long_options, &option_index);
+
+		if (c == -1) {
+			break;
+		}
+
+		switch (c) {
+		case 'v':
+			cout << "dcpomatic version " << dcpomatic_version << " " << dcpomatic_git_commit << "\n";
+			exit (EXIT_SUCCESS);
+		case 'h':
+			help (argv[0]);
+			exit (EXIT_SUCCESS);
+		case 's':
+			wanted.push_back (optarg);
+			break;
+		case 'l':
+			for (auto const& i: scenarios()) {
+				cout << std::left << std::setw(12) << i.name << i.description << "\n";
+			}
+			exit (EXIT_SUCCESS);
+		case 'f':
+			frames = atoi (optarg);
+			break;
+		case 't':
+			threads = atoi (optarg);
+			break;
+		case 'd':
+			dir = optarg;
+			break;
+		case 'F':
+			trace = optarg;
+			break;
+		default:
+			help (argv[0]);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	if (frames < frame_rate) {
+		cerr << argv[0] << ": --frames must be at least " << frame_rate << "\n";
+		exit (EXIT_FAILURE);
+	}
+
+	/* Use a configuration of our own so that the user's settings do not affect the results */
+	State::override_path = dir / "config";
+	dcp::filesystem::create_directories (dir / "sources");
+	if (trace) {
+		dcp::filesystem::create_directories (*trace);
+	}
+
+	dcpomatic_setup_path_encoding ();
+	dcpomatic_setup ();
+	signal_manager = new SignalManager ();
+
+	/* Only ever encode locally, so that results do not depend on what is on the network */
+	EncodeServerFinder::instance()->stop ();
+	Config::instance()->set_use_any_servers (false);
+	if (threads) {
+		Config::instance()->set_master_encoding_threads (*threads);
+	}
+
+	Trace::enable ();
+
+	Bench bench (dir, frames, trace);
+	bool ok = true;
+
+	for (auto const& scenario: scenarios()) {
+		if (!wanted.empty() && std::find(wanted.begin(), wanted.end(), scenario.name) == wanted.end()) {
+			continue;
+		}
+
+		try {
+			ok = bench.run(scenario.name, scenario.make(bench)) && ok;
+		} catch (std::exception& e) {
+			cerr << argv[0] << ": scenario " << scenario.name << " failed: " << e.what() << "\n";
+			ok = false;
+		}
+	}
+
+	EncodeServerFinder::drop ();
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -24,6 +24,7 @@
 #include "lib/config.h"
 #include "lib/cross.h"
 #include "lib/dcpomatic_log.h"
+#include "lib/encode_estimate.h"
 #include "lib/encode_server_finder.h"
 #include "lib/ffmpeg_encoder.h"
 #include "lib/film.h"
@@ -34,7 +35,9 @@
 #include "lib/log.h"
 #include "lib/make_dcp.h"
 #include "lib/ratio.h"
+#include "lib/review_export.h"
 #include "lib/signal_manager.h"
+#include "lib/trace.h"
 #include "lib/transcode_job.h"
 #include "lib/util.h"
 #include "lib/version.h"
@@ -79,7 +82,10 @@ help (string n)
 	     << "      --no-check                    don't check project's content files for changes before making the DCP\n"
 	     << "      --export-format <format>      export project to a file, rather than making a DCP: specify mov or mp4\n"
 	     << "      --export-filename <filename>  filename to export to with --export-format\n"
+	     << "      --export-with-dcp             make the DCP as well as the export given by --export-format, using the same pass where possible\n"
 	     << "      --hints                       analyze film for hints before encoding and abort if any are found\n"
+	     << "      --trace <filename>            write a trace of the encoding pipeline's threads to a file which can be opened in Perfetto or chrome://tracing\n"
+	     << "      --estimate <frames>           estimate how long making the DCP will take by encoding this many sample frames; don't encode\n"
 	     << "\n"
 	     << "<FILM> is the film directory.\n";
 }
@@ -134,6 +140,41 @@ print_dump (shared_ptr<Film> film)
 }
 
 
+static void
+print_estimate (shared_ptr<Film> film, int samples)
+{
+	auto const threads = Config::instance()->master_encoding_threads();
+
+	cout << "Encoding " << samples << " sample frames with " << threads << " threads...\n";
+	cout.flush();
+
+	EncodeEstimate estimate;
+	try {
+		estimate = estimate_encode(film, samples, threads);
+	} catch (std::exception& e) {
+		cerr << "Could not estimate encoding time: " << e.what() << "\n";
+		exit (EXIT_FAILURE);
+	}
+
+	if (estimate.frames == 0) {
+		cerr << "Could not estimate encoding time: no frames were decoded\n";
+		exit (EXIT_FAILURE);
+	}
+
+	auto const fps = estimate.projected > 0 ? estimate.total_frames / estimate.projected : 0;
+
+	cout << std::fixed << std::setprecision(3)
+	     << "Sampled " << estimate.frames << " frames\n"
+	     << "Decode  " << (estimate.decode * 1000) << "ms per frame (" << estimate.decoders << " players)\n"
+	     << "Prepare " << (estimate.prepare * 1000) << "ms per frame\n"
+	     << "Encode  " << (estimate.encode * 1000) << "ms per frame (" << estimate.threads << " threads)\n"
+	     << "Size    " << (estimate.bits_per_frame * film->video_frame_rate() / 1000000) << "Mbit/s\n"
+	     << "Noise   " << (estimate.noise_retries * 100) << "% of frames re-encoded with added noise\n"
+	     << "Total   " << estimate.total_frames << " frames in about " << seconds_to_hms(estimate.projected)
+	     << " (" << std::setprecision(1) << fps << "fps) on this machine, not counting remote servers or audio\n";
+}
+
+
 static void
 list_servers ()
 {
@@ -273,7 +314,10 @@ main (int argc, char* argv[])
 	bool check = true;
 	optional<string> export_format;
 	optional<boost::filesystem::path> export_filename;
+	bool export_with_dcp = false;
 	bool hints = false;
+	optional<boost::filesystem::path> trace;
+	optional<int> estimate;
 
 	int option_index = 0;
 	while (true) {
@@ -296,10 +340,13 @@ main (int argc, char* argv[])
 			{ "export-format", required_argument, 0, 'C' },
 			{ "export-filename", required_argument, 0, 'D' },
 			{ "hints", no_argument, 0, 'E' },
+			{ "trace", required_argument, 0, 'F' },
+			{ "export-with-dcp", no_argument, 0, 'G' },
+			{ "estimate", required_argument, 0, 'H' },
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "vhfnrt:j:kAs:ldc:BC:D:E", long_options, &option_index);
+		int c = getopt_long (argc, argv, "vhfnrt:j:kAs:ldc:BC:D:EF:GH:", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -358,6 +405,15 @@ main (int argc, char* argv[])
 		case 'E':
 			hints = true;
 			break;
+		case 'G':
+			export_with_dcp = true;
+			break;
+		case 'F':
+			trace = optarg;
+			break;
+		case 'H':
+			estimate = atoi(optarg);
+			break;
 		}
 	}
 
@@ -401,6 +457,16 @@ main (int argc, char* argv[])
 		exit (EXIT_FAILURE);
 	}
 
+	if (export_with_dcp && !export_format) {
+		cerr << "Argument --export-format is required with --export-with-dcp\n";
+		exit (EXIT_FAILURE);
+	}
+
+	if (estimate && *estimate <= 0) {
+		cerr << "Argument --estimate must be a positive number of frames\n";
+		exit (EXIT_FAILURE);
+	}
+
 	if (export_format && *export_format != "mp4" && *export_format != "mov") {
 		cerr << "Unrecognised export format: must be mp4 or mov\n";
 		exit (EXIT_FAILURE);
@@ -408,11 +474,15 @@ main (int argc, char* argv[])
 
 	film_dir = argv[optind];
 
+	if (trace) {
+		Trace::enable ();
+	}
+
 	dcpomatic_setup_path_encoding ();
 	dcpomatic_setup ();
 	signal_manager = new SignalManager ();
 
-	if (no_remote || export_format) {
+	if (no_remote || (export_format && !export_with_dcp)) {
 		EncodeServerFinder::instance()->stop ();
 	}
 
@@ -450,7 +520,12 @@ main (int argc, char* argv[])
 		}
 	}
 
-	if (!export_format && hints) {
+	if (estimate) {
+		print_estimate (film, *estimate);
+		exit (EXIT_SUCCESS);
+	}
+
+	if ((!export_format || export_with_dcp) && hints) {
 		string const prefix = "Checking project for hints";
 		bool pulse_phase = false;
 		vector<string> hints;
@@ -497,7 +572,7 @@ main (int argc, char* argv[])
 	}
 
 	if (progress) {
-		if (export_format) {
+		if (export_format && !export_with_dcp) {
 			cout << "\nExporting " << film->name() << "\n";
 		} else {
 			cout << "\nMaking DCP for " << film->name() << "\n";
@@ -506,11 +581,20 @@ main (int argc, char* argv[])
 
 	TranscodeJob::ChangedBehaviour const behaviour = check ? TranscodeJob::ChangedBehaviour::STOP : TranscodeJob::ChangedBehaviour::IGNORE;
 
-	if (export_format) {
+	auto const export_format_enum = export_format && *export_format == "mp4" ? ExportFormat::H264_AAC : ExportFormat::PRORES_HQ;
+
+	if (export_format && export_with_dcp) {
+		try {
+			make_dcp (film, behaviour, { std::make_shared<ReviewExport>(*export_filename, export_format_enum, false, false, 23) });
+		} catch (runtime_error& e) {
+			std::cerr << "Could not make DCP: " << e.what() << "\n";
+			exit(EXIT_FAILURE);
+		}
+	} else if (export_format) {
 		auto job = std::make_shared<TranscodeJob>(film, behaviour);
 		job->set_encoder (
 			std::make_shared<FFmpegEncoder> (
-				film, job, *export_filename, *export_format == "mp4" ? ExportFormat::H264_AAC : ExportFormat::PRORES_HQ, false, false, false, 23
+				film, job, *export_filename, export_format_enum, false, false, false, 23
 				)
 			);
 		JobManager::instance()->add (job);
@@ -525,6 +609,14 @@ main (int argc, char* argv[])
 
 	bool const error = show_jobs_on_console (progress);
 
+	if (trace) {
+		try {
+			Trace::write (*trace);
+		} catch (std::exception& e) {
+			cerr << argv[0] << ": could not write trace (" << e.what() << ")\n";
+		}
+	}
+
 	if (keep_going) {
 		while (true) {
 			dcpomatic_sleep_seconds (3600);
@@ -25,6 +25,7 @@
 #include "lib/cross.h"
 #include "lib/dcp_content.h"
 #include "lib/dcp_content_type.h"
+#include "lib/examine_content_job.h"
 #include "lib/film.h"
 #include "lib/image_content.h"
 #include "lib/job.h"
@@ -42,6 +43,8 @@
 #include <getopt.h>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <set>
 #include <stdexcept>
 #include <string>
 
@@ -52,6 +55,8 @@ using std::dynamic_pointer_cast;
 using std::exception;
 using std::list;
 using std::make_shared;
+using std::map;
+using std::set;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -67,6 +72,227 @@ public:
 	void wake_ui () override {}
 };
 
+/** @return Content for a file or directory given on the command line (or in a manifest) */
+static
+vector<shared_ptr<Content>>
+make_content (CreateCLI::Content const& cli_content)
+{
+	auto const can = dcp::filesystem::canonical(cli_content.path);
+	vector<shared_ptr<Content>> film_content_list;
+
+	if (dcp::filesystem::exists(can / "ASSETMAP") || (dcp::filesystem::exists(can / "ASSETMAP.xml"))) {
+		auto dcp = make_shared<DCPContent>(can);
+		film_content_list.push_back (dcp);
+		if (cli_content.kdm) {
+			dcp->add_kdm (dcp::EncryptedKDM(dcp::file_to_string(*cli_content.kdm)));
+		}
+		if (cli_content.cpl) {
+			dcp->set_cpl(*cli_content.cpl);
+		}
+	} else {
+		/* I guess it's not a DCP */
+		film_content_list = content_factory (can);
+	}
+
+	return film_content_list;
+}
+
+
+/** Apply the options given for some content to that content, once it has been examined and added to the film */
+static
+void
+set_up_content (shared_ptr<Film> film, CreateCLI::Content const& cli_content, vector<shared_ptr<Content>> const& film_content_list)
+{
+	for (auto film_content: film_content_list) {
+		if (film_content->video) {
+			film_content->video->set_frame_type (cli_content.frame_type);
+		}
+		if (film_content->audio && cli_content.channel) {
+			for (auto stream: film_content->audio->streams()) {
+				AudioMapping mapping(stream->channels(), film->audio_channels());
+				for (int channel = 0; channel < stream->channels(); ++channel) {
+					mapping.set(channel, *cli_content.channel, 1.0f);
+				}
+				stream->set_mapping (mapping);
+			}
+		}
+		if (film_content->audio && cli_content.gain) {
+			film_content->audio->set_gain (*cli_content.gain);
+		}
+	}
+}
+
+
+/** Apply the options given for a film once all its content has been added */
+static
+void
+finish_film (CreateCLI const& cc, shared_ptr<Film> film)
+{
+	if (cc.dcp_frame_rate) {
+		film->set_video_frame_rate (*cc.dcp_frame_rate);
+	}
+
+	for (auto i: film->content()) {
+		auto ic = dynamic_pointer_cast<ImageContent> (i);
+		if (ic && ic->still()) {
+			ic->video->set_length(cc.still_length.get_value_or(10) * 24);
+		}
+	}
+}
+
+
+static
+void
+wait_for_jobs ()
+{
+	auto jm = JobManager::instance ();
+
+	while (jm->work_to_do ()) {
+		dcpomatic_sleep_seconds (1);
+	}
+
+	while (signal_manager->ui_idle() > 0) {}
+}
+
+
+static
+void
+report_error (shared_ptr<Job> job)
+{
+	cerr << job->error_summary() << "\n";
+	if (!job->error_details().empty()) {
+		cout << job->error_details() << "\n";
+	}
+}
+
+
+/** Create all the films described by a manifest in one go.  Content is examined in parallel
+ *  (as far as Config::parallel_examine_jobs() allows) and content which is used by more than one
+ *  film is only examined once.
+ *  @return true if every film was created.
+ */
+static
+bool
+create_from_manifest (CreateCLI const& cc, string program)
+{
+	auto const films = cc.manifest_films(program);
+	bool ok = true;
+	for (auto const& film: films) {
+		if (film.error) {
+			cerr << *film.error << "\n";
+			ok = false;
+		}
+	}
+
+	if (!ok) {
+		return false;
+	}
+
+	/* Content made for a given command-line description of some content, and the jobs examining it */
+	struct Examined {
+		vector<shared_ptr<Content>> content;
+		vector<shared_ptr<Job>> jobs;
+		bool used = false;
+	};
+
+	auto key = [](CreateCLI::Content const& content) {
+		return content.path.string() + "\n" + (content.kdm ? content.kdm->string() : "") + "\n" + content.cpl.get_value_or("");
+	};
+
+	map<string, Examined> examined;
+	vector<shared_ptr<Film>> made;
+	vector<bool> film_ok (films.size(), true);
+
+	for (size_t i = 0; i < films.size(); ++i) {
+		auto film = films[i].make_film();
+		made.push_back (film);
+		for (auto const& cli_content: films[i].content) {
+			if (examined.find(key(cli_content)) != examined.end()) {
+				continue;
+			}
+			try {
+				Examined e;
+				e.content = make_content (cli_content);
+				for (auto content: e.content) {
+					auto job = make_shared<ExamineContentJob>(film, content);
+					JobManager::instance()->add (job);
+					e.jobs.push_back (job);
+				}
+				examined[key(cli_content)] = e;
+			} catch (exception& e) {
+				cerr << program << ": " << cli_content.path.string() << ": " << e.what() << "\n";
+				film_ok[i] = false;
+			}
+		}
+	}
+
+	wait_for_jobs ();
+
+	set<shared_ptr<Job>> reported;
+
+	for (size_t i = 0; i < films.size(); ++i) {
+		for (auto const& cli_content: films[i].content) {
+			auto e = examined.find(key(cli_content));
+			if (e == examined.end()) {
+				film_ok[i] = false;
+				continue;
+			}
+			for (auto job: e->second.jobs) {
+				if (!job->finished_ok()) {
+					if (reported.find(job) == reported.end()) {
+						report_error (job);
+						reported.insert (job);
+					}
+					film_ok[i] = false;
+				}
+			}
+		}
+
+		if (!film_ok[i]) {
+			continue;
+		}
+
+		auto film = made[i];
+		for (auto const& cli_content: films[i].content) {
+			auto& e = examined[key(cli_content)];
+			vector<shared_ptr<Content>> film_content_list;
+			for (auto content: e.content) {
+				/* Other films must have their own copies of the content */
+				film_content_list.push_back (e.used ? content->clone() : content);
+			}
+			e.used = true;
+
+			for (auto film_content: film_content_list) {
+				film->add_examined_content (film_content);
+			}
+			set_up_content (film, cli_content, film_content_list);
+		}
+
+		finish_film (films[i], film);
+	}
+
+	/* Wait for any audio analysis to finish */
+	wait_for_jobs ();
+
+	for (auto job: JobManager::instance()->get()) {
+		if (job->finished_in_error() && reported.find(job) == reported.end()) {
+			report_error (job);
+		}
+	}
+
+	for (size_t i = 0; i < films.size(); ++i) {
+		if (film_ok[i]) {
+			made[i]->write_metadata ();
+		} else {
+			cerr << program << ": could not create film in " << films[i].output_dir->string() << "\n";
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+
 int
 main (int argc, char* argv[])
 {
@@ -92,73 +318,30 @@ main (int argc, char* argv[])
 	auto jm = JobManager::instance ();
 
 	try {
+		if (cc.manifest) {
+			exit (create_from_manifest(cc, argv[0]) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+
 		auto film = cc.make_film();
 
 		for (auto cli_content: cc.content) {
-			auto const can = dcp::filesystem::canonical(cli_content.path);
-			vector<shared_ptr<Content>> film_content_list;
-
-			if (dcp::filesystem::exists(can / "ASSETMAP") || (dcp::filesystem::exists(can / "ASSETMAP.xml"))) {
-				auto dcp = make_shared<DCPContent>(can);
-				film_content_list.push_back (dcp);
-				if (cli_content.kdm) {
-					dcp->add_kdm (dcp::EncryptedKDM(dcp::file_to_string(*cli_content.kdm)));
-				}
-				if (cli_content.cpl) {
-					dcp->set_cpl(*cli_content.cpl);
-				}
-			} else {
-				/* I guess it's not a DCP */
-				film_content_list = content_factory (can);
-			}
+			auto film_content_list = make_content (cli_content);
 
 			for (auto film_content: film_content_list) {
 				film->examine_and_add_content (film_content);
 			}
 
-			while (jm->work_to_do ()) {
-				dcpomatic_sleep_seconds (1);
-			}
-
-			while (signal_manager->ui_idle() > 0) {}
+			wait_for_jobs ();
 
-			for (auto film_content: film_content_list) {
-				if (film_content->video) {
-					film_content->video->set_frame_type (cli_content.frame_type);
-				}
-				if (film_content->audio && cli_content.channel) {
-					for (auto stream: film_content->audio->streams()) {
-						AudioMapping mapping(stream->channels(), film->audio_channels());
-						for (int channel = 0; channel < stream->channels(); ++channel) {
-							mapping.set(channel, *cli_content.channel, 1.0f);
-						}
-						stream->set_mapping (mapping);
-					}
-				}
-				if (film_content->audio && cli_content.gain) {
-					film_content->audio->set_gain (*cli_content.gain);
-				}
-			}
-		}
-
-		if (cc.dcp_frame_rate) {
-			film->set_video_frame_rate (*cc.dcp_frame_rate);
+			set_up_content (film, cli_content, film_content_list);
 		}
 
-		for (auto i: film->content()) {
-			auto ic = dynamic_pointer_cast<ImageContent> (i);
-			if (ic && ic->still()) {
-				ic->video->set_length(cc.still_length.get_value_or(10) * 24);
-			}
-		}
+		finish_film (cc, film);
 
 		if (jm->errors ()) {
 			for (auto i: jm->get()) {
 				if (i->finished_in_error()) {
-					cerr << i->error_summary() << "\n";
-					if (!i->error_details().empty()) {
-					     cout << i->error_details() << "\n";
-					}
+					report_error (i);
 				}
 			}
 			exit (EXIT_FAILURE);
@@ -44,6 +44,7 @@
 #include <wx/cmdline.h>
 #include <wx/wx.h>
 LIBDCP_DISABLE_WARNINGS
+#include <boost/algorithm/string.hpp>
 #include <boost/process.hpp>
 LIBDCP_ENABLE_WARNINGS
 #ifdef DCPOMATIC_WINDOWS
@@ -331,8 +332,11 @@ private:
 #endif
 		}
 
-		auto const& drive = _drives[_drive->GetSelection()];
-		if (drive.mounted()) {
+		auto const targets = selected_drives();
+		for (auto const& drive: targets) {
+			if (!drive.mounted()) {
+				continue;
+			}
 			auto d = make_wx<TryUnmountDialog>(this, drive.description());
 			int const r = d->ShowModal ();
 			if (r != wxID_OK) {
@@ -366,7 +370,11 @@ private:
 		}
 
 
-		auto d = make_wx<DriveWipeWarningDialog>(this, _drive->GetString(_drive->GetSelection()));
+		vector<string> descriptions;
+		for (auto const& drive: targets) {
+			descriptions.push_back(drive.description());
+		}
+		auto d = make_wx<DriveWipeWarningDialog>(this, std_to_wx(boost::algorithm::join(descriptions, "\n")));
 		if (d->ShowModal() != wxID_OK) {
 			return;
 		}
@@ -375,7 +383,7 @@ private:
 			return;
 		}
 
-		JobManager::instance()->add(make_shared<CopyToDriveJob>(_dcp_paths, _drives[_drive->GetSelection()], _nanomsg));
+		JobManager::instance()->add(make_shared<CopyToDriveJob>(_dcp_paths, targets, _nanomsg));
 		setup_sensitivity ();
 	}
 
@@ -398,10 +406,28 @@ private:
 			_drive->Append(s);
 			++j;
 		}
+		if (_drives.size() > 1) {
+			/* This choice, always the last one, means write to every drive at once */
+			_drive->Append(_("All drives"));
+			if (current == _("All drives")) {
+				re_select = j;
+			}
+		}
 		_drive->SetSelection (re_select);
 		setup_sensitivity ();
 	}
 
+	/** @return the drives that the user has chosen to write to */
+	vector<Drive> selected_drives () const
+	{
+		int const sel = _drive->GetSelection();
+		DCPOMATIC_ASSERT (sel != wxNOT_FOUND);
+		if (sel == static_cast<int>(_drives.size())) {
+			return _drives;
+		}
+		return { _drives[sel] };
+	}
+
 	void setup_sensitivity ()
 	{
 		_copy->Enable (!_dcp_paths.empty() && _drive->GetSelection() != wxNOT_FOUND && !JobManager::instance()->work_to_do());
@@ -31,6 +31,7 @@
 #include "lib/nanomsg.h"
 #include "lib/util.h"
 #include "lib/version.h"
+#include <dcp/raw_convert.h>
 #include <dcp/warnings.h>
 
 #ifdef DCPOMATIC_POSIX
@@ -68,6 +69,9 @@ LIBDCP_ENABLE_WARNINGS
 #include <sys/types.h>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
+LIBDCP_DISABLE_WARNINGS
+#include <boost/process.hpp>
+LIBDCP_ENABLE_WARNINGS
 #include <iostream>
 
 
@@ -148,6 +152,174 @@ void request_privileges (string, std::function<void ()> granted, std::function<v
 }
 
 
+/** Do some basic sanity checks on a drive that we have been asked to write to;
+ *  this is a bit belt-and-braces but it can't hurt...
+ */
+static bool
+can_write_to (string device)
+{
+	using namespace boost::algorithm;
+
+#ifdef DCPOMATIC_OSX
+	if (!starts_with(device, "/dev/disk")) {
+		LOG_DISK ("Will not write to %1", device);
+		return false;
+	}
+#endif
+#ifdef DCPOMATIC_LINUX
+	if (!starts_with(device, "/dev/sd") && !starts_with(device, "/dev/hd")) {
+		LOG_DISK ("Will not write to %1", device);
+		return false;
+	}
+#endif
+#ifdef DCPOMATIC_WINDOWS
+	if (!starts_with(device, "\\\\.\\PHYSICALDRIVE")) {
+		LOG_DISK ("Will not write to %1", device);
+		return false;
+	}
+#endif
+
+	bool on_drive_list = false;
+	bool mounted = false;
+	for (auto const& i: Drive::get()) {
+		if (i.device() == device) {
+			on_drive_list = true;
+			mounted = i.mounted();
+		}
+	}
+
+	if (!on_drive_list) {
+		LOG_DISK ("Will not write to %1 as it's not recognised as a drive", device);
+		return false;
+	}
+	if (mounted) {
+		LOG_DISK ("Will not write to %1 as it's mounted", device);
+		return false;
+	}
+
+	return true;
+}
+
+
+/** Format a drive and write some DCPs to it, reporting progress to nanomsg */
+static void
+write_drive (vector<boost::filesystem::path> dcp_paths, string device, int verify_sample_interval, Nanomsg* nanomsg)
+{
+#if defined(DCPOMATIC_LINUX)
+	auto posix_partition = device;
+	/* XXX: don't know if this logic is sensible */
+	if (posix_partition.size() > 0 && isdigit(posix_partition[posix_partition.length() - 1])) {
+		posix_partition += "p1";
+	} else {
+		posix_partition += "1";
+	}
+	dcpomatic::write (dcp_paths, device, posix_partition, nanomsg, verify_sample_interval);
+#elif defined(DCPOMATIC_OSX)
+	auto fast_device = boost::algorithm::replace_first_copy (device, "/dev/disk", "/dev/rdisk");
+	dcpomatic::write (dcp_paths, fast_device, fast_device + "s1", nanomsg, verify_sample_interval);
+#elif defined(DCPOMATIC_WINDOWS)
+	dcpomatic::write (dcp_paths, device, "", nanomsg, verify_sample_interval);
+#endif
+}
+
+
+static string
+fan_out_url (int drive)
+{
+	return String::compose("ipc:///tmp/dcpomatic-drive-%1.ipc", drive);
+}
+
+
+/** Write some DCPs to several drives at the same time.  lwext4 can only work with one
+ *  device in each process, so each drive is written by a child copy of this program,
+ *  which reports back to us over its own nanomsg socket.  The children read the same
+ *  source files at about the same rate, so after the first one has read some data the
+ *  others will usually find it in the operating system's cache.  A failure of one
+ *  drive does not affect the others.
+ *
+ *  @param drives Drives to write to, with the index that the front-end knows each one by.
+ */
+static void
+write_drives (vector<boost::filesystem::path> dcp_paths, vector<std::pair<int, string>> drives, int verify_sample_interval)
+{
+	struct Child {
+		int drive;
+		std::shared_ptr<Nanomsg> nanomsg;
+		std::shared_ptr<boost::process::child> process;
+		bool finished;
+	};
+
+	auto fail = [](int drive, string message) {
+		LOG_DISK("Drive %1 failed: %2", drive, message);
+		auto response = DiskWriterBackEndResponse::error(message, 0, 0);
+		response.set_drive(drive);
+		response.write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
+	};
+
+	vector<Child> children;
+	for (auto const& drive: drives) {
+		try {
+			auto child_nanomsg = std::make_shared<Nanomsg>(true, fan_out_url(drive.first));
+			vector<string> args = {
+				"--fan-out",
+				fan_out_url(drive.first),
+				drive.second,
+				dcp::raw_convert<string>(verify_sample_interval)
+			};
+			for (auto const& i: dcp_paths) {
+				args.push_back(i.string());
+			}
+			LOG_DISK("Starting writer for drive %1 (%2)", drive.first, drive.second);
+			auto process = std::make_shared<boost::process::child>(disk_writer_path(), boost::process::args(args));
+			children.push_back({drive.first, child_nanomsg, process, false});
+		} catch (exception& e) {
+			fail (drive.first, String::compose("Could not start writer (%1)", e.what()));
+		}
+	}
+
+	while (true) {
+		bool all_finished = true;
+		for (auto& child: children) {
+			if (child.finished) {
+				continue;
+			}
+
+			auto response = DiskWriterBackEndResponse::read_from_nanomsg(*child.nanomsg, SHORT_TIMEOUT);
+			if (!response && !child.process->running()) {
+				/* Check for anything that it sent just before it exited */
+				response = DiskWriterBackEndResponse::read_from_nanomsg(*child.nanomsg, SHORT_TIMEOUT);
+				if (!response) {
+					fail (child.drive, "Writer stopped unexpectedly");
+					child.finished = true;
+					continue;
+				}
+			}
+
+			if (response) {
+				response->set_drive(child.drive);
+				response->write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
+				if (response->type() == DiskWriterBackEndResponse::Type::OK || response->type() == DiskWriterBackEndResponse::Type::ERROR) {
+					child.finished = true;
+					continue;
+				}
+			}
+
+			all_finished = false;
+		}
+
+		if (all_finished) {
+			break;
+		}
+	}
+
+	for (auto& child: children) {
+		child.process->wait();
+	}
+
+	DiskWriterBackEndResponse::ok().write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
+}
+
+
 bool
 idle ()
 try
@@ -216,73 +388,83 @@ try
 			}
 		}
 
-		/* Do some basic sanity checks; this is a bit belt-and-braces but it can't hurt... */
-
-#ifdef DCPOMATIC_OSX
-		if (!starts_with(device, "/dev/disk")) {
-			LOG_DISK ("Will not write to %1", device);
-			DiskWriterBackEndResponse::error("Refusing to write to this drive", 1, 0).write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
-			return true;
+		auto verify_opt = nanomsg->receive (LONG_TIMEOUT);
+		if (!verify_opt) {
+			LOG_DISK_NC("Failed to receive write request");
+			throw CommunicationFailedError();
 		}
-#endif
-#ifdef DCPOMATIC_LINUX
-		if (!starts_with(device, "/dev/sd") && !starts_with(device, "/dev/hd")) {
-			LOG_DISK ("Will not write to %1", device);
+		auto const verify_sample_interval = std::max(1, dcp::raw_convert<int>(*verify_opt));
+
+		if (!can_write_to(device)) {
 			DiskWriterBackEndResponse::error("Refusing to write to this drive", 1, 0).write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
 			return true;
 		}
-#endif
-#ifdef DCPOMATIC_WINDOWS
-		if (!starts_with(device, "\\\\.\\PHYSICALDRIVE")) {
-			LOG_DISK ("Will not write to %1", device);
-			DiskWriterBackEndResponse::error("Refusing to write to this drive", 1, 0).write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
-			return true;
+
+		LOG_DISK("Here we go writing these to %1", device);
+		for (auto dcp: dcp_paths) {
+			LOG_DISK("  %1", dcp);
 		}
-#endif
 
-		bool on_drive_list = false;
-		bool mounted = false;
-		for (auto const& i: Drive::get()) {
-			if (i.device() == device) {
-				on_drive_list = true;
-				mounted = i.mounted();
+		request_privileges (
+			"com.dcpomatic.write-drive",
+			[dcp_paths, device, verify_sample_interval]() {
+				write_drive (dcp_paths, device, verify_sample_interval, nanomsg);
+			},
+			[]() {
+				if (nanomsg) {
+					DiskWriterBackEndResponse::error("Could not obtain authorization to write to the drive", 1, 0).write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
+				}
+			});
+	} else if (*s == DISK_WRITER_WRITE_MULTIPLE) {
+		auto receive_list = []() -> vector<string> {
+			vector<string> list;
+			while (true) {
+				auto line = nanomsg->receive (LONG_TIMEOUT);
+				if (!line) {
+					LOG_DISK_NC("Failed to receive write request");
+					throw CommunicationFailedError();
+				}
+				if (line->empty()) {
+					break;
+				}
+				list.push_back(*line);
 			}
-		}
+			return list;
+		};
 
-		if (!on_drive_list) {
-			LOG_DISK ("Will not write to %1 as it's not recognised as a drive", device);
-			DiskWriterBackEndResponse::error("Refusing to write to this drive", 1, 0).write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
-			return true;
+		auto const devices = receive_list();
+		vector<boost::filesystem::path> dcp_paths;
+		for (auto const& i: receive_list()) {
+			dcp_paths.push_back(i);
 		}
-		if (mounted) {
-			LOG_DISK ("Will not write to %1 as it's mounted", device);
-			DiskWriterBackEndResponse::error("Refusing to write to this drive", 1, 0).write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
-			return true;
+		auto verify_opt = nanomsg->receive (LONG_TIMEOUT);
+		if (!verify_opt) {
+			LOG_DISK_NC("Failed to receive write request");
+			throw CommunicationFailedError();
 		}
+		auto const verify_sample_interval = std::max(1, dcp::raw_convert<int>(*verify_opt));
 
-		LOG_DISK("Here we go writing these to %1", device);
+		/* Any drives which fail the checks are refused, but we carry on with the others */
+		vector<std::pair<int, string>> drives;
+		for (size_t i = 0; i < devices.size(); ++i) {
+			if (can_write_to(devices[i])) {
+				drives.push_back(std::make_pair(static_cast<int>(i), devices[i]));
+			} else {
+				auto response = DiskWriterBackEndResponse::error("Refusing to write to this drive", 1, 0);
+				response.set_drive(i);
+				response.write_to_nanomsg(*nanomsg, LONG_TIMEOUT);
+			}
+		}
+
+		LOG_DISK("Here we go writing these to %1 drives", drives.size());
 		for (auto dcp: dcp_paths) {
 			LOG_DISK("  %1", dcp);
 		}
 
 		request_privileges (
 			"com.dcpomatic.write-drive",
-			[dcp_paths, device]() {
-#if defined(DCPOMATIC_LINUX)
-				auto posix_partition = device;
-				/* XXX: don't know if this logic is sensible */
-				if (posix_partition.size() > 0 && isdigit(posix_partition[posix_partition.length() - 1])) {
-					posix_partition += "p1";
-				} else {
-					posix_partition += "1";
-				}
-				dcpomatic::write (dcp_paths, device, posix_partition, nanomsg);
-#elif defined(DCPOMATIC_OSX)
-				auto fast_device = boost::algorithm::replace_first_copy (device, "/dev/disk", "/dev/rdisk");
-				dcpomatic::write (dcp_paths, fast_device, fast_device + "s1", nanomsg);
-#elif defined(DCPOMATIC_WINDOWS)
-				dcpomatic::write (dcp_paths, device, "", nanomsg);
-#endif
+			[dcp_paths, drives, verify_sample_interval]() {
+				write_drives (dcp_paths, drives, verify_sample_interval);
 			},
 			[]() {
 				if (nanomsg) {
@@ -298,7 +480,7 @@ try
 }
 
 int
-main ()
+main (int argc, char* argv[])
 {
 	dcpomatic_setup_path_encoding();
 
@@ -324,6 +506,23 @@ main ()
         xpc_set_event_stream_handler("com.apple.notifyd.matching", DISPATCH_TARGET_QUEUE_DEFAULT, ^(xpc_object_t) {});
 #endif
 
+	if (argc >= 5 && string(argv[1]) == "--fan-out") {
+		/* We are writing one drive on behalf of another copy of ourselves; see write_drives() */
+		try {
+			nanomsg = new Nanomsg (false, argv[2]);
+		} catch (runtime_error& e) {
+			LOG_DISK("Could not set up nanomsg socket for %1", argv[3]);
+			exit (EXIT_FAILURE);
+		}
+		vector<boost::filesystem::path> dcp_paths;
+		for (int i = 5; i < argc; ++i) {
+			dcp_paths.push_back(argv[i]);
+		}
+		write_drive (dcp_paths, argv[3], std::max(1, dcp::raw_convert<int>(argv[4])), nanomsg);
+		delete nanomsg;
+		exit (EXIT_SUCCESS);
+	}
+
 	try {
 		nanomsg = new Nanomsg (false);
 	} catch (runtime_error& e) {
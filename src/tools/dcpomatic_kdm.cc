@@ -50,6 +50,7 @@
 #include "lib/kdm_with_metadata.h"
 #include "lib/screen.h"
 #include "lib/send_kdm_email_job.h"
+#include "lib/util.h"
 #include <dcp/encrypted_kdm.h>
 #include <dcp/decrypted_kdm.h>
 #include <dcp/exceptions.h>
@@ -372,7 +373,7 @@ private:
 
 			/* This is the signer for our new KDMs */
 			auto signer = Config::instance()->signer_chain ();
-			if (!signer->valid ()) {
+			if (!certificate_chain_valid(signer)) {
 				throw InvalidSignerError ();
 			}
 
@@ -396,23 +397,16 @@ private:
 				return kdm;
 			};
 
-			for (auto i: _screens->screens()) {
-
-				auto kdm = kdm_for_screen(
-					make_kdm,
-					i,
-					_timing->from(),
-					_timing->until(),
-					_output->formulation(),
-					!_output->forensic_mark_video(),
-					_output->forensic_mark_audio() ? boost::optional<int>() : 0,
-					period_checks
-					);
-
-				if (kdm) {
-					kdms.push_back(kdm);
-				}
-			}
+			kdms = kdms_for_screens(
+				make_kdm,
+				_screens->screens(),
+				_timing->from(),
+				_timing->until(),
+				_output->formulation(),
+				!_output->forensic_mark_video(),
+				_output->forensic_mark_audio() ? boost::optional<int>() : 0,
+				period_checks
+				);
 
 			if (kdms.empty()) {
 				return;
@@ -0,0 +1,443 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/tools/dcpomatic_microbench.cc
+ *  @brief Time the image and audio kernels that the encoding pipeline spends most of its time in.
+ *
+ *  Each benchmark is run repeatedly until a minimum time has passed, and the mean
+ *  time per iteration is reported.
+ */
+
+
+#include "lib/audio_buffers.h"
+#include "lib/audio_filter.h"
+#include "lib/colour_conversion.h"
+#include "lib/compose.hpp"
+#include "lib/dcp_video.h"
+#include "lib/image.h"
+#include "lib/player_video.h"
+#include "lib/raw_image_proxy.h"
+#include "lib/resampler.h"
+#include "lib/util.h"
+#include "lib/version.h"
+#include <dcp/openjpeg_image.h>
+#include <getopt.h>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+
+using std::cerr;
+using std::cout;
+using std::function;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using std::weak_ptr;
+using boost::optional;
+
+
+struct Benchmark
+{
+	string name;
+	/** number of items (pixels or samples) processed by each iteration */
+	int64_t items;
+	/** Set up the inputs to the benchmark and return something to run each iteration.
+	 *  This is only called when the benchmark is run so that we do not keep every
+	 *  benchmark's (possibly 8K) images in memory at once.
+	 */
+	function<function<void ()> ()> prepare;
+};
+
+
+struct NamedSize
+{
+	string name;
+	dcp::Size size;
+};
+
+
+static vector<NamedSize> const sizes = {
+	{ "2K", dcp::Size(1998, 1080) },
+	{ "4K", dcp::Size(3996, 2160) },
+	{ "8K", dcp::Size(7680, 4320) },
+};
+
+
+static string
+format_name (AVPixelFormat format)
+{
+	switch (format) {
+	case AV_PIX_FMT_RGB24:
+		return "RGB24";
+	case AV_PIX_FMT_BGRA:
+		return "BGRA";
+	case AV_PIX_FMT_RGB48LE:
+		return "RGB48LE";
+	case AV_PIX_FMT_XYZ12LE:
+		return "XYZ12LE";
+	case AV_PIX_FMT_YUV420P:
+		return "YUV420P";
+	case AV_PIX_FMT_YUV422P10LE:
+		return "YUV422P10LE";
+	default:
+		return String::compose("format%1", static_cast<int>(format));
+	}
+}
+
+
+/** @return an image with some non-uniform content */
+static shared_ptr<Image>
+test_image (AVPixelFormat format, dcp::Size size)
+{
+	auto image = make_shared<Image>(format, size, Image::Alignment::PADDED);
+	for (int c = 0; c < image->planes(); ++c) {
+		auto const lines = image->sample_size(c).height;
+		for (int y = 0; y < lines; ++y) {
+			auto p = image->data()[c] + y * image->stride()[c];
+			for (int x = 0; x < image->line_size()[c]; ++x) {
+				*p++ = static_cast<uint8_t>((x * 7 + y * 3 + c * 50) & 0xff);
+			}
+		}
+	}
+	return image;
+}
+
+
+static shared_ptr<AudioBuffers>
+test_audio (int channels, int frames)
+{
+	auto audio = make_shared<AudioBuffers>(channels, frames);
+	for (int c = 0; c < channels; ++c) {
+		auto p = audio->data(c);
+		for (int i = 0; i < frames; ++i) {
+			p[i] = 0.5 * sin(i * (0.01 + c * 0.001));
+		}
+	}
+	return audio;
+}
+
+
+static vector<Benchmark>
+benchmarks ()
+{
+	vector<Benchmark> b;
+
+	vector<AVPixelFormat> const formats = {
+		AV_PIX_FMT_RGB24, AV_PIX_FMT_RGB48LE, AV_PIX_FMT_XYZ12LE, AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P10LE
+	};
+
+	for (auto const& named: sizes) {
+		auto const size = named.size;
+		auto const pixels = static_cast<int64_t>(size.width) * size.height;
+
+		for (auto format: { AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_RGB24, AV_PIX_FMT_XYZ12LE }) {
+			for (auto scale: { 1, 2 }) {
+				b.push_back({
+					String::compose("crop_scale_window/%1->RGB48LE/%2%3", format_name(format), named.name, scale == 1 ? "" : "-half"),
+					pixels,
+					[format, size, scale]() -> function<void ()> {
+						auto in = test_image(format, size);
+						auto const out_size = dcp::Size(size.width / scale, size.height / scale);
+						return [in, out_size]() {
+							in->crop_scale_window(
+								Crop(), out_size, out_size, dcp::YUVToRGB::REC709, VideoRange::FULL,
+								AV_PIX_FMT_RGB48LE, VideoRange::FULL, Image::Alignment::PADDED, false
+								);
+						};
+					}
+				});
+			}
+		}
+
+		for (auto conversion: vector<std::pair<AVPixelFormat, AVPixelFormat>>{
+				{ AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGB24 },
+				{ AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_RGB48LE },
+				{ AV_PIX_FMT_RGB48LE, AV_PIX_FMT_RGB24 },
+				{ AV_PIX_FMT_RGB24, AV_PIX_FMT_BGRA }
+			}) {
+			auto const in_format = conversion.first;
+			auto const out_format = conversion.second;
+			b.push_back({
+				String::compose("convert_pixel_format/%1->%2/%3", format_name(in_format), format_name(out_format), named.name),
+				pixels,
+				[in_format, out_format, size]() -> function<void ()> {
+					auto in = test_image(in_format, size);
+					return [in, out_format]() {
+						in->convert_pixel_format(dcp::YUVToRGB::REC709, out_format, Image::Alignment::PADDED, false);
+					};
+				}
+			});
+		}
+
+		for (auto format: formats) {
+			/* A subtitle-like overlay covering the bottom quarter of the frame */
+			b.push_back({
+				String::compose("alpha_blend/%1/%2", format_name(format), named.name),
+				pixels / 4,
+				[format, size]() -> function<void ()> {
+					auto image = test_image(format, size);
+					auto overlay = test_image(AV_PIX_FMT_BGRA, dcp::Size(size.width, size.height / 4));
+					auto const position = Position<int>(0, size.height * 3 / 4);
+					return [image, overlay, position]() {
+						image->alpha_blend(overlay, position);
+					};
+				}
+			});
+			b.push_back({
+				String::compose("fade/%1/%2", format_name(format), named.name),
+				pixels,
+				[format, size]() -> function<void ()> {
+					auto image = test_image(format, size);
+					return [image]() {
+						image->fade(0.5);
+					};
+				}
+			});
+			b.push_back({
+				String::compose("make_black/%1/%2", format_name(format), named.name),
+				pixels,
+				[format, size]() -> function<void ()> {
+					auto image = test_image(format, size);
+					return [image]() {
+						image->make_black();
+					};
+				}
+			});
+		}
+
+		b.push_back({
+			String::compose("convert_to_xyz/RGB48LE/%1", named.name),
+			pixels,
+			[size]() -> function<void ()> {
+				auto pv = make_shared<PlayerVideo>(
+					make_shared<RawImageProxy>(test_image(AV_PIX_FMT_RGB48LE, size)),
+					Crop(),
+					optional<double>(),
+					size,
+					size,
+					Eyes::BOTH,
+					Part::WHOLE,
+					PresetColourConversion::from_id("rec709").conversion,
+					VideoRange::FULL,
+					weak_ptr<Content>(),
+					optional<Frame>(),
+					false
+					);
+				return [pv]() {
+					DCPVideo::convert_to_xyz(pv);
+				};
+			}
+		});
+	}
+
+	/* One second of audio at 48kHz */
+	int const frames = 48000;
+
+	b.push_back({
+		"AudioBuffers::accumulate_channel/16ch",
+		int64_t(16) * frames,
+		[frames]() -> function<void ()> {
+			auto audio = test_audio(16, frames);
+			auto target = make_shared<AudioBuffers>(16, frames);
+			return [audio, target]() {
+				for (int c = 0; c < 16; ++c) {
+					target->accumulate_channel(audio.get(), c, c, 0.5);
+				}
+			};
+		}
+	});
+	b.push_back({
+		"AudioBuffers::accumulate_frames/16ch",
+		int64_t(16) * frames,
+		[frames]() -> function<void ()> {
+			auto audio = test_audio(16, frames);
+			auto target = make_shared<AudioBuffers>(16, frames);
+			return [audio, target, frames]() {
+				target->accumulate_frames(audio.get(), frames, 0, 0);
+			};
+		}
+	});
+
+	for (auto channels: { 2, 6, 16 }) {
+		for (auto quality: { std::make_pair(ResamplerQuality::BEST, "best"), std::make_pair(ResamplerQuality::FASTEST, "fastest") }) {
+			b.push_back({
+				String::compose("Resampler::run/44100->48000/%1ch/%2", channels, quality.second),
+				int64_t(channels) * 44100,
+				[channels, quality]() -> function<void ()> {
+					auto in = test_audio(channels, 44100);
+					auto resampler = make_shared<Resampler>(44100, 48000, channels, quality.first);
+					return [in, resampler]() {
+						resampler->run(in);
+					};
+				}
+			});
+		}
+		b.push_back({
+			String::compose("AudioFilter::run/low-pass/%1ch", channels),
+			int64_t(channels) * frames,
+			[channels, frames]() -> function<void ()> {
+				auto in = test_audio(channels, frames);
+				auto filter = make_shared<LowPassAudioFilter>(0.02, 0.1);
+				return [in, filter]() {
+					filter->run(in);
+				};
+			}
+		});
+	}
+
+	return b;
+}
+
+
+static void
+help (string n)
+{
+	cerr << "Syntax: " << n << " [OPTION]\n"
+	     << "  -v, --version                show DCP-o-matic version\n"
+	     << "  -h, --help                   show this help\n"
+	     << "  -f, --filter <text>          run only benchmarks whose name contains <text> (may be given more than once)\n"
+	     << "  -l, --list                   list the available benchmarks\n"
+	     << "  -m, --min-time <seconds>     minimum time to run each benchmark for (default 0.5)\n"
+	     << "  -j, --json                   write results as one JSON object per benchmark\n";
+}
+
+
+int
+main (int argc, char* argv[])
+{
+	vector<string> filters;
+	double min_time = 0.5;
+	bool json = false;
+	bool list = false;
+
+	int option_index = 0;
+	while (true) {
+		static struct option long_options[] = {
+			{ "version", no_argument, 0, 'v' },
+			{ "help", no_argument, 0, 'h' },
+			{ "filter", required_argument, 0, 'f' },
+			{ "list", no_argument, 0, 'l' },
+			{ "min-time", required_argument, 0, 'm' },
+			{ "json", no_argument, 0, 'j' },
+			{ 0, 0, 0, 0 }
+		};
+
+		int c = getopt_long (argc, argv, "vhf:lm:j", long_options, &option_index);
+
+		if (c == -1) {
+			break;
+		}
+
+		switch (c) {
+		case 'v':
+			cout << "dcpomatic version " << dcpomatic_version << " " << dcpomatic_git_commit << "\n";
+			exit (EXIT_SUCCESS);
+		case 'h':
+			help (argv[0]);
+			exit (EXIT_SUCCESS);
+		case 'f':
+			filters.push_back (optarg);
+			break;
+		case 'l':
+			list = true;
+			break;
+		case 'm':
+			min_time = atof (optarg);
+			break;
+		case 'j':
+			json = true;
+			break;
+		default:
+			help (argv[0]);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	dcpomatic_setup_path_encoding ();
+	dcpomatic_setup ();
+
+	auto wanted = [&filters](string const& name) -> bool {
+		if (filters.empty()) {
+			return true;
+		}
+		for (auto const& i: filters) {
+			if (name.find(i) != string::npos) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	if (!json && !list) {
+		cout << std::left << std::setw(56) << "Benchmark" << std::right << std::setw(14) << "Time/iter" << std::setw(12) << "Iterations" << std::setw(16) << "Items/s" << "\n";
+	}
+
+	for (auto const& benchmark: benchmarks()) {
+		if (!wanted(benchmark.name)) {
+			continue;
+		}
+
+		if (list) {
+			cout << benchmark.name << "\n";
+			continue;
+		}
+
+		auto run = benchmark.prepare ();
+
+		/* Warm up caches and any lazily-allocated state */
+		run ();
+
+		int64_t iterations = 0;
+		auto const start = std::chrono::steady_clock::now();
+		double elapsed = 0;
+		do {
+			run ();
+			++iterations;
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		} while (elapsed < min_time);
+
+		auto const per_iteration = elapsed / iterations;
+		auto const items_per_second = benchmark.items / per_iteration;
+
+		if (json) {
+			cout << std::fixed << std::setprecision(3)
+			     << "{\"name\": \"" << benchmark.name << "\""
+			     << ", \"iterations\": " << iterations
+			     << ", \"ns_per_iteration\": " << per_iteration * 1e9
+			     << ", \"items_per_second\": " << items_per_second
+			     << "}\n";
+		} else {
+			cout << std::left << std::setw(56) << benchmark.name
+			     << std::right << std::fixed << std::setprecision(3) << std::setw(11) << per_iteration * 1e3 << " ms"
+			     << std::setw(12) << iterations
+			     << std::setprecision(1) << std::setw(15) << items_per_second / 1e6 << "M\n";
+		}
+		cout << std::flush;
+	}
+
+	return EXIT_SUCCESS;
+}
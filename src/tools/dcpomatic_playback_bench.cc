@@ -0,0 +1,473 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  src/tools/dcpomatic_playback_bench.cc
+ *  @brief Play a film or DCP through a Butler, as the viewer does, and report how well it keeps up.
+ *
+ *  Playback is driven either by random seeks or by a script in the same format as the
+ *  player's stress tester (see PlayerStressTester).  Results are written as a JSON object.
+ */
+
+
+#include "lib/audio_mapping.h"
+#include "lib/butler.h"
+#include "lib/config.h"
+#include "lib/cross.h"
+#include "lib/dcp_content.h"
+#include "lib/dcpomatic_log.h"
+#include "lib/film.h"
+#include "lib/image.h"
+#include "lib/job_manager.h"
+#include "lib/player.h"
+#include "lib/player_video.h"
+#include "lib/signal_manager.h"
+#include "lib/state.h"
+#include "lib/stress_command.h"
+#include "lib/util.h"
+#include "lib/version.h"
+#include <dcp/filesystem.h>
+#include <boost/bind/bind.hpp>
+#include <getopt.h>
+#ifndef DCPOMATIC_WINDOWS
+#include <sys/resource.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+
+using std::cerr;
+using std::cout;
+using std::make_shared;
+using std::max;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::optional;
+using namespace dcpomatic;
+
+
+/** Number of positions on the player's slider, which scripts use to give seek positions */
+static int const slider_positions = 4096;
+
+
+static double
+now ()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+static long
+peak_rss_kib ()
+{
+#ifndef DCPOMATIC_WINDOWS
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0) {
+		return ru.ru_maxrss;
+	}
+#endif
+	return 0;
+}
+
+
+/** Wait for all jobs to finish.
+ *  @return true if any job failed.
+ */
+static bool
+wait_for_jobs ()
+{
+	auto jm = JobManager::instance();
+	while (jm->work_to_do()) {
+		while (signal_manager->ui_idle()) {}
+		dcpomatic_sleep_milliseconds (100);
+	}
+
+	bool failed = false;
+	for (auto job: jm->get()) {
+		if (job->finished_in_error()) {
+			cerr << job->error_summary() << "\n" << job->error_details() << "\n";
+			failed = true;
+		}
+	}
+
+	return failed;
+}
+
+
+/** @return A film from a DCP-o-matic project folder, or one containing just the DCP in a DCP folder */
+static shared_ptr<Film>
+load (boost::filesystem::path path)
+{
+	if (dcp::filesystem::exists(path / "metadata.xml")) {
+		auto film = make_shared<Film>(path);
+		film->read_metadata ();
+		return film;
+	}
+
+	/* Set up as the player does */
+	auto film = make_shared<Film>(optional<boost::filesystem::path>());
+	film->set_tolerant (true);
+	film->set_audio_channels (MAX_DCP_AUDIO_CHANNELS);
+
+	auto dcp = make_shared<DCPContent>(path);
+	film->examine_and_add_content (dcp, true);
+	if (wait_for_jobs()) {
+		throw std::runtime_error ("Could not examine DCP");
+	}
+	if (dcp->video_frame_rate()) {
+		film->set_video_frame_rate (dcp->video_frame_rate().get(), true);
+	}
+	return film;
+}
+
+
+class PlaybackBench
+{
+public:
+	PlaybackBench (shared_ptr<Film> film, int audio_channels, bool realtime)
+		: _film (film)
+		, _player (film, Image::Alignment::PADDED)
+		, _audio_channels (audio_channels)
+		, _realtime (realtime)
+		, _butler (
+			film,
+			_player,
+			Config::instance()->audio_mapping(audio_channels),
+			audio_channels,
+			boost::bind(&PlayerVideo::force, AV_PIX_FMT_RGB24),
+			VideoRange::FULL,
+			Image::Alignment::PADDED,
+			true,
+			false,
+			Butler::Audio::ENABLED
+			)
+	{
+
+	}
+
+	/** Seek as the player does when its slider is moved to a position, and wait for the first frame */
+	void seek (int slider)
+	{
+		auto const rate = _film->video_frame_rate();
+		auto const length = _film->length();
+		auto const position = DCPTime(length.get() * slider / slider_positions).round(rate);
+
+		auto const start = now();
+		_butler.seek (position, true);
+		auto const first = get_video ();
+		_seek_latencies.push_back (now() - start);
+
+		_finished = !first;
+		_audio_position = 0;
+		_played_since_seek = 1;
+	}
+
+	/** Play for some period, either as fast as possible or at real time */
+	void play (int milliseconds)
+	{
+		if (_finished) {
+			return;
+		}
+
+		auto const rate = _film->video_frame_rate();
+		auto const audio_rate = _film->audio_frame_rate();
+		auto const frames = static_cast<int64_t>(milliseconds) * rate / 1000;
+		vector<float> audio;
+
+		auto const start = now();
+		for (int64_t i = 0; i < frames; ++i) {
+			if (_realtime) {
+				auto const due = start + static_cast<double>(i) / rate;
+				auto const wait = due - now();
+				if (wait > 0) {
+					std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+				}
+			}
+
+			if (!get_video()) {
+				_finished = true;
+				break;
+			}
+
+			++_played_since_seek;
+			++_frames;
+
+			if (_realtime && now() > start + static_cast<double>(i + 1) / rate) {
+				/* This frame arrived after the next one should have been shown, so the viewer would drop it */
+				++_video_underruns;
+			}
+
+			/* Take the audio that the sound card would have wanted while this frame was shown */
+			auto const audio_wanted = _played_since_seek * audio_rate / rate - _audio_position;
+			if (audio_wanted > 0) {
+				audio.resize (audio_wanted * _audio_channels);
+				auto const got = _butler.get_audio(_realtime ? Butler::Behaviour::NON_BLOCKING : Butler::Behaviour::BLOCKING, audio.data(), audio_wanted);
+				if (!got && _realtime) {
+					++_audio_underruns;
+				}
+				_audio_position += audio_wanted;
+			}
+
+			_peak_butler_memory = max(_peak_butler_memory, _butler.memory_used().first);
+		}
+
+		_playing += now() - start;
+	}
+
+	void pause (int milliseconds)
+	{
+		if (_realtime) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+		}
+	}
+
+	void print (string name) const
+	{
+		auto latencies = _seek_latencies;
+		std::sort (latencies.begin(), latencies.end());
+		auto percentile = [&latencies](double p) -> double {
+			if (latencies.empty()) {
+				return 0;
+			}
+			auto const index = std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+			return latencies[index] * 1000;
+		};
+
+		cout << std::fixed << std::setprecision(3)
+		     << "{\"film\": \"" << name << "\""
+		     << ", \"realtime\": " << (_realtime ? "true" : "false")
+		     << ", \"frames\": " << _frames
+		     << ", \"seconds\": " << _playing
+		     << ", \"frames_per_second\": " << (_playing > 0 ? _frames / _playing : 0)
+		     << ", \"video_underruns\": " << _video_underruns
+		     << ", \"audio_underruns\": " << _audio_underruns
+		     << ", \"seeks\": " << latencies.size()
+		     << ", \"seek_latency_ms\": {"
+		     << "\"p50\": " << percentile(0.5)
+		     << ", \"p90\": " << percentile(0.9)
+		     << ", \"p99\": " << percentile(0.99)
+		     << ", \"max\": " << percentile(1)
+		     << "}"
+		     << ", \"peak_butler_bytes\": " << _peak_butler_memory
+		     << ", \"peak_rss_kib\": " << peak_rss_kib()
+		     << "}\n" << std::flush;
+	}
+
+private:
+	/** Get a frame and make its image as the viewer would.
+	 *  @return false if there are no more frames.
+	 */
+	bool get_video ()
+	{
+		Butler::Error error;
+		auto video = _butler.get_video(Butler::Behaviour::BLOCKING, &error);
+		if (!video.first) {
+			if (error.code == Butler::Error::Code::DIED) {
+				throw std::runtime_error (error.summary());
+			}
+			return false;
+		}
+
+		video.first->image(boost::bind(&PlayerVideo::force, AV_PIX_FMT_RGB24), VideoRange::FULL, true);
+		return true;
+	}
+
+	shared_ptr<Film> _film;
+	Player _player;
+	int _audio_channels;
+	bool _realtime;
+	Butler _butler;
+
+	bool _finished = false;
+	int64_t _played_since_seek = 0;
+	int64_t _audio_position = 0;
+
+	int64_t _frames = 0;
+	double _playing = 0;
+	int _video_underruns = 0;
+	int _audio_underruns = 0;
+	vector<double> _seek_latencies;
+	size_t _peak_butler_memory = 0;
+};
+
+
+static void
+help (string n)
+{
+	cerr << "Syntax: " << n << " [OPTION] <FILM-OR-DCP>\n"
+	     << "  -v, --version                show DCP-o-matic version\n"
+	     << "  -h, --help                   show this help\n"
+	     << "  -r, --realtime               play at real time, rather than as fast as possible\n"
+	     << "  -n, --seeks <n>              number of random seeks to make (default 20)\n"
+	     << "  -p, --play <ms>              time to play after each seek, in milliseconds (default 2000)\n"
+	     << "  -S, --seed <n>               seed for the random seek positions (default 1)\n"
+	     << "  -s, --script <file>          follow a player stress-test script instead of seeking at random\n"
+	     << "  -a, --audio-channels <n>     number of audio output channels (default 2)\n"
+	     << "  -c, --config <dir>           directory containing config.xml\n"
+	     << "\n"
+	     << "Results are written to stdout as a JSON object.\n";
+}
+
+
+int
+main (int argc, char* argv[])
+{
+	bool realtime = false;
+	int seeks = 20;
+	int play = 2000;
+	unsigned int seed = 1;
+	optional<boost::filesystem::path> script;
+	int audio_channels = 2;
+	optional<boost::filesystem::path> config;
+
+	int option_index = 0;
+	while (true) {
+		static struct option long_options[] = {
+			{ "version", no_argument, 0, 'v' },
+			{ "help", no_argument, 0, 'h' },
+			{ "realtime", no_argument, 0, 'r' },
+			{ "seeks", required_argument, 0, 'n' },
+			{ "play", required_argument, 0, 'p' },
+			{ "seed", required_argument, 0, 'S' },
+			{ "script", required_argument, 0, 's' },
+			{ "audio-channels", required_argument, 0, 'a' },
+			{ "config", required_argument, 0, 'c' },
+			{ 0, 0, 0, 0 }
+		};
+
+		int c = getopt_long (argc, argv, "vhrn:p:S:s:a:c:", long_options, &option_index);
+
+		if (c == -1) {
+			break;
+		}
+
+		switch (c) {
+		case 'v':
+			cout << "dcpomatic version " << dcpomatic_version << " " << dcpomatic_git_commit << "\n";
+			exit (EXIT_SUCCESS);
+		case 'h':
+			help (argv[0]);
+			exit (EXIT_SUCCESS);
+		case 'r':
+			realtime = true;
+			break;
+		case 'n':
+			seeks = atoi (optarg);
+			break;
+		case 'p':
+			play = atoi (optarg);
+			break;
+		case 'S':
+			seed = atoi (optarg);
+			break;
+		case 's':
+			script = optarg;
+			break;
+		case 'a':
+			audio_channels = atoi (optarg);
+			break;
+		case 'c':
+			config = optarg;
+			break;
+		default:
+			help (argv[0]);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	if (optind >= argc) {
+		help (argv[0]);
+		exit (EXIT_FAILURE);
+	}
+
+	if (audio_channels < 1) {
+		cerr << argv[0] << ": --audio-channels must be at least 1\n";
+		exit (EXIT_FAILURE);
+	}
+
+	if (config) {
+		State::override_path = *config;
+	}
+
+	boost::filesystem::path const path = argv[optind];
+
+	dcpomatic_setup_path_encoding ();
+	dcpomatic_setup ();
+	signal_manager = new SignalManager ();
+
+	try {
+		auto film = load (path);
+		PlaybackBench bench (film, audio_channels, realtime);
+
+		if (script) {
+			bool playing = false;
+			for (auto const& command: read_stress_script(*script)) {
+				if (command.type == Command::EXIT) {
+					break;
+				}
+				switch (command.type) {
+				case Command::OPEN:
+					cerr << argv[0] << ": ignoring O command; give the film or DCP on the command line\n";
+					break;
+				case Command::PLAY:
+					playing = true;
+					break;
+				case Command::STOP:
+					playing = false;
+					break;
+				case Command::WAIT:
+					if (playing) {
+						bench.play (command.int_param);
+					} else {
+						bench.pause (command.int_param);
+					}
+					break;
+				case Command::SEEK:
+					bench.seek (command.int_param);
+					break;
+				default:
+					break;
+				}
+			}
+		} else {
+			std::mt19937 generator (seed);
+			std::uniform_int_distribution<int> distribution (0, slider_positions - 1);
+			bench.play (play);
+			for (int i = 0; i < seeks; ++i) {
+				bench.seek (distribution(generator));
+				bench.play (play);
+			}
+		}
+
+		bench.print (path.filename().string());
+	} catch (std::exception& e) {
+		cerr << argv[0] << ": " << e.what() << "\n";
+		exit (EXIT_FAILURE);
+	}
+
+	return EXIT_SUCCESS;
+}
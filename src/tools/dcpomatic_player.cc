@@ -38,6 +38,7 @@
 #include "lib/compose.hpp"
 #include "lib/config.h"
 #include "lib/constants.h"
+#include "lib/cpl_cache.h"
 #include "lib/cross.h"
 #include "lib/dcp_content.h"
 #include "lib/dcp_examiner.h"
@@ -70,7 +71,6 @@
 #include <dcp/exceptions.h>
 #include <dcp/filesystem.h>
 #include <dcp/raw_convert.h>
-#include <dcp/search.h>
 #include <dcp/warnings.h>
 LIBDCP_DISABLE_WARNINGS
 #include <wx/cmdline.h>
@@ -134,6 +134,7 @@ enum {
 	ID_view_scale_full,
 	ID_view_scale_half,
 	ID_view_scale_quarter,
+	ID_view_scale_adaptive,
 	ID_help_report_a_problem,
 	ID_tools_verify,
 	ID_tools_check_for_updates,
@@ -239,6 +240,7 @@ public:
 		Bind (wxEVT_MENU, boost::bind (&DOMFrame::set_decode_reduction, this, optional<int>(0)), ID_view_scale_full);
 		Bind (wxEVT_MENU, boost::bind (&DOMFrame::set_decode_reduction, this, optional<int>(1)), ID_view_scale_half);
 		Bind (wxEVT_MENU, boost::bind (&DOMFrame::set_decode_reduction, this, optional<int>(2)), ID_view_scale_quarter);
+		Bind (wxEVT_MENU, boost::bind (&DOMFrame::view_adaptive_decode_reduction, this, _1), ID_view_scale_adaptive);
 		Bind (wxEVT_MENU, boost::bind (&DOMFrame::help_about, this), wxID_ABOUT);
 		Bind (wxEVT_MENU, boost::bind (&DOMFrame::help_report_a_problem, this), ID_help_report_a_problem);
 		Bind (wxEVT_MENU, boost::bind (&DOMFrame::tools_verify, this), ID_tools_verify);
@@ -257,6 +259,7 @@ public:
 		}
 		_controls->set_film(_viewer.film());
 		_viewer.set_dcp_decode_reduction(Config::instance()->decode_reduction());
+		_viewer.set_adaptive_dcp_decode_reduction(Config::instance()->adaptive_decode_reduction());
 		_viewer.set_optimise_for_j2k(true);
 		_viewer.PlaybackPermitted.connect(bind(&DOMFrame::playback_permitted, this));
 		_viewer.TooManyDropped.connect(bind(&DOMFrame::too_many_frames_dropped, this));
@@ -385,6 +388,13 @@ public:
 		Config::instance()->set_decode_reduction (reduction);
 	}
 
+	void view_adaptive_decode_reduction (wxCommandEvent& ev)
+	{
+		_viewer.set_adaptive_dcp_decode_reduction(ev.IsChecked());
+		_info->triggered_update ();
+		Config::instance()->set_adaptive_decode_reduction(ev.IsChecked());
+	}
+
 	void load_dcp (boost::filesystem::path dir)
 	{
 		DCPOMATIC_ASSERT (_film);
@@ -504,7 +514,7 @@ public:
 			auto first = dynamic_pointer_cast<DCPContent>(_film->content().front());
 			if (first) {
 				int id = ID_view_cpl;
-				for (auto i: dcp::find_and_resolve_cpls(first->directories(), true)) {
+				for (auto i: find_and_resolve_cpls_cached(first->directories(), true)) {
 					auto j = _cpl_menu->AppendRadioItem(
 						id,
 						wxString::Format("%s (%s)", std_to_wx(i->annotation_text().get_value_or("")).data(), std_to_wx(i->id()).data())
@@ -597,6 +607,8 @@ private:
 		view->AppendRadioItem(ID_view_scale_full, _("Decode at full resolution"))->Check(c && c.get() == 0);
 		view->AppendRadioItem(ID_view_scale_half, _("Decode at half resolution"))->Check(c && c.get() == 1);
 		view->AppendRadioItem(ID_view_scale_quarter, _("Decode at quarter resolution"))->Check(c && c.get() == 2);
+		view->AppendSeparator();
+		view->AppendCheckItem(ID_view_scale_adaptive, _("Lower decode resolution when dropping frames"))->Check(Config::instance()->adaptive_decode_reduction());
 
 		auto tools = new wxMenu;
 		_tools_verify = tools->Append (ID_tools_verify, _("Verify DCP..."));
@@ -797,7 +809,7 @@ private:
 	{
 		auto dcp = std::dynamic_pointer_cast<DCPContent>(_film->content().front());
 		DCPOMATIC_ASSERT (dcp);
-		auto cpls = dcp::find_and_resolve_cpls (dcp->directories(), true);
+		auto cpls = find_and_resolve_cpls_cached(dcp->directories(), true);
 		int id = ev.GetId() - ID_view_cpl;
 		DCPOMATIC_ASSERT (id >= 0);
 		DCPOMATIC_ASSERT (id < int(cpls.size()));
@@ -338,6 +338,7 @@ private:
 	void main_thread ()
 	try {
 		EncodeServer server (false, Config::instance()->server_encoding_threads());
+		server.benchmark ();
 		server.run ();
 	} catch (...) {
 		store_current ();
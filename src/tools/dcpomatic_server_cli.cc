@@ -28,6 +28,7 @@
 #include "lib/null_log.h"
 #include "lib/version.h"
 #include "lib/encode_server.h"
+#include "lib/encode_server_coordinator.h"
 #include "lib/dcpomatic_log.h"
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
@@ -56,7 +57,9 @@ help (string n)
 	     << "  -h, --help         show this help\n"
 	     << "  -t, --threads      number of parallel encoding threads to use\n"
 	     << "  --verbose          be verbose to stdout\n"
-	     << "  --log              write a log file of activity\n";
+	     << "  --log              write a log file of activity\n"
+	     << "  --no-benchmark     don't measure encoding speed before starting\n"
+	     << "  --coordinator      instead of encoding, share out the servers on the network between masters\n";
 }
 
 int
@@ -68,6 +71,8 @@ main (int argc, char* argv[])
 	int num_threads = Config::instance()->server_encoding_threads ();
 	bool verbose = false;
 	bool write_log = false;
+	bool benchmark = true;
+	bool coordinator = false;
 
 	int option_index = 0;
 	while (true) {
@@ -77,10 +82,12 @@ main (int argc, char* argv[])
 			{ "threads", required_argument, 0, 't'},
 			{ "verbose", no_argument, 0, 'A'},
 			{ "log", no_argument, 0, 'B'},
+			{ "no-benchmark", no_argument, 0, 'C'},
+			{ "coordinator", no_argument, 0, 'D'},
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "vht:AB", long_options, &option_index);
+		int c = getopt_long (argc, argv, "vht:ABCD", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -102,6 +109,12 @@ main (int argc, char* argv[])
 		case 'B':
 			write_log = true;
 			break;
+		case 'C':
+			benchmark = false;
+			break;
+		case 'D':
+			coordinator = true;
+			break;
 		}
 	}
 
@@ -109,9 +122,21 @@ main (int argc, char* argv[])
 		dcpomatic_log.reset (new FileLog("dcpomatic_server_cli.log"));
 	}
 
-	EncodeServer server (verbose, num_threads);
-
 	try {
+		if (coordinator) {
+			if (!Config::instance()->encode_server_coordinator().empty()) {
+				cerr << argv[0] << ": this machine is configured to get its servers from another coordinator.\n";
+				exit (EXIT_FAILURE);
+			}
+			EncodeServerCoordinator server (verbose);
+			server.run ();
+			return 0;
+		}
+
+		EncodeServer server (verbose, num_threads);
+		if (benchmark) {
+			server.benchmark ();
+		}
 		server.run ();
 	} catch (boost::system::system_error& e) {
 		if (e.code() == boost::system::errc::address_in_use) {
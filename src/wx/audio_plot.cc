@@ -33,9 +33,9 @@ LIBDCP_DISABLE_WARNINGS
 LIBDCP_ENABLE_WARNINGS
 #include <boost/bind/bind.hpp>
 #include <cfloat>
+#include <cmath>
 
 
-using std::list;
 using std::map;
 using std::max;
 using std::min;
@@ -105,6 +105,7 @@ AudioPlot::AudioPlot(wxWindow* parent, FilmViewer& viewer)
 	Bind (wxEVT_MOTION, boost::bind (&AudioPlot::mouse_moved, this, _1));
 	Bind (wxEVT_LEAVE_WINDOW, boost::bind (&AudioPlot::mouse_leave, this, _1));
 	Bind (wxEVT_LEFT_DOWN, boost::bind(&AudioPlot::left_down, this));
+	Bind (wxEVT_MOUSEWHEEL, boost::bind(&AudioPlot::mouse_wheel, this, _1));
 
 	SetMinSize (wxSize (640, 512));
 }
@@ -114,6 +115,10 @@ void
 AudioPlot::set_analysis (shared_ptr<AudioAnalysis> a)
 {
 	_analysis = a;
+	_view_start = 0;
+	_view_points = 0;
+	_peak.clear ();
+	_rms.clear ();
 
 	if (!a) {
 		_message = _("Please wait; audio is being analysed...");
@@ -152,8 +157,16 @@ struct Metrics
 	double db_label_width;
 	int height;
 	int y_origin;
-	float x_scale; ///< pixels per data point
+	float x_scale; ///< pixels per data point at `level'
 	float y_scale;
+	/** level of the analysis that we are drawing */
+	int level;
+	/** index of the point (at `level') which is at the left-hand edge of the plot; may be fractional */
+	double view_start;
+	/** first point to draw */
+	int first;
+	/** one past the last point to draw */
+	int last;
 };
 
 
@@ -187,8 +200,18 @@ AudioPlot::paint ()
 	metrics.db_label_width += 8;
 
 	int const data_width = GetSize().GetWidth() - metrics.db_label_width;
+	_data_left = metrics.db_label_width;
+	_data_width = max(1, data_width);
+
 	/* Assume all channels have the same number of points */
-	metrics.x_scale = data_width / float (_analysis->points (0));
+	double const view_points = _view_points > 0 ? _view_points : _analysis->points(0);
+	/* Use the lowest resolution which still gives us at least a point per pixel */
+	metrics.level = _analysis->level_for_samples_per_point(llrint(view_points * _analysis->samples_per_point() / _data_width));
+	double const level_scale = pow(2, metrics.level);
+	metrics.x_scale = data_width / (view_points / level_scale);
+	metrics.view_start = _view_start / level_scale;
+	metrics.first = max(0, static_cast<int>(floor(metrics.view_start)));
+	metrics.last = min(_analysis->points(0, metrics.level), static_cast<int>(ceil(metrics.view_start + view_points / level_scale)) + 1);
 	metrics.height = GetSize().GetHeight ();
 	metrics.y_origin = 32;
 	metrics.y_scale = (metrics.height - metrics.y_origin) / -_minimum;
@@ -210,12 +233,13 @@ AudioPlot::paint ()
 	auto v_grid = gc->CreatePath ();
 
 	DCPOMATIC_ASSERT (_analysis->samples_per_point() != 0.0);
-	double const pps = _analysis->sample_rate() * metrics.x_scale / _analysis->samples_per_point();
+	double const pps = _analysis->sample_rate() * metrics.x_scale / _analysis->samples_per_point(metrics.level);
+	double const view_start_seconds = _view_start * _analysis->samples_per_point() / _analysis->sample_rate();
 
 	double const mark_interval = calculate_mark_interval (rint (128 / pps));
 
-	auto t = DCPTime::from_seconds (mark_interval);
-	while ((t.seconds() * pps) < data_width) {
+	auto t = DCPTime::from_seconds ((floor(view_start_seconds / mark_interval) + 1) * mark_interval);
+	while (((t.seconds() - view_start_seconds) * pps) < data_width) {
 		double tc = t.seconds ();
 		int const h = tc / 3600;
 		tc -= h * 3600;
@@ -230,7 +254,7 @@ AudioPlot::paint ()
 		wxDouble str_leading;
 		gc->GetTextExtent (str, &str_width, &str_height, &str_descent, &str_leading);
 
-		int const tx = llrintf (metrics.db_label_width + t.seconds() * pps);
+		int const tx = llrintf (metrics.db_label_width + (t.seconds() - view_start_seconds) * pps);
 		gc->DrawText (str, tx - str_width / 2, metrics.height - metrics.y_origin + db_label_height);
 
 		v_grid.MoveToPoint (tx, metrics.height - metrics.y_origin + 4);
@@ -300,16 +324,15 @@ AudioPlot::y_for_linear (float p, Metrics const & metrics) const
 void
 AudioPlot::plot_peak (wxGraphicsPath& path, int channel, Metrics const & metrics) const
 {
-	if (_analysis->points (channel) == 0) {
+	if (metrics.first >= metrics.last) {
 		return;
 	}
 
 	_peak[channel] = PointList ();
 
 	float peak = 0;
-	int const N = _analysis->points(channel);
-	for (int i = 0; i < N; ++i) {
-		float const p = get_point(channel, i)[AudioPoint::PEAK];
+	for (int i = metrics.first; i < metrics.last; ++i) {
+		float const p = get_point(channel, i, metrics.level)[AudioPoint::PEAK];
 		peak -= 0.01f * (1 - log10 (_smoothing) / log10 (max_smoothing));
 		if (p > peak) {
 			peak = p;
@@ -319,8 +342,8 @@ AudioPlot::plot_peak (wxGraphicsPath& path, int channel, Metrics const & metrics
 
 		_peak[channel].push_back (
 			Point (
-				wxPoint (metrics.db_label_width + i * metrics.x_scale, y_for_linear (peak, metrics)),
-				DCPTime::from_frames (i * _analysis->samples_per_point(), _analysis->sample_rate()),
+				wxPoint (metrics.db_label_width + (i - metrics.view_start) * metrics.x_scale, y_for_linear (peak, metrics)),
+				DCPTime::from_frames (i * _analysis->samples_per_point(metrics.level), _analysis->sample_rate()),
 				linear_to_db(peak)
 				)
 			);
@@ -338,62 +361,42 @@ AudioPlot::plot_peak (wxGraphicsPath& path, int channel, Metrics const & metrics
 void
 AudioPlot::plot_rms (wxGraphicsPath& path, int channel, Metrics const & metrics) const
 {
-	if (_analysis->points (channel) == 0) {
+	if (metrics.first >= metrics.last) {
 		return;
 	}
 
 	_rms[channel] = PointList();
 
-	list<float> smoothing;
-
-	int const N = _analysis->points(channel);
+	int const N = _analysis->points(channel, metrics.level);
 
-	float const first = get_point(channel, 0)[AudioPoint::RMS];
-	float const last = get_point(channel, N - 1)[AudioPoint::RMS];
+	/* Square of the RMS value of point i, using the first or last point
+	 * for anything off the ends.
+	 */
+	auto square = [this, channel, N, &metrics](int i) {
+		return pow(get_point(channel, min(max(i, 0), N - 1), metrics.level)[AudioPoint::RMS], 2);
+	};
 
 	int const before = _smoothing / 2;
 	int const after = _smoothing - before;
 
-	/* Pre-load the smoothing list */
-	for (int i = 0; i < before; ++i) {
-		smoothing.push_back (first);
-	}
-	for (int i = 0; i < after; ++i) {
-		if (i < N) {
-			smoothing.push_back (get_point(channel, i)[AudioPoint::RMS]);
-		} else {
-			smoothing.push_back (last);
-		}
+	/* Sum of the squares of the points in the window [i - before, i + after) */
+	double sum = 0;
+	for (int i = metrics.first - before; i < metrics.first + after; ++i) {
+		sum += square (i);
 	}
 
-	for (int i = 0; i < N; ++i) {
-
-		int const next_for_window = i + after;
-
-		if (next_for_window < N) {
-			smoothing.push_back (get_point(channel, i)[AudioPoint::RMS]);
-		} else {
-			smoothing.push_back (last);
-		}
-
-		smoothing.pop_front ();
-
-		float p = 0;
-		for (list<float>::const_iterator j = smoothing.begin(); j != smoothing.end(); ++j) {
-			p += pow (*j, 2);
-		}
-
-		if (!smoothing.empty ()) {
-			p = sqrt (p / smoothing.size ());
-		}
+	for (int i = metrics.first; i < metrics.last; ++i) {
+		float const p = sqrt (max(0.0, sum) / _smoothing);
 
 		_rms[channel].push_back (
 			Point (
-				wxPoint (metrics.db_label_width + i * metrics.x_scale, y_for_linear (p, metrics)),
-				DCPTime::from_frames (i * _analysis->samples_per_point(), _analysis->sample_rate()),
+				wxPoint (metrics.db_label_width + (i - metrics.view_start) * metrics.x_scale, y_for_linear (p, metrics)),
+				DCPTime::from_frames (i * _analysis->samples_per_point(metrics.level), _analysis->sample_rate()),
 				linear_to_db(p)
 				)
 			);
+
+		sum += square (i + after) - square (i - before);
 	}
 
 	DCPOMATIC_ASSERT (_rms.find(channel) != _rms.end());
@@ -424,9 +427,9 @@ AudioPlot::set_gain_correction (double gain)
 
 
 AudioPoint
-AudioPlot::get_point (int channel, int point) const
+AudioPlot::get_point (int channel, int point, int level) const
 {
-	auto p = _analysis->get_point (channel, point);
+	auto p = _analysis->get_point (channel, point, level);
 	for (int i = 0; i < AudioPoint::COUNT; ++i) {
 		p[i] *= db_to_linear(_gain_correction);
 	}
@@ -495,6 +498,33 @@ AudioPlot::mouse_moved (wxMouseEvent& ev)
 }
 
 
+/** Zoom in or out around the mouse position */
+void
+AudioPlot::mouse_wheel (wxMouseEvent& ev)
+{
+	if (!_analysis || _analysis->channels() == 0 || _analysis->points(0) == 0 || ev.GetWheelRotation() == 0) {
+		return;
+	}
+
+	/* Don't zoom in further than this many points across the whole plot */
+	double constexpr minimum_view_points = 64;
+
+	double const total = _analysis->points(0);
+	double const view_points = _view_points > 0 ? _view_points : total;
+	double const fraction = min(1.0, max(0.0, double(ev.GetX() - _data_left) / _data_width));
+	double const centre = _view_start + fraction * view_points;
+
+	double const new_points = min(total, max(minimum_view_points, ev.GetWheelRotation() > 0 ? view_points / 2 : view_points * 2));
+	_view_start = min(total - new_points, max(0.0, centre - fraction * new_points));
+	_view_points = new_points < total ? new_points : 0;
+
+	_cursor = boost::none;
+	_peak.clear ();
+	_rms.clear ();
+	Refresh ();
+}
+
+
 void
 AudioPlot::mouse_leave (wxMouseEvent &)
 {
@@ -73,10 +73,11 @@ private:
 	void plot_peak (wxGraphicsPath &, int, Metrics const &) const;
 	void plot_rms (wxGraphicsPath &, int, Metrics const &) const;
 	float y_for_linear (float, Metrics const &) const;
-	AudioPoint get_point (int channel, int point) const;
+	AudioPoint get_point (int channel, int point, int level) const;
 	void left_down ();
 	void mouse_moved (wxMouseEvent& ev);
 	void mouse_leave (wxMouseEvent& ev);
+	void mouse_wheel (wxMouseEvent& ev);
 
 	FilmViewer& _viewer;
 	std::shared_ptr<AudioAnalysis> _analysis;
@@ -87,6 +88,14 @@ private:
 	wxString _message;
 	float _gain_correction;
 
+	/** Index of the first visible level-0 point of the analysis */
+	double _view_start = 0;
+	/** Number of level-0 points that are visible, or 0 to show them all */
+	double _view_points = 0;
+	/** x position and width of the data area when we last painted */
+	int _data_left = 0;
+	int _data_width = 1;
+
 	/** peak values keyed by channel */
 	mutable std::map<int, PointList> _peak;
 	/** RMS values keyed by channel */
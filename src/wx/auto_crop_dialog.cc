@@ -38,14 +38,18 @@ AutoCropDialog::AutoCropDialog (wxWindow* parent, Crop crop)
 	_bottom = add(new SpinCtrl(this, DCPOMATIC_SPIN_CTRL_WIDTH));
 	add (_("Threshold"), true);
 	_threshold = add(new SpinCtrl(this, DCPOMATIC_SPIN_CTRL_WIDTH));
+	add (_("Frames to look at"), true);
+	_samples = add(new SpinCtrl(this, DCPOMATIC_SPIN_CTRL_WIDTH));
 
 	_left->SetRange(0, 4096);
 	_right->SetRange(0, 4096);
 	_top->SetRange(0, 4096);
 	_bottom->SetRange(0, 4096);
+	_samples->SetRange(1, 64);
 
 	set (crop);
 	_threshold->SetValue (std::round(Config::instance()->auto_crop_threshold() * 100));
+	_samples->SetValue (Config::instance()->auto_crop_samples());
 
 	layout ();
 
@@ -54,6 +58,7 @@ AutoCropDialog::AutoCropDialog (wxWindow* parent, Crop crop)
 	_top->Bind (wxEVT_SPINCTRL, [this](wxSpinEvent&) { Changed(get()); });
 	_bottom->Bind (wxEVT_SPINCTRL, [this](wxSpinEvent&) { Changed(get()); });
 	_threshold->Bind (wxEVT_SPINCTRL, [](wxSpinEvent& ev) { Config::instance()->set_auto_crop_threshold(ev.GetPosition() / 100.0); });
+	_samples->Bind (wxEVT_SPINCTRL, [](wxSpinEvent& ev) { Config::instance()->set_auto_crop_samples(ev.GetPosition()); });
 }
 
 
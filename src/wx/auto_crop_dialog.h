@@ -47,6 +47,7 @@ private:
 	SpinCtrl* _top;
 	SpinCtrl* _bottom;
 	SpinCtrl* _threshold;
+	SpinCtrl* _samples;
 };
 
 
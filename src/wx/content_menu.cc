@@ -35,6 +35,7 @@
 #include "lib/content_factory.h"
 #include "lib/constants.h"
 #include "lib/copy_dcp_details_to_film.h"
+#include "lib/cpl_cache.h"
 #include "lib/dcp_content.h"
 #include "lib/dcp_examiner.h"
 #include "lib/examine_content_job.h"
@@ -51,7 +52,6 @@
 #include <dcp/cpl.h>
 #include <dcp/decrypted_kdm.h>
 #include <dcp/exceptions.h>
-#include <dcp/search.h>
 #include <dcp/warnings.h>
 LIBDCP_DISABLE_WARNINGS
 #include <wx/dirdlg.h>
@@ -166,7 +166,7 @@ ContentMenu::popup (weak_ptr<Film> film, ContentList c, TimelineContentViewList
 			_set_dcp_settings->Enable (static_cast<bool>(dcp));
 			_set_dcp_markers->Enable(static_cast<bool>(dcp));
 			try {
-				auto cpls = dcp::find_and_resolve_cpls (dcp->directories(), true);
+				auto cpls = find_and_resolve_cpls_cached(dcp->directories(), true);
 				_choose_cpl->Enable (cpls.size() > 1);
 				/* We can't have 0 as a menu item ID on OS X */
 				int id = 1;
@@ -428,7 +428,7 @@ ContentMenu::kdm ()
 		return;
 	}
 
-	auto cpls = dcp::find_and_resolve_cpls (dcp->directories(), true);
+	auto cpls = find_and_resolve_cpls_cached(dcp->directories(), true);
 	bool const kdm_matches_any_cpl = std::any_of(cpls.begin(), cpls.end(), [kdm](shared_ptr<const dcp::CPL> cpl) { return cpl->id() == kdm->cpl_id(); });
 	bool const kdm_matches_selected_cpl = dcp->cpl() || kdm->cpl_id() == dcp->cpl().get();
 
@@ -520,7 +520,7 @@ ContentMenu::cpl_selected (wxCommandEvent& ev)
 	auto dcp = dynamic_pointer_cast<DCPContent> (_content.front());
 	DCPOMATIC_ASSERT (dcp);
 
-	auto cpls = dcp::find_and_resolve_cpls (dcp->directories(), true);
+	auto cpls = find_and_resolve_cpls_cached(dcp->directories(), true);
 	DCPOMATIC_ASSERT (ev.GetId() > 0);
 	DCPOMATIC_ASSERT (ev.GetId() <= int (cpls.size()));
 
@@ -559,6 +559,10 @@ ContentMenu::auto_crop ()
 	};
 
 	auto guess_crop_for_content = [this, film]() {
+		auto const samples = Config::instance()->auto_crop_samples();
+		if (samples > 1) {
+			return guess_crop_sampled(film, _content.front(), Config::instance()->auto_crop_threshold(), samples);
+		}
 		auto position = _viewer.position_in_content(_content.front()).get_value_or(
 			ContentTime::from_frames(_content.front()->video->length(), _content.front()->video_frame_rate().get_value_or(24))
 			);
@@ -577,7 +581,7 @@ ContentMenu::auto_crop ()
 	_auto_crop_config_connection = Config::instance()->Changed.connect([this, guess_crop_for_content, update_viewer](Config::Property property) {
 		auto film = _film.lock();
 		DCPOMATIC_ASSERT (film);
-		if (property == Config::AUTO_CROP_THRESHOLD) {
+		if (property == Config::AUTO_CROP_THRESHOLD || property == Config::AUTO_CROP_SAMPLES) {
 			auto const crop = guess_crop_for_content();
 			_auto_crop_dialog->set(crop);
 			update_viewer(crop);
@@ -586,6 +590,10 @@ ContentMenu::auto_crop ()
 
 	/* Also update the dialog and view when we're looking at a different frame */
 	_auto_crop_viewer_connection = _viewer.ImageChanged.connect([this, guess_crop_for_content, update_viewer](shared_ptr<PlayerVideo>) {
+		if (Config::instance()->auto_crop_samples() > 1) {
+			/* The guess does not depend on what we are looking at */
+			return;
+		}
 		auto const crop = guess_crop_for_content();
 		_auto_crop_dialog->set(crop);
 		update_viewer(crop);
@@ -202,10 +202,30 @@ public:
 		bool error;
 	};
 
+	/** Set the items to show, refreshing only the rows which have changed
+	 *  if the number of items is the same as before.
+	 */
 	void set(vector<Item> const& items)
 	{
-		_items = items;
-		SetItemCount(items.size());
+		if (items.size() != _items.size()) {
+			_items = items;
+			SetItemCount(items.size());
+			Refresh();
+			return;
+		}
+
+		for (size_t i = 0; i < items.size(); ++i) {
+			auto const& old_item = _items[i];
+			auto const& new_item = items[i];
+			if (
+				old_item.text != new_item.text ||
+				old_item.error != new_item.error ||
+				old_item.content.lock() != new_item.content.lock()
+			   ) {
+				_items[i] = new_item;
+				RefreshItem(i);
+			}
+		}
 	}
 
 	wxString OnGetItemText(long item, long) const override
@@ -862,7 +882,7 @@ void
 ContentPanel::setup ()
 {
 	if (!_film) {
-		_content->DeleteAllItems ();
+		_content->set({});
 		setup_sensitivity ();
 		return;
 	}
@@ -22,34 +22,35 @@
 #include "content_view.h"
 #include "wx_util.h"
 #include "lib/config.h"
-#include "lib/content_factory.h"
 #include "lib/cross.h"
 #include "lib/dcp_content.h"
 #include "lib/dcpomatic_assert.h"
-#include "lib/examine_content_job.h"
-#include "lib/job_manager.h"
-#include "lib/util.h"
-#include <dcp/exceptions.h>
+#include "lib/ui_watchdog.h"
 #include <dcp/filesystem.h>
 #include <dcp/warnings.h>
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 LIBDCP_DISABLE_WARNINGS
-#include <wx/progdlg.h>
+#include <wx/fswatcher.h>
 LIBDCP_ENABLE_WARNINGS
 
 
-using std::cout;
 using std::dynamic_pointer_cast;
-using std::list;
-using std::make_shared;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 using std::weak_ptr;
 using boost::optional;
+#if BOOST_VERSION >= 106100
+using namespace boost::placeholders;
+#endif
 using namespace dcpomatic;
 
 
+/** Time in milliseconds to wait after the last change to the content directory before looking at it again */
+static constexpr int REFRESH_DELAY = 5000;
+
+
 ContentView::ContentView (wxWindow* parent)
 	: wxListCtrl (parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxLC_NO_HEADER)
 {
@@ -58,6 +59,19 @@ ContentView::ContentView (wxWindow* parent)
 	AppendColumn (wxT(""), wxLIST_FORMAT_LEFT, 80);
 	/* annotation text */
 	AppendColumn (wxT(""), wxLIST_FORMAT_LEFT, 580);
+
+	_refreshed_connection = _library.Refreshed.connect(boost::bind(&ContentView::set_content, this, _1));
+	_error_connection = _library.Error.connect(boost::bind(&ContentView::library_error, this, _1, _2));
+
+	_refresh_timer.Bind (wxEVT_TIMER, [this](wxTimerEvent&) {
+		_library.refresh(_directory, false);
+	});
+}
+
+
+ContentView::~ContentView ()
+{
+	_refresh_timer.Stop ();
 }
 
 
@@ -74,69 +88,94 @@ ContentView::selected () const
 }
 
 
+/** Show what we knew about the content directory last time, then look at it
+ *  again in the background to pick up anything that has changed.
+ */
 void
 ContentView::update ()
 {
-	using namespace boost::filesystem;
+	UIWatchdog::Activity activity("ContentView::update");
 
-	DeleteAllItems ();
-	_content.clear ();
 	auto dir = Config::instance()->player_content_directory();
 	if (!dir || !dcp::filesystem::is_directory(*dir)) {
 		dir = home_directory ();
 	}
 
-	wxProgressDialog progress (_("DCP-o-matic"), _("Reading content directory"));
-	auto jm = JobManager::instance ();
-
-	list<shared_ptr<ExamineContentJob>> jobs;
-
-	for (auto i: directory_iterator(*dir)) {
-		try {
-			progress.Pulse ();
-
-			shared_ptr<Content> content;
-			if (is_directory(i) && contains_assetmap(i)) {
-				content = make_shared<DCPContent>(i);
-			} else if (i.path().extension() == ".mp4") {
-				auto all_content = content_factory(i);
-				if (!all_content.empty()) {
-					content = all_content[0];
-				}
-			}
-
-			if (content) {
-				auto job = make_shared<ExamineContentJob>(shared_ptr<Film>(), content);
-				jm->add (job);
-				jobs.push_back (job);
-			}
-		} catch (boost::filesystem::filesystem_error& e) {
-			/* Never mind */
-		} catch (dcp::ReadError& e) {
-			/* Never mind */
-		}
+	_directory = *dir;
+	set_content (_library.load(_directory));
+	_library.refresh (_directory, true);
+
+	/* wxFileSystemWatcher needs the event loop to be running, which it may not be yet */
+	CallAfter ([this]() {
+		watch (_directory);
+	});
+}
+
+
+void
+ContentView::set_content (vector<shared_ptr<Content>> content)
+{
+	boost::optional<boost::filesystem::path> selected_path;
+	if (auto s = selected()) {
+		selected_path = s->path(0);
 	}
 
-	while (jm->work_to_do()) {
-		if (!progress.Pulse()) {
-			/* user pressed cancel */
-			for (auto i: jm->get()) {
-				i->cancel();
-			}
-			return;
+	auto digests = [](vector<shared_ptr<Content>> const& list) -> vector<string> {
+		vector<string> d;
+		for (auto i: list) {
+			d.push_back(i->digest());
 		}
-		dcpomatic_sleep_seconds (1);
-	}
+		return d;
+	};
+
+	bool const changed = digests(content) != digests(_content);
+
+	DeleteAllItems ();
+	_content = content;
 
-	/* Add content from successful jobs and report errors */
-	for (auto i: jobs) {
-		if (i->finished_in_error()) {
-			error_dialog(this, std_to_wx(i->error_summary()) + ".\n", std_to_wx(i->error_details()));
-		} else {
-			add (i->content());
-			_content.push_back (i->content());
+	for (auto i: _content) {
+		add (i);
+		if (selected_path && i->path(0) == *selected_path) {
+			SetItemState (GetItemCount() - 1, wxLIST_STATE_SELECTED, wxLIST_STATE_SELECTED);
 		}
 	}
+
+	if (changed) {
+		Changed ();
+	}
+}
+
+
+void
+ContentView::library_error (string summary, string details)
+{
+	error_dialog(this, std_to_wx(summary) + ".\n", std_to_wx(details));
+}
+
+
+void
+ContentView::watch (boost::filesystem::path directory)
+{
+#if wxUSE_FSWATCHER
+	if (!_watcher) {
+		_watcher.reset (new wxFileSystemWatcher());
+		_watcher->SetOwner (this);
+		Bind (wxEVT_FSWATCHER, boost::bind(&ContentView::file_system_changed, this, _1));
+	}
+
+	_watcher->RemoveAll ();
+	_watcher->AddTree (wxFileName::DirName(std_to_wx(directory.string())), wxFSW_EVENT_CREATE | wxFSW_EVENT_DELETE | wxFSW_EVENT_RENAME | wxFSW_EVENT_MODIFY);
+#else
+	(void) directory;
+#endif
+}
+
+
+void
+ContentView::file_system_changed (wxFileSystemWatcherEvent&)
+{
+	/* Wait for things to settle down (e.g. for a DCP to finish being copied in) before looking */
+	_refresh_timer.StartOnce (REFRESH_DELAY);
 }
 
 
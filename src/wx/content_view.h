@@ -19,31 +19,53 @@
 */
 
 
+#include "lib/content_library.h"
 #include "lib/content_store.h"
 #include <dcp/warnings.h>
 LIBDCP_DISABLE_WARNINGS
 #include <wx/listctrl.h>
+#include <wx/timer.h>
 LIBDCP_ENABLE_WARNINGS
+#include <boost/signals2.hpp>
+#include <memory>
 #include <vector>
 
 
 class Content;
 class Film;
+class wxFileSystemWatcher;
+class wxFileSystemWatcherEvent;
 
 
 class ContentView : public wxListCtrl, public ContentStore
 {
 public:
 	ContentView (wxWindow* parent);
+	~ContentView ();
 
 	std::shared_ptr<Content> selected () const;
 	void update ();
 
 	std::shared_ptr<Content> get (std::string digest) const override;
 
+	/** Emitted when the content that we are showing changes */
+	boost::signals2::signal<void ()> Changed;
+
 private:
 	void add (std::shared_ptr<Content> content);
+	void set_content (std::vector<std::shared_ptr<Content>> content);
+	void library_error (std::string summary, std::string details);
+	void watch (boost::filesystem::path directory);
+	void file_system_changed (wxFileSystemWatcherEvent& ev);
 
 	std::weak_ptr<Film> _film;
 	std::vector<std::shared_ptr<Content>> _content;
+	ContentLibrary _library;
+	/** Directory that we are showing */
+	boost::filesystem::path _directory;
+	std::unique_ptr<wxFileSystemWatcher> _watcher;
+	/** Timer to refresh the library once changes to the directory have stopped for a while */
+	wxTimer _refresh_timer;
+	boost::signals2::scoped_connection _refreshed_connection;
+	boost::signals2::scoped_connection _error_connection;
 };
@@ -159,8 +159,12 @@ public:
 	void view_changed ()
 	{
 		_ignore_model_changes = true;
-		for (size_t i = 0; i < _content.size(); ++i) {
-			boost::bind (_model_setter, _part (_content[i].get()).get(), _view_to_model (wx_get (_wrapped))) ();
+		{
+			/* Signal the changes once all the content has been changed */
+			ContentChangeSignalBatch batch;
+			for (size_t i = 0; i < _content.size(); ++i) {
+				boost::bind (_model_setter, _part (_content[i].get()).get(), _view_to_model (wx_get (_wrapped))) ();
+			}
 		}
 		if (_view_changed) {
 			_view_changed ();
@@ -204,6 +208,7 @@ private:
 	void button_clicked ()
 	{
 		U const v = boost::bind (_model_getter, _part(_content.front().get()).get())();
+		ContentChangeSignalBatch batch;
 		for (auto const& i: _content) {
 			boost::bind (_model_setter, _part(i.get()).get(), v)();
 		}
@@ -191,6 +191,10 @@ Controls::stopped ()
 void
 Controls::update_position ()
 {
+	if (_scrub_position && std::chrono::steady_clock::now() - _last_scrub > std::chrono::milliseconds(250)) {
+		refine_scrub ();
+	}
+
 	if (!_slider_being_moved && !_viewer.pending_idle_get()) {
 		update_position_label ();
 		update_position_slider ();
@@ -237,6 +241,15 @@ Controls::slider_moved (bool page)
 		accurate = true;
 	}
 	_viewer.seek(t, accurate);
+	if (accurate) {
+		_scrub_position = boost::none;
+	} else {
+		/* This seek will show the nearest frame that can be found quickly; we'll refine
+		   it with an accurate seek when the slider stops.
+		*/
+		_scrub_position = t;
+		_last_scrub = std::chrono::steady_clock::now();
+	}
 	update_position_label ();
 }
 
@@ -244,12 +257,27 @@ Controls::slider_moved (bool page)
 void
 Controls::slider_released ()
 {
+	refine_scrub ();
 	/* Restart after a drag */
 	_viewer.resume();
 	_slider_being_moved = false;
 }
 
 
+/** Make an accurate seek to the position of the last inaccurate one made by moving the slider */
+void
+Controls::refine_scrub ()
+{
+	if (!_scrub_position) {
+		return;
+	}
+
+	auto const t = *_scrub_position;
+	_scrub_position = boost::none;
+	_viewer.seek(t, true);
+}
+
+
 void
 Controls::update_position_slider ()
 {
@@ -409,6 +437,7 @@ Controls::set_film (shared_ptr<Film> film)
 	}
 
 	_film = film;
+	_scrub_position = boost::none;
 
 	_markers->set_film (_film);
 
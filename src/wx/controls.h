@@ -31,6 +31,7 @@ LIBDCP_DISABLE_WARNINGS
 #include <wx/wx.h>
 LIBDCP_ENABLE_WARNINGS
 #include <boost/signals2.hpp>
+#include <chrono>
 
 
 class CheckBox;
@@ -94,6 +95,7 @@ private:
 	void forward_clicked (wxKeyboardState &);
 	void slider_moved (bool page);
 	void slider_released ();
+	void refine_scrub ();
 	void frame_number_clicked ();
 	void jump_to_selected_clicked ();
 	void timecode_clicked ();
@@ -108,6 +110,12 @@ private:
 	typedef std::pair<std::shared_ptr<dcp::CPL>, boost::filesystem::path> CPL;
 
 	bool _slider_being_moved = false;
+	/** Position of the last inaccurate seek made by moving the slider, which we will
+	 *  make accurate once the slider has stopped moving.
+	 */
+	boost::optional<dcpomatic::DCPTime> _scrub_position;
+	/** Time of the last inaccurate seek made by moving the slider */
+	std::chrono::steady_clock::time_point _last_scrub;
 
 	CheckBox* _outline_content = nullptr;
 	wxChoice* _eye = nullptr;
@@ -473,6 +473,9 @@ DCPPanel::film_changed(FilmProperty p)
 	case FilmProperty::REENCODE_J2K:
 		checked_set (_reencode_j2k, _film->reencode_j2k());
 		break;
+	case FilmProperty::VARIABLE_J2K_BANDWIDTH:
+		checked_set (_variable_j2k_bandwidth, _film->variable_j2k_bandwidth());
+		break;
 	case FilmProperty::INTEROP:
 		set_standard();
 		setup_dcp_name ();
@@ -650,6 +653,7 @@ DCPPanel::set_film (shared_ptr<Film> film)
 	film_changed(FilmProperty::REEL_TYPE);
 	film_changed(FilmProperty::REEL_LENGTH);
 	film_changed(FilmProperty::REENCODE_J2K);
+	film_changed(FilmProperty::VARIABLE_J2K_BANDWIDTH);
 	film_changed(FilmProperty::AUDIO_LANGUAGE);
 	film_changed(FilmProperty::AUDIO_FRAME_RATE);
 	film_changed(FilmProperty::LIMIT_TO_SMPTE_BV20);
@@ -706,6 +710,7 @@ DCPPanel::setup_sensitivity ()
 		);
 
 	_reencode_j2k->Enable           (_generally_sensitive && _film);
+	_variable_j2k_bandwidth->Enable (_generally_sensitive && _film && !_film->references_dcp_video());
 	_show_audio->Enable             (_generally_sensitive && _film);
 }
 
@@ -761,6 +766,17 @@ DCPPanel::reencode_j2k_changed ()
 }
 
 
+void
+DCPPanel::variable_j2k_bandwidth_changed ()
+{
+	if (!_film) {
+		return;
+	}
+
+	_film->set_variable_j2k_bandwidth (_variable_j2k_bandwidth->GetValue());
+}
+
+
 void
 DCPPanel::config_changed (Config::Property p)
 {
@@ -827,6 +843,8 @@ DCPPanel::make_video_panel ()
 	_j2k_bandwidth = new SpinCtrl (panel, DCPOMATIC_SPIN_CTRL_WIDTH);
 	_mbits_label = create_label (panel, _("Mbit/s"), false);
 
+	_variable_j2k_bandwidth = new CheckBox (panel, _("Give more bandwidth to more detailed frames"));
+	_variable_j2k_bandwidth->SetToolTip (_("The film's video is examined while it is checked for hints.  Frames with more detail are given more of the JPEG2000 bandwidth, and simpler ones less, keeping the average the same."));
 	_reencode_j2k = new CheckBox (panel, _("Re-encode JPEG2000 data from input"));
 
 	_container->Bind	 (wxEVT_CHOICE,	  boost::bind(&DCPPanel::container_changed, this));
@@ -838,6 +856,7 @@ DCPPanel::make_video_panel ()
 	_j2k_bandwidth->Bind	 (wxEVT_TEXT,     boost::bind(&DCPPanel::j2k_bandwidth_changed, this));
 	_resolution->Bind        (wxEVT_CHOICE,   boost::bind(&DCPPanel::resolution_changed, this));
 	_three_d->bind(&DCPPanel::three_d_changed, this);
+	_variable_j2k_bandwidth->bind(&DCPPanel::variable_j2k_bandwidth_changed, this);
 	_reencode_j2k->bind(&DCPPanel::reencode_j2k_changed, this);
 
 	for (auto i: Ratio::containers()) {
@@ -898,6 +917,8 @@ DCPPanel::add_video_panel_to_grid ()
 	add_label_to_sizer (s, _mbits_label, false, 0, wxLEFT | wxALIGN_CENTER_VERTICAL);
 	_video_grid->Add (s, wxGBPosition(r, 1), wxDefaultSpan);
 	++r;
+	_video_grid->Add (_variable_j2k_bandwidth, wxGBPosition(r, 0), wxGBSpan(1, 2));
+	++r;
 	_video_grid->Add (_reencode_j2k, wxGBPosition(r, 0), wxGBSpan(1, 2));
 }
 
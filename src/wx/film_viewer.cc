@@ -59,6 +59,8 @@ extern "C" {
 LIBDCP_DISABLE_WARNINGS
 #include <wx/tglbtn.h>
 LIBDCP_ENABLE_WARNINGS
+#include <cmath>
+#include <functional>
 #include <iomanip>
 
 
@@ -77,6 +79,10 @@ using dcp::Size;
 using namespace dcpomatic;
 
 
+/** Number of frames before the one that we want to fetch (and cache) when seeking backwards */
+static constexpr int BACK_FILL_FRAMES = 12;
+
+
 static
 int
 rtaudio_callback (void* out, void *, unsigned int frames, double, RtAudioStreamStatus, void* data)
@@ -103,7 +109,8 @@ FilmViewer::FilmViewer (wxWindow* p)
 #endif
 
 	_video_view->Sized.connect (boost::bind(&FilmViewer::video_view_sized, this));
-	_video_view->TooManyDropped.connect (boost::bind(boost::ref(TooManyDropped)));
+	_video_view->TooManyDropped.connect (boost::bind(&FilmViewer::video_view_too_many_dropped, this));
+	_video_view->CaughtUp.connect (boost::bind(&FilmViewer::video_view_caught_up, this));
 
 	set_film (shared_ptr<Film>());
 
@@ -172,8 +179,9 @@ FilmViewer::set_film (shared_ptr<Film> film)
 	try {
 		_player.emplace(_film, _optimise_for_j2k ? Image::Alignment::COMPACT : Image::Alignment::PADDED);
 		_player->set_fast ();
-		if (_dcp_decode_reduction) {
-			_player->set_dcp_decode_reduction (_dcp_decode_reduction);
+		_player->set_reduce_ffmpeg_decode (Config::instance()->reduce_preview_ffmpeg_decode());
+		if (auto reduction = effective_dcp_decode_reduction()) {
+			_player->set_dcp_decode_reduction (reduction);
 		}
 	} catch (bad_alloc &) {
 		error_dialog (_video_view->get(), _("There is not enough free memory to do that."));
@@ -210,6 +218,8 @@ FilmViewer::destroy_butler()
 {
 	suspend ();
 	_butler.reset ();
+	_video_view->clear_cache ();
+	_pending_butler_seek = boost::none;
 }
 
 
@@ -231,19 +241,28 @@ void
 FilmViewer::create_butler()
 {
 #if wxCHECK_VERSION(3, 1, 0)
-	auto const j2k_gl_optimised = dynamic_pointer_cast<GLVideoView>(_video_view) && _optimise_for_j2k;
+	auto const gl = static_cast<bool>(dynamic_pointer_cast<GLVideoView>(_video_view));
 #else
-	auto const j2k_gl_optimised = false;
+	auto const gl = false;
 #endif
+	auto const j2k_gl_optimised = gl && _optimise_for_j2k;
+
+	/* The GL view converts some YUV formats to RGB in its shader, so we need not do it here */
+	std::function<AVPixelFormat (AVPixelFormat)> pixel_format = boost::bind(&PlayerVideo::force, AV_PIX_FMT_RGB24);
+	if (gl) {
+		pixel_format = &PlayerVideo::keep_yuv_or_rgb;
+	}
 
 	DCPOMATIC_ASSERT(_player);
 
+	_video_view->forget_prefetched ();
+	_video_view->set_cache_memory_limit (static_cast<size_t>(Config::instance()->preview_frame_cache_size()) * 1024 * 1024);
 	_butler = std::make_shared<Butler>(
 		_film,
 		*_player,
 		Config::instance()->audio_mapping(_audio_channels),
 		_audio_channels,
-		boost::bind(&PlayerVideo::force, AV_PIX_FMT_RGB24),
+		pixel_format,
 		VideoRange::FULL,
 		j2k_gl_optimised ? Image::Alignment::COMPACT : Image::Alignment::PADDED,
 		true,
@@ -277,6 +296,7 @@ void
 FilmViewer::set_eyes (Eyes e)
 {
 	_video_view->set_eyes (e);
+	_video_view->clear_cache ();
 	slow_refresh ();
 }
 
@@ -397,6 +417,14 @@ FilmViewer::start ()
 		idle_handler ();
 	}
 
+	if (_pending_butler_seek) {
+		/* The frame on show came from the cache, so the butler needs to catch up with it */
+		seek_butler (*_pending_butler_seek, true);
+		while (_idle_get) {
+			idle_handler ();
+		}
+	}
+
 	/* Take the video view's idea of position as our `playhead' and start the
 	   audio stream (which is the timing reference) there.
          */
@@ -425,6 +453,13 @@ FilmViewer::stop ()
 
 	_playing = false;
 	_video_view->stop ();
+
+	auto const pacing = _video_view->pacing ();
+	LOG_GENERAL (
+		"Playback pacing: %1 frames drawn, %2 late (worst by %3ms), %4 dropped",
+		pacing.presented, pacing.late, std::lrint(pacing.worst_lateness * 1000), pacing.missed
+		);
+
 	Stopped ();
 
 	_video_view->rethrow ();
@@ -451,6 +486,9 @@ FilmViewer::player_change (ChangeType type, int property, bool frequent)
 void
 FilmViewer::player_change (vector<int> properties)
 {
+	/* Any frames that we have cached may now be wrong */
+	_video_view->clear_cache ();
+
 	calculate_sizes ();
 
 	bool try_quick_refresh = false;
@@ -515,7 +553,9 @@ FilmViewer::film_length_change ()
 void
 FilmViewer::slow_refresh ()
 {
-	seek (_video_view->position(), true);
+	if (_butler) {
+		seek_butler (_video_view->position(), true);
+	}
 }
 
 
@@ -571,10 +611,49 @@ FilmViewer::seek (DCPTime t, bool accurate)
 		t = _film->length() - one_video_frame();
 	}
 
+	if (!_playing) {
+		if (_video_view->use_cached_frame(t)) {
+			/* Show the frame that we already have and leave the butler where it is until it is needed */
+			_closed_captions_dialog->clear ();
+			_pending_butler_seek = t;
+			request_idle_display_next_frame ();
+			return;
+		}
+
+		if (!_pending_butler_seek && !_idle_get && t == _video_view->position() + one_video_frame()) {
+			/* The butler is already on its way to the next frame so there's no need to seek it */
+			_closed_captions_dialog->clear ();
+			request_idle_display_next_frame ();
+			return;
+		}
+	}
+
+	seek_butler (t, accurate);
+}
+
+
+/** Seek the butler (rather than just finding the frame in our cache) */
+void
+FilmViewer::seek_butler (DCPTime t, bool accurate)
+{
+	_pending_butler_seek = boost::none;
+
 	suspend ();
 
 	_closed_captions_dialog->clear ();
-	_butler->seek (t, accurate);
+
+	auto const back_fill = DCPTime::from_frames(BACK_FILL_FRAMES, _film->video_frame_rate());
+	if (!_playing && accurate && t < _video_view->position() && t > back_fill) {
+		/* We are going backwards, so get some frames before the one that we want
+		   while we are here, so that the next few steps back need no seek.
+		*/
+		_butler->seek (t - back_fill, true);
+		_video_view->forget_prefetched ();
+		_video_view->cache_frames_until (t);
+	} else {
+		_butler->seek (t, accurate);
+		_video_view->forget_prefetched ();
+	}
 
 	if (!_playing) {
 		/* We're not playing, so let the GUI thread get on and
@@ -735,15 +814,78 @@ FilmViewer::set_dcp_decode_reduction (optional<int> reduction)
 {
 	_dcp_decode_reduction = reduction;
 	if (_player) {
-		_player->set_dcp_decode_reduction (reduction);
+		_player->set_dcp_decode_reduction (effective_dcp_decode_reduction());
 	}
 }
 
 
+/** @return the DCP decode reduction that is actually being used, which may be higher than
+ *  the one given to set_dcp_decode_reduction if adaptive reduction is on.
+ */
 optional<int>
 FilmViewer::dcp_decode_reduction () const
 {
-	return _dcp_decode_reduction;
+	return effective_dcp_decode_reduction ();
+}
+
+
+optional<int>
+FilmViewer::effective_dcp_decode_reduction () const
+{
+	if (!_adaptive_reduction) {
+		return _dcp_decode_reduction;
+	}
+
+	return max(_dcp_decode_reduction.get_value_or(0), *_adaptive_reduction);
+}
+
+
+void
+FilmViewer::set_adaptive_dcp_decode_reduction (bool adaptive)
+{
+	_adaptive_dcp_decode_reduction = adaptive;
+	if (!adaptive && _adaptive_reduction) {
+		_adaptive_reduction = boost::none;
+		if (_player) {
+			_player->set_dcp_decode_reduction (effective_dcp_decode_reduction());
+		}
+	}
+}
+
+
+void
+FilmViewer::video_view_too_many_dropped ()
+{
+	/* Quarter resolution is the lowest that we offer in the UI */
+	int constexpr maximum_reduction = 2;
+
+	auto const current = effective_dcp_decode_reduction().get_value_or(0);
+	if (!_adaptive_dcp_decode_reduction || !_player || current >= maximum_reduction) {
+		TooManyDropped ();
+		return;
+	}
+
+	_adaptive_reduction = current + 1;
+	LOG_GENERAL ("Dropping too many frames; raising DCP decode reduction to %1", *_adaptive_reduction);
+	_player->set_dcp_decode_reduction (effective_dcp_decode_reduction());
+}
+
+
+void
+FilmViewer::video_view_caught_up ()
+{
+	if (!_adaptive_reduction || !_player || !_playing) {
+		return;
+	}
+
+	if (*_adaptive_reduction - 1 <= _dcp_decode_reduction.get_value_or(0)) {
+		_adaptive_reduction = boost::none;
+	} else {
+		_adaptive_reduction = *_adaptive_reduction - 1;
+	}
+
+	LOG_GENERAL ("Playback has caught up; DCP decode reduction is now %1", effective_dcp_decode_reduction().get_value_or(0));
+	_player->set_dcp_decode_reduction (effective_dcp_decode_reduction());
 }
 
 
@@ -824,6 +966,13 @@ FilmViewer::gets () const
 }
 
 
+PresentationScheduler::Statistics
+FilmViewer::pacing () const
+{
+	return _video_view->pacing ();
+}
+
+
 void
 FilmViewer::image_changed (shared_ptr<PlayerVideo> pv)
 {
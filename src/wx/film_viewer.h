@@ -95,6 +95,11 @@ public:
 	void set_coalesce_player_changes (bool c);
 	void set_dcp_decode_reduction (boost::optional<int> reduction);
 	boost::optional<int> dcp_decode_reduction () const;
+	/** @param adaptive true to raise the DCP decode reduction automatically when we are
+	 *  dropping frames, and lower it again (to no less than the one set by set_dcp_decode_reduction)
+	 *  when playback has caught up.
+	 */
+	void set_adaptive_dcp_decode_reduction (bool adaptive);
 	void set_outline_content (bool o);
 	void set_outline_subtitles (boost::optional<dcpomatic::Rect<double>>);
 	void set_eyes (Eyes e);
@@ -111,6 +116,7 @@ public:
 	int dropped () const;
 	int errored () const;
 	int gets () const;
+	PresentationScheduler::Statistics pacing () const;
 
 	int audio_callback (void* out, unsigned int frames);
 
@@ -157,6 +163,9 @@ public:
 private:
 
 	void video_view_sized ();
+	void video_view_too_many_dropped ();
+	void video_view_caught_up ();
+	boost::optional<int> effective_dcp_decode_reduction () const;
 	void calculate_sizes ();
 	void player_change (ChangeType type, int, bool);
 	void player_change (std::vector<int> properties);
@@ -164,6 +173,7 @@ private:
 	void request_idle_display_next_frame ();
 	void film_change(ChangeType, FilmProperty);
 	void destroy_butler();
+	void seek_butler (dcpomatic::DCPTime t, bool accurate);
 	void create_butler();
 	void destroy_and_maybe_create_butler();
 	void config_changed (Config::Property);
@@ -196,6 +206,9 @@ private:
 	int _latency_history_count = 0;
 
 	boost::optional<int> _dcp_decode_reduction;
+	bool _adaptive_dcp_decode_reduction = false;
+	/** reduction that we have chosen ourselves because playback was falling behind, if any */
+	boost::optional<int> _adaptive_reduction;
 
 	/** true to assume that this viewer is only being used for JPEG2000 sources
 	 *  so it can optimise accordingly.
@@ -213,6 +226,10 @@ private:
 
 	/** true if an get() is required next time we are idle */
 	bool _idle_get = false;
+	/** If set, the frame on show came from the video view's cache and the butler
+	 *  must be seeked to this time before we next get anything from it.
+	 */
+	boost::optional<dcpomatic::DCPTime> _pending_butler_seek;
 
 	boost::optional<dcpomatic::Rect<float>> _crop_guess;
 
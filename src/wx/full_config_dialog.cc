@@ -693,13 +693,41 @@ private:
 
 		_panel->GetSizer()->Add (_servers_list, 1, wxEXPAND | wxALL, _border);
 
+		auto table = new wxFlexGridSizer (2, DCPOMATIC_SIZER_X_GAP, DCPOMATIC_SIZER_Y_GAP);
+		table->AddGrowableCol (1, 1);
+		_panel->GetSizer()->Add (table, 0, wxALL | wxEXPAND, _border);
+
+		add_label_to_sizer (table, _panel, _("Get servers from coordinator"), true, 0, wxLEFT | wxRIGHT | wxALIGN_CENTRE_VERTICAL);
+		_coordinator = new wxTextCtrl (_panel, wxID_ANY);
+		table->Add (_coordinator, 1, wxEXPAND);
+
+		add_label_to_sizer (table, _panel, _("Priority with coordinator"), true, 0, wxLEFT | wxRIGHT | wxALIGN_CENTRE_VERTICAL);
+		_coordinator_priority = new wxSpinCtrl (_panel);
+		_coordinator_priority->SetRange (1, 100);
+		table->Add (_coordinator_priority);
+
 		_use_any_servers->bind(&EncodingServersPage::use_any_servers_changed, this);
+		_coordinator->Bind (wxEVT_TEXT, boost::bind(&EncodingServersPage::coordinator_changed, this));
+		_coordinator_priority->Bind (wxEVT_SPINCTRL, boost::bind(&EncodingServersPage::coordinator_priority_changed, this));
 	}
 
 	void config_changed () override
 	{
-		checked_set (_use_any_servers, Config::instance()->use_any_servers ());
+		auto config = Config::instance ();
+
+		checked_set (_use_any_servers, config->use_any_servers ());
 		_servers_list->refresh ();
+		checked_set (_coordinator, config->encode_server_coordinator());
+		checked_set (_coordinator_priority, config->encode_server_coordinator_priority());
+		setup_sensitivity ();
+	}
+
+	void setup_sensitivity ()
+	{
+		bool const coordinator = !Config::instance()->encode_server_coordinator().empty();
+		_use_any_servers->Enable (!coordinator);
+		_servers_list->Enable (!coordinator);
+		_coordinator_priority->Enable (coordinator);
 	}
 
 	void use_any_servers_changed ()
@@ -707,6 +735,16 @@ private:
 		Config::instance()->set_use_any_servers (_use_any_servers->GetValue ());
 	}
 
+	void coordinator_changed ()
+	{
+		Config::instance()->set_encode_server_coordinator (wx_to_std(_coordinator->GetValue()));
+	}
+
+	void coordinator_priority_changed ()
+	{
+		Config::instance()->set_encode_server_coordinator_priority (_coordinator_priority->GetValue());
+	}
+
 	string server_column (string s)
 	{
 		return s;
@@ -714,6 +752,8 @@ private:
 
 	CheckBox* _use_any_servers;
 	EditableList<string, ServerDialog>* _servers_list;
+	wxTextCtrl* _coordinator;
+	wxSpinCtrl* _coordinator_priority;
 };
 
 
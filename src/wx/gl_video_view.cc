@@ -37,7 +37,13 @@
 #include "lib/exceptions.h"
 #include "lib/image.h"
 #include "lib/player_video.h"
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+#include <wx/display.h>
+LIBDCP_ENABLE_WARNINGS
 #include <boost/bind/bind.hpp>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 #ifdef DCPOMATIC_OSX
@@ -195,11 +201,16 @@ static constexpr char fragment_source[] =
 "in vec2 TexCoord;\n"
 "\n"
 "uniform sampler2D texture_sampler;\n"
+/* U and V planes when drawing YUV; texture_sampler then has the Y plane */
+"uniform sampler2D u_texture_sampler;\n"
+"uniform sampler2D v_texture_sampler;\n"
 /* type = 0: draw outline content rectangle
  * type = 1: draw crop guess rectangle
  * type = 2: draw XYZ image
  * type = 3: draw RGB image (with sRGB/Rec709 primaries)
  * type = 4: draw RGB image (converting from Rec2020 primaries)
+ * type = 5: draw full-range YUV image (with sRGB/Rec709 primaries)
+ * type = 6: draw full-range YUV image (converting from Rec2020 primaries)
  * See FragmentType enum below.
  */
 "uniform int type = 0;\n"
@@ -207,6 +218,9 @@ static constexpr char fragment_source[] =
 "uniform vec4 crop_guess_colour;\n"
 "uniform mat4 xyz_rec709_colour_conversion;\n"
 "uniform mat4 rec2020_rec709_colour_conversion;\n"
+"uniform mat3 yuv_rgb_colour_conversion;\n"
+/* Amount to multiply YUV samples by to get them in the range 0-1 */
+"uniform float yuv_scale;\n"
 "\n"
 "out vec4 FragColor;\n"
 "\n"
@@ -260,6 +274,16 @@ static constexpr char fragment_source[] =
 "	   , sy);\n"
 "}\n"
 "\n"
+"vec4 yuv_to_rgb(vec2 tex_coords)\n"
+"{\n"
+"	vec3 yuv = vec3(\n"
+"		texture_bicubic(texture_sampler, tex_coords).x,\n"
+"		texture_bicubic(u_texture_sampler, tex_coords).x,\n"
+"		texture_bicubic(v_texture_sampler, tex_coords).x\n"
+"		) * yuv_scale - vec3(0.0, 0.5, 0.5);\n"
+"	return vec4(yuv_rgb_colour_conversion * yuv, 1.0);\n"
+"}\n"
+"\n"
 "void main()\n"
 "{\n"
 "	switch (type) {\n"
@@ -286,6 +310,12 @@ static constexpr char fragment_source[] =
 "			FragColor = texture_bicubic(texture_sampler, TexCoord);\n"
 "			FragColor = rec2020_rec709_colour_conversion * FragColor;\n"
 "			break;\n"
+"		case 5:\n"
+"			FragColor = yuv_to_rgb(TexCoord);\n"
+"			break;\n"
+"		case 6:\n"
+"			FragColor = rec2020_rec709_colour_conversion * yuv_to_rgb(TexCoord);\n"
+"			break;\n"
 "	}\n"
 "}\n";
 
@@ -297,9 +327,47 @@ enum class FragmentType
 	XYZ_IMAGE = 2,
 	REC709_IMAGE = 3,
 	REC2020_IMAGE = 4,
+	YUV_REC709_IMAGE = 5,
+	YUV_REC2020_IMAGE = 6,
 };
 
 
+/** Fill in a (row-major) matrix to convert full-range YUV, with U and V centred on 0, to RGB */
+static void
+yuv_rgb_matrix (dcp::YUVToRGB yuv_to_rgb, GLfloat* gl)
+{
+	float kr = 0.299f;
+	float kb = 0.114f;
+
+	switch (yuv_to_rgb) {
+	case dcp::YUVToRGB::REC601:
+		break;
+	case dcp::YUVToRGB::REC709:
+		kr = 0.2126f;
+		kb = 0.0722f;
+		break;
+	case dcp::YUVToRGB::REC2020:
+		kr = 0.2627f;
+		kb = 0.0593f;
+		break;
+	default:
+		DCPOMATIC_ASSERT (false);
+	}
+
+	float const kg = 1 - kr - kb;
+
+	gl[0] = 1;
+	gl[1] = 0;
+	gl[2] = 2 * (1 - kr);
+	gl[3] = 1;
+	gl[4] = -2 * kb * (1 - kb) / kg;
+	gl[5] = -2 * kr * (1 - kr) / kg;
+	gl[6] = 1;
+	gl[7] = 2 * (1 - kb);
+	gl[8] = 0;
+}
+
+
 void
 GLVideoView::ensure_context ()
 {
@@ -458,6 +526,16 @@ GLVideoView::setup_shaders ()
 
 	_fragment_type = glGetUniformLocation (program, "type");
 	check_gl_error ("glGetUniformLocation");
+	_yuv_rgb_colour_conversion = glGetUniformLocation (program, "yuv_rgb_colour_conversion");
+	check_gl_error ("glGetUniformLocation");
+	_yuv_scale = glGetUniformLocation (program, "yuv_scale");
+	check_gl_error ("glGetUniformLocation");
+
+	/* Texture units for the samplers; these must match the units given to our Textures */
+	glUniform1i (glGetUniformLocation(program, "texture_sampler"), 0);
+	glUniform1i (glGetUniformLocation(program, "u_texture_sampler"), 1);
+	glUniform1i (glGetUniformLocation(program, "v_texture_sampler"), 2);
+	check_gl_error ("glUniform1i");
 	set_outline_content_colour (program);
 	set_crop_guess_colour (program);
 
@@ -562,12 +640,18 @@ GLVideoView::draw ()
 	check_gl_error ("glBindVertexArray");
 	if (_optimise_for_j2k) {
 		glUniform1i(_fragment_type, static_cast<GLint>(FragmentType::XYZ_IMAGE));
+	} else if (_video_yuv) {
+		glUniform1i(_fragment_type, static_cast<GLint>(_rec2020 ? FragmentType::YUV_REC2020_IMAGE : FragmentType::YUV_REC709_IMAGE));
 	} else if (_rec2020) {
 		glUniform1i(_fragment_type, static_cast<GLint>(FragmentType::REC2020_IMAGE));
 	} else {
 		glUniform1i(_fragment_type, static_cast<GLint>(FragmentType::REC709_IMAGE));
 	}
 	_video_texture->bind();
+	if (_video_yuv) {
+		_video_u_texture->bind();
+		_video_v_texture->bind();
+	}
 	glDrawElements (GL_TRIANGLES, indices_video_texture_number, GL_UNSIGNED_INT, reinterpret_cast<void*>(indices_video_texture_offset * sizeof(int)));
 	if (_have_subtitle_to_render) {
 		glUniform1i(_fragment_type, static_cast<GLint>(FragmentType::REC709_IMAGE));
@@ -595,7 +679,8 @@ GLVideoView::draw ()
 void
 GLVideoView::set_image (shared_ptr<const PlayerVideo> pv)
 {
-	shared_ptr<const Image> video = _optimise_for_j2k ? pv->raw_image() : pv->image(boost::bind(&PlayerVideo::force, AV_PIX_FMT_RGB24), VideoRange::FULL, true);
+	/* This pixel format function must match the one that FilmViewer gives to the butler */
+	shared_ptr<const Image> video = _optimise_for_j2k ? pv->raw_image() : pv->image(&PlayerVideo::keep_yuv_or_rgb, VideoRange::FULL, true);
 
 	/* Only the player's black frames should be aligned at this stage, so this should
 	 * almost always have no work to do.
@@ -604,16 +689,31 @@ GLVideoView::set_image (shared_ptr<const PlayerVideo> pv)
 
 	/** If _optimise_for_j2k is true we render a XYZ image, doing the colourspace
 	 *  conversion, scaling and video range conversion in the GL shader.
-	 *  Otherwise we render a RGB image without any shader-side processing.
+	 *  Otherwise we render either a full-range YUV image, doing the conversion to RGB
+	 *  in the shader, or a RGB image without any shader-side processing.
 	 */
 
-	_video_texture->set (video);
+	_video_yuv = video->pixel_format() == AV_PIX_FMT_YUV420P || video->pixel_format() == AV_PIX_FMT_YUV422P10LE;
+	if (_video_yuv) {
+		_video_texture->set (video, 0);
+		_video_u_texture->set (video, 1);
+		_video_v_texture->set (video, 2);
+
+		GLfloat matrix[9];
+		yuv_rgb_matrix (pv->colour_conversion() ? pv->colour_conversion()->yuv_to_rgb() : dcp::YUVToRGB::REC601, matrix);
+		glUniformMatrix3fv (_yuv_rgb_colour_conversion, 1, GL_TRUE, matrix);
+		/* 10-bit samples end up in the bottom of 16-bit texture values */
+		glUniform1f (_yuv_scale, video->pixel_format() == AV_PIX_FMT_YUV422P10LE ? 65535.0f / 1023.0f : 1.0f);
+		check_gl_error ("glUniform1f");
+	} else {
+		_video_texture->set (video);
+	}
 
 	auto const text = pv->text();
 	_have_subtitle_to_render = static_cast<bool>(text) && _optimise_for_j2k;
 	if (_have_subtitle_to_render) {
 		/* opt: only do this if it's a new subtitle? */
-		DCPOMATIC_ASSERT (text->image->alignment() == Image::Alignment::COMPACT);
+		DCPOMATIC_ASSERT (text->image->has_layout_of(Image::Alignment::COMPACT));
 		_subtitle_texture->set (text->image);
 	}
 
@@ -737,22 +837,23 @@ GLVideoView::set_image (shared_ptr<const PlayerVideo> pv)
 	}
 
 	_rec2020 = pv->colour_conversion() && pv->colour_conversion()->about_equal(dcp::ColourConversion::rec2020_to_xyz(), 1e-6);
-
-	/* opt: where should these go? */
-
-	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	check_gl_error ("glTexParameteri");
-
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	check_gl_error ("glTexParameterf");
 }
 
 
 void
 GLVideoView::start ()
 {
+	/* Tell the scheduler how often the display refreshes, if we can find out */
+	optional<double> refresh_period;
+	auto const display = wxDisplay::GetFromWindow(_canvas);
+	if (display != wxNOT_FOUND) {
+		auto const refresh = wxDisplay(display).GetCurrentMode().GetRefresh();
+		if (refresh > 0) {
+			refresh_period = 1.0 / refresh;
+		}
+	}
+	_scheduler.set_refresh_period (refresh_period);
+
 	VideoView::start ();
 
 	boost::mutex::scoped_lock lm (_playing_mutex);
@@ -779,18 +880,26 @@ GLVideoView::thread_playing ()
 			return;
 		}
 
+		/* This will usually use the frame that we prefetched last time */
 		get_next_frame (false);
 		set_image_and_draw ();
+		_scheduler.presented (PresentationScheduler::now(), lateness(), one_video_frame().seconds());
 	}
 
+	/* Drop any frames that we can no longer draw in time */
 	while (true) {
-		optional<int> n = time_until_next_frame();
-		if (!n || *n > 5) {
+		auto const until = seconds_until_next_frame ();
+		if (!until || !_scheduler.too_late(*until, one_video_frame().seconds())) {
+			break;
+		}
+		if (get_next_frame(true) != SUCCESS) {
 			break;
 		}
-		get_next_frame (true);
 		add_dropped ();
 	}
+
+	/* Get the next frame now if it's ready, so that we don't have to wait for the butler when it's due */
+	prefetch_next_frame ();
 }
 
 
@@ -856,7 +965,11 @@ try
 	_vsync_enabled = true;
 #endif
 
+	_scheduler.set_vsync (_vsync_enabled);
+
 	_video_texture.reset(new Texture(_optimise_for_j2k ? 2 : 1));
+	_video_u_texture.reset(new Texture(1, 1));
+	_video_v_texture.reset(new Texture(1, 2));
 	_subtitle_texture.reset(new Texture(1));
 
 	while (true) {
@@ -874,7 +987,13 @@ try
 		}
 
 		boost::this_thread::interruption_point ();
-		dcpomatic_sleep_milliseconds (time_until_next_frame().get_value_or(0));
+		if (_playing) {
+			/* Wait until it's time to draw the next frame so that it appears when it should */
+			auto const until = seconds_until_next_frame ();
+			dcpomatic_sleep_milliseconds (until ? std::lrint(_scheduler.wait(*until) * 1000) : 0);
+		} else {
+			dcpomatic_sleep_milliseconds (time_until_next_frame().get_value_or(0));
+		}
 	}
 
 	/* XXX: leaks _context, but that seems preferable to deleting it here
@@ -905,16 +1024,20 @@ GLVideoView::request_one_shot ()
 }
 
 
-Texture::Texture (GLint unpack_alignment)
+Texture::Texture (GLint unpack_alignment, int unit)
 	: _unpack_alignment (unpack_alignment)
+	, _unit (unit)
 {
 	glGenTextures (1, &_name);
 	check_gl_error ("glGenTextures");
+	glGenBuffers (2, _buffers);
+	check_gl_error ("glGenBuffers");
 }
 
 
 Texture::~Texture ()
 {
+	glDeleteBuffers (2, _buffers);
 	glDeleteTextures (1, &_name);
 }
 
@@ -922,21 +1045,27 @@ Texture::~Texture ()
 void
 Texture::bind ()
 {
+	glActiveTexture(GL_TEXTURE0 + _unit);
+	check_gl_error ("glActiveTexture");
 	glBindTexture(GL_TEXTURE_2D, _name);
 	check_gl_error ("glBindTexture");
 }
 
 
+/** @param plane Plane of the image to use; for the YUV formats that we support each plane becomes
+ *  a single-component texture, otherwise this must be 0.
+ */
 void
-Texture::set (shared_ptr<const Image> image)
+Texture::set (shared_ptr<const Image> image, int plane)
 {
-	auto const create = !_size || image->size() != _size;
-	_size = image->size();
+	auto const size = image->sample_size(plane);
+	auto const create = !_size || size != _size;
+	_size = size;
 
 	glPixelStorei (GL_UNPACK_ALIGNMENT, _unpack_alignment);
 	check_gl_error ("glPixelStorei");
 
-	DCPOMATIC_ASSERT (image->alignment() == Image::Alignment::COMPACT);
+	DCPOMATIC_ASSERT (image->has_layout_of(Image::Alignment::COMPACT));
 
 	GLint internal_format;
 	GLenum format;
@@ -963,19 +1092,63 @@ Texture::set (shared_ptr<const Image> image)
 		format = GL_RGB;
 		type = GL_UNSIGNED_SHORT;
 		break;
+	case AV_PIX_FMT_YUV420P:
+		internal_format = GL_R8;
+		format = GL_RED;
+		type = GL_UNSIGNED_BYTE;
+		break;
+	case AV_PIX_FMT_YUV422P10LE:
+		internal_format = GL_R16;
+		format = GL_RED;
+		type = GL_UNSIGNED_SHORT;
+		break;
 	default:
 		throw PixelFormatError ("Texture::set", image->pixel_format());
 	}
 
+	DCPOMATIC_ASSERT (plane == 0 || format == GL_RED);
+
+	/* Copy the data into a pixel buffer object so that the transfer to the texture can happen
+	 * asynchronously.  We use our two buffers in turn, and orphan the old storage of each one
+	 * before we write to it, so that we need never wait for a previous transfer to finish.
+	 */
+	auto const bytes = static_cast<GLsizeiptr>(image->stride()[plane]) * size.height;
+	glBindBuffer (GL_PIXEL_UNPACK_BUFFER, _buffers[_next_buffer]);
+	check_gl_error ("glBindBuffer");
+	_next_buffer = (_next_buffer + 1) % 2;
+	glBufferData (GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+	check_gl_error ("glBufferData");
+
+	void const* pixels = nullptr;
+	auto mapped = glMapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped) {
+		memcpy (mapped, image->data()[plane], bytes);
+		glUnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+	} else {
+		/* We couldn't map the buffer, so upload straight from the image instead */
+		glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+		pixels = image->data()[plane];
+	}
+
 	bind ();
 
 	if (create) {
-		glTexImage2D (GL_TEXTURE_2D, 0, internal_format, _size->width, _size->height, 0, format, type, image->data()[0]);
+		glTexImage2D (GL_TEXTURE_2D, 0, internal_format, _size->width, _size->height, 0, format, type, pixels);
 		check_gl_error ("glTexImage2D");
+
+		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		check_gl_error ("glTexParameteri");
+
+		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		check_gl_error ("glTexParameterf");
 	} else {
-		glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, _size->width, _size->height, format, type, image->data()[0]);
+		glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, _size->width, _size->height, format, type, pixels);
 		check_gl_error ("glTexSubImage2D");
 	}
+
+	glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
 }
 
 #endif
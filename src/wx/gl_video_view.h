@@ -51,19 +51,24 @@ LIBDCP_ENABLE_WARNINGS
 class Texture
 {
 public:
-	Texture (GLint unpack_alignment);
+	Texture (GLint unpack_alignment, int unit = 0);
 	~Texture ();
 
 	Texture (Texture const&) = delete;
 	Texture& operator= (Texture const&) = delete;
 
 	void bind ();
-	void set (std::shared_ptr<const Image> image);
+	void set (std::shared_ptr<const Image> image, int plane = 0);
 
 private:
 	GLuint _name;
 	GLint _unpack_alignment;
+	/** Texture unit that we are bound to */
+	int _unit;
 	boost::optional<dcp::Size> _size;
+	/** Pixel buffer objects which we upload through, using each in turn */
+	GLuint _buffers[2];
+	int _next_buffer = 0;
 };
 
 
@@ -137,7 +142,13 @@ private:
 
 	boost::atomic<wxSize> _canvas_size;
 	boost::atomic<bool> _rec2020;
+	/** Texture for RGB or XYZ video, or for the Y plane of YUV video */
 	std::unique_ptr<Texture> _video_texture;
+	/** Textures for the U and V planes of YUV video */
+	std::unique_ptr<Texture> _video_u_texture;
+	std::unique_ptr<Texture> _video_v_texture;
+	/** true if the current video is YUV, to be converted to RGB by the shader */
+	bool _video_yuv = false;
 	std::unique_ptr<Texture> _subtitle_texture;
 	bool _have_subtitle_to_render = false;
 	bool _vsync_enabled;
@@ -150,6 +161,8 @@ private:
 
 	GLuint _vao;
 	GLint _fragment_type;
+	GLint _yuv_rgb_colour_conversion;
+	GLint _yuv_scale;
 	bool _setup_shaders_done = false;
 
 	std::shared_ptr<wxTimer> _timer;
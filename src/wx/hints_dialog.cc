@@ -36,6 +36,7 @@ using std::max;
 using std::vector;
 using std::string;
 using std::cout;
+using std::make_shared;
 using std::shared_ptr;
 using boost::optional;
 using boost::bind;
@@ -49,6 +50,7 @@ HintsDialog::HintsDialog (wxWindow* parent, std::weak_ptr<Film> film, bool ok)
 	: wxDialog (parent, wxID_ANY, _("Hints"))
 	, _film (film)
 	, _hints (0)
+	, _hints_cache (make_shared<HintsCache>())
 	, _finished (false)
 {
 	auto sizer = new wxBoxSizer (wxVERTICAL);
@@ -91,21 +93,44 @@ HintsDialog::HintsDialog (wxWindow* parent, std::weak_ptr<Film> film, bool ok)
 
 	auto locked_film = _film.lock ();
 	if (locked_film) {
-		_film_change_connection = locked_film->Change.connect (boost::bind (&HintsDialog::film_change, this, _1));
-		_film_content_change_connection = locked_film->ContentChange.connect (boost::bind (&HintsDialog::film_content_change, this, _1));
+		_film_change_connection = locked_film->Change.connect (boost::bind (&HintsDialog::film_change, this, _1, _2));
+		_film_content_change_connection = locked_film->ContentChange.connect (boost::bind (&HintsDialog::film_content_change, this, _1, _3));
 	}
 
-	film_change (ChangeType::DONE);
+	start_hints ();
 }
 
 
 void
-HintsDialog::film_change (ChangeType type)
+HintsDialog::film_change (ChangeType type, FilmProperty property)
 {
 	if (type != ChangeType::DONE) {
 		return;
 	}
 
+	/* Stop any current run before we forget its results, so that it can't put back anything out of date */
+	_hints.reset ();
+	_hints_cache->film_changed (property);
+	start_hints ();
+}
+
+
+void
+HintsDialog::film_content_change (ChangeType type, int property)
+{
+	if (type != ChangeType::DONE) {
+		return;
+	}
+
+	_hints.reset ();
+	_hints_cache->content_changed (property);
+	start_hints ();
+}
+
+
+void
+HintsDialog::start_hints ()
+{
 	_text->Clear ();
 	_current.clear ();
 
@@ -121,7 +146,7 @@ HintsDialog::film_change (ChangeType type)
 	update ();
 	_finished = false;
 
-	_hints.reset (new Hints (_film));
+	_hints.reset (new Hints(_film, _hints_cache));
 	_hints_hint_connection = _hints->Hint.connect(bind(&HintsDialog::hint, this, _1));
 	_hints_progress_connection = _hints->Progress.connect(bind(&HintsDialog::progress, this, _1));
 	_hints_pulse_connection = _hints->Pulse.connect(bind(&HintsDialog::pulse, this));
@@ -129,12 +154,6 @@ HintsDialog::film_change (ChangeType type)
 	_hints->start ();
 }
 
-void
-HintsDialog::film_content_change (ChangeType type)
-{
-	film_change (type);
-}
-
 void
 HintsDialog::update ()
 {
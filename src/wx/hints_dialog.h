@@ -24,12 +24,14 @@
 LIBDCP_DISABLE_WARNINGS
 #include <wx/wx.h>
 LIBDCP_ENABLE_WARNINGS
+#include "lib/film_property.h"
 #include <boost/signals2.hpp>
 
 
 class wxRichTextCtrl;
 class Film;
 class Hints;
+class HintsCache;
 
 class HintsDialog : public wxDialog
 {
@@ -37,8 +39,9 @@ public:
 	HintsDialog (wxWindow* parent, std::weak_ptr<Film>, bool ok);
 
 private:
-	void film_change (ChangeType);
-	void film_content_change (ChangeType type);
+	void film_change (ChangeType type, FilmProperty property);
+	void film_content_change (ChangeType type, int property);
+	void start_hints ();
 	void shut_up (wxCommandEvent& ev);
 	void update ();
 	void hint (std::string text);
@@ -51,6 +54,8 @@ private:
 	wxStaticText* _gauge_message;
 	wxRichTextCtrl* _text;
 	boost::scoped_ptr<Hints> _hints;
+	/** Results of earlier runs of _hints, so that we only re-do what has changed */
+	std::shared_ptr<HintsCache> _hints_cache;
 	std::list<std::string> _current;
 	bool _finished;
 
@@ -32,6 +32,7 @@
 #include "lib/config.h"
 #include "lib/film.h"
 #include "lib/job_manager.h"
+#include "lib/kdm_source.h"
 #include "lib/kdm_with_metadata.h"
 #include "lib/kdm_util.h"
 #include "lib/screen.h"
@@ -47,6 +48,7 @@ LIBDCP_ENABLE_WARNINGS
 using std::exception;
 using std::list;
 using std::make_pair;
+using std::make_shared;
 using std::map;
 using std::pair;
 using std::runtime_error;
@@ -174,16 +176,13 @@ KDMDialog::make_clicked ()
 
 		vector<KDMCertificatePeriod> period_checks;
 
-		std::function<dcp::DecryptedKDM (dcp::LocalTime, dcp::LocalTime)> make_kdm = [film, this](dcp::LocalTime begin, dcp::LocalTime end) {
-			return film->make_kdm(_cpl->cpl(), begin, end);
+		/* make_kdm is called from worker threads, so don't touch any controls inside it */
+		auto source = make_shared<const KDMSource>(*film, _cpl->cpl());
+		std::function<dcp::DecryptedKDM (dcp::LocalTime, dcp::LocalTime)> make_kdm = [source](dcp::LocalTime begin, dcp::LocalTime end) {
+			return source->make(begin, end);
 		};
 
-		for (auto i: _screens->screens()) {
-			auto p = kdm_for_screen(make_kdm, i, _timing->from(), _timing->until(), _output->formulation(), !_output->forensic_mark_video(), for_audio, period_checks);
-			if (p) {
-				kdms.push_back (p);
-			}
-		}
+		kdms = kdms_for_screens(make_kdm, _screens->screens(), _timing->from(), _timing->until(), _output->formulation(), !_output->forensic_mark_video(), for_audio, period_checks);
 
 		if (find(period_checks.begin(), period_checks.end(), KDMCertificatePeriod::KDM_OUTSIDE_CERTIFICATE) != period_checks.end()) {
 			error_dialog(
@@ -28,6 +28,7 @@
 #include "lib/audio_content.h"
 #include "lib/dcp_content.h"
 #include "lib/film.h"
+#include <cmath>
 
 
 using std::cout;
@@ -90,6 +91,7 @@ PlayerInformation::PlayerInformation(wxWindow* parent, FilmViewer const& viewer)
 		auto s = new wxBoxSizer (wxVERTICAL);
 		add_label_to_sizer(s, this, _("Performance"), false, 0)->SetFont(title_font);
 		_dropped = add_label_to_sizer(s, this, wxT(""), false, 0);
+		_late = add_label_to_sizer(s, this, wxT(""), false, 0);
 		_decode_resolution = add_label_to_sizer(s, this, wxT(""), false, 0);
 		_sizer->Add (s, 2, wxEXPAND | wxALL, 6);
 	}
@@ -114,6 +116,13 @@ PlayerInformation::periodic_update ()
 		s += wxString::Format(_(" (%d errors)"), _viewer.errored());
 	}
 	checked_set (_dropped, s);
+
+	auto const pacing = _viewer.pacing();
+	if (pacing.late > 0) {
+		checked_set(_late, wxString::Format(_("Late frames: %d (up to %dms)"), pacing.late, static_cast<int>(std::lrint(pacing.worst_lateness * 1000))));
+	} else {
+		checked_set(_late, _("Late frames: 0"));
+	}
 }
 
 
@@ -47,6 +47,7 @@ private:
 	wxStaticText* _kdm_from;
 	wxStaticText* _kdm_to;
 	wxStaticText* _dropped;
+	wxStaticText* _late;
 	wxStaticText* _decode_resolution;
 	boost::scoped_ptr<wxTimer> _timer;
 };
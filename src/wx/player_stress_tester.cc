@@ -21,23 +21,17 @@
 
 #include "controls.h"
 #include "player_stress_tester.h"
-#include <dcp/raw_convert.h>
-#include <dcp/util.h>
 #include <dcp/warnings.h>
 LIBDCP_DISABLE_WARNINGS
 #include <wx/wx.h>
 LIBDCP_ENABLE_WARNINGS
-#include <boost/algorithm/string.hpp>
 #include <boost/bind/bind.hpp>
 #include <iostream>
 #include <string>
-#include <vector>
 
 
 using std::cout;
 using std::string;
-using std::vector;
-using dcp::raw_convert;
 using boost::optional;
 
 
@@ -45,39 +39,6 @@ using boost::optional;
 #define CHECK_INTERVAL 20
 
 
-Command::Command (string line)
-	: type (NONE)
-	, int_param (0)
-{
-	vector<string> bits;
-	boost::split (bits, line, boost::is_any_of(" "));
-	if (bits[0] == "O") {
-		if (bits.size() != 2) {
-			return;
-		}
-		type = OPEN;
-		string_param = bits[1];
-	} else if (bits[0] == "P") {
-		type = PLAY;
-	} else if (bits[0] == "W") {
-		if (bits.size() != 2) {
-			return;
-		}
-		type = WAIT;
-		int_param = raw_convert<int>(bits[1]);
-	} else if (bits[0] == "S") {
-		type = STOP;
-	} else if (bits[0] == "K") {
-		if (bits.size() != 2) {
-			return;
-		}
-		type = SEEK;
-		int_param = raw_convert<int>(bits[1]);
-	} else if (bits[0] == "E") {
-		type = EXIT;
-	}
-}
-
 PlayerStressTester::PlayerStressTester ()
 	: _parent (0)
 	, _controls (0)
@@ -102,12 +63,7 @@ PlayerStressTester::load_script (boost::filesystem::path file)
 
 	_timer.Bind (wxEVT_TIMER, boost::bind(&PlayerStressTester::check_commands, this));
 	_timer.Start (CHECK_INTERVAL);
-	vector<string> lines;
-	string const script = dcp::file_to_string(file);
-	boost::split (lines, script, boost::is_any_of("\n"));
-	for (auto i: lines) {
-		_commands.push_back (Command(i));
-	}
+	_commands = read_stress_script(file);
 	_current_command = _commands.begin();
 }
 
@@ -19,6 +19,7 @@
 */
 
 
+#include "lib/stress_command.h"
 #include <dcp/warnings.h>
 LIBDCP_DISABLE_WARNINGS
 #include <wx/wx.h>
@@ -31,26 +32,6 @@ class wxWindow;
 class Controls;
 
 
-class Command
-{
-public:
-	enum Type {
-		NONE,
-		OPEN,
-		PLAY,
-		WAIT,
-		STOP,
-		SEEK,
-		EXIT
-	};
-
-	Command(std::string line);
-
-	Type type;
-	std::string string_param;
-	int int_param;
-};
-
 class PlayerStressTester
 {
 public:
@@ -32,7 +32,10 @@
 #include "lib/ffmpeg_content.h"
 #include "lib/film.h"
 #include "lib/internet.h"
+#include "lib/kdm_index.h"
 #include "lib/player_video.h"
+#include "lib/ratio.h"
+#include "lib/video_content.h"
 #include "lib/scoped_temporary.h"
 #include <dcp/exceptions.h>
 #include <dcp/raw_convert.h>
@@ -46,13 +49,40 @@ LIBDCP_ENABLE_WARNINGS
 using std::cout;
 using std::dynamic_pointer_cast;
 using std::exception;
+using std::make_shared;
 using std::shared_ptr;
 using std::sort;
 using std::string;
 using boost::optional;
+#if BOOST_VERSION >= 106100
+using namespace boost::placeholders;
+#endif
 using namespace dcpomatic;
 
 
+/** @return true if b can follow a in the same film, i.e. without the player having to
+ *  change frame rate, container or 3D mode in between.
+ */
+static
+bool
+can_play_continuously (shared_ptr<const Content> a, shared_ptr<const Content> b)
+{
+	if (!a->video || !b->video || a->video_frame_rate() != b->video_frame_rate()) {
+		return false;
+	}
+
+	auto scope = [](shared_ptr<const Content> c) {
+		return Ratio::nearest_from_ratio(c->video->size().ratio())->id() == "239";
+	};
+
+	auto three_d = [](shared_ptr<const Content> c) {
+		return c->video->frame_type() != VideoFrameType::TWO_D;
+	};
+
+	return scope(a) == scope(b) && three_d(a) == three_d(b);
+}
+
+
 PlaylistControls::PlaylistControls(wxWindow* parent, FilmViewer& viewer)
 	: Controls (parent, viewer, false)
 	, _play_button (new Button(this, _("Play")))
@@ -120,6 +150,8 @@ PlaylistControls::PlaylistControls(wxWindow* parent, FilmViewer& viewer)
 	_viewer.Finished.connect(boost::bind(&PlaylistControls::viewer_finished, this));
 	_refresh_spl_view->Bind (wxEVT_BUTTON, boost::bind(&PlaylistControls::update_playlist_directory, this));
 	_refresh_content_view->Bind (wxEVT_BUTTON, boost::bind(&ContentView::update, _content_view));
+	_content_view->Changed.connect(boost::bind(&PlaylistControls::content_view_changed, this));
+	_viewer.ImageChanged.connect(boost::bind(&PlaylistControls::image_changed, this, _1));
 
 	_content_view->update ();
 	update_playlist_directory ();
@@ -203,8 +235,7 @@ PlaylistControls::previous_clicked ()
 		return;
 	}
 
-	_selected_playlist_position--;
-	update_current_content ();
+	move_to (_selected_playlist_position - 1);
 }
 
 bool
@@ -220,8 +251,50 @@ PlaylistControls::next_clicked ()
 		return;
 	}
 
-	_selected_playlist_position++;
-	update_current_content ();
+	move_to (_selected_playlist_position + 1);
+}
+
+
+/** Go to an entry in the selected playlist, seeking within the current film if it is there */
+void
+PlaylistControls::move_to (int position)
+{
+	DCPOMATIC_ASSERT (_selected_playlist);
+
+	if (_film && position >= _film_first_position && position < (_film_first_position + _film_entries)) {
+		_selected_playlist_position = position;
+		_viewer.seek (_playlists[*_selected_playlist].get()[position].content->position(), true);
+		setup_sensitivity ();
+	} else {
+		_selected_playlist_position = position;
+		update_current_content ();
+	}
+}
+
+
+/** Keep track of which playlist entry is being shown, as playback can go from one to the next within a film */
+void
+PlaylistControls::image_changed (shared_ptr<PlayerVideo> video)
+{
+	if (!video || !_selected_playlist) {
+		return;
+	}
+
+	auto content = video->content().lock();
+	if (!content) {
+		return;
+	}
+
+	auto const& entries = _playlists[*_selected_playlist].get();
+	for (int i = _film_first_position; i < (_film_first_position + _film_entries) && i < int(entries.size()); ++i) {
+		if (entries[i].content == content) {
+			if (i != _selected_playlist_position) {
+				_selected_playlist_position = i;
+				setup_sensitivity ();
+			}
+			break;
+		}
+	}
 }
 
 
@@ -281,27 +354,24 @@ PlaylistControls::update_playlist_directory ()
 	_selected_playlist = boost::none;
 }
 
+/** Called when the content view has found new or changed content, which may be referred to by our playlists */
+void
+PlaylistControls::content_view_changed ()
+{
+	if (!_selected_playlist) {
+		update_playlist_directory ();
+	}
+}
+
 optional<dcp::EncryptedKDM>
 PlaylistControls::get_kdm_from_directory (shared_ptr<DCPContent> dcp)
 {
-	using namespace boost::filesystem;
-	optional<path> kdm_dir = Config::instance()->player_kdm_directory();
-	if (!kdm_dir) {
-		return optional<dcp::EncryptedKDM>();
+	auto kdm_dir = Config::instance()->player_kdm_directory();
+	if (!kdm_dir || !dcp->cpl()) {
+		return {};
 	}
-	for (directory_iterator i = directory_iterator(*kdm_dir); i != directory_iterator(); ++i) {
-		try {
-			if (file_size(i->path()) < MAX_KDM_SIZE) {
-				dcp::EncryptedKDM kdm (dcp::file_to_string(i->path()));
-				if (kdm.cpl_id() == dcp->cpl()) {
-					return kdm;
-				}
-			}
-		} catch (std::exception& e) {
-			/* Hey well */
-		}
-	}
-	return optional<dcp::EncryptedKDM>();
+
+	return KDMIndex::instance()->find(*kdm_dir, *dcp->cpl());
 }
 
 void
@@ -380,8 +450,25 @@ void
 PlaylistControls::reset_film ()
 {
 	DCPOMATIC_ASSERT (_selected_playlist);
-	shared_ptr<Film> film (new Film(optional<boost::filesystem::path>()));
-	film->add_content (_playlists[*_selected_playlist].get()[_selected_playlist_position].content);
+
+	auto const& entries = _playlists[*_selected_playlist].get();
+
+	/* Put as many of the following entries as we can into the same film, so that the player
+	   goes from one to the next without a gap.
+	*/
+	int end = _selected_playlist_position + 1;
+	while (end < int(entries.size()) && can_play_continuously(entries[end - 1].content, entries[end].content)) {
+		++end;
+	}
+
+	auto film = make_shared<Film>(optional<boost::filesystem::path>());
+	for (int i = _selected_playlist_position; i < end; ++i) {
+		film->add_content (entries[i].content);
+	}
+
+	_film_first_position = _selected_playlist_position;
+	_film_entries = end - _selected_playlist_position;
+
 	ResetFilm (film);
 }
 
@@ -410,7 +497,7 @@ PlaylistControls::update_current_content ()
 	reset_film ();
 }
 
-/** One piece of content in our SPL has finished playing */
+/** The film made from one or more entries in our SPL has finished playing */
 void
 PlaylistControls::viewer_finished ()
 {
@@ -418,7 +505,8 @@ PlaylistControls::viewer_finished ()
 		return;
 	}
 
-	_selected_playlist_position++;
+	/* Everything in the film has been played */
+	_selected_playlist_position = _film_first_position + _film_entries;
 	if (_selected_playlist_position < int(_playlists[*_selected_playlist].get().size())) {
 		/* Next piece of content on the SPL */
 		update_current_content ();
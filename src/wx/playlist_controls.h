@@ -49,6 +49,9 @@ private:
 	void add_playlist_to_list (SPL spl);
 	void update_content_directory ();
 	void update_playlist_directory ();
+	void content_view_changed ();
+	void image_changed (std::shared_ptr<PlayerVideo> video);
+	void move_to (int position);
 	void spl_selection_changed ();
 	void select_playlist (int selected, int position);
 	void started () override;
@@ -79,4 +82,8 @@ private:
 	std::vector<SPL> _playlists;
 	boost::optional<int> _selected_playlist;
 	int _selected_playlist_position;
+	/** Position in the selected playlist of the first entry in _film */
+	int _film_first_position = 0;
+	/** Number of playlist entries in _film */
+	int _film_entries = 0;
 };
@@ -139,7 +139,7 @@ RecipientsPanel::edit_recipient_clicked ()
 	auto c = *_selected.begin();
 
 	RecipientDialog dialog(
-		GetParent(), _("Edit recipient"), c.second->name, c.second->notes, c.second->emails, c.second->utc_offset_hour, c.second->utc_offset_minute, c.second->recipient
+		GetParent(), _("Edit recipient"), c.second->name, c.second->notes, c.second->emails, c.second->utc_offset_hour, c.second->utc_offset_minute, c.second->recipient()
 		);
 
 	if (dialog.ShowModal() == wxID_OK) {
@@ -424,7 +424,7 @@ ScreensPanel::edit_screen(shared_ptr<Screen> edit_screen)
 		GetParent(), _("Edit screen"),
 		edit_screen->name,
 		edit_screen->notes,
-		edit_screen->recipient,
+		edit_screen->recipient(),
 		edit_screen->recipient_file,
 		edit_screen->trusted_devices
 		);
@@ -449,7 +449,7 @@ ScreensPanel::edit_screen(shared_ptr<Screen> edit_screen)
 
 	edit_screen->name = dialog.name();
 	edit_screen->notes = dialog.notes();
-	edit_screen->recipient = dialog.recipient();
+	edit_screen->set_recipient(dialog.recipient());
 	edit_screen->recipient_file = dialog.recipient_file();
 	edit_screen->trusted_devices = dialog.trusted_devices();
 	notify_cinemas_changed();
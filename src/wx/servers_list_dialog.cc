@@ -37,7 +37,7 @@ ServersListDialog::ServersListDialog (wxWindow* parent)
 	wxBoxSizer* s = new wxBoxSizer (wxVERTICAL);
 	SetSizer (s);
 
-	_list = new wxListCtrl (this, wxID_ANY, wxDefaultPosition, wxSize (500, 200), wxLC_REPORT | wxLC_SINGLE_SEL);
+	_list = new wxListCtrl (this, wxID_ANY, wxDefaultPosition, wxSize (650, 200), wxLC_REPORT | wxLC_SINGLE_SEL);
 
 	{
 		wxListItem ip;
@@ -55,6 +55,22 @@ ServersListDialog::ServersListDialog (wxWindow* parent)
 		_list->InsertColumn (1, ip);
 	}
 
+	{
+		wxListItem ip;
+		ip.SetId (2);
+		ip.SetText (_("Response"));
+		ip.SetWidth (150);
+		_list->InsertColumn (2, ip);
+	}
+
+	{
+		wxListItem ip;
+		ip.SetId (3);
+		ip.SetText (_("Load"));
+		ip.SetWidth (100);
+		_list->InsertColumn (3, ip);
+	}
+
 	s->Add (_list, 1, wxEXPAND | wxALL, 12);
 
 	wxSizer* buttons = CreateSeparatedButtonSizer (wxOK);
@@ -90,6 +106,12 @@ ServersListDialog::servers_list_changed ()
 		} else {
 			_list->SetItem (n, 1, _("Incorrect version"));
 		}
+		if (i.latency()) {
+			_list->SetItem (n, 2, wxString::Format(_("%dms (%d%%)"), static_cast<int>(lrint(*i.latency() * 1000)), static_cast<int>(lrint(i.reliability() * 100))));
+		}
+		if (i.load()) {
+			_list->SetItem (n, 3, wxString::Format(wxT("%.1f"), *i.load()));
+		}
 		++n;
 	}
 }
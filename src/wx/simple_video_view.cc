@@ -84,7 +84,7 @@ SimpleVideoView::paint ()
 		dc.SetBackground (b);
 		dc.Clear ();
 	} else {
-		DCPOMATIC_ASSERT (_image->alignment() == Image::Alignment::COMPACT);
+		DCPOMATIC_ASSERT (_image->has_layout_of(Image::Alignment::COMPACT));
 		out_size = _image->size();
 		wxImage frame (out_size.width, out_size.height, _image->data()[0], true);
 		wxBitmap frame_bitmap (frame);
@@ -252,7 +252,7 @@ SimpleVideoView::update ()
 	auto const pv = player_video();
 	_image = pv.first->image(boost::bind(&PlayerVideo::force, AV_PIX_FMT_RGB24), VideoRange::FULL, true);
 	if (pv.first->colour_conversion() && pv.first->colour_conversion()->about_equal(dcp::ColourConversion::rec2020_to_xyz(), 1e-6)) {
-		_image = Image::ensure_alignment(_rec2020_filter_graph.get(_image->size(), _image->pixel_format())->process(_image).front(), Image::Alignment::COMPACT);
+		_image = _rec2020_filter_graph.get(_image->size(), _image->pixel_format())->process(_image, Image::Alignment::COMPACT).front();
 	}
 
 	_state_timer.set ("ImageChanged");
@@ -23,6 +23,7 @@
 #include "gl_video_view.h"
 #include "system_information_dialog.h"
 #include "wx_util.h"
+#include "lib/ui_watchdog.h"
 
 
 #ifdef DCPOMATIC_OSX
@@ -70,6 +71,8 @@ SystemInformationDialog::SystemInformationDialog(wxWindow* parent, FilmViewer co
 		add (gl->vsync_enabled() ? _("enabled") : _("not enabled"), false);
 	}
 
+	add_ui_latency ();
+
 	layout ();
 }
 
@@ -80,6 +83,37 @@ SystemInformationDialog::SystemInformationDialog(wxWindow* parent, FilmViewer co
 {
 	add (_("OpenGL version"), true);
 	add (_("OpenGL renderer not supported by this DCP-o-matic version"), false);
+
+	add_ui_latency ();
 }
 
 #endif
+
+
+/** Add the histogram of UI event loop latencies from UIWatchdog, if it is running */
+void
+SystemInformationDialog::add_ui_latency()
+{
+	add (_("UI event loop latency"), true);
+
+	auto watchdog = UIWatchdog::instance();
+	if (!watchdog->running()) {
+		add (_("not being measured"), false);
+		return;
+	}
+
+	auto const statistics = watchdog->statistics();
+	add (wxString::Format(_("longest %dms; %d stalls"), statistics.longest, statistics.stalls), false);
+
+	for (size_t i = 0; i < statistics.counts.size(); ++i) {
+		if (i < statistics.limits.size()) {
+			add (wxString::Format(_("Under %dms"), statistics.limits[i]), true);
+		} else {
+			add (wxString::Format(_("%dms or more"), statistics.limits.back()), true);
+		}
+		add (wxString::Format("%lld", static_cast<long long>(statistics.counts[i])), false);
+	}
+
+	add (_("Deepest signal queue"), true);
+	add (wxString::Format("%d", static_cast<int>(statistics.deepest_queue)), false);
+}
@@ -30,4 +30,7 @@ class SystemInformationDialog : public TableDialog
 {
 public:
 	SystemInformationDialog(wxWindow* parent, FilmViewer const& viewer);
+
+private:
+	void add_ui_latency();
 };
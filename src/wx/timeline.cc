@@ -38,13 +38,18 @@
 #include "lib/scope_guard.h"
 #include "lib/text_content.h"
 #include "lib/timer.h"
+#include "lib/ui_watchdog.h"
 #include "lib/video_content.h"
 #include <dcp/warnings.h>
 LIBDCP_DISABLE_WARNINGS
 #include <wx/graphics.h>
 LIBDCP_ENABLE_WARNINGS
+#include <algorithm>
+#include <functional>
 #include <iterator>
 #include <list>
+#include <map>
+#include <vector>
 
 
 using std::abs;
@@ -135,7 +140,24 @@ Timeline::Timeline(wxWindow* parent, ContentPanel* cp, shared_ptr<Film> film, Fi
 void
 Timeline::update_playhead ()
 {
-	Refresh ();
+	int const x = _viewer.position().seconds() * pixels_per_second().get_value_or(0);
+	if (_playhead_x && *_playhead_x == x) {
+		return;
+	}
+
+	/* Just redraw where the playhead was, and where it is now */
+	if (_playhead_x) {
+		force_redraw (playhead_rect(*_playhead_x));
+	}
+	force_redraw (playhead_rect(x));
+	_playhead_x = x;
+}
+
+
+dcpomatic::Rect<int>
+Timeline::playhead_rect (int x) const
+{
+	return { x - 2, 0, 4, pixels_per_track() * _tracks + 32 };
 }
 
 
@@ -193,26 +215,45 @@ Timeline::paint_main ()
 
 	gc->SetAntialiasMode (wxANTIALIAS_DEFAULT);
 
-	for (auto i: _views) {
-
-		auto ic = dynamic_pointer_cast<TimelineContentView> (i);
+	/* The area that needs painting, in the same coordinates as our views' bounding boxes */
+	auto const update_box = _main_canvas->GetUpdateRegion().GetBox();
+	auto const update_position = _main_canvas->CalcUnscrolledPosition(update_box.GetPosition());
+	dcpomatic::Rect<int> const update (update_position.x, update_position.y, update_box.GetWidth(), update_box.GetHeight());
 
-		/* Find areas of overlap with other content views, so that we can plot them */
-		list<dcpomatic::Rect<int>> overlaps;
-		for (auto j: _views) {
-			auto jc = dynamic_pointer_cast<TimelineContentView> (j);
-			/* No overlap with non-content views, views on different tracks, audio views or non-active views */
-			if (!ic || !jc || i == j || ic->track() != jc->track() || ic->track().get_value_or(2) >= 2 || !ic->active() || !jc->active()) {
-				continue;
-			}
+	/* Find areas of overlap between content views, so that we can plot them.  Only active views
+	 * on the video tracks can overlap, and then only with views on the same track, so sort
+	 * those views on each track by position and look for overlaps between neighbours.
+	 */
+	std::map<int, std::vector<std::pair<dcpomatic::Rect<int>, shared_ptr<TimelineView>>>> track_views;
+	for (auto i: _views) {
+		auto ic = dynamic_pointer_cast<TimelineContentView>(i);
+		if (ic && ic->track().get_value_or(2) < 2 && ic->active()) {
+			track_views[ic->track().get()].push_back({ ic->bbox(), i });
+		}
+	}
 
-			auto r = j->bbox().intersection(i->bbox());
-			if (r) {
-				overlaps.push_back (r.get ());
+	std::map<shared_ptr<TimelineView>, list<dcpomatic::Rect<int>>> overlaps;
+	for (auto& track: track_views) {
+		auto& views = track.second;
+		std::sort (views.begin(), views.end(), [](std::pair<dcpomatic::Rect<int>, shared_ptr<TimelineView>> const& a, std::pair<dcpomatic::Rect<int>, shared_ptr<TimelineView>> const& b) {
+			return a.first.x < b.first.x;
+		});
+		for (size_t i = 0; i < views.size(); ++i) {
+			for (size_t j = i + 1; j < views.size() && views[j].first.x <= (views[i].first.x + views[i].first.width); ++j) {
+				auto r = views[i].first.intersection(views[j].first);
+				if (r) {
+					overlaps[views[i].second].push_back (r.get());
+					overlaps[views[j].second].push_back (r.get());
+				}
 			}
 		}
+	}
 
-		i->paint (gc, overlaps);
+	for (auto i: _views) {
+		/* Views draw a little outside their bounding boxes */
+		if (i->bbox().extended(4).intersection(update)) {
+			i->paint (gc, overlaps[i]);
+		}
 	}
 
 	if (_zoom_point) {
@@ -247,7 +288,7 @@ Timeline::film_change(ChangeType type, FilmProperty p)
 	if (p == FilmProperty::CONTENT || p == FilmProperty::REEL_TYPE || p == FilmProperty::REEL_LENGTH) {
 		ensure_ui_thread ();
 		recreate_views ();
-	} else if (p == FilmProperty::CONTENT_ORDER) {
+	} else {
 		Refresh ();
 	}
 }
@@ -256,30 +297,59 @@ Timeline::film_change(ChangeType type, FilmProperty p)
 void
 Timeline::recreate_views ()
 {
+	UIWatchdog::Activity activity("Timeline::recreate_views");
+
 	auto film = _film.lock ();
 	if (!film) {
 		return;
 	}
 
+	/* Keep any views that we already have for content which is still in the film, so that
+	 * we don't lose anything that they have cached.
+	 */
+	std::multimap<shared_ptr<const Content>, shared_ptr<TimelineContentView>> old_views;
+	for (auto i: _views) {
+		if (auto cv = dynamic_pointer_cast<TimelineContentView>(i)) {
+			old_views.insert ({ cv->content(), cv });
+		}
+	}
+
+	auto find = [&old_views](shared_ptr<const Content> content, std::function<bool (shared_ptr<TimelineContentView>)> match) -> shared_ptr<TimelineContentView> {
+		auto range = old_views.equal_range(content);
+		for (auto i = range.first; i != range.second; ++i) {
+			if (match(i->second)) {
+				return i->second;
+			}
+		}
+		return {};
+	};
+
 	_views.clear ();
 	_views.push_back (_time_axis_view);
 	_views.push_back (_reels_view);
 
 	for (auto i: film->content ()) {
 		if (i->video) {
-			_views.push_back (make_shared<TimelineVideoContentView>(*this, i));
+			auto view = find(i, [](shared_ptr<TimelineContentView> v) { return static_cast<bool>(dynamic_pointer_cast<TimelineVideoContentView>(v)); });
+			_views.push_back (view ? view : make_shared<TimelineVideoContentView>(*this, i));
 		}
 
 		if (i->audio && !i->audio->mapping().mapped_output_channels().empty ()) {
-			_views.push_back (make_shared<TimelineAudioContentView>(*this, i));
+			auto view = find(i, [](shared_ptr<TimelineContentView> v) { return static_cast<bool>(dynamic_pointer_cast<TimelineAudioContentView>(v)); });
+			_views.push_back (view ? view : make_shared<TimelineAudioContentView>(*this, i));
 		}
 
 		for (auto j: i->text) {
-			_views.push_back (make_shared<TimelineTextContentView>(*this, i, j));
+			auto view = find(i, [j](shared_ptr<TimelineContentView> v) -> bool {
+				auto text = dynamic_pointer_cast<TimelineTextContentView>(v);
+				return text && text->caption() == j;
+			});
+			_views.push_back (view ? view : make_shared<TimelineTextContentView>(*this, i, j));
 		}
 
 		if (i->atmos) {
-			_views.push_back (make_shared<TimelineAtmosContentView>(*this, i));
+			auto view = find(i, [](shared_ptr<TimelineContentView> v) { return static_cast<bool>(dynamic_pointer_cast<TimelineAtmosContentView>(v)); });
+			_views.push_back (view ? view : make_shared<TimelineAtmosContentView>(*this, i));
 		}
 	}
 
@@ -305,6 +375,8 @@ Timeline::film_content_change (ChangeType type, int property, bool frequent)
 	} else if (!frequent) {
 		setup_scrollbars ();
 		Refresh ();
+	} else {
+		_main_canvas->Refresh ();
 	}
 }
 
@@ -828,7 +900,9 @@ Timeline::set_position_from_event (wxMouseEvent& ev, bool force_emit)
 void
 Timeline::force_redraw (dcpomatic::Rect<int> const & r)
 {
-	_main_canvas->RefreshRect (wxRect (r.x, r.y, r.width, r.height), false);
+	/* r is in the coordinates that our views use, which ignore scrolling */
+	auto const position = _main_canvas->CalcScrolledPosition (wxPoint(r.x, r.y));
+	_main_canvas->RefreshRect (wxRect(position.x, position.y, r.width, r.height), false);
 }
 
 
@@ -917,6 +991,20 @@ Timeline::width () const
 }
 
 
+/** @return Range of x positions on the main canvas (in the same units as TimelineView::time_x)
+ *  which can currently be seen.
+ */
+std::pair<int, int>
+Timeline::visible_x_range () const
+{
+	int x;
+	int y;
+	_main_canvas->GetViewStart (&x, &y);
+	x *= _x_scroll_rate;
+	return { x, x + _main_canvas->GetClientSize().GetWidth() };
+}
+
+
 void
 Timeline::scrolled (wxScrollWinEvent& ev)
 {
@@ -49,6 +49,7 @@ public:
 	void force_redraw (dcpomatic::Rect<int> const &);
 
 	int width () const;
+	std::pair<int, int> visible_x_range () const;
 
 	int pixels_per_track () const {
 		return _pixels_per_track;
@@ -110,6 +111,7 @@ private:
 	void set_pixels_per_track (int h);
 	void zoom_all ();
 	void update_playhead ();
+	dcpomatic::Rect<int> playhead_rect (int x) const;
 
 	std::shared_ptr<TimelineView> event_to_view (wxMouseEvent &);
 	TimelineContentViewList selected_views () const;
@@ -143,6 +145,8 @@ private:
 	int _pixels_per_track;
 	bool _first_resize;
 	wxTimer _timer;
+	/** x position of the playhead when it was last drawn */
+	boost::optional<int> _playhead_x;
 
 	static double const _minimum_pixels_per_second;
 	static int const _minimum_pixels_per_track;
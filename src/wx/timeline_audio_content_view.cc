@@ -18,14 +18,25 @@
 
 */
 
+#include "timeline.h"
 #include "timeline_audio_content_view.h"
 #include "wx_util.h"
 #include "lib/audio_content.h"
+#include "lib/audio_waveform.h"
+#include "lib/ffmpeg_content.h"
+#include "lib/film.h"
 #include "lib/util.h"
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+#include <wx/graphics.h>
+LIBDCP_ENABLE_WARNINGS
 
+using std::dynamic_pointer_cast;
 using std::list;
+using std::max;
+using std::min;
 using std::shared_ptr;
-using std::dynamic_pointer_cast;
+using namespace dcpomatic;
 
 /** @class TimelineAudioContentView
  *  @brief Timeline view for AudioContent.
@@ -79,3 +90,59 @@ TimelineAudioContentView::label () const
 
 	return s;
 }
+
+
+void
+TimelineAudioContentView::paint_inside (wxGraphicsContext* gc)
+{
+	auto film = _timeline.film ();
+	auto cont = content ();
+	auto const pps = _timeline.pixels_per_second ();
+	if (!film || !cont || !track() || !pps || *pps <= 0) {
+		return;
+	}
+
+	if (!_waveform_read) {
+		if (auto ffmpeg = dynamic_pointer_cast<const FFmpegContent>(cont)) {
+			_waveform = ffmpeg->audio_waveform ();
+		}
+		_waveform_read = true;
+	}
+
+	if (!_waveform || _waveform->empty()) {
+		return;
+	}
+
+	auto const position = cont->position ();
+	auto const frc = film->active_frame_rate_change (position);
+	auto const trim = cont->trim_start ();
+
+	int const x_from = time_x (position) + 2;
+	int const x_to = time_x (position + cont->length_after_trim(film)) - 1;
+	int const top = y_pos (track().get()) + 6;
+	int const bottom = y_pos (track().get() + 1) - 6;
+	double const centre = (top + bottom) / 2.0;
+	double const half_height = (bottom - top) / 2.0;
+
+	/* There is no point in drawing more than one line for each point in the waveform */
+	int const step = max (1, static_cast<int>(*pps / AudioWaveform::points_per_second));
+
+	auto content_time = [&](int x) {
+		return trim + ContentTime(DCPTime::from_seconds(x / *pps) - position, frc);
+	};
+
+	auto path = gc->CreatePath ();
+	for (int x = x_from; x < x_to; x += step) {
+		auto const range = _waveform->range (content_time(x), content_time(min(x + step, x_to)));
+		auto const high = centre - min(1.0f, range.second) * half_height;
+		auto const low = centre - max(-1.0f, range.first) * half_height;
+		double const line_x = x + step / 2.0;
+		path.MoveToPoint (line_x, high);
+		path.AddLineToPoint (line_x, max(low, high + 1));
+	}
+
+	auto colour = foreground_colour ();
+	gc->SetPen (*wxThePenList->FindOrCreatePen(wxColour(colour.Red(), colour.Green(), colour.Blue(), 128), step, wxPENSTYLE_SOLID));
+	gc->StrokePath (path);
+}
+
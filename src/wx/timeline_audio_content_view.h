@@ -22,6 +22,9 @@
 #include "timeline_content_view.h"
 
 
+class AudioWaveform;
+
+
 /** @class TimelineAudioContentView
  *  @brief Timeline view for AudioContent.
  */
@@ -37,4 +40,9 @@ private:
 	wxColour background_colour () const override;
 	wxColour foreground_colour () const override;
 	wxString label () const override;
+	void paint_inside (wxGraphicsContext* gc) override;
+
+	/** Summary of our content's audio; this is read the first time we paint */
+	std::shared_ptr<const AudioWaveform> _waveform;
+	bool _waveform_read = false;
 };
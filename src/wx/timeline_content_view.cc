@@ -141,6 +141,8 @@ TimelineContentView::do_paint (wxGraphicsContext* gc, list<dcpomatic::Rect<int>>
 	gc->StrokePath (path);
 	gc->FillPath (path);
 
+	paint_inside (gc);
+
 	/* Reel split points */
 	gc->SetPen (*wxThePenList->FindOrCreatePen (foreground_colour(), 1, wxPENSTYLE_DOT));
 	for (auto i: cont->reel_split_points(film)) {
@@ -57,6 +57,8 @@ public:
 	virtual wxString label () const;
 
 protected:
+	/** Paint anything that should appear inside our outline, underneath the label */
+	virtual void paint_inside (wxGraphicsContext *) {}
 
 	std::weak_ptr<Content> _content;
 
@@ -31,6 +31,10 @@ class TimelineTextContentView : public TimelineContentView
 public:
 	TimelineTextContentView (Timeline& tl, std::shared_ptr<Content>, std::shared_ptr<TextContent>);
 
+	std::shared_ptr<TextContent> caption () const {
+		return _caption;
+	}
+
 private:
 	bool active () const override;
 	wxColour background_colour () const override;
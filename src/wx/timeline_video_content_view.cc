@@ -18,16 +18,31 @@
 
 */
 
+#include "timeline.h"
+#include "timeline_video_content_view.h"
+#include "lib/film.h"
+#include "lib/frame_rate_change.h"
+#include "lib/image.h"
 #include "lib/image_content.h"
+#include "lib/thumbnail_cache.h"
 #include "lib/video_content.h"
-#include "timeline_video_content_view.h"
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+#include <wx/graphics.h>
+LIBDCP_ENABLE_WARNINGS
+#include <boost/bind/bind.hpp>
+#include <cmath>
 
 using std::dynamic_pointer_cast;
+using std::max;
+using std::min;
 using std::shared_ptr;
+using namespace dcpomatic;
 
 TimelineVideoContentView::TimelineVideoContentView (Timeline& tl, shared_ptr<Content> c)
 	: TimelineContentView (tl, c)
 {
+	_thumbnails_ready_connection = ThumbnailCache::instance()->Ready.connect(boost::bind(&TimelineVideoContentView::force_redraw, this));
 
 }
 
@@ -58,3 +73,88 @@ TimelineVideoContentView::active () const
 	DCPOMATIC_ASSERT (c);
 	return c->video && c->video->use();
 }
+
+
+/** Draw thumbnails of our content, for as much of it as can be seen */
+void
+TimelineVideoContentView::paint_inside (wxGraphicsContext* gc)
+{
+	auto film = _timeline.film ();
+	auto cont = content ();
+	auto const pps = _timeline.pixels_per_second ();
+	if (!film || !cont || !cont->video || !active() || !track() || !pps || *pps <= 0) {
+		return;
+	}
+
+	int const top = y_pos (track().get()) + 6;
+	int const height = y_pos (track().get() + 1) - 6 - top;
+	int const width = std::lrint (height * film->frame_size().ratio());
+	if (height < 8 || width < 1) {
+		return;
+	}
+
+	auto const position = cont->position ();
+	auto const trim = cont->trim_start ();
+	FrameRateChange const frc (film, cont);
+
+	int const x_from = time_x (position) + 4;
+	int const x_to = time_x (cont->end(film)) - 3;
+	auto const visible = _timeline.visible_x_range ();
+
+	/* Space thumbnails by a power-of-two number of seconds so that the same ones
+	 * are used (and cached) at different zoom levels.
+	 */
+	double interval = 0.125;
+	while (interval * *pps < width) {
+		interval *= 2;
+	}
+
+	auto const image_content = dynamic_pointer_cast<const ImageContent>(cont);
+	bool const still = image_content && image_content->still();
+
+	auto content_time = [&](int x) {
+		return trim + ContentTime(DCPTime::from_seconds(x / *pps) - position, frc);
+	};
+
+	if (_bitmaps.size() > 256) {
+		_bitmaps.clear ();
+	}
+
+	gc->PushState ();
+	gc->Clip (x_from, top, max(0, x_to - x_from), height);
+
+	auto cache = ThumbnailCache::instance ();
+	for (auto n = static_cast<int64_t>(std::ceil(content_time(max(x_from, visible.first - width)).seconds() / interval)); ; ++n) {
+		auto const time = ContentTime::from_seconds (n * interval);
+		int const x = time_x (position + DCPTime(time - trim, frc));
+		if (x >= min(x_to, visible.second)) {
+			break;
+		}
+
+		auto image = cache->get (film, cont, still ? ContentTime() : time);
+		if (!image) {
+			continue;
+		}
+
+		auto bitmap = _bitmaps.find (image);
+		if (bitmap == _bitmaps.end()) {
+			auto const size = image->size ();
+			wxImage wx_image (size.width, size.height, false);
+			auto out = wx_image.GetData ();
+			for (int line = 0; line < size.height; ++line) {
+				auto in = image->data()[0] + line * image->stride()[0];
+				for (int pixel = 0; pixel < size.width; ++pixel) {
+					*out++ = *in++;
+					*out++ = *in++;
+					*out++ = *in++;
+					++in;
+				}
+			}
+			bitmap = _bitmaps.emplace (image, wxBitmap(wx_image)).first;
+		}
+
+		gc->DrawBitmap (bitmap->second, x, top, width, height);
+	}
+
+	gc->PopState ();
+}
@@ -20,6 +20,15 @@
 
 
 #include "timeline_content_view.h"
+#include <dcp/warnings.h>
+LIBDCP_DISABLE_WARNINGS
+#include <wx/bitmap.h>
+LIBDCP_ENABLE_WARNINGS
+#include <boost/signals2.hpp>
+#include <map>
+
+
+class Image;
 
 
 /** @class TimelineVideoContentView
@@ -34,4 +43,10 @@ private:
 	bool active () const override;
 	wxColour background_colour () const override;
 	wxColour foreground_colour () const override;
+	void paint_inside (wxGraphicsContext* gc) override;
+
+	/** Bitmaps that we have made from thumbnails */
+	std::map<std::shared_ptr<const Image>, wxBitmap> _bitmaps;
+
+	boost::signals2::scoped_connection _thumbnails_ready_connection;
 };
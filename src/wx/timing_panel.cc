@@ -325,6 +325,7 @@ void
 TimingPanel::position_changed ()
 {
 	DCPTime const pos = _position->get (_parent->film()->video_frame_rate ());
+	ContentChangeSignalBatch batch;
 	for (auto i: _parent->selected()) {
 		i->set_position (_parent->film(), pos);
 	}
@@ -335,6 +336,7 @@ TimingPanel::full_length_changed ()
 {
 	int const vfr = _parent->film()->video_frame_rate ();
 	Frame const len = _full_length->get (vfr).frames_round (vfr);
+	ContentChangeSignalBatch batch;
 	for (auto i: _parent->selected()) {
 		shared_ptr<ImageContent> ic = dynamic_pointer_cast<ImageContent> (i);
 		if (ic && ic->still ()) {
@@ -355,19 +357,22 @@ TimingPanel::trim_start_changed ()
 	optional<DCPTime> ref_ph;
 
 	Suspender::Block bl = _film_content_changed_suspender.block ();
-	for (auto i: _parent->selected()) {
-		if (i->position() <= ph && ph < i->end(_parent->film())) {
-			/* The playhead is in i.  Use it as a reference to work out
-			   where to put the playhead post-trim; we're trying to keep the playhead
-			   at the same frame of content that we're looking at pre-trim.
-			*/
-			ref = i;
-			ref_frc = _parent->film()->active_frame_rate_change (i->position ());
-			ref_ph = ph - i->position() + DCPTime (i->trim_start(), ref_frc.get());
-		}
+	{
+		ContentChangeSignalBatch batch;
+		for (auto i: _parent->selected()) {
+			if (i->position() <= ph && ph < i->end(_parent->film())) {
+				/* The playhead is in i.  Use it as a reference to work out
+				   where to put the playhead post-trim; we're trying to keep the playhead
+				   at the same frame of content that we're looking at pre-trim.
+				*/
+				ref = i;
+				ref_frc = _parent->film()->active_frame_rate_change (i->position ());
+				ref_ph = ph - i->position() + DCPTime (i->trim_start(), ref_frc.get());
+			}
 
-		ContentTime const trim = _trim_start->get (i->video_frame_rate().get_value_or(_parent->film()->video_frame_rate()));
-		i->set_trim_start(_parent->film(), trim);
+			ContentTime const trim = _trim_start->get (i->video_frame_rate().get_value_or(_parent->film()->video_frame_rate()));
+			i->set_trim_start(_parent->film(), trim);
+		}
 	}
 
 	if (ref) {
@@ -383,9 +388,12 @@ TimingPanel::trim_end_changed ()
 	_viewer.set_coalesce_player_changes(true);
 
 	Suspender::Block bl = _film_content_changed_suspender.block ();
-	for (auto i: _parent->selected()) {
-		ContentTime const trim = _trim_end->get (i->video_frame_rate().get_value_or(_parent->film()->video_frame_rate()));
-		i->set_trim_end (trim);
+	{
+		ContentChangeSignalBatch batch;
+		for (auto i: _parent->selected()) {
+			ContentTime const trim = _trim_end->get (i->video_frame_rate().get_value_or(_parent->film()->video_frame_rate()));
+			i->set_trim_end (trim);
+		}
 	}
 
 	/* XXX: maybe playhead-off-the-end-of-the-film should be handled elsewhere */
@@ -401,6 +409,7 @@ TimingPanel::play_length_changed ()
 {
 	DCPTime const play_length = _play_length->get (_parent->film()->video_frame_rate());
 	Suspender::Block bl = _film_content_changed_suspender.block ();
+	ContentChangeSignalBatch batch;
 	for (auto i: _parent->selected()) {
 		FrameRateChange const frc = _parent->film()->active_frame_rate_change (i->position ());
 		auto dcp = max(DCPTime(), i->full_length(_parent->film()) - play_length);
@@ -439,11 +448,14 @@ TimingPanel::trim_start_to_playhead_clicked ()
 
 	_viewer.set_coalesce_player_changes(true);
 
-	for (auto i: _parent->selected()) {
-		if (i->position() < ph && ph < i->end(film)) {
-			FrameRateChange const frc = film->active_frame_rate_change (i->position());
-			i->set_trim_start(film, i->trim_start() + ContentTime(ph - i->position(), frc));
-			new_ph = i->position ();
+	{
+		ContentChangeSignalBatch batch;
+		for (auto i: _parent->selected()) {
+			if (i->position() < ph && ph < i->end(film)) {
+				FrameRateChange const frc = film->active_frame_rate_change (i->position());
+				i->set_trim_start(film, i->trim_start() + ContentTime(ph - i->position(), frc));
+				new_ph = i->position ();
+			}
 		}
 	}
 
@@ -459,6 +471,7 @@ TimingPanel::trim_end_to_playhead_clicked ()
 {
 	auto film = _parent->film ();
 	auto const ph = _viewer.position().floor(film->video_frame_rate());
+	ContentChangeSignalBatch batch;
 	for (auto i: _parent->selected()) {
 		if (i->position() < ph && ph < i->end(film)) {
 			FrameRateChange const frc = film->active_frame_rate_change (i->position ());
@@ -511,6 +524,7 @@ TimingPanel::move_to_start_of_reel_clicked ()
 	auto d = make_wx<MoveToDialog>(this, position, _parent->film());
 
 	if (d->ShowModal() == wxID_OK) {
+		ContentChangeSignalBatch batch;
 		for (auto i: _parent->selected()) {
 			i->set_position (_parent->film(), d->position());
 		}
@@ -23,8 +23,10 @@
 #include "wx_util.h"
 #include "film_viewer.h"
 #include "lib/butler.h"
+#include "lib/config.h"
 #include "lib/dcpomatic_log.h"
 #include <boost/optional.hpp>
+#include <algorithm>
 #include <sys/time.h>
 
 
@@ -34,13 +36,16 @@ using boost::optional;
 
 static constexpr int TOO_MANY_DROPPED_FRAMES = 20;
 static constexpr int TOO_MANY_DROPPED_PERIOD = 5.0;
+/** Seconds of playback without any dropped frames before we say that we have caught up */
+static constexpr int CAUGHT_UP_PERIOD = 30;
 
 
 VideoView::VideoView (FilmViewer* viewer)
 	: _viewer (viewer)
 	, _state_timer ("viewer")
+	, _cache (static_cast<size_t>(Config::instance()->preview_frame_cache_size()) * 1024 * 1024)
 {
-
+	gettimeofday(&_last_drop, nullptr);
 }
 
 
@@ -50,6 +55,72 @@ VideoView::clear ()
 	boost::mutex::scoped_lock lm (_mutex);
 	_player_video.first.reset ();
 	_player_video.second = dcpomatic::DCPTime ();
+	_prefetched.first.reset ();
+	_cache_until = boost::none;
+	_cache.clear ();
+}
+
+
+/** Forget any frame that we got from the butler in advance; this must be called
+ *  whenever the butler is seeked or replaced.
+ */
+void
+VideoView::forget_prefetched ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_prefetched.first.reset ();
+	_cache_until = boost::none;
+}
+
+
+/** If we have the frame at some time in our cache, arrange for it to be the next
+ *  one that we show.
+ *  @return true if we had the frame, false if it must come from the butler.
+ */
+bool
+VideoView::use_cached_frame (dcpomatic::DCPTime time)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	if (_video_frame_rate == 0) {
+		return false;
+	}
+
+	auto video = _cache.get(time, dcpomatic::DCPTime::from_frames(1, _video_frame_rate) / 2);
+	if (!video) {
+		return false;
+	}
+
+	_prefetched = *video;
+	_cache_until = boost::none;
+	return true;
+}
+
+
+/** Cache, but do not show, any frames that come from the butler before a given time.
+ *  This must be called after forget_prefetched().
+ */
+void
+VideoView::cache_frames_until (dcpomatic::DCPTime time)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	_cache_until = time;
+}
+
+
+/** Forget all cached frames; this must be called whenever something changes which
+ *  would make the player give us different frames.
+ */
+void
+VideoView::clear_cache ()
+{
+	_cache.clear ();
+}
+
+
+void
+VideoView::set_cache_memory_limit (size_t limit)
+{
+	_cache.set_memory_limit (limit);
 }
 
 
@@ -73,6 +144,52 @@ VideoView::get_next_frame (bool non_blocking)
 
 	boost::mutex::scoped_lock lm (_mutex);
 
+	if (_prefetched.first) {
+		_player_video = _prefetched;
+		_prefetched.first.reset ();
+	} else {
+		std::pair<shared_ptr<PlayerVideo>, dcpomatic::DCPTime> video;
+		while (true) {
+			auto const r = fetch (butler, non_blocking, video);
+			if (r != SUCCESS) {
+				return r;
+			}
+			_cache.put (video.first, video.second);
+			if (!_cache_until || _video_frame_rate == 0 || video.second >= (*_cache_until - dcpomatic::DCPTime::from_frames(1, _video_frame_rate) / 2)) {
+				break;
+			}
+		}
+		_cache_until = boost::none;
+		_player_video = video;
+	}
+
+	if (_player_video.first && _player_video.first->error()) {
+		++_errored;
+	}
+
+	struct timeval now;
+	gettimeofday(&now, nullptr);
+	bool const caught_up = (seconds(now) - seconds(_last_drop)) > CAUGHT_UP_PERIOD;
+	if (caught_up) {
+		_last_drop = now;
+	}
+
+	lm.unlock();
+
+	if (caught_up) {
+		emit(boost::bind(boost::ref(CaughtUp)));
+	}
+
+	return SUCCESS;
+}
+
+
+/** Get a frame for the eye that we are showing from the butler.  A lock must be held on _mutex.
+ *  @param video Filled in with the frame.
+ */
+VideoView::NextFrameResult
+VideoView::fetch (shared_ptr<Butler> butler, bool non_blocking, std::pair<shared_ptr<PlayerVideo>, dcpomatic::DCPTime>& video)
+{
 	do {
 		Butler::Error e;
 		auto pv = butler->get_video (non_blocking ? Butler::Behaviour::NON_BLOCKING : Butler::Behaviour::BLOCKING, &e);
@@ -82,19 +199,43 @@ VideoView::get_next_frame (bool non_blocking)
 		if (!pv.first) {
 			return e.code == Butler::Error::Code::AGAIN ? AGAIN : FAIL;
 		}
-		_player_video = pv;
+		video = pv;
 	} while (
-		_player_video.first &&
+		video.first &&
 		_three_d &&
-		_eyes != _player_video.first->eyes() &&
-		_player_video.first->eyes() != Eyes::BOTH
+		_eyes != video.first->eyes() &&
+		video.first->eyes() != Eyes::BOTH
 		);
 
-	if (_player_video.first && _player_video.first->error()) {
-		++_errored;
+	return SUCCESS;
+}
+
+
+/** Get the frame after the current one from the butler, if it is ready, so that we
+ *  have it to hand when it is due.  Could be called from any thread.
+ */
+void
+VideoView::prefetch_next_frame ()
+{
+	if (length() == dcpomatic::DCPTime()) {
+		return;
 	}
 
-	return SUCCESS;
+	auto butler = _viewer->butler ();
+	if (!butler) {
+		return;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	if (_prefetched.first) {
+		return;
+	}
+
+	std::pair<shared_ptr<PlayerVideo>, dcpomatic::DCPTime> video;
+	if (fetch(butler, true, video) == SUCCESS) {
+		_cache.put (video.first, video.second);
+		_prefetched = video;
+	}
 }
 
 
@@ -108,6 +249,18 @@ VideoView::one_video_frame () const
 /** @return Time in ms until the next frame is due, or empty if nothing is due */
 optional<int>
 VideoView::time_until_next_frame () const
+{
+	auto const until = seconds_until_next_frame ();
+	if (!until) {
+		return {};
+	}
+	return std::max(0.0, *until) * 1000;
+}
+
+
+/** @return Time in seconds until the next frame is due (negative if it is overdue), or empty if nothing is due */
+optional<double>
+VideoView::seconds_until_next_frame () const
 {
 	if (length() == dcpomatic::DCPTime()) {
 		/* There's no content, so this doesn't matter */
@@ -115,11 +268,16 @@ VideoView::time_until_next_frame () const
 	}
 
 	auto const next = position() + one_video_frame();
-	auto const time = _viewer->audio_time().get_value_or(position());
-	if (next < time) {
-		return 0;
-	}
-	return (next.seconds() - time.seconds()) * 1000;
+	return (next - _viewer->audio_time().get_value_or(position())).seconds();
+}
+
+
+/** @return Time in seconds since the current frame was due (negative if it is not yet due) */
+double
+VideoView::lateness () const
+{
+	auto const current = position ();
+	return (_viewer->audio_time().get_value_or(current) - current).seconds();
 }
 
 
@@ -130,6 +288,10 @@ VideoView::start ()
 	_dropped = 0;
 	_errored = 0;
 	gettimeofday(&_dropped_check_period_start, nullptr);
+	_last_drop = _dropped_check_period_start;
+	lm.unlock ();
+
+	_scheduler.start ();
 }
 
 
@@ -158,9 +320,10 @@ VideoView::add_dropped ()
 	{
 		boost::mutex::scoped_lock lm (_mutex);
 		++_dropped;
+		struct timeval now;
+		gettimeofday (&now, nullptr);
+		_last_drop = now;
 		if (_dropped > TOO_MANY_DROPPED_FRAMES) {
-			struct timeval now;
-			gettimeofday (&now, nullptr);
 			double const elapsed = seconds(now) - seconds(_dropped_check_period_start);
 			too_many = elapsed < TOO_MANY_DROPPED_PERIOD;
 			_dropped = 0;
@@ -168,6 +331,8 @@ VideoView::add_dropped ()
 		}
 	}
 
+	_scheduler.dropped ();
+
 	if (too_many) {
 		emit (boost::bind(boost::ref(TooManyDropped)));
 	}
@@ -25,6 +25,8 @@
 
 #include "lib/dcpomatic_time.h"
 #include "lib/exception_store.h"
+#include "lib/player_video_cache.h"
+#include "lib/presentation_scheduler.h"
 #include "lib/signaller.h"
 #include "lib/timer.h"
 #include "lib/types.h"
@@ -37,6 +39,7 @@ LIBDCP_ENABLE_WARNINGS
 #include <boost/thread.hpp>
 
 
+class Butler;
 class FilmViewer;
 class Image;
 class Player;
@@ -72,12 +75,19 @@ public:
 	virtual NextFrameResult display_next_frame (bool) = 0;
 
 	void clear ();
+	void forget_prefetched ();
+	bool use_cached_frame (dcpomatic::DCPTime time);
+	void cache_frames_until (dcpomatic::DCPTime time);
+	void clear_cache ();
+	void set_cache_memory_limit (size_t limit);
 	bool reset_metadata (std::shared_ptr<const Film> film, dcp::Size player_video_container_size);
 
 	/** Emitted from the GUI thread when our display changes in size */
 	boost::signals2::signal<void()> Sized;
 	/** Emitted from the GUI thread when a lot of frames are being dropped */
 	boost::signals2::signal<void()> TooManyDropped;
+	/** Emitted from the GUI thread when playback has gone for a while without dropping any frames */
+	boost::signals2::signal<void()> CaughtUp;
 
 
 	/* Accessors for FilmViewer */
@@ -97,6 +107,10 @@ public:
 		return _gets;
 	}
 
+	PresentationScheduler::Statistics pacing () const {
+		return _scheduler.statistics();
+	}
+
 	StateTimer const & state_timer () const {
 		return _state_timer;
 	}
@@ -138,6 +152,9 @@ public:
 protected:
 	NextFrameResult get_next_frame (bool non_blocking);
 	boost::optional<int> time_until_next_frame () const;
+	boost::optional<double> seconds_until_next_frame () const;
+	double lateness () const;
+	void prefetch_next_frame ();
 	dcpomatic::DCPTime one_video_frame () const;
 
 	wxColour pad_colour () const;
@@ -182,11 +199,21 @@ protected:
 
 	bool _optimise_for_j2k = false;
 
+	PresentationScheduler _scheduler;
+
 private:
+	NextFrameResult fetch (std::shared_ptr<Butler> butler, bool non_blocking, std::pair<std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime>& video);
+
 	/** Mutex protecting all the state in this class */
 	mutable boost::mutex _mutex;
 
 	std::pair<std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime> _player_video;
+	/** The frame after _player_video, if we have already got it from the butler */
+	std::pair<std::shared_ptr<PlayerVideo>, dcpomatic::DCPTime> _prefetched;
+	/** Frames that we have recently got from the butler, so that we can go back to them without seeking */
+	PlayerVideoCache _cache;
+	/** If set, frames from the butler before this time should be put in _cache rather than shown */
+	boost::optional<dcpomatic::DCPTime> _cache_until;
 	int _video_frame_rate = 0;
 	/** length of the film we are playing, or 0 if there is none */
 	dcpomatic::DCPTime _length;
@@ -195,6 +222,8 @@ private:
 
 	int _dropped = 0;
 	struct timeval _dropped_check_period_start;
+	/** time of the last dropped frame, or the start of playback or the last CaughtUp emission */
+	struct timeval _last_drop;
 	int _errored = 0;
 	int _gets = 0;
 };
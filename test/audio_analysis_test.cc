@@ -29,22 +29,34 @@
 
 #include "lib/analyse_audio_job.h"
 #include "lib/audio_analysis.h"
+#include "lib/audio_buffers.h"
 #include "lib/audio_content.h"
+#include "lib/audio_point.h"
 #include "lib/content_factory.h"
 #include "lib/dcp_content_type.h"
 #include "lib/ffmpeg_content.h"
 #include "lib/ffmpeg_content.h"
 #include "lib/film.h"
 #include "lib/job_manager.h"
+#include "lib/player.h"
 #include "lib/playlist.h"
 #include "lib/ratio.h"
+#include "lib/subtitle_analysis.h"
+#include "lib/true_peak_meter.h"
 #include "test.h"
+#include <dcp/filesystem.h>
+#include <boost/bind/bind.hpp>
 #include <boost/test/unit_test.hpp>
 
 
 using std::make_shared;
+using std::shared_ptr;
 using std::vector;
+using boost::bind;
 using namespace dcpomatic;
+#if BOOST_VERSION >= 106100
+using namespace boost::placeholders;
+#endif
 
 
 BOOST_AUTO_TEST_CASE (audio_analysis_serialisation_test)
@@ -98,6 +110,98 @@ BOOST_AUTO_TEST_CASE (audio_analysis_serialisation_test)
 }
 
 
+/** Check that both the old XML and the new binary formats can be written and read back */
+BOOST_AUTO_TEST_CASE (audio_analysis_formats_test)
+{
+	int const channels = 6;
+	int const points = 1023;
+
+	AudioAnalysis a (channels);
+	for (int i = 0; i < channels; ++i) {
+		for (int j = 0; j < points; ++j) {
+			AudioPoint p;
+			p[AudioPoint::PEAK] = j * 0.001 + i;
+			p[AudioPoint::RMS] = j * 0.0005 + i;
+			a.add_point (i, p);
+		}
+	}
+
+	vector<AudioAnalysis::PeakTime> peak;
+	vector<float> true_peak;
+	for (int i = 0; i < channels; ++i) {
+		peak.push_back (AudioAnalysis::PeakTime(i * 0.1, DCPTime(i * 1000)));
+		true_peak.push_back (i * 0.2);
+	}
+	a.set_sample_peak (peak);
+	a.set_true_peak (true_peak);
+	a.set_integrated_loudness (-23.5);
+	a.set_leqm (82.25);
+	a.set_samples_per_point (100);
+	a.set_sample_rate (48000);
+
+	for (auto format: { AudioAnalysis::Format::XML, AudioAnalysis::Format::BINARY }) {
+		boost::filesystem::path const path = "build/test/audio_analysis_formats_test";
+		a.write (path, format);
+
+		AudioAnalysis b (path);
+		BOOST_REQUIRE_EQUAL (b.channels(), channels);
+		for (int i = 0; i < channels; ++i) {
+			BOOST_REQUIRE_EQUAL (b.points(i), points);
+			for (int j = 0; j < points; ++j) {
+				BOOST_CHECK_CLOSE (b.get_point(i, j)[AudioPoint::PEAK], a.get_point(i, j)[AudioPoint::PEAK], 0.01);
+				BOOST_CHECK_CLOSE (b.get_point(i, j)[AudioPoint::RMS], a.get_point(i, j)[AudioPoint::RMS], 0.01);
+			}
+			BOOST_CHECK_CLOSE (b.sample_peak()[i].peak, peak[i].peak, 0.01);
+			BOOST_CHECK_EQUAL (b.sample_peak()[i].time.get(), peak[i].time.get());
+			BOOST_CHECK_CLOSE (b.true_peak()[i], true_peak[i], 0.01);
+		}
+
+		BOOST_CHECK_CLOSE (b.integrated_loudness().get_value_or(0), -23.5, 0.01);
+		BOOST_CHECK (!b.loudness_range());
+		BOOST_CHECK (!b.analysis_gain());
+		BOOST_CHECK_CLOSE (b.leqm().get_value_or(0), 82.25, 0.01);
+		BOOST_CHECK_EQUAL (b.samples_per_point(), 100);
+		BOOST_CHECK_EQUAL (b.sample_rate(), 48000);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE (audio_analysis_levels_test)
+{
+	AudioAnalysis a (1);
+	for (int i = 0; i < 5; ++i) {
+		AudioPoint p;
+		p[AudioPoint::PEAK] = i * 0.1;
+		p[AudioPoint::RMS] = i * 0.1;
+		a.add_point (0, p);
+	}
+	a.set_samples_per_point (100);
+
+	/* 5 -> 3 -> 2 -> 1 points */
+	BOOST_REQUIRE_EQUAL (a.levels(), 4);
+	BOOST_CHECK_EQUAL (a.points(0, 1), 3);
+	BOOST_CHECK_EQUAL (a.points(0, 2), 2);
+	BOOST_CHECK_EQUAL (a.points(0, 3), 1);
+
+	BOOST_CHECK_CLOSE (a.get_point(0, 0, 1)[AudioPoint::PEAK], 0.1, 0.01);
+	BOOST_CHECK_CLOSE (a.get_point(0, 0, 1)[AudioPoint::RMS], sqrt(0.01 / 2), 0.01);
+	BOOST_CHECK_CLOSE (a.get_point(0, 2, 1)[AudioPoint::PEAK], 0.4, 0.01);
+	BOOST_CHECK_CLOSE (a.get_point(0, 2, 1)[AudioPoint::RMS], 0.4, 0.01);
+	BOOST_CHECK_CLOSE (a.get_point(0, 0, 3)[AudioPoint::PEAK], 0.4, 0.01);
+
+	BOOST_CHECK_EQUAL (a.samples_per_point(2), 400);
+	BOOST_CHECK_EQUAL (a.level_for_samples_per_point(50), 0);
+	BOOST_CHECK_EQUAL (a.level_for_samples_per_point(250), 1);
+	BOOST_CHECK_EQUAL (a.level_for_samples_per_point(100000), 3);
+
+	/* Adding a point must throw away the old levels */
+	a.add_point (0, AudioPoint());
+	BOOST_CHECK_EQUAL (a.points(0, 1), 3);
+	BOOST_CHECK_CLOSE (a.get_point(0, 2, 1)[AudioPoint::PEAK], 0.4, 0.01);
+	BOOST_CHECK_EQUAL (a.levels(), 4);
+}
+
+
 BOOST_AUTO_TEST_CASE (audio_analysis_test)
 {
 	auto film = new_test_film ("audio_analysis_test");
@@ -239,3 +343,145 @@ BOOST_AUTO_TEST_CASE(analyse_audio_with_strange_channel_count)
 	BOOST_CHECK(!wait_for_jobs());
 }
 
+
+
+/** Audio analysis should also analyse the subtitles of any content which needs it */
+BOOST_AUTO_TEST_CASE(analyse_audio_also_analyses_subtitles)
+{
+	auto audio = content_factory("test/data/sine_440.wav")[0];
+	auto sub = content_factory("test/data/15s.srt")[0];
+	auto film = new_test_film2("analyse_audio_also_analyses_subtitles", { audio, sub });
+
+	BOOST_REQUIRE(!dcp::filesystem::exists(film->subtitle_analysis_path(sub)));
+
+	boost::signals2::connection c;
+	JobManager::instance()->analyse_audio(film, film->playlist(), false, c, [](Job::Result) {});
+	BOOST_CHECK(!wait_for_jobs());
+
+	BOOST_REQUIRE(dcp::filesystem::exists(film->subtitle_analysis_path(sub)));
+	SubtitleAnalysis analysis(film->subtitle_analysis_path(sub));
+	BOOST_CHECK(analysis.bounding_box());
+}
+
+
+/** Analysing audio in parts and merging the results should give the same points and peaks
+ *  as analysing it all at once.
+ */
+BOOST_AUTO_TEST_CASE(audio_analysis_in_parts_matches_whole)
+{
+	auto content = content_factory("test/data/sine_440.wav")[0];
+	auto film = new_test_film2("audio_analysis_in_parts_matches_whole", { content });
+	auto playlist = film->playlist();
+
+	auto analyse = [film, playlist](AudioAnalyser& analyser, DCPTime from) {
+		Player player(film, playlist);
+		player.set_ignore_video();
+		player.set_ignore_text();
+		player.Audio.connect(bind(&AudioAnalyser::analyse, &analyser, _1, _2));
+		player.seek(from, true);
+		while (!analyser.period_done() && !player.pass()) {}
+		analyser.finish();
+	};
+
+	AudioAnalyser whole_analyser(film, playlist, false, [](float) {});
+	analyse(whole_analyser, whole_analyser.start());
+	auto whole = whole_analyser.get();
+
+	auto periods = AudioAnalyser::split(film, playlist, false, 3);
+	BOOST_REQUIRE_EQUAL(periods.size(), 3U);
+
+	vector<shared_ptr<AudioAnalyser>> parts;
+	for (auto period: periods) {
+		parts.push_back(make_shared<AudioAnalyser>(film, playlist, false, [](float) {}, period));
+		analyse(*parts.back(), period.from);
+	}
+	auto merged = AudioAnalyser::merge(parts);
+
+	BOOST_REQUIRE_EQUAL(merged.channels(), whole.channels());
+	for (int c = 0; c < whole.channels(); ++c) {
+		BOOST_REQUIRE_EQUAL(merged.points(c), whole.points(c));
+		for (int p = 0; p < whole.points(c); ++p) {
+			BOOST_CHECK_CLOSE(merged.get_point(c, p)[AudioPoint::PEAK], whole.get_point(c, p)[AudioPoint::PEAK], 1e-3);
+			BOOST_CHECK_CLOSE(merged.get_point(c, p)[AudioPoint::RMS], whole.get_point(c, p)[AudioPoint::RMS], 1e-3);
+		}
+		BOOST_CHECK_CLOSE(merged.sample_peak()[c].peak, whole.sample_peak()[c].peak, 1e-3);
+		BOOST_CHECK(merged.sample_peak()[c].time == whole.sample_peak()[c].time);
+	}
+
+	BOOST_CHECK_CLOSE(merged.leqm().get_value_or(0), whole.leqm().get_value_or(0), 1);
+}
+
+
+/** An analysis which re-uses the cached analysis of an unchanged region of the playlist should
+ *  give the same results as one made from scratch.
+ */
+BOOST_AUTO_TEST_CASE(audio_analysis_reuses_unchanged_regions)
+{
+	auto A = content_factory("test/data/sine_440.wav")[0];
+	auto B = content_factory("test/data/sine_440.wav")[0];
+	auto film = new_test_film2("audio_analysis_reuses_unchanged_regions", { A, B });
+	auto playlist = film->playlist();
+
+	auto analyse = [film, playlist]() -> AudioAnalysis {
+		boost::signals2::connection c;
+		JobManager::instance()->analyse_audio(film, playlist, false, c, [](Job::Result) {});
+		BOOST_REQUIRE(!wait_for_jobs());
+		return AudioAnalysis(film->audio_analysis_path(playlist));
+	};
+
+	auto first_own_region = [film, playlist]() -> std::string {
+		for (auto const& region: AudioAnalyser::split_by_content(film, playlist, false)) {
+			if (region.digest) {
+				return *region.digest;
+			}
+		}
+		return std::string();
+	};
+
+	analyse();
+	auto const digest = first_own_region();
+	BOOST_REQUIRE(!digest.empty());
+	BOOST_REQUIRE(dcp::filesystem::exists(film->audio_analysis_region_path(digest)));
+
+	/* Changing B should leave A's region alone */
+	B->audio->set_gain(-6);
+	BOOST_CHECK_EQUAL(first_own_region(), digest);
+	auto reused = analyse();
+
+	dcp::filesystem::remove_all(film->dir("analysis"));
+	auto fresh = analyse();
+
+	BOOST_REQUIRE_EQUAL(reused.channels(), fresh.channels());
+	for (int c = 0; c < fresh.channels(); ++c) {
+		BOOST_REQUIRE_EQUAL(reused.points(c), fresh.points(c));
+		for (int p = 0; p < fresh.points(c); ++p) {
+			BOOST_CHECK_CLOSE(reused.get_point(c, p)[AudioPoint::PEAK], fresh.get_point(c, p)[AudioPoint::PEAK], 1e-3);
+			BOOST_CHECK_CLOSE(reused.get_point(c, p)[AudioPoint::RMS], fresh.get_point(c, p)[AudioPoint::RMS], 1e-3);
+		}
+		BOOST_CHECK_CLOSE(reused.sample_peak()[c].peak, fresh.sample_peak()[c].peak, 1e-3);
+		BOOST_CHECK(reused.sample_peak()[c].time == fresh.sample_peak()[c].time);
+	}
+}
+
+
+/* A sine at a quarter of the sample rate, 45 degrees out of phase with the samples, never has a sample at its peak */
+BOOST_AUTO_TEST_CASE(true_peak_meter_test)
+{
+	TruePeakMeter meter(2);
+
+	for (int block = 0; block < 10; ++block) {
+		AudioBuffers audio(2, 4800);
+		for (int i = 0; i < audio.frames(); ++i) {
+			audio.data(0)[i] = 0.5 * sin(M_PI * (block * audio.frames() + i) / 2 + M_PI / 4);
+			audio.data(1)[i] = 0;
+		}
+		meter.process(audio);
+	}
+
+	meter.flush();
+
+	auto const peaks = meter.peaks();
+	BOOST_REQUIRE_EQUAL(peaks.size(), 2U);
+	BOOST_CHECK_CLOSE(peaks[0], 0.5, 2);
+	BOOST_CHECK_EQUAL(peaks[1], 0);
+}
@@ -385,3 +385,46 @@ BOOST_AUTO_TEST_CASE(audio_buffers_set_channels_higher)
 		}
 	}
 }
+
+
+/** Check that AudioBuffers made from re-used storage are silent */
+BOOST_AUTO_TEST_CASE(audio_buffers_reuse_is_silent)
+{
+	{
+		AudioBuffers buffers(6, 4000);
+		random_fill(buffers);
+	}
+
+	AudioBuffers buffers(6, 3000);
+	for (int c = 0; c < 6; ++c) {
+		for (int i = 0; i < 3000; ++i) {
+			BOOST_REQUIRE_EQUAL(buffers.data(c)[i], 0);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(audio_buffers_move_construct_and_assign)
+{
+	AudioBuffers a(3, 500);
+	srand(7);
+	random_fill(a);
+
+	AudioBuffers b(std::move(a));
+	BOOST_CHECK_EQUAL(a.channels(), 0);
+	BOOST_CHECK_EQUAL(a.frames(), 0);
+	BOOST_REQUIRE_EQUAL(b.channels(), 3);
+	BOOST_REQUIRE_EQUAL(b.frames(), 500);
+
+	AudioBuffers c(1, 1);
+	c = std::move(b);
+	BOOST_REQUIRE_EQUAL(c.channels(), 3);
+	BOOST_REQUIRE_EQUAL(c.frames(), 500);
+
+	srand(7);
+	for (int i = 0; i < 500; ++i) {
+		for (int ch = 0; ch < 3; ++ch) {
+			BOOST_CHECK_EQUAL(c.data(ch)[i], random_float());
+		}
+	}
+}
@@ -28,6 +28,7 @@
 #include <boost/test/unit_test.hpp>
 #include "lib/audio_filter.h"
 #include "lib/audio_buffers.h"
+#include "lib/rng.h"
 
 
 using std::make_shared;
@@ -110,3 +111,48 @@ BOOST_AUTO_TEST_CASE (audio_filter_impulse_input_test)
 		}
 	}
 }
+
+
+/** Check that a filter with a long kernel (which is applied using FFTs) gives the same
+ *  results as direct convolution, whatever the block size and number of channels.
+ */
+BOOST_AUTO_TEST_CASE (audio_filter_fft_test)
+{
+	LowPassAudioFilter fft (0.01, 0.1);
+	BOOST_REQUIRE (static_cast<int>(fft._ir.size()) >= 256);
+
+	/* A copy of the kernel, applied the obvious way */
+	auto const ir = fft._ir;
+	int const M = fft._M;
+
+	int const channels = 3;
+	std::vector<std::vector<float>> input(channels);
+
+	dcpomatic::RNG rng(1);
+	for (auto block_size: { 17, 401, 4096 }) {
+		auto in = make_shared<AudioBuffers>(channels, block_size);
+		for (int c = 0; c < channels; ++c) {
+			for (int i = 0; i < block_size; ++i) {
+				auto const s = static_cast<float>(rng.get() & 0xffff) / 32768 - 1;
+				in->data(c)[i] = s;
+				input[c].push_back(s);
+			}
+		}
+
+		auto out = fft.run(in);
+
+		for (int c = 0; c < channels; ++c) {
+			int const offset = input[c].size() - block_size;
+			for (int i = 0; i < block_size; ++i) {
+				double expected = 0;
+				for (int k = 0; k <= M; ++k) {
+					auto const n = offset + i - k;
+					if (n >= 0) {
+						expected += input[c][n] * ir[k];
+					}
+				}
+				BOOST_REQUIRE_SMALL (out->data(c)[i] - expected, 1e-5);
+			}
+		}
+	}
+}
@@ -26,12 +26,14 @@
 
 
 #include <boost/test/unit_test.hpp>
+#include "lib/audio_buffers.h"
 #include "lib/audio_mapping.h"
 #include "lib/constants.h"
 #include "lib/compose.hpp"
 
 
 using std::list;
+using std::make_shared;
 using std::string;
 using boost::optional;
 
@@ -148,3 +150,59 @@ BOOST_AUTO_TEST_CASE(audio_mapping_take_from_smaller)
 	BOOST_CHECK_CLOSE(A.get(0, 2), 1, 0.01);
 	BOOST_CHECK_CLOSE(A.get(1, 2), 9, 0.01);
 }
+
+
+BOOST_AUTO_TEST_CASE(sparse_audio_mapping_test)
+{
+	AudioMapping mapping(3, 6);
+	mapping.set(0, 0, 1);
+	mapping.set(2, 0, 0.5);
+	mapping.set(1, 1, 2);
+	mapping.set(2, 3, 0.25);
+	/* Should be ignored, as it is beyond the outputs we ask for */
+	mapping.set(0, 5, 1);
+
+	/* Leave some non-zero channels in the pool so that we can check that unmapped outputs are silenced */
+	{
+		AudioBuffers dirty(6, 64);
+		for (int c = 0; c < dirty.channels(); ++c) {
+			for (int f = 0; f < dirty.frames(); ++f) {
+				dirty.data(c)[f] = 42;
+			}
+		}
+	}
+
+	auto input = make_shared<AudioBuffers>(3, 64);
+	for (int c = 0; c < input->channels(); ++c) {
+		for (int f = 0; f < input->frames(); ++f) {
+			input->data(c)[f] = (c + 1) * 0.01 + f * 0.001;
+		}
+	}
+
+	SparseAudioMapping sparse(mapping, 4);
+	BOOST_CHECK_EQUAL(sparse.output_channels(), 4);
+
+	auto output = sparse.run(input);
+	BOOST_REQUIRE_EQUAL(output->channels(), 4);
+	BOOST_REQUIRE_EQUAL(output->frames(), 64);
+
+	for (int f = 0; f < 64; ++f) {
+		BOOST_CHECK_CLOSE(output->data(0)[f], input->data(0)[f] + input->data(2)[f] * 0.5, 1e-4);
+		BOOST_CHECK_CLOSE(output->data(1)[f], input->data(1)[f] * 2, 1e-4);
+		BOOST_CHECK_EQUAL(output->data(2)[f], 0);
+		BOOST_CHECK_CLOSE(output->data(3)[f], input->data(2)[f] * 0.25, 1e-4);
+	}
+
+	/* Inputs that the mapping mentions but the audio doesn't have are skipped */
+	auto stereo = make_shared<AudioBuffers>(2, 64);
+	stereo->copy_channel_from(input.get(), 0, 0);
+	stereo->copy_channel_from(input.get(), 1, 1);
+	output = sparse.run(stereo);
+
+	for (int f = 0; f < 64; ++f) {
+		BOOST_CHECK_CLOSE(output->data(0)[f], input->data(0)[f], 1e-4);
+		BOOST_CHECK_CLOSE(output->data(1)[f], input->data(1)[f] * 2, 1e-4);
+		BOOST_CHECK_EQUAL(output->data(2)[f], 0);
+		BOOST_CHECK_EQUAL(output->data(3)[f], 0);
+	}
+}
@@ -100,6 +100,32 @@ BOOST_AUTO_TEST_CASE (audio_merger_test1)
 }
 
 
+/* As audio_merger_test1 but with the later block pushed first */
+BOOST_AUTO_TEST_CASE (audio_merger_test1b)
+{
+	AudioMerger merger (sampling_rate);
+
+	push (merger, 0, 64, 22);
+	push (merger, 0, 64, 0);
+
+	auto tb = merger.pull (DCPTime::from_frames (22 + 64, sampling_rate));
+	BOOST_REQUIRE (tb.size() == 1U);
+	BOOST_CHECK_EQUAL (tb.front().first->frames(), 22 + 64);
+	BOOST_CHECK_EQUAL (tb.front().second.get(), 0);
+
+	for (int i = 0; i < 22 + 64; ++i) {
+		int correct = 0;
+		if (i < 64) {
+			correct += i;
+		}
+		if (i >= 22) {
+			correct += i - 22;
+		}
+		BOOST_CHECK_EQUAL (tb.front().first->data()[0][i], correct);
+	}
+}
+
+
 /* Push at non-zero time */
 BOOST_AUTO_TEST_CASE (audio_merger_test2)
 {
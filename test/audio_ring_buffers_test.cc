@@ -21,6 +21,8 @@
 
 #include "lib/audio_ring_buffers.h"
 #include <boost/test/unit_test.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
 
 
 using std::make_shared;
@@ -194,3 +196,104 @@ BOOST_AUTO_TEST_CASE (audio_ring_buffers_test3)
 	BOOST_CHECK (!rb.get(buffer, 2, 240));
 	BOOST_CHECK_EQUAL (buffer[240 * 2], CANARY);
 }
+
+
+/** Fetching without interleaving, across the boundary between two put()s and then into an underrun */
+BOOST_AUTO_TEST_CASE (audio_ring_buffers_deinterleaved_test)
+{
+	AudioRingBuffers rb;
+
+	int value = 0;
+	for (int k = 0; k < 2; ++k) {
+		auto data = make_shared<AudioBuffers>(2, 50);
+		for (int i = 0; i < 50; ++i) {
+			for (int j = 0; j < 2; ++j) {
+				data->data(j)[i] = value++;
+			}
+		}
+		rb.put (data, DCPTime::from_frames(k * 50, 48000), 48000);
+	}
+	BOOST_CHECK_EQUAL (rb.size(), 100);
+
+	/* Ask for more channels than were put in */
+	AudioBuffers out(3, 70);
+	BOOST_CHECK (*rb.get(out) == DCPTime());
+	int check = 0;
+	for (int i = 0; i < 70; ++i) {
+		for (int j = 0; j < 2; ++j) {
+			BOOST_REQUIRE_EQUAL (out.data(j)[i], check++);
+		}
+		BOOST_REQUIRE_EQUAL (out.data(2)[i], 0);
+	}
+	BOOST_CHECK_EQUAL (rb.size(), 30);
+
+	/* The last 30 frames then silence */
+	BOOST_CHECK (*rb.get(out) == DCPTime::from_frames(70, 48000));
+	for (int i = 0; i < 70; ++i) {
+		for (int j = 0; j < 2; ++j) {
+			float const expected = i < 30 ? check++ : 0;
+			BOOST_REQUIRE_EQUAL (out.data(j)[i], expected);
+		}
+		BOOST_REQUIRE_EQUAL (out.data(2)[i], 0);
+	}
+	BOOST_CHECK_EQUAL (rb.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE (audio_ring_buffers_memory_used)
+{
+	AudioRingBuffers rb;
+	BOOST_CHECK_EQUAL (rb.memory_used(), 0U);
+
+	auto data = make_shared<AudioBuffers>(16, 2000);
+	data->make_silent ();
+	rb.put (data, DCPTime(), 48000);
+	rb.put (data, DCPTime::from_frames(2000, 48000), 48000);
+	BOOST_CHECK_EQUAL (rb.memory_used(), 2 * 16 * 2000 * sizeof(float));
+
+	rb.clear ();
+	BOOST_CHECK_EQUAL (rb.memory_used(), 0U);
+}
+
+
+/** Check that data put by one thread comes out in order from another, with clears from the first */
+BOOST_AUTO_TEST_CASE (audio_ring_buffers_threads)
+{
+	AudioRingBuffers rb(64);
+
+	boost::atomic<bool> stop(false);
+	bool ok = true;
+	auto reader = boost::thread([&rb, &stop, &ok]() {
+		float buffer[100];
+		while (!stop) {
+			auto const t = rb.get(buffer, 1, 100);
+			for (int i = 1; i < 100; ++i) {
+				/* Each frame's value is its index, except after an underrun or a clear */
+				if (t && buffer[i] != 0 && buffer[i] != buffer[i - 1] + 1) {
+					ok = false;
+				}
+			}
+		}
+	});
+
+	int frame = 0;
+	for (int i = 0; i < 20000; ++i) {
+		while (rb.size() > 1000) {}
+		auto data = make_shared<AudioBuffers>(1, 50);
+		for (int j = 0; j < 50; ++j) {
+			data->data(0)[j] = frame + j;
+		}
+		rb.put(data, DCPTime::from_frames(frame, 48000), 48000);
+		frame += 50;
+		if ((i % 100) == 0) {
+			rb.clear();
+			BOOST_CHECK_EQUAL(rb.size(), 0);
+			BOOST_CHECK(!rb.peek());
+			frame = 0;
+		}
+	}
+
+	stop = true;
+	reader.join();
+	BOOST_CHECK(ok);
+}
@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/audio_sample_conversion_test.cc
+ *  @brief Check that the (possibly vectorised) audio sample conversions give the same answers as simple loops.
+ */
+
+
+#include "lib/audio_sample_conversion.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <vector>
+
+
+using std::vector;
+
+
+BOOST_AUTO_TEST_CASE(s16_to_float_test)
+{
+	/* Odd lengths so that the scalar tail is exercised too */
+	for (auto count: { 0, 1, 7, 8, 9, 1001 }) {
+		vector<int16_t> in(count);
+		for (auto& i: in) {
+			i = static_cast<int16_t>((rand() % 65536) - 32768);
+		}
+		if (count > 1) {
+			in[0] = -32768;
+			in[1] = 32767;
+		}
+
+		vector<float> out(count);
+		s16_to_float(in.data(), out.data(), count);
+
+		for (int i = 0; i < count; ++i) {
+			BOOST_REQUIRE_EQUAL(out[i], float(in[i]) / (1 << 15));
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(s32_to_float_test)
+{
+	for (auto count: { 0, 1, 3, 4, 5, 1001 }) {
+		vector<int32_t> in(count);
+		for (auto& i: in) {
+			i = static_cast<int32_t>((static_cast<uint32_t>(rand()) << 16) ^ static_cast<uint32_t>(rand()));
+		}
+		if (count > 1) {
+			in[0] = INT32_MIN;
+			in[1] = INT32_MAX;
+		}
+
+		vector<float> out(count);
+		s32_to_float(in.data(), out.data(), count);
+
+		for (int i = 0; i < count; ++i) {
+			BOOST_REQUIRE_EQUAL(out[i], static_cast<float>(in[i]) / 2147483648);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(s24_to_float_test)
+{
+	for (auto count: { 0, 1, 3, 4, 5, 1001 }) {
+		vector<int32_t> samples(count);
+		for (auto& i: samples) {
+			i = (rand() % (1 << 24)) - (1 << 23);
+		}
+		if (count > 1) {
+			samples[0] = -(1 << 23);
+			samples[1] = (1 << 23) - 1;
+		}
+
+		vector<uint8_t> in;
+		for (auto i: samples) {
+			in.push_back(i & 0xff);
+			in.push_back((i >> 8) & 0xff);
+			in.push_back((i >> 16) & 0xff);
+		}
+
+		vector<float> out(count);
+		s24_to_float(in.data(), out.data(), count);
+
+		for (int i = 0; i < count; ++i) {
+			BOOST_REQUIRE_EQUAL(out[i], static_cast<float>(samples[i] * 256) / 2147483648);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(deinterleave_float_test)
+{
+	for (auto channels: { 1, 2, 6, 16 }) {
+		for (auto frames: { 0, 1, 3, 4, 5, 999 }) {
+			vector<float> in(channels * frames);
+			for (size_t i = 0; i < in.size(); ++i) {
+				in[i] = i;
+			}
+
+			vector<vector<float>> out(channels, vector<float>(frames));
+			vector<float*> pointers;
+			for (auto& i: out) {
+				pointers.push_back(i.data());
+			}
+
+			deinterleave_float(in.data(), pointers.data(), channels, frames);
+
+			for (int c = 0; c < channels; ++c) {
+				for (int f = 0; f < frames; ++f) {
+					BOOST_REQUIRE_EQUAL(out[c][f], in[f * channels + c]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  test/audio_waveform_test.cc
+ *  @brief Test AudioWaveform class.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/audio_buffers.h"
+#include "lib/audio_waveform.h"
+#include <boost/test/unit_test.hpp>
+
+
+using namespace dcpomatic;
+
+
+BOOST_AUTO_TEST_CASE(audio_waveform_test)
+{
+	int const rate = 48000;
+	int const samples_per_point = rate / AudioWaveform::points_per_second;
+
+	/* One second of audio starting 1 second in; each point's peaks are its index / 100 */
+	AudioWaveform waveform;
+	AudioBuffers audio(2, rate);
+	audio.make_silent();
+	for (int i = 0; i < rate; i += samples_per_point) {
+		auto const point = i / samples_per_point;
+		audio.data(0)[i + 10] = point / 100.0;
+		audio.data(1)[i + 20] = -point / 100.0;
+	}
+	waveform.add(audio, rate, ContentTime::from_seconds(1));
+
+	BOOST_CHECK(!waveform.empty());
+
+	/* Nothing before 1 second */
+	auto range = waveform.range(ContentTime(), ContentTime::from_seconds(0.9));
+	BOOST_CHECK_EQUAL(range.first, 0);
+	BOOST_CHECK_EQUAL(range.second, 0);
+
+	/* The 10th point after 1 second */
+	range = waveform.range(ContentTime::from_seconds(1.2), ContentTime::from_seconds(1.2));
+	BOOST_CHECK_CLOSE(range.first, -0.1, 0.1);
+	BOOST_CHECK_CLOSE(range.second, 0.1, 0.1);
+
+	/* The whole lot */
+	range = waveform.range(ContentTime(), ContentTime::from_seconds(10));
+	BOOST_CHECK_CLOSE(range.first, -0.49, 0.1);
+	BOOST_CHECK_CLOSE(range.second, 0.49, 0.1);
+
+	waveform.shift(ContentTime::from_seconds(-1));
+	range = waveform.range(ContentTime::from_seconds(0.2), ContentTime::from_seconds(0.2));
+	BOOST_CHECK_CLOSE(range.second, 0.1, 0.1);
+
+	boost::filesystem::path file = "build/test/audio_waveform_test.waveform";
+	waveform.write(file);
+	AudioWaveform check(file);
+	range = check.range(ContentTime::from_seconds(0.2), ContentTime::from_seconds(0.2));
+	BOOST_CHECK_CLOSE(range.first, -0.1, 0.1);
+	BOOST_CHECK_CLOSE(range.second, 0.1, 0.1);
+}
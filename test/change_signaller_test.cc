@@ -0,0 +1,131 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/change_signaller_test.cc
+ *  @brief Test ChangeSignalDespatcher batching.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/change_signaller.h"
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+
+using std::pair;
+using std::vector;
+
+
+class Changer
+{
+public:
+	void signal_change(ChangeType type, int property)
+	{
+		changes.push_back({type, property});
+	}
+
+	vector<pair<ChangeType, int>> changes;
+};
+
+
+typedef ChangeSignaller<Changer, int> ChangerChangeSignaller;
+typedef ChangeSignalDespatcher<Changer, int>::Batch ChangerChangeSignalBatch;
+
+
+BOOST_AUTO_TEST_CASE(change_signaller_batch_test)
+{
+	Changer a;
+	Changer b;
+
+	{
+		ChangerChangeSignalBatch batch;
+		for (int i = 0; i < 3; ++i) {
+			ChangerChangeSignaller cca(&a, 1);
+			ChangerChangeSignaller ccb(&b, 1);
+		}
+		{
+			ChangerChangeSignaller cca(&a, 2);
+			cca.abort();
+		}
+		BOOST_CHECK(a.changes.empty());
+		BOOST_CHECK(b.changes.empty());
+	}
+
+	/* Each thing/property is signalled once, with the PENDINGs first */
+	vector<pair<ChangeType, int>> const a_changes = {
+		{ ChangeType::PENDING, 1 },
+		{ ChangeType::PENDING, 2 },
+		{ ChangeType::DONE, 1 },
+		{ ChangeType::CANCELLED, 2 }
+	};
+	BOOST_CHECK(a.changes == a_changes);
+
+	vector<pair<ChangeType, int>> const b_changes = {
+		{ ChangeType::PENDING, 1 },
+		{ ChangeType::DONE, 1 }
+	};
+	BOOST_CHECK(b.changes == b_changes);
+}
+
+
+/** Check that changes which start inside a batch and end outside it (or the other way round) are balanced */
+BOOST_AUTO_TEST_CASE(change_signaller_batch_overlap_test)
+{
+	Changer a;
+
+	{
+		ChangerChangeSignaller outside(&a, 1);
+		ChangerChangeSignalBatch batch;
+		ChangerChangeSignaller inside(&a, 1);
+	}
+
+	auto pending = 0;
+	auto closed = 0;
+	for (auto change: a.changes) {
+		if (change.first == ChangeType::PENDING) {
+			++pending;
+		} else {
+			++closed;
+			BOOST_CHECK(closed <= pending);
+		}
+	}
+	BOOST_CHECK_EQUAL(pending, 2);
+	BOOST_CHECK_EQUAL(closed, 2);
+
+	a.changes.clear();
+
+	{
+		auto batch = new ChangerChangeSignalBatch();
+		ChangerChangeSignaller one(&a, 1);
+		{
+			ChangerChangeSignaller two(&a, 1);
+		}
+		delete batch;
+	}
+
+	vector<pair<ChangeType, int>> const changes = {
+		{ ChangeType::PENDING, 1 },
+		{ ChangeType::DONE, 1 }
+	};
+	BOOST_CHECK(a.changes == changes);
+}
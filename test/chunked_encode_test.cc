@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/chunked_encode_test.cc
+ *  @brief Test making a DCP with video from several players at once.
+ *  @ingroup feature
+ */
+
+
+#include "lib/config.h"
+#include "lib/content_factory.h"
+#include "lib/film.h"
+#include "lib/video_content.h"
+#include "test.h"
+#include <boost/test/unit_test.hpp>
+
+
+using std::shared_ptr;
+using std::string;
+
+
+/** The DCP made with two chunk players should be the same as the one made with a single player */
+BOOST_AUTO_TEST_CASE (chunked_encode_test)
+{
+	ConfigRestorer cr;
+
+	auto make = [](string name, int chunks) -> shared_ptr<Film> {
+		Config::instance()->set_dcp_encode_chunks(chunks);
+		auto red = content_factory("test/data/flat_red.png")[0];
+		auto green = content_factory("test/data/flat_green.png")[0];
+		auto sine = content_factory("test/data/sine_440.wav")[0];
+		auto film = new_test_film2 (name, { red, green, sine });
+		/* Same name for both so that the CPLs can be compared */
+		film->set_name ("chunked_encode_test");
+		red->video->set_length (12 * 24);
+		green->video->set_length (13 * 24);
+		make_and_verify_dcp (film);
+		return film;
+	};
+
+	auto single = make ("chunked_encode_test_single", 1);
+	auto chunked = make ("chunked_encode_test_chunked", 2);
+
+	check_dcp (single->dir(single->dcp_name()), chunked->dir(chunked->dcp_name()));
+}
@@ -32,6 +32,7 @@
 #include "lib/cross.h"
 #include "lib/dcp_video.h"
 #include "lib/dcpomatic_log.h"
+#include "lib/digester.h"
 #include "lib/encode_server.h"
 #include "lib/encode_server_description.h"
 #include "lib/file_log.h"
@@ -315,3 +316,258 @@ BOOST_AUTO_TEST_CASE (client_server_test_j2k)
 }
 
 
+
+
+/** Check that a frame whose XYZ was made in advance by DCPVideo::prepare() encodes the same as one which was not */
+BOOST_AUTO_TEST_CASE (dcp_video_prepare_test)
+{
+	auto image = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(1998, 1080), Image::Alignment::PADDED);
+	uint8_t* p = image->data()[0];
+	for (int y = 0; y < 1080; ++y) {
+		uint8_t* q = p;
+		for (int x = 0; x < 1998; ++x) {
+			*q++ = x % 256;
+			*q++ = y % 256;
+			*q++ = (x + y) % 256;
+		}
+		p += image->stride()[0];
+	}
+
+	auto pvf = std::make_shared<PlayerVideo>(
+		make_shared<RawImageProxy>(image),
+		Crop(),
+		optional<double>(),
+		dcp::Size(1998, 1080),
+		dcp::Size(1998, 1080),
+		Eyes::BOTH,
+		Part::WHOLE,
+		ColourConversion(),
+		VideoRange::FULL,
+		weak_ptr<Content>(),
+		optional<Frame>(),
+		false
+		);
+
+	auto const unprepared = DCPVideo(pvf, 0, 24, 200000000, Resolution::TWO_K).encode_locally();
+
+	DCPVideo frame(pvf, 0, 24, 200000000, Resolution::TWO_K);
+	/* Prepare a copy, as J2KEncoder does */
+	DCPVideo copy = frame;
+	copy.prepare();
+	auto const prepared = frame.encode_locally();
+
+	BOOST_REQUIRE_EQUAL(unprepared.size(), prepared.size());
+	BOOST_CHECK_EQUAL(memcmp(unprepared.data(), prepared.data(), unprepared.size()), 0);
+}
+
+
+/** Encoding a frame with several threads should give the same codestream as encoding it with one */
+BOOST_AUTO_TEST_CASE(encode_locally_with_threads_test)
+{
+	auto image = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(1998, 1080), Image::Alignment::PADDED);
+	uint8_t* p = image->data()[0];
+	for (int y = 0; y < 1080; ++y) {
+		uint8_t* q = p;
+		for (int x = 0; x < 1998; ++x) {
+			*q++ = x % 256;
+			*q++ = y % 256;
+			*q++ = (x + y) % 256;
+		}
+		p += image->stride()[0];
+	}
+
+	auto pvf = std::make_shared<PlayerVideo>(
+		make_shared<RawImageProxy>(image),
+		Crop(),
+		optional<double>(),
+		dcp::Size(1998, 1080),
+		dcp::Size(1998, 1080),
+		Eyes::BOTH,
+		Part::WHOLE,
+		ColourConversion(),
+		VideoRange::FULL,
+		weak_ptr<Content>(),
+		optional<Frame>(),
+		false
+		);
+
+	auto const single = DCPVideo(pvf, 0, 24, 200000000, Resolution::TWO_K).encode_locally();
+	auto const threaded = DCPVideo(pvf, 0, 24, 200000000, Resolution::TWO_K).encode_locally(4);
+
+	BOOST_REQUIRE_EQUAL(single.size(), threaded.size());
+	BOOST_CHECK_EQUAL(memcmp(single.data(), threaded.data(), single.size()), 0);
+}
+
+
+/** Check that a server still understands frames described in XML */
+BOOST_AUTO_TEST_CASE (client_server_test_xml_request)
+{
+	auto image = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(1998, 1080), Image::Alignment::PADDED);
+	uint8_t* p = image->data()[0];
+	for (int y = 0; y < 1080; ++y) {
+		uint8_t* q = p;
+		for (int x = 0; x < 1998; ++x) {
+			*q++ = x % 256;
+			*q++ = y % 256;
+			*q++ = (x + y) % 256;
+		}
+		p += image->stride()[0];
+	}
+
+	auto pvf = std::make_shared<PlayerVideo>(
+		make_shared<RawImageProxy>(image),
+		Crop(),
+		optional<double>(),
+		dcp::Size(1998, 1080),
+		dcp::Size(1998, 1080),
+		Eyes::BOTH,
+		Part::WHOLE,
+		ColourConversion(),
+		VideoRange::FULL,
+		weak_ptr<Content>(),
+		optional<Frame>(),
+		false
+		);
+
+	DCPVideo frame(pvf, 4, 24, 200000000, Resolution::TWO_K);
+	auto const locally_encoded = frame.encode_locally();
+
+	auto server = make_shared<EncodeServer>(true, 2);
+	thread server_thread(boost::bind(&EncodeServer::run, server));
+	dcpomatic_sleep_seconds (1);
+
+	EncodeServerDescription description("127.0.0.1", 1, SERVER_LINK_VERSION);
+	auto socket = DCPVideo::connect_to_server(description, 1200);
+	frame.send_to_server(socket, TransportCompression::NONE, EncodingRequestFormat::XML);
+	auto remotely_encoded = DCPVideo::collect_from_server(socket);
+
+	BOOST_CHECK_EQUAL(remotely_encoded.index, 4);
+	BOOST_REQUIRE_EQUAL(locally_encoded.size(), remotely_encoded.data.size());
+	BOOST_CHECK_EQUAL(memcmp(locally_encoded.data(), remotely_encoded.data.data(), locally_encoded.size()), 0);
+
+	socket.reset();
+	server->stop ();
+	server_thread.join();
+}
+
+
+/** Check that a server sends back a correct hash of each frame that it encodes */
+BOOST_AUTO_TEST_CASE (client_server_test_hash)
+{
+	auto image = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(1998, 1080), Image::Alignment::PADDED);
+	uint8_t* p = image->data()[0];
+	for (int y = 0; y < 1080; ++y) {
+		uint8_t* q = p;
+		for (int x = 0; x < 1998; ++x) {
+			*q++ = x % 256;
+			*q++ = y % 256;
+			*q++ = (x + y) % 256;
+		}
+		p += image->stride()[0];
+	}
+
+	auto pvf = std::make_shared<PlayerVideo>(
+		make_shared<RawImageProxy>(image),
+		Crop(),
+		optional<double>(),
+		dcp::Size(1998, 1080),
+		dcp::Size(1998, 1080),
+		Eyes::BOTH,
+		Part::WHOLE,
+		ColourConversion(),
+		VideoRange::FULL,
+		weak_ptr<Content>(),
+		optional<Frame>(),
+		false
+		);
+
+	DCPVideo frame(pvf, 2, 24, 200000000, Resolution::TWO_K);
+	auto const locally_encoded = frame.encode_locally();
+
+	auto server = make_shared<EncodeServer>(true, 2);
+	thread server_thread(boost::bind(&EncodeServer::run, server));
+	dcpomatic_sleep_seconds (1);
+
+	EncodeServerDescription description("127.0.0.1", 1, SERVER_LINK_VERSION);
+	auto socket = DCPVideo::connect_to_server(description, 1200);
+	frame.send_to_server(socket);
+	auto remotely_encoded = DCPVideo::collect_from_server(socket, false);
+
+	Digester digester;
+	digester.add(locally_encoded.data(), locally_encoded.size());
+	BOOST_CHECK_EQUAL(remotely_encoded.hash, digester.get());
+	BOOST_CHECK(remotely_encoded.check());
+
+	remotely_encoded.data.data()[remotely_encoded.data.size() / 2] ^= 0xff;
+	BOOST_CHECK(!remotely_encoded.check());
+
+	socket.reset();
+	server->stop ();
+	server_thread.join();
+}
+
+
+/** Check that a server with a full queue says that it is busy rather than making us wait */
+BOOST_AUTO_TEST_CASE (client_server_test_busy)
+{
+	auto image = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(1998, 1080), Image::Alignment::PADDED);
+	uint8_t* p = image->data()[0];
+	for (int y = 0; y < 1080; ++y) {
+		uint8_t* q = p;
+		for (int x = 0; x < 1998; ++x) {
+			*q++ = x % 256;
+			*q++ = y % 256;
+			*q++ = (x + y) % 256;
+		}
+		p += image->stride()[0];
+	}
+
+	auto pvf = std::make_shared<PlayerVideo>(
+		make_shared<RawImageProxy>(image),
+		Crop(),
+		optional<double>(),
+		dcp::Size(1998, 1080),
+		dcp::Size(1998, 1080),
+		Eyes::BOTH,
+		Part::WHOLE,
+		ColourConversion(),
+		VideoRange::FULL,
+		weak_ptr<Content>(),
+		optional<Frame>(),
+		false
+		);
+
+	/* One thread, so the server will queue two frames at most */
+	auto server = make_shared<EncodeServer>(true, 1);
+	thread server_thread(boost::bind(&EncodeServer::run, server));
+	dcpomatic_sleep_seconds (1);
+
+	EncodeServerDescription description("127.0.0.1", 1, SERVER_LINK_VERSION);
+	auto socket = DCPVideo::connect_to_server(description, 1200);
+
+	int const frames = 8;
+	for (int i = 0; i < frames; ++i) {
+		DCPVideo(pvf, i, 24, 200000000, Resolution::TWO_K).send_to_server(socket);
+	}
+
+	int busy = 0;
+	int encoded = 0;
+	for (int i = 0; i < frames; ++i) {
+		auto result = DCPVideo::collect_from_server(socket);
+		if (result.busy_retry > 0) {
+			BOOST_CHECK_EQUAL(result.data.size(), 0);
+			++busy;
+		} else {
+			BOOST_CHECK(result.data.size() > 0);
+			++encoded;
+		}
+	}
+
+	BOOST_CHECK(busy > 0);
+	BOOST_CHECK(encoded >= 3);
+	BOOST_CHECK_EQUAL(busy + encoded, frames);
+
+	socket.reset();
+	server->stop ();
+	server_thread.join();
+}
@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/combine_dcp_test.cc
+ *  @brief Test CombineDCPJob.
+ *  @ingroup feature
+ */
+
+
+#include "lib/combine_dcp_job.h"
+#include "lib/content_factory.h"
+#include "lib/dcp_content_type.h"
+#include "lib/film.h"
+#include "lib/job_manager.h"
+#include "test.h"
+#include <dcp/dcp.h>
+#include <dcp/filesystem.h>
+#include <boost/test/unit_test.hpp>
+
+
+using std::make_shared;
+using std::string;
+
+
+/** Combine a couple of DCPs and check that the result is valid and has all the assets */
+BOOST_AUTO_TEST_CASE (combine_dcp_test)
+{
+	auto make = [](string name, string image) -> boost::filesystem::path {
+		auto film = new_test_film2 (name, content_factory(image));
+		film->set_dcp_content_type (DCPContentType::from_isdcf_name("TST"));
+		make_and_verify_dcp (film);
+		return film->dir(film->dcp_name());
+	};
+
+	auto const red = make ("combine_dcp_test_red", "test/data/flat_red.png");
+	auto const green = make ("combine_dcp_test_green", "test/data/flat_green.png");
+
+	boost::filesystem::path output("build/test/combine_dcp_test");
+	boost::system::error_code ec;
+	dcp::filesystem::remove_all(output, ec);
+
+	JobManager::instance()->add(make_shared<CombineDCPJob>(std::vector<boost::filesystem::path>{red, green}, output, "A combined DCP"));
+	BOOST_REQUIRE (!wait_for_jobs());
+
+	dcp::DCP combined(output);
+	combined.read ();
+	BOOST_CHECK_EQUAL (combined.cpls().size(), 2U);
+
+	verify_dcp (output, {});
+
+	for (auto const& i: boost::filesystem::directory_iterator(red)) {
+		if (dcp::filesystem::extension(i.path()) == ".mxf") {
+			auto const size = dcp::filesystem::file_size(i.path());
+			BOOST_CHECK_EQUAL (dcp::filesystem::file_size(output / i.path().filename()), size);
+		}
+	}
+}
@@ -249,3 +249,36 @@ BOOST_AUTO_TEST_CASE(keep_config_if_cinemas_fail_to_load)
 	check_text_file(cinemas, dir / "cinemas_backup_for_test.xml");
 }
 
+
+
+BOOST_AUTO_TEST_CASE(config_cinema_by_name_or_email_test)
+{
+	ConfigRestorer cr;
+
+	boost::filesystem::path dir = "build/test/config_cinema_by_name_or_email_test";
+	Config::override_path = dir;
+	Config::drop();
+	boost::filesystem::remove_all(dir);
+	boost::filesystem::create_directories(dir);
+
+	auto config = Config::instance();
+	auto fred = make_shared<Cinema>("Fred's", vector<string>{"fred@fred.com"}, "", 0, 0);
+	auto jim = make_shared<Cinema>("Jim's", vector<string>{"jim@jim.com", "Fred's"}, "", 0, 0);
+	config->add_cinema(fred);
+	config->add_cinema(jim);
+
+	BOOST_CHECK(config->cinema_by_name_or_email("Fred's") == fred);
+	BOOST_CHECK(config->cinema_by_name_or_email("fred@fred.com") == fred);
+	BOOST_CHECK(config->cinema_by_name_or_email("jim@jim.com") == jim);
+	BOOST_CHECK(!config->cinema_by_name_or_email("Sheila's"));
+
+	/* Changes which are announced must be seen by the index */
+	jim->name = "Sheila's";
+	config->changed(Config::CINEMAS);
+	BOOST_CHECK(config->cinema_by_name_or_email("Sheila's") == jim);
+	BOOST_CHECK(!config->cinema_by_name_or_email("Jim's"));
+
+	config->remove_cinema(fred);
+	BOOST_CHECK(config->cinema_by_name_or_email("Fred's") == jim);
+	BOOST_CHECK(!config->cinema_by_name_or_email("fred@fred.com"));
+}
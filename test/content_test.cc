@@ -35,6 +35,7 @@
 #include <boost/test/unit_test.hpp>
 
 
+using std::make_shared;
 using namespace dcpomatic;
 
 
@@ -177,3 +178,34 @@ BOOST_AUTO_TEST_CASE(wav_with_markers_zero_channels_test)
 	auto film = new_test_film2("wav_with_markers_zero_channels_test", content);
 	make_and_verify_dcp(film, { dcp::VerificationNote::Code::MISSING_CPL_METADATA });
 }
+
+
+/** Check that Content::changed() notices files being changed, and that the change
+ *  information survives a round trip through the metadata.
+ */
+BOOST_AUTO_TEST_CASE(content_changed_test)
+{
+	using namespace boost::filesystem;
+
+	auto const dir = path("build/test/content_changed_test_data");
+	remove_all(dir);
+	create_directories(dir);
+	copy_file("test/data/flat_red.png", dir / "red.png");
+
+	auto content = content_factory(dir / "red.png")[0];
+	auto film = new_test_film2("content_changed_test", { content });
+	BOOST_CHECK(!content->changed());
+
+	film->write_metadata();
+	auto reloaded = make_shared<Film>(*film->directory());
+	reloaded->read_metadata();
+	BOOST_REQUIRE_EQUAL(reloaded->content().size(), 1U);
+	BOOST_CHECK(!reloaded->content()[0]->changed());
+
+	/* Replace the file with a different one */
+	remove(dir / "red.png");
+	copy_file("test/data/flat_green.png", dir / "red.png");
+	last_write_time(dir / "red.png", last_write_time(dir / "red.png") + 10);
+	BOOST_CHECK(content->changed());
+	BOOST_CHECK(reloaded->content()[0]->changed());
+}
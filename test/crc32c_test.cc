@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/crc32c_test.cc
+ *  @brief Check the CRC-32C checksum used on encode server connections.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/crc32c.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+
+using std::string;
+
+
+BOOST_AUTO_TEST_CASE (crc32c_reference_test)
+{
+	CRC32C empty;
+	BOOST_CHECK_EQUAL (empty.get(), 0U);
+
+	CRC32C check;
+	string const digits = "123456789";
+	check.add (digits.data(), digits.size());
+	BOOST_CHECK_EQUAL (check.get(), 0xe3069283U);
+}
+
+
+BOOST_AUTO_TEST_CASE (crc32c_incremental_test)
+{
+	string data (1031, '\0');
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<char>(i * 7);
+	}
+
+	CRC32C all;
+	all.add (data.data(), data.size());
+
+	CRC32C pieces;
+	pieces.add (data.data(), 3);
+	pieces.add (data.data() + 3, 517);
+	pieces.add (data.data() + 520, data.size() - 520);
+
+	BOOST_CHECK_EQUAL (all.get(), pieces.get());
+}
@@ -28,6 +28,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <fstream>
 #include <iostream>
 
 
@@ -310,3 +311,42 @@ BOOST_AUTO_TEST_CASE(create_cli_defaults_test)
 	BOOST_CHECK_EQUAL(film->dcp_content_type()->isdcf_name(), "TST");
 }
 
+
+BOOST_AUTO_TEST_CASE(create_cli_manifest_test)
+{
+	{
+		std::ofstream manifest("build/test/create_cli_manifest_test.txt");
+		manifest << "# Trailers\n"
+			 << "test/data/flat_red.png --name red -o build/test/create_cli_manifest_red\n"
+			 << "\n"
+			 << "  \"test/data/flat_green.png\"   --name \"a green film\" --dcp-content-type ADV -o build/test/create_cli_manifest_green\n"
+			 << "test/data/flat_blue.png --name blue\n";
+	}
+
+	auto cc = run("dcpomatic2_create --manifest build/test/create_cli_manifest_test.txt");
+	BOOST_CHECK(!cc.error);
+	BOOST_REQUIRE(cc.manifest);
+
+	auto films = cc.manifest_films("dcpomatic2_create");
+	BOOST_REQUIRE_EQUAL(films.size(), 3U);
+
+	BOOST_CHECK(!films[0].error);
+	BOOST_CHECK_EQUAL(films[0]._name, "red");
+	BOOST_REQUIRE(films[0].output_dir);
+	BOOST_CHECK_EQUAL(*films[0].output_dir, "build/test/create_cli_manifest_red");
+	BOOST_REQUIRE_EQUAL(films[0].content.size(), 1U);
+	BOOST_CHECK_EQUAL(films[0].content[0].path, "test/data/flat_red.png");
+
+	BOOST_CHECK(!films[1].error);
+	BOOST_CHECK_EQUAL(films[1]._name, "a green film");
+	BOOST_CHECK_EQUAL(films[1]._dcp_content_type, DCPContentType::from_isdcf_name("ADV"));
+	BOOST_REQUIRE_EQUAL(films[1].content.size(), 1U);
+	BOOST_CHECK_EQUAL(films[1].content[0].path, "test/data/flat_green.png");
+
+	/* No output directory */
+	BOOST_REQUIRE(films[2].error);
+	BOOST_CHECK(boost::algorithm::starts_with(*films[2].error, "build/test/create_cli_manifest_test.txt:5: "));
+
+	cc = run("dcpomatic2_create test/data/flat_red.png --manifest build/test/create_cli_manifest_test.txt");
+	BOOST_CHECK(cc.error);
+}
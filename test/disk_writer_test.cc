@@ -335,3 +335,39 @@ BOOST_AUTO_TEST_CASE (osx_drive_identification_test)
 	BOOST_CHECK_EQUAL (writeable[0].device(), "/dev/disk0");
 }
 
+
+
+/** Write a file several blocks long and check it with sampled verification */
+BOOST_AUTO_TEST_CASE (disk_writer_sampled_verify_test)
+{
+	using namespace boost::filesystem;
+
+	Cleanup cl;
+
+	path const disk = "build/test/disk_writer_sampled_verify_test.disk";
+	path const partition = "build/test/disk_writer_sampled_verify_test.partition";
+
+	cl.add(disk);
+	cl.add(partition);
+
+	make_random_file(disk, 256 * 1024 * 1024);
+	make_random_file(partition, 256 * 1024 * 1024);
+
+	path const dcp = "build/test/disk_writer_sampled_verify_test";
+	remove_all(dcp);
+	create_directory(dcp);
+	cl.add(dcp);
+	make_random_file(dcp / "foo", 1024 * 1024 * 80 - 1234);
+
+	dcpomatic::write({dcp}, disk.string(), partition.string(), nullptr, 2);
+
+	BOOST_CHECK_EQUAL(system("/sbin/e2fsck -fn build/test/disk_writer_sampled_verify_test.partition"), 0);
+
+	path const check = "build/test/disk_writer_sampled_verify_test_check";
+	create_directory(check);
+	cl.add(check);
+	system("e2cp " + partition.string() + ":disk_writer_sampled_verify_test/foo " + (check / "foo").string());
+	check_file(dcp / "foo", check / "foo");
+
+	cl.run();
+}
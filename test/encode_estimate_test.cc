@@ -0,0 +1,47 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "lib/content.h"
+#include "lib/content_factory.h"
+#include "lib/encode_estimate.h"
+#include "lib/film.h"
+#include "lib/video_content.h"
+#include "test.h"
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE(encode_estimate_test)
+{
+	auto content = content_factory("test/data/flat_red.png")[0];
+	auto film = new_test_film2("encode_estimate_test", { content });
+	content->video->set_length(24 * 60);
+
+	auto const estimate = estimate_encode(film, 4, 2);
+
+	BOOST_CHECK_EQUAL(estimate.frames, 4);
+	BOOST_CHECK_EQUAL(estimate.total_frames, 24 * 60);
+	BOOST_CHECK_EQUAL(estimate.threads, 2);
+	BOOST_CHECK(estimate.encode > 0);
+	BOOST_CHECK(estimate.bits_per_frame > 0);
+	BOOST_CHECK(estimate.projected > 0);
+}
@@ -0,0 +1,509 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  test/encode_farm_test.cc
+ *  @brief Simulate a farm of encode servers to see how J2KEncoder and Writer cope with it.
+ *  @ingroup feature
+ *
+ *  A fake coordinator tells the master about some fake servers.  The servers speak the
+ *  real protocol over loopback, but rather than encoding each frame they return the same
+ *  JPEG2000 after a configurable delay, possibly with failures and a slow link.  Each
+ *  server has its own address (127.0.0.2, 127.0.0.3 and so on), all handled by the
+ *  same listening socket.
+ */
+
+
+#include "lib/compose.hpp"
+#include "lib/config.h"
+#include "lib/content_factory.h"
+#include "lib/cross.h"
+#include "lib/dcp_video.h"
+#include "lib/dcpomatic_socket.h"
+#include "lib/digester.h"
+#include "lib/encode_server.h"
+#include "lib/encode_server_finder.h"
+#include "lib/exceptions.h"
+#include "lib/film.h"
+#include "lib/job.h"
+#include "lib/job_manager.h"
+#include "lib/make_dcp.h"
+#include "lib/metric.h"
+#include "lib/server.h"
+#include "lib/signal_manager.h"
+#include "lib/transcode_job.h"
+#include "lib/types.h"
+#include "test.h"
+#include <dcp/raw_convert.h>
+#include <libxml++/libxml++.h>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+
+
+using std::list;
+using std::make_shared;
+using std::map;
+using std::max;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::optional;
+using dcp::raw_convert;
+
+
+/** How a simulated encode server behaves */
+struct FakeServerProfile
+{
+	int threads = 4;
+	/** Mean time to encode a frame, in seconds */
+	double latency = 0.05;
+	/** Largest random variation in the time to encode a frame, in seconds */
+	double jitter = 0;
+	/** Probability that any frame will fail to encode */
+	double failure_rate = 0;
+	/** Speed of the link back to the master in bytes per second, or 0 for no limit */
+	double bandwidth = 0;
+};
+
+
+/** Some encode servers which pretend to encode, and a coordinator to tell masters about them */
+class FakeEncodeFarm
+{
+public:
+	explicit FakeEncodeFarm(vector<FakeServerProfile> profiles)
+		: _frames(*this)
+		, _coordinator(*this)
+	{
+		for (size_t i = 0; i < profiles.size(); ++i) {
+			_hosts[host_name(i)].profile = profiles[i];
+		}
+		_frames_thread = boost::thread(boost::bind(&Frames::run, &_frames));
+		_coordinator_thread = boost::thread(boost::bind(&Coordinator::run, &_coordinator));
+	}
+
+	~FakeEncodeFarm()
+	{
+		_frames.stop();
+		_coordinator.stop();
+		_frames_thread.join();
+		_coordinator_thread.join();
+		_connections.join_all();
+	}
+
+	static string host_name(int index) {
+		return String::compose("127.0.0.%1", index + 2);
+	}
+
+	/** Make a server stop accepting work, as if it had crashed, or bring it back */
+	void set_down(int index, bool down) {
+		boost::mutex::scoped_lock lm(_mutex);
+		_hosts[host_name(index)].down = down;
+	}
+
+	struct HostStatistics {
+		int frames = 0;
+		int failures = 0;
+		/** Total time spent "encoding", in seconds */
+		double busy = 0;
+	};
+
+	map<string, HostStatistics> statistics() const {
+		boost::mutex::scoped_lock lm(_mutex);
+		map<string, HostStatistics> s;
+		for (auto const& i: _hosts) {
+			s[i.first] = i.second.statistics;
+		}
+		return s;
+	}
+
+	/** @return Times in seconds between each frame arriving and it being sent back, sorted */
+	vector<double> latencies() const {
+		boost::mutex::scoped_lock lm(_mutex);
+		auto l = _latencies;
+		std::sort(l.begin(), l.end());
+		return l;
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Host {
+		FakeServerProfile profile;
+		bool down = false;
+		/** Time that each of the server's threads will next be free */
+		vector<Clock::time_point> free;
+		HostStatistics statistics;
+	};
+
+	class Frames : public Server
+	{
+	public:
+		explicit Frames(FakeEncodeFarm& farm)
+			: Server(ENCODE_FRAME_PORT)
+			, _farm(farm)
+		{}
+
+	private:
+		void handle(shared_ptr<Socket> socket) override {
+			_farm._connections.create_thread(boost::bind(&FakeEncodeFarm::connection_thread, &_farm, socket));
+		}
+
+		FakeEncodeFarm& _farm;
+	};
+
+	class Coordinator : public Server
+	{
+	public:
+		explicit Coordinator(FakeEncodeFarm& farm)
+			: Server(ENCODE_SERVER_COORDINATOR_PORT)
+			, _farm(farm)
+		{}
+
+	private:
+		void handle(shared_ptr<Socket> socket) override {
+			try {
+				/* We give the same servers to everybody, so there's no need to look at the request */
+				vector<uint8_t> request(socket->read_uint32());
+				socket->read(request.data(), request.size());
+
+				xmlpp::Document doc;
+				auto root = doc.create_root_node("EncodeServers");
+				{
+					boost::mutex::scoped_lock lm(_farm._mutex);
+					for (auto const& i: _farm._hosts) {
+						auto node = root->add_child("Server");
+						node->add_child("HostName")->add_child_text(i.first);
+						node->add_child("Threads")->add_child_text(raw_convert<string>(i.second.profile.threads));
+						node->add_child("Version")->add_child_text(raw_convert<string>(SERVER_LINK_VERSION));
+					}
+				}
+
+				auto xml = doc.write_to_string("UTF-8");
+				socket->write(xml.bytes() + 1);
+				socket->write(reinterpret_cast<uint8_t const *>(xml.c_str()), xml.bytes() + 1);
+			} catch (std::exception&) {
+				/* The master will ask again */
+			}
+		}
+
+		FakeEncodeFarm& _farm;
+	};
+
+	struct Pending {
+		int index;
+		Eyes eyes;
+		Clock::time_point received;
+		Clock::time_point ready;
+		bool fail;
+	};
+
+	void connection_thread(shared_ptr<Socket> socket);
+	void collect(shared_ptr<Socket> socket, string const& host, list<Pending>& pending);
+
+	mutable boost::mutex _mutex;
+	map<string, Host> _hosts;
+	vector<double> _latencies;
+	std::mt19937 _random{42};
+	/** The JPEG2000 that every server sends back */
+	optional<dcp::ArrayData> _j2k;
+	/** MD5 of _j2k as hex */
+	string _j2k_hash;
+	boost::mutex _j2k_mutex;
+
+	Frames _frames;
+	Coordinator _coordinator;
+	boost::thread _frames_thread;
+	boost::thread _coordinator_thread;
+	boost::thread_group _connections;
+};
+
+
+void
+FakeEncodeFarm::connection_thread(shared_ptr<Socket> socket)
+try
+{
+	/* The address that the master connected to tells us which server it thinks it is talking to */
+	auto const host = socket->socket().local_endpoint().address().to_string();
+	list<Pending> pending;
+
+	while (true) {
+		auto const command = static_cast<EncodeServerCommand>(socket->read_uint32());
+
+		{
+			boost::mutex::scoped_lock lm(_mutex);
+			if (_hosts[host].down) {
+				/* Drop the connection, as a crashed server would */
+				return;
+			}
+		}
+
+		switch (command) {
+		case EncodeServerCommand::ENCODE:
+		case EncodeServerCommand::ENCODE_BINARY:
+		{
+			auto frame = command == EncodeServerCommand::ENCODE_BINARY ? EncodeServer::read_binary_request(socket) : EncodeServer::read_request(socket);
+			auto const received = Clock::now();
+
+			{
+				boost::mutex::scoped_lock lm(_j2k_mutex);
+				if (!_j2k) {
+					_j2k = frame->encode_locally();
+					Digester digester;
+					digester.add(_j2k->data(), _j2k->size());
+					_j2k_hash = digester.get();
+				}
+			}
+
+			boost::mutex::scoped_lock lm(_mutex);
+			auto& h = _hosts[host];
+			h.free.resize(h.profile.threads, received);
+			/* The frame goes to whichever of the server's threads is free first */
+			auto thread = std::min_element(h.free.begin(), h.free.end());
+			std::uniform_real_distribution<double> unit(0, 1);
+			auto const seconds = max(0.0, h.profile.latency + h.profile.jitter * (unit(_random) * 2 - 1));
+			auto const duration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+			*thread = max(*thread, received) + duration;
+			h.statistics.busy += seconds;
+			pending.push_back({frame->index(), frame->eyes(), received, *thread, unit(_random) < h.profile.failure_rate});
+			break;
+		}
+		case EncodeServerCommand::COLLECT:
+			collect(socket, host, pending);
+			break;
+		case EncodeServerCommand::SET_CHECKSUM:
+			socket->set_checksum(static_cast<TransportChecksum>(socket->read_uint32()));
+			break;
+		default:
+			return;
+		}
+	}
+}
+catch (std::exception&)
+{
+	/* The master has gone away */
+}
+
+
+/** Send back whichever of the pending frames on a connection will be ready first */
+void
+FakeEncodeFarm::collect(shared_ptr<Socket> socket, string const& host, list<Pending>& pending)
+{
+	if (pending.empty()) {
+		throw NetworkError("Master asked for a frame when none were outstanding");
+	}
+
+	auto next = std::min_element(pending.begin(), pending.end(), [](Pending const& a, Pending const& b) {
+		return a.ready < b.ready;
+	});
+	std::this_thread::sleep_until(next->ready);
+
+	double bandwidth = 0;
+	{
+		boost::mutex::scoped_lock lm(_mutex);
+		bandwidth = _hosts[host].profile.bandwidth;
+	}
+
+	auto const data = next->fail ? dcp::ArrayData() : *_j2k;
+	if (bandwidth > 0) {
+		std::this_thread::sleep_for(std::chrono::duration<double>(data.size() / bandwidth));
+	}
+
+	{
+		Socket::WriteDigestScope ds(socket);
+		socket->write(static_cast<uint32_t>(next->index));
+		socket->write(static_cast<uint32_t>(next->eyes));
+		/* Never too busy */
+		socket->write(static_cast<uint32_t>(0));
+		socket->write(static_cast<uint32_t>(data.size()));
+		socket->write(reinterpret_cast<uint8_t const*>(_j2k_hash.c_str()), _j2k_hash.size());
+	}
+	socket->write(data.data(), data.size());
+
+	boost::mutex::scoped_lock lm(_mutex);
+	auto& statistics = _hosts[host].statistics;
+	if (next->fail) {
+		++statistics.failures;
+	} else {
+		++statistics.frames;
+	}
+	_latencies.push_back(std::chrono::duration<double>(Clock::now() - next->received).count());
+	pending.erase(next);
+}
+
+
+struct FarmReport
+{
+	int frames = 0;
+	double seconds = 0;
+	/** Largest number of frames that the Writer had pushed to disk to save memory */
+	int spills = 0;
+	map<string, FakeEncodeFarm::HostStatistics> hosts;
+	vector<double> latencies;
+
+	double percentile(double p) const {
+		return latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+	}
+};
+
+
+/** Make a DCP of some video using only the servers in a fake farm.
+ *  @param during Function to call every 100ms or so while the encode is running, with the
+ *  number of seconds since it started.
+ */
+static
+FarmReport
+encode_with_farm(string name, vector<FakeServerProfile> profiles, std::function<void (FakeEncodeFarm&, double)> during = {})
+{
+	ConfigRestorer cr;
+
+	FakeEncodeFarm farm(profiles);
+
+	/* Make a new EncodeServerFinder which will ask our fake coordinator for servers */
+	Config::instance()->set_encode_server_coordinator("127.0.0.1");
+	Config::instance()->set_only_servers_encode(true);
+	EncodeServerFinder::drop();
+
+	auto content = content_factory("test/data/count300bd24.m2ts")[0];
+	auto film = new_test_film2(name, { content });
+
+	auto const start = std::chrono::steady_clock::now();
+	auto elapsed = [start]() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	FarmReport report;
+
+	make_dcp(film, TranscodeJob::ChangedBehaviour::IGNORE);
+	auto job = JobManager::instance()->get().back();
+	while (!job->finished()) {
+		while (signal_manager->ui_idle()) {}
+		for (auto const& metric: job->metrics()) {
+			if (metric.name == "writer_frames_pushed_to_disk") {
+				report.spills = max(report.spills, static_cast<int>(metric.value));
+			}
+		}
+		if (during) {
+			during(farm, elapsed());
+		}
+		dcpomatic_sleep_milliseconds(100);
+	}
+
+	report.seconds = elapsed();
+	report.frames = film->length().frames_round(film->video_frame_rate());
+	report.hosts = farm.statistics();
+	report.latencies = farm.latencies();
+
+	/* Put things back as they were for the other tests */
+	EncodeServerFinder::instance()->stop();
+	Config::instance()->set_encode_server_coordinator("");
+	Config::instance()->set_only_servers_encode(false);
+
+	BOOST_REQUIRE(job->finished_ok());
+
+	BOOST_TEST_MESSAGE(name << ": " << report.frames << " frames in " << report.seconds << "s (" << (report.frames / report.seconds) << "fps)");
+	BOOST_TEST_MESSAGE("\tspills: " << report.spills);
+	BOOST_TEST_MESSAGE("\tlatency p50 " << report.percentile(0.5) << "s, p95 " << report.percentile(0.95) << "s, p99 " << report.percentile(0.99) << "s");
+	for (size_t i = 0; i < profiles.size(); ++i) {
+		auto const& statistics = report.hosts[FakeEncodeFarm::host_name(i)];
+		auto const idle = 1 - statistics.busy / (profiles[i].threads * report.seconds);
+		BOOST_TEST_MESSAGE("\t" << FakeEncodeFarm::host_name(i) << ": " << statistics.frames << " frames, " << statistics.failures << " failures, " << (idle * 100) << "% idle");
+	}
+
+	return report;
+}
+
+
+static
+int
+frames_encoded(FarmReport const& report)
+{
+	int frames = 0;
+	for (auto const& i: report.hosts) {
+		frames += i.second.frames;
+	}
+	return frames;
+}
+
+
+#ifdef DCPOMATIC_LINUX
+
+BOOST_AUTO_TEST_CASE(encode_farm_steady_test)
+{
+	FakeServerProfile fast;
+	fast.threads = 8;
+	fast.latency = 0.05;
+	fast.jitter = 0.02;
+
+	FakeServerProfile slow;
+	slow.threads = 2;
+	slow.latency = 0.4;
+	slow.jitter = 0.1;
+
+	auto report = encode_with_farm("encode_farm_steady_test", { fast, fast, slow });
+
+	/* Every frame should have been encoded once, apart from any that were encoded
+	 * again speculatively because they were holding things up.
+	 */
+	BOOST_CHECK(frames_encoded(report) >= report.frames);
+	/* The fast servers should have done most of the work */
+	BOOST_CHECK(report.hosts[FakeEncodeFarm::host_name(2)].frames < report.frames / 4);
+}
+
+
+BOOST_AUTO_TEST_CASE(encode_farm_unreliable_test)
+{
+	FakeServerProfile flaky;
+	flaky.latency = 0.05;
+	flaky.failure_rate = 0.1;
+
+	FakeServerProfile narrow;
+	narrow.latency = 0.05;
+	/* About 10 frames per second at the J2K bandwidth that the tests use */
+	narrow.bandwidth = 5e6;
+
+	auto report = encode_with_farm("encode_farm_unreliable_test", { flaky, flaky, narrow });
+	BOOST_CHECK(frames_encoded(report) >= report.frames);
+}
+
+
+BOOST_AUTO_TEST_CASE(encode_farm_churn_test)
+{
+	FakeServerProfile profile;
+	profile.latency = 0.1;
+	profile.jitter = 0.05;
+
+	/* One server crashes a second in, and another is away for a while in the middle */
+	auto report = encode_with_farm("encode_farm_churn_test", { profile, profile, profile }, [](FakeEncodeFarm& farm, double time) {
+		if (time > 1) {
+			farm.set_down(0, true);
+		}
+		farm.set_down(1, time > 2 && time < 5);
+	});
+
+	BOOST_CHECK(frames_encoded(report) >= report.frames);
+}
+
+#endif
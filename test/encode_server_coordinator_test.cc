@@ -0,0 +1,92 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/encode_server_coordinator_test.cc
+ *  @brief Check EncodeServerCoordinator's sharing of servers between masters.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/encode_server_coordinator.h"
+#include <boost/test/unit_test.hpp>
+
+
+using std::list;
+using std::string;
+using std::vector;
+
+
+static
+int
+threads (vector<EncodeServerDescription> const& servers)
+{
+	int total = 0;
+	for (auto const& i: servers) {
+		total += i.threads();
+	}
+	return total;
+}
+
+
+BOOST_AUTO_TEST_CASE (encode_server_coordinator_fair_share_test)
+{
+	list<EncodeServerDescription> servers = {
+		EncodeServerDescription("192.168.1.1", 12, SERVER_LINK_VERSION),
+		EncodeServerDescription("192.168.1.2", 8, SERVER_LINK_VERSION),
+		EncodeServerDescription("192.168.1.3", 4, SERVER_LINK_VERSION),
+		/* This one is too old to use, so it should be ignored */
+		EncodeServerDescription("192.168.1.4", 16, SERVER_LINK_VERSION - 1)
+	};
+
+	auto allocation = EncodeServerCoordinator::allocate(servers, { {"a", 1}, {"b", 1} });
+	BOOST_REQUIRE_EQUAL(allocation.size(), 2U);
+	BOOST_CHECK_EQUAL(threads(allocation["a"]), 12);
+	BOOST_CHECK_EQUAL(threads(allocation["b"]), 12);
+
+	/* Whole servers should be handed out where possible */
+	BOOST_REQUIRE_EQUAL(allocation["a"].size(), 1U);
+	BOOST_CHECK_EQUAL(allocation["a"][0].host_name(), "192.168.1.1");
+
+	allocation = EncodeServerCoordinator::allocate(servers, { {"a", 1}, {"b", 2} });
+	BOOST_CHECK_EQUAL(threads(allocation["a"]), 8);
+	BOOST_CHECK_EQUAL(threads(allocation["b"]), 16);
+
+	/* Rounding leftovers should still be handed out */
+	allocation = EncodeServerCoordinator::allocate(servers, { {"a", 1}, {"b", 1}, {"c", 1}, {"d", 1}, {"e", 1} });
+	int total = 0;
+	for (auto const& i: allocation) {
+		BOOST_CHECK(threads(i.second) >= 4);
+		total += threads(i.second);
+	}
+	BOOST_CHECK_EQUAL(total, 24);
+}
+
+
+BOOST_AUTO_TEST_CASE (encode_server_coordinator_no_servers_test)
+{
+	auto allocation = EncodeServerCoordinator::allocate({}, { {"a", 1} });
+	BOOST_REQUIRE_EQUAL(allocation.size(), 1U);
+	BOOST_CHECK(allocation["a"].empty());
+
+	BOOST_CHECK(EncodeServerCoordinator::allocate({ EncodeServerDescription("192.168.1.1", 12, SERVER_LINK_VERSION) }, {}).empty());
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "lib/colour_conversion.h"
+#include "lib/encoding_request.h"
+#include "lib/exceptions.h"
+#include <boost/test/unit_test.hpp>
+
+
+using boost::optional;
+
+
+BOOST_AUTO_TEST_CASE(encoding_request_round_trip_test)
+{
+	EncodingRequestWriter writer;
+	writer.write_uint(0xdeadbeef);
+	writer.write_int(-42);
+	writer.write_double(0.1);
+	writer.write_bool(true);
+	writer.write_optional_int(optional<int>());
+	writer.write_optional_int(7);
+	writer.write_optional_double(-3.5);
+
+	EncodingRequestReader reader(writer.data());
+	BOOST_CHECK_EQUAL(reader.read_uint(), 0xdeadbeef);
+	BOOST_CHECK_EQUAL(reader.read_int(), -42);
+	BOOST_CHECK_EQUAL(reader.read_double(), 0.1);
+	BOOST_CHECK(reader.read_bool());
+	BOOST_CHECK(!reader.read_optional_int());
+	BOOST_CHECK(reader.read_optional_int() == optional<int>(7));
+	BOOST_CHECK(reader.read_optional_double() == optional<double>(-3.5));
+
+	BOOST_CHECK_THROW(reader.read_bool(), NetworkError);
+}
+
+
+BOOST_AUTO_TEST_CASE(encoding_request_colour_conversion_test)
+{
+	for (auto const& preset: PresetColourConversion::all()) {
+		EncodingRequestWriter writer;
+		ColourConversion(preset.conversion).as_binary(writer);
+		EncodingRequestReader reader(writer.data());
+		BOOST_CHECK(ColourConversion(reader) == ColourConversion(preset.conversion));
+	}
+}
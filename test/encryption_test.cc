@@ -24,6 +24,7 @@
 #include "lib/dcp_content.h"
 #include "lib/dcp_examiner.h"
 #include "lib/film.h"
+#include "lib/kdm_source.h"
 #include "test.h"
 #include <dcp/cpl.h>
 #include <dcp/dcp.h>
@@ -67,3 +68,33 @@ BOOST_AUTO_TEST_CASE (smpte_dcp_with_subtitles_can_be_decrypted)
 	BOOST_CHECK (examiner.kdm_valid());
 }
 
+
+
+BOOST_AUTO_TEST_CASE (kdm_source_makes_the_same_kdms_as_film)
+{
+	auto content = content_factory("test/data/flat_red.png")[0];
+	auto film = new_test_film2 ("kdm_source_makes_the_same_kdms_as_film", { content });
+	film->set_encrypted (true);
+	make_and_verify_dcp (film);
+
+	auto const cpl = film->cpls().front().cpl_file;
+	dcp::LocalTime const from("2030-07-21T00:00:00+00:00");
+	dcp::LocalTime const until("2031-07-21T00:00:00+00:00");
+
+	auto const reference = film->make_kdm(cpl, from, until);
+	auto const reference_keys = reference.keys();
+
+	KDMSource source(*film, cpl);
+	for (int i = 0; i < 2; ++i) {
+		auto const kdm = source.make(from, until);
+		BOOST_CHECK_EQUAL (kdm.cpl_id(), reference.cpl_id());
+		auto const keys = kdm.keys();
+		BOOST_REQUIRE_EQUAL (keys.size(), reference_keys.size());
+		auto j = reference_keys.begin();
+		for (auto const& key: keys) {
+			BOOST_CHECK_EQUAL (key.id(), j->id());
+			BOOST_CHECK (key.key() == j->key());
+			++j;
+		}
+	}
+}
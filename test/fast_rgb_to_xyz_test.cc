@@ -0,0 +1,89 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** @file  test/fast_rgb_to_xyz_test.cc
+ *  @brief Check fast_rgb_to_xyz() against dcp::rgb_to_xyz().
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/fast_rgb_to_xyz.h"
+#include "lib/rng.h"
+#include <dcp/colour_conversion.h>
+#include <dcp/openjpeg_image.h>
+#include <dcp/rgb_xyz.h>
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <vector>
+
+
+using std::vector;
+
+
+static
+void
+check(dcp::ColourConversion const& conversion)
+{
+	/* Odd width so that we test the non-SIMD tail of each line */
+	dcp::Size const size(67, 9);
+	int const stride = size.width * 6 + 10;
+	vector<uint8_t> rgb(stride * size.height);
+
+	dcpomatic::RNG rng(1);
+	for (int y = 0; y < size.height; ++y) {
+		auto p = reinterpret_cast<uint16_t*>(rgb.data() + y * stride);
+		for (int x = 0; x < size.width * 3; ++x) {
+			*p++ = rng.get() & 0xffff;
+		}
+	}
+
+	auto ref = dcp::rgb_to_xyz(rgb.data(), size, stride, conversion);
+	auto fast = fast_rgb_to_xyz(rgb.data(), size, stride, conversion);
+
+	for (int c = 0; c < 3; ++c) {
+		for (int i = 0; i < size.width * size.height; ++i) {
+			BOOST_REQUIRE_MESSAGE(std::abs(ref->data(c)[i] - fast->data(c)[i]) <= 1, "component " << c << " pixel " << i);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(fast_rgb_to_xyz_test)
+{
+	check(dcp::ColourConversion::srgb_to_xyz());
+	check(dcp::ColourConversion::rec709_to_xyz());
+	check(dcp::ColourConversion::rec2020_to_xyz());
+}
+
+
+BOOST_AUTO_TEST_CASE(fast_rgb_to_xyz_cache_test)
+{
+	auto srgb = FastRGBToXYZ::cached(dcp::ColourConversion::srgb_to_xyz());
+	auto rec709 = FastRGBToXYZ::cached(dcp::ColourConversion::rec709_to_xyz());
+
+	BOOST_CHECK(srgb != rec709);
+	BOOST_CHECK(FastRGBToXYZ::cached(dcp::ColourConversion::srgb_to_xyz()) == srgb);
+	BOOST_CHECK(FastRGBToXYZ::cached(dcp::ColourConversion::rec709_to_xyz()) == rec709);
+
+	auto modified = dcp::ColourConversion::srgb_to_xyz();
+	modified.set_adjusted_white(dcp::Chromaticity(0.3, 0.3));
+	BOOST_CHECK(FastRGBToXYZ::cached(modified) != srgb);
+}
@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/** @file  test/fast_xyz_to_rgb_test.cc
+ *  @brief Check fast_xyz_to_rgb() against dcp::xyz_to_rgb().
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/fast_xyz_to_rgb.h"
+#include "lib/image.h"
+#include "lib/rng.h"
+#include <dcp/colour_conversion.h>
+#include <dcp/openjpeg_image.h>
+#include <dcp/rgb_xyz.h>
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <vector>
+
+
+using std::make_shared;
+using std::vector;
+
+
+BOOST_AUTO_TEST_CASE(fast_xyz_to_rgb_test)
+{
+	/* Odd width so that we test the non-SIMD tail of each line */
+	dcp::Size const size(67, 9);
+
+	auto xyz = make_shared<dcp::OpenJPEGImage>(size);
+	Image image(AV_PIX_FMT_XYZ12LE, size, Image::Alignment::PADDED);
+
+	dcpomatic::RNG rng(1);
+	for (int y = 0; y < size.height; ++y) {
+		auto p = reinterpret_cast<uint16_t*>(image.data()[0] + y * image.stride()[0]);
+		for (int x = 0; x < size.width; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				auto const value = rng.get() & 0xfff;
+				xyz->data(c)[y * size.width + x] = value;
+				*p++ = value << 4;
+			}
+		}
+	}
+
+	int const stride = size.width * 6;
+	vector<uint8_t> ref(stride * size.height);
+	dcp::xyz_to_rgb(xyz, dcp::ColourConversion::rec709_to_xyz(), ref.data(), stride);
+
+	auto fast = fast_xyz_to_rgb(image);
+	BOOST_REQUIRE(fast->pixel_format() == AV_PIX_FMT_RGB48LE);
+
+	for (int y = 0; y < size.height; ++y) {
+		auto r = reinterpret_cast<uint16_t const*>(ref.data() + y * stride);
+		auto f = reinterpret_cast<uint16_t const*>(fast->data()[0] + y * fast->stride()[0]);
+		for (int x = 0; x < size.width * 3; ++x) {
+			/* Allow a quarter of an 8-bit step for the difference between float and double maths */
+			BOOST_REQUIRE_MESSAGE(std::abs(r[x] - f[x]) <= 64, "line " << y << " sample " << x);
+		}
+	}
+}
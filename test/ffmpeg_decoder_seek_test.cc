@@ -28,6 +28,7 @@
  */
 
 
+#include "lib/config.h"
 #include "lib/content_video.h"
 #include "lib/ffmpeg_content.h"
 #include "lib/ffmpeg_decoder.h"
@@ -84,6 +85,7 @@ test (boost::filesystem::path file, vector<int> frames)
 	auto content = make_shared<FFmpegContent>(path);
 	film->examine_and_add_content (content);
 	BOOST_REQUIRE (!wait_for_jobs());
+	BOOST_CHECK_EQUAL (content->keyframes().empty(), !Config::instance()->ffmpeg_keyframe_index());
 	auto decoder = make_shared<FFmpegDecoder>(film, content, false);
 	decoder->video->Data.connect (bind (&store, _1));
 
@@ -102,3 +104,27 @@ BOOST_AUTO_TEST_CASE (ffmpeg_decoder_seek_test)
 	test ("prophet_long_clip.mkv", { 15, 42, 999, 15 });
 	test ("dolby_aurora.vob", { 0, 125, 250, 41 });
 }
+
+
+/** As above, but seeking using an index of the keyframes */
+BOOST_AUTO_TEST_CASE (ffmpeg_decoder_seek_with_keyframe_index_test)
+{
+	ConfigRestorer cr;
+	Config::instance()->set_ffmpeg_keyframe_index(true);
+
+	vector<int> frames = { 0, 42, 999, 0 };
+
+	test ("boon_telly.mkv", frames);
+	test ("Sintel_Trailer1.480p.DivX_Plus_HD.mkv", frames);
+	test ("prophet_long_clip.mkv", { 15, 42, 999, 15 });
+}
+
+
+/** Check that asking for hardware decoding that can't be done falls back to software */
+BOOST_AUTO_TEST_CASE (ffmpeg_decoder_hardware_fallback_test)
+{
+	ConfigRestorer cr;
+	Config::instance()->set_ffmpeg_hardware_decode("not-a-real-device");
+
+	test ("boon_telly.mkv", { 0, 42, 999, 0 });
+}
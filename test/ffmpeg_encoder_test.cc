@@ -32,7 +32,9 @@
 #include "lib/ffmpeg_examiner.h"
 #include "lib/film.h"
 #include "lib/image_content.h"
+#include "lib/make_dcp.h"
 #include "lib/ratio.h"
+#include "lib/review_export.h"
 #include "lib/string_text_file_content.h"
 #include "lib/text_content.h"
 #include "lib/transcode_job.h"
@@ -476,6 +478,43 @@ BOOST_AUTO_TEST_CASE (ffmpeg_encoder_h264_with_reels)
 }
 
 
+/** Export reels of different lengths to separate files, both one at a time and all at once */
+BOOST_AUTO_TEST_CASE (ffmpeg_encoder_concurrent_reels)
+{
+	ConfigRestorer cr;
+
+	auto content1 = content_factory("test/data/flat_red.png")[0];
+	auto content2 = content_factory("test/data/flat_green.png")[0];
+	auto content3 = content_factory("test/data/flat_blue.png")[0];
+	auto film = new_test_film2 ("ffmpeg_encoder_concurrent_reels", { content1, content2, content3 });
+	film->set_reel_type (ReelType::BY_VIDEO_CONTENT);
+	content1->video->set_length (48);
+	content2->video->set_length (72);
+	content3->video->set_length (24);
+
+	for (auto concurrent: { 1, 3 }) {
+		Config::instance()->set_export_concurrent_reels(concurrent);
+
+		auto const base = String::compose("build/test/ffmpeg_encoder_concurrent_reels_%1", concurrent);
+		auto job = make_shared<TranscodeJob>(film, TranscodeJob::ChangedBehaviour::IGNORE);
+		FFmpegEncoder encoder (film, job, base + ".mov", ExportFormat::H264_AAC, false, true, false, 23);
+		encoder.go ();
+		BOOST_CHECK_EQUAL (encoder.frames_done(), 144);
+
+		auto check = [](boost::filesystem::path path, Frame length) {
+			auto reel = std::dynamic_pointer_cast<FFmpegContent>(content_factory(path)[0]);
+			BOOST_REQUIRE (reel);
+			FFmpegExaminer examiner(reel);
+			BOOST_CHECK_EQUAL (examiner.video_length(), length);
+		};
+
+		check (base + "_reel1.mov", 48);
+		check (base + "_reel2.mov", 72);
+		check (base + "_reel3.mov", 24);
+	}
+}
+
+
 /** Regression test for "Error during decoding: Butler finished" (#2097) */
 BOOST_AUTO_TEST_CASE (ffmpeg_encoder_prores_regression_1)
 {
@@ -553,3 +592,29 @@ BOOST_AUTO_TEST_CASE(ffmpeg_encoder_missing_frame_at_end)
 	BOOST_CHECK_EQUAL(nb_read_frames, 26);
 }
 
+
+
+/** Make a DCP and an export of the same film from one Player pass */
+BOOST_AUTO_TEST_CASE(ffmpeg_encoder_export_with_dcp_test)
+{
+	auto image = content_factory("test/data/flat_red.png")[0];
+	auto sound = content_factory("test/data/white.wav")[0];
+	auto film = new_test_film2("ffmpeg_encoder_export_with_dcp_test", { image, sound });
+	image->video->set_length(48);
+	BOOST_REQUIRE(ReviewExport::possible(film));
+
+	boost::filesystem::path output("build/test/ffmpeg_encoder_export_with_dcp_test.mov");
+	boost::system::error_code ec;
+	boost::filesystem::remove(output, ec);
+
+	film->write_metadata();
+	make_dcp(film, TranscodeJob::ChangedBehaviour::IGNORE, { make_shared<ReviewExport>(output, ExportFormat::PRORES_HQ, false, false, 23) });
+	BOOST_REQUIRE(!wait_for_jobs());
+	verify_dcp({film->dir(film->dcp_name())}, {});
+
+	auto check = content_factory(output)[0];
+	auto check_film = new_test_film2("ffmpeg_encoder_export_with_dcp_test_check", { check });
+	BOOST_REQUIRE(check->video);
+	BOOST_CHECK_EQUAL(check->video->length(), 48);
+	BOOST_REQUIRE(check->audio);
+}
@@ -26,9 +26,13 @@
 
 
 #include <boost/test/unit_test.hpp>
+#include "lib/audio_content.h"
+#include "lib/config.h"
+#include "lib/ffmpeg_examination.h"
 #include "lib/ffmpeg_examiner.h"
 #include "lib/ffmpeg_content.h"
 #include "lib/ffmpeg_audio_stream.h"
+#include "lib/video_content.h"
 #include "test.h"
 
 
@@ -93,3 +97,48 @@ BOOST_AUTO_TEST_CASE (ffmpeg_examiner_video_stream_selection_test)
 	BOOST_REQUIRE (examiner->video_frame_rate());
 	BOOST_CHECK_EQUAL (examiner->video_frame_rate().get(), 25);
 }
+
+
+/** Check that trusting the container index gives the same results as scanning the file */
+BOOST_AUTO_TEST_CASE (ffmpeg_examiner_trust_index_test)
+{
+	ConfigRestorer cr;
+
+	auto content = make_shared<FFmpegContent>("test/data/count300bd24.m2ts");
+
+	Config::instance()->set_ffmpeg_trust_container_index(false);
+	auto scanned = make_shared<FFmpegExaminer>(content);
+	Config::instance()->set_ffmpeg_trust_container_index(true);
+	auto trusted = make_shared<FFmpegExaminer>(content);
+
+	BOOST_CHECK_EQUAL (trusted->video_length(), scanned->video_length());
+	BOOST_CHECK_EQUAL (trusted->first_video().get().get(), scanned->first_video().get().get());
+	BOOST_REQUIRE_EQUAL (trusted->audio_streams().size(), scanned->audio_streams().size());
+	BOOST_CHECK_EQUAL (trusted->audio_streams()[0]->first_audio.get().get(), scanned->audio_streams()[0]->first_audio.get().get());
+}
+
+
+/** Check that a second examination of the same file comes from the cache and gives the same results */
+BOOST_AUTO_TEST_CASE (ffmpeg_examination_cache_test)
+{
+	auto first = make_shared<FFmpegContent>("test/data/count300bd24.m2ts");
+	auto film1 = new_test_film2("ffmpeg_examination_cache_test1", { first });
+
+	auto const key = FFmpegExamination::cache_key(first);
+	auto cached = FFmpegExamination::from_cache(key);
+	BOOST_REQUIRE (cached);
+
+	auto second = make_shared<FFmpegContent>("test/data/count300bd24.m2ts");
+	auto film2 = new_test_film2("ffmpeg_examination_cache_test2", { second });
+
+	BOOST_CHECK_EQUAL (FFmpegExamination::cache_key(second), key);
+	BOOST_REQUIRE (second->video);
+	BOOST_CHECK_EQUAL (second->video->length(), first->video->length());
+	BOOST_CHECK (second->video->size() == first->video->size());
+	BOOST_CHECK_EQUAL (second->first_video().get().get(), first->first_video().get().get());
+	BOOST_REQUIRE (second->audio);
+	BOOST_REQUIRE_EQUAL (second->audio->streams().size(), first->audio->streams().size());
+	BOOST_CHECK_EQUAL (second->audio->streams()[0]->frame_rate(), first->audio->streams()[0]->frame_rate());
+	BOOST_CHECK_EQUAL (second->audio->streams()[0]->length(), first->audio->streams()[0]->length());
+	BOOST_CHECK_EQUAL (second->audio->streams()[0]->mapping().get(0, 0), first->audio->streams()[0]->mapping().get(0, 0));
+}
@@ -25,8 +25,18 @@
  */
 
 
+#include "lib/compose.hpp"
 #include "lib/file_log.h"
+#include <dcp/filesystem.h>
+#include <dcp/raw_convert.h>
+#include <dcp/util.h>
+#include <boost/algorithm/string.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+
+using std::string;
+using std::vector;
 
 
 BOOST_AUTO_TEST_CASE (file_log_test)
@@ -35,3 +45,53 @@ BOOST_AUTO_TEST_CASE (file_log_test)
 	BOOST_CHECK_EQUAL (log.head_and_tail(1024), "This is a short log.\nWith only two lines.\n");
 	BOOST_CHECK_EQUAL (log.head_and_tail(8), "This is \n .\n .\n .\no lines.\n");
 }
+
+
+BOOST_AUTO_TEST_CASE (file_log_threads_test)
+{
+	boost::filesystem::path const path = "build/test/file_log_threads_test.log";
+	boost::system::error_code ec;
+	dcp::filesystem::remove(path, ec);
+
+	int const threads = 8;
+	int const entries = 500;
+
+	{
+		FileLog log (path, LogEntry::TYPE_GENERAL);
+
+		boost::thread_group group;
+		for (int i = 0; i < threads; ++i) {
+			group.create_thread ([&log, i]() {
+				for (int j = 0; j < entries; ++j) {
+					log.log (String::compose("thread %1 entry %2", i, j), LogEntry::TYPE_GENERAL);
+				}
+			});
+		}
+		group.join_all ();
+
+		log.flush ();
+		/* Entries of other types should be ignored */
+		log.log ("not wanted", LogEntry::TYPE_DEBUG_ENCODE);
+	}
+
+	vector<string> lines;
+	auto const text = dcp::file_to_string(path);
+	boost::algorithm::split (lines, text, boost::is_any_of("\n"), boost::token_compress_on);
+	if (!lines.empty() && lines.back().empty()) {
+		lines.pop_back ();
+	}
+	BOOST_REQUIRE_EQUAL (lines.size(), static_cast<size_t>(threads * entries));
+
+	/* Each thread's entries should be in the order that they were logged */
+	vector<int> next (threads, 0);
+	for (auto const& line: lines) {
+		vector<string> parts;
+		boost::algorithm::split (parts, line, boost::is_any_of(" "));
+		BOOST_REQUIRE (parts.size() >= 4);
+		auto const thread = dcp::raw_convert<int>(parts[parts.size() - 3]);
+		auto const entry = dcp::raw_convert<int>(parts[parts.size() - 1]);
+		BOOST_REQUIRE (thread >= 0 && thread < threads);
+		BOOST_CHECK_EQUAL (entry, next[thread]);
+		next[thread] = entry + 1;
+	}
+}
@@ -45,3 +45,33 @@ BOOST_AUTO_TEST_CASE(film_contains_atmos_content_test)
 
 }
 
+
+
+BOOST_AUTO_TEST_CASE(film_cpls_follow_changes_test)
+{
+	auto image = content_factory("test/data/flat_red.png")[0];
+	auto film = new_test_film2("film_cpls_follow_changes_test", { image });
+	BOOST_CHECK(film->cpls().empty());
+
+	make_and_verify_dcp(film);
+
+	auto cpls = film->cpls();
+	BOOST_REQUIRE_EQUAL(cpls.size(), 1U);
+	auto const first_id = cpls[0].cpl_id;
+
+	/* Asking again gives the same answer */
+	cpls = film->cpls();
+	BOOST_REQUIRE_EQUAL(cpls.size(), 1U);
+	BOOST_CHECK_EQUAL(cpls[0].cpl_id, first_id);
+
+	/* A removed DCP is forgotten */
+	boost::filesystem::remove_all(film->dir(film->dcp_name()));
+	BOOST_CHECK(film->cpls().empty());
+
+	/* and a new one is noticed */
+	film->set_name("film_cpls_follow_changes_test_again");
+	make_and_verify_dcp(film);
+	cpls = film->cpls();
+	BOOST_REQUIRE_EQUAL(cpls.size(), 1U);
+	BOOST_CHECK(cpls[0].cpl_id != first_id);
+}
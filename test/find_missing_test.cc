@@ -154,3 +154,35 @@ BOOST_AUTO_TEST_CASE (find_missing_test_with_multiple_files_one_incorrect)
 	}
 }
 
+
+
+BOOST_AUTO_TEST_CASE (find_missing_test_with_depth_limit)
+{
+	using namespace boost::filesystem;
+
+	auto name = string{"find_missing_test_with_depth_limit"};
+
+	auto content_dir = path("build/test") / path(name + "_content");
+	remove_all (content_dir);
+	create_directories (content_dir);
+	copy_file ("test/data/flat_red.png", content_dir / "A.png");
+
+	auto film = new_test_film2 (name + "_film", { content_factory(content_dir / "A.png")[0] });
+	film->write_metadata ();
+
+	/* Move the content two directories down from where we will look */
+	auto moved = path("build/test") / path(name + "_moved");
+	remove_all (moved);
+	create_directories (moved / "a");
+	rename (content_dir, moved / "a" / "b");
+
+	BOOST_REQUIRE (!film->content()[0]->paths_valid());
+
+	/* Not deep enough */
+	dcpomatic::find_missing (film->content(), moved, {}, 1);
+	BOOST_CHECK (!film->content()[0]->paths_valid());
+
+	dcpomatic::find_missing (film->content(), moved, {}, 2);
+	BOOST_CHECK (film->content()[0]->paths_valid());
+	BOOST_CHECK (film->content()[0]->path(0) == moved / "a" / "b" / "A.png");
+}
@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** @file  test/frame_prefetcher_test.cc
+ *  @brief Test FramePrefetcher.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/frame_prefetcher.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <stdexcept>
+
+
+using std::make_shared;
+using std::shared_ptr;
+
+
+class FakeReader
+{
+public:
+	shared_ptr<const int64_t> get_frame (int64_t index) const
+	{
+		++reads;
+		if (index == bad) {
+			throw std::runtime_error("bad frame");
+		}
+		return make_shared<int64_t>(index * 10);
+	}
+
+	int64_t bad = -1;
+	mutable std::atomic<int> reads{0};
+};
+
+
+BOOST_AUTO_TEST_CASE(frame_prefetcher_test)
+{
+	for (int count = 0; count < 4; ++count) {
+		auto reader = make_shared<FakeReader>();
+		FramePrefetcher<FakeReader, int64_t> prefetcher(reader, 100, count);
+
+		/* In order */
+		for (int i = 0; i < 50; ++i) {
+			BOOST_REQUIRE_EQUAL(*prefetcher.get(i), i * 10);
+		}
+
+		/* Seek backwards, forwards and repeat a frame */
+		BOOST_CHECK_EQUAL(*prefetcher.get(3), 30);
+		BOOST_CHECK_EQUAL(*prefetcher.get(80), 800);
+		BOOST_CHECK_EQUAL(*prefetcher.get(80), 800);
+		BOOST_CHECK_EQUAL(*prefetcher.get(81), 810);
+
+		/* Up to the end */
+		for (int i = 82; i < 100; ++i) {
+			BOOST_REQUIRE_EQUAL(*prefetcher.get(i), i * 10);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(frame_prefetcher_error_test)
+{
+	auto reader = make_shared<FakeReader>();
+	reader->bad = 5;
+	FramePrefetcher<FakeReader, int64_t> prefetcher(reader, 100, 3);
+
+	for (int i = 0; i < 5; ++i) {
+		BOOST_REQUIRE_EQUAL(*prefetcher.get(i), i * 10);
+	}
+	BOOST_CHECK_THROW(prefetcher.get(5), std::runtime_error);
+	BOOST_CHECK_EQUAL(*prefetcher.get(6), 60);
+}
@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/frame_recipes_test.cc
+ *  @brief Test re-use of frames from earlier encodes of a film.
+ *  @ingroup feature
+ */
+
+
+#include "lib/content_factory.h"
+#include "lib/film.h"
+#include "lib/frame_recipes.h"
+#include "lib/player.h"
+#include "lib/player_video.h"
+#include "lib/video_content.h"
+#include "test.h"
+#include <boost/test/unit_test.hpp>
+
+
+using std::shared_ptr;
+
+
+BOOST_AUTO_TEST_CASE (frame_recipes_find_frames_from_earlier_encode)
+{
+	auto red = content_factory("test/data/flat_red.png")[0];
+	auto green = content_factory("test/data/flat_green.png")[0];
+	auto film = new_test_film2 ("frame_recipes_find_frames_from_earlier_encode", { red, green });
+	red->video->set_length (24);
+	green->video->set_length (24);
+	make_and_verify_dcp (film);
+
+	/* Splitting into reels means new video assets, but everything in them is in the old one */
+	film->set_reel_type (ReelType::BY_VIDEO_CONTENT);
+	BOOST_REQUIRE_EQUAL (film->reels().size(), 2U);
+
+	FrameRecipes recipes(film);
+
+	int found = 0;
+	int frames = 0;
+	Player player(film, Image::Alignment::COMPACT);
+	player.Video.connect([film, &recipes, &found, &frames](shared_ptr<PlayerVideo> video, dcpomatic::DCPTime) {
+		++frames;
+		auto recipe = recipes.recipe(video, film->j2k_bandwidth());
+		if (recipe && recipes.find(*recipe)) {
+			++found;
+		}
+	});
+	while (!player.pass()) {}
+
+	BOOST_CHECK_EQUAL (frames, 48);
+	BOOST_CHECK_EQUAL (found, 48);
+
+	make_and_verify_dcp (film);
+}
+
+
+BOOST_AUTO_TEST_CASE (frame_recipes_ignore_changed_frames)
+{
+	auto red = content_factory("test/data/flat_red.png")[0];
+	auto film = new_test_film2 ("frame_recipes_ignore_changed_frames", { red });
+	red->video->set_length (24);
+	make_and_verify_dcp (film);
+
+	red->video->set_crop (Crop(0, 0, 16, 16));
+
+	FrameRecipes recipes(film);
+
+	int found = 0;
+	Player player(film, Image::Alignment::COMPACT);
+	player.Video.connect([film, &recipes, &found](shared_ptr<PlayerVideo> video, dcpomatic::DCPTime) {
+		auto recipe = recipes.recipe(video, film->j2k_bandwidth());
+		if (recipe && recipes.find(*recipe)) {
+			++found;
+		}
+	});
+	while (!player.pass()) {}
+
+	BOOST_CHECK_EQUAL (found, 0);
+}
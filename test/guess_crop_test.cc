@@ -57,3 +57,12 @@ BOOST_AUTO_TEST_CASE (guess_crop_image_test3)
 
 	BOOST_CHECK(guess_crop(film, content[0], 0.1, {}) == Crop(113, 262, 0, 0));
 }
+
+
+BOOST_AUTO_TEST_CASE (guess_crop_sampled_test)
+{
+	auto content = content_factory(TestPaths::private_data() / "pillarbox.png");
+	auto film = new_test_film2 ("guess_crop_sampled_test", content);
+
+	BOOST_CHECK(guess_crop_sampled(film, content[0], 0.1, 4) == Crop(113, 262, 0, 0));
+}
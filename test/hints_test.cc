@@ -53,10 +53,10 @@ collect_hint (string hint)
 
 static
 vector<string>
-get_hints (shared_ptr<Film> film)
+get_hints (shared_ptr<Film> film, shared_ptr<HintsCache> cache = {})
 {
 	current_hints.clear ();
-	Hints hints (film);
+	Hints hints (film, cache);
 	/* None of our tests need the audio analysis, and it is quite time-consuming */
 	hints.disable_audio_analysis ();
 	hints.Hint.connect (collect_hint);
@@ -295,3 +295,35 @@ BOOST_AUTO_TEST_CASE (hints_certificate_validity)
 		);
 }
 
+
+
+BOOST_AUTO_TEST_CASE (hints_cache_test)
+{
+	auto film = new_test_film2 ("hints_cache_test");
+	auto cache = make_shared<HintsCache>();
+
+	BOOST_CHECK (get_hints(film, cache).empty());
+
+	string const j2k_hint = "A few projectors have problems playing back very high bit-rate DCPs.  It is a good idea to drop the JPEG2000 bandwidth down to about 200Mbit/s; this is unlikely to have any visible effect on the image.";
+
+	film->set_j2k_bandwidth (250000000);
+
+	/* The cache has not been told about the change, so we should get the old result */
+	BOOST_CHECK (get_hints(film, cache).empty());
+
+	cache->film_changed (FilmProperty::J2K_BANDWIDTH);
+	auto hints = get_hints (film, cache);
+	BOOST_REQUIRE_EQUAL (hints.size(), 1U);
+	BOOST_CHECK_EQUAL (hints[0], j2k_hint);
+
+	/* Changes to other properties should leave the cached result alone */
+	film->set_j2k_bandwidth (100000000);
+	cache->film_changed (FilmProperty::AUDIO_CHANNELS);
+	cache->content_changed (ContentProperty::POSITION);
+	hints = get_hints (film, cache);
+	BOOST_REQUIRE_EQUAL (hints.size(), 1U);
+	BOOST_CHECK_EQUAL (hints[0], j2k_hint);
+
+	/* Without a cache everything is checked */
+	BOOST_CHECK (get_hints(film).empty());
+}
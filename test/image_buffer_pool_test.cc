@@ -0,0 +1,106 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** @file  test/image_buffer_pool_test.cc
+ *  @brief Test ImageBufferPool.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/config.h"
+#include "lib/image_buffer_pool.h"
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE(image_buffer_pool_reuse_test)
+{
+	Config::instance()->set_image_buffer_pool_size(1);
+	ImageBufferPool pool;
+
+	auto a = pool.get(4096);
+	pool.put(a, 4096);
+	BOOST_CHECK_EQUAL(pool.statistics().bytes_held, 4096U);
+
+	/* Same size should give us the same buffer back */
+	auto b = pool.get(4096);
+	BOOST_CHECK(a == b);
+	BOOST_CHECK_EQUAL(pool.statistics().hits, 1);
+	BOOST_CHECK_EQUAL(pool.statistics().bytes_held, 0U);
+
+	/* A different size should not */
+	auto c = pool.get(8192);
+	BOOST_CHECK_EQUAL(pool.statistics().misses, 2);
+
+	pool.put(b, 4096);
+	pool.put(c, 8192);
+	BOOST_CHECK_EQUAL(pool.statistics().bytes_held, 4096U + 8192U);
+}
+
+
+BOOST_AUTO_TEST_CASE(image_buffer_pool_limit_test)
+{
+	Config::instance()->set_image_buffer_pool_size(1);
+	ImageBufferPool pool;
+
+	auto a = pool.get(768 * 1024);
+	auto b = pool.get(768 * 1024);
+	pool.put(a, 768 * 1024);
+	/* This one would take us over the 1MB limit */
+	pool.put(b, 768 * 1024);
+
+	BOOST_CHECK_EQUAL(pool.statistics().discards, 1);
+	BOOST_CHECK_EQUAL(pool.statistics().bytes_held, 768U * 1024);
+
+	/* Reducing the limit should free what is held */
+	Config::instance()->set_image_buffer_pool_size(0);
+	BOOST_CHECK_EQUAL(pool.statistics().bytes_held, 0U);
+
+	Config::instance()->set_image_buffer_pool_size(512);
+}
+
+
+BOOST_AUTO_TEST_CASE(image_buffer_pool_huge_pages_test)
+{
+	Config::instance()->set_image_buffer_pool_size(0);
+	Config::instance()->set_image_huge_pages(true);
+	ImageBufferPool pool;
+
+	size_t const size = 8 * 1024 * 1024;
+	auto a = static_cast<uint8_t*>(pool.get(size));
+	/* The buffer must be usable whether or not it came from huge pages */
+	a[0] = a[size - 1] = 42;
+
+#ifdef DCPOMATIC_LINUX
+	BOOST_CHECK_EQUAL(pool.statistics().huge_page_allocations, 1);
+	BOOST_CHECK_EQUAL(pool.statistics().huge_page_bytes, size);
+#endif
+
+	/* Small buffers never come from huge pages */
+	auto b = pool.get(4096);
+	BOOST_CHECK(pool.statistics().huge_page_allocations <= 1);
+
+	pool.put(a, size);
+	pool.put(b, 4096);
+	BOOST_CHECK_EQUAL(pool.statistics().huge_page_bytes, 0U);
+
+	Config::instance()->set_image_huge_pages(false);
+	Config::instance()->set_image_buffer_pool_size(512);
+}
@@ -0,0 +1,98 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "lib/compose.hpp"
+#include "lib/content_factory.h"
+#include "lib/film.h"
+#include "lib/image.h"
+#include "lib/image_content.h"
+#include "lib/player.h"
+#include "lib/player_video.h"
+#include "test.h"
+#include <dcp/filesystem.h>
+#include <boost/bind/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+
+
+BOOST_AUTO_TEST_CASE (image_content_scan_cache_test)
+{
+	auto film = new_test_film2 ("image_content_scan_cache_test");
+
+	boost::filesystem::path const dir = "build/test/image_content_scan_cache_test/frames";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+	for (int i = 0; i < 4; ++i) {
+		boost::filesystem::copy_file ("test/data/flat_red.png", dir / String::compose("%1.png", i));
+	}
+
+	/* Make the directory look like it was last changed a while ago, otherwise its listing won't be cached */
+	auto const modified = time(nullptr) - 60;
+	boost::filesystem::last_write_time (dir, modified);
+
+	auto content = make_shared<ImageContent>(dir);
+	film->examine_and_add_content (content);
+	BOOST_REQUIRE (!wait_for_jobs());
+	BOOST_CHECK_EQUAL (content->number_of_paths(), 4U);
+
+	/* Adding a file without the directory's modification time changing should give the cached listing */
+	boost::filesystem::copy_file ("test/data/flat_red.png", dir / "4.png");
+	boost::filesystem::last_write_time (dir, modified);
+	auto cached = make_shared<ImageContent>(dir);
+	film->examine_and_add_content (cached);
+	BOOST_REQUIRE (!wait_for_jobs());
+	BOOST_CHECK_EQUAL (cached->number_of_paths(), 4U);
+
+	/* and if the directory has been modified it should be scanned again */
+	boost::filesystem::last_write_time (dir, modified + 10);
+	auto scanned = make_shared<ImageContent>(dir);
+	film->examine_and_add_content (scanned);
+	BOOST_REQUIRE (!wait_for_jobs());
+	BOOST_CHECK_EQUAL (scanned->number_of_paths(), 5U);
+}
+
+
+/** Check that the frames of a still image share one cropped and scaled image */
+BOOST_AUTO_TEST_CASE (image_content_still_shares_scaled_image_test)
+{
+	auto content = content_factory("test/data/flat_red.png")[0];
+	auto film = new_test_film2 ("image_content_still_shares_scaled_image_test", { content });
+
+	Player player (film, Image::Alignment::PADDED);
+	player.set_ignore_audio ();
+
+	vector<shared_ptr<Image>> images;
+	player.Video.connect ([&images](shared_ptr<PlayerVideo> video, dcpomatic::DCPTime) {
+		images.push_back (video->image(boost::bind(&PlayerVideo::force, AV_PIX_FMT_RGB24), VideoRange::FULL, true));
+	});
+
+	while (images.size() < 8 && !player.pass()) {}
+
+	BOOST_REQUIRE (images.size() >= 8);
+	/* The first frame may have been made before the second could share with it */
+	for (size_t i = 1; i < images.size(); ++i) {
+		BOOST_CHECK (images[i] == images.back());
+	}
+}
@@ -20,12 +20,18 @@
 
 
 #include "lib/ffmpeg_image_proxy.h"
+#include "lib/image.h"
 #include "lib/j2k_image_proxy.h"
+#include "lib/player_video.h"
 #include "test.h"
+#include <dcp/j2k_transcode.h>
+#include <dcp/openjpeg_image.h>
 #include <boost/test/unit_test.hpp>
 
 
 using std::make_shared;
+using std::weak_ptr;
+using boost::optional;
 
 
 static const boost::filesystem::path data_file0 = TestPaths::private_data() / "player_seek_test_0.png";
@@ -65,3 +71,73 @@ BOOST_AUTO_TEST_CASE (ffmpeg_image_proxy_same_test)
 	}
 }
 
+
+
+static
+dcp::ArrayData
+make_xyz_j2k(dcp::Size size)
+{
+	auto original = make_shared<dcp::OpenJPEGImage>(size);
+	for (int c = 0; c < 3; ++c) {
+		for (int i = 0; i < size.width * size.height; ++i) {
+			original->data(c)[i] = (i * (c + 1)) % 4096;
+		}
+	}
+
+	return dcp::compress_j2k(original, 250000000, 24, false, false);
+}
+
+
+/** Check that XYZ JPEG2000 can be decoded straight into an XYZ image for encoding, and
+ *  that at full size it comes out the same as it would via an Image.
+ */
+BOOST_AUTO_TEST_CASE (j2k_image_proxy_xyz_test)
+{
+	dcp::Size const size(1998, 1080);
+	auto j2k = make_xyz_j2k(size);
+
+	for (auto out_size: { size, dcp::Size(999, 540) }) {
+		auto proxy = make_shared<J2KImageProxy>(j2k, size, AV_PIX_FMT_XYZ12LE);
+		auto video = make_shared<PlayerVideo>(
+			proxy, Crop(), optional<double>(), out_size, out_size, Eyes::BOTH, Part::WHOLE,
+			optional<ColourConversion>(), VideoRange::FULL, weak_ptr<Content>(), optional<Frame>(), false
+			);
+
+		auto direct = video->xyz_image();
+		BOOST_REQUIRE(direct);
+		BOOST_REQUIRE(direct->size() == out_size);
+
+		if (out_size == size) {
+			auto image = video->image(&PlayerVideo::keep_xyz_or_rgb, VideoRange::FULL, false);
+			dcp::OpenJPEGImage via_image(image->data()[0], image->size(), image->stride()[0]);
+			for (int c = 0; c < 3; ++c) {
+				BOOST_REQUIRE(std::equal(direct->data(c), direct->data(c) + out_size.width * out_size.height, via_image.data(c)));
+			}
+		}
+	}
+
+	/* If no number of discarded levels gives the size we want we have to scale */
+	auto proxy = make_shared<J2KImageProxy>(j2k, size, AV_PIX_FMT_XYZ12LE);
+	BOOST_CHECK(!proxy->xyz(dcp::Size(1920, 1080)));
+}
+
+
+/** Check that J2KImageProxy discards as many resolution levels as it can while still making an image
+ *  at least as big as the one that is asked for.
+ */
+BOOST_AUTO_TEST_CASE (j2k_image_proxy_reduction_test)
+{
+	dcp::Size const size(1998, 1080);
+	auto proxy = make_shared<J2KImageProxy>(make_xyz_j2k(size), size, AV_PIX_FMT_XYZ12LE);
+
+	auto check = [proxy](dcp::Size target, int log2_scaling, dcp::Size decoded) {
+		auto result = proxy->image(Image::Alignment::PADDED, target);
+		BOOST_CHECK_EQUAL(result.log2_scaling, log2_scaling);
+		BOOST_CHECK(result.image->size() == decoded);
+	};
+
+	check(size, 0, size);
+	check(dcp::Size(1000, 540), 0, size);
+	check(dcp::Size(999, 540), 1, dcp::Size(999, 540));
+	check(dcp::Size(400, 200), 2, dcp::Size(500, 270));
+}
@@ -32,6 +32,7 @@
 #include "lib/image_decoder.h"
 #include "lib/image_jpeg.h"
 #include "lib/image_png.h"
+#include "lib/maths_util.h"
 #include "lib/ffmpeg_image_proxy.h"
 #include "test.h"
 #include <boost/test/unit_test.hpp>
@@ -254,6 +255,39 @@ BOOST_AUTO_TEST_CASE (alpha_blend_test)
 }
 
 
+/** Check the results of Image::alpha_blend for transparent, opaque and partially-transparent pixels */
+BOOST_AUTO_TEST_CASE(alpha_blend_bgra_onto_rgb48le_pixels_test)
+{
+	auto background = make_shared<Image>(AV_PIX_FMT_RGB48LE, dcp::Size(3, 1), Image::Alignment::PADDED);
+	auto bp = reinterpret_cast<uint16_t*>(background->data()[0]);
+	for (int i = 0; i < 9; ++i) {
+		bp[i] = 1000;
+	}
+
+	auto overlay = make_shared<Image>(AV_PIX_FMT_BGRA, dcp::Size(3, 1), Image::Alignment::PADDED);
+	overlay->make_transparent();
+	auto op = overlay->data()[0];
+	/* Pixel 0 is transparent; pixel 1 is opaque red; pixel 2 is half-transparent green */
+	op[4 + 2] = 200;
+	op[4 + 3] = 255;
+	op[8 + 1] = 100;
+	op[8 + 3] = 128;
+
+	background->alpha_blend(overlay, Position<int>(0, 0));
+
+	BOOST_CHECK_EQUAL(bp[0], 1000);
+	BOOST_CHECK_EQUAL(bp[1], 1000);
+	BOOST_CHECK_EQUAL(bp[2], 1000);
+	BOOST_CHECK_EQUAL(bp[3], 200 * 256);
+	BOOST_CHECK_EQUAL(bp[4], 0);
+	BOOST_CHECK_EQUAL(bp[5], 0);
+	float const alpha = 128 / 255.0f;
+	BOOST_CHECK_EQUAL(bp[6], uint16_t(1000 * (1 - alpha)));
+	BOOST_CHECK_EQUAL(bp[7], uint16_t(100 * 256 * alpha + 1000 * (1 - alpha)));
+	BOOST_CHECK_EQUAL(bp[8], uint16_t(1000 * (1 - alpha)));
+}
+
+
 /** Test Image::alpha_blend when blending RGBA onto XYZ12LE */
 BOOST_AUTO_TEST_CASE(alpha_blend_test_rgba_onto_xyz)
 {
@@ -530,6 +564,30 @@ BOOST_AUTO_TEST_CASE (crop_scale_window_test8)
 }
 
 
+/** Check that crop_scale_window gives the same result when it is scaling a slice at a time to call lines_ready */
+BOOST_AUTO_TEST_CASE (crop_scale_window_lines_ready_test)
+{
+	auto proxy = make_shared<FFmpegImageProxy>("test/data/rgb_grey_testcard.png");
+	auto yuv = proxy->image(Image::Alignment::PADDED).image->convert_pixel_format(dcp::YUVToRGB::REC709, AV_PIX_FMT_YUV420P, Image::Alignment::PADDED, false);
+
+	auto reference = yuv->crop_scale_window(
+		Crop(14, 6, 4, 8), dcp::Size(1435, 1080), dcp::Size(1998, 1080), dcp::YUVToRGB::REC709, VideoRange::VIDEO, AV_PIX_FMT_RGB48LE, VideoRange::FULL, Image::Alignment::COMPACT, false
+		);
+
+	int next = 0;
+	auto sliced = yuv->crop_scale_window(
+		Crop(14, 6, 4, 8), dcp::Size(1435, 1080), dcp::Size(1998, 1080), dcp::YUVToRGB::REC709, VideoRange::VIDEO, AV_PIX_FMT_RGB48LE, VideoRange::FULL, Image::Alignment::COMPACT, false,
+		[&next](Image const&, int y, int lines) {
+			BOOST_CHECK_EQUAL(y, next);
+			BOOST_CHECK(lines > 0);
+			next = y + lines;
+		});
+
+	BOOST_CHECK_EQUAL(next, 1080);
+	BOOST_CHECK(*reference == *sliced);
+}
+
+
 BOOST_AUTO_TEST_CASE (as_png_test)
 {
 	auto proxy = make_shared<FFmpegImageProxy>("test/data/3d_test/000001.png");
@@ -575,7 +633,10 @@ fade_test_format_red (AVPixelFormat f, float amount, string name)
 {
 	auto proxy = make_shared<FFmpegImageProxy>("test/data/flat_red.png");
 	auto red = proxy->image(Image::Alignment::PADDED).image->convert_pixel_format(dcp::YUVToRGB::REC709, f, Image::Alignment::PADDED, false);
+	auto faded = red->faded(amount);
 	red->fade (amount);
+	/* faded() should give the same result as fade() on a copy */
+	BOOST_CHECK (*faded == *red);
 	string const filename = "fade_test_red_" + name + ".png";
 	image_as_png(red->convert_pixel_format(dcp::YUVToRGB::REC709, AV_PIX_FMT_RGBA, Image::Alignment::PADDED, false)).write("build/test/" + filename);
 	check_image ("test/data/" + filename, "build/test/" + filename);
@@ -751,3 +812,142 @@ BOOST_AUTO_TEST_CASE (over_crop_test)
 	write_image (scaled, "build/test/" + filename);
 	check_image ("test/data/" + filename, "build/test/" + filename);
 }
+
+
+/** Check Image::video_range_to_full_range against a direct calculation for every possible sample value */
+BOOST_AUTO_TEST_CASE (video_range_to_full_range_test)
+{
+	{
+		Image image(AV_PIX_FMT_RGB24, dcp::Size(86, 2), Image::Alignment::PADDED);
+		for (int y = 0; y < 2; ++y) {
+			auto p = image.data()[0] + y * image.stride()[0];
+			for (int x = 0; x < 86 * 3; ++x) {
+				p[x] = std::min(x, 255);
+			}
+		}
+		image.video_range_to_full_range();
+		for (int y = 0; y < 2; ++y) {
+			auto p = image.data()[0] + y * image.stride()[0];
+			for (int x = 0; x < 86 * 3; ++x) {
+				long const v = std::min(x, 255);
+				BOOST_REQUIRE_EQUAL(p[x], clamp(lrintf((v - 16) * (256.0f / 219.0f)), 0L, 255L));
+			}
+		}
+	}
+
+	{
+		Image image(AV_PIX_FMT_RGB48LE, dcp::Size(21846, 2), Image::Alignment::PADDED);
+		for (int y = 0; y < 2; ++y) {
+			auto p = reinterpret_cast<uint16_t*>(image.data()[0] + y * image.stride()[0]);
+			for (int x = 0; x < 21846 * 3; ++x) {
+				p[x] = std::min(x, 65535);
+			}
+		}
+		image.video_range_to_full_range();
+		for (int y = 0; y < 2; ++y) {
+			auto p = reinterpret_cast<uint16_t*>(image.data()[0] + y * image.stride()[0]);
+			for (int x = 0; x < 21846 * 3; ++x) {
+				long const v = std::min(x, 65535);
+				BOOST_REQUIRE_EQUAL(p[x], clamp(lrintf((v - 4096) * float(65536.0 / 56064.0)), 0L, 65535L));
+			}
+		}
+	}
+
+	{
+		Image image(AV_PIX_FMT_GBRP12LE, dcp::Size(4096, 2), Image::Alignment::PADDED);
+		for (int c = 0; c < 3; ++c) {
+			for (int y = 0; y < 2; ++y) {
+				auto p = reinterpret_cast<uint16_t*>(image.data()[c] + y * image.stride()[c]);
+				for (int x = 0; x < 4096; ++x) {
+					p[x] = x;
+				}
+			}
+		}
+		image.video_range_to_full_range();
+		for (int c = 0; c < 3; ++c) {
+			for (int y = 0; y < 2; ++y) {
+				auto p = reinterpret_cast<uint16_t*>(image.data()[c] + y * image.stride()[c]);
+				for (int x = 0; x < 4096; ++x) {
+					BOOST_REQUIRE_EQUAL(p[x], clamp(lrintf((x - 256) * float(4096.0 / 3504.0)), 0L, 4095L));
+				}
+			}
+		}
+	}
+}
+
+
+/** Check Image::fade against a direct calculation */
+BOOST_AUTO_TEST_CASE (fade_test)
+{
+	float const f = 0.37;
+
+	Image rgb(AV_PIX_FMT_RGB48LE, dcp::Size(21846, 1), Image::Alignment::PADDED);
+	auto p = reinterpret_cast<uint16_t*>(rgb.data()[0]);
+	for (int x = 0; x < 21846 * 3; ++x) {
+		p[x] = std::min(x, 65535);
+	}
+	rgb.fade(f);
+	for (int x = 0; x < 21846 * 3; ++x) {
+		BOOST_REQUIRE_EQUAL(p[x], int(float(std::min(x, 65535)) * f));
+	}
+
+	Image yuv(AV_PIX_FMT_YUV420P, dcp::Size(256, 2), Image::Alignment::PADDED);
+	for (int c = 0; c < 3; ++c) {
+		for (int x = 0; x < yuv.line_size()[c]; ++x) {
+			yuv.data()[c][x] = x;
+		}
+	}
+	yuv.fade(f);
+	for (int x = 0; x < 256; ++x) {
+		BOOST_REQUIRE_EQUAL(yuv.data()[0][x], int(float(x) * f));
+	}
+	for (int c = 1; c < 3; ++c) {
+		for (int x = 0; x < yuv.line_size()[c]; ++x) {
+			BOOST_REQUIRE_EQUAL(yuv.data()[c][x], 127 + int((x - 127) * f));
+		}
+	}
+}
+
+
+/** Check that re-used scale contexts give the same results as new ones, and that contexts
+ *  are not shared between scales with different colour ranges.
+ */
+BOOST_AUTO_TEST_CASE (crop_scale_window_context_reuse_test)
+{
+	auto proxy = make_shared<FFmpegImageProxy>("test/data/flat_red.png");
+	auto raw = proxy->image(Image::Alignment::PADDED).image;
+	auto yuv = raw->convert_pixel_format(dcp::YUVToRGB::REC709, AV_PIX_FMT_YUV420P, Image::Alignment::PADDED, false);
+
+	auto scale = [yuv](VideoRange range) {
+		return yuv->crop_scale_window(
+			Crop(), dcp::Size(999, 418), dcp::Size(999, 540), dcp::YUVToRGB::REC709, range, AV_PIX_FMT_RGB24, VideoRange::FULL, Image::Alignment::PADDED, false
+			);
+	};
+
+	auto const full1 = scale(VideoRange::FULL);
+	auto const video = scale(VideoRange::VIDEO);
+	auto const full2 = scale(VideoRange::FULL);
+
+	BOOST_CHECK(*full1 == *full2);
+	BOOST_CHECK(!(*full1 == *video));
+}
+
+
+BOOST_AUTO_TEST_CASE (ensure_alignment_avoids_copy_test)
+{
+	/* 64 RGB24 pixels is 192 bytes, a multiple of the padding alignment, so the COMPACT
+	 * and PADDED versions of this image look the same in memory.
+	 */
+	auto same = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(64, 32), Image::Alignment::COMPACT);
+	BOOST_CHECK (same->has_layout_of(Image::Alignment::COMPACT));
+	BOOST_CHECK (same->has_layout_of(Image::Alignment::PADDED));
+	BOOST_CHECK (Image::ensure_alignment(same, Image::Alignment::PADDED) == same);
+
+	auto different = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(65, 32), Image::Alignment::COMPACT);
+	BOOST_CHECK (different->has_layout_of(Image::Alignment::COMPACT));
+	BOOST_CHECK (!different->has_layout_of(Image::Alignment::PADDED));
+	auto padded = Image::ensure_alignment(different, Image::Alignment::PADDED);
+	BOOST_CHECK (padded != different);
+	BOOST_CHECK (padded->alignment() == Image::Alignment::PADDED);
+	BOOST_CHECK (!padded->has_layout_of(Image::Alignment::COMPACT));
+}
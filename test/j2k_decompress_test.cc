@@ -0,0 +1,56 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "lib/j2k_decompress.h"
+#include <dcp/j2k_transcode.h>
+#include <dcp/openjpeg_image.h>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+
+
+using std::make_shared;
+
+
+/** Check that our (possibly multi-threaded) J2K decoder gives the same results as libdcp's */
+BOOST_AUTO_TEST_CASE(j2k_decompress_matches_libdcp)
+{
+	auto size = dcp::Size(1998, 1080);
+	auto image = make_shared<dcp::OpenJPEGImage>(size);
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < (size.width * size.height); ++j) {
+			image->data(i)[j] = (j * (i + 1)) % 4095;
+		}
+	}
+
+	auto j2k = dcp::compress_j2k(image, 100000000, 24, false, false);
+
+	for (auto reduce = 0; reduce < 3; ++reduce) {
+		for (auto threads: { 1, 4 }) {
+			auto ours = decompress_j2k(j2k.data(), j2k.size(), reduce, threads);
+			auto theirs = dcp::decompress_j2k(j2k.data(), j2k.size(), reduce);
+			BOOST_REQUIRE(ours->size() == theirs->size());
+			BOOST_CHECK_EQUAL(ours->precision(0), theirs->precision(0));
+			for (int i = 0; i < 3; ++i) {
+				BOOST_REQUIRE(std::equal(ours->data(i), ours->data(i) + ours->size().width * ours->size().height, theirs->data(i)));
+			}
+		}
+	}
+}
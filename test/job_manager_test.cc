@@ -25,9 +25,11 @@
  */
 
 
+#include "lib/config.h"
 #include "lib/cross.h"
 #include "lib/job.h"
 #include "lib/job_manager.h"
+#include "test.h"
 #include <boost/test/unit_test.hpp>
 
 
@@ -40,8 +42,10 @@ using std::vector;
 class TestJob : public Job
 {
 public:
-	explicit TestJob (shared_ptr<Film> film)
+	explicit TestJob (shared_ptr<Film> film, bool parallel = false, Resource resource = Resource::CPU)
 		: Job (film)
+		, _parallel (parallel)
+		, _resource (resource)
 	{
 
 	}
@@ -76,6 +80,18 @@ public:
 	string json_name () const override {
 		return "";
 	}
+
+	bool parallel () const override {
+		return _parallel;
+	}
+
+	Resource resource () const override {
+		return _resource;
+	}
+
+private:
+	bool _parallel;
+	Resource _resource;
 };
 
 
@@ -161,3 +177,102 @@ BOOST_AUTO_TEST_CASE(cancel_job_test)
 	BOOST_CHECK(jobs[1]->finished_cancelled());
 }
 
+
+
+BOOST_AUTO_TEST_CASE(job_manager_parallel_test)
+{
+	ConfigRestorer cr;
+	Config::instance()->set_parallel_examine_jobs(2);
+
+	shared_ptr<Film> film;
+
+	vector<shared_ptr<TestJob>> jobs;
+	for (int i = 0; i < 3; ++i) {
+		jobs.push_back(make_shared<TestJob>(film, true));
+	}
+	jobs.push_back(make_shared<TestJob>(film));
+	jobs.push_back(make_shared<TestJob>(film));
+
+	for (auto job: jobs) {
+		JobManager::instance()->add(job);
+	}
+
+	/* Two of the parallel jobs should be running, along with the first serial one */
+	dcpomatic_sleep_seconds(1);
+	BOOST_CHECK(jobs[0]->running());
+	BOOST_CHECK(jobs[1]->running());
+	BOOST_CHECK(!jobs[2]->running());
+	BOOST_CHECK(jobs[3]->running());
+	BOOST_CHECK(!jobs[4]->running());
+
+	jobs[0]->set_finished_ok();
+	jobs[3]->set_finished_ok();
+	dcpomatic_sleep_seconds(1);
+	BOOST_CHECK(jobs[1]->running());
+	BOOST_CHECK(jobs[2]->running());
+	BOOST_CHECK(jobs[4]->running());
+
+	for (auto job: jobs) {
+		if (!job->finished()) {
+			job->set_finished_ok();
+		}
+	}
+
+	BOOST_REQUIRE(!wait_for_jobs());
+}
+
+
+BOOST_AUTO_TEST_CASE(job_manager_resource_test)
+{
+	shared_ptr<Film> no_film;
+
+	vector<shared_ptr<TestJob>> jobs;
+	jobs.push_back(make_shared<TestJob>(no_film, false, Job::Resource::CPU));
+	jobs.push_back(make_shared<TestJob>(no_film, false, Job::Resource::CPU));
+	jobs.push_back(make_shared<TestJob>(no_film, false, Job::Resource::DISK));
+	jobs.push_back(make_shared<TestJob>(no_film, false, Job::Resource::NETWORK));
+	jobs.push_back(make_shared<TestJob>(no_film, false, Job::Resource::NETWORK));
+	jobs.push_back(make_shared<TestJob>(no_film, false, Job::Resource::NETWORK));
+
+	/* Jobs for the same film must still run one after the other, whatever they use */
+	auto film = new_test_film("job_manager_resource_test");
+	jobs.push_back(make_shared<TestJob>(film, false, Job::Resource::CPU));
+	jobs.push_back(make_shared<TestJob>(film, false, Job::Resource::DISK));
+
+	for (auto job: jobs) {
+		JobManager::instance()->add(job);
+	}
+
+	/* One CPU job, one disk job and two network jobs should be running */
+	dcpomatic_sleep_seconds(1);
+	BOOST_CHECK(jobs[0]->running());
+	BOOST_CHECK(!jobs[1]->running());
+	BOOST_CHECK(jobs[2]->running());
+	BOOST_CHECK(jobs[3]->running());
+	BOOST_CHECK(jobs[4]->running());
+	BOOST_CHECK(!jobs[5]->running());
+	BOOST_CHECK(!jobs[6]->running());
+	BOOST_CHECK(!jobs[7]->running());
+
+	jobs[0]->set_finished_ok();
+	jobs[1]->set_finished_ok();
+	jobs[2]->set_finished_ok();
+	jobs[3]->set_finished_ok();
+	dcpomatic_sleep_seconds(1);
+	BOOST_CHECK(jobs[4]->running());
+	BOOST_CHECK(jobs[5]->running());
+	BOOST_CHECK(jobs[6]->running());
+	BOOST_CHECK(!jobs[7]->running());
+
+	jobs[6]->set_finished_ok();
+	dcpomatic_sleep_seconds(1);
+	BOOST_CHECK(jobs[7]->running());
+
+	for (auto job: jobs) {
+		if (!job->finished()) {
+			job->set_finished_ok();
+		}
+	}
+
+	BOOST_REQUIRE(!wait_for_jobs());
+}
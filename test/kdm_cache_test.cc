@@ -0,0 +1,73 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "lib/config.h"
+#include "lib/kdm_cache.h"
+#include <dcp/certificate_chain.h>
+#include <dcp/decrypted_kdm_key.h>
+#include <dcp/filesystem.h>
+#include <dcp/key.h>
+#include <dcp/util.h>
+#include <boost/test/unit_test.hpp>
+
+
+using std::string;
+
+
+BOOST_AUTO_TEST_CASE(kdm_cache_test)
+{
+	boost::filesystem::path const dir = "build/test/kdm_cache_test";
+	dcp::filesystem::remove_all(dir);
+
+	dcp::LocalTime const from("2023-01-03T10:30:00");
+	dcp::LocalTime const to("2023-01-10T10:30:00");
+	dcp::LocalTime const later_to("2023-01-17T10:30:00");
+
+	auto const cpl_id = dcp::make_uuid();
+	auto const key_id = dcp::make_uuid();
+	dcp::Key const key;
+
+	auto make = [&](dcp::LocalTime end) {
+		dcp::DecryptedKDM kdm(from, end, "annotation", "title", dcp::LocalTime().as_string());
+		kdm.add_key(dcp::DecryptedKDMKey(string("MDIK"), key_id, key, cpl_id, dcp::Standard::SMPTE));
+		return kdm;
+	};
+
+	auto signer = Config::instance()->signer_chain();
+	auto const recipient = dcp::Certificate(dcp::file_to_string("test/data/cert.pem"));
+	auto const formulation = dcp::Formulation::MODIFIED_TRANSITIONAL_1;
+
+	string first;
+	{
+		KDMCache cache(dir);
+		first = cache.encrypt(make(to), from, to, signer, recipient, {}, formulation, false, {}).as_xml();
+		/* Asking again gives the same KDM, rather than a new one (which would have a new message ID) */
+		BOOST_CHECK_EQUAL(cache.encrypt(make(to), from, to, signer, recipient, {}, formulation, false, {}).as_xml(), first);
+		/* Changing anything gives a different one */
+		BOOST_CHECK(cache.encrypt(make(later_to), from, later_to, signer, recipient, {}, formulation, false, {}).as_xml() != first);
+		BOOST_CHECK(cache.encrypt(make(to), from, to, signer, recipient, {}, formulation, true, {}).as_xml() != first);
+	}
+
+	/* The KDMs are still there for another cache using the same directory */
+	KDMCache cache(dir);
+	BOOST_CHECK_EQUAL(cache.encrypt(make(to), from, to, signer, recipient, {}, formulation, false, {}).as_xml(), first);
+}
@@ -0,0 +1,105 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  test/pcm_decoder_test.cc
+ *  @brief Check that PCMDecoder gives the same audio as FFmpegDecoder.
+ */
+
+
+#include "lib/audio_buffers.h"
+#include "lib/audio_decoder.h"
+#include "lib/content_audio.h"
+#include "lib/content_factory.h"
+#include "lib/ffmpeg_content.h"
+#include "lib/ffmpeg_decoder.h"
+#include "lib/pcm_decoder.h"
+#include "test.h"
+#include <boost/optional.hpp>
+#include <boost/test/unit_test.hpp>
+
+
+using std::dynamic_pointer_cast;
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+using boost::optional;
+using namespace dcpomatic;
+
+
+/** @return All the samples from channel 0 of decoder, from its current position to the end */
+static
+vector<float>
+decode_all(shared_ptr<Decoder> decoder)
+{
+	vector<float> samples;
+	decoder->audio->Data.connect([&samples](AudioStreamPtr, ContentAudio audio) {
+		auto data = audio.audio->data(0);
+		samples.insert(samples.end(), data, data + audio.audio->frames());
+	});
+
+	while (!decoder->pass()) {}
+	return samples;
+}
+
+
+BOOST_AUTO_TEST_CASE(pcm_decoder_matches_ffmpeg_test)
+{
+	for (auto file: { "sine_440.wav", "impulse_train.wav" }) {
+		auto content = dynamic_pointer_cast<FFmpegContent>(content_factory(boost::filesystem::path("test/data") / file)[0]);
+		BOOST_REQUIRE(content);
+		auto film = new_test_film2("pcm_decoder_matches_ffmpeg_test", { content });
+
+		BOOST_REQUIRE(PCMDecoder::can_decode(content));
+
+		auto const ffmpeg = decode_all(make_shared<FFmpegDecoder>(film, content, false, boost::none, boost::none));
+		auto const pcm = decode_all(make_shared<PCMDecoder>(film, content, false));
+		BOOST_CHECK(ffmpeg == pcm);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(pcm_decoder_seek_test)
+{
+	auto content = dynamic_pointer_cast<FFmpegContent>(content_factory("test/data/impulse_train.wav")[0]);
+	BOOST_REQUIRE(content);
+	auto film = new_test_film2("pcm_decoder_seek_test", { content });
+
+	auto const all = decode_all(make_shared<PCMDecoder>(film, content, false));
+
+	auto decoder = make_shared<PCMDecoder>(film, content, false);
+	for (auto frame: { 12345, 0, 48000 }) {
+		decoder->seek(ContentTime::from_frames(frame, 48000), false);
+		optional<Frame> first;
+		optional<float> sample;
+		auto connection = decoder->audio->Data.connect([&first, &sample](AudioStreamPtr, ContentAudio audio) {
+			if (!first) {
+				first = audio.frame;
+				sample = audio.audio->data(0)[0];
+			}
+		});
+		BOOST_REQUIRE(!decoder->pass());
+		connection.disconnect();
+		BOOST_REQUIRE(first);
+		BOOST_CHECK_EQUAL(*first, frame);
+		BOOST_CHECK_EQUAL(*sample, all[frame]);
+	}
+}
@@ -53,6 +53,7 @@
 using std::cout;
 using std::list;
 using std::shared_ptr;
+using std::vector;
 using std::make_shared;
 using boost::bind;
 using boost::optional;
@@ -710,3 +711,93 @@ BOOST_AUTO_TEST_CASE(three_d_in_two_d_chooses_left)
 	while (!player->pass()) {}
 }
 
+
+
+/** Check that decoding ahead on per-content threads gives the same emissions as decoding serially */
+BOOST_AUTO_TEST_CASE(player_decode_ahead_test)
+{
+	ConfigRestorer cr;
+
+	auto A = content_factory("test/data/flat_red.png")[0];
+	auto B = content_factory("test/data/awkward_length.wav")[0];
+	auto film = new_test_film2("player_decode_ahead_test", { A, B });
+	film->set_video_frame_rate(24);
+	A->video->set_length(3 * 24);
+
+	auto run = [film](bool decode_ahead) {
+		Config::instance()->set_player_decode_ahead(decode_ahead);
+		std::vector<DCPTime> video_times;
+		std::vector<std::pair<DCPTime, Frame>> audio_times;
+		Player player(film, Image::Alignment::COMPACT);
+		player.Video.connect([&video_times](shared_ptr<PlayerVideo>, DCPTime time) {
+			video_times.push_back(time);
+		});
+		player.Audio.connect([&audio_times](shared_ptr<AudioBuffers> audio, DCPTime time, int) {
+			audio_times.push_back(std::make_pair(time, audio->frames()));
+		});
+		while (!player.pass()) {}
+		return std::make_pair(video_times, audio_times);
+	};
+
+	auto const serial = run(false);
+	auto const ahead = run(true);
+
+	BOOST_CHECK_EQUAL(serial.first.size(), 3U * 24 + 1);
+	BOOST_CHECK(serial.first == ahead.first);
+	BOOST_CHECK(serial.second == ahead.second);
+}
+
+
+/** Check that a long playlist of short pieces of content is played back in order and without gaps */
+BOOST_AUTO_TEST_CASE(player_many_short_pieces_test)
+{
+	vector<shared_ptr<Content>> content;
+	for (int i = 0; i < 50; ++i) {
+		content.push_back(content_factory("test/data/flat_red.png")[0]);
+	}
+
+	auto film = new_test_film2("player_many_short_pieces_test", content);
+	film->set_video_frame_rate(24);
+	for (auto i: content) {
+		i->video->set_length(2);
+	}
+	film->playlist()->maybe_sequence(film);
+
+	Player player(film, Image::Alignment::COMPACT);
+	optional<DCPTime> last_time;
+	int frames = 0;
+	player.Video.connect([&last_time, &frames](shared_ptr<PlayerVideo>, DCPTime time) {
+		BOOST_CHECK(!last_time || time == *last_time + DCPTime::from_frames(1, 24));
+		last_time = time;
+		++frames;
+	});
+
+	while (!player.pass()) {}
+	BOOST_CHECK_EQUAL(frames, 50 * 2);
+}
+
+
+/** Check that moving content keeps its decoder, but that other changes give it a new one */
+BOOST_AUTO_TEST_CASE(player_reuse_decoders_test)
+{
+	auto A = content_factory("test/data/flat_red.png")[0];
+	auto B = content_factory("test/data/flat_red.png")[0];
+	auto film = new_test_film2("player_reuse_decoders_test", { A, B });
+	film->set_sequence(false);
+
+	Player player(film, Image::Alignment::COMPACT);
+	BOOST_REQUIRE_EQUAL(player._pieces.size(), 2U);
+	auto const decoder_A = player._pieces[0]->decoder;
+	auto const decoder_B = player._pieces[1]->decoder;
+
+	A->set_position(film, DCPTime::from_seconds(20));
+	BOOST_REQUIRE_EQUAL(player._pieces.size(), 2U);
+	/* A is now after B */
+	BOOST_CHECK(player._pieces[0]->decoder == decoder_B);
+	BOOST_CHECK(player._pieces[1]->decoder == decoder_A);
+
+	A->video->set_frame_type(VideoFrameType::THREE_D_LEFT_RIGHT);
+	BOOST_REQUIRE_EQUAL(player._pieces.size(), 2U);
+	BOOST_CHECK(player._pieces[0]->decoder == decoder_B);
+	BOOST_CHECK(player._pieces[1]->decoder != decoder_A);
+}
@@ -0,0 +1,126 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/player_video_cache_test.cc
+ *  @brief Check PlayerVideoCache.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/image.h"
+#include "lib/player_video.h"
+#include "lib/player_video_cache.h"
+#include "lib/raw_image_proxy.h"
+#include <boost/test/unit_test.hpp>
+
+
+using std::make_shared;
+using std::shared_ptr;
+using std::weak_ptr;
+using boost::optional;
+using namespace dcpomatic;
+
+
+static
+shared_ptr<PlayerVideo>
+make_frame ()
+{
+	auto image = make_shared<Image>(AV_PIX_FMT_RGB24, dcp::Size(64, 32), Image::Alignment::PADDED);
+	image->make_black ();
+
+	return make_shared<PlayerVideo>(
+		make_shared<RawImageProxy>(image),
+		Crop(),
+		optional<double>(),
+		dcp::Size(64, 32),
+		dcp::Size(64, 32),
+		Eyes::BOTH,
+		Part::WHOLE,
+		optional<ColourConversion>(),
+		VideoRange::FULL,
+		weak_ptr<Content>(),
+		optional<Frame>(),
+		false
+		);
+}
+
+
+BOOST_AUTO_TEST_CASE (player_video_cache_get_test)
+{
+	PlayerVideoCache cache (1024 * 1024);
+
+	auto const frame = DCPTime::from_frames(1, 24);
+	auto a = make_frame ();
+	auto b = make_frame ();
+	cache.put (a, DCPTime());
+	cache.put (b, frame);
+
+	auto first = cache.get(DCPTime(), DCPTime());
+	BOOST_REQUIRE (first);
+	BOOST_CHECK (first->first == a);
+
+	auto second = cache.get(frame, DCPTime());
+	BOOST_REQUIRE (second);
+	BOOST_CHECK (second->first == b);
+
+	/* Close enough to the second frame */
+	auto near = cache.get(frame + DCPTime(10), DCPTime::from_frames(1, 48));
+	BOOST_REQUIRE (near);
+	BOOST_CHECK (near->first == b);
+	BOOST_CHECK (near->second == frame);
+
+	BOOST_CHECK (!cache.get(DCPTime::from_frames(3, 24), DCPTime::from_frames(1, 48)));
+
+	cache.clear ();
+	BOOST_CHECK_EQUAL (cache.size(), 0U);
+	BOOST_CHECK_EQUAL (cache.memory_used(), 0U);
+}
+
+
+/** Check that the frames furthest from the last one used are thrown away first */
+BOOST_AUTO_TEST_CASE (player_video_cache_evict_test)
+{
+	auto const memory = make_frame()->memory_used();
+	PlayerVideoCache cache (memory * 3);
+
+	auto at = [](int index) {
+		return DCPTime::from_frames(index, 24);
+	};
+
+	for (int i = 0; i < 5; ++i) {
+		cache.put (make_frame(), at(i));
+	}
+
+	BOOST_CHECK_EQUAL (cache.size(), 3U);
+	BOOST_CHECK_EQUAL (cache.memory_used(), memory * 3);
+	BOOST_CHECK (!cache.get(at(1), DCPTime()));
+	BOOST_CHECK (cache.get(at(2), DCPTime()));
+	BOOST_CHECK (cache.get(at(4), DCPTime()));
+
+	/* Stepping back to frame 1 should lose frame 4 */
+	cache.put (make_frame(), at(1));
+	BOOST_CHECK_EQUAL (cache.size(), 3U);
+	BOOST_CHECK (cache.get(at(1), DCPTime()));
+	BOOST_CHECK (cache.get(at(3), DCPTime()));
+	BOOST_CHECK (!cache.get(at(4), DCPTime()));
+}
@@ -23,6 +23,7 @@
 #include "lib/content_factory.h"
 #include "lib/film.h"
 #include "lib/playlist.h"
+#include "lib/video_content.h"
 #include "test.h"
 #include <boost/test/unit_test.hpp>
 
@@ -96,3 +97,35 @@ BOOST_AUTO_TEST_CASE(playlist_move_later_test2)
 	BOOST_CHECK(content[2]->position() == positions[2]);
 }
 
+
+
+/** Check that the playlist's remembered timeline geometry follows changes to content and the film */
+BOOST_AUTO_TEST_CASE(playlist_geometry_test)
+{
+	vector<shared_ptr<Content>> content;
+	vector<dcpomatic::DCPTime> positions;
+	vector<dcpomatic::DCPTime> lengths;
+	auto film = setup(content, positions, lengths);
+	auto playlist = film->playlist();
+
+	BOOST_CHECK(playlist->length(film) == content[2]->end(film));
+	BOOST_CHECK(playlist->video_end(film) == content[2]->end(film));
+	BOOST_CHECK(playlist->start() == dcpomatic::DCPTime());
+
+	content[2]->video->set_length(48);
+	BOOST_CHECK(playlist->length(film) == content[2]->position() + dcpomatic::DCPTime::from_seconds(2));
+
+	content[2]->set_trim_end(dcpomatic::ContentTime::from_seconds(1));
+	BOOST_CHECK(playlist->length(film) == content[2]->position() + dcpomatic::DCPTime::from_seconds(1));
+
+	film->set_video_frame_rate(48);
+	BOOST_CHECK(playlist->length(film) == content[2]->end(film));
+
+	auto const points = playlist->video_split_points(film);
+	BOOST_REQUIRE(!points.empty());
+	BOOST_CHECK(points.front() == content[0]->end(film));
+	BOOST_CHECK(points.back() == content[2]->end(film));
+
+	film->remove_content(content[2]);
+	BOOST_CHECK(playlist->length(film) == content[1]->end(film));
+}
@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/presentation_scheduler_test.cc
+ *  @brief Test PresentationScheduler class.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/presentation_scheduler.h"
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE(presentation_scheduler_timing_test)
+{
+	double const frame = 1.0 / 48;
+	double const refresh = 1.0 / 60;
+
+	PresentationScheduler scheduler;
+
+	/* Without vsync we draw frames when they are due, and drop them once the following frame is due */
+	BOOST_CHECK_CLOSE(scheduler.wait(0.01), 0.01, 1e-6);
+	BOOST_CHECK_EQUAL(scheduler.wait(-0.01), 0);
+	BOOST_CHECK(!scheduler.too_late(-frame / 2, frame));
+	BOOST_CHECK(scheduler.too_late(-frame * 1.5, frame));
+
+	/* With vsync we draw half a refresh early */
+	scheduler.set_vsync(true);
+	scheduler.set_refresh_period(refresh);
+	BOOST_CHECK_CLOSE(scheduler.wait(0.01), 0.01 - refresh / 2, 1e-6);
+	BOOST_CHECK(!scheduler.too_late(-frame / 2, frame));
+	BOOST_CHECK(scheduler.too_late(refresh / 4 - frame, frame));
+}
+
+
+BOOST_AUTO_TEST_CASE(presentation_scheduler_statistics_test)
+{
+	double const frame = 1.0 / 48;
+	double const refresh = 1.0 / 60;
+
+	PresentationScheduler scheduler;
+	scheduler.set_vsync(true);
+	scheduler.set_refresh_period(refresh);
+	scheduler.start();
+
+	scheduler.presented(0, 0.001, frame);
+	scheduler.presented(refresh, refresh / 2 - 0.0005, frame);
+	scheduler.presented(refresh * 3, 0.02, frame);
+	scheduler.dropped();
+
+	auto stats = scheduler.statistics();
+	BOOST_CHECK_EQUAL(stats.presented, 3);
+	BOOST_CHECK_EQUAL(stats.late, 1);
+	BOOST_CHECK_EQUAL(stats.missed, 1);
+	BOOST_CHECK_CLOSE(stats.worst_lateness, 0.02, 1e-6);
+
+	scheduler.start();
+	BOOST_CHECK_EQUAL(scheduler.statistics().presented, 0);
+}
+
+
+/** Check that the refresh period is guessed from the times between presentations if we weren't given it */
+BOOST_AUTO_TEST_CASE(presentation_scheduler_guess_refresh_test)
+{
+	double const refresh = 1.0 / 60;
+
+	PresentationScheduler scheduler;
+	scheduler.set_vsync(true);
+
+	double now = 0;
+	for (int i = 0; i < 20; ++i) {
+		scheduler.presented(now, 0, refresh);
+		/* Frames are on alternating one and two refreshes apart, as for 40fps on a 60Hz display */
+		now += (i % 2) ? refresh : refresh * 2;
+	}
+
+	BOOST_REQUIRE(scheduler.refresh_period());
+	BOOST_CHECK_CLOSE(*scheduler.refresh_period(), refresh, 1);
+}
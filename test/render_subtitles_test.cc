@@ -198,3 +198,51 @@ BOOST_AUTO_TEST_CASE (render_text_test)
 }
 
 #endif
+
+
+/** Check that a line rendered for a second time is re-used, and that fades are applied to it */
+BOOST_AUTO_TEST_CASE(render_text_cache_test)
+{
+	auto dcp_string = dcp::SubtitleString(
+		{}, false, false, false, dcp::Colour(255, 255, 255), 42, 1.0,
+		dcp::Time(0, 0, 0, 0, 24), dcp::Time(0, 0, 4, 0, 24),
+		0.5, dcp::HAlign::CENTER,
+		0.5, dcp::VAlign::CENTER,
+		0.0,
+		dcp::Direction::LTR,
+		"Cached line",
+		dcp::Effect::NONE, dcp::Colour(0, 0, 0),
+		dcp::Time(0, 0, 1, 0, 24), {},
+		0,
+		std::vector<dcp::Ruby>()
+		);
+
+	std::vector<StringText> st = {{dcp_string, 0, make_shared<dcpomatic::Font>("foo"), dcp::SubtitleStandard::SMPTE_2014}};
+
+	auto const first = render_text(st, dcp::Size(1998, 1080), dcpomatic::DCPTime::from_seconds(2), 24);
+	auto const second = render_text(st, dcp::Size(1998, 1080), dcpomatic::DCPTime::from_seconds(3), 24);
+	BOOST_REQUIRE_EQUAL(first.size(), 1U);
+	BOOST_REQUIRE_EQUAL(second.size(), 1U);
+	BOOST_CHECK(first[0].image == second[0].image);
+
+	/* Half-way through the fade up */
+	auto const faded = render_text(st, dcp::Size(1998, 1080), dcpomatic::DCPTime::from_seconds(0.5), 24);
+	BOOST_REQUIRE_EQUAL(faded.size(), 1U);
+	BOOST_CHECK(faded[0].image != first[0].image);
+	BOOST_REQUIRE(faded[0].image->size() == first[0].image->size());
+	BOOST_CHECK(faded[0].position == first[0].position);
+
+	auto max_alpha = [](shared_ptr<const Image> image) {
+		int alpha = 0;
+		for (int y = 0; y < image->size().height; ++y) {
+			auto p = image->data()[0] + y * image->stride()[0];
+			for (int x = 0; x < image->size().width; ++x) {
+				alpha = std::max(alpha, int(p[x * 4 + 3]));
+			}
+		}
+		return alpha;
+	};
+
+	BOOST_CHECK_EQUAL(max_alpha(first[0].image), 255);
+	BOOST_CHECK_EQUAL(max_alpha(faded[0].image), 127);
+}
@@ -0,0 +1,76 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include "lib/serial_worker.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+
+using std::vector;
+
+
+BOOST_AUTO_TEST_CASE(serial_worker_order_test)
+{
+	vector<int> order;
+
+	SerialWorker worker("test", 4);
+	for (int i = 0; i < 1000; ++i) {
+		worker.submit([&order, i]() {
+			order.push_back(i);
+		});
+	}
+	worker.finish();
+
+	BOOST_REQUIRE_EQUAL(order.size(), 1000U);
+	for (int i = 0; i < 1000; ++i) {
+		BOOST_CHECK_EQUAL(order[i], i);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(serial_worker_exception_test)
+{
+	std::atomic<int> count(0);
+
+	SerialWorker worker("test", 1);
+	worker.submit([]() {
+		throw std::runtime_error("oh dear");
+	});
+
+	/* Whichever of submit() or finish() comes after the failure should pass it on */
+	bool thrown = false;
+	try {
+		for (int i = 0; i < 100; ++i) {
+			worker.submit([&count]() { ++count; });
+		}
+		worker.finish();
+	} catch (std::runtime_error& e) {
+		thrown = true;
+		BOOST_CHECK_EQUAL(e.what(), std::string("oh dear"));
+	}
+
+	BOOST_CHECK(thrown);
+	BOOST_CHECK_EQUAL(count, 0);
+}
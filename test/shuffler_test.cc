@@ -38,7 +38,7 @@ using namespace boost::placeholders;
 static void
 push (Shuffler& s, int frame, Eyes eyes)
 {
-	auto piece = make_shared<Piece>(shared_ptr<Content>(), shared_ptr<Decoder>(), FrameRateChange(24, 24));
+	auto piece = make_shared<Piece>(shared_ptr<const Film>(), shared_ptr<Content>(), shared_ptr<Decoder>(), FrameRateChange(24, 24));
 	ContentVideo cv;
 	cv.frame = frame;
 	cv.eyes = eyes;
@@ -194,3 +194,32 @@ BOOST_AUTO_TEST_CASE (socket_digest_test2)
 	BOOST_CHECK (server.result());
 }
 
+
+
+/** Check that writing several buffers at once sends the same data, with the same digest, as writing them separately */
+BOOST_AUTO_TEST_CASE (socket_write_buffers_test)
+{
+	using boost::asio::ip::tcp;
+
+	TestServer server(false);
+	server.expect (13 + 16);
+
+	boost::asio::io_service io_service;
+	tcp::resolver resolver (io_service);
+	tcp::resolver::query query ("127.0.0.1", dcp::raw_convert<string>(TEST_SERVER_PORT));
+	tcp::resolver::iterator endpoint_iterator = resolver.resolve (query);
+
+	auto socket = make_shared<Socket>();
+	socket->connect (*endpoint_iterator);
+	{
+		Socket::WriteDigestScope ds(socket);
+		char const* message = "Hello world!";
+		socket->write({ boost::asio::buffer(message, 6), boost::asio::buffer(message + 6, 7) });
+	}
+
+	server.await ();
+	BOOST_CHECK_EQUAL(strcmp(reinterpret_cast<char const *>(server.buffer()), "Hello world!"), 0);
+
+	char ref[] = "\x59\x86\x88\xed\x18\xc8\x71\xdd\x57\xb9\xb7\x9f\x4b\x03\x14\xcf";
+	BOOST_CHECK (memcmp(server.buffer() + 13, ref, 16) == 0);
+}
@@ -0,0 +1,76 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "lib/spill_journal.h"
+#include "test.h"
+#include <dcp/array_data.h>
+#include <dcp/filesystem.h>
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+
+
+using std::make_shared;
+using std::shared_ptr;
+
+
+static shared_ptr<dcp::ArrayData>
+frame_data(int size, uint8_t value)
+{
+	auto data = make_shared<dcp::ArrayData>(size);
+	memset(data->data(), value, size);
+	return data;
+}
+
+
+BOOST_AUTO_TEST_CASE(spill_journal_round_trip_test)
+{
+	boost::filesystem::path const path = "build/test/spill_journal_round_trip_test.spill";
+	dcp::filesystem::remove(path);
+
+	{
+		SpillJournal journal(path);
+		journal.write(0, 4, Eyes::BOTH, *frame_data(100, 4));
+		journal.write(0, 3, Eyes::BOTH, *frame_data(200, 3));
+		journal.write(1, 3, Eyes::LEFT, *frame_data(300, 5));
+		BOOST_CHECK_EQUAL(journal.end(), 600);
+
+		auto three = journal.read(0, 3, Eyes::BOTH);
+		BOOST_CHECK(*three == *frame_data(200, 3));
+		/* That frame wasn't at the end so no space is recovered */
+		BOOST_CHECK_EQUAL(journal.end(), 600);
+
+		auto left = journal.read(1, 3, Eyes::LEFT);
+		BOOST_CHECK(*left == *frame_data(300, 5));
+		/* Now the space for both is recovered */
+		BOOST_CHECK_EQUAL(journal.end(), 100);
+
+		journal.write(0, 5, Eyes::BOTH, *frame_data(50, 6));
+		BOOST_CHECK_EQUAL(journal.end(), 150);
+
+		BOOST_CHECK(*journal.read(0, 4, Eyes::BOTH) == *frame_data(100, 4));
+		BOOST_CHECK(*journal.read(0, 5, Eyes::BOTH) == *frame_data(50, 6));
+		BOOST_CHECK(journal.empty());
+		BOOST_CHECK_EQUAL(journal.end(), 0);
+	}
+
+	BOOST_CHECK(!dcp::filesystem::exists(path));
+}
@@ -0,0 +1,104 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "lib/task_scheduler.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <vector>
+
+
+using std::vector;
+
+
+BOOST_AUTO_TEST_CASE(task_scheduler_runs_all_tasks_test)
+{
+	TaskScheduler scheduler(4);
+	std::atomic<int> count(0);
+
+	{
+		TaskScheduler::Group group(&scheduler, TaskScheduler::Priority::ENCODE);
+		for (int i = 0; i < 1000; ++i) {
+			group.submit([&count]() { ++count; });
+		}
+		group.wait();
+		BOOST_CHECK_EQUAL(count, 1000);
+
+		group.submit([&count]() { ++count; });
+	}
+
+	/* The Group's destructor should have waited for the last task */
+	BOOST_CHECK_EQUAL(count, 1001);
+}
+
+
+BOOST_AUTO_TEST_CASE(task_scheduler_priority_test)
+{
+	TaskScheduler scheduler(1);
+
+	boost::mutex mutex;
+	boost::condition condition;
+	bool started = false;
+	bool release = false;
+	vector<int> order;
+
+	TaskScheduler::Group group(&scheduler, TaskScheduler::Priority::BACKGROUND);
+
+	/* Hold up the only worker while we queue some tasks */
+	group.submit([&]() {
+		boost::mutex::scoped_lock lm(mutex);
+		started = true;
+		condition.notify_all();
+		while (!release) {
+			condition.wait(lm);
+		}
+	});
+
+	{
+		boost::mutex::scoped_lock lm(mutex);
+		while (!started) {
+			condition.wait(lm);
+		}
+	}
+
+	TaskScheduler::Group background(&scheduler, TaskScheduler::Priority::BACKGROUND);
+	TaskScheduler::Group encode(&scheduler, TaskScheduler::Priority::ENCODE);
+	TaskScheduler::Group preview(&scheduler, TaskScheduler::Priority::PREVIEW);
+
+	background.submit([&]() { boost::mutex::scoped_lock lm(mutex); order.push_back(2); });
+	encode.submit([&]() { boost::mutex::scoped_lock lm(mutex); order.push_back(1); });
+	preview.submit([&]() { boost::mutex::scoped_lock lm(mutex); order.push_back(0); });
+
+	{
+		boost::mutex::scoped_lock lm(mutex);
+		release = true;
+	}
+	condition.notify_all();
+
+	group.wait();
+	background.wait();
+	encode.wait();
+	preview.wait();
+
+	BOOST_REQUIRE_EQUAL(order.size(), 3U);
+	BOOST_CHECK_EQUAL(order[0], 0);
+	BOOST_CHECK_EQUAL(order[1], 1);
+	BOOST_CHECK_EQUAL(order[2], 2);
+}
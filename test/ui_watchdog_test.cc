@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  test/ui_watchdog_test.cc
+ *  @brief Check that UIWatchdog measures UI latency and notices stalls.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/cross.h"
+#include "lib/signal_manager.h"
+#include "lib/ui_watchdog.h"
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+
+
+BOOST_AUTO_TEST_CASE(ui_watchdog_test)
+{
+	/* Our "UI thread" is this one, which calls ui_idle() itself */
+	auto watchdog = UIWatchdog::instance();
+	watchdog->start(200);
+
+	auto run_ui = [](int milliseconds) {
+		for (int i = 0; i < milliseconds / 10; ++i) {
+			while (signal_manager->ui_idle()) {}
+			dcpomatic_sleep_milliseconds(10);
+		}
+	};
+
+	/* A responsive UI */
+	run_ui(500);
+
+	auto statistics = watchdog->statistics();
+	BOOST_CHECK_EQUAL(statistics.stalls, 0);
+	BOOST_CHECK(statistics.counts[0] + statistics.counts[1] + statistics.counts[2] + statistics.counts[3] > 0);
+
+	/* Now block for a while */
+	{
+		UIWatchdog::Activity activity("ui_watchdog_test");
+		/* The watchdog may interrupt our sleeps to look at our stack, so keep going until we've really waited */
+		auto const end = std::chrono::steady_clock::now() + std::chrono::milliseconds(600);
+		while (std::chrono::steady_clock::now() < end) {
+			dcpomatic_sleep_milliseconds(10);
+		}
+	}
+	run_ui(200);
+
+	statistics = watchdog->statistics();
+	BOOST_CHECK_EQUAL(statistics.stalls, 1);
+	BOOST_CHECK(statistics.longest >= 400);
+	BOOST_CHECK(statistics.counts[6] + statistics.counts[7] > 0);
+	BOOST_CHECK_EQUAL(signal_manager->queue_depth(), 0U);
+
+	watchdog->stop();
+	/* Run anything that the watchdog posted just before it stopped */
+	while (signal_manager->ui_idle()) {}
+	UIWatchdog::drop();
+}
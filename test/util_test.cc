@@ -155,3 +155,25 @@ BOOST_AUTO_TEST_CASE(word_wrap_test)
 	BOOST_CHECK(word_wrap("hello this is a longer bit of text and it should be word-wrapped", 31) == string{"hello this is a longer bit of \ntext and it should be word-\nwrapped\n"});
 	BOOST_CHECK_EQUAL(word_wrap("hellocan'twrapthissadly", 5), "hello\ncan't\nwrapt\nhissa\ndly\n");
 }
+
+
+BOOST_AUTO_TEST_CASE(certificate_chain_valid_test)
+{
+	auto good = std::make_shared<dcp::CertificateChain>(dcp::file_to_string("test/data/signer_chain"));
+	auto decryption = std::make_shared<dcp::CertificateChain>(dcp::file_to_string("test/data/decryption_chain"));
+
+	/* The signer's certificates with the wrong private key */
+	auto bad = std::make_shared<dcp::CertificateChain>(*good);
+	bad->set_key(decryption->key().get());
+
+	string bad_reason;
+	BOOST_REQUIRE(!bad->valid(&bad_reason));
+
+	/* Check twice so that we see the cached result too */
+	for (int i = 0; i < 2; ++i) {
+		BOOST_CHECK(certificate_chain_valid(good));
+		string reason;
+		BOOST_CHECK(!certificate_chain_valid(bad, &reason));
+		BOOST_CHECK_EQUAL(reason, bad_reason);
+	}
+}
@@ -0,0 +1,89 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+/** @file  test/video_complexity_test.cc
+ *  @brief Test VideoComplexity.
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/image.h"
+#include "lib/video_complexity.h"
+#include "test.h"
+#include <boost/test/unit_test.hpp>
+
+
+using std::make_shared;
+
+
+BOOST_AUTO_TEST_CASE (video_complexity_measure_test)
+{
+	dcp::Size const size(64, 32);
+
+	auto flat = make_shared<Image>(AV_PIX_FMT_RGB24, size, Image::Alignment::PADDED);
+	flat->make_black ();
+	BOOST_CHECK_EQUAL (VideoComplexity::measure(flat), 0);
+
+	auto stripes = make_shared<Image>(AV_PIX_FMT_RGB24, size, Image::Alignment::PADDED);
+	for (int y = 0; y < size.height; ++y) {
+		auto p = stripes->data()[0] + y * stripes->stride()[0];
+		for (int x = 0; x < size.width * 3; ++x) {
+			*p++ = ((x / 3) % 2) ? 255 : 0;
+		}
+	}
+	BOOST_CHECK_CLOSE (VideoComplexity::measure(stripes), 255, 0.1);
+}
+
+
+BOOST_AUTO_TEST_CASE (video_complexity_bandwidth_test)
+{
+	VideoComplexity complexity;
+	for (int i = 0; i < 100; ++i) {
+		complexity.add (i, i < 50 ? 0 : 100);
+	}
+
+	int const average = 150000000;
+	int const maximum = 250000000;
+
+	auto const simple = complexity.j2k_bandwidth(0, average, maximum);
+	auto const complex = complexity.j2k_bandwidth(99, average, maximum);
+	BOOST_CHECK (simple < average);
+	BOOST_CHECK (complex > average);
+	BOOST_CHECK (complex <= maximum);
+	BOOST_CHECK_CLOSE ((simple + complex) / 2.0, average, 0.01);
+
+	/* Frames we know nothing about get the average */
+	BOOST_CHECK_EQUAL (complexity.j2k_bandwidth(100, average, maximum), average);
+
+	/* The maximum is never used to bring the bandwidth below the average */
+	BOOST_CHECK_EQUAL (complexity.j2k_bandwidth(99, average, 100000000), average);
+
+	auto const path = boost::filesystem::path("build/test/video_complexity_bandwidth_test");
+	boost::filesystem::remove(path);
+	complexity.write (path);
+
+	VideoComplexity read(path);
+	BOOST_CHECK_EQUAL (read.frames(), 100);
+	BOOST_CHECK_EQUAL (read.j2k_bandwidth(0, average, maximum), simple);
+	BOOST_CHECK_EQUAL (read.j2k_bandwidth(99, average, maximum), complex);
+}
@@ -0,0 +1,57 @@
+/*
+    Copyright (C) 2026 Carl Hetherington <cth@carlh.net>
+
+    This file is part of DCP-o-matic.
+
+    DCP-o-matic is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DCP-o-matic is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DCP-o-matic.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/** @file  test/xyz_image_pool_test.cc
+ *  @brief Check re-use of images by pooled_xyz_image().
+ *  @ingroup selfcontained
+ */
+
+
+#include "lib/xyz_image_pool.h"
+#include <dcp/openjpeg_image.h>
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE(xyz_image_pool_test)
+{
+	dcp::Size const size(1998, 1080);
+
+	auto first = pooled_xyz_image(size);
+	BOOST_REQUIRE(first);
+	BOOST_CHECK(first->size() == size);
+	auto const first_address = first.get();
+
+	/* Something else of the same size can't have the image while it's in use */
+	auto second = pooled_xyz_image(size);
+	BOOST_CHECK(second.get() != first_address);
+
+	/* but it can be re-used afterwards */
+	first.reset();
+	auto third = pooled_xyz_image(size);
+	BOOST_CHECK(third.get() == first_address);
+
+	/* and not for a different size */
+	third.reset();
+	auto other = pooled_xyz_image(dcp::Size(2048, 858));
+	BOOST_CHECK(other.get() != first_address);
+	BOOST_CHECK(other->size() == dcp::Size(2048, 858));
+}
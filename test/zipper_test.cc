@@ -34,6 +34,9 @@
 #include <boost/filesystem.hpp>
 
 
+using std::string;
+
+
 /** Basic test of Zipper working normally */
 BOOST_AUTO_TEST_CASE (zipper_test1)
 {
@@ -73,3 +76,35 @@ BOOST_AUTO_TEST_CASE (zipper_test2, * boost::unit_test::depends_on("zipper_test1
 	BOOST_CHECK_THROW (Zipper("build/test/zipped.zip"), FileError);
 }
 
+
+
+/** Test entries whose content is only made when the ZIP is written */
+BOOST_AUTO_TEST_CASE (zipper_deferred_content_test)
+{
+	boost::system::error_code ec;
+	boost::filesystem::remove ("build/test/zipped_deferred.zip", ec);
+
+	int made = 0;
+	Zipper zipper ("build/test/zipped_deferred.zip");
+	zipper.add ("foo.txt", [&made]() -> string { ++made; return string("1234567890"); });
+	zipper.add ("bar.txt", [&made]() -> string { ++made; return string(100000, 'x'); });
+#ifdef DCPOMATIC_HAVE_ZIP_SOURCE_T
+	BOOST_CHECK_EQUAL (made, 0);
+#endif
+	zipper.close ();
+	BOOST_CHECK_EQUAL (made, 2);
+
+	boost::filesystem::current_path(dcp::filesystem::unfix_long_path(boost::filesystem::current_path()));
+
+	boost::filesystem::remove_all ("build/test/zipper_deferred_content_test", ec);
+#ifdef DCPOMATIC_WINDOWS
+	boost::filesystem::create_directories ("build/test/zipper_deferred_content_test");
+	int const r = system ("tar -xf build\\test\\zipped_deferred.zip -C build\\test\\zipper_deferred_content_test");
+#else
+	int const r = system ("unzip build/test/zipped_deferred.zip -d build/test/zipper_deferred_content_test");
+#endif
+	BOOST_REQUIRE_EQUAL (r, 0);
+
+	BOOST_CHECK_EQUAL (dcp::file_to_string("build/test/zipper_deferred_content_test/foo.txt"), "1234567890");
+	BOOST_CHECK_EQUAL (dcp::file_to_string("build/test/zipper_deferred_content_test/bar.txt"), string(100000, 'x'));
+}